@@ -974,6 +974,25 @@ static errno_t confdb_init_domain(struct sss_domain_info *domain,
         goto done;
     }
 
+    ret = get_entry_as_bool(res->msgs[0], &domain->initgr_closure,
+                            CONFDB_DOMAIN_INITGR_CLOSURE, 0);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Invalid value for %s\n",
+               CONFDB_DOMAIN_INITGR_CLOSURE);
+        goto done;
+    }
+
+    tmp = ldb_msg_find_attr_as_string(res->msgs[0],
+                                      CONFDB_DOMAIN_CACHE_FORMAT,
+                                      SYSDB_CACHE_FORMAT_STANDARD);
+    ret = sysdb_cache_format_from_str(tmp, &domain->cache_format);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Invalid value [%s] for %s\n", tmp, CONFDB_DOMAIN_CACHE_FORMAT);
+        goto done;
+    }
+
     ret = get_entry_as_uint32(res->msgs[0], &domain->id_min,
                               CONFDB_DOMAIN_MINID,
                               SSSD_MIN_ID);
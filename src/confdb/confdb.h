@@ -97,6 +97,13 @@
 #define CONFDB_RESPONDER_IDLE_TIMEOUT "responder_idle_timeout"
 #define CONFDB_RESPONDER_IDLE_DEFAULT_TIMEOUT 300
 #define CONFDB_RESPONDER_CACHE_FIRST "cache_first"
+#define CONFDB_RESPONDER_PARALLEL_DOMAIN_LOOKUP "parallel_domain_lookup"
+#define CONFDB_RESPONDER_RESULT_CACHE_SIZE "result_cache_size"
+#define CONFDB_RESPONDER_RESULT_CACHE_SIZE_DEFAULT 1000
+#define CONFDB_RESPONDER_RESULT_CACHE_TIMEOUT "result_cache_timeout"
+#define CONFDB_RESPONDER_RESULT_CACHE_TIMEOUT_DEFAULT 5
+#define CONFDB_RESPONDER_SYSDB_READERS "sysdb_readers"
+#define CONFDB_RESPONDER_SYSDB_READERS_DEFAULT 0
 #ifdef BUILD_FILES_PROVIDER
 /* There is a subtile issue with this option when 'files' + another domain is enabled */
 #define CONFDB_RESPONDER_CACHE_FIRST_DEFAILT false
@@ -125,6 +132,11 @@
 #define CONFDB_NSS_MEMCACHE_SIZE_GROUP "memcache_size_group"
 #define CONFDB_NSS_MEMCACHE_SIZE_INITGROUPS "memcache_size_initgroups"
 #define CONFDB_NSS_MEMCACHE_SIZE_SID "memcache_size_sid"
+#define CONFDB_NSS_MEMCACHE_SIZE_NETGROUP "memcache_size_netgroup"
+#define CONFDB_NSS_MEMCACHE_SIZE_SERVICES "memcache_size_services"
+#define CONFDB_NSS_MEMCACHE_MAX_GROWTH "memcache_max_growth"
+#define CONFDB_NSS_MEMCACHE_WARM_START "memcache_warm_start"
+#define CONFDB_NSS_INSTANCES "instances"
 #define CONFDB_NSS_HOMEDIR_SUBSTRING "homedir_substring"
 #define CONFDB_DEFAULT_HOMEDIR_SUBSTRING "/home"
 
@@ -249,6 +261,9 @@
 #define CONFDB_DOMAIN_SUBDOMAIN_HOMEDIR "subdomain_homedir"
 #define CONFDB_DOMAIN_DEFAULT_SUBDOMAIN_HOMEDIR "/home/%d/%u"
 #define CONFDB_DOMAIN_IGNORE_GROUP_MEMBERS "ignore_group_members"
+#define CONFDB_DOMAIN_INITGR_CLOSURE "initgroups_closure_index"
+#define CONFDB_DOMAIN_TS_FLUSH_INTERVAL "timestamp_cache_flush_interval"
+#define CONFDB_DOMAIN_CACHE_FORMAT "cache_format"
 #define CONFDB_DOMAIN_SUBDOMAIN_REFRESH "subdomain_refresh_interval"
 #define CONFDB_DOMAIN_SUBDOMAIN_REFRESH_DEFAULT_VALUE 14400
 #define CONFDB_DOMAIN_SUBDOMAIN_REFRESH_OFFSET "subdomain_refresh_interval_offset"
@@ -373,6 +388,11 @@ enum sss_domain_mpg_mode {
     MPG_DEFAULT, /* Use default value for given id mapping. */
 };
 
+enum sss_cache_format {
+    SSS_CACHE_FORMAT_STANDARD, /* records and indexes keyed by DN */
+    SSS_CACHE_FORMAT_COMPACT,  /* records and indexes keyed by recordGUID */
+};
+
 /**
  * Data structure storing all of the basic features
  * of a domain.
@@ -389,6 +409,8 @@ struct sss_domain_info {
     bool fqnames;
     enum sss_domain_mpg_mode mpg_mode;
     bool ignore_group_members;
+    bool initgr_closure;
+    enum sss_cache_format cache_format;
     uint32_t id_min;
     uint32_t id_max;
     const char *pwfield;
@@ -29,6 +29,10 @@ class SSSDOptions(object):
         'client_idle_timeout': _('Idle time before automatic disconnection of a client'),
         'responder_idle_timeout': _('Idle time before automatic shutdown of the responder'),
         'cache_first': _('Always query all the caches before querying the Data Providers'),
+        'parallel_domain_lookup': _('Query all domains at once when the domain of an object is not known'),
+        'result_cache_size': _('Number of recently found objects kept in memory by the responder'),
+        'result_cache_timeout': _('How long the responder keeps a found object in memory'),
+        'sysdb_readers': _('Number of processes searching the cache for the responder'),
         'offline_timeout': _('When SSSD switches to offline mode the amount of time before it tries to go back online '
                              'will increase based upon the time spent disconnected. This value is in seconds and '
                              'calculated by the following: offline_timeout + random_offset.'),
@@ -78,6 +82,15 @@ class SSSDOptions(object):
             'Size (in megabytes) of the data table allocated inside fast in-memory cache for group requests'),
         'memcache_size_initgroups': _(
             'Size (in megabytes) of the data table allocated inside fast in-memory cache for initgroups requests'),
+        'memcache_size_netgroup': _(
+            'Size (in megabytes) of the data table allocated inside fast in-memory cache for netgroup requests'),
+        'memcache_size_services': _(
+            'Size (in megabytes) of the data table allocated inside fast in-memory cache for services requests'),
+        'memcache_max_growth': _(
+            'Factor by which the fast in-memory caches may grow at runtime instead of dropping live records'),
+        'memcache_warm_start': _(
+            'Whether to keep the unexpired records of the fast in-memory caches when the NSS responder starts'),
+        'instances': _('Number of NSS responder processes that share the NSS socket'),
         'homedir_substring': _('The value of this option will be used in the expansion of the override_homedir option '
                                'if the template contains the format string %H.'),
         'get_domains_timeout': _('Specifies time in seconds for which the list of subdomains will be considered '
@@ -176,6 +189,9 @@ class SSSDOptions(object):
         'cache_credentials': _('Cache credentials for offline login'),
         'use_fully_qualified_names': _('Display users/groups in fully-qualified form'),
         'ignore_group_members': _('Don\'t include group members in group lookups'),
+        'initgroups_closure_index': _('Keep the groups of each user in an index for initgroups lookups'),
+        'timestamp_cache_flush_interval': _('How often timestamp-only cache updates are written (seconds)'),
+        'cache_format': _('On-disk format of the cache'),
         'entry_cache_timeout': _('Entry cache timeout length (seconds)'),
         'lookup_family_order': _('Restrict or prefer a specific address family when performing DNS lookups'),
         'account_cache_expiration': _('How long to keep cached entries after last successful login (days)'),
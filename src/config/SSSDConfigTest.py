@@ -343,6 +343,10 @@ class SSSDConfigTestSSSDService(unittest.TestCase):
             'client_idle_timeout',
             'responder_idle_timeout',
             'cache_first',
+            'parallel_domain_lookup',
+            'result_cache_size',
+            'result_cache_timeout',
+            'sysdb_readers',
             'description',
             'certificate_verification',
             'override_space',
@@ -560,6 +564,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'cache_credentials_minimal_first_factor_length',
             'use_fully_qualified_names',
             'ignore_group_members',
+            'initgroups_closure_index',
+            'timestamp_cache_flush_interval',
+            'cache_format',
             'filter_users',
             'filter_groups',
             'entry_cache_timeout',
@@ -921,6 +928,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'cache_credentials_minimal_first_factor_length',
             'use_fully_qualified_names',
             'ignore_group_members',
+            'initgroups_closure_index',
+            'timestamp_cache_flush_interval',
+            'cache_format',
             'filter_users',
             'filter_groups',
             'entry_cache_timeout',
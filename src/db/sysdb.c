@@ -906,6 +906,9 @@ int sysdb_transaction_commit(struct sysdb_ctx *sysdb)
     if (ret == LDB_SUCCESS) {
         sysdb->transaction_nesting--;
         PROBE(SYSDB_TRANSACTION_COMMIT_AFTER, sysdb->transaction_nesting);
+        if (sysdb->transaction_nesting == 0) {
+            sysdb_ts_buffer_commit(sysdb);
+        }
     } else {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Failed to commit ldb transaction! (%d)\n", ret);
@@ -921,6 +924,9 @@ int sysdb_transaction_cancel(struct sysdb_ctx *sysdb)
     if (ret == LDB_SUCCESS) {
         sysdb->transaction_nesting--;
         PROBE(SYSDB_TRANSACTION_CANCEL, sysdb->transaction_nesting);
+        if (sysdb->transaction_nesting == 0) {
+            sysdb_ts_buffer_cancel(sysdb);
+        }
     } else {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Failed to cancel ldb transaction! (%d)\n", ret);
@@ -1930,6 +1936,28 @@ done:
     return differs;
 }
 
+bool sysdb_entry_attrs_diff_msg(struct sysdb_ctx *sysdb,
+                                struct ldb_message *db_msg,
+                                struct sysdb_attrs *attrs,
+                                int mod_op)
+{
+    struct ldb_message *new_entry_msg;
+    bool differs;
+
+    if (sysdb->ldb_ts == NULL || is_ts_ldb_dn(db_msg->dn) == false) {
+        return true;
+    }
+
+    new_entry_msg = sysdb_attrs2msg(NULL, db_msg->dn, attrs, mod_op);
+    if (new_entry_msg == NULL) {
+        return true;
+    }
+
+    differs = sysdb_ldb_msg_difference(db_msg->dn, db_msg, new_entry_msg);
+    talloc_free(new_entry_msg);
+    return differs;
+}
+
 void ldb_debug_messages(void *context, enum ldb_debug_level level,
                         const char *fmt, va_list ap)
 {
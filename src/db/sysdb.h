@@ -102,9 +102,17 @@
 #define SYSDB_LAST_UPDATE "lastUpdate"
 #define SYSDB_CACHE_EXPIRE "dataExpireTimestamp"
 #define SYSDB_INITGR_EXPIRE "initgrExpireTimestamp"
+#define SYSDB_INITGR_CLOSURE "initgrClosure"
+#define SYSDB_INITGR_CLOSURE_GEN "initgrClosureGeneration"
+#define SYSDB_GROUP_GENERATION "groupGeneration"
 #define SYSDB_ENUM_EXPIRE "enumerationExpireTimestamp"
 #define SYSDB_IFP_CACHED "ifpCached"
 
+#define SYSDB_RECORD_GUID "recordGUID"
+#define SYSDB_CACHE_FORMAT "cacheFormat"
+#define SYSDB_CACHE_FORMAT_STANDARD "standard"
+#define SYSDB_CACHE_FORMAT_COMPACT "compact"
+
 #define SYSDB_AUTHORIZED_SERVICE "authorizedService"
 #define SYSDB_AUTHORIZED_HOST "authorizedHost"
 #define SYSDB_AUTHORIZED_RHOST "authorizedRHost"
@@ -525,6 +533,20 @@ int sysdb_transaction_start(struct sysdb_ctx *sysdb);
 int sysdb_transaction_commit(struct sysdb_ctx *sysdb);
 int sysdb_transaction_cancel(struct sysdb_ctx *sysdb);
 
+/* Timestamp-only refreshes of entries are kept in memory and written to the
+ * timestamp cache in one transaction every flush_interval seconds, or
+ * earlier if many are pending. A flush_interval of 0 writes them right away.
+ * Updates that are lost make the entries expire earlier, nothing else. */
+errno_t sysdb_ts_buffer_init(struct sysdb_ctx *sysdb,
+                             struct tevent_context *ev,
+                             uint32_t flush_interval);
+errno_t sysdb_ts_buffer_flush(struct sysdb_ctx *sysdb);
+
+/* The on-disk format of the cache, see sysdb_format.c */
+const char *sysdb_cache_format_str(enum sss_cache_format format);
+errno_t sysdb_cache_format_from_str(const char *str,
+                                    enum sss_cache_format *_format);
+
 /* functions related to subdomains */
 errno_t sysdb_domain_create(struct sysdb_ctx *sysdb, const char *domain_name);
 
@@ -921,6 +943,11 @@ int sysdb_initgroups_with_views(TALLOC_CTX *mem_ctx,
                                 const char *name,
                                 struct ldb_result **res);
 
+/* Rebuilds the initgroups closure index of the user if the domain keeps
+ * one. Called by the backend after the groups of the user were saved. */
+errno_t sysdb_initgr_closure_update(struct sss_domain_info *domain,
+                                    const char *name);
+
 int sysdb_get_user_attr(TALLOC_CTX *mem_ctx,
                         struct sss_domain_info *domain,
                         const char *name,
@@ -982,6 +1009,80 @@ int sysdb_search_entry(TALLOC_CTX *mem_ctx,
                        size_t *_msgs_count,
                        struct ldb_message ***_msgs);
 
+/* Asynchronous searches
+ *
+ * The searches are sent to one of the sysdb reader children started by
+ * sysdb_readers_init(), so they do not block the event loop. Without the
+ * readers, or if a reader fails, the cache is searched synchronously and
+ * the request finishes in the next event loop iteration.
+ *
+ * base_dn, filter and attrs must stay valid until the request finishes.
+ */
+struct sysdb_readers;
+
+errno_t sysdb_readers_init(TALLOC_CTX *mem_ctx,
+                           struct tevent_context *ev,
+                           struct sss_domain_info *domains,
+                           int num_readers,
+                           struct sysdb_readers **_readers);
+
+bool sysdb_readers_available(struct sss_domain_info *domain);
+
+struct tevent_req *sysdb_search_entry_send(TALLOC_CTX *mem_ctx,
+                                           struct tevent_context *ev,
+                                           struct sysdb_ctx *sysdb,
+                                           struct ldb_dn *base_dn,
+                                           enum ldb_scope scope,
+                                           const char *filter,
+                                           const char **attrs);
+
+int sysdb_search_entry_recv(struct tevent_req *req,
+                            TALLOC_CTX *mem_ctx,
+                            size_t *_msgs_count,
+                            struct ldb_message ***_msgs);
+
+/* Same results as sysdb_getpwnam() and sysdb_getpwuid() */
+struct tevent_req *sysdb_getpwnam_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_domain_info *domain,
+                                       const char *name);
+
+errno_t sysdb_getpwnam_recv(TALLOC_CTX *mem_ctx,
+                            struct tevent_req *req,
+                            struct ldb_result **_res);
+
+struct tevent_req *sysdb_getpwuid_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_domain_info *domain,
+                                       uid_t uid);
+
+errno_t sysdb_getpwuid_recv(TALLOC_CTX *mem_ctx,
+                            struct tevent_req *req,
+                            struct ldb_result **_res);
+
+/* Same results as sysdb_getpwnam_with_views() and
+ * sysdb_getpwuid_with_views(). Domains with views are always searched
+ * synchronously. */
+struct tevent_req *
+sysdb_getpwnam_with_views_send(TALLOC_CTX *mem_ctx,
+                               struct tevent_context *ev,
+                               struct sss_domain_info *domain,
+                               const char *name);
+
+errno_t sysdb_getpwnam_with_views_recv(TALLOC_CTX *mem_ctx,
+                                       struct tevent_req *req,
+                                       struct ldb_result **_res);
+
+struct tevent_req *
+sysdb_getpwuid_with_views_send(TALLOC_CTX *mem_ctx,
+                               struct tevent_context *ev,
+                               struct sss_domain_info *domain,
+                               uid_t uid);
+
+errno_t sysdb_getpwuid_with_views_recv(TALLOC_CTX *mem_ctx,
+                                       struct tevent_req *req,
+                                       struct ldb_result **_res);
+
 #define SSS_LDB_SEARCH(ret, ldb, mem_ctx, _result, base, scope, attrs,    \
                        exp_fmt, ...) do {                                 \
     int _sls_lret;                                                        \
@@ -1174,6 +1275,39 @@ int sysdb_store_group(struct sss_domain_info *domain,
                       uint64_t cache_timeout,
                       time_t now);
 
+/* A user or a group stored by sysdb_store_objects(). The fields have the
+ * meaning of the arguments of sysdb_store_user() and sysdb_store_group(),
+ * groups use only name, gid and attrs. */
+struct sysdb_store_obj {
+    enum sysdb_obj_type type;
+    const char *name;
+    const char *pwd;
+    uid_t uid;
+    gid_t gid;
+    const char *gecos;
+    const char *homedir;
+    const char *shell;
+    const char *orig_dn;
+    struct sysdb_attrs *attrs;
+    char **remove_attrs;
+
+    /* Set by sysdb_store_objects() */
+    errno_t ret;
+};
+
+/* Stores many users and groups of one domain in a single transaction. The
+ * cached entries are read with a few searches up front and compared in
+ * memory, instead of being searched for one by one.
+ *
+ * A failure to store one object does not stop the others, its error is
+ * saved in the ret field of the object. The function itself fails only if
+ * the whole batch could not be stored. */
+errno_t sysdb_store_objects(struct sss_domain_info *domain,
+                            struct sysdb_store_obj *objs,
+                            size_t num_objs,
+                            uint64_t cache_timeout,
+                            time_t now);
+
 int sysdb_add_group_member(struct sss_domain_info *domain,
                            const char *group,
                            const char *member,
@@ -0,0 +1,1017 @@
+/*
+   SSSD
+
+   System Database - asynchronous searches in the sysdb reader children
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <signal.h>
+
+#include "util/util.h"
+#include "util/child_common.h"
+#include "db/sysdb_private.h"
+#include "db/sysdb_reader.h"
+
+/* A reader that dies this many times in a row without answering a single
+ * search is not started again. */
+#define SYSDB_READER_MAX_FAILURES 5
+
+#define SYSDB_READER_IN_BUF_SIZE 4096
+
+struct sysdb_reader_out {
+    struct sysdb_reader_out *prev;
+    struct sysdb_reader_out *next;
+
+    struct sysdb_reader *reader;
+    uint8_t *buf;
+    size_t len;
+    size_t written;
+};
+
+struct sysdb_search_entry_state {
+    struct sysdb_search_entry_state *prev;
+    struct sysdb_search_entry_state *next;
+
+    struct tevent_req *req;
+    struct sysdb_reader *reader;
+    uint32_t id;
+
+    struct sysdb_ctx *sysdb;
+    struct ldb_dn *base_dn;
+    enum ldb_scope scope;
+    const char *filter;
+    const char **attrs;
+
+    size_t msgs_count;
+    struct ldb_message **msgs;
+};
+
+struct sysdb_reader {
+    struct sysdb_readers *readers;
+    int num;
+
+    pid_t pid;
+    bool running;
+    int failures;
+    int read_fd;
+    int write_fd;
+    struct tevent_fd *read_fde;
+    struct tevent_fd *write_fde;
+    struct sss_child_ctx_old *child_ctx;
+
+    /* requests waiting to be written to the child */
+    struct sysdb_reader_out *out;
+
+    /* replies read from the child */
+    uint8_t *in;
+    size_t in_len;
+    size_t in_size;
+
+    /* searches waiting for a reply */
+    struct sysdb_search_entry_state *searches;
+    size_t num_searches;
+};
+
+struct sysdb_readers {
+    struct tevent_context *ev;
+
+    struct sysdb_reader **readers;
+    int num_readers;
+
+    uint32_t next_id;
+};
+
+static errno_t sysdb_reader_start(struct sysdb_reader *reader);
+static void sysdb_reader_restart(struct sysdb_reader *reader);
+static void
+sysdb_search_entry_fallback(struct sysdb_search_entry_state *state,
+                            errno_t error);
+
+/* ==Reader=children===================================================== */
+
+static void sysdb_reader_stop(struct sysdb_reader *reader)
+{
+    reader->running = false;
+
+    talloc_zfree(reader->read_fde);
+    talloc_zfree(reader->write_fde);
+    PIPE_FD_CLOSE(reader->read_fd);
+    PIPE_FD_CLOSE(reader->write_fd);
+
+    if (reader->child_ctx != NULL) {
+        /* kills the child, it is still reaped */
+        child_handler_destroy(reader->child_ctx);
+        reader->child_ctx = NULL;
+    }
+
+    while (reader->out != NULL) {
+        talloc_free(reader->out);
+    }
+
+    reader->in_len = 0;
+}
+
+static int sysdb_reader_destructor(struct sysdb_reader *reader)
+{
+    struct sysdb_search_entry_state *state;
+
+    sysdb_reader_stop(reader);
+
+    /* The responder is shutting down, these are never finished */
+    for (state = reader->searches; state != NULL; state = state->next) {
+        state->reader = NULL;
+    }
+
+    return 0;
+}
+
+static int sysdb_reader_out_destructor(struct sysdb_reader_out *out)
+{
+    DLIST_REMOVE(out->reader->out, out);
+
+    return 0;
+}
+
+static void sysdb_reader_child_exited(int child_status,
+                                      struct tevent_signal *sige,
+                                      void *pvt)
+{
+    struct sysdb_reader *reader;
+
+    reader = talloc_get_type(pvt, struct sysdb_reader);
+
+    DEBUG(SSSDBG_OP_FAILURE, "sysdb reader %d [%d] exited with status "
+          "[%d]\n", reader->num, reader->pid, child_status);
+
+    /* The handler is freed after this callback returns */
+    reader->child_ctx = NULL;
+    sysdb_reader_restart(reader);
+}
+
+static void sysdb_reader_reply(struct sysdb_reader *reader,
+                               uint8_t *body,
+                               size_t len)
+{
+    struct sysdb_search_entry_state *state;
+    uint32_t id;
+    errno_t error;
+    errno_t ret;
+
+    ret = sysdb_reader_unpack_reply_header(body, len, &id, &error);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Malformed reply from sysdb reader %d\n",
+              reader->num);
+        return;
+    }
+
+    for (state = reader->searches; state != NULL; state = state->next) {
+        if (state->id == id) {
+            break;
+        }
+    }
+
+    if (state == NULL) {
+        /* The search was cancelled */
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Dropping reply [%u] from sysdb "
+              "reader %d\n", id, reader->num);
+        return;
+    }
+
+    DLIST_REMOVE(reader->searches, state);
+    reader->num_searches--;
+    state->reader = NULL;
+
+    if (error == EOK) {
+        ret = sysdb_reader_unpack_reply(state, state->sysdb->ldb, body, len,
+                                        &state->msgs_count, &state->msgs);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Malformed reply from sysdb reader "
+                  "%d [%d]: %s\n", reader->num, ret, sss_strerror(ret));
+            sysdb_search_entry_fallback(state, ret);
+            return;
+        }
+
+        tevent_req_done(state->req);
+    } else if (error == ENOENT) {
+        tevent_req_error(state->req, ENOENT);
+    } else {
+        sysdb_search_entry_fallback(state, error);
+    }
+}
+
+static errno_t sysdb_reader_read(struct sysdb_reader *reader)
+{
+    uint8_t *in;
+    size_t size;
+    size_t pos;
+    uint32_t len;
+    ssize_t n;
+
+    if (reader->in_size - reader->in_len < SYSDB_READER_IN_BUF_SIZE) {
+        size = reader->in_size * 2;
+        if (size < SYSDB_READER_IN_BUF_SIZE) {
+            size = SYSDB_READER_IN_BUF_SIZE;
+        }
+
+        in = talloc_realloc(reader, reader->in, uint8_t, size);
+        if (in == NULL) {
+            return ENOMEM;
+        }
+        reader->in = in;
+        reader->in_size = size;
+    }
+
+    n = read(reader->read_fd, reader->in + reader->in_len,
+             reader->in_size - reader->in_len);
+    if (n == -1) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return EOK;
+        }
+        return errno;
+    } else if (n == 0) {
+        return EPIPE;
+    }
+
+    reader->in_len += n;
+
+    /* Process all complete replies. The buffer is not touched by the
+     * callbacks of the searches. */
+    pos = 0;
+    while (reader->in_len - pos >= sizeof(uint32_t)) {
+        SAFEALIGN_COPY_UINT32(&len, reader->in + pos, NULL);
+        if (len > SYSDB_READER_MAX_FRAME) {
+            return EBADMSG;
+        }
+
+        if (reader->in_len - pos - sizeof(uint32_t) < len) {
+            break;
+        }
+
+        reader->failures = 0;
+        sysdb_reader_reply(reader, reader->in + pos + sizeof(uint32_t), len);
+        pos += sizeof(uint32_t) + len;
+
+        if (!reader->running) {
+            return EOK;
+        }
+    }
+
+    if (pos > 0) {
+        memmove(reader->in, reader->in + pos, reader->in_len - pos);
+        reader->in_len -= pos;
+    }
+
+    return EOK;
+}
+
+static errno_t sysdb_reader_write(struct sysdb_reader *reader)
+{
+    struct sysdb_reader_out *out;
+    ssize_t n;
+
+    while ((out = reader->out) != NULL) {
+        n = write(reader->write_fd, out->buf + out->written,
+                  out->len - out->written);
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return EOK;
+            }
+            return errno;
+        }
+
+        out->written += n;
+        if (out->written < out->len) {
+            return EOK;
+        }
+
+        talloc_free(out);
+    }
+
+    TEVENT_FD_NOT_WRITEABLE(reader->write_fde);
+    return EOK;
+}
+
+static void sysdb_reader_fd_handler(struct tevent_context *ev,
+                                    struct tevent_fd *fde,
+                                    uint16_t flags,
+                                    void *pvt)
+{
+    struct sysdb_reader *reader;
+    errno_t ret;
+
+    reader = talloc_get_type(pvt, struct sysdb_reader);
+
+    if (fde == reader->write_fde) {
+        ret = sysdb_reader_write(reader);
+    } else {
+        ret = sysdb_reader_read(reader);
+    }
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Lost sysdb reader %d [%d]: %s\n",
+              reader->num, ret, sss_strerror(ret));
+        sysdb_reader_restart(reader);
+    }
+}
+
+static errno_t sysdb_reader_start(struct sysdb_reader *reader)
+{
+    struct tevent_context *ev = reader->readers->ev;
+    int pipefd_to_child[2] = PIPE_INIT;
+    int pipefd_from_child[2] = PIPE_INIT;
+    pid_t child_pid;
+    errno_t ret;
+
+    ret = pipe(pipefd_from_child);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+    ret = pipe(pipefd_to_child);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+
+    child_pid = fork();
+    if (child_pid == 0) { /* child */
+        exec_child_ex(reader, pipefd_to_child, pipefd_from_child,
+                      SYSDB_READER_CHILD_PATH, SYSDB_READER_CHILD_LOG_FILE,
+                      NULL, false, STDIN_FILENO, STDOUT_FILENO);
+
+        /* We should never get here */
+        DEBUG(SSSDBG_CRIT_FAILURE, "BUG: Could not exec sysdb reader child\n");
+        _exit(1);
+    } else if (child_pid < 0) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "fork failed [%d][%s].\n", ret, strerror(ret));
+        goto done;
+    }
+
+    /* parent */
+    reader->pid = child_pid;
+
+    reader->read_fd = pipefd_from_child[0];
+    PIPE_FD_CLOSE(pipefd_from_child[1]);
+    sss_fd_nonblocking(reader->read_fd);
+
+    reader->write_fd = pipefd_to_child[1];
+    PIPE_FD_CLOSE(pipefd_to_child[0]);
+    sss_fd_nonblocking(reader->write_fd);
+
+    ret = child_handler_setup(ev, child_pid, sysdb_reader_child_exited,
+                              reader, &reader->child_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Could not set up child handlers [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    reader->read_fde = tevent_add_fd(ev, reader, reader->read_fd,
+                                     TEVENT_FD_READ,
+                                     sysdb_reader_fd_handler, reader);
+    reader->write_fde = tevent_add_fd(ev, reader, reader->write_fd, 0,
+                                      sysdb_reader_fd_handler, reader);
+    if (reader->read_fde == NULL || reader->write_fde == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    reader->running = true;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Started sysdb reader %d [%d]\n",
+          reader->num, reader->pid);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        PIPE_CLOSE(pipefd_from_child);
+        PIPE_CLOSE(pipefd_to_child);
+        sysdb_reader_stop(reader);
+    }
+
+    return ret;
+}
+
+static void sysdb_reader_restart(struct sysdb_reader *reader)
+{
+    struct sysdb_search_entry_state *state;
+    errno_t ret;
+
+    sysdb_reader_stop(reader);
+
+    /* The searches sent to this reader are done by the responder itself.
+     * Their callbacks may cancel other searches of this reader, which
+     * removes them from the list. */
+    while ((state = reader->searches) != NULL) {
+        DLIST_REMOVE(reader->searches, state);
+        reader->num_searches--;
+        state->reader = NULL;
+        sysdb_search_entry_fallback(state, EPIPE);
+    }
+
+    reader->failures++;
+    if (reader->failures >= SYSDB_READER_MAX_FAILURES) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb reader %d keeps failing, the "
+              "cache is searched without it\n", reader->num);
+        return;
+    }
+
+    ret = sysdb_reader_start(reader);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to restart sysdb reader %d "
+              "[%d]: %s\n", reader->num, ret, sss_strerror(ret));
+    }
+}
+
+static struct sysdb_reader *sysdb_readers_pick(struct sysdb_readers *readers)
+{
+    struct sysdb_reader *best = NULL;
+    int i;
+
+    if (readers == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < readers->num_readers; i++) {
+        if (!readers->readers[i]->running) {
+            continue;
+        }
+
+        if (best == NULL
+                || readers->readers[i]->num_searches < best->num_searches) {
+            best = readers->readers[i];
+        }
+    }
+
+    return best;
+}
+
+errno_t sysdb_readers_init(TALLOC_CTX *mem_ctx,
+                           struct tevent_context *ev,
+                           struct sss_domain_info *domains,
+                           int num_readers,
+                           struct sysdb_readers **_readers)
+{
+    struct sysdb_readers *readers;
+    struct sysdb_reader *reader;
+    struct sss_domain_info *dom;
+    errno_t ret;
+    int i;
+
+    if (num_readers <= 0) {
+        return EINVAL;
+    }
+
+    readers = talloc_zero(mem_ctx, struct sysdb_readers);
+    if (readers == NULL) {
+        return ENOMEM;
+    }
+
+    readers->ev = ev;
+    readers->num_readers = num_readers;
+    readers->readers = talloc_zero_array(readers, struct sysdb_reader *,
+                                         num_readers);
+    if (readers->readers == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_readers; i++) {
+        reader = talloc_zero(readers->readers, struct sysdb_reader);
+        if (reader == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        reader->readers = readers;
+        reader->num = i;
+        reader->read_fd = -1;
+        reader->write_fd = -1;
+        talloc_set_destructor(reader, sysdb_reader_destructor);
+        readers->readers[i] = reader;
+
+        ret = sysdb_reader_start(reader);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    /* Subdomains share the sysdb of their parent */
+    for (dom = domains; dom != NULL; dom = get_next_domain(dom, 0)) {
+        if (dom->sysdb != NULL) {
+            dom->sysdb->readers = readers;
+        }
+    }
+
+    *_readers = readers;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(readers);
+    }
+
+    return ret;
+}
+
+bool sysdb_readers_available(struct sss_domain_info *domain)
+{
+    if (domain == NULL || domain->sysdb == NULL) {
+        return false;
+    }
+
+    return sysdb_readers_pick(domain->sysdb->readers) != NULL;
+}
+
+/* ==Search-Entry========================================================= */
+
+
+static int sysdb_search_entry_destructor(struct sysdb_search_entry_state *state)
+{
+    if (state->reader != NULL) {
+        DLIST_REMOVE(state->reader->searches, state);
+        state->reader->num_searches--;
+        state->reader = NULL;
+    }
+
+    return 0;
+}
+
+/* Search in the responder, if the readers cannot */
+static void
+sysdb_search_entry_fallback(struct sysdb_search_entry_state *state,
+                            errno_t error)
+{
+    errno_t ret;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "sysdb reader search failed [%d]: %s, "
+          "searching the cache directly\n", error, sss_strerror(error));
+
+    ret = sysdb_search_entry(state, state->sysdb, state->base_dn,
+                             state->scope, state->filter, state->attrs,
+                             &state->msgs_count, &state->msgs);
+    if (ret != EOK) {
+        tevent_req_error(state->req, ret);
+        return;
+    }
+
+    tevent_req_done(state->req);
+}
+
+static errno_t
+sysdb_search_entry_queue(struct sysdb_search_entry_state *state,
+                         struct sysdb_reader *reader)
+{
+    struct sysdb_reader_request request = { 0 };
+    struct sysdb_reader_out *out;
+    errno_t ret;
+
+    out = talloc_zero(reader, struct sysdb_reader_out);
+    if (out == NULL) {
+        return ENOMEM;
+    }
+
+    state->id = reader->readers->next_id++;
+
+    request.id = state->id;
+    request.scope = state->scope;
+    request.ldb_file = state->sysdb->ldb_file;
+    request.ts_file = state->sysdb->ldb_ts != NULL ? state->sysdb->ldb_ts_file
+                                                   : NULL;
+    request.base_dn = ldb_dn_get_linearized(state->base_dn);
+    request.filter = state->filter;
+    request.attrs = state->attrs;
+
+    if (request.base_dn == NULL) {
+        talloc_free(out);
+        return EINVAL;
+    }
+
+    ret = sysdb_reader_pack_request(out, &request, &out->buf, &out->len);
+    if (ret != EOK) {
+        talloc_free(out);
+        return ret;
+    }
+
+    out->reader = reader;
+    talloc_set_destructor(out, sysdb_reader_out_destructor);
+    DLIST_ADD_END(reader->out, out, struct sysdb_reader_out *);
+    TEVENT_FD_WRITEABLE(reader->write_fde);
+
+    state->reader = reader;
+    DLIST_ADD(reader->searches, state);
+    reader->num_searches++;
+    talloc_set_destructor(state, sysdb_search_entry_destructor);
+
+    return EOK;
+}
+
+struct tevent_req *sysdb_search_entry_send(TALLOC_CTX *mem_ctx,
+                                           struct tevent_context *ev,
+                                           struct sysdb_ctx *sysdb,
+                                           struct ldb_dn *base_dn,
+                                           enum ldb_scope scope,
+                                           const char *filter,
+                                           const char **attrs)
+{
+    struct sysdb_search_entry_state *state;
+    struct sysdb_reader *reader;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct sysdb_search_entry_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->req = req;
+    state->sysdb = sysdb;
+    state->base_dn = base_dn;
+    state->scope = scope;
+    state->filter = filter;
+    state->attrs = attrs;
+
+    reader = sysdb_readers_pick(sysdb->readers);
+    if (reader != NULL) {
+        ret = sysdb_search_entry_queue(state, reader);
+        if (ret == EOK) {
+            return req;
+        }
+
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to send search to sysdb reader "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+
+    ret = sysdb_search_entry(state, sysdb, base_dn, scope, filter, attrs,
+                             &state->msgs_count, &state->msgs);
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+int sysdb_search_entry_recv(struct tevent_req *req,
+                            TALLOC_CTX *mem_ctx,
+                            size_t *_msgs_count,
+                            struct ldb_message ***_msgs)
+{
+    struct sysdb_search_entry_state *state;
+    state = tevent_req_data(req, struct sysdb_search_entry_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_msgs_count = state->msgs_count;
+    *_msgs = talloc_steal(mem_ctx, state->msgs);
+
+    return EOK;
+}
+
+/* ==Users================================================================ */
+
+struct sysdb_getpw_state {
+    struct ldb_result *res;
+};
+
+static void sysdb_getpw_done(struct tevent_req *subreq);
+
+static struct tevent_req *sysdb_getpw_send(TALLOC_CTX *mem_ctx,
+                                           struct tevent_context *ev,
+                                           struct sss_domain_info *domain,
+                                           const char *filter)
+{
+    static const char *attrs[] = SYSDB_PW_ATTRS;
+    struct sysdb_getpw_state *state;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    struct ldb_dn *base_dn;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sysdb_getpw_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    if (filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    base_dn = sysdb_user_base_dn(state, domain);
+    if (base_dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    subreq = sysdb_search_entry_send(state, ev, domain->sysdb, base_dn,
+                                     LDB_SCOPE_SUBTREE, filter, attrs);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, sysdb_getpw_done, req);
+
+    return req;
+
+done:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static void sysdb_getpw_done(struct tevent_req *subreq)
+{
+    struct sysdb_getpw_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sysdb_getpw_state);
+
+    state->res = talloc_zero(state, struct ldb_result);
+    if (state->res == NULL) {
+        talloc_zfree(subreq);
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+
+    ret = sysdb_search_entry_recv(subreq, state->res, &state->res->count,
+                                  &state->res->msgs);
+    talloc_zfree(subreq);
+    if (ret == ENOENT) {
+        /* The synchronous lookups return an empty result */
+        state->res->count = 0;
+        state->res->msgs = NULL;
+    } else if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    if (state->res->count > 1) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Search for user returned %u results\n", state->res->count);
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t sysdb_getpw_recv(TALLOC_CTX *mem_ctx,
+                                struct tevent_req *req,
+                                struct ldb_result **_res)
+{
+    struct sysdb_getpw_state *state;
+    state = tevent_req_data(req, struct sysdb_getpw_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_res = talloc_steal(mem_ctx, state->res);
+
+    return EOK;
+}
+
+struct tevent_req *sysdb_getpwnam_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_domain_info *domain,
+                                       const char *name)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct tevent_req *req;
+    char *sanitized_name;
+    char *lc_sanitized_name;
+    char *filter = NULL;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return NULL;
+    }
+
+    ret = sss_filter_sanitize_for_dom(tmp_ctx, name, domain,
+                                      &sanitized_name, &lc_sanitized_name);
+    if (ret == EOK) {
+        filter = talloc_asprintf(tmp_ctx, SYSDB_PWNAM_FILTER,
+                                 lc_sanitized_name,
+                                 sanitized_name, sanitized_name);
+    }
+
+    /* a NULL filter fails the request with ENOMEM */
+    req = sysdb_getpw_send(mem_ctx, ev, domain, filter);
+    if (req != NULL && filter != NULL) {
+        talloc_steal(req, filter);
+    }
+
+    talloc_free(tmp_ctx);
+    return req;
+}
+
+errno_t sysdb_getpwnam_recv(TALLOC_CTX *mem_ctx,
+                            struct tevent_req *req,
+                            struct ldb_result **_res)
+{
+    return sysdb_getpw_recv(mem_ctx, req, _res);
+}
+
+struct tevent_req *sysdb_getpwuid_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_domain_info *domain,
+                                       uid_t uid)
+{
+    unsigned long int ul_uid = uid;
+    struct tevent_req *req;
+    char *filter;
+
+    filter = talloc_asprintf(NULL, SYSDB_PWUID_FILTER, ul_uid);
+
+    req = sysdb_getpw_send(mem_ctx, ev, domain, filter);
+    if (req != NULL && filter != NULL) {
+        talloc_steal(req, filter);
+    } else {
+        talloc_free(filter);
+    }
+
+    return req;
+}
+
+errno_t sysdb_getpwuid_recv(TALLOC_CTX *mem_ctx,
+                            struct tevent_req *req,
+                            struct ldb_result **_res)
+{
+    return sysdb_getpw_recv(mem_ctx, req, _res);
+}
+
+/* Overrides are looked up in the responder, so domains with views are
+ * searched synchronously. */
+
+struct sysdb_getpw_with_views_state {
+    struct ldb_result *res;
+};
+
+static void sysdb_getpw_with_views_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+sysdb_getpw_with_views_sync(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            struct sss_domain_info *domain,
+                            const char *name,
+                            uid_t uid)
+{
+    struct sysdb_getpw_with_views_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct sysdb_getpw_with_views_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    if (name != NULL) {
+        ret = sysdb_getpwnam_with_views(state, domain, name, &state->res);
+    } else {
+        ret = sysdb_getpwuid_with_views(state, domain, uid, &state->res);
+    }
+
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static struct tevent_req *
+sysdb_getpw_with_views_send(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            struct sss_domain_info *domain,
+                            const char *name,
+                            uid_t uid)
+{
+    struct sysdb_getpw_with_views_state *state;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+
+    if (DOM_HAS_VIEWS(domain) || !sysdb_readers_available(domain)) {
+        return sysdb_getpw_with_views_sync(mem_ctx, ev, domain, name, uid);
+    }
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct sysdb_getpw_with_views_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    if (name != NULL) {
+        subreq = sysdb_getpwnam_send(state, ev, domain, name);
+    } else {
+        subreq = sysdb_getpwuid_send(state, ev, domain, uid);
+    }
+    if (subreq == NULL) {
+        tevent_req_error(req, ENOMEM);
+        tevent_req_post(req, ev);
+        return req;
+    }
+
+    tevent_req_set_callback(subreq, sysdb_getpw_with_views_done, req);
+
+    return req;
+}
+
+static void sysdb_getpw_with_views_done(struct tevent_req *subreq)
+{
+    struct sysdb_getpw_with_views_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sysdb_getpw_with_views_state);
+
+    ret = sysdb_getpw_recv(state, subreq, &state->res);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t sysdb_getpw_with_views_recv(TALLOC_CTX *mem_ctx,
+                                           struct tevent_req *req,
+                                           struct ldb_result **_res)
+{
+    struct sysdb_getpw_with_views_state *state;
+    state = tevent_req_data(req, struct sysdb_getpw_with_views_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_res = talloc_steal(mem_ctx, state->res);
+
+    return EOK;
+}
+
+struct tevent_req *
+sysdb_getpwnam_with_views_send(TALLOC_CTX *mem_ctx,
+                               struct tevent_context *ev,
+                               struct sss_domain_info *domain,
+                               const char *name)
+{
+    if (name == NULL) {
+        return NULL;
+    }
+
+    return sysdb_getpw_with_views_send(mem_ctx, ev, domain, name, 0);
+}
+
+errno_t sysdb_getpwnam_with_views_recv(TALLOC_CTX *mem_ctx,
+                                       struct tevent_req *req,
+                                       struct ldb_result **_res)
+{
+    return sysdb_getpw_with_views_recv(mem_ctx, req, _res);
+}
+
+struct tevent_req *
+sysdb_getpwuid_with_views_send(TALLOC_CTX *mem_ctx,
+                               struct tevent_context *ev,
+                               struct sss_domain_info *domain,
+                               uid_t uid)
+{
+    return sysdb_getpw_with_views_send(mem_ctx, ev, domain, NULL, uid);
+}
+
+errno_t sysdb_getpwuid_with_views_recv(TALLOC_CTX *mem_ctx,
+                                       struct tevent_req *req,
+                                       struct ldb_result **_res)
+{
+    return sysdb_getpw_with_views_recv(mem_ctx, req, _res);
+}
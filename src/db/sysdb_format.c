@@ -0,0 +1,379 @@
+/*
+   SSSD
+
+   System Database - on-disk cache format
+
+   In the standard format every record of the cache is keyed by its DN and
+   every index entry lists the DNs of the records it matches. Member and
+   memberof values make every group DN appear in the indexes once for each
+   of its members and parents, and the users and groups DNs once more in
+   the objectCategory, name and id indexes.
+
+   The compact format gives every record a 16 byte recordGUID and lets ldb
+   key the records and the index entries by it, so the indexes hold fixed
+   size binary values instead of DNs. The member, memberof and ghost values
+   of the records themselves still hold full DNs.
+
+   The format is recorded in the base object of the cache, next to its
+   version, and caches are converted in both directions in one transaction.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "db/sysdb_private.h"
+
+#define SYSDB_IDXGUID "@IDXGUID"
+
+const char *sysdb_cache_format_str(enum sss_cache_format format)
+{
+    switch (format) {
+    case SSS_CACHE_FORMAT_STANDARD:
+        return SYSDB_CACHE_FORMAT_STANDARD;
+    case SSS_CACHE_FORMAT_COMPACT:
+        return SYSDB_CACHE_FORMAT_COMPACT;
+    }
+
+    return "unknown";
+}
+
+errno_t sysdb_cache_format_from_str(const char *str,
+                                    enum sss_cache_format *_format)
+{
+    if (strcasecmp(str, SYSDB_CACHE_FORMAT_STANDARD) == 0) {
+        *_format = SSS_CACHE_FORMAT_STANDARD;
+    } else if (strcasecmp(str, SYSDB_CACHE_FORMAT_COMPACT) == 0) {
+        *_format = SSS_CACHE_FORMAT_COMPACT;
+    } else {
+        return EINVAL;
+    }
+
+    return EOK;
+}
+
+errno_t sysdb_ldb_get_format(struct ldb_context *ldb,
+                             enum sss_cache_format *_format)
+{
+    static const char *attrs[] = { SYSDB_CACHE_FORMAT, NULL };
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_result *res;
+    struct ldb_dn *basedn;
+    const char *str;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    basedn = ldb_dn_new(tmp_ctx, ldb, SYSDB_BASE);
+    if (basedn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ldb_search(ldb, tmp_ctx, &res, basedn, LDB_SCOPE_BASE, attrs, NULL);
+    if (ret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(ret);
+        goto done;
+    }
+
+    if (res->count != 1) {
+        ret = EIO;
+        goto done;
+    }
+
+    /* caches created before the format was recorded are standard ones */
+    str = ldb_msg_find_attr_as_string(res->msgs[0], SYSDB_CACHE_FORMAT,
+                                      SYSDB_CACHE_FORMAT_STANDARD);
+    ret = sysdb_cache_format_from_str(str, _format);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unknown cache format [%s]\n", str);
+        goto done;
+    }
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* Adds a recordGUID to every record lacking one, or removes them all */
+static errno_t sysdb_format_set_guids(struct ldb_context *ldb, bool add)
+{
+    static const char *attrs[] = { SYSDB_RECORD_GUID, NULL };
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_result *res;
+    struct ldb_message *msg;
+    struct ldb_dn *basedn;
+    uint8_t guid[SSS_UNIQUE_ID_SIZE];
+    struct ldb_val val;
+    bool has_guid;
+    size_t count = 0;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    basedn = ldb_dn_new(tmp_ctx, ldb, SYSDB_BASE);
+    if (basedn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ldb_search(ldb, tmp_ctx, &res, basedn, LDB_SCOPE_SUBTREE,
+                     attrs, NULL);
+    if (ret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(ret);
+        goto done;
+    }
+
+    for (i = 0; i < res->count; i++) {
+        has_guid = ldb_msg_find_element(res->msgs[i],
+                                        SYSDB_RECORD_GUID) != NULL;
+        if (has_guid == add) {
+            continue;
+        }
+
+        msg = ldb_msg_new(tmp_ctx);
+        if (msg == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        msg->dn = res->msgs[i]->dn;
+
+        if (add) {
+            sss_unique_id(guid);
+            val.data = guid;
+            val.length = sizeof(guid);
+
+            ret = ldb_msg_add_empty(msg, SYSDB_RECORD_GUID,
+                                    LDB_FLAG_MOD_ADD, NULL);
+            if (ret == LDB_SUCCESS) {
+                ret = ldb_msg_add_value(msg, SYSDB_RECORD_GUID, &val, NULL);
+            }
+        } else {
+            ret = ldb_msg_add_empty(msg, SYSDB_RECORD_GUID,
+                                    LDB_FLAG_MOD_DELETE, NULL);
+        }
+        if (ret != LDB_SUCCESS) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = ldb_modify(ldb, msg);
+        if (ret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Cannot update the record GUID of [%s]: [%s]\n",
+                  ldb_dn_get_linearized(msg->dn), ldb_errstring(ldb));
+            ret = sysdb_error_to_errno(ret);
+            goto done;
+        }
+
+        talloc_free(msg);
+        count++;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s the record GUID of %zu entries\n",
+          add ? "Added" : "Removed", count);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* Switches the record and index keys of ldb to the recordGUID or back to
+ * the DN, ldb re-keys and reindexes the whole cache when @INDEXLIST changes */
+static errno_t sysdb_format_set_index(struct ldb_context *ldb, bool add)
+{
+    struct ldb_message *msg;
+    errno_t ret;
+
+    msg = ldb_msg_new(NULL);
+    if (msg == NULL) {
+        return ENOMEM;
+    }
+
+    msg->dn = ldb_dn_new(msg, ldb, "@INDEXLIST");
+    if (msg->dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ldb_msg_add_empty(msg, SYSDB_IDXGUID, LDB_FLAG_MOD_REPLACE, NULL);
+    if (ret == LDB_SUCCESS && add) {
+        ret = ldb_msg_add_string(msg, SYSDB_IDXGUID, SYSDB_RECORD_GUID);
+    }
+    if (ret != LDB_SUCCESS) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ldb_modify(ldb, msg);
+    if (ret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot update @INDEXLIST: [%s]\n",
+              ldb_errstring(ldb));
+        ret = sysdb_error_to_errno(ret);
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(msg);
+    return ret;
+}
+
+static errno_t sysdb_format_set_base(struct ldb_context *ldb,
+                                     enum sss_cache_format format)
+{
+    struct ldb_message *msg;
+    errno_t ret;
+
+    msg = ldb_msg_new(NULL);
+    if (msg == NULL) {
+        return ENOMEM;
+    }
+
+    msg->dn = ldb_dn_new(msg, ldb, SYSDB_BASE);
+    if (msg->dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ldb_msg_add_empty(msg, SYSDB_CACHE_FORMAT, LDB_FLAG_MOD_REPLACE,
+                            NULL);
+    if (ret == LDB_SUCCESS) {
+        ret = ldb_msg_add_string(msg, SYSDB_CACHE_FORMAT,
+                                 sysdb_cache_format_str(format));
+    }
+    if (ret != LDB_SUCCESS) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = ldb_modify(ldb, msg);
+    if (ret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(ret);
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(msg);
+    return ret;
+}
+
+errno_t sysdb_ldb_set_format(struct ldb_context *ldb,
+                             enum sss_cache_format format,
+                             bool *_converted)
+{
+    enum sss_cache_format current;
+    bool in_transaction = false;
+    bool compact;
+    errno_t ret;
+
+    ret = sysdb_ldb_get_format(ldb, &current);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (current == format) {
+        *_converted = false;
+        return EOK;
+    }
+
+    DEBUG(SSSDBG_IMPORTANT_INFO, "CONVERTING CACHE TO FORMAT %s\n",
+          sysdb_cache_format_str(format));
+
+    ret = ldb_transaction_start(ldb);
+    if (ret != LDB_SUCCESS) {
+        return EIO;
+    }
+    in_transaction = true;
+
+    /* ldb refuses to re-key records lacking the GUID and to change the GUID
+     * of records keyed by it, hence the order */
+    compact = (format == SSS_CACHE_FORMAT_COMPACT);
+    if (compact) {
+        ret = sysdb_format_set_guids(ldb, true);
+        if (ret == EOK) {
+            ret = sysdb_format_set_index(ldb, true);
+        }
+    } else {
+        ret = sysdb_format_set_index(ldb, false);
+        if (ret == EOK) {
+            ret = sysdb_format_set_guids(ldb, false);
+        }
+    }
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_format_set_base(ldb, format);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = ldb_transaction_commit(ldb);
+    if (ret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(ret);
+        goto done;
+    }
+    in_transaction = false;
+
+    *_converted = true;
+    ret = EOK;
+
+done:
+    if (in_transaction) {
+        ldb_transaction_cancel(ldb);
+    }
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot convert the cache [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+    return ret;
+}
+
+errno_t sysdb_manage_format(TALLOC_CTX *mem_ctx,
+                            const char *name,
+                            bool convert,
+                            enum sss_cache_format *format)
+{
+    struct ldb_context *ldb = NULL;
+    bool converted;
+    errno_t ret;
+
+    ret = sysdb_ldb_connect(mem_ctx, name, LDB_FLG_DONT_CREATE_DB, &ldb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_ldb_connect() failed.\n");
+        goto done;
+    }
+
+    if (convert) {
+        ret = sysdb_ldb_set_format(ldb, *format, &converted);
+    } else {
+        ret = sysdb_ldb_get_format(ldb, format);
+    }
+
+done:
+    talloc_free(ldb);
+
+    return ret;
+}
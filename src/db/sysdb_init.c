@@ -717,6 +717,31 @@ static errno_t sysdb_ts_cache_connect(TALLOC_CTX *mem_ctx,
                                       ldb, version);
 }
 
+static errno_t sysdb_domain_cache_format(TALLOC_CTX *mem_ctx,
+                                         struct sysdb_ctx *sysdb,
+                                         struct sss_domain_info *domain,
+                                         struct ldb_context **ldb)
+{
+    bool converted;
+    errno_t ret;
+
+    ret = sysdb_ldb_set_format(*ldb, domain->cache_format, &converted);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Could not convert the cache of domain %s to format %s\n",
+              domain->name, sysdb_cache_format_str(domain->cache_format));
+        return ret;
+    }
+
+    if (!converted) {
+        return EOK;
+    }
+
+    /* The memberof module reads the attribute new records are keyed by
+     * when the cache is opened, reopen it. */
+    return sysdb_ldb_reconnect(mem_ctx, sysdb->ldb_file, 0, ldb);
+}
+
 static int sysdb_domain_cache_connect(struct sysdb_ctx *sysdb,
                                       struct sss_domain_info *domain,
                                       struct sysdb_dom_upgrade_ctx *upgrade_ctx)
@@ -786,6 +811,11 @@ static int sysdb_domain_cache_connect(struct sysdb_ctx *sysdb,
     }
 
 done:
+    if (ret == EOK && upgrade_ctx != NULL) {
+        /* Only the process allowed to upgrade the cache converts it, the
+         * others use the cache in the format it is in. */
+        ret = sysdb_domain_cache_format(tmp_ctx, sysdb, domain, &ldb);
+    }
     if (ret == EOK) {
         sysdb->ldb = talloc_steal(sysdb, ldb);
     }
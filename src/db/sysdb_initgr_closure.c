@@ -0,0 +1,345 @@
+/*
+   SSSD
+
+   System Database - initgroups closure index
+
+   The groups a user is a direct or nested member of, with the attributes
+   initgroups returns for them, are kept in the timestamp cache entry of
+   the user. The backend rebuilds the index whenever it has saved the
+   groups of the user, the responders only read it.
+
+   The memberof module replaces the generation of the group data in the
+   base entry of the cache whenever a write may change which groups an
+   entry is a member of, or the attributes of such groups. The index is
+   stored with the generation it was built with and is used only while
+   that generation is current.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "db/sysdb_private.h"
+#include "db/sysdb_reader.h"
+
+/* The groups are stored in the encoding of the sysdb reader replies, the
+ * id field of the reply carries the version of the index */
+#define SYSDB_INITGR_CLOSURE_VERSION 1
+
+/* generation of caches where no group was written yet */
+#define SYSDB_GROUP_GENERATION_NONE "0"
+
+bool sysdb_initgr_closure_enabled(struct sss_domain_info *domain)
+{
+    return domain->initgr_closure && domain->sysdb->ldb_ts != NULL;
+}
+
+static errno_t sysdb_group_generation(TALLOC_CTX *mem_ctx,
+                                      struct sysdb_ctx *sysdb,
+                                      const char **_generation)
+{
+    static const char *attrs[] = { SYSDB_GROUP_GENERATION, NULL };
+    struct ldb_result *res;
+    struct ldb_dn *base_dn;
+    const char *generation;
+    errno_t ret;
+    int lret;
+
+    base_dn = ldb_dn_new(mem_ctx, sysdb->ldb, SYSDB_BASE);
+    if (base_dn == NULL) {
+        return ENOMEM;
+    }
+
+    lret = ldb_search(sysdb->ldb, mem_ctx, &res, base_dn, LDB_SCOPE_BASE,
+                      attrs, NULL);
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    generation = SYSDB_GROUP_GENERATION_NONE;
+    if (res->count == 1) {
+        generation = ldb_msg_find_attr_as_string(res->msgs[0],
+                                                 SYSDB_GROUP_GENERATION,
+                                                 generation);
+    }
+
+    *_generation = talloc_strdup(mem_ctx, generation);
+    ret = *_generation == NULL ? ENOMEM : EOK;
+    talloc_free(res);
+
+done:
+    talloc_free(base_dn);
+    return ret;
+}
+
+errno_t sysdb_initgr_closure_get(TALLOC_CTX *mem_ctx,
+                                 struct sss_domain_info *domain,
+                                 struct ldb_dn *user_dn,
+                                 size_t *_count,
+                                 struct ldb_message ***_msgs)
+{
+    static const char *attrs[] = { SYSDB_INITGR_CLOSURE,
+                                   SYSDB_INITGR_CLOSURE_GEN,
+                                   NULL };
+    struct sysdb_ctx *sysdb = domain->sysdb;
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_result *res;
+    const struct ldb_val *val;
+    const char *stored_generation;
+    const char *generation;
+    struct ldb_message **msgs;
+    uint32_t version;
+    size_t count;
+    errno_t error;
+    errno_t ret;
+    int lret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    lret = ldb_search(sysdb->ldb_ts, tmp_ctx, &res, user_dn, LDB_SCOPE_BASE,
+                      attrs, NULL);
+    if (lret == LDB_ERR_NO_SUCH_OBJECT) {
+        ret = ENOENT;
+        goto done;
+    } else if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    if (res->count != 1) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    stored_generation = ldb_msg_find_attr_as_string(res->msgs[0],
+                                                    SYSDB_INITGR_CLOSURE_GEN,
+                                                    NULL);
+    val = ldb_msg_find_ldb_val(res->msgs[0], SYSDB_INITGR_CLOSURE);
+    if (val == NULL || stored_generation == NULL) {
+        DEBUG(SSSDBG_TRACE_ALL, "No closure index for [%s]\n",
+              ldb_dn_get_linearized(user_dn));
+        ret = ENOENT;
+        goto done;
+    }
+
+    ret = sysdb_group_generation(tmp_ctx, sysdb, &generation);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (strcmp(generation, stored_generation) != 0) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "The groups changed since the closure index of [%s] was "
+              "built\n", ldb_dn_get_linearized(user_dn));
+        ret = ENOENT;
+        goto done;
+    }
+
+    /* skip the frame length */
+    if (val->length < sizeof(uint32_t)) {
+        ret = EINVAL;
+        goto done;
+    }
+
+    ret = sysdb_reader_unpack_reply_header(val->data + sizeof(uint32_t),
+                                           val->length - sizeof(uint32_t),
+                                           &version, &error);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (version != SYSDB_INITGR_CLOSURE_VERSION || error != EOK) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    ret = sysdb_reader_unpack_reply(mem_ctx, sysdb->ldb,
+                                    val->data + sizeof(uint32_t),
+                                    val->length - sizeof(uint32_t),
+                                    &count, &msgs);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    *_count = count;
+    *_msgs = msgs;
+
+done:
+    if (ret != EOK && ret != ENOENT) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot read the closure index of [%s] [%d]: %s\n",
+              ldb_dn_get_linearized(user_dn), ret, sss_strerror(ret));
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static int sysdb_initgr_closure_cmp(const void *a, const void *b)
+{
+    uint64_t gid_a;
+    uint64_t gid_b;
+
+    gid_a = ldb_msg_find_attr_as_uint64(*(struct ldb_message * const *)a,
+                                        SYSDB_GIDNUM, 0);
+    gid_b = ldb_msg_find_attr_as_uint64(*(struct ldb_message * const *)b,
+                                        SYSDB_GIDNUM, 0);
+
+    return gid_a < gid_b ? -1 : gid_a > gid_b ? 1 : 0;
+}
+
+/* Stores the groups of user_dn, as returned by the initgroups search while
+ * the group data had the given generation, into the timestamp cache entry
+ * of the user */
+static errno_t sysdb_initgr_closure_set(struct sss_domain_info *domain,
+                                        struct ldb_dn *user_dn,
+                                        const char *generation,
+                                        size_t count,
+                                        struct ldb_message **groups)
+{
+    struct sysdb_ctx *sysdb = domain->sysdb;
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_message **sorted;
+    struct ldb_message *msg;
+    struct ldb_val val;
+    uint8_t *buf;
+    size_t len;
+    errno_t ret;
+    int lret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    sorted = talloc_array(tmp_ctx, struct ldb_message *, count + 1);
+    if (sorted == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    if (count > 0) {
+        memcpy(sorted, groups, count * sizeof(struct ldb_message *));
+        qsort(sorted, count, sizeof(struct ldb_message *),
+              sysdb_initgr_closure_cmp);
+    }
+    sorted[count] = NULL;
+
+    ret = sysdb_reader_pack_reply(tmp_ctx, SYSDB_INITGR_CLOSURE_VERSION, EOK,
+                                  count, sorted, &buf, &len);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    msg = ldb_msg_new(tmp_ctx);
+    if (msg == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    msg->dn = user_dn;
+
+    val.data = buf;
+    val.length = len;
+
+    lret = ldb_msg_add_empty(msg, SYSDB_INITGR_CLOSURE, LDB_FLAG_MOD_REPLACE,
+                             NULL);
+    if (lret == LDB_SUCCESS) {
+        lret = ldb_msg_add_value(msg, SYSDB_INITGR_CLOSURE, &val, NULL);
+    }
+    if (lret == LDB_SUCCESS) {
+        lret = ldb_msg_add_empty(msg, SYSDB_INITGR_CLOSURE_GEN,
+                                 LDB_FLAG_MOD_REPLACE, NULL);
+    }
+    if (lret == LDB_SUCCESS) {
+        lret = ldb_msg_add_string(msg, SYSDB_INITGR_CLOSURE_GEN, generation);
+    }
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    lret = ldb_modify(sysdb->ldb_ts, msg);
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Stored closure index of [%s] with %zu groups\n",
+          ldb_dn_get_linearized(user_dn), count);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t sysdb_initgr_closure_update(struct sss_domain_info *domain,
+                                    const char *name)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_result *res;
+    struct ldb_dn *user_dn;
+    const char *generation;
+    errno_t ret;
+
+    if (!sysdb_initgr_closure_enabled(domain)) {
+        return EOK;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_getpwnam(tmp_ctx, domain, name, &res);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (res->count == 0) {
+        /* the user was removed from the cache */
+        ret = EOK;
+        goto done;
+    } else if (res->count != 1) {
+        ret = EIO;
+        goto done;
+    }
+
+    user_dn = res->msgs[0]->dn;
+
+    /* The backend is the only writer of the cache, so the groups do not
+     * change between reading the generation and the groups */
+    ret = sysdb_group_generation(tmp_ctx, domain->sysdb, &generation);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_initgroups_asq(domain, res);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_initgr_closure_set(domain, user_dn, generation, res->count - 1,
+                                   res->msgs + 1);
+
+done:
+    if (ret != EOK) {
+        DEBUG(ret == ENOENT ? SSSDBG_TRACE_FUNC : SSSDBG_MINOR_FAILURE,
+              "Cannot store the closure index of [%s] [%d]: %s\n",
+              name, ret, sss_strerror(ret));
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
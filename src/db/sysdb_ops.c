@@ -29,6 +29,7 @@
 #include "db/sysdb_ipnetworks.h"
 #include "util/crypto/sss_crypto.h"
 #include "util/cert.h"
+#include "util/sss_ptr_hash.h"
 #include <time.h>
 
 #define SSS_SYSDB_NO_CACHE 0x0
@@ -160,6 +161,8 @@ static int sysdb_delete_ts_entry(struct sysdb_ctx *sysdb,
         return EOK;
     }
 
+    sysdb_ts_buffer_drop_dn(sysdb, dn);
+
     return sysdb_delete_cache_entry(sysdb->ldb_ts, dn, true);
 }
 
@@ -343,8 +346,8 @@ int sysdb_search_ts_entry(TALLOC_CTX *mem_ctx,
         return EOK;
     }
 
-    return sysdb_cache_search_entry(mem_ctx, sysdb->ldb_ts, base_dn, scope,
-                                    filter, attrs, _msgs_count, _msgs);
+    return sysdb_ts_buffer_search(mem_ctx, sysdb, base_dn, scope, filter,
+                                  attrs, _msgs_count, _msgs);
 }
 
 /* =Search-Entry-by-SID-string============================================ */
@@ -1342,17 +1345,18 @@ static const char *get_attr_storage(int state_mask)
     return storage;
 }
 
-int sysdb_set_entry_attr(struct sysdb_ctx *sysdb,
-                         struct ldb_dn *entry_dn,
-                         struct sysdb_attrs *attrs,
-                         int mod_op)
+/* Writes attrs to the timestamp cache and, if sysdb_write is true, also to
+ * the cache itself */
+static int sysdb_set_entry_attr_int(struct sysdb_ctx *sysdb,
+                                    struct ldb_dn *entry_dn,
+                                    struct sysdb_attrs *attrs,
+                                    int mod_op,
+                                    bool sysdb_write)
 {
-    bool sysdb_write = true;
     errno_t ret = EOK;
     errno_t tret = EOK;
     int state_mask = SSS_SYSDB_NO_CACHE;
 
-    sysdb_write = sysdb_entry_attrs_diff(sysdb, entry_dn, attrs, mod_op);
     if (sysdb_write == true) {
         ret = sysdb_set_cache_entry_attr(sysdb->ldb, entry_dn, attrs, mod_op);
         if (ret != EOK) {
@@ -1393,6 +1397,19 @@ int sysdb_set_entry_attr(struct sysdb_ctx *sysdb,
     return ret;
 }
 
+int sysdb_set_entry_attr(struct sysdb_ctx *sysdb,
+                         struct ldb_dn *entry_dn,
+                         struct sysdb_attrs *attrs,
+                         int mod_op)
+{
+    bool sysdb_write;
+
+    sysdb_write = sysdb_entry_attrs_diff(sysdb, entry_dn, attrs, mod_op);
+
+    return sysdb_set_entry_attr_int(sysdb, entry_dn, attrs, mod_op,
+                                    sysdb_write);
+}
+
 static int sysdb_rep_ts_entry_attr(struct sysdb_ctx *sysdb,
                                    struct ldb_dn *entry_dn,
                                    struct sysdb_attrs *attrs)
@@ -1431,9 +1448,14 @@ static int sysdb_set_ts_entry_attr(struct sysdb_ctx *sysdb,
 
     switch (mod_op) {
     case SYSDB_MOD_REP:
+        if (sysdb_ts_buffer_enabled(sysdb)) {
+            ret = sysdb_ts_buffer_add(sysdb, entry_dn, ts_attrs);
+            break;
+        }
         ret = sysdb_rep_ts_entry_attr(sysdb, entry_dn, ts_attrs);
         break;
     case SYSDB_MOD_ADD:
+        sysdb_ts_buffer_flush_dn(sysdb, entry_dn);
         ret = sysdb_create_ts_entry(sysdb, entry_dn, ts_attrs);
         break;
     default:
@@ -2713,18 +2735,16 @@ static errno_t sysdb_store_new_user(struct sss_domain_info *domain,
     return EOK;
 }
 
-static errno_t sysdb_store_user_attrs(struct sss_domain_info *domain,
-                                      const char *name,
-                                      uid_t uid,
-                                      gid_t gid,
-                                      const char *gecos,
-                                      const char *homedir,
-                                      const char *shell,
-                                      const char *orig_dn,
-                                      struct sysdb_attrs *attrs,
-                                      char **remove_attrs,
-                                      uint64_t cache_timeout,
-                                      time_t now)
+/* Adds the basic attributes and the timestamps to attrs */
+static errno_t sysdb_store_user_attrs_prepare(struct sss_domain_info *domain,
+                                              uid_t uid,
+                                              gid_t gid,
+                                              const char *gecos,
+                                              const char *homedir,
+                                              const char *shell,
+                                              struct sysdb_attrs *attrs,
+                                              uint64_t cache_timeout,
+                                              time_t now)
 {
     errno_t ret;
 
@@ -2766,6 +2786,28 @@ static errno_t sysdb_store_user_attrs(struct sss_domain_info *domain,
                                   (now + cache_timeout) : 0));
     if (ret) return ret;
 
+    return EOK;
+}
+
+static errno_t sysdb_store_user_attrs(struct sss_domain_info *domain,
+                                      const char *name,
+                                      uid_t uid,
+                                      gid_t gid,
+                                      const char *gecos,
+                                      const char *homedir,
+                                      const char *shell,
+                                      const char *orig_dn,
+                                      struct sysdb_attrs *attrs,
+                                      char **remove_attrs,
+                                      uint64_t cache_timeout,
+                                      time_t now)
+{
+    errno_t ret;
+
+    ret = sysdb_store_user_attrs_prepare(domain, uid, gid, gecos, homedir,
+                                         shell, attrs, cache_timeout, now);
+    if (ret) return ret;
+
     ret = sysdb_set_user_attr(domain, name, attrs, SYSDB_MOD_REP);
     if (ret) return ret;
 
@@ -2960,16 +3002,14 @@ static errno_t sysdb_store_new_group(struct sss_domain_info *domain,
     return EOK;
 }
 
-static errno_t sysdb_store_group_attrs(struct sss_domain_info *domain,
-                                       const char *name,
-                                       gid_t gid,
-                                       struct sysdb_attrs *attrs,
-                                       uint64_t cache_timeout,
-                                       time_t now)
+/* Adds the GID and the timestamps to attrs */
+static errno_t sysdb_store_group_attrs_prepare(gid_t gid,
+                                               struct sysdb_attrs *attrs,
+                                               uint64_t cache_timeout,
+                                               time_t now)
 {
     errno_t ret;
 
-    /* the group exists, let's just replace attributes when set */
     if (gid) {
         ret = sysdb_attrs_add_uint32(attrs, SYSDB_GIDNUM, gid);
         if (ret) {
@@ -2992,6 +3032,24 @@ static errno_t sysdb_store_group_attrs(struct sss_domain_info *domain,
         return ret;
     }
 
+    return EOK;
+}
+
+static errno_t sysdb_store_group_attrs(struct sss_domain_info *domain,
+                                       const char *name,
+                                       gid_t gid,
+                                       struct sysdb_attrs *attrs,
+                                       uint64_t cache_timeout,
+                                       time_t now)
+{
+    errno_t ret;
+
+    /* the group exists, let's just replace attributes when set */
+    ret = sysdb_store_group_attrs_prepare(gid, attrs, cache_timeout, now);
+    if (ret) {
+        return ret;
+    }
+
     ret = sysdb_set_group_attr(domain, name, attrs, SYSDB_MOD_REP);
     if (ret) {
         DEBUG(SSSDBG_TRACE_LIBS, "sysdb_set_group_attr failed.\n");
@@ -3001,6 +3059,463 @@ static errno_t sysdb_store_group_attrs(struct sss_domain_info *domain,
     return EOK;
 }
 
+/* =Store-Many-Users-And-Groups=========================================== */
+
+/* Names looked up by one search when prefetching the stored objects */
+#define SYSDB_STORE_PREFETCH_MAX 128
+
+struct sysdb_store_found {
+    struct ldb_message *msg;
+    /* More entries match the name, leave it to sysdb_store_user/group() */
+    bool ambiguous;
+};
+
+static errno_t sysdb_store_index_name(hash_table_t *table,
+                                      const char *name,
+                                      struct ldb_message *msg)
+{
+    struct sysdb_store_found *found;
+    errno_t ret;
+
+    found = sss_ptr_hash_lookup(table, name, struct sysdb_store_found);
+    if (found != NULL) {
+        if (found->msg != msg) {
+            found->ambiguous = true;
+        }
+        return EOK;
+    }
+
+    found = talloc_zero(table, struct sysdb_store_found);
+    if (found == NULL) {
+        return ENOMEM;
+    }
+    found->msg = msg;
+
+    ret = sss_ptr_hash_add(table, name, found, struct sysdb_store_found);
+    if (ret != EOK) {
+        talloc_free(found);
+        return ret;
+    }
+
+    return EOK;
+}
+
+static errno_t sysdb_store_index_msg(hash_table_t *table,
+                                     struct ldb_message *msg)
+{
+    struct ldb_message_element *el;
+    const char *name;
+    unsigned int i;
+    errno_t ret;
+
+    name = ldb_msg_find_attr_as_string(msg, SYSDB_NAME, NULL);
+    if (name == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Entry [%s] without a name?\n",
+              ldb_dn_get_linearized(msg->dn));
+        return EOK;
+    }
+
+    ret = sysdb_store_index_name(table, name, msg);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    el = ldb_msg_find_element(msg, SYSDB_NAME_ALIAS);
+    if (el == NULL) {
+        return EOK;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        ret = sysdb_store_index_name(table,
+                                     (const char *)el->values[i].data, msg);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+/* Reads the cached entries of the objects of the given type with one search
+ * per SYSDB_STORE_PREFETCH_MAX objects and indexes them by their names and
+ * aliases, the same values sysdb_search_by_name() matches */
+static errno_t sysdb_store_prefetch(TALLOC_CTX *mem_ctx,
+                                    struct sss_domain_info *domain,
+                                    enum sysdb_obj_type type,
+                                    struct sysdb_store_obj *objs,
+                                    size_t num_objs,
+                                    hash_table_t *table)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_dn *base_dn;
+    struct ldb_result *res;
+    const char *oc;
+    char *sanitized_name;
+    char *lc_sanitized_name;
+    char *filter;
+    size_t num_names;
+    size_t i;
+    size_t c;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    if (type == SYSDB_USER) {
+        oc = SYSDB_UC;
+        base_dn = sysdb_user_base_dn(tmp_ctx, domain);
+    } else {
+        oc = SYSDB_GC;
+        base_dn = sysdb_group_base_dn(tmp_ctx, domain);
+    }
+    if (base_dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    i = 0;
+    while (i < num_objs) {
+        filter = talloc_asprintf(tmp_ctx, "(&(%s)(|", oc);
+        if (filter == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        for (num_names = 0;
+             i < num_objs && num_names < SYSDB_STORE_PREFETCH_MAX;
+             i++) {
+            if (objs[i].type != type) {
+                continue;
+            }
+
+            ret = sss_filter_sanitize_for_dom(filter, objs[i].name, domain,
+                                              &sanitized_name,
+                                              &lc_sanitized_name);
+            if (ret != EOK) {
+                goto done;
+            }
+
+            filter = talloc_asprintf_append(filter, "(%s=%s)(%s=%s)(%s=%s)",
+                                            SYSDB_NAME_ALIAS, lc_sanitized_name,
+                                            SYSDB_NAME_ALIAS, sanitized_name,
+                                            SYSDB_NAME, sanitized_name);
+            if (filter == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+            num_names++;
+        }
+
+        if (num_names == 0) {
+            break;
+        }
+
+        filter = talloc_asprintf_append(filter, "))");
+        if (filter == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = ldb_search(domain->sysdb->ldb, mem_ctx, &res, base_dn,
+                         LDB_SCOPE_SUBTREE, NULL, "%s", filter);
+        if (ret != LDB_SUCCESS) {
+            ret = sysdb_error_to_errno(ret);
+            goto done;
+        }
+
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Prefetched %u of %zu objects\n",
+              res->count, num_names);
+
+        for (c = 0; c < res->count; c++) {
+            ret = sysdb_store_index_msg(table, res->msgs[c]);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+
+        talloc_free(filter);
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static struct ldb_message *
+sysdb_store_find(TALLOC_CTX *mem_ctx,
+                 struct sss_domain_info *domain,
+                 hash_table_t *table,
+                 const char *name)
+{
+    struct sysdb_store_found *found;
+    char *lc_name;
+
+    found = sss_ptr_hash_lookup(table, name, struct sysdb_store_found);
+    if (found == NULL && domain->case_sensitive == false) {
+        lc_name = sss_tc_utf8_str_tolower(mem_ctx, name);
+        if (lc_name == NULL) {
+            return NULL;
+        }
+
+        found = sss_ptr_hash_lookup(table, lc_name, struct sysdb_store_found);
+        talloc_free(lc_name);
+    }
+
+    if (found == NULL || found->ambiguous) {
+        return NULL;
+    }
+
+    return found->msg;
+}
+
+/* Updates the cached entry msg, read by sysdb_store_prefetch() */
+static errno_t sysdb_store_cached_obj(TALLOC_CTX *mem_ctx,
+                                      struct sss_domain_info *domain,
+                                      struct sysdb_store_obj *obj,
+                                      struct ldb_message *msg,
+                                      uint64_t cache_timeout,
+                                      time_t now)
+{
+    const char *name;
+    bool sysdb_write;
+    errno_t ret;
+
+    if (obj->type == SYSDB_GROUP) {
+        /* Same as sysdb_store_group() */
+        ret = sysdb_check_and_update_ts_cache(domain, msg->dn, obj->attrs,
+                                              cache_timeout, now);
+        if (ret == EOK) {
+            DEBUG(SSSDBG_TRACE_LIBS,
+                  "The group record of %s did not change, only updated "
+                  "the timestamp cache\n", obj->name);
+            return EOK;
+        }
+    }
+
+    if (obj->attrs == NULL) {
+        obj->attrs = sysdb_new_attrs(mem_ctx);
+        if (obj->attrs == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    if (obj->type == SYSDB_GROUP) {
+        ret = sysdb_store_group_attrs_prepare(obj->gid, obj->attrs,
+                                              cache_timeout, now);
+    } else {
+        if (obj->pwd != NULL && *obj->pwd == '\0') {
+            ret = sysdb_attrs_add_string(obj->attrs, SYSDB_PWD, obj->pwd);
+            if (ret != EOK) {
+                return ret;
+            }
+        }
+
+        ret = sysdb_store_user_attrs_prepare(domain, obj->uid, obj->gid,
+                                             obj->gecos, obj->homedir,
+                                             obj->shell, obj->attrs,
+                                             cache_timeout, now);
+    }
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sysdb_write = sysdb_entry_attrs_diff_msg(domain->sysdb, msg, obj->attrs,
+                                             SYSDB_MOD_REP);
+
+    ret = sysdb_set_entry_attr_int(domain->sysdb, msg->dn, obj->attrs,
+                                   SYSDB_MOD_REP, sysdb_write);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (obj->type == SYSDB_USER && obj->remove_attrs != NULL) {
+        name = ldb_msg_find_attr_as_string(msg, SYSDB_NAME, obj->name);
+        ret = sysdb_remove_attrs(domain, name, SYSDB_MEMBER_USER,
+                                 obj->remove_attrs);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CONF_SETTINGS,
+                  "Could not remove missing attributes\n");
+        }
+    }
+
+    return EOK;
+}
+
+/* Objects without a cached entry and renames take the usual path */
+static errno_t sysdb_store_new_obj(struct sss_domain_info *domain,
+                                   struct sysdb_store_obj *obj,
+                                   uint64_t cache_timeout,
+                                   time_t now)
+{
+    if (obj->type == SYSDB_GROUP) {
+        return sysdb_store_group(domain, obj->name, obj->gid, obj->attrs,
+                                 cache_timeout, now);
+    }
+
+    return sysdb_store_user(domain, obj->name, obj->pwd, obj->uid, obj->gid,
+                            obj->gecos, obj->homedir, obj->shell,
+                            obj->orig_dn, obj->attrs, obj->remove_attrs,
+                            cache_timeout, now);
+}
+
+errno_t sysdb_store_objects(struct sss_domain_info *domain,
+                            struct sysdb_store_obj *objs,
+                            size_t num_objs,
+                            uint64_t cache_timeout,
+                            time_t now)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_context *ldb_ts = domain->sysdb->ldb_ts;
+    hash_table_t *users;
+    hash_table_t *groups;
+    struct ldb_message **msgs;
+    bool in_transaction = false;
+    bool in_ts_transaction = false;
+    size_t stored = 0;
+    size_t i;
+    errno_t ret;
+    errno_t sret;
+
+    if (num_objs == 0) {
+        return EOK;
+    }
+
+    for (i = 0; i < num_objs; i++) {
+        if (objs[i].name == NULL
+                || (objs[i].type != SYSDB_USER
+                    && objs[i].type != SYSDB_GROUP)) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Invalid object %zu\n", i);
+            return EINVAL;
+        }
+    }
+
+    /* get transaction timestamp */
+    if (now == 0) {
+        now = time(NULL);
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    users = sss_ptr_hash_create(tmp_ctx, NULL, NULL);
+    groups = sss_ptr_hash_create(tmp_ctx, NULL, NULL);
+    if (users == NULL || groups == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sysdb_transaction_start(domain->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
+        goto done;
+    }
+    in_transaction = true;
+
+    /* Group the writes to the timestamp cache as well. It is not synced to
+     * disk, but every write outside of a transaction still locks the file
+     * and updates its sequence number */
+    if (ldb_ts != NULL) {
+        ret = ldb_transaction_start(ldb_ts);
+        if (ret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Failed to start timestamp cache transaction\n");
+        } else {
+            in_ts_transaction = true;
+        }
+    }
+
+    ret = sysdb_store_prefetch(tmp_ctx, domain, SYSDB_USER, objs, num_objs,
+                               users);
+    if (ret == EOK) {
+        ret = sysdb_store_prefetch(tmp_ctx, domain, SYSDB_GROUP, objs,
+                                   num_objs, groups);
+    }
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read the cached objects "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /* Update the cached entries first, storing a new object may remove
+     * an entry with the same ID and the prefetched one would be stale */
+    msgs = talloc_zero_array(tmp_ctx, struct ldb_message *, num_objs);
+    if (msgs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_objs; i++) {
+        msgs[i] = sysdb_store_find(tmp_ctx, domain,
+                                   objs[i].type == SYSDB_USER ? users : groups,
+                                   objs[i].name);
+        if (msgs[i] == NULL) {
+            continue;
+        }
+
+        objs[i].ret = sysdb_store_cached_obj(tmp_ctx, domain, &objs[i],
+                                             msgs[i], cache_timeout, now);
+    }
+
+    for (i = 0; i < num_objs; i++) {
+        if (msgs[i] == NULL) {
+            objs[i].ret = sysdb_store_new_obj(domain, &objs[i],
+                                              cache_timeout, now);
+        }
+
+        if (objs[i].ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to store %s [%d]: %s\n",
+                  objs[i].name, objs[i].ret, sss_strerror(objs[i].ret));
+            continue;
+        }
+        stored++;
+    }
+
+    ret = sysdb_transaction_commit(domain->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+        goto done;
+    }
+    in_transaction = false;
+
+    if (in_ts_transaction) {
+        ret = ldb_transaction_commit(ldb_ts);
+        in_ts_transaction = false;
+        if (ret != LDB_SUCCESS) {
+            /* Not fatal, the timestamps are refreshed by the next update */
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Failed to commit timestamp cache transaction\n");
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Stored %zu of %zu objects\n", stored, num_objs);
+    ret = EOK;
+
+done:
+    if (in_ts_transaction) {
+        sret = ldb_transaction_cancel(ldb_ts);
+        if (sret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Could not cancel timestamp cache transaction\n");
+        }
+    }
+
+    if (in_transaction) {
+        sret = sysdb_transaction_cancel(domain->sysdb);
+        if (sret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not cancel transaction\n");
+        }
+    }
+
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 /* =Add-User-to-Group(Native/Legacy)====================================== */
 static int
 sysdb_group_membership_mod(struct sss_domain_info *domain,
@@ -3701,9 +4216,16 @@ static int sysdb_cache_search_users(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "Search users with filter: %s\n", filter);
 
-    ret = sysdb_cache_search_entry(mem_ctx, ldb, basedn,
-                                   LDB_SCOPE_SUBTREE, filter, attrs,
-                                   msgs_count, msgs);
+    if (ldb == domain->sysdb->ldb_ts) {
+        /* includes the pending timestamp updates */
+        ret = sysdb_ts_buffer_search(mem_ctx, domain->sysdb, basedn,
+                                     LDB_SCOPE_SUBTREE, filter, attrs,
+                                     msgs_count, msgs);
+    } else {
+        ret = sysdb_cache_search_entry(mem_ctx, ldb, basedn,
+                                       LDB_SCOPE_SUBTREE, filter, attrs,
+                                       msgs_count, msgs);
+    }
     if (ret) {
         goto fail;
     }
@@ -4065,9 +4587,16 @@ static int sysdb_cache_search_groups(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "Search groups with filter: %s\n", filter);
 
-    ret = sysdb_cache_search_entry(mem_ctx, ldb, basedn,
-                                   LDB_SCOPE_SUBTREE, filter, attrs,
-                                   msgs_count, msgs);
+    if (ldb == domain->sysdb->ldb_ts) {
+        /* includes the pending timestamp updates */
+        ret = sysdb_ts_buffer_search(mem_ctx, domain->sysdb, basedn,
+                                     LDB_SCOPE_SUBTREE, filter, attrs,
+                                     msgs_count, msgs);
+    } else {
+        ret = sysdb_cache_search_entry(mem_ctx, ldb, basedn,
+                                       LDB_SCOPE_SUBTREE, filter, attrs,
+                                       msgs_count, msgs);
+    }
     if (ret) {
         goto fail;
     }
@@ -5605,6 +6134,7 @@ errno_t sysdb_mark_entry_as_expired_ldb_dn(struct sss_domain_info *dom,
     }
 
     if (dom->sysdb->ldb_ts != NULL) {
+        sysdb_ts_buffer_flush_dn(dom->sysdb, msg->dn);
         ret = ldb_modify(dom->sysdb->ldb_ts, msg);
         if (ret != LDB_SUCCESS) {
             DEBUG(SSSDBG_MINOR_FAILURE,
@@ -5700,6 +6230,7 @@ int sysdb_invalidate_cache_entry(struct sss_domain_info *domain,
     }
 
     if (sysdb->ldb_ts != NULL) {
+        sysdb_ts_buffer_flush_dn(sysdb, entry_dn);
         ret = sysdb_set_cache_entry_attr(sysdb->ldb_ts, entry_dn,
                                          attrs, SYSDB_MOD_REP);
         if (ret != EOK) {
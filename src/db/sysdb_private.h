@@ -135,6 +135,12 @@ struct sysdb_ctx {
     char *ldb_ts_file;
 
     int transaction_nesting;
+
+    /* Reader children the searches can be sent to, see sysdb_async.c */
+    struct sysdb_readers *readers;
+
+    /* Pending timestamp cache updates, see sysdb_ts_buffer.c */
+    struct sysdb_ts_buffer *ts_buffer;
 };
 
 /* Internal utility functions */
@@ -320,4 +326,86 @@ bool sysdb_entry_attrs_diff(struct sysdb_ctx *sysdb,
                             struct sysdb_attrs *attrs,
                             int mod_op);
 
+/* Same as sysdb_entry_attrs_diff() but compares with db_msg, an entry the
+ * caller has already read from the cache, instead of searching for it.
+ */
+bool sysdb_entry_attrs_diff_msg(struct sysdb_ctx *sysdb,
+                                struct ldb_message *db_msg,
+                                struct sysdb_attrs *attrs,
+                                int mod_op);
+
+/* The timestamp cache write buffer, see sysdb_ts_buffer.c */
+bool sysdb_ts_buffer_enabled(struct sysdb_ctx *sysdb);
+
+/* Queues a replace of attrs on the timestamp entry of entry_dn */
+errno_t sysdb_ts_buffer_add(struct sysdb_ctx *sysdb,
+                            struct ldb_dn *entry_dn,
+                            struct sysdb_attrs *attrs);
+
+/* Writes the pending update of entry_dn, if any, before a direct write */
+errno_t sysdb_ts_buffer_flush_dn(struct sysdb_ctx *sysdb,
+                                 struct ldb_dn *entry_dn);
+
+/* Moves the updates staged inside the outermost sysdb transaction into the
+ * buffer when it commits, or drops them when it is cancelled */
+void sysdb_ts_buffer_commit(struct sysdb_ctx *sysdb);
+void sysdb_ts_buffer_cancel(struct sysdb_ctx *sysdb);
+
+/* Forgets the pending update of entry_dn, if any, when it is deleted */
+void sysdb_ts_buffer_drop_dn(struct sysdb_ctx *sysdb,
+                             struct ldb_dn *entry_dn);
+
+/* Applies the pending update of ts_msg->dn to a timestamp entry that was
+ * read from the timestamp cache */
+errno_t sysdb_ts_buffer_merge(struct sysdb_ctx *sysdb,
+                              struct ldb_message *ts_msg);
+
+/* Searches the timestamp cache like sysdb_cache_search_entry(). The result
+ * includes the pending updates, also when they change which entries the
+ * filter matches, without writing them. */
+errno_t sysdb_ts_buffer_search(TALLOC_CTX *mem_ctx,
+                               struct sysdb_ctx *sysdb,
+                               struct ldb_dn *base_dn,
+                               enum ldb_scope scope,
+                               const char *filter,
+                               const char **attrs,
+                               size_t *_msgs_count,
+                               struct ldb_message ***_msgs);
+
+/* The initgroups closure index, see sysdb_initgr_closure.c */
+bool sysdb_initgr_closure_enabled(struct sss_domain_info *domain);
+
+/* Returns ENOENT unless user_dn has an index that was built from its
+ * current group memberships. Never writes to the cache.
+ */
+errno_t sysdb_initgr_closure_get(TALLOC_CTX *mem_ctx,
+                                 struct sss_domain_info *domain,
+                                 struct ldb_dn *user_dn,
+                                 size_t *_count,
+                                 struct ldb_message ***_msgs);
+
+/* Appends the groups the user in res->msgs[0] is a member of to res with
+ * an ASQ search over the memberOf attribute */
+errno_t sysdb_initgroups_asq(struct sss_domain_info *domain,
+                             struct ldb_result *res);
+
+/* The on-disk format of the cache, see sysdb_format.c */
+errno_t sysdb_ldb_get_format(struct ldb_context *ldb,
+                             enum sss_cache_format *_format);
+
+/* Converts the cache to format in one transaction, _converted tells whether
+ * it was in another format. Connections opened before the conversion have to
+ * be reopened before they write to the cache.
+ */
+errno_t sysdb_ldb_set_format(struct ldb_context *ldb,
+                             enum sss_cache_format format,
+                             bool *_converted);
+
+/* Reads the format of the cache file name into format, or converts the cache
+ * to format if convert is set */
+errno_t sysdb_manage_format(TALLOC_CTX *mem_ctx,
+                            const char *name,
+                            bool convert,
+                            enum sss_cache_format *format);
+
 #endif /* __INT_SYS_DB_H__ */
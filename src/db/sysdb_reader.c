@@ -0,0 +1,474 @@
+/*
+   SSSD
+
+   System Database - protocol of the sysdb reader child
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "db/sysdb_reader.h"
+
+static size_t reader_data_len(size_t len)
+{
+    return sizeof(uint32_t) + len;
+}
+
+static size_t reader_string_len(const char *str)
+{
+    return reader_data_len(str == NULL ? 0 : strlen(str));
+}
+
+static void reader_put_data(uint8_t *buf, size_t *_c,
+                            const void *data, size_t len)
+{
+    SAFEALIGN_SETMEM_UINT32(&buf[*_c], len, _c);
+    safealign_memcpy(&buf[*_c], data, len, _c);
+}
+
+static void reader_put_string(uint8_t *buf, size_t *_c, const char *str)
+{
+    if (str == NULL) {
+        SAFEALIGN_SETMEM_UINT32(&buf[*_c], SYSDB_READER_NULL, _c);
+        return;
+    }
+
+    reader_put_data(buf, _c, str, strlen(str));
+}
+
+static errno_t reader_get_data(uint8_t *body, size_t len, size_t *_c,
+                               uint8_t **_data, uint32_t *_data_len)
+{
+    uint32_t data_len;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&data_len, &body[*_c], len, _c);
+    if (data_len == SYSDB_READER_NULL) {
+        *_data = NULL;
+        *_data_len = 0;
+        return EOK;
+    }
+
+    if (data_len > len - *_c) {
+        return EINVAL;
+    }
+
+    *_data = &body[*_c];
+    *_data_len = data_len;
+    *_c += data_len;
+
+    return EOK;
+}
+
+static errno_t reader_get_string(TALLOC_CTX *mem_ctx,
+                                 uint8_t *body, size_t len, size_t *_c,
+                                 const char **_str)
+{
+    uint8_t *data;
+    uint32_t data_len;
+    char *str;
+    errno_t ret;
+
+    ret = reader_get_data(body, len, _c, &data, &data_len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (data == NULL) {
+        *_str = NULL;
+        return EOK;
+    }
+
+    str = talloc_strndup(mem_ctx, (const char *)data, data_len);
+    if (str == NULL) {
+        return ENOMEM;
+    }
+
+    *_str = str;
+    return EOK;
+}
+
+errno_t sysdb_reader_pack_request(TALLOC_CTX *mem_ctx,
+                                  struct sysdb_reader_request *request,
+                                  uint8_t **_buf,
+                                  size_t *_len)
+{
+    uint32_t num_attrs = SYSDB_READER_NULL;
+    uint8_t *buf;
+    size_t len;
+    size_t c = 0;
+    size_t i;
+
+    len = 4 * sizeof(uint32_t)
+            + reader_string_len(request->ldb_file)
+            + reader_string_len(request->ts_file)
+            + reader_string_len(request->base_dn)
+            + reader_string_len(request->filter);
+
+    if (request->attrs != NULL) {
+        for (i = 0; request->attrs[i] != NULL; i++) {
+            len += reader_string_len(request->attrs[i]);
+        }
+        num_attrs = i;
+    }
+
+    if (len > SYSDB_READER_MAX_FRAME) {
+        return EINVAL;
+    }
+
+    buf = talloc_size(mem_ctx, len);
+    if (buf == NULL) {
+        return ENOMEM;
+    }
+
+    SAFEALIGN_SETMEM_UINT32(&buf[c], len - sizeof(uint32_t), &c);
+    SAFEALIGN_SETMEM_UINT32(&buf[c], request->id, &c);
+    SAFEALIGN_SETMEM_UINT32(&buf[c], request->scope, &c);
+    reader_put_string(buf, &c, request->ldb_file);
+    reader_put_string(buf, &c, request->ts_file);
+    reader_put_string(buf, &c, request->base_dn);
+    reader_put_string(buf, &c, request->filter);
+    SAFEALIGN_SETMEM_UINT32(&buf[c], num_attrs, &c);
+    if (request->attrs != NULL) {
+        for (i = 0; request->attrs[i] != NULL; i++) {
+            reader_put_string(buf, &c, request->attrs[i]);
+        }
+    }
+
+    *_buf = buf;
+    *_len = len;
+
+    return EOK;
+}
+
+static errno_t reader_unpack_request(struct sysdb_reader_request *request,
+                                     uint8_t *body,
+                                     size_t len)
+{
+    uint32_t num_attrs;
+    uint32_t scope;
+    size_t c = 0;
+    size_t i;
+    errno_t ret;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&request->id, &body[c], len, &c);
+    SAFEALIGN_COPY_UINT32_CHECK(&scope, &body[c], len, &c);
+    request->scope = scope;
+
+    ret = reader_get_string(request, body, len, &c, &request->ldb_file);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = reader_get_string(request, body, len, &c, &request->ts_file);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = reader_get_string(request, body, len, &c, &request->base_dn);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = reader_get_string(request, body, len, &c, &request->filter);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    SAFEALIGN_COPY_UINT32_CHECK(&num_attrs, &body[c], len, &c);
+    if (num_attrs == SYSDB_READER_NULL) {
+        request->attrs = NULL;
+    } else {
+        /* Each attribute takes at least its length field */
+        if (num_attrs > (len - c) / sizeof(uint32_t)) {
+            return EINVAL;
+        }
+
+        request->attrs = talloc_zero_array(request, const char *,
+                                           num_attrs + 1);
+        if (request->attrs == NULL) {
+            return ENOMEM;
+        }
+
+        for (i = 0; i < num_attrs; i++) {
+            ret = reader_get_string(request->attrs, body, len, &c,
+                                    &request->attrs[i]);
+            if (ret != EOK) {
+                return ret;
+            }
+
+            if (request->attrs[i] == NULL) {
+                return EINVAL;
+            }
+        }
+    }
+
+    if (request->ldb_file == NULL || request->base_dn == NULL) {
+        return EINVAL;
+    }
+
+    return EOK;
+}
+
+errno_t sysdb_reader_unpack_request(TALLOC_CTX *mem_ctx,
+                                    uint8_t *body,
+                                    size_t len,
+                                    struct sysdb_reader_request **_request)
+{
+    struct sysdb_reader_request *request;
+    errno_t ret;
+
+    request = talloc_zero(mem_ctx, struct sysdb_reader_request);
+    if (request == NULL) {
+        return ENOMEM;
+    }
+
+    ret = reader_unpack_request(request, body, len);
+    if (ret != EOK) {
+        talloc_free(request);
+        return ret;
+    }
+
+    *_request = request;
+    return EOK;
+}
+
+errno_t sysdb_reader_pack_reply(TALLOC_CTX *mem_ctx,
+                                uint32_t id,
+                                errno_t error,
+                                size_t msgs_count,
+                                struct ldb_message **msgs,
+                                uint8_t **_buf,
+                                size_t *_len)
+{
+    struct ldb_message_element *el;
+    const char *dn;
+    uint8_t *buf;
+    size_t len;
+    size_t c = 0;
+    size_t i, j, k;
+
+    len = 4 * sizeof(uint32_t);
+    for (i = 0; i < msgs_count; i++) {
+        dn = ldb_dn_get_linearized(msgs[i]->dn);
+        if (dn == NULL) {
+            return EINVAL;
+        }
+
+        len += reader_string_len(dn) + sizeof(uint32_t);
+        for (j = 0; j < msgs[i]->num_elements; j++) {
+            el = &msgs[i]->elements[j];
+            len += reader_string_len(el->name) + sizeof(uint32_t);
+            for (k = 0; k < el->num_values; k++) {
+                if (el->values[k].length >= SYSDB_READER_NULL) {
+                    return EINVAL;
+                }
+                len += reader_data_len(el->values[k].length);
+            }
+        }
+
+        if (len > SYSDB_READER_MAX_FRAME) {
+            return E2BIG;
+        }
+    }
+
+    buf = talloc_size(mem_ctx, len);
+    if (buf == NULL) {
+        return ENOMEM;
+    }
+
+    SAFEALIGN_SETMEM_UINT32(&buf[c], len - sizeof(uint32_t), &c);
+    SAFEALIGN_SETMEM_UINT32(&buf[c], id, &c);
+    SAFEALIGN_SETMEM_UINT32(&buf[c], error, &c);
+    SAFEALIGN_SETMEM_UINT32(&buf[c], msgs_count, &c);
+    for (i = 0; i < msgs_count; i++) {
+        reader_put_string(buf, &c, ldb_dn_get_linearized(msgs[i]->dn));
+        SAFEALIGN_SETMEM_UINT32(&buf[c], msgs[i]->num_elements, &c);
+        for (j = 0; j < msgs[i]->num_elements; j++) {
+            el = &msgs[i]->elements[j];
+            reader_put_string(buf, &c, el->name);
+            SAFEALIGN_SETMEM_UINT32(&buf[c], el->num_values, &c);
+            for (k = 0; k < el->num_values; k++) {
+                reader_put_data(buf, &c, el->values[k].data,
+                                el->values[k].length);
+            }
+        }
+    }
+
+    *_buf = buf;
+    *_len = len;
+
+    return EOK;
+}
+
+errno_t sysdb_reader_unpack_reply_header(uint8_t *body,
+                                         size_t len,
+                                         uint32_t *_id,
+                                         errno_t *_error)
+{
+    uint32_t error;
+    size_t c = 0;
+
+    SAFEALIGN_COPY_UINT32_CHECK(_id, &body[c], len, &c);
+    SAFEALIGN_COPY_UINT32_CHECK(&error, &body[c], len, &c);
+    *_error = error;
+
+    return EOK;
+}
+
+static errno_t reader_unpack_element(struct ldb_message *msg,
+                                     uint8_t *body,
+                                     size_t len,
+                                     size_t *_c)
+{
+    struct ldb_message_element *el;
+    const char *name;
+    uint32_t num_values;
+    uint8_t *data;
+    uint32_t data_len;
+    uint32_t i;
+    errno_t ret;
+
+    ret = reader_get_string(msg, body, len, _c, &name);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (name == NULL) {
+        return EINVAL;
+    }
+
+    SAFEALIGN_COPY_UINT32_CHECK(&num_values, &body[*_c], len, _c);
+    if (num_values > (len - *_c) / sizeof(uint32_t)) {
+        return EINVAL;
+    }
+
+    ret = ldb_msg_add_empty(msg, name, 0, &el);
+    if (ret != LDB_SUCCESS) {
+        return sss_ldb_error_to_errno(ret);
+    }
+
+    el->values = talloc_array(msg->elements, struct ldb_val, num_values);
+    if (el->values == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < num_values; i++) {
+        ret = reader_get_data(body, len, _c, &data, &data_len);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        /* ldb values are NUL terminated for the convenience of callers */
+        el->values[i].data = talloc_size(el->values, data_len + 1);
+        if (el->values[i].data == NULL) {
+            return ENOMEM;
+        }
+
+        if (data_len > 0) {
+            memcpy(el->values[i].data, data, data_len);
+        }
+        el->values[i].data[data_len] = '\0';
+        el->values[i].length = data_len;
+        el->num_values++;
+    }
+
+    return EOK;
+}
+
+errno_t sysdb_reader_unpack_reply(TALLOC_CTX *mem_ctx,
+                                  struct ldb_context *ldb,
+                                  uint8_t *body,
+                                  size_t len,
+                                  size_t *_msgs_count,
+                                  struct ldb_message ***_msgs)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_message **msgs;
+    const char *dn;
+    uint32_t msgs_count;
+    uint32_t num_elements;
+    uint32_t i, j;
+    size_t c = 2 * sizeof(uint32_t);
+    errno_t ret;
+
+    if (len < c) {
+        return EINVAL;
+    }
+
+    SAFEALIGN_COPY_UINT32_CHECK(&msgs_count, &body[c], len, &c);
+    if (msgs_count > (len - c) / (2 * sizeof(uint32_t))) {
+        return EINVAL;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    msgs = talloc_zero_array(tmp_ctx, struct ldb_message *, msgs_count + 1);
+    if (msgs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < msgs_count; i++) {
+        msgs[i] = ldb_msg_new(msgs);
+        if (msgs[i] == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = reader_get_string(tmp_ctx, body, len, &c, &dn);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        if (dn == NULL) {
+            ret = EINVAL;
+            goto done;
+        }
+
+        msgs[i]->dn = ldb_dn_new(msgs[i], ldb, dn);
+        if (msgs[i]->dn == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        if (len - c < sizeof(uint32_t)) {
+            ret = EINVAL;
+            goto done;
+        }
+        SAFEALIGN_COPY_UINT32(&num_elements, &body[c], &c);
+
+        for (j = 0; j < num_elements; j++) {
+            ret = reader_unpack_element(msgs[i], body, len, &c);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    if (c != len) {
+        ret = EINVAL;
+        goto done;
+    }
+
+    *_msgs_count = msgs_count;
+    *_msgs = talloc_steal(mem_ctx, msgs);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
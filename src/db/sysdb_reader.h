@@ -0,0 +1,92 @@
+/*
+   SSSD
+
+   System Database - protocol of the sysdb reader child
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SYSDB_READER_H_
+#define _SYSDB_READER_H_
+
+#include "util/util.h"
+#include <ldb.h>
+
+/* The sysdb reader child searches the cache on behalf of a responder.
+ * The responder writes requests to the standard input of the child and
+ * reads the replies from its standard output. The child answers the
+ * requests in the order they were written.
+ *
+ * Each frame starts with a uint32_t holding the length of the rest of
+ * the frame, followed by the uint32_t id of the request. Strings and
+ * values are sent as a uint32_t length followed by the data, a NULL
+ * string has the length SYSDB_READER_NULL.
+ *
+ * Request: scope, ldb file, timestamp cache file, base DN, filter,
+ *          number of attributes (SYSDB_READER_NULL for all), attributes
+ *
+ * Reply:   errno, number of messages, and for each message its DN, the
+ *          number of elements and for each element its name, the number
+ *          of values and the values
+ */
+
+#define SYSDB_READER_NULL UINT32_MAX
+
+/* Anything longer is a corrupted frame */
+#define SYSDB_READER_MAX_FRAME (64 * 1024 * 1024)
+
+struct sysdb_reader_request {
+    uint32_t id;
+    int scope;
+    const char *ldb_file;
+    const char *ts_file;
+    const char *base_dn;
+    const char *filter;
+    const char **attrs;
+};
+
+errno_t sysdb_reader_pack_request(TALLOC_CTX *mem_ctx,
+                                  struct sysdb_reader_request *request,
+                                  uint8_t **_buf,
+                                  size_t *_len);
+
+/* Unpacks the frame after the length field */
+errno_t sysdb_reader_unpack_request(TALLOC_CTX *mem_ctx,
+                                    uint8_t *body,
+                                    size_t len,
+                                    struct sysdb_reader_request **_request);
+
+errno_t sysdb_reader_pack_reply(TALLOC_CTX *mem_ctx,
+                                uint32_t id,
+                                errno_t error,
+                                size_t msgs_count,
+                                struct ldb_message **msgs,
+                                uint8_t **_buf,
+                                size_t *_len);
+
+/* Reads only the id and the errno of the reply */
+errno_t sysdb_reader_unpack_reply_header(uint8_t *body,
+                                         size_t len,
+                                         uint32_t *_id,
+                                         errno_t *_error);
+
+/* Unpacks the messages of the reply, the DNs are created in ldb */
+errno_t sysdb_reader_unpack_reply(TALLOC_CTX *mem_ctx,
+                                  struct ldb_context *ldb,
+                                  uint8_t *body,
+                                  size_t len,
+                                  size_t *_msgs_count,
+                                  struct ldb_message ***_msgs);
+
+#endif /* _SYSDB_READER_H_ */
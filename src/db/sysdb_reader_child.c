@@ -0,0 +1,309 @@
+/*
+   SSSD
+
+   sysdb reader child - searches the cache on behalf of a responder
+
+   The responder keeps a few of these processes around and sends them the
+   cache searches, so that a slow search or a search waiting for the lock
+   held by sssd_be does not block its event loop. Each child has its own
+   read-only ldb connection to every cache it was asked to search.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <popt.h>
+#include <sys/prctl.h>
+
+#include "util/util.h"
+#include "db/sysdb_private.h"
+#include "db/sysdb_reader.h"
+
+struct reader_db {
+    struct reader_db *prev;
+    struct reader_db *next;
+
+    const char *file;
+    struct ldb_context *ldb;
+};
+
+struct reader_ctx {
+    struct reader_db *dbs;
+};
+
+static errno_t reader_get_ldb(struct reader_ctx *rctx,
+                              const char *file,
+                              struct ldb_context **_ldb)
+{
+    struct reader_db *db;
+    errno_t ret;
+
+    for (db = rctx->dbs; db != NULL; db = db->next) {
+        if (strcmp(db->file, file) == 0) {
+            *_ldb = db->ldb;
+            return EOK;
+        }
+    }
+
+    db = talloc_zero(rctx, struct reader_db);
+    if (db == NULL) {
+        return ENOMEM;
+    }
+
+    db->file = talloc_strdup(db, file);
+    if (db->file == NULL) {
+        talloc_free(db);
+        return ENOMEM;
+    }
+
+    ret = sysdb_ldb_connect(db, file, LDB_FLG_RDONLY, &db->ldb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to open [%s] [%d]: %s\n",
+              file, ret, sss_strerror(ret));
+        talloc_free(db);
+        return ret;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Opened [%s]\n", file);
+
+    DLIST_ADD(rctx->dbs, db);
+    *_ldb = db->ldb;
+
+    return EOK;
+}
+
+static errno_t reader_search(TALLOC_CTX *mem_ctx,
+                             struct reader_ctx *rctx,
+                             struct sysdb_reader_request *request,
+                             size_t *_msgs_count,
+                             struct ldb_message ***_msgs)
+{
+    struct sysdb_ctx *sysdb;
+    struct ldb_dn *base_dn;
+    errno_t ret;
+
+    /* Just enough of a sysdb context for the search functions */
+    sysdb = talloc_zero(mem_ctx, struct sysdb_ctx);
+    if (sysdb == NULL) {
+        return ENOMEM;
+    }
+
+    ret = reader_get_ldb(rctx, request->ldb_file, &sysdb->ldb);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (request->ts_file != NULL) {
+        ret = reader_get_ldb(rctx, request->ts_file, &sysdb->ldb_ts);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    base_dn = ldb_dn_new(mem_ctx, sysdb->ldb, request->base_dn);
+    if (base_dn == NULL) {
+        return ENOMEM;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "[%u] Searching [%s] under [%s]\n",
+          request->id, request->filter, request->base_dn);
+
+    return sysdb_search_entry(mem_ctx, sysdb, base_dn, request->scope,
+                              request->filter, request->attrs,
+                              _msgs_count, _msgs);
+}
+
+static errno_t reader_loop(struct reader_ctx *rctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_reader_request *request;
+    struct ldb_message **msgs;
+    size_t msgs_count;
+    uint8_t *body;
+    uint8_t *reply;
+    size_t reply_len;
+    uint32_t len;
+    ssize_t len_read;
+    errno_t ret;
+
+    while (true) {
+        errno = 0;
+        len_read = sss_atomic_read_s(STDIN_FILENO, &len, sizeof(len));
+        if (len_read == 0) {
+            /* The responder is gone */
+            return EOK;
+        } else if (len_read != sizeof(len)) {
+            ret = errno != 0 ? errno : EIO;
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to read the request length "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+            return ret;
+        }
+
+        if (len > SYSDB_READER_MAX_FRAME) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Request too long [%u]\n", len);
+            return EINVAL;
+        }
+
+        tmp_ctx = talloc_new(rctx);
+        if (tmp_ctx == NULL) {
+            return ENOMEM;
+        }
+
+        body = talloc_size(tmp_ctx, len);
+        if (body == NULL) {
+            talloc_free(tmp_ctx);
+            return ENOMEM;
+        }
+
+        errno = 0;
+        len_read = sss_atomic_read_s(STDIN_FILENO, body, len);
+        if (len_read != len) {
+            ret = errno != 0 ? errno : EIO;
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to read the request "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+            talloc_free(tmp_ctx);
+            return ret;
+        }
+
+        /* A malformed request means the two sides lost their framing, so
+         * there is no reply this child could send */
+        ret = sysdb_reader_unpack_request(tmp_ctx, body, len, &request);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Malformed request [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            talloc_free(tmp_ctx);
+            return ret;
+        }
+
+        msgs_count = 0;
+        msgs = NULL;
+        ret = reader_search(tmp_ctx, rctx, request, &msgs_count, &msgs);
+        if (ret != EOK && ret != ENOENT) {
+            DEBUG(SSSDBG_OP_FAILURE, "[%u] Search failed [%d]: %s\n",
+                  request->id, ret, sss_strerror(ret));
+            msgs_count = 0;
+        }
+
+        ret = sysdb_reader_pack_reply(tmp_ctx, request->id, ret,
+                                      msgs_count, msgs, &reply, &reply_len);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "[%u] Unable to pack the reply "
+                  "[%d]: %s\n", request->id, ret, sss_strerror(ret));
+            /* Let the responder search the cache itself */
+            ret = sysdb_reader_pack_reply(tmp_ctx, request->id, ret, 0, NULL,
+                                          &reply, &reply_len);
+            if (ret != EOK) {
+                talloc_free(tmp_ctx);
+                return ret;
+            }
+        }
+
+        errno = 0;
+        len_read = sss_atomic_write_s(STDOUT_FILENO, reply, reply_len);
+        if (len_read != reply_len) {
+            ret = errno != 0 ? errno : EIO;
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to write the reply "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+            talloc_free(tmp_ctx);
+            return ret;
+        }
+
+        talloc_free(tmp_ctx);
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int dumpable = 1;
+    int debug_fd = -1;
+    const char *opt_logger = NULL;
+    struct reader_ctx *rctx = NULL;
+    errno_t ret;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"dumpable", 0, POPT_ARG_INT, &dumpable, 0,
+         _("Allow core dumps"), NULL },
+        {"debug-fd", 0, POPT_ARG_INT, &debug_fd, 0,
+         _("An open file descriptor for the debug logs"), NULL},
+        SSSD_LOGGER_OPTS
+        POPT_TABLEEND
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                  poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            _exit(-1);
+        }
+    }
+
+    poptFreeContext(pc);
+
+    prctl(PR_SET_DUMPABLE, (dumpable == 0) ? 0 : 1);
+
+    debug_prg_name = talloc_asprintf(NULL, "sysdb_reader_child[%d]",
+                                     getpid());
+    if (debug_prg_name == NULL) {
+        ERROR("talloc_asprintf failed.\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (debug_fd != -1) {
+        opt_logger = sss_logger_str[FILES_LOGGER];
+        ret = set_debug_file_from_fd(debug_fd);
+        if (ret != EOK) {
+            opt_logger = sss_logger_str[STDERR_LOGGER];
+            ERROR("set_debug_file_from_fd failed.\n");
+        }
+    }
+
+    DEBUG_INIT(debug_level, opt_logger);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "sysdb_reader_child started.\n");
+
+    rctx = talloc_zero(NULL, struct reader_ctx);
+    if (rctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_zero failed.\n");
+        talloc_free(discard_const(debug_prg_name));
+        ret = ENOMEM;
+        goto done;
+    }
+    talloc_steal(rctx, debug_prg_name);
+
+    ret = reader_loop(rctx);
+
+done:
+    talloc_free(rctx);
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_reader_child failed (%d)\n", ret);
+        return EXIT_FAILURE;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "sysdb_reader_child finished.\n");
+    return EXIT_SUCCESS;
+}
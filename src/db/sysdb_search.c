@@ -1655,13 +1655,10 @@ int sysdb_enumgrent_with_views(TALLOC_CTX *mem_ctx,
     return sysdb_enumgrent_filter_with_views(mem_ctx, domain, NULL, NULL, _res);
 }
 
-int sysdb_initgroups(TALLOC_CTX *mem_ctx,
-                     struct sss_domain_info *domain,
-                     const char *name,
-                     struct ldb_result **_res)
+errno_t sysdb_initgroups_asq(struct sss_domain_info *domain,
+                             struct ldb_result *res)
 {
     TALLOC_CTX *tmp_ctx;
-    struct ldb_result *res;
     struct ldb_dn *user_dn;
     struct ldb_request *req;
     struct ldb_control **ctrl;
@@ -1674,26 +1671,6 @@ int sysdb_initgroups(TALLOC_CTX *mem_ctx,
         return ENOMEM;
     }
 
-    ret = sysdb_getpwnam(tmp_ctx, domain, name, &res);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_getpwnam failed: [%d][%s]\n",
-                  ret, strerror(ret));
-        goto done;
-    }
-
-    if (res->count == 0) {
-        /* User is not cached yet */
-        *_res = talloc_steal(mem_ctx, res);
-        ret = EOK;
-        goto done;
-
-    } else if (res->count != 1) {
-        ret = EIO;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "sysdb_getpwnam returned count: [%d]\n", res->count);
-        goto done;
-    }
-
     /* no need to steal the dn, we are not freeing the result */
     user_dn = res->msgs[0]->dn;
 
@@ -1748,6 +1725,94 @@ int sysdb_initgroups(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* Appends the groups the user in res->msgs[0] is a member of to res, from
+ * the closure index if it is current and with an ASQ search otherwise. The
+ * index is only read here, the backend keeps it up to date. */
+static errno_t sysdb_initgroups_groups(struct sss_domain_info *domain,
+                                       struct ldb_result *res)
+{
+    struct ldb_message **groups;
+    struct ldb_dn *user_dn;
+    size_t count;
+    size_t c;
+    int ret;
+
+    if (!sysdb_initgr_closure_enabled(domain)) {
+        return sysdb_initgroups_asq(domain, res);
+    }
+
+    user_dn = res->msgs[0]->dn;
+
+    ret = sysdb_initgr_closure_get(res, domain, user_dn, &count, &groups);
+    if (ret != EOK) {
+        return sysdb_initgroups_asq(domain, res);
+    }
+
+    res->msgs = talloc_realloc(res, res->msgs, struct ldb_message *,
+                               res->count + count + 1);
+    if (res->msgs == NULL) {
+        talloc_free(groups);
+        return ENOMEM;
+    }
+
+    for (c = 0; c < count; c++) {
+        res->msgs[res->count + c] = talloc_steal(res->msgs, groups[c]);
+    }
+    res->count += count;
+    res->msgs[res->count] = NULL;
+    talloc_free(groups);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Groups of [%s] read from the closure index\n",
+          ldb_dn_get_linearized(user_dn));
+    return EOK;
+}
+
+int sysdb_initgroups(TALLOC_CTX *mem_ctx,
+                     struct sss_domain_info *domain,
+                     const char *name,
+                     struct ldb_result **_res)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_result *res;
+    int ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (!tmp_ctx) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_getpwnam(tmp_ctx, domain, name, &res);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "sysdb_getpwnam failed: [%d][%s]\n",
+                  ret, strerror(ret));
+        goto done;
+    }
+
+    if (res->count == 0) {
+        /* User is not cached yet */
+        *_res = talloc_steal(mem_ctx, res);
+        ret = EOK;
+        goto done;
+
+    } else if (res->count != 1) {
+        ret = EIO;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "sysdb_getpwnam returned count: [%d]\n", res->count);
+        goto done;
+    }
+
+    ret = sysdb_initgroups_groups(domain, res);
+    if (ret != EOK) {
+        goto done;
+    }
+
     *_res = talloc_steal(mem_ctx, res);
 
 done:
@@ -1826,11 +1891,6 @@ int sysdb_initgroups_with_views(TALLOC_CTX *mem_ctx,
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_result *res;
-    struct ldb_dn *user_dn;
-    struct ldb_request *req;
-    struct ldb_control **ctrl;
-    struct ldb_asq_control *control;
-    static const char *attrs[] = SYSDB_INITGR_ATTRS;
     int ret;
     size_t c;
 
@@ -1859,57 +1919,8 @@ int sysdb_initgroups_with_views(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
-    /* no need to steal the dn, we are not freeing the result */
-    user_dn = res->msgs[0]->dn;
-
-    /* note we count on the fact that the default search callback
-     * will just keep appending values. This is by design and can't
-     * change so it is ok to already have a result (from the getpwnam)
-     * even before we call the next search */
-
-    ctrl = talloc_array(tmp_ctx, struct ldb_control *, 2);
-    if (!ctrl) {
-        ret = ENOMEM;
-        goto done;
-    }
-    ctrl[1] = NULL;
-    ctrl[0] = talloc(ctrl, struct ldb_control);
-    if (!ctrl[0]) {
-        ret = ENOMEM;
-        goto done;
-    }
-    ctrl[0]->oid = LDB_CONTROL_ASQ_OID;
-    ctrl[0]->critical = 1;
-    control = talloc(ctrl[0], struct ldb_asq_control);
-    if (!control) {
-        ret = ENOMEM;
-        goto done;
-    }
-    control->request = 1;
-    control->source_attribute = talloc_strdup(control, SYSDB_INITGR_ATTR);
-    if (!control->source_attribute) {
-        ret = ENOMEM;
-        goto done;
-    }
-    control->src_attr_len = strlen(control->source_attribute);
-    ctrl[0]->data = control;
-
-    ret = ldb_build_search_req(&req, domain->sysdb->ldb, tmp_ctx,
-                               user_dn, LDB_SCOPE_BASE,
-                               SYSDB_INITGR_FILTER, attrs, ctrl,
-                               res, ldb_search_default_callback,
-                               NULL);
-    if (ret != LDB_SUCCESS) {
-        ret = sysdb_error_to_errno(ret);
-        goto done;
-    }
-
-    ret = ldb_request(domain->sysdb->ldb, req);
-    if (ret == LDB_SUCCESS) {
-        ret = ldb_wait(req->handle, LDB_WAIT_ALL);
-    }
-    if (ret != LDB_SUCCESS) {
-        ret = sysdb_error_to_errno(ret);
+    ret = sysdb_initgroups_groups(domain, res);
+    if (ret != EOK) {
         goto done;
     }
 
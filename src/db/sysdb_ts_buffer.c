@@ -0,0 +1,913 @@
+/*
+   SSSD
+
+   System Database - timestamp cache write buffer
+
+   Refreshing an entry that did not change on the server only moves its
+   timestamps. Instead of writing each of those updates to the timestamp
+   cache right away, they are collected in memory and written in a single
+   transaction when the flush interval elapses or the buffer is full.
+
+   Updates made inside a sysdb transaction are staged separately. They
+   join the buffer when the outermost transaction commits and are dropped
+   when it is cancelled, like the changes to the cache they belong to.
+
+   Losing the buffer is harmless: the timestamp cache then still holds the
+   older expiration times and the affected entries are simply refreshed
+   again.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ldb_module.h>
+
+#include "util/util.h"
+#include "util/sss_ptr_hash.h"
+#include "db/sysdb_private.h"
+
+/* Flush early when this many entries are pending */
+#define SYSDB_TS_BUFFER_MAX_ENTRIES 1000
+
+struct sysdb_ts_buffer {
+    struct sysdb_ctx *sysdb;
+    struct tevent_context *ev;
+    uint32_t flush_interval;
+
+    /* casefolded DN -> struct ldb_message with the pending replaces */
+    hash_table_t *entries;
+    unsigned long count;
+    struct tevent_timer *timer;
+
+    /* the same for the updates of the running sysdb transaction */
+    hash_table_t *staged;
+};
+
+static int sysdb_ts_buffer_destructor(struct sysdb_ts_buffer *buf)
+{
+    /* The updates are written on a clean shutdown, the buffer is freed
+     * together with the sysdb context before the ldb contexts */
+    sysdb_ts_buffer_flush(buf->sysdb);
+    buf->sysdb->ts_buffer = NULL;
+    return 0;
+}
+
+errno_t sysdb_ts_buffer_init(struct sysdb_ctx *sysdb,
+                             struct tevent_context *ev,
+                             uint32_t flush_interval)
+{
+    struct sysdb_ts_buffer *buf;
+
+    if (sysdb->ts_buffer != NULL) {
+        talloc_free(sysdb->ts_buffer);
+    }
+
+    if (flush_interval == 0 || sysdb->ldb_ts == NULL) {
+        return EOK;
+    }
+
+    buf = talloc_zero(sysdb, struct sysdb_ts_buffer);
+    if (buf == NULL) {
+        return ENOMEM;
+    }
+
+    buf->sysdb = sysdb;
+    buf->ev = ev;
+    buf->flush_interval = flush_interval;
+
+    buf->entries = sss_ptr_hash_create(buf, NULL, NULL);
+    if (buf->entries == NULL) {
+        talloc_free(buf);
+        return ENOMEM;
+    }
+
+    buf->staged = sss_ptr_hash_create(buf, NULL, NULL);
+    if (buf->staged == NULL) {
+        talloc_free(buf);
+        return ENOMEM;
+    }
+
+    talloc_set_destructor(buf, sysdb_ts_buffer_destructor);
+    sysdb->ts_buffer = buf;
+
+    DEBUG(SSSDBG_CONF_SETTINGS,
+          "Timestamp cache updates are flushed every %u seconds\n",
+          flush_interval);
+
+    return EOK;
+}
+
+bool sysdb_ts_buffer_enabled(struct sysdb_ctx *sysdb)
+{
+    return sysdb->ts_buffer != NULL;
+}
+
+static const char *sysdb_ts_buffer_key(struct ldb_dn *dn)
+{
+    return ldb_dn_get_casefold(dn);
+}
+
+static void sysdb_ts_buffer_timer(struct tevent_context *ev,
+                                  struct tevent_timer *te,
+                                  struct timeval tv,
+                                  void *pvt)
+{
+    struct sysdb_ts_buffer *buf;
+
+    buf = talloc_get_type(pvt, struct sysdb_ts_buffer);
+
+    /* tevent frees the timer */
+    buf->timer = NULL;
+    sysdb_ts_buffer_flush(buf->sysdb);
+}
+
+/* The timestamp entry is missing, which happens when the timestamp cache
+ * was removed. Recreate it as sysdb_set_entry_attr() does, unless the
+ * entry has been removed from the cache in the meantime */
+static int sysdb_ts_buffer_add_entry(struct sysdb_ctx *sysdb,
+                                     struct ldb_message *msg)
+{
+    static const char *attrs[] = { NULL };
+    struct ldb_result *res;
+    unsigned int i;
+    int lret;
+
+    lret = ldb_search(sysdb->ldb, msg, &res, msg->dn, LDB_SCOPE_BASE,
+                      attrs, NULL);
+    if (lret != LDB_SUCCESS) {
+        return lret;
+    }
+
+    if (res->count != 1) {
+        talloc_free(res);
+        return LDB_ERR_NO_SUCH_OBJECT;
+    }
+    talloc_free(res);
+
+    for (i = 0; i < msg->num_elements; i++) {
+        msg->elements[i].flags = 0;
+    }
+
+    return ldb_add(sysdb->ldb_ts, msg);
+}
+
+static int sysdb_ts_buffer_write(struct sysdb_ctx *sysdb,
+                                 struct ldb_message *msg)
+{
+    int lret;
+
+    lret = ldb_modify(sysdb->ldb_ts, msg);
+    if (lret == LDB_ERR_NO_SUCH_OBJECT) {
+        lret = sysdb_ts_buffer_add_entry(sysdb, msg);
+    }
+
+    if (lret == LDB_ERR_NO_SUCH_OBJECT) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Entry [%s] is gone, update dropped\n",
+              ldb_dn_get_linearized(msg->dn));
+        lret = LDB_SUCCESS;
+    } else if (lret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot write the timestamps of [%s]: [%s](%d)[%s]\n",
+              ldb_dn_get_linearized(msg->dn), ldb_strerror(lret), lret,
+              ldb_errstring(sysdb->ldb_ts));
+    }
+
+    return lret;
+}
+
+errno_t sysdb_ts_buffer_flush(struct sysdb_ctx *sysdb)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+    struct ldb_message *msg;
+    hash_value_t *values = NULL;
+    unsigned long count;
+    unsigned long failed = 0;
+    unsigned long i;
+    bool in_transaction = false;
+    errno_t ret;
+    int hret;
+    int lret;
+
+    if (buf == NULL || buf->count == 0) {
+        return EOK;
+    }
+
+    talloc_zfree(buf->timer);
+
+    hret = hash_values(buf->entries, &count, &values);
+    if (hret != HASH_SUCCESS) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    lret = ldb_transaction_start(sysdb->ldb_ts);
+    if (lret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot start timestamp cache transaction: [%s](%d)[%s]\n",
+              ldb_strerror(lret), lret, ldb_errstring(sysdb->ldb_ts));
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+    in_transaction = true;
+
+    for (i = 0; i < count; i++) {
+        msg = sss_ptr_get_value(&values[i], struct ldb_message);
+        if (msg == NULL) {
+            continue;
+        }
+
+        /* a single failing entry must not discard the others */
+        if (sysdb_ts_buffer_write(sysdb, msg) != LDB_SUCCESS) {
+            failed++;
+        }
+    }
+
+    lret = ldb_transaction_commit(sysdb->ldb_ts);
+    if (lret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot commit timestamp cache transaction: [%s](%d)[%s]\n",
+              ldb_strerror(lret), lret, ldb_errstring(sysdb->ldb_ts));
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+    in_transaction = false;
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Flushed %lu timestamp cache updates, %lu failed\n",
+          count, failed);
+    ret = EOK;
+
+done:
+    if (in_transaction) {
+        lret = ldb_transaction_cancel(sysdb->ldb_ts);
+        if (lret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Cannot cancel timestamp cache transaction\n");
+        }
+    }
+
+    /* Whatever was not written is lost, the entries just expire earlier */
+    talloc_free(values);
+    sss_ptr_hash_delete_all(buf->entries, true);
+    buf->count = 0;
+
+    return ret;
+}
+
+/* Adds a copy of el to msg, the attrs of the callers are temporary */
+static int sysdb_ts_buffer_copy_el(struct ldb_message *msg,
+                                   struct ldb_message_element *el,
+                                   int flags)
+{
+    struct ldb_val val;
+    unsigned int i;
+    int lret;
+
+    lret = ldb_msg_add_empty(msg, el->name, flags, NULL);
+    if (lret != LDB_SUCCESS) {
+        return lret;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        val = ldb_val_dup(msg, &el->values[i]);
+        if (val.data == NULL) {
+            return LDB_ERR_OPERATIONS_ERROR;
+        }
+
+        lret = ldb_msg_add_value(msg, el->name, &val, NULL);
+        if (lret != LDB_SUCCESS) {
+            return lret;
+        }
+    }
+
+    return LDB_SUCCESS;
+}
+
+/* Adds msg to table under key. The pending values of the attributes msg
+ * does not replace are kept. */
+static errno_t sysdb_ts_buffer_put(hash_table_t *table,
+                                   const char *key,
+                                   struct ldb_message *msg)
+{
+    struct ldb_message *pending;
+    unsigned int i;
+    int lret;
+
+    pending = sss_ptr_hash_lookup(table, key, struct ldb_message);
+    if (pending != NULL) {
+        for (i = 0; i < pending->num_elements; i++) {
+            if (ldb_msg_find_element(msg, pending->elements[i].name) != NULL) {
+                continue;
+            }
+
+            lret = sysdb_ts_buffer_copy_el(msg, &pending->elements[i],
+                                           LDB_FLAG_MOD_REPLACE);
+            if (lret != LDB_SUCCESS) {
+                return sysdb_error_to_errno(lret);
+            }
+        }
+
+        talloc_free(pending);
+    }
+
+    return sss_ptr_hash_add(table, key, msg, struct ldb_message);
+}
+
+/* Flushes a full buffer or makes sure it is flushed later */
+static errno_t sysdb_ts_buffer_schedule(struct sysdb_ts_buffer *buf)
+{
+    buf->count = hash_count(buf->entries);
+
+    if (buf->count >= SYSDB_TS_BUFFER_MAX_ENTRIES) {
+        return sysdb_ts_buffer_flush(buf->sysdb);
+    }
+
+    if (buf->count > 0 && buf->timer == NULL) {
+        buf->timer = tevent_add_timer(buf->ev, buf,
+                            tevent_timeval_current_ofs(buf->flush_interval, 0),
+                            sysdb_ts_buffer_timer, buf);
+        if (buf->timer == NULL) {
+            /* the update is written by the next flush */
+            DEBUG(SSSDBG_MINOR_FAILURE, "Cannot schedule flush\n");
+        }
+    }
+
+    return EOK;
+}
+
+errno_t sysdb_ts_buffer_add(struct sysdb_ctx *sysdb,
+                            struct ldb_dn *entry_dn,
+                            struct sysdb_attrs *attrs)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+    struct ldb_message *msg;
+    hash_table_t *table;
+    const char *key;
+    int i;
+    errno_t ret;
+    int lret;
+
+    if (attrs->num == 0) {
+        return EOK;
+    }
+
+    key = sysdb_ts_buffer_key(entry_dn);
+    if (key == NULL) {
+        return ENOMEM;
+    }
+
+    msg = ldb_msg_new(buf);
+    if (msg == NULL) {
+        return ENOMEM;
+    }
+
+    msg->dn = ldb_dn_copy(msg, entry_dn);
+    if (msg->dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < attrs->num; i++) {
+        lret = sysdb_ts_buffer_copy_el(msg, &attrs->a[i],
+                                       LDB_FLAG_MOD_REPLACE);
+        if (lret != LDB_SUCCESS) {
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+    }
+
+    table = sysdb->transaction_nesting > 0 ? buf->staged : buf->entries;
+
+    ret = sysdb_ts_buffer_put(table, key, msg);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (table == buf->staged) {
+        /* scheduled when the transaction commits */
+        return EOK;
+    }
+
+    return sysdb_ts_buffer_schedule(buf);
+
+done:
+    talloc_free(msg);
+    return ret;
+}
+
+void sysdb_ts_buffer_commit(struct sysdb_ctx *sysdb)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+    struct ldb_message *msg;
+    hash_value_t *values = NULL;
+    unsigned long count;
+    unsigned long i;
+    const char *key;
+    errno_t ret;
+    int hret;
+
+    if (buf == NULL || hash_count(buf->staged) == 0) {
+        return;
+    }
+
+    hret = hash_values(buf->staged, &count, &values);
+    if (hret != HASH_SUCCESS) {
+        /* the entries just expire earlier */
+        sss_ptr_hash_delete_all(buf->staged, true);
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        msg = sss_ptr_get_value(&values[i], struct ldb_message);
+        if (msg == NULL) {
+            continue;
+        }
+
+        key = sysdb_ts_buffer_key(msg->dn);
+        if (key == NULL) {
+            continue;
+        }
+
+        sss_ptr_hash_delete(buf->staged, key, false);
+
+        ret = sysdb_ts_buffer_put(buf->entries, key, msg);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Cannot buffer the timestamps of [%s]\n",
+                  ldb_dn_get_linearized(msg->dn));
+            talloc_free(msg);
+        }
+    }
+
+    talloc_free(values);
+    sss_ptr_hash_delete_all(buf->staged, true);
+
+    sysdb_ts_buffer_schedule(buf);
+}
+
+void sysdb_ts_buffer_cancel(struct sysdb_ctx *sysdb)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+
+    if (buf == NULL) {
+        return;
+    }
+
+    sss_ptr_hash_delete_all(buf->staged, true);
+}
+
+static bool sysdb_ts_buffer_empty(struct sysdb_ts_buffer *buf)
+{
+    return buf == NULL
+            || (buf->count == 0 && hash_count(buf->staged) == 0);
+}
+
+errno_t sysdb_ts_buffer_flush_dn(struct sysdb_ctx *sysdb,
+                                 struct ldb_dn *entry_dn)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+    hash_table_t *tables[2];
+    struct ldb_message *pending;
+    const char *key;
+    unsigned int i;
+    int lret = LDB_SUCCESS;
+
+    if (sysdb_ts_buffer_empty(buf)) {
+        return EOK;
+    }
+
+    key = sysdb_ts_buffer_key(entry_dn);
+    if (key == NULL) {
+        return ENOMEM;
+    }
+
+    /* the staged update is the newer one */
+    tables[0] = buf->entries;
+    tables[1] = buf->staged;
+
+    for (i = 0; i < 2 && lret == LDB_SUCCESS; i++) {
+        pending = sss_ptr_hash_lookup(tables[i], key, struct ldb_message);
+        if (pending == NULL) {
+            continue;
+        }
+
+        lret = sysdb_ts_buffer_write(sysdb, pending);
+        talloc_free(pending);
+    }
+
+    buf->count = hash_count(buf->entries);
+
+    return sysdb_error_to_errno(lret);
+}
+
+void sysdb_ts_buffer_drop_dn(struct sysdb_ctx *sysdb,
+                             struct ldb_dn *entry_dn)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+    struct ldb_message *pending;
+    const char *key;
+
+    if (sysdb_ts_buffer_empty(buf)) {
+        return;
+    }
+
+    key = sysdb_ts_buffer_key(entry_dn);
+    if (key == NULL) {
+        return;
+    }
+
+    pending = sss_ptr_hash_lookup(buf->entries, key, struct ldb_message);
+    talloc_free(pending);
+    pending = sss_ptr_hash_lookup(buf->staged, key, struct ldb_message);
+    talloc_free(pending);
+
+    buf->count = hash_count(buf->entries);
+}
+
+static errno_t sysdb_ts_buffer_merge_msg(struct ldb_message *ts_msg,
+                                         struct ldb_message *pending)
+{
+    unsigned int i;
+    int lret;
+
+    for (i = 0; i < pending->num_elements; i++) {
+        ldb_msg_remove_attr(ts_msg, pending->elements[i].name);
+
+        lret = sysdb_ts_buffer_copy_el(ts_msg, &pending->elements[i], 0);
+        if (lret != LDB_SUCCESS) {
+            return sysdb_error_to_errno(lret);
+        }
+    }
+
+    return EOK;
+}
+
+errno_t sysdb_ts_buffer_merge(struct sysdb_ctx *sysdb,
+                              struct ldb_message *ts_msg)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+    struct ldb_message *pending;
+    const char *key;
+    errno_t ret;
+
+    if (sysdb_ts_buffer_empty(buf)) {
+        return EOK;
+    }
+
+    key = sysdb_ts_buffer_key(ts_msg->dn);
+    if (key == NULL) {
+        return ENOMEM;
+    }
+
+    pending = sss_ptr_hash_lookup(buf->entries, key, struct ldb_message);
+    if (pending != NULL) {
+        ret = sysdb_ts_buffer_merge_msg(ts_msg, pending);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    /* the transaction reads its own updates */
+    pending = sss_ptr_hash_lookup(buf->staged, key, struct ldb_message);
+    if (pending != NULL) {
+        ret = sysdb_ts_buffer_merge_msg(ts_msg, pending);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+/* Whether the result of tree can depend on the attributes pending updates */
+static bool sysdb_ts_buffer_tree_uses(const struct ldb_parse_tree *tree,
+                                      const struct ldb_message *pending)
+{
+    const char *attr;
+    unsigned int i;
+
+    switch (tree->operation) {
+    case LDB_OP_AND:
+    case LDB_OP_OR:
+        for (i = 0; i < tree->u.list.num_elements; i++) {
+            if (sysdb_ts_buffer_tree_uses(tree->u.list.elements[i],
+                                          pending)) {
+                return true;
+            }
+        }
+        return false;
+    case LDB_OP_NOT:
+        return sysdb_ts_buffer_tree_uses(tree->u.isnot.child, pending);
+    case LDB_OP_EQUALITY:
+        attr = tree->u.equality.attr;
+        break;
+    case LDB_OP_SUBSTRING:
+        attr = tree->u.substring.attr;
+        break;
+    case LDB_OP_GREATER:
+    case LDB_OP_LESS:
+    case LDB_OP_APPROX:
+        attr = tree->u.comparison.attr;
+        break;
+    case LDB_OP_PRESENT:
+        attr = tree->u.present.attr;
+        break;
+    case LDB_OP_EXTENDED:
+        attr = tree->u.extended.attr;
+        break;
+    default:
+        return true;
+    }
+
+    return attr == NULL || ldb_msg_find_element(pending, attr) != NULL;
+}
+
+/* Keeps only the attributes the search asked for */
+static void sysdb_ts_buffer_trim(struct ldb_message *msg, const char **attrs)
+{
+    unsigned int i;
+    unsigned int j;
+
+    if (attrs == NULL) {
+        return;
+    }
+
+    for (j = 0; attrs[j] != NULL; j++) {
+        if (strcmp(attrs[j], "*") == 0) {
+            return;
+        }
+    }
+
+    for (i = msg->num_elements; i > 0; i--) {
+        for (j = 0; attrs[j] != NULL; j++) {
+            if (ldb_attr_cmp(attrs[j], msg->elements[i - 1].name) == 0) {
+                break;
+            }
+        }
+
+        if (attrs[j] == NULL) {
+            ldb_msg_remove_element(msg, &msg->elements[i - 1]);
+        }
+    }
+}
+
+struct sysdb_ts_buffer_search_state {
+    struct sysdb_ctx *sysdb;
+    struct ldb_dn *base_dn;
+    enum ldb_scope scope;
+    struct ldb_parse_tree *tree;
+    const char **attrs;
+
+    /* casefolded DN -> index in msgs */
+    hash_table_t *found;
+    struct ldb_message **msgs;
+    size_t count;
+};
+
+/* Re-evaluates the filter for an entry with a pending update the filter
+ * depends on, against the stored entry with the update applied */
+static errno_t
+sysdb_ts_buffer_search_check(struct sysdb_ts_buffer_search_state *state,
+                             struct ldb_message *pending)
+{
+    struct ldb_context *ldb = state->sysdb->ldb_ts;
+    struct ldb_message *msg;
+    struct ldb_result *res;
+    hash_key_t key;
+    hash_value_t value;
+    bool matched;
+    bool listed;
+    errno_t ret;
+    int hret;
+    int lret;
+
+    if (!sysdb_ts_buffer_tree_uses(state->tree, pending)) {
+        /* the stored entry gives the same answer */
+        return EOK;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(sysdb_ts_buffer_key(pending->dn));
+    if (key.str == NULL) {
+        return ENOMEM;
+    }
+
+    hret = hash_lookup(state->found, &key, &value);
+    listed = (hret == HASH_SUCCESS);
+
+    lret = ldb_search(ldb, state, &res, pending->dn, LDB_SCOPE_BASE,
+                      NULL, NULL);
+    if (lret == LDB_ERR_NO_SUCH_OBJECT) {
+        return EOK;
+    } else if (lret != LDB_SUCCESS) {
+        return sysdb_error_to_errno(lret);
+    }
+
+    if (res->count != 1) {
+        talloc_free(res);
+        return EOK;
+    }
+    msg = res->msgs[0];
+
+    ret = sysdb_ts_buffer_merge(state->sysdb, msg);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    lret = ldb_match_msg_error(ldb, msg, state->tree, state->base_dn,
+                               state->scope, &matched);
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    if (matched && !listed) {
+        state->msgs = talloc_realloc(state, state->msgs,
+                                     struct ldb_message *, state->count + 2);
+        if (state->msgs == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        sysdb_ts_buffer_trim(msg, state->attrs);
+        state->msgs[state->count] = talloc_steal(state->msgs, msg);
+        state->msgs[state->count + 1] = NULL;
+
+        value.type = HASH_VALUE_ULONG;
+        value.ul = state->count;
+        hret = hash_enter(state->found, &key, &value);
+        if (hret != HASH_SUCCESS) {
+            ret = ENOMEM;
+            goto done;
+        }
+        state->count++;
+    } else if (!matched && listed && state->msgs[value.ul] != NULL) {
+        DEBUG(SSSDBG_TRACE_ALL, "[%s] no longer matches\n",
+              ldb_dn_get_linearized(pending->dn));
+        talloc_zfree(state->msgs[value.ul]);
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(res);
+    return ret;
+}
+
+static errno_t
+sysdb_ts_buffer_search_table(struct sysdb_ts_buffer_search_state *state,
+                             hash_table_t *table)
+{
+    struct ldb_message *pending;
+    hash_value_t *values = NULL;
+    unsigned long count;
+    unsigned long i;
+    errno_t ret = EOK;
+    int hret;
+
+    if (hash_count(table) == 0) {
+        return EOK;
+    }
+
+    hret = hash_values(table, &count, &values);
+    if (hret != HASH_SUCCESS) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < count; i++) {
+        pending = sss_ptr_get_value(&values[i], struct ldb_message);
+        if (pending == NULL) {
+            continue;
+        }
+
+        ret = sysdb_ts_buffer_search_check(state, pending);
+        if (ret != EOK) {
+            break;
+        }
+    }
+
+    talloc_free(values);
+    return ret;
+}
+
+errno_t sysdb_ts_buffer_search(TALLOC_CTX *mem_ctx,
+                               struct sysdb_ctx *sysdb,
+                               struct ldb_dn *base_dn,
+                               enum ldb_scope scope,
+                               const char *filter,
+                               const char **attrs,
+                               size_t *_msgs_count,
+                               struct ldb_message ***_msgs)
+{
+    struct sysdb_ts_buffer *buf = sysdb->ts_buffer;
+    struct sysdb_ts_buffer_search_state *state;
+    hash_key_t key;
+    hash_value_t value;
+    size_t i;
+    size_t n;
+    errno_t ret;
+    int hret;
+
+    state = talloc_zero(NULL, struct sysdb_ts_buffer_search_state);
+    if (state == NULL) {
+        return ENOMEM;
+    }
+    state->sysdb = sysdb;
+    state->base_dn = base_dn;
+    state->scope = scope;
+    state->attrs = attrs;
+
+    ret = sysdb_cache_search_entry(state, sysdb->ldb_ts, base_dn, scope,
+                                   filter, attrs, &state->count,
+                                   &state->msgs);
+    if (ret == ENOENT) {
+        state->count = 0;
+        state->msgs = NULL;
+    } else if (ret != EOK) {
+        goto done;
+    }
+
+    /* The entries a filter matches can change with the pending updates.
+     * Only the ones whose updates touch an attribute of the filter are
+     * looked at again, nothing is written. */
+    if (filter != NULL && !sysdb_ts_buffer_empty(buf)) {
+        state->tree = ldb_parse_tree(state, filter);
+        if (state->tree == NULL) {
+            ret = EINVAL;
+            goto done;
+        }
+
+        ret = sss_hash_create(state, state->count, &state->found);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        key.type = HASH_KEY_STRING;
+        value.type = HASH_VALUE_ULONG;
+        for (i = 0; i < state->count; i++) {
+            key.str = discard_const(sysdb_ts_buffer_key(state->msgs[i]->dn));
+            if (key.str == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+
+            value.ul = i;
+            hret = hash_enter(state->found, &key, &value);
+            if (hret != HASH_SUCCESS) {
+                ret = ENOMEM;
+                goto done;
+            }
+        }
+
+        ret = sysdb_ts_buffer_search_table(state, buf->entries);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        ret = sysdb_ts_buffer_search_table(state, buf->staged);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        /* drop the entries that no longer match */
+        for (i = 0, n = 0; i < state->count; i++) {
+            if (state->msgs[i] != NULL) {
+                state->msgs[n++] = state->msgs[i];
+            }
+        }
+        state->count = n;
+        if (state->msgs != NULL) {
+            state->msgs[n] = NULL;
+        }
+    }
+
+    for (i = 0; i < state->count; i++) {
+        ret = sysdb_ts_buffer_merge(sysdb, state->msgs[i]);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if (state->count == 0) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    *_msgs_count = state->count;
+    *_msgs = talloc_steal(mem_ctx, state->msgs);
+    ret = EOK;
+
+done:
+    talloc_free(state);
+    return ret;
+}
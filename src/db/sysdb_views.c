@@ -306,6 +306,7 @@ static errno_t invalidate_entry_override(struct sysdb_ctx *sysdb,
     }
 
     if (sysdb->ldb_ts != NULL) {
+        sysdb_ts_buffer_flush_dn(sysdb, dn);
         ret = ldb_modify(sysdb->ldb_ts, msg_repl);
         if (ret != LDB_SUCCESS && ret != LDB_ERR_NO_SUCH_ATTRIBUTE) {
             DEBUG(SSSDBG_OP_FAILURE,
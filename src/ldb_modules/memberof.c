@@ -18,6 +18,8 @@
 */
 
 #include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
 #include <dhash.h>
 
 #include "ldb_module.h"
@@ -32,11 +34,17 @@
 #define DB_GROUP_CLASS "group"
 #define DB_CACHE_EXPIRE "dataExpireTimestamp"
 #define DB_OC "objectCategory"
+#define DB_BASE "cn=sysdb"
+#define DB_GROUPS_CONTAINER "groups"
+#define DB_GROUP_GENERATION "groupGeneration"
 
 #ifndef MAX
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 #endif
 
+/* upper bound of group entries kept by the transaction graph */
+#define MBOF_GRAPH_MAX_ENTRIES 65536
+
 struct mbof_val_array {
     struct ldb_val *vals;
     int num;
@@ -52,6 +60,29 @@ struct mbof_dn {
     struct ldb_dn *dn;
 };
 
+/* Group entries (objectCategory, name, member, ghost and memberof) read
+ * while the current transaction is open, keyed by casefolded DN. Their
+ * memberof values are the group-to-parent edges walked by the add and
+ * delete operations, so every group is read from the database once per
+ * transaction instead of once per hop. Entries are dropped as soon as a
+ * request touching them is passed down and the whole graph is dropped when
+ * the transaction ends. */
+struct mbof_graph {
+    hash_table_t *entries;
+};
+
+struct mbof_private {
+    bool in_transaction;
+    struct mbof_graph *graph;
+
+    /* the generation of the group data was replaced in this transaction */
+    bool gen_replaced;
+    /* request continued after the generation was handled */
+    struct ldb_request *gen_req;
+    /* attribute keying the records in compact caches, see sysdb_format.c */
+    const char *guid_attr;
+};
+
 struct mbof_ctx {
     struct ldb_module *module;
     struct ldb_request *req;
@@ -73,13 +104,19 @@ struct mbof_add_operation {
 struct mbof_memberuid_op {
     struct ldb_dn *dn;
     struct ldb_message_element *el;
+
+    /* values already in el, to skip duplicates */
+    hash_table_t *values;
 };
 
 struct mbof_add_ctx {
     struct mbof_ctx *ctx;
 
     struct mbof_add_operation *add_list;
+    struct mbof_add_operation *add_tail;
     struct mbof_add_operation *current_op;
+    /* casefolded DN -> queued add operation */
+    hash_table_t *addop_index;
 
     struct ldb_message *msg;
     struct ldb_dn *msg_dn;
@@ -90,6 +127,8 @@ struct mbof_add_ctx {
     struct mbof_memberuid_op *muops;
     int num_muops;
     int cur_muop;
+    /* casefolded parent DN -> index in muops */
+    hash_table_t *muop_index;
 };
 
 struct mbof_del_ancestors_ctx {
@@ -131,10 +170,12 @@ struct mbof_del_ctx {
     struct mbof_memberuid_op *muops;
     int num_muops;
     int cur_muop;
+    hash_table_t *muop_index;
 
     struct mbof_memberuid_op *ghops;
     int num_ghops;
     int cur_ghop;
+    hash_table_t *ghop_index;
 
     struct mbof_mod_ctx *follow_mod;
     bool is_mod;
@@ -225,9 +266,411 @@ static int entry_is_group_object(struct ldb_message *entry)
     return entry_has_objectclass(entry, DB_GROUP_CLASS);
 }
 
+static struct mbof_private *mbof_get_private(struct ldb_module *module)
+{
+    return talloc_get_type(ldb_module_get_private(module),
+                           struct mbof_private);
+}
+
+static void mbof_graph_flush(struct ldb_module *module)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+
+    if (priv != NULL) {
+        talloc_zfree(priv->graph);
+    }
+}
+
+static const struct ldb_message *mbof_graph_lookup(struct ldb_module *module,
+                                                   struct ldb_dn *dn)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+    hash_value_t value;
+    hash_key_t key;
+    int ret;
+
+    if (priv == NULL || !priv->in_transaction || priv->graph == NULL) {
+        return NULL;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(dn));
+    if (!key.str) {
+        return NULL;
+    }
+
+    ret = hash_lookup(priv->graph->entries, &key, &value);
+    if (ret != HASH_SUCCESS) {
+        return NULL;
+    }
+
+    return talloc_get_type(value.ptr, struct ldb_message);
+}
+
+/* Failing to remember an entry only costs a search later, so errors are
+ * not reported to the caller */
+static void mbof_graph_store(struct ldb_module *module,
+                             struct ldb_message *entry)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+    struct ldb_message *copy;
+    hash_value_t value;
+    hash_key_t key;
+    int ret;
+
+    if (priv == NULL || !priv->in_transaction) {
+        return;
+    }
+
+    if (entry_is_group_object(entry) != LDB_SUCCESS) {
+        return;
+    }
+
+    if (priv->graph == NULL) {
+        priv->graph = talloc_zero(priv, struct mbof_graph);
+        if (priv->graph == NULL) {
+            return;
+        }
+
+        ret = hash_create_ex(0, &priv->graph->entries, 0, 0, 0, 0,
+                             hash_alloc, hash_free, priv->graph, NULL, NULL);
+        if (ret != HASH_SUCCESS) {
+            talloc_zfree(priv->graph);
+            return;
+        }
+    }
+
+    if (hash_count(priv->graph->entries) >= MBOF_GRAPH_MAX_ENTRIES) {
+        return;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(entry->dn));
+    if (!key.str || hash_has_key(priv->graph->entries, &key)) {
+        return;
+    }
+
+    copy = ldb_msg_copy(priv->graph, entry);
+    if (copy == NULL) {
+        return;
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = copy;
+    ret = hash_enter(priv->graph->entries, &key, &value);
+    if (ret != HASH_SUCCESS) {
+        talloc_free(copy);
+    }
+}
+
+static void mbof_graph_forget(struct ldb_module *module,
+                              struct ldb_request *req)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+    struct ldb_dn *dn;
+    hash_value_t value;
+    hash_key_t key;
+    int ret;
+
+    if (priv == NULL || priv->graph == NULL) {
+        return;
+    }
+
+    switch (req->operation) {
+    case LDB_ADD:
+        dn = req->op.add.message->dn;
+        break;
+    case LDB_MODIFY:
+        dn = req->op.mod.message->dn;
+        break;
+    case LDB_DELETE:
+        dn = req->op.del.dn;
+        break;
+    case LDB_RENAME:
+        /* memberof values of other entries may point to the old name */
+        mbof_graph_flush(module);
+        return;
+    default:
+        return;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(dn));
+    if (!key.str) {
+        mbof_graph_flush(module);
+        return;
+    }
+
+    ret = hash_lookup(priv->graph->entries, &key, &value);
+    if (ret != HASH_SUCCESS) {
+        return;
+    }
+
+    ret = hash_delete(priv->graph->entries, &key);
+    if (ret != HASH_SUCCESS) {
+        mbof_graph_flush(module);
+        return;
+    }
+    talloc_free(value.ptr);
+}
+
+/* All writes, ours and the ones we were asked for, are passed down through
+ * here so that the graph never holds a stale entry */
+static int mbof_next_request(struct ldb_module *module,
+                             struct ldb_request *req)
+{
+    mbof_graph_forget(module, req);
+    return ldb_next_request(module, req);
+}
+
+/* The generation of the group data is replaced in the base entry of the
+ * cache whenever a write may change the groups some entry is a member of,
+ * or the attributes of such groups. Data derived from the groups, like the
+ * initgroups closure index of sysdb, is valid only as long as the
+ * generation it was built with is current. It is replaced once per
+ * transaction. */
+typedef int (*mbof_gen_next_fn)(struct ldb_module *module,
+                                struct ldb_request *req);
+
+struct mbof_gen_ctx {
+    struct ldb_module *module;
+    struct ldb_request *req;
+    mbof_gen_next_fn next;
+
+    bool has_members;
+};
+
+/* name=...,cn=groups,cn=<domain>,cn=sysdb */
+static bool mbof_is_group_dn(struct ldb_dn *dn)
+{
+    const struct ldb_val *val;
+    const char *name;
+
+    if (ldb_dn_get_comp_num(dn) != 4) {
+        return false;
+    }
+
+    name = ldb_dn_get_component_name(dn, 1);
+    val = ldb_dn_get_component_val(dn, 1);
+    if (name == NULL || val == NULL || strcasecmp(name, "cn") != 0) {
+        return false;
+    }
+
+    return val->length == strlen(DB_GROUPS_CONTAINER)
+            && strncasecmp((const char *)val->data, DB_GROUPS_CONTAINER,
+                           val->length) == 0;
+}
+
+static bool mbof_gen_needed(struct ldb_module *module,
+                            struct ldb_request *req,
+                            struct ldb_dn *dn)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+
+    if (priv->gen_replaced || priv->gen_req == req) {
+        return false;
+    }
+
+    return mbof_is_group_dn(dn);
+}
+
+static int mbof_gen_continue(struct mbof_gen_ctx *gen_ctx)
+{
+    struct mbof_private *priv = mbof_get_private(gen_ctx->module);
+    int ret;
+
+    priv->gen_req = gen_ctx->req;
+    ret = gen_ctx->next(gen_ctx->module, gen_ctx->req);
+    priv->gen_req = NULL;
+
+    if (ret != LDB_SUCCESS) {
+        return ldb_module_done(gen_ctx->req, NULL, NULL, ret);
+    }
+
+    return LDB_SUCCESS;
+}
+
+static int mbof_gen_replace_callback(struct ldb_request *req,
+                                     struct ldb_reply *ares)
+{
+    struct mbof_gen_ctx *gen_ctx;
+    struct mbof_private *priv;
+
+    gen_ctx = talloc_get_type(req->context, struct mbof_gen_ctx);
+    priv = mbof_get_private(gen_ctx->module);
+
+    if (!ares) {
+        return ldb_module_done(gen_ctx->req, NULL, NULL,
+                               LDB_ERR_OPERATIONS_ERROR);
+    }
+
+    /* caches without a base entry have nothing derived from the groups */
+    if (ares->error != LDB_SUCCESS
+            && ares->error != LDB_ERR_NO_SUCH_OBJECT) {
+        return ldb_module_done(gen_ctx->req, ares->controls,
+                               ares->response, ares->error);
+    }
+
+    if (ares->error == LDB_SUCCESS && ares->type != LDB_REPLY_DONE) {
+        talloc_zfree(ares);
+        return LDB_SUCCESS;
+    }
+
+    talloc_zfree(ares);
+    priv->gen_replaced = true;
+
+    return mbof_gen_continue(gen_ctx);
+}
+
+static int mbof_gen_replace(struct mbof_gen_ctx *gen_ctx)
+{
+    static unsigned int counter;
+    struct ldb_context *ldb = ldb_module_get_ctx(gen_ctx->module);
+    struct ldb_request *mod_req;
+    struct ldb_message *msg;
+    struct timeval tv;
+    int ret;
+
+    msg = ldb_msg_new(gen_ctx);
+    if (!msg) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
+
+    msg->dn = ldb_dn_new(msg, ldb, DB_BASE);
+    if (!msg->dn) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
+
+    ret = ldb_msg_add_empty(msg, DB_GROUP_GENERATION,
+                            LDB_FLAG_MOD_REPLACE, NULL);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
+    /* only has to differ from all the values used before */
+    gettimeofday(&tv, NULL);
+    ret = ldb_msg_add_fmt(msg, DB_GROUP_GENERATION, "%lld.%06ld-%d-%u",
+                          (long long)tv.tv_sec, (long)tv.tv_usec,
+                          (int)getpid(), counter++);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
+    ret = ldb_build_mod_req(&mod_req, ldb, gen_ctx, msg, NULL,
+                            gen_ctx, mbof_gen_replace_callback,
+                            gen_ctx->req);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
+    return mbof_next_request(gen_ctx->module, mod_req);
+}
+
+static int mbof_gen_search_callback(struct ldb_request *req,
+                                    struct ldb_reply *ares)
+{
+    struct mbof_gen_ctx *gen_ctx;
+    int ret;
+
+    gen_ctx = talloc_get_type(req->context, struct mbof_gen_ctx);
+
+    if (!ares) {
+        return ldb_module_done(gen_ctx->req, NULL, NULL,
+                               LDB_ERR_OPERATIONS_ERROR);
+    }
+
+    /* a missing entry is reported by the request itself */
+    if (ares->error != LDB_SUCCESS
+            && ares->error != LDB_ERR_NO_SUCH_OBJECT) {
+        return ldb_module_done(gen_ctx->req, ares->controls,
+                               ares->response, ares->error);
+    }
+
+    switch (ares->type) {
+    case LDB_REPLY_ENTRY:
+        gen_ctx->has_members = true;
+        break;
+
+    case LDB_REPLY_REFERRAL:
+        /* ignore */
+        break;
+
+    case LDB_REPLY_DONE:
+        talloc_zfree(ares);
+
+        /* nobody is a member of a group without members */
+        if (!gen_ctx->has_members) {
+            return mbof_gen_continue(gen_ctx);
+        }
+
+        ret = mbof_gen_replace(gen_ctx);
+        if (ret != LDB_SUCCESS) {
+            return ldb_module_done(gen_ctx->req, NULL, NULL, ret);
+        }
+        return LDB_SUCCESS;
+    }
+
+    talloc_zfree(ares);
+    return LDB_SUCCESS;
+}
+
+/* Whether a modification of a group changes more than its ghost users */
+static bool mbof_mod_changes_group(const struct ldb_message *msg)
+{
+    unsigned int i;
+
+    for (i = 0; i < msg->num_elements; i++) {
+        if (strcasecmp(msg->elements[i].name, DB_GHOST) != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Replaces the generation before @req, which writes the group @dn, is
+ * continued with @next. Unless @members_change is set, it is replaced only
+ * if the group has members. */
+static int mbof_gen_start(struct ldb_module *module,
+                          struct ldb_request *req,
+                          struct ldb_dn *dn,
+                          bool members_change,
+                          mbof_gen_next_fn next)
+{
+    static const char *attrs[] = { DB_OC, NULL };
+    struct ldb_context *ldb = ldb_module_get_ctx(module);
+    struct mbof_gen_ctx *gen_ctx;
+    struct ldb_request *search;
+    int ret;
+
+    gen_ctx = talloc_zero(req, struct mbof_gen_ctx);
+    if (!gen_ctx) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
+    gen_ctx->module = module;
+    gen_ctx->req = req;
+    gen_ctx->next = next;
+
+    if (members_change) {
+        return mbof_gen_replace(gen_ctx);
+    }
+
+    ret = ldb_build_search_req(&search, ldb, gen_ctx,
+                               dn, LDB_SCOPE_BASE,
+                               "("DB_MEMBER"=*)", attrs, NULL,
+                               gen_ctx, mbof_gen_search_callback,
+                               req);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
+    return ldb_next_request(module, search);
+}
+
 static int mbof_append_muop(TALLOC_CTX *memctx,
                             struct mbof_memberuid_op **_muops,
                             int *_num_muops,
+                            hash_table_t **_muop_index,
                             int flags,
                             struct ldb_dn *parent,
                             const char *name,
@@ -237,15 +680,32 @@ static int mbof_append_muop(TALLOC_CTX *memctx,
     int num_muops = *_num_muops;
     struct mbof_memberuid_op *op;
     struct ldb_val *val;
-    int i;
+    hash_value_t value;
+    hash_key_t key;
+    int ret;
+
+    /* Deleting a group with thousands of members queues thousands of
+     * values for each parent, so both the parent and the value lookups
+     * are done through hash tables rather than by scanning the arrays */
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(parent));
+    if (!key.str) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
 
     op = NULL;
-    if (muops) {
-        for (i = 0; i < num_muops; i++) {
-            if (ldb_dn_compare(parent, muops[i].dn) == 0) {
-                op = &muops[i];
-                break;
-            }
+    if (*_muop_index == NULL) {
+        ret = hash_create_ex(0, _muop_index, 0, 0, 0, 0,
+                             hash_alloc, hash_free, memctx, NULL, NULL);
+        if (ret != HASH_SUCCESS) {
+            return LDB_ERR_OPERATIONS_ERROR;
+        }
+    } else {
+        ret = hash_lookup(*_muop_index, &key, &value);
+        if (ret == HASH_SUCCESS) {
+            op = &muops[value.i];
+        } else if (ret != HASH_ERROR_KEY_NOT_FOUND) {
+            return LDB_ERR_OPERATIONS_ERROR;
         }
     }
     if (!op) {
@@ -256,12 +716,21 @@ static int mbof_append_muop(TALLOC_CTX *memctx,
             return LDB_ERR_OPERATIONS_ERROR;
         }
         op = &muops[num_muops];
-        num_muops++;
         *_muops = muops;
-        *_num_muops = num_muops;
 
         op->dn = parent;
         op->el = NULL;
+        op->values = NULL;
+
+        value.type = HASH_VALUE_INT;
+        value.i = num_muops;
+        ret = hash_enter(*_muop_index, &key, &value);
+        if (ret != HASH_SUCCESS) {
+            return LDB_ERR_OPERATIONS_ERROR;
+        }
+
+        num_muops++;
+        *_num_muops = num_muops;
     }
 
     if (!op->el) {
@@ -274,15 +743,21 @@ static int mbof_append_muop(TALLOC_CTX *memctx,
             return LDB_ERR_OPERATIONS_ERROR;
         }
         op->el->flags = flags;
-    }
 
-    for (i = 0; i < op->el->num_values; i++) {
-        if (strcmp((char *)op->el->values[i].data, name) == 0) {
-            /* we already have this value, get out*/
-            return LDB_SUCCESS;
+        ret = hash_create_ex(0, &op->values, 0, 0, 0, 0,
+                             hash_alloc, hash_free, op->el, NULL, NULL);
+        if (ret != HASH_SUCCESS) {
+            return LDB_ERR_OPERATIONS_ERROR;
         }
     }
 
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+    if (hash_has_key(op->values, &key)) {
+        /* we already have this value, get out*/
+        return LDB_SUCCESS;
+    }
+
     val = talloc_realloc(op->el, op->el->values,
                          struct ldb_val, op->el->num_values + 1);
     if (!val) {
@@ -295,6 +770,14 @@ static int mbof_append_muop(TALLOC_CTX *memctx,
     val[op->el->num_values].length = strlen(name);
 
     op->el->values = val;
+
+    value.type = HASH_VALUE_INT;
+    value.i = op->el->num_values;
+    ret = hash_enter(op->values, &key, &value);
+    if (ret != HASH_SUCCESS) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
+
     op->el->num_values++;
 
     return LDB_SUCCESS;
@@ -346,25 +829,28 @@ static int mbof_append_addop(struct mbof_add_ctx *add_ctx,
                              struct mbof_dn_array *parents,
                              struct ldb_dn *entry_dn)
 {
-    struct mbof_add_operation *lastop = NULL;
     struct mbof_add_operation *addop;
+    hash_value_t value;
+    hash_key_t key;
+    int ret;
 
     /* test if this is a duplicate */
-    /* FIXME: this is not efficient */
-    if (add_ctx->add_list) {
-        do {
-            if (lastop) {
-                lastop = lastop->next;
-            } else {
-                lastop = add_ctx->add_list;
-            }
+    /* FIXME: check if this is right, might have to compare parents */
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(entry_dn));
+    if (!key.str) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
 
-            /* FIXME: check if this is right, might have to compare parents */
-            if (ldb_dn_compare(lastop->entry_dn, entry_dn) == 0) {
-                /* duplicate found */
-                return LDB_SUCCESS;
-            }
-        } while (lastop->next);
+    if (add_ctx->addop_index == NULL) {
+        ret = hash_create_ex(0, &add_ctx->addop_index, 0, 0, 0, 0,
+                             hash_alloc, hash_free, add_ctx, NULL, NULL);
+        if (ret != HASH_SUCCESS) {
+            return LDB_ERR_OPERATIONS_ERROR;
+        }
+    } else if (hash_has_key(add_ctx->addop_index, &key)) {
+        /* duplicate found */
+        return LDB_SUCCESS;
     }
 
     addop = talloc_zero(add_ctx, struct mbof_add_operation);
@@ -376,11 +862,19 @@ static int mbof_append_addop(struct mbof_add_ctx *add_ctx,
     addop->parents = parents;
     addop->entry_dn = entry_dn;
 
-    if (add_ctx->add_list) {
-        lastop->next = addop;
+    value.type = HASH_VALUE_PTR;
+    value.ptr = addop;
+    ret = hash_enter(add_ctx->addop_index, &key, &value);
+    if (ret != HASH_SUCCESS) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
+
+    if (add_ctx->add_tail) {
+        add_ctx->add_tail->next = addop;
     } else {
         add_ctx->add_list = addop;
     }
+    add_ctx->add_tail = addop;
 
     return LDB_SUCCESS;
 }
@@ -423,6 +917,7 @@ static int mbof_add_fill_ghop_ex(struct mbof_add_ctx *add_ctx,
         for (j = 0; j < num_gh_vals; j++) {
             ret = mbof_append_muop(add_ctx, &add_ctx->muops,
                                    &add_ctx->num_muops,
+                                   &add_ctx->muop_index,
                                    LDB_FLAG_MOD_ADD,
                                    parents->dns[i],
                                    (const char *) ghvals[j].data,
@@ -445,6 +940,11 @@ static int mbof_next_add(struct mbof_add_operation *addop);
 static int mbof_next_add_callback(struct ldb_request *req,
                                   struct ldb_reply *ares);
 static int mbof_add_operation(struct mbof_add_operation *addop);
+static int mbof_add_new_parents(struct mbof_add_operation *addop,
+                                const struct ldb_message *entry,
+                                struct mbof_dn_array **_parents);
+static int mbof_add_apply(struct mbof_add_operation *addop,
+                          struct mbof_dn_array *parents);
 static int mbof_add_fill_ghop(struct mbof_add_ctx *add_ctx,
                               struct ldb_message *entry,
                               struct mbof_dn_array *parents);
@@ -456,6 +956,31 @@ static int mbof_add_muop(struct mbof_add_ctx *add_ctx);
 static int mbof_add_muop_callback(struct ldb_request *req,
                                   struct ldb_reply *ares);
 
+/* New records of compact caches need the GUID they are keyed by */
+static int mbof_add_guid(struct ldb_module *module, struct ldb_message *msg)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+    uint8_t guid[SSS_UNIQUE_ID_SIZE];
+    struct ldb_val val;
+    int ret;
+
+    if (priv->guid_attr == NULL
+            || ldb_msg_find_element(msg, priv->guid_attr) != NULL) {
+        return LDB_SUCCESS;
+    }
+
+    sss_unique_id(guid);
+    val.data = guid;
+    val.length = sizeof(guid);
+
+    ret = ldb_msg_add_empty(msg, priv->guid_attr, 0, NULL);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
+    return ldb_msg_add_value(msg, priv->guid_attr, &val, NULL);
+}
+
 static int memberof_add(struct ldb_module *module, struct ldb_request *req)
 {
     struct ldb_context *ldb = ldb_module_get_ctx(module);
@@ -475,7 +1000,7 @@ static int memberof_add(struct ldb_module *module, struct ldb_request *req)
         }
 
         /* do not manipulate other control entries */
-        return ldb_next_request(module, req);
+        return mbof_next_request(module, req);
     }
 
     /* check if memberof is specified */
@@ -494,6 +1019,13 @@ static int memberof_add(struct ldb_module *module, struct ldb_request *req)
         return LDB_ERR_UNWILLING_TO_PERFORM;
     }
 
+    /* a new group changes the groups of its members only */
+    if (mbof_gen_needed(module, req, req->op.add.message->dn)
+            && ldb_msg_find_element(req->op.add.message, DB_MEMBER)) {
+        return mbof_gen_start(module, req, req->op.add.message->dn, true,
+                              memberof_add);
+    }
+
     ctx = mbof_init(module, req);
     if (!ctx) {
         return LDB_ERR_OPERATIONS_ERROR;
@@ -511,6 +1043,11 @@ static int memberof_add(struct ldb_module *module, struct ldb_request *req)
     }
     add_ctx->msg_dn = add_ctx->msg->dn;
 
+    ret = mbof_add_guid(module, add_ctx->msg);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
     /* continue with normal ops if there are no members */
     el = ldb_msg_find_element(add_ctx->msg, DB_MEMBER);
     if (!el) {
@@ -559,7 +1096,7 @@ done:
         return ret;
     }
 
-    return ldb_next_request(module, add_req);
+    return mbof_next_request(module, add_req);
 }
 
 static int mbof_add_callback(struct ldb_request *req,
@@ -642,6 +1179,8 @@ static int mbof_next_add(struct mbof_add_operation *addop)
     static const char *attrs[] = { DB_OC, DB_NAME,
                                    DB_MEMBER, DB_GHOST,
                                    DB_MEMBEROF, NULL };
+    const struct ldb_message *entry;
+    struct mbof_dn_array *parents;
     struct ldb_context *ldb;
     struct ldb_request *req;
     struct mbof_add_ctx *add_ctx;
@@ -652,6 +1191,45 @@ static int mbof_next_add(struct mbof_add_operation *addop)
     ctx = add_ctx->ctx;
     ldb = ldb_module_get_ctx(ctx->module);
 
+    /* Groups already read in this transaction are taken from the graph.
+     * The ones that already have all the parents are skipped here in a
+     * loop, so long chains of them do not recurse */
+    while ((entry = mbof_graph_lookup(ctx->module, addop->entry_dn))) {
+
+        /* mark the operation as being handled */
+        add_ctx->current_op = addop;
+
+        ret = mbof_add_new_parents(addop, entry, &parents);
+        if (ret != LDB_SUCCESS) {
+            return ret;
+        }
+
+        if (parents->num > 0) {
+            addop->entry = ldb_msg_copy(addop, entry);
+            if (!addop->entry) {
+                return LDB_ERR_OPERATIONS_ERROR;
+            }
+            return mbof_add_apply(addop, parents);
+        }
+        talloc_free(parents);
+
+        if (!addop->next) {
+            /* no more operations */
+            if (add_ctx->missing) {
+                return mbof_add_cleanup(add_ctx);
+            }
+            if (add_ctx->muops) {
+                return mbof_add_muop(add_ctx);
+            }
+            /* that was the last entry, get out */
+            return ldb_module_done(ctx->req,
+                                   ctx->ret_ctrls,
+                                   ctx->ret_resp,
+                                   LDB_SUCCESS);
+        }
+        addop = addop->next;
+    }
+
     /* mark the operation as being handled */
     add_ctx->current_op = addop;
 
@@ -749,6 +1327,8 @@ static int mbof_next_add_callback(struct ldb_request *req,
             }
         }
         else {
+            mbof_graph_store(ctx->module, addop->entry);
+
             ret = mbof_add_operation(addop);
             if (ret != LDB_SUCCESS) {
                 return ldb_module_done(ctx->req, NULL, NULL, ret);
@@ -761,29 +1341,21 @@ static int mbof_next_add_callback(struct ldb_request *req,
     return LDB_SUCCESS;
 }
 
-/* if it is a group, add all members for cascade effect
- * add memberof attribute to this entry
- */
-static int mbof_add_operation(struct mbof_add_operation *addop)
+/* compute which parents are still missing from the entry memberof list */
+static int mbof_add_new_parents(struct mbof_add_operation *addop,
+                                const struct ldb_message *entry,
+                                struct mbof_dn_array **_parents)
 {
-
     TALLOC_CTX *tmp_ctx;
-    struct mbof_ctx *ctx;
     struct mbof_add_ctx *add_ctx;
     struct ldb_context *ldb;
     struct ldb_message_element *el;
-    struct ldb_request *mod_req;
-    struct ldb_message *msg;
     struct ldb_dn *elval_dn;
-    struct ldb_dn *valdn;
     struct mbof_dn_array *parents;
-    int i, j, ret;
-    const char *val;
-    const char *name;
+    int i, j;
 
     add_ctx = addop->add_ctx;
-    ctx = add_ctx->ctx;
-    ldb = ldb_module_get_ctx(ctx->module);
+    ldb = ldb_module_get_ctx(add_ctx->ctx->module);
 
     parents = talloc_zero(add_ctx, struct mbof_dn_array);
     if (!parents) {
@@ -793,6 +1365,7 @@ static int mbof_add_operation(struct mbof_add_operation *addop)
     parents->dns = talloc_array(parents, struct ldb_dn *,
                                 addop->parents->num);
     if (!parents->dns) {
+        talloc_free(parents);
         return LDB_ERR_OPERATIONS_ERROR;
     }
 
@@ -807,18 +1380,22 @@ static int mbof_add_operation(struct mbof_add_operation *addop)
     }
 
     /* remove entries that are already there */
-    el = ldb_msg_find_element(addop->entry, DB_MEMBEROF);
+    el = ldb_msg_find_element(entry, DB_MEMBEROF);
     if (el) {
 
         tmp_ctx = talloc_new(addop);
-        if (!tmp_ctx) return LDB_ERR_OPERATIONS_ERROR;
+        if (!tmp_ctx) {
+            talloc_free(parents);
+            return LDB_ERR_OPERATIONS_ERROR;
+        }
 
-        for (i = 0; i < el->num_values; i++) {
+        for (i = 0; i < el->num_values && parents->num > 0; i++) {
             elval_dn = ldb_dn_from_ldb_val(tmp_ctx, ldb, &el->values[i]);
             if (!elval_dn) {
                 ldb_debug(ldb, LDB_DEBUG_TRACE, "Invalid DN in memberof [%s]",
                                             (const char *)el->values[i].data);
                 talloc_free(tmp_ctx);
+                talloc_free(parents);
                 return LDB_ERR_OPERATIONS_ERROR;
             }
             for (j = 0; j < parents->num; j++) {
@@ -836,29 +1413,73 @@ static int mbof_add_operation(struct mbof_add_operation *addop)
             }
         }
 
-        if (parents->num == 0) {
-            /* already contains all parents as memberof, skip to next */
-            talloc_free(tmp_ctx);
-            talloc_free(addop->entry);
-            addop->entry = NULL;
+        talloc_free(tmp_ctx);
+    }
 
-            if (addop->next) {
-                return mbof_next_add(addop->next);
-            }
-            else if (add_ctx->muops) {
-                return mbof_add_muop(add_ctx);
-            }
-            else {
-                /* that was the last entry, get out */
-                return ldb_module_done(ctx->req,
-                                       ctx->ret_ctrls,
-                                       ctx->ret_resp,
-                                       LDB_SUCCESS);
-            }
+    *_parents = parents;
+    return LDB_SUCCESS;
+}
+
+/* if it is a group, add all members for cascade effect
+ * add memberof attribute to this entry
+ */
+static int mbof_add_operation(struct mbof_add_operation *addop)
+{
+    struct mbof_ctx *ctx;
+    struct mbof_add_ctx *add_ctx;
+    struct mbof_dn_array *parents;
+    int ret;
+
+    add_ctx = addop->add_ctx;
+    ctx = add_ctx->ctx;
+
+    ret = mbof_add_new_parents(addop, addop->entry, &parents);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
+    if (parents->num == 0) {
+        /* already contains all parents as memberof, skip to next */
+        talloc_free(parents);
+        talloc_free(addop->entry);
+        addop->entry = NULL;
+
+        if (addop->next) {
+            return mbof_next_add(addop->next);
+        }
+        else if (add_ctx->muops) {
+            return mbof_add_muop(add_ctx);
+        }
+        else {
+            /* that was the last entry, get out */
+            return ldb_module_done(ctx->req,
+                                   ctx->ret_ctrls,
+                                   ctx->ret_resp,
+                                   LDB_SUCCESS);
         }
-        talloc_free(tmp_ctx);
     }
 
+    return mbof_add_apply(addop, parents);
+}
+
+static int mbof_add_apply(struct mbof_add_operation *addop,
+                          struct mbof_dn_array *parents)
+{
+    struct mbof_ctx *ctx;
+    struct mbof_add_ctx *add_ctx;
+    struct ldb_context *ldb;
+    struct ldb_message_element *el;
+    struct ldb_request *mod_req;
+    struct ldb_message *msg;
+    struct ldb_dn *valdn;
+    int i, j, ret;
+    const char *val;
+    const char *name;
+
+    add_ctx = addop->add_ctx;
+    ctx = add_ctx->ctx;
+    ldb = ldb_module_get_ctx(ctx->module);
+
     /* if it is a group add all members */
     el = ldb_msg_find_element(addop->entry, DB_MEMBER);
     if (el) {
@@ -895,6 +1516,7 @@ static int mbof_add_operation(struct mbof_add_operation *addop)
         for (i = 0; i < parents->num; i++) {
             ret = mbof_append_muop(add_ctx, &add_ctx->muops,
                                    &add_ctx->num_muops,
+                                   &add_ctx->muop_index,
                                    LDB_FLAG_MOD_ADD,
                                    parents->dns[i], name,
                                    DB_MEMBERUID);
@@ -958,7 +1580,7 @@ static int mbof_add_operation(struct mbof_add_operation *addop)
     }
     talloc_steal(mod_req, msg);
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_add_fill_ghop(struct mbof_add_ctx *add_ctx,
@@ -1048,7 +1670,7 @@ static int mbof_add_cleanup(struct mbof_add_ctx *add_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_add_cleanup_callback(struct ldb_request *req,
@@ -1137,7 +1759,7 @@ static int mbof_add_muop(struct mbof_add_ctx *add_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_add_muop_callback(struct ldb_request *req,
@@ -1291,6 +1913,8 @@ static int mbof_del_exop_search_callback(struct ldb_request *req,
                                          struct ldb_reply *ares);
 static int mbof_del_execute_cont(struct mbof_del_operation *delop);
 static int mbof_del_ancestors(struct mbof_del_operation *delop);
+static int mbof_del_anc_merge(struct mbof_del_operation *delop,
+                              const struct ldb_message *entry);
 static int mbof_del_anc_callback(struct ldb_request *req,
                                  struct ldb_reply *ares);
 static int mbof_del_mod_entry(struct mbof_del_operation *delop);
@@ -1330,7 +1954,12 @@ static int memberof_del(struct ldb_module *module, struct ldb_request *req)
 
     if (ldb_dn_is_special(req->op.del.dn)) {
         /* do not manipulate our control entries */
-        return ldb_next_request(module, req);
+        return mbof_next_request(module, req);
+    }
+
+    if (mbof_gen_needed(module, req, req->op.del.dn)) {
+        return mbof_gen_start(module, req, req->op.del.dn, false,
+                              memberof_del);
     }
 
     ctx = mbof_init(module, req);
@@ -1494,7 +2123,7 @@ static int mbof_orig_del(struct mbof_del_ctx *del_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, del_req);
+    return mbof_next_request(ctx->module, del_req);
 }
 
 static int mbof_orig_del_callback(struct ldb_request *req,
@@ -1624,7 +2253,7 @@ static int mbof_del_cleanup_parents(struct mbof_del_ctx *del_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_del_clean_par_callback(struct ldb_request *req,
@@ -1770,8 +2399,10 @@ static int mbof_del_execute_op(struct mbof_del_operation *delop)
     char *expression;
     const char *dn;
     char *clean_dn;
+    /* ghost is only asked for so that parents can go to the graph */
     static const char *attrs[] = { DB_OC, DB_NAME,
-                                   DB_MEMBER, DB_MEMBEROF, NULL };
+                                   DB_MEMBER, DB_MEMBEROF,
+                                   DB_GHOST, NULL };
     int ret;
 
     del_ctx = delop->del_ctx;
@@ -1871,6 +2502,8 @@ static int mbof_del_exop_search_callback(struct ldb_request *req,
             }
             delop->parents[delop->num_parents] = msg;
             delop->num_parents++;
+
+            mbof_graph_store(ctx->module, msg);
         }
         break;
     case LDB_REPLY_REFERRAL:
@@ -1954,7 +2587,10 @@ static int mbof_del_ancestors(struct mbof_del_operation *delop)
     struct mbof_ctx *ctx;
     struct ldb_context *ldb;
     struct mbof_dn_array *new_list;
-    static const char *attrs[] = { DB_MEMBEROF, NULL };
+    const struct ldb_message *entry;
+    static const char *attrs[] = { DB_OC, DB_NAME,
+                                   DB_MEMBER, DB_GHOST,
+                                   DB_MEMBEROF, NULL };
     struct ldb_request *search;
     int ret;
 
@@ -1964,6 +2600,26 @@ static int mbof_del_ancestors(struct mbof_del_operation *delop)
     anc_ctx = delop->anc_ctx;
     new_list = anc_ctx->new_list;
 
+    /* the direct parents are usually shared by many members of the deleted
+     * group, use the graph for the ones that were read already */
+    while (anc_ctx->cur < anc_ctx->num_direct) {
+        entry = mbof_graph_lookup(ctx->module, new_list->dns[anc_ctx->cur]);
+        if (!entry) {
+            break;
+        }
+
+        ret = mbof_del_anc_merge(delop, entry);
+        if (ret != LDB_SUCCESS) {
+            return ret;
+        }
+        anc_ctx->cur++;
+    }
+
+    if (anc_ctx->cur >= anc_ctx->num_direct) {
+        /* all known, proceed to modify the entry */
+        return mbof_del_mod_entry(delop);
+    }
+
     ret = ldb_build_search_req(&search, ldb, anc_ctx,
                                new_list->dns[anc_ctx->cur],
                                LDB_SCOPE_BASE, NULL, attrs, NULL,
@@ -1976,6 +2632,55 @@ static int mbof_del_ancestors(struct mbof_del_operation *delop)
     return ldb_request(ldb, search);
 }
 
+/* add the memberof list of a direct parent to the new memberof list */
+static int mbof_del_anc_merge(struct mbof_del_operation *delop,
+                              const struct ldb_message *entry)
+{
+    struct mbof_dn_array *new_list;
+    const struct ldb_message_element *el;
+    struct ldb_context *ldb;
+    struct ldb_dn *valdn;
+    int i, j;
+
+    ldb = ldb_module_get_ctx(delop->del_ctx->ctx->module);
+    new_list = delop->anc_ctx->new_list;
+
+    el = ldb_msg_find_element(entry, DB_MEMBEROF);
+    if (!el) {
+        return LDB_SUCCESS;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        valdn = ldb_dn_from_ldb_val(new_list, ldb, &el->values[i]);
+        if (!valdn) {
+            ldb_debug(ldb, LDB_DEBUG_TRACE,
+                           "Invalid dn for memberof: (%s)",
+                           (const char *)el->values[i].data);
+            return LDB_ERR_OPERATIONS_ERROR;
+        }
+        for (j = 0; j < new_list->num; j++) {
+            if (ldb_dn_compare(valdn, new_list->dns[j]) == 0)
+                break;
+        }
+        if (j < new_list->num) {
+            talloc_free(valdn);
+            continue;
+        }
+
+        new_list->dns = talloc_realloc(new_list,
+                                       new_list->dns,
+                                       struct ldb_dn *,
+                                       new_list->num + 1);
+        if (!new_list->dns) {
+            return LDB_ERR_OPERATIONS_ERROR;
+        }
+        new_list->dns[new_list->num] = valdn;
+        new_list->num++;
+    }
+
+    return LDB_SUCCESS;
+}
+
 static int mbof_del_anc_callback(struct ldb_request *req,
                                  struct ldb_reply *ares)
 {
@@ -1985,17 +2690,13 @@ static int mbof_del_anc_callback(struct ldb_request *req,
     struct mbof_ctx *ctx;
     struct ldb_context *ldb;
     struct ldb_message *msg;
-    const struct ldb_message_element *el;
-    struct mbof_dn_array *new_list;
-    struct ldb_dn *valdn;
-    int i, j, ret;
+    int ret;
 
     delop = talloc_get_type(req->context, struct mbof_del_operation);
     del_ctx = delop->del_ctx;
     ctx = del_ctx->ctx;
     ldb = ldb_module_get_ctx(ctx->module);
     anc_ctx = delop->anc_ctx;
-    new_list = anc_ctx->new_list;
 
     if (!ares) {
         return ldb_module_done(ctx->req, NULL, NULL,
@@ -2038,38 +2739,12 @@ static int mbof_del_anc_callback(struct ldb_request *req,
                                    LDB_ERR_OPERATIONS_ERROR);
         }
 
-        /* check entry */
-        el = ldb_msg_find_element(anc_ctx->entry, DB_MEMBEROF);
-        if (el) {
-            for (i = 0; i < el->num_values; i++) {
-                valdn = ldb_dn_from_ldb_val(new_list, ldb, &el->values[i]);
-                if (!valdn) {
-                    ldb_debug(ldb, LDB_DEBUG_TRACE,
-                                   "Invalid dn for memberof: (%s)",
-                                   (const char *)el->values[i].data);
-                    return ldb_module_done(ctx->req, NULL, NULL,
-                                           LDB_ERR_OPERATIONS_ERROR);
-                }
-                for (j = 0; j < new_list->num; j++) {
-                    if (ldb_dn_compare(valdn, new_list->dns[j]) == 0)
-                        break;
-                }
-                if (j < new_list->num) {
-                    talloc_free(valdn);
-                    continue;
-                }
+        mbof_graph_store(ctx->module, anc_ctx->entry);
 
-                new_list->dns = talloc_realloc(new_list,
-                                               new_list->dns,
-                                               struct ldb_dn *,
-                                               new_list->num + 1);
-                if (!new_list->dns) {
-                    return ldb_module_done(ctx->req, NULL, NULL,
-                                           LDB_ERR_OPERATIONS_ERROR);
-                }
-                new_list->dns[new_list->num] = valdn;
-                new_list->num++;
-            }
+        /* check entry */
+        ret = mbof_del_anc_merge(delop, anc_ctx->entry);
+        if (ret != LDB_SUCCESS) {
+            return ldb_module_done(ctx->req, NULL, NULL, ret);
         }
 
         /* done with this one */
@@ -2233,6 +2908,7 @@ static int mbof_del_mod_entry(struct mbof_del_operation *delop)
         for (i = 0; diff[i]; i++) {
             ret = mbof_append_muop(del_ctx, &del_ctx->muops,
                                    &del_ctx->num_muops,
+                                   &del_ctx->muop_index,
                                    LDB_FLAG_MOD_DELETE,
                                    diff[i], name,
                                    DB_MEMBERUID);
@@ -2252,7 +2928,7 @@ static int mbof_del_mod_entry(struct mbof_del_operation *delop)
     }
     talloc_steal(mod_req, msg);
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_del_mod_callback(struct ldb_request *req,
@@ -2481,6 +3157,7 @@ static int mbof_del_fill_muop(struct mbof_del_ctx *del_ctx,
 
         ret = mbof_append_muop(del_ctx, &del_ctx->muops,
                                &del_ctx->num_muops,
+                               &del_ctx->muop_index,
                                LDB_FLAG_MOD_DELETE,
                                valdn, name,
                                DB_MEMBERUID);
@@ -2548,6 +3225,7 @@ static int mbof_del_fill_ghop_ex(struct mbof_del_ctx *del_ctx,
         for (j = 0; j < num_gh_vals; j++) {
             ret = mbof_append_muop(del_ctx, &del_ctx->ghops,
                                    &del_ctx->num_ghops,
+                                   &del_ctx->ghop_index,
                                    LDB_FLAG_MOD_DELETE,
                                    valdn,
                                    (const char *) ghvals[j].data,
@@ -2604,7 +3282,7 @@ static int mbof_del_muop(struct mbof_del_ctx *del_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_del_muop_callback(struct ldb_request *req,
@@ -2720,7 +3398,7 @@ static int mbof_del_ghop(struct mbof_del_ctx *del_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_del_ghop_callback(struct ldb_request *req,
@@ -2874,12 +3552,12 @@ static int memberof_mod(struct ldb_module *module, struct ldb_request *req)
 
     if (getenv("SSSD_UPGRADE_DB")) {
         /* do not do anything during upgrade */
-        return ldb_next_request(module, req);
+        return mbof_next_request(module, req);
     }
 
     if (ldb_dn_is_special(req->op.mod.message->dn)) {
         /* do not manipulate our control entries */
-        return ldb_next_request(module, req);
+        return mbof_next_request(module, req);
     }
 
     /* check if memberof is specified */
@@ -2898,6 +3576,15 @@ static int memberof_mod(struct ldb_module *module, struct ldb_request *req)
         return LDB_ERR_UNWILLING_TO_PERFORM;
     }
 
+    /* ghost users are not entries of the cache */
+    if (mbof_gen_needed(module, req, req->op.mod.message->dn)
+            && mbof_mod_changes_group(req->op.mod.message)) {
+        return mbof_gen_start(module, req, req->op.mod.message->dn,
+                              ldb_msg_find_element(req->op.mod.message,
+                                                   DB_MEMBER) != NULL,
+                              memberof_mod);
+    }
+
     ctx = mbof_init(module, req);
     if (!ctx) {
         return LDB_ERR_OPERATIONS_ERROR;
@@ -3184,7 +3871,7 @@ static int mbof_orig_mod(struct mbof_mod_ctx *mod_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_orig_mod_callback(struct ldb_request *req,
@@ -3325,7 +4012,7 @@ static int mbof_inherited_mod(struct mbof_mod_ctx *mod_ctx)
         return ret;
     }
 
-    return ldb_next_request(ctx->module, mod_req);
+    return mbof_next_request(ctx->module, mod_req);
 }
 
 static int mbof_inherited_mod_callback(struct ldb_request *req,
@@ -4498,7 +5185,7 @@ static int mbof_rcmp_update(struct mbof_rcmp_context *ctx)
     talloc_steal(req, msg);
 
     /* fire next call */
-    return ldb_next_request(ctx->module, req);
+    return mbof_next_request(ctx->module, req);
 
 done:
     /* all users and groups have been processed */
@@ -4549,13 +5236,134 @@ static int mbof_rcmp_mod_callback(struct ldb_request *req,
 
 
 
+/* transactions */
+
+static int memberof_start_transaction(struct ldb_module *module)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+    int ret;
+
+    ret = ldb_next_start_trans(module);
+    if (ret != LDB_SUCCESS) {
+        return ret;
+    }
+
+    mbof_graph_flush(module);
+    priv->in_transaction = true;
+    priv->gen_replaced = false;
+
+    return LDB_SUCCESS;
+}
+
+static int memberof_end_transaction(struct ldb_module *module)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+
+    /* other processes may change the database once we let go of it */
+    mbof_graph_flush(module);
+    priv->in_transaction = false;
+    priv->gen_replaced = false;
+
+    return ldb_next_end_trans(module);
+}
+
+static int memberof_del_transaction(struct ldb_module *module)
+{
+    struct mbof_private *priv = mbof_get_private(module);
+
+    mbof_graph_flush(module);
+    priv->in_transaction = false;
+    priv->gen_replaced = false;
+
+    return ldb_next_del_trans(module);
+}
+
+static int memberof_rename(struct ldb_module *module, struct ldb_request *req)
+{
+    if (mbof_gen_needed(module, req, req->op.rename.olddn)) {
+        return mbof_gen_start(module, req, req->op.rename.olddn, false,
+                              memberof_rename);
+    }
+
+    return mbof_next_request(module, req);
+}
+
+
 /* module init code */
 
+/* Reads the attribute the records are keyed by from @INDEXLIST, caches
+ * are converted with the connection closed, so this is read only once */
+static int mbof_load_guid_attr(struct ldb_module *module,
+                               struct mbof_private *priv)
+{
+    static const char *attrs[] = { "@IDXGUID", NULL };
+    struct ldb_context *ldb = ldb_module_get_ctx(module);
+    struct ldb_request *req;
+    struct ldb_result *res;
+    struct ldb_dn *dn;
+    const char *attr;
+    TALLOC_CTX *tmp_ctx;
+    int ret;
+
+    tmp_ctx = talloc_new(priv);
+    if (tmp_ctx == NULL) {
+        return LDB_ERR_OPERATIONS_ERROR;
+    }
+
+    dn = ldb_dn_new(tmp_ctx, ldb, "@INDEXLIST");
+    res = talloc_zero(tmp_ctx, struct ldb_result);
+    if (dn == NULL || res == NULL) {
+        ret = LDB_ERR_OPERATIONS_ERROR;
+        goto done;
+    }
+
+    ret = ldb_build_search_req(&req, ldb, tmp_ctx, dn, LDB_SCOPE_BASE,
+                               NULL, attrs, NULL, res,
+                               ldb_search_default_callback, NULL);
+    if (ret != LDB_SUCCESS) {
+        goto done;
+    }
+
+    ret = ldb_next_request(module, req);
+    if (ret == LDB_SUCCESS) {
+        ret = ldb_wait(req->handle, LDB_WAIT_ALL);
+    }
+    if (ret == LDB_ERR_NO_SUCH_OBJECT) {
+        /* empty database, not indexed yet */
+        ret = LDB_SUCCESS;
+        goto done;
+    } else if (ret != LDB_SUCCESS) {
+        goto done;
+    }
+
+    if (res->count == 1) {
+        attr = ldb_msg_find_attr_as_string(res->msgs[0], "@IDXGUID", NULL);
+        if (attr != NULL) {
+            priv->guid_attr = talloc_strdup(priv, attr);
+            if (priv->guid_attr == NULL) {
+                ret = LDB_ERR_OPERATIONS_ERROR;
+                goto done;
+            }
+        }
+    }
+
+    ret = LDB_SUCCESS;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 static int memberof_init(struct ldb_module *module)
 {
     struct ldb_context *ldb = ldb_module_get_ctx(module);
+    struct mbof_private *priv;
     int ret;
 
+    priv = talloc_zero(module, struct mbof_private);
+    if (priv == NULL) return LDB_ERR_OPERATIONS_ERROR;
+    ldb_module_set_private(module, priv);
+
     /* set syntaxes for member and memberof so that comparisons in filters and
      * such are done right */
     ret = ldb_schema_attribute_add(ldb, DB_MEMBER, 0, LDB_SYNTAX_DN);
@@ -4564,7 +5372,10 @@ static int memberof_init(struct ldb_module *module)
     ret = ldb_schema_attribute_add(ldb, DB_MEMBEROF, 0, LDB_SYNTAX_DN);
     if (ret != 0) return LDB_ERR_OPERATIONS_ERROR;
 
-    return ldb_next_init(module);
+    ret = ldb_next_init(module);
+    if (ret != LDB_SUCCESS) return ret;
+
+    return mbof_load_guid_attr(module, priv);
 }
 
 const struct ldb_module_ops ldb_memberof_module_ops = {
@@ -4573,6 +5384,10 @@ const struct ldb_module_ops ldb_memberof_module_ops = {
     .add = memberof_add,
     .modify = memberof_mod,
     .del = memberof_del,
+    .rename = memberof_rename,
+    .start_transaction = memberof_start_transaction,
+    .end_transaction = memberof_end_transaction,
+    .del_transaction = memberof_del_transaction,
 };
 
 int ldb_init_module(const char *version)
@@ -41,6 +41,8 @@
 #include "confdb/confdb_setup.h"
 #include "db/sysdb.h"
 #include "sss_iface/sss_iface_async.h"
+#include "responder/common/responder.h"
+#include "responder/common/negcache_shared.h"
 
 #ifdef HAVE_SYSTEMD
 #include <systemd/sd-daemon.h>
@@ -94,6 +96,9 @@ struct mt_svc {
     const char *busname;
     pid_t pid;
 
+    /* index of the instance if the service runs in several processes */
+    int instance;
+
     bool svc_started;
     bool socket_activated; /* also used for dbus-activated services */
 
@@ -123,6 +128,11 @@ struct mt_ctx {
     struct sbus_server *sbus_server;
     struct sbus_connection *sbus_conn;
 
+    /* number of NSS responder processes, they all accept clients on the
+     * listening socket nss_lfd created by the monitor */
+    int nss_instances;
+    int nss_lfd;
+
 #ifdef BUILD_CONF_SERVICE_USER_SUPPORT
     /* User to switch to in run time */
     uid_t uid;
@@ -137,11 +147,12 @@ static void monitor_service_shutdown(struct mt_svc *svc);
 static int service_signal_reset_offline(struct mt_svc *svc);
 
 static int get_service_config(struct mt_ctx *ctx, const char *name,
-                              struct mt_svc **svc_cfg);
+                              int instance, struct mt_svc **svc_cfg);
 static int get_provider_config(struct mt_ctx *ctx, const char *name,
                               struct mt_svc **svc_cfg);
 static int add_new_service(struct mt_ctx *ctx,
                            const char *name,
+                           int instance,
                            int restarts);
 static int add_new_provider(struct mt_ctx *ctx,
                             const char *name,
@@ -409,6 +420,7 @@ static int mark_service_as_started(struct mt_svc *svc)
     struct mt_svc *iter;
     int ret;
     int i;
+    int j;
 
     DEBUG(SSSDBG_FUNC_DATA, "Marking %s as started.\n", svc->name);
     svc->svc_started = true;
@@ -444,7 +456,15 @@ static int mark_service_as_started(struct mt_svc *svc)
             DEBUG(SSSDBG_CONF_SETTINGS, "Now starting services!\n");
             /* then start all services */
             for (i = 0; ctx->services[i]; i++) {
-                add_new_service(ctx, ctx->services[i], 0);
+                add_new_service(ctx, ctx->services[i], 0, 0);
+
+                if (strcasecmp(ctx->services[i], "nss") != 0) {
+                    continue;
+                }
+
+                for (j = 1; j < ctx->nss_instances; j++) {
+                    add_new_service(ctx, ctx->services[i], j, 0);
+                }
             }
         }
     }
@@ -882,6 +902,56 @@ static void get_debug_level(struct sss_ini *config)
     debug_level = sss_ini_get_int_config_value(config, 1, debug_level, NULL);
 }
 
+/* Read how many NSS responder processes should be started */
+static int get_nss_instances(struct mt_ctx *ctx)
+{
+    int ret;
+    int i;
+
+    ctx->nss_instances = 1;
+
+    if (ctx->services == NULL) {
+        return EOK;
+    }
+
+    for (i = 0; ctx->services[i] != NULL; i++) {
+        if (strcasecmp(ctx->services[i], "nss") == 0) {
+            break;
+        }
+    }
+
+    if (ctx->services[i] == NULL) {
+        return EOK;
+    }
+
+    ret = confdb_get_int(ctx->cdb, CONFDB_NSS_CONF_ENTRY,
+                         CONFDB_NSS_INSTANCES, 1, &ctx->nss_instances);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to get '"CONFDB_NSS_INSTANCES"' option from confdb.\n");
+        return ret;
+    }
+
+    if (ctx->nss_instances < 1) {
+        ctx->nss_instances = 1;
+    }
+
+#ifndef HAVE_SYSTEMD
+    /* the listening socket is passed the same way as by systemd socket
+     * activation */
+    if (ctx->nss_instances > 1) {
+        DEBUG(SSSDBG_CONF_SETTINGS,
+              "'"CONFDB_NSS_INSTANCES"' requires systemd support, "
+              "starting a single NSS responder\n");
+        ctx->nss_instances = 1;
+    }
+#endif
+
+    ctx->num_services += ctx->nss_instances - 1;
+
+    return EOK;
+}
+
 static int get_monitor_config(struct mt_ctx *ctx)
 {
     int ret;
@@ -928,6 +998,11 @@ static int get_monitor_config(struct mt_ctx *ctx)
         }
     }
 
+    ret = get_nss_instances(ctx);
+    if (ret != EOK) {
+        return ret;
+    }
+
     ret = confdb_expand_app_domains(ctx->cdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE, "Failed to expand application domains\n");
@@ -952,7 +1027,7 @@ static int get_monitor_config(struct mt_ctx *ctx)
 }
 
 static int get_service_config(struct mt_ctx *ctx, const char *name,
-                              struct mt_svc **svc_cfg)
+                              int instance, struct mt_svc **svc_cfg)
 {
     int ret;
     char *path;
@@ -976,7 +1051,13 @@ static int get_service_config(struct mt_ctx *ctx, const char *name,
         return ENOMEM;
     }
 
-    svc->identity = talloc_strdup(svc, name);
+    /* additional instances register under a name of their own */
+    svc->instance = instance;
+    if (instance == 0) {
+        svc->identity = talloc_strdup(svc, name);
+    } else {
+        svc->identity = talloc_asprintf(svc, "%s_%d", name, instance);
+    }
     if (!svc->identity) {
         talloc_free(svc);
         return ENOMEM;
@@ -1054,6 +1135,15 @@ static int get_service_config(struct mt_ctx *ctx, const char *name,
               svc->command, svc->name);
     }
 
+    if (instance != 0) {
+        svc->command = talloc_asprintf_append(svc->command,
+                                              " --instance=%d", instance);
+        if (!svc->command) {
+            talloc_free(svc);
+            return ENOMEM;
+        }
+    }
+
     svc->last_restart = now;
 
     *svc_cfg = svc;
@@ -1064,12 +1154,13 @@ static int get_service_config(struct mt_ctx *ctx, const char *name,
 
 static int add_new_service(struct mt_ctx *ctx,
                            const char *name,
+                           int instance,
                            int restarts)
 {
     int ret;
     struct mt_svc *svc;
 
-    ret = get_service_config(ctx, name, &svc);
+    ret = get_service_config(ctx, name, instance, &svc);
     if (ret != EOK) {
         return ret;
     }
@@ -1565,6 +1656,29 @@ static int monitor_process_init(struct mt_ctx *ctx)
     }
     talloc_zfree(tmp_ctx);
 
+    /* Responders share negative cache entries through this segment. It is
+     * recreated on every start so no stale entries are carried over. */
+    ret = sss_nc_shared_create(SSS_NC_SHARED_PATH);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to create the shared negative cache, responders will "
+              "use their own negative cache only\n");
+    }
+
+    /* All NSS responder processes accept clients on the same socket. It is
+     * kept open by the monitor so that restarted processes inherit it. */
+    if (ctx->nss_instances > 1) {
+        ret = create_pipe_fd(SSS_NSS_SOCKET_NAME, &ctx->nss_lfd,
+                             SCKT_RSP_UMASK);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Unable to create the NSS socket, starting a single NSS "
+                  "responder [%d]: %s\n", ret, sss_strerror(ret));
+            ctx->num_services -= ctx->nss_instances - 1;
+            ctx->nss_instances = 1;
+        }
+    }
+
     req = sbus_server_create_and_connect_send(ctx, ctx->ev, SSS_BUS_MONITOR,
                                               NULL, SSS_BUS_ADDRESS,
                                               false, 100, NULL, NULL);
@@ -1712,6 +1826,42 @@ static int start_service(struct mt_svc *svc)
     return EOK;
 }
 
+#ifdef HAVE_SYSTEMD
+/* Pass the listening socket @fd to the service that is going to be executed
+ * by this process the same way systemd passes activated sockets, so that
+ * activate_unix_sockets() picks it up. */
+static errno_t pass_listen_fd(int fd)
+{
+    char buf[32];
+    int ret;
+
+    if (fd != SD_LISTEN_FDS_START) {
+        ret = dup2(fd, SD_LISTEN_FDS_START);
+        if (ret == -1) {
+            return errno;
+        }
+    }
+
+    /* the descriptor was created with close-on-exec */
+    ret = fcntl(SD_LISTEN_FDS_START, F_SETFD, 0);
+    if (ret == -1) {
+        return errno;
+    }
+
+    snprintf(buf, sizeof(buf), "%d", (int)getpid());
+    if (setenv("LISTEN_PID", buf, 1) != 0 || setenv("LISTEN_FDS", "1", 1) != 0) {
+        return errno;
+    }
+
+    return EOK;
+}
+#else
+static errno_t pass_listen_fd(int fd)
+{
+    return ENOTSUP;
+}
+#endif
+
 static void mt_svc_exit_handler(int pid, int wait_status, void *pvt);
 static void service_startup_handler(struct tevent_context *ev,
                                     struct tevent_timer *te,
@@ -1775,6 +1925,18 @@ static void service_startup_handler(struct tevent_context *ev,
         }
     }
 
+    if (mt_svc->type == MT_SVC_SERVICE
+            && mt_svc->mt_ctx->nss_lfd != -1
+            && strcmp(mt_svc->name, "nss") == 0) {
+        ret = pass_listen_fd(mt_svc->mt_ctx->nss_lfd);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Unable to pass the NSS socket to [%s]\n",
+                  mt_svc->identity);
+            _exit(1);
+        }
+    }
+
     args = parse_args(mt_svc->command);
     execvp(args[0], args);
 
@@ -1808,7 +1970,8 @@ static void mt_svc_restart(struct tevent_context *ev,
                               svc->name, svc->restarts+1);
 
     if (svc->type == MT_SVC_SERVICE) {
-        add_new_service(svc->mt_ctx, svc->name, svc->restarts + 1);
+        add_new_service(svc->mt_ctx, svc->name, svc->instance,
+                        svc->restarts + 1);
     } else if (svc->type == MT_SVC_PROVIDER) {
         add_new_provider(svc->mt_ctx, svc->name, svc->restarts + 1);
     } else {
@@ -1964,6 +2127,8 @@ int main(int argc, const char *argv[])
         ret = 2;
         goto out;
     }
+    monitor->nss_instances = 1;
+    monitor->nss_lfd = -1;
     talloc_set_destructor((TALLOC_CTX *)monitor, monitor_ctx_destructor);
 
     struct poptOption long_options[] = {
@@ -404,6 +404,12 @@ static void dp_req_done(struct tevent_req *subreq)
                  "Handling request took %s.",
                  sss_format_time(get_spend_time_us(state->dp_req->start_time)));
 
+    /* The responder reads the timestamp cache as soon as it gets the reply */
+    if (state->dp_req->domain != NULL
+            && state->dp_req->domain->sysdb != NULL) {
+        sysdb_ts_buffer_flush(state->dp_req->domain->sysdb);
+    }
+
     if (ret != EOK) {
         tevent_req_error(req, ret);
         return;
@@ -448,6 +448,30 @@ static void dp_req_initgr_pp_set_initgr_timestamp(struct dp_initgr_ctx *ctx,
     }
 }
 
+static void dp_req_initgr_pp_closure_index(struct dp_initgr_ctx *ctx,
+                                           struct dp_reply_std *reply)
+{
+    errno_t ret;
+
+    if (reply->dp_error != DP_ERR_OK || reply->error != EOK) {
+        /* The groups of the user were not refreshed */
+        return;
+    }
+
+    if (ctx->filter_value == NULL) {
+        return;
+    }
+
+    /* The responders only read the index, it is rebuilt here once the
+     * groups of the user are saved */
+    ret = sysdb_initgr_closure_update(ctx->domain_info, ctx->filter_value);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Failed to update the initgroups closure index of [%s]\n",
+              ctx->filter_value);
+    }
+}
+
 
 struct dp_sr_resolve_groups_state {
     struct data_provider *provider;
@@ -840,6 +864,7 @@ static void dp_get_account_info_initgroups_resolv_done(struct tevent_req *subreq
     }
 
     dp_req_initgr_pp_set_initgr_timestamp(state->initgr_ctx, &state->reply);
+    dp_req_initgr_pp_closure_index(state->initgr_ctx, &state->reply);
     dp_req_initgr_pp_sr_overlay(state->provider, state->initgr_ctx);
 
     if (state->initgr_ctx->username != NULL) {
@@ -601,6 +601,7 @@ errno_t be_process_init(TALLOC_CTX *mem_ctx,
     struct tevent_signal *tes;
     struct be_ctx *be_ctx;
     char *str = NULL;
+    int ts_flush_interval;
     errno_t ret;
 
     be_ctx = talloc_zero(mem_ctx, struct be_ctx);
@@ -638,6 +639,23 @@ errno_t be_process_init(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    ret = confdb_get_int(cdb, be_ctx->conf_path,
+                         CONFDB_DOMAIN_TS_FLUSH_INTERVAL, 0,
+                         &ts_flush_interval);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to read %s\n",
+              CONFDB_DOMAIN_TS_FLUSH_INTERVAL);
+        goto done;
+    }
+
+    ret = sysdb_ts_buffer_init(be_ctx->domain->sysdb, ev,
+                               ts_flush_interval > 0 ? ts_flush_interval : 0);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Unable to set up the timestamp cache write buffer\n");
+        goto done;
+    }
+
     /* We need this for subdomains support, as they have to store fully
      * qualified user and group names for now. */
     ret = sss_names_init(be_ctx->domain, cdb, be_ctx->domain->name,
@@ -168,15 +168,16 @@ static int sdap_user_set_mpg(struct sysdb_attrs *user_attrs,
     return EOK;
 }
 
-/* FIXME: support storing additional attributes */
-int sdap_save_user(TALLOC_CTX *memctx,
-                   struct sdap_options *opts,
-                   struct sss_domain_info *dom,
-                   struct sysdb_attrs *attrs,
-                   struct sysdb_attrs *mapped_attrs,
-                   char **_usn_value,
-                   time_t now,
-                   bool set_non_posix)
+/* Converts the LDAP attributes of a user into the object stored in the
+ * cache of _dom. The object has no name if the user should be skipped. */
+static int sdap_prepare_user(TALLOC_CTX *memctx,
+                             struct sdap_options *opts,
+                             struct sss_domain_info *dom,
+                             struct sysdb_attrs *attrs,
+                             bool set_non_posix,
+                             struct sss_domain_info **_dom,
+                             struct sysdb_store_obj *_obj,
+                             char **_usn_value)
 {
     struct ldb_message_element *el;
     int ret;
@@ -192,7 +193,6 @@ int sdap_save_user(TALLOC_CTX *memctx,
     struct sysdb_attrs *user_attrs;
     char *upn = NULL;
     size_t i;
-    int cache_timeout;
     char *usn_value = NULL;
     char **missing = NULL;
     TALLOC_CTX *tmpctx = NULL;
@@ -205,7 +205,7 @@ int sdap_save_user(TALLOC_CTX *memctx,
     char *p2;
     bool is_posix = true;
 
-    DEBUG(SSSDBG_TRACE_FUNC, "Save user\n");
+    memset(_obj, 0, sizeof(struct sysdb_store_obj));
 
     tmpctx = talloc_new(NULL);
     if (!tmpctx) {
@@ -599,8 +599,6 @@ int sdap_save_user(TALLOC_CTX *memctx,
         }
     }
 
-    cache_timeout = dom->user_timeout;
-
     ret = sdap_save_all_names(user_name, attrs, dom,
                               SYSDB_MEMBER_USER, user_attrs);
     if (ret != EOK) {
@@ -617,23 +615,23 @@ int sdap_save_user(TALLOC_CTX *memctx,
         goto done;
     }
 
-    DEBUG(SSSDBG_TRACE_FUNC, "Storing info for user %s\n", user_name);
-
-    ret = sysdb_store_user(dom, user_name, pwd, uid, gid,
-                           gecos, homedir, shell, orig_dn,
-                           user_attrs, missing, cache_timeout, now);
-    if (ret) goto done;
-
-    if (mapped_attrs != NULL) {
-        ret = sysdb_set_user_attr(dom, user_name, mapped_attrs, SYSDB_MOD_ADD);
-        if (ret) return ret;
-    }
+    _obj->type = SYSDB_USER;
+    _obj->name = user_name;
+    _obj->pwd = pwd;
+    _obj->uid = uid;
+    _obj->gid = gid;
+    _obj->gecos = gecos;
+    _obj->homedir = homedir;
+    _obj->shell = shell;
+    _obj->orig_dn = orig_dn;
+    _obj->attrs = talloc_steal(memctx, user_attrs);
+    _obj->remove_attrs = missing;
 
+    *_dom = dom;
     if (_usn_value) {
         *_usn_value = talloc_steal(memctx, usn_value);
     }
 
-    talloc_steal(memctx, user_attrs);
     ret = EOK;
 
 done:
@@ -646,6 +644,54 @@ done:
     return ret;
 }
 
+/* FIXME: support storing additional attributes */
+int sdap_save_user(TALLOC_CTX *memctx,
+                   struct sdap_options *opts,
+                   struct sss_domain_info *dom,
+                   struct sysdb_attrs *attrs,
+                   struct sysdb_attrs *mapped_attrs,
+                   char **_usn_value,
+                   time_t now,
+                   bool set_non_posix)
+{
+    struct sysdb_store_obj obj;
+    char *usn_value = NULL;
+    int ret;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Save user\n");
+
+    ret = sdap_prepare_user(memctx, opts, dom, attrs, set_non_posix,
+                            &dom, &obj, &usn_value);
+    if (ret != EOK || obj.name == NULL) {
+        return ret;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Storing info for user %s\n", obj.name);
+
+    ret = sysdb_store_user(dom, obj.name, obj.pwd, obj.uid, obj.gid,
+                           obj.gecos, obj.homedir, obj.shell, obj.orig_dn,
+                           obj.attrs, obj.remove_attrs, dom->user_timeout,
+                           now);
+    if (ret) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to save user [%s]\n", obj.name);
+        talloc_free(usn_value);
+        return ret;
+    }
+
+    if (mapped_attrs != NULL) {
+        ret = sysdb_set_user_attr(dom, obj.name, mapped_attrs, SYSDB_MOD_ADD);
+        if (ret) return ret;
+    }
+
+    if (_usn_value) {
+        *_usn_value = usn_value;
+    } else {
+        talloc_free(usn_value);
+    }
+
+    return EOK;
+}
+
 
 /* ==Generic-Function-to-save-multiple-users============================= */
 
@@ -659,11 +705,19 @@ int sdap_save_users(TALLOC_CTX *memctx,
                     char **_usn_value)
 {
     TALLOC_CTX *tmpctx;
+    struct sysdb_store_obj *objs;
+    struct sysdb_store_obj *batch;
+    struct sss_domain_info **obj_doms;
+    struct sss_domain_info *user_dom;
+    size_t num_batch;
+    char **usn_values;
+    bool *batched;
     char *higher_usn = NULL;
     char *usn_value;
     int ret;
     errno_t sret;
     int i;
+    int j;
     time_t now;
     bool in_transaction = false;
 
@@ -692,29 +746,88 @@ int sdap_save_users(TALLOC_CTX *memctx,
         }
     }
 
+    objs = talloc_zero_array(tmpctx, struct sysdb_store_obj, num_users);
+    obj_doms = talloc_zero_array(tmpctx, struct sss_domain_info *, num_users);
+    usn_values = talloc_zero_array(tmpctx, char *, num_users);
+    batch = talloc_zero_array(tmpctx, struct sysdb_store_obj, num_users);
+    batched = talloc_zero_array(tmpctx, bool, num_users);
+    if (objs == NULL || obj_doms == NULL || usn_values == NULL
+            || batch == NULL || batched == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_users; i++) {
+        ret = sdap_prepare_user(tmpctx, opts, dom, users[i], false,
+                                &obj_doms[i], &objs[i], &usn_values[i]);
+        if (ret) {
+            /* Do not fail completely on errors.
+             * Just report the failure to save and go on */
+            DEBUG(SSSDBG_OP_FAILURE, "Failed to store user %d. Ignoring.\n", i);
+            objs[i].name = NULL;
+        }
+    }
+
+    /* Store the users of each domain at once, the users of a subdomain are
+     * only found by their SID */
     now = time(NULL);
     for (i = 0; i < num_users; i++) {
-        usn_value = NULL;
+        if (objs[i].name == NULL || batched[i]) {
+            continue;
+        }
+        user_dom = obj_doms[i];
+
+        num_batch = 0;
+        for (j = i; j < num_users; j++) {
+            if (objs[j].name != NULL && obj_doms[j] == user_dom) {
+                batch[num_batch] = objs[j];
+                num_batch++;
+            }
+        }
 
-        ret = sdap_save_user(tmpctx, opts, dom, users[i], mapped_attrs,
-                             &usn_value, now, false);
+        ret = sysdb_store_objects(user_dom, batch, num_batch,
+                                  user_dom->user_timeout, now);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Failed to store users of %s [%d]: %s\n",
+                  user_dom->name, ret, sss_strerror(ret));
+            goto done;
+        }
+
+        num_batch = 0;
+        for (j = i; j < num_users; j++) {
+            if (objs[j].name != NULL && obj_doms[j] == user_dom) {
+                objs[j].ret = batch[num_batch].ret;
+                batched[j] = true;
+                num_batch++;
+            }
+        }
+    }
+
+    for (i = 0; i < num_users; i++) {
+        if (objs[i].name == NULL) {
+            continue;
+        }
+
+        ret = objs[i].ret;
+        if (ret == EOK && mapped_attrs != NULL) {
+            ret = sysdb_set_user_attr(obj_doms[i], objs[i].name,
+                                      mapped_attrs, SYSDB_MOD_ADD);
+        }
 
         /* Do not fail completely on errors.
          * Just report the failure to save and go on */
         if (ret) {
             DEBUG(SSSDBG_OP_FAILURE, "Failed to store user %d. Ignoring.\n", i);
-        } else {
-            DEBUG(SSSDBG_TRACE_ALL, "User %d processed!\n", i);
+            continue;
         }
+        DEBUG(SSSDBG_TRACE_ALL, "User %d processed!\n", i);
 
+        usn_value = usn_values[i];
         if (usn_value) {
             if (higher_usn) {
                 if ((strlen(usn_value) > strlen(higher_usn)) ||
                     (strcmp(usn_value, higher_usn) > 0)) {
-                    talloc_zfree(higher_usn);
                     higher_usn = usn_value;
-                } else {
-                    talloc_zfree(usn_value);
                 }
             } else {
                 higher_usn = usn_value;
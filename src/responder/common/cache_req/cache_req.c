@@ -25,7 +25,9 @@
 
 #include "util/util.h"
 #include "util/sss_chain_id.h"
+#include "util/sss_ptr_hash.h"
 #include "responder/common/responder.h"
+#include "responder/common/responder_stats.h"
 #include "responder/common/cache_req/cache_req_private.h"
 #include "responder/common/cache_req/cache_req_plugin.h"
 
@@ -146,6 +148,7 @@ cache_req_create(TALLOC_CTX *mem_ctx,
     cr->midpoint = midpoint;
     cr->req_dom_type = req_dom_type;
     cr->req_start = time(NULL);
+    cr->start_time = get_start_time();
 
     /* It is perfectly fine to just overflow here. */
     cr->reqid = rctx->cache_req_num++;
@@ -688,6 +691,17 @@ static errno_t cache_req_locate_dom_cache_recv(TALLOC_CTX *mem_ctx,
     return EOK;
 }
 
+/* Search of one domain when all domains are searched at once */
+struct cache_req_parallel_search {
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    struct cache_req *cr;
+    struct sss_domain_info *domain;
+    struct ldb_result *result;
+    errno_t ret;
+    bool done;
+};
+
 struct cache_req_search_domains_state {
     /* input data */
     struct tevent_context *ev;
@@ -702,9 +716,14 @@ struct cache_req_search_domains_state {
     bool check_next;
     bool dp_success;
     bool first_iteration;
+
+    /* searches in the order of the domains, if searching in parallel */
+    struct cache_req_parallel_search *parallel;
+    size_t num_parallel;
 };
 
 static errno_t cache_req_search_domains_next(struct tevent_req *req);
+static errno_t cache_req_search_domains_parallel(struct tevent_req *req);
 static errno_t cache_req_handle_result(struct tevent_req *req,
                                        struct ldb_result *result);
 
@@ -772,7 +791,7 @@ cache_req_search_domains_send(TALLOC_CTX *mem_ctx,
         cache_req_domain_set_locate_flag(cr_domain, cr);
     }
 
-    ret = cache_req_search_domains_next(req);
+    ret = cache_req_search_domains_parallel(req);
     if (ret == EAGAIN) {
         return req;
     }
@@ -787,23 +806,49 @@ cache_req_search_domains_send(TALLOC_CTX *mem_ctx,
     return req;
 }
 
+static bool
+cache_req_search_domains_is_candidate(struct cache_req_search_domains_state *state,
+                                      struct cache_req_domain *cr_domain)
+{
+    struct cache_req *cr = state->cr;
+
+    /* As the cr_domain list is a flatten version of the domains
+     * list, we have to ensure to only go through the subdomains in
+     * case it's specified in the plugin to do so.
+     */
+    if (cr->plugin->get_next_domain_flags == 0
+            && IS_SUBDOMAIN(cr_domain->domain)) {
+        return false;
+    }
+
+    /* Check if this domain is valid for this request. */
+    if (!cache_req_validate_domain(cr, cr_domain->domain)) {
+        return false;
+    }
+
+    /* If not specified otherwise, we skip domains that require fully
+     * qualified names on domain less search. We do not descend into
+     * subdomains here since those are implicitly qualified.
+     */
+    if (state->check_next && !cr->plugin->allow_missing_fqn
+            && cr_domain->fqnames) {
+        return false;
+    }
+
+    return true;
+}
+
 static errno_t cache_req_search_domains_next(struct tevent_req *req)
 {
     struct cache_req_search_domains_state *state;
     struct tevent_req *subreq;
     struct cache_req *cr;
     struct sss_domain_info *domain;
-    uint32_t next_domain_flag;
-    bool is_domain_valid;
-    bool allow_no_fqn;
     errno_t ret;
 
     state = tevent_req_data(req, struct cache_req_search_domains_state);
     cr = state->cr;
 
-    next_domain_flag = cr->plugin->get_next_domain_flags;
-    allow_no_fqn = cr->plugin->allow_missing_fqn;
-
     while (state->cr_domain != NULL) {
         domain = state->cr_domain->domain;
 
@@ -811,27 +856,7 @@ static errno_t cache_req_search_domains_next(struct tevent_req *req)
             break;
         }
 
-        /* As the cr_domain list is a flatten version of the domains
-         * list, we have to ensure to only go through the subdomains in
-         * case it's specified in the plugin to do so.
-         */
-        if (next_domain_flag == 0 && IS_SUBDOMAIN(domain)) {
-            state->cr_domain = state->cr_domain->next;
-            continue;
-        }
-
-        /* Check if this domain is valid for this request. */
-        is_domain_valid = cache_req_validate_domain(cr, domain);
-        if (!is_domain_valid) {
-            state->cr_domain = state->cr_domain->next;
-            continue;
-        }
-
-        /* If not specified otherwise, we skip domains that require fully
-         * qualified names on domain less search. We do not descend into
-         * subdomains here since those are implicitly qualified.
-         */
-        if (state->check_next && !allow_no_fqn && state->cr_domain->fqnames) {
+        if (!cache_req_search_domains_is_candidate(state, state->cr_domain)) {
             state->cr_domain = state->cr_domain->next;
             continue;
         }
@@ -1058,6 +1083,244 @@ done:
     return;
 }
 
+/* Searching all domains at once only pays off if the data provider is
+ * contacted and the first domain that knows the object is the answer. */
+static bool
+cache_req_search_domains_parallel_wanted(struct cache_req_search_domains_state *state)
+{
+    struct cache_req_domain *iter;
+
+    if (!state->cr->rctx->parallel_domain_lookup) {
+        return false;
+    }
+
+    if (!state->check_next || state->cr->plugin->search_all_domains) {
+        return false;
+    }
+
+    if (!cache_req_dp_contacted(state)) {
+        return false;
+    }
+
+    /* the domain locator decides which domain to search */
+    DLIST_FOR_EACH(iter, state->cr_domain) {
+        if (iter->locate_domain) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Per domain data of the request are modified when the domain is set, so
+ * each parallel search needs a copy of its own. The rest is shared with
+ * the original request. */
+static struct cache_req *
+cache_req_copy_for_domain(TALLOC_CTX *mem_ctx,
+                          struct cache_req *cr,
+                          struct sss_domain_info *domain)
+{
+    struct cache_req *copy;
+    errno_t ret;
+
+    copy = talloc_zero(mem_ctx, struct cache_req);
+    if (copy == NULL) {
+        return NULL;
+    }
+    *copy = *cr;
+    copy->debugobj = NULL;
+
+    copy->data = talloc_zero(copy, struct cache_req_data);
+    if (copy->data == NULL) {
+        talloc_free(copy);
+        return NULL;
+    }
+    *copy->data = *cr->data;
+    copy->data->name.lookup = NULL;
+    copy->data->svc.name = &copy->data->name;
+    copy->data->svc.protocol.lookup = NULL;
+
+    ret = cache_req_set_domain(copy, domain);
+    if (ret != EOK) {
+        talloc_free(copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+static void cache_req_search_domains_parallel_done(struct tevent_req *subreq);
+
+static errno_t cache_req_search_domains_parallel(struct tevent_req *req)
+{
+    struct cache_req_search_domains_state *state;
+    struct cache_req_parallel_search *search;
+    struct cache_req_domain *iter;
+    size_t count = 0;
+
+    state = tevent_req_data(req, struct cache_req_search_domains_state);
+
+    if (!cache_req_search_domains_parallel_wanted(state)) {
+        return cache_req_search_domains_next(req);
+    }
+
+    DLIST_FOR_EACH(iter, state->cr_domain) {
+        if (iter->domain != NULL
+                && cache_req_search_domains_is_candidate(state, iter)) {
+            count++;
+        }
+    }
+
+    if (count < 2) {
+        return cache_req_search_domains_next(req);
+    }
+
+    state->parallel = talloc_zero_array(state, struct cache_req_parallel_search,
+                                        count);
+    if (state->parallel == NULL) {
+        return ENOMEM;
+    }
+
+    CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
+                    "Searching %zu domains in parallel\n", count);
+
+    DLIST_FOR_EACH(iter, state->cr_domain) {
+        if (iter->domain == NULL
+                || !cache_req_search_domains_is_candidate(state, iter)) {
+            continue;
+        }
+
+        search = &state->parallel[state->num_parallel];
+        search->req = req;
+        search->domain = iter->domain;
+
+        search->cr = cache_req_copy_for_domain(state->parallel, state->cr,
+                                               iter->domain);
+        if (search->cr == NULL) {
+            return ENOMEM;
+        }
+
+        search->subreq = cache_req_search_send(state->parallel, state->ev,
+                                               search->cr,
+                                               state->first_iteration, false);
+        if (search->subreq == NULL) {
+            return ENOMEM;
+        }
+        tevent_req_set_callback(search->subreq,
+                                cache_req_search_domains_parallel_done,
+                                search);
+
+        state->num_parallel++;
+    }
+
+    return EAGAIN;
+}
+
+static void
+cache_req_search_domains_parallel_cancel(struct cache_req_search_domains_state *state,
+                                         size_t first)
+{
+    size_t i;
+
+    for (i = first; i < state->num_parallel; i++) {
+        if (state->parallel[i].subreq != NULL) {
+            CACHE_REQ_DEBUG(SSSDBG_TRACE_INTERNAL, state->cr,
+                            "Cancelling search in domain [%s]\n",
+                            state->parallel[i].domain->name);
+            talloc_zfree(state->parallel[i].subreq);
+        }
+    }
+}
+
+/* The result of a domain is used only if all domains that precede it in
+ * the domain resolution order did not find the object, exactly as if the
+ * domains were searched one by one. */
+static errno_t cache_req_search_domains_parallel_pick(struct tevent_req *req)
+{
+    struct cache_req_search_domains_state *state;
+    struct cache_req_parallel_search *search;
+    errno_t ret;
+    size_t i;
+
+    state = tevent_req_data(req, struct cache_req_search_domains_state);
+
+    for (i = 0; i < state->num_parallel; i++) {
+        search = &state->parallel[i];
+        if (!search->done) {
+            return EAGAIN;
+        }
+
+        switch (search->ret) {
+        case EOK:
+            cache_req_search_domains_parallel_cancel(state, i + 1);
+
+            state->selected_domain = search->domain;
+            ret = cache_req_set_domain(state->cr, search->domain);
+            if (ret != EOK) {
+                return ret;
+            }
+
+            ret = cache_req_handle_result(req, search->result);
+            return ret == EAGAIN ? EOK : ret;
+        case ERR_ID_OUTSIDE_RANGE:
+        case ENOENT:
+            continue;
+        default:
+            /* Some serious error has happened. Finish. */
+            cache_req_search_domains_parallel_cancel(state, 0);
+            return search->ret;
+        }
+    }
+
+    /* See cache_req_search_domains_next() */
+    if (state->dp_success) {
+        cache_req_global_ncache_add(state->cr);
+    }
+
+    return ENOENT;
+}
+
+static void cache_req_search_domains_parallel_done(struct tevent_req *subreq)
+{
+    struct cache_req_search_domains_state *state;
+    struct cache_req_parallel_search *search;
+    struct tevent_req *req;
+    bool dp_success;
+    errno_t ret;
+
+    search = tevent_req_callback_data(subreq, struct cache_req_parallel_search);
+    req = search->req;
+    state = tevent_req_data(req, struct cache_req_search_domains_state);
+
+    search->ret = cache_req_search_recv(state->parallel, subreq,
+                                        &search->result, &dp_success);
+    talloc_zfree(subreq);
+    search->subreq = NULL;
+    search->done = true;
+
+    /* Remember if any DP request fails. */
+    state->dp_success = !dp_success ? false : state->dp_success;
+
+    ret = cache_req_search_domains_parallel_pick(req);
+    switch (ret) {
+    case EOK:
+        tevent_req_done(req);
+        break;
+    case EAGAIN:
+        break;
+    default:
+        if (ret == ENOENT
+                && !state->dp_success
+                && state->cr->data->propogate_offline_status) {
+            /* Not found and data provider request failed so we were
+             * unable to fetch the data. */
+            ret = ERR_OFFLINE;
+        }
+        tevent_req_error(req, ret);
+        break;
+    }
+}
+
 static errno_t
 cache_req_search_domains_recv(TALLOC_CTX *mem_ctx,
                               struct tevent_req *req,
@@ -1120,14 +1383,15 @@ static void cache_req_process_result(struct tevent_req *subreq);
 
 static void cache_req_done(struct tevent_req *subreq);
 
-struct tevent_req *cache_req_send(TALLOC_CTX *mem_ctx,
-                                  struct tevent_context *ev,
-                                  struct resp_ctx *rctx,
-                                  struct sss_nc_ctx *ncache,
-                                  int midpoint,
-                                  enum cache_req_dom_type req_dom_type,
-                                  const char *domain,
-                                  struct cache_req_data *data)
+static struct tevent_req *
+cache_req_start_send(TALLOC_CTX *mem_ctx,
+                     struct tevent_context *ev,
+                     struct resp_ctx *rctx,
+                     struct sss_nc_ctx *ncache,
+                     int midpoint,
+                     enum cache_req_dom_type req_dom_type,
+                     const char *domain,
+                     struct cache_req_data *data)
 {
     struct cache_req_state *state;
     struct cache_req_result *result;
@@ -1539,6 +1803,329 @@ static void cache_req_done(struct tevent_req *subreq)
     }
 }
 
+/* Identical requests that run at the same time are coalesced into one
+ * flight. Only the flight searches the cache and contacts the data
+ * provider, every request that asked for the object gets a copy of its
+ * result. The flight does not belong to any of the requests so it finishes
+ * even if the request that started it is cancelled. */
+
+struct cache_req_flight_waiter;
+
+struct cache_req_flight {
+    struct resp_ctx *rctx;
+    const char *key;
+    struct cache_req_flight_waiter *waiters;
+};
+
+struct cache_req_flight_waiter {
+    struct cache_req_flight_waiter *prev;
+    struct cache_req_flight_waiter *next;
+
+    struct cache_req_flight *flight;
+    struct tevent_req *req;
+};
+
+static const char *
+cache_req_flight_key(TALLOC_CTX *mem_ctx,
+                     struct sss_nc_ctx *ncache,
+                     int midpoint,
+                     enum cache_req_dom_type req_dom_type,
+                     const char *domain,
+                     struct cache_req_data *data)
+{
+    const char *object;
+    char *idstr = NULL;
+
+    /* Requests with custom attributes or a custom list of domains are rare
+     * and would only make the key longer. */
+    if (data->attrs != NULL || data->requested_domains != NULL) {
+        return NULL;
+    }
+
+    switch (data->type) {
+    case CACHE_REQ_USER_BY_NAME:
+    case CACHE_REQ_USER_BY_UPN:
+    case CACHE_REQ_GROUP_BY_NAME:
+    case CACHE_REQ_INITGROUPS:
+    case CACHE_REQ_INITGROUPS_BY_UPN:
+        object = data->name.input;
+        break;
+    case CACHE_REQ_USER_BY_ID:
+    case CACHE_REQ_GROUP_BY_ID:
+        idstr = talloc_asprintf(mem_ctx, "%"PRIu32, data->id);
+        object = idstr;
+        break;
+    case CACHE_REQ_OBJECT_BY_SID:
+        object = data->sid;
+        break;
+    default:
+        return NULL;
+    }
+
+    if (object == NULL) {
+        return NULL;
+    }
+
+    return talloc_asprintf(mem_ctx, "%d:%d:%d:%d%d%d%d:%p:%s:%s",
+                           data->type, req_dom_type, midpoint,
+                           data->bypass_cache, data->bypass_dp,
+                           data->propogate_offline_status,
+                           data->hybrid_lookup, ncache,
+                           domain == NULL ? "" : domain, object);
+}
+
+static int cache_req_flight_waiter_destructor(struct cache_req_flight_waiter *w)
+{
+    if (w->flight != NULL) {
+        DLIST_REMOVE(w->flight->waiters, w);
+    }
+
+    return 0;
+}
+
+static errno_t
+cache_req_flight_attach(struct cache_req_flight *flight,
+                        struct tevent_req *req)
+{
+    struct cache_req_state *state;
+    struct cache_req_flight_waiter *w;
+
+    state = tevent_req_data(req, struct cache_req_state);
+
+    w = talloc_zero(state, struct cache_req_flight_waiter);
+    if (w == NULL) {
+        return ENOMEM;
+    }
+
+    w->flight = flight;
+    w->req = req;
+    talloc_set_destructor(w, cache_req_flight_waiter_destructor);
+    DLIST_ADD_END(flight->waiters, w, struct cache_req_flight_waiter *);
+
+    return EOK;
+}
+
+static void cache_req_flight_done(struct tevent_req *subreq);
+
+static errno_t cache_req_recv_results(TALLOC_CTX *mem_ctx,
+                                      struct tevent_req *req,
+                                      struct cache_req_result ***_results);
+
+static errno_t
+cache_req_flight_start(struct tevent_context *ev,
+                       struct resp_ctx *rctx,
+                       struct sss_nc_ctx *ncache,
+                       int midpoint,
+                       enum cache_req_dom_type req_dom_type,
+                       const char *domain,
+                       struct cache_req_data *data,
+                       const char *key,
+                       struct cache_req_flight **_flight)
+{
+    struct cache_req_flight *flight;
+    struct cache_req_data *flight_data;
+    struct tevent_req *subreq;
+    errno_t ret;
+
+    if (rctx->cr_flights == NULL) {
+        rctx->cr_flights = sss_ptr_hash_create(rctx, NULL, NULL);
+        if (rctx->cr_flights == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    flight = talloc_zero(rctx->cr_flights, struct cache_req_flight);
+    if (flight == NULL) {
+        return ENOMEM;
+    }
+
+    flight->rctx = rctx;
+    flight->key = talloc_strdup(flight, key);
+    if (flight->key == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* the data of the request may be gone before the flight finishes */
+    flight_data = cache_req_data_copy(flight, data);
+    if (flight_data == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    subreq = cache_req_start_send(flight, ev, rctx, ncache, midpoint,
+                                  req_dom_type, domain, flight_data);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    tevent_req_set_callback(subreq, cache_req_flight_done, flight);
+
+    ret = sss_ptr_hash_add(rctx->cr_flights, flight->key, flight,
+                           struct cache_req_flight);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    *_flight = flight;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(flight);
+    }
+
+    return ret;
+}
+
+static errno_t
+cache_req_flight_copy_results(struct cache_req_state *state,
+                              struct cache_req_result **results)
+{
+    struct cache_req_result *copy;
+    errno_t ret;
+    size_t i;
+
+    for (i = 0; results != NULL && results[i] != NULL; i++) {
+        copy = cache_req_copy_result(state, results[i]);
+        if (copy == NULL) {
+            return ENOMEM;
+        }
+
+        ret = cache_req_add_result(state, copy, &state->results,
+                                   &state->num_results);
+        if (ret != EOK) {
+            talloc_free(copy);
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+static void cache_req_flight_done(struct tevent_req *subreq)
+{
+    struct cache_req_flight *flight;
+    struct cache_req_flight_waiter *w;
+    struct cache_req_result **results = NULL;
+    struct cache_req_state *state;
+    struct tevent_req *req;
+    errno_t copy_ret;
+    errno_t ret;
+
+    flight = tevent_req_callback_data(subreq, struct cache_req_flight);
+
+    /* only the requests waiting for the flight are counted */
+    ret = cache_req_recv_results(flight, subreq, &results);
+    talloc_zfree(subreq);
+
+    /* new requests must not attach to the finished flight */
+    sss_ptr_hash_delete(flight->rctx->cr_flights, flight->key, false);
+
+    while ((w = flight->waiters) != NULL) {
+        DLIST_REMOVE(flight->waiters, w);
+        w->flight = NULL;
+        req = w->req;
+        state = tevent_req_data(req, struct cache_req_state);
+
+        if (ret == EOK) {
+            copy_ret = cache_req_flight_copy_results(state, results);
+            if (copy_ret != EOK) {
+                tevent_req_error(req, copy_ret);
+                continue;
+            }
+
+            CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
+                            "Finished: Success\n");
+            tevent_req_done(req);
+            continue;
+        }
+
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
+                        "Finished: Error %d: %s\n", ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+    }
+
+    talloc_free(flight);
+}
+
+struct tevent_req *cache_req_send(TALLOC_CTX *mem_ctx,
+                                  struct tevent_context *ev,
+                                  struct resp_ctx *rctx,
+                                  struct sss_nc_ctx *ncache,
+                                  int midpoint,
+                                  enum cache_req_dom_type req_dom_type,
+                                  const char *domain,
+                                  struct cache_req_data *data)
+{
+    struct cache_req_flight *flight = NULL;
+    struct cache_req_state *state;
+    struct tevent_req *req;
+    const char *key;
+    errno_t ret;
+
+    key = cache_req_flight_key(NULL, ncache, midpoint, req_dom_type,
+                               domain, data);
+    if (key == NULL) {
+        return cache_req_start_send(mem_ctx, ev, rctx, ncache, midpoint,
+                                    req_dom_type, domain, data);
+    }
+
+    req = tevent_req_create(mem_ctx, &state, struct cache_req_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        talloc_free(discard_const(key));
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->cr = cache_req_create(state, rctx, data,
+                                 ncache, midpoint, req_dom_type);
+    if (state->cr == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (rctx->cr_flights != NULL) {
+        flight = sss_ptr_hash_lookup(rctx->cr_flights, key,
+                                     struct cache_req_flight);
+    }
+
+    if (flight != NULL) {
+        rctx->cr_flights_merged++;
+        resp_stats_count(rctx->stats, RESP_STATS_CR_FLIGHTS_MERGED);
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
+                        "Waiting for identical request in progress "
+                        "[%"PRIu64" of %"PRIu64" requests merged]\n",
+                        rctx->cr_flights_merged,
+                        rctx->cr_flights_started + rctx->cr_flights_merged);
+    } else {
+        ret = cache_req_flight_start(ev, rctx, ncache, midpoint,
+                                     req_dom_type, domain, data, key,
+                                     &flight);
+        if (ret != EOK) {
+            goto done;
+        }
+        rctx->cr_flights_started++;
+        resp_stats_count(rctx->stats, RESP_STATS_CR_FLIGHTS_STARTED);
+    }
+
+    ret = cache_req_flight_attach(flight, req);
+    if (ret == EOK) {
+        ret = EAGAIN;
+    }
+
+done:
+    talloc_free(discard_const(key));
+
+    if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
 uint32_t cache_req_get_reqid(struct tevent_req *req)
 {
     const struct cache_req_state *state;
@@ -1552,9 +2139,21 @@ uint32_t cache_req_get_reqid(struct tevent_req *req)
     return 0;
 }
 
-errno_t cache_req_recv(TALLOC_CTX *mem_ctx,
-                       struct tevent_req *req,
-                       struct cache_req_result ***_results)
+static void cache_req_record_stats(struct cache_req *cr)
+{
+    if (cr == NULL || cr->start_time == 0) {
+        return;
+    }
+
+    resp_stats_cr_record(cr->rctx->stats, cr->data->type, cr->plugin->name,
+                         RESP_STATS_CR_TOTAL,
+                         get_spend_time_us(cr->start_time));
+    cr->start_time = 0;
+}
+
+static errno_t cache_req_recv_results(TALLOC_CTX *mem_ctx,
+                                      struct tevent_req *req,
+                                      struct cache_req_result ***_results)
 {
     struct cache_req_state *state;
 
@@ -1569,6 +2168,18 @@ errno_t cache_req_recv(TALLOC_CTX *mem_ctx,
     return EOK;
 }
 
+errno_t cache_req_recv(TALLOC_CTX *mem_ctx,
+                       struct tevent_req *req,
+                       struct cache_req_result ***_results)
+{
+    struct cache_req_state *state;
+
+    state = tevent_req_data(req, struct cache_req_state);
+    cache_req_record_stats(state->cr);
+
+    return cache_req_recv_results(mem_ctx, req, _results);
+}
+
 errno_t cache_req_single_domain_recv(TALLOC_CTX *mem_ctx,
                                      struct tevent_req *req,
                                      struct cache_req_result **_result)
@@ -1576,6 +2187,7 @@ errno_t cache_req_single_domain_recv(TALLOC_CTX *mem_ctx,
     struct cache_req_state *state;
 
     state = tevent_req_data(req, struct cache_req_state);
+    cache_req_record_stats(state->cr);
 
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
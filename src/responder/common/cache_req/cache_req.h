@@ -242,6 +242,19 @@ cache_req_copy_limited_result(TALLOC_CTX *mem_ctx,
                               uint32_t start,
                               uint32_t limit);
 
+/**
+ * Deep copy of cache request result.
+ */
+struct cache_req_result *
+cache_req_copy_result(TALLOC_CTX *mem_ctx,
+                      struct cache_req_result *result);
+
+/**
+ * Drop all objects that were kept in memory by cache requests. Called
+ * when the responder is told that the cache was invalidated.
+ */
+void cache_req_hot_cache_clear(struct resp_ctx *rctx);
+
 /* Generic request. */
 
 struct tevent_req *cache_req_send(TALLOC_CTX *mem_ctx,
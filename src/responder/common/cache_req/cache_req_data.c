@@ -282,6 +282,30 @@ done:
     return data;
 }
 
+struct cache_req_data *
+cache_req_data_copy(TALLOC_CTX *mem_ctx,
+                    struct cache_req_data *data)
+{
+    struct cache_req_data *copy;
+
+    if (data->requested_domains != NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Bug: requested domains are not copied!\n");
+        return NULL;
+    }
+
+    copy = cache_req_data_create(mem_ctx, data->type, data);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    copy->bypass_cache = data->bypass_cache;
+    copy->bypass_dp = data->bypass_dp;
+    copy->propogate_offline_status = data->propogate_offline_status;
+    copy->hybrid_lookup = data->hybrid_lookup;
+
+    return copy;
+}
+
 struct cache_req_data *
 cache_req_data_name(TALLOC_CTX *mem_ctx,
                     enum cache_req_type type,
@@ -129,6 +129,34 @@ typedef errno_t
                        struct sss_domain_info *domain,
                        struct ldb_result **_result);
 
+/**
+ * Start an asynchronous lookup of the object in sysdb. It is used instead
+ * of the lookup function when the cache is searched by the sysdb readers.
+ *
+ * @return EOK    If the lookup was started, the request is in _subreq.
+ * @return Other errno code in case of an error, the same the lookup
+ *         function would return.
+ */
+typedef errno_t
+(*cache_req_lookup_send_fn)(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            struct cache_req *cr,
+                            struct cache_req_data *data,
+                            struct sss_domain_info *domain,
+                            struct tevent_req **_subreq);
+
+/**
+ * Receive the result of the asynchronous lookup.
+ *
+ * @return EOK    If the object is found.
+ * @return ENOENT If the object is not found.
+ * @return Other errno code in case of an error.
+ */
+typedef errno_t
+(*cache_req_lookup_recv_fn)(TALLOC_CTX *mem_ctx,
+                            struct tevent_req *subreq,
+                            struct ldb_result **_result);
+
 /**
  * Send Data Provider request.
  *
@@ -288,6 +316,8 @@ struct cache_req_plugin {
     cache_req_ncache_add_fn ncache_add_fn;
     cache_req_ncache_filter_fn ncache_filter_fn;
     cache_req_lookup_fn lookup_fn;
+    cache_req_lookup_send_fn lookup_send_fn;
+    cache_req_lookup_recv_fn lookup_recv_fn;
     cache_req_dp_send_fn dp_send_fn;
     cache_req_dp_recv_fn dp_recv_fn;
     cache_req_dp_get_domain_check_fn dp_get_domain_check_fn;
@@ -58,6 +58,9 @@ struct cache_req {
 
     /* Time when the request started. Useful for by-filter lookups */
     time_t req_start;
+
+    /* Time when the request started in microseconds, for the statistics */
+    uint64_t start_time;
 };
 
 /**
@@ -116,6 +119,11 @@ struct cache_req_data {
     bool hybrid_lookup;
 };
 
+/* Deep copy of the input data of a request */
+struct cache_req_data *
+cache_req_data_copy(TALLOC_CTX *mem_ctx,
+                    struct cache_req_data *data);
+
 struct tevent_req *
 cache_req_search_send(TALLOC_CTX *mem_ctx,
                       struct tevent_context *ev,
@@ -179,6 +187,11 @@ struct ldb_result *
 cache_req_create_ldb_result_from_msg(TALLOC_CTX *mem_ctx,
                                      struct ldb_message *ldb_msg);
 
+/* Deep copy of the messages, the result does not share memory with @result */
+struct ldb_result *
+cache_req_copy_ldb_result(TALLOC_CTX *mem_ctx,
+                          struct ldb_result *result);
+
 struct cache_req_result *
 cache_req_create_result_from_msg(TALLOC_CTX *mem_ctx,
                                  struct sss_domain_info *domain,
@@ -272,3 +272,93 @@ done:
 
     return out;
 }
+
+struct ldb_result *
+cache_req_copy_ldb_result(TALLOC_CTX *mem_ctx,
+                          struct ldb_result *result)
+{
+    struct ldb_result *out;
+    unsigned int i;
+
+    out = talloc_zero(mem_ctx, struct ldb_result);
+    if (out == NULL) {
+        return NULL;
+    }
+
+    out->msgs = talloc_zero_array(out, struct ldb_message *,
+                                  result->count + 1);
+    if (out->msgs == NULL) {
+        talloc_free(out);
+        return NULL;
+    }
+
+    for (i = 0; i < result->count; i++) {
+        out->msgs[i] = ldb_msg_copy(out->msgs, result->msgs[i]);
+        if (out->msgs[i] == NULL) {
+            talloc_free(out);
+            return NULL;
+        }
+    }
+    out->count = result->count;
+
+    return out;
+}
+
+struct cache_req_result *
+cache_req_copy_result(TALLOC_CTX *mem_ctx,
+                      struct cache_req_result *result)
+{
+    struct cache_req_result *out = NULL;
+    struct ldb_result *ldb_result;
+    errno_t ret;
+
+    out = talloc_zero(mem_ctx, struct cache_req_result);
+    if (out == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    out->domain = result->domain;
+    out->well_known_object = result->well_known_object;
+
+    if (result->ldb_result != NULL) {
+        ldb_result = cache_req_copy_ldb_result(out, result->ldb_result);
+        if (ldb_result == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        out->ldb_result = ldb_result;
+        out->count = ldb_result->count;
+        out->msgs = ldb_result->msgs;
+    }
+
+    if (result->lookup_name != NULL) {
+        out->lookup_name = talloc_strdup(out, result->lookup_name);
+        if (out->lookup_name == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    if (result->well_known_domain != NULL) {
+        out->well_known_domain = talloc_strdup(out, result->well_known_domain);
+        if (out->well_known_domain == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to copy cache request result "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+
+        talloc_free(out);
+        return NULL;
+    }
+
+    return out;
+}
@@ -23,6 +23,8 @@
 #include <tevent.h>
 
 #include "util/util.h"
+#include "util/sss_ptr_hash.h"
+#include "responder/common/responder_stats.h"
 #include "responder/common/cache_req/cache_req_private.h"
 #include "responder/common/cache_req/cache_req_plugin.h"
 #include "db/sysdb.h"
@@ -194,43 +196,400 @@ cache_req_should_be_in_cache(struct cache_req *cr,
     return EOK;
 }
 
-static errno_t cache_req_search_cache(TALLOC_CTX *mem_ctx,
-                                      struct cache_req *cr,
-                                      struct ldb_result **_result)
+/* Objects that were recently found in the cache are kept in memory for
+ * result_cache_timeout seconds, so lookups of hot objects do not have to
+ * search ldb again. All entries are dropped by cache_req_hot_cache_clear()
+ * when the responder is told that the cache was invalidated. */
+
+struct cache_req_hot_entry {
+    struct cache_req_hot_entry *prev;
+    struct cache_req_hot_entry *next;
+
+    struct cache_req_hot_cache *hc;
+    struct ldb_result *result;
+    time_t stored;
+};
+
+struct cache_req_hot_cache {
+    hash_table_t *table;
+
+    /* most recently used entry first */
+    struct cache_req_hot_entry *entries;
+    struct cache_req_hot_entry *last;
+    int num_entries;
+};
+
+static enum cache_object_status
+cache_req_expiration_status(struct cache_req *cr,
+                            struct ldb_result *result);
+
+static void cache_req_hot_entry_unlink(struct cache_req_hot_entry *entry)
+{
+    struct cache_req_hot_cache *hc = entry->hc;
+
+    if (hc->last == entry) {
+        hc->last = entry->prev;
+    }
+
+    DLIST_REMOVE(hc->entries, entry);
+}
+
+static int cache_req_hot_entry_destructor(struct cache_req_hot_entry *entry)
+{
+    cache_req_hot_entry_unlink(entry);
+    entry->hc->num_entries--;
+
+    return 0;
+}
+
+static int cache_req_hot_cache_destructor(struct cache_req_hot_cache *hc)
+{
+    /* free the entries while the table still exists */
+    sss_ptr_hash_delete_all(hc->table, true);
+
+    return 0;
+}
+
+static struct cache_req_hot_cache *
+cache_req_hot_cache_get(struct resp_ctx *rctx)
+{
+    struct cache_req_hot_cache *hc;
+
+    if (rctx->cr_hot_cache != NULL) {
+        return rctx->cr_hot_cache;
+    }
+
+    hc = talloc_zero(rctx, struct cache_req_hot_cache);
+    if (hc == NULL) {
+        return NULL;
+    }
+
+    hc->table = sss_ptr_hash_create(hc, NULL, NULL);
+    if (hc->table == NULL) {
+        talloc_free(hc);
+        return NULL;
+    }
+
+    talloc_set_destructor(hc, cache_req_hot_cache_destructor);
+    rctx->cr_hot_cache = hc;
+
+    return hc;
+}
+
+void cache_req_hot_cache_clear(struct resp_ctx *rctx)
+{
+    if (rctx->cr_hot_cache == NULL) {
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Dropping %d objects kept in memory\n",
+          rctx->cr_hot_cache->num_entries);
+
+    talloc_zfree(rctx->cr_hot_cache);
+}
+
+static char *cache_req_hot_key(TALLOC_CTX *mem_ctx, struct cache_req *cr)
+{
+    const char *object;
+
+    if (cr->rctx->result_cache_size <= 0
+            || cr->rctx->result_cache_timeout <= 0) {
+        return NULL;
+    }
+
+    /* the result would depend on the requested attributes */
+    if (cr->data->attrs != NULL) {
+        return NULL;
+    }
+
+    switch (cr->data->type) {
+    case CACHE_REQ_USER_BY_NAME:
+    case CACHE_REQ_USER_BY_UPN:
+    case CACHE_REQ_GROUP_BY_NAME:
+    case CACHE_REQ_INITGROUPS:
+    case CACHE_REQ_INITGROUPS_BY_UPN:
+        object = cr->data->name.lookup;
+        break;
+    case CACHE_REQ_USER_BY_ID:
+    case CACHE_REQ_GROUP_BY_ID:
+        return talloc_asprintf(mem_ctx, "%d:%s:%"PRIu32, cr->data->type,
+                               cr->domain->name, cr->data->id);
+    case CACHE_REQ_OBJECT_BY_SID:
+        object = cr->data->sid;
+        break;
+    default:
+        return NULL;
+    }
+
+    if (object == NULL) {
+        return NULL;
+    }
+
+    return talloc_asprintf(mem_ctx, "%d:%s:%s", cr->data->type,
+                           cr->domain->name, object);
+}
+
+static struct ldb_result *
+cache_req_hot_cache_lookup(TALLOC_CTX *mem_ctx,
+                           struct cache_req *cr,
+                           const char *key)
+{
+    struct cache_req_hot_cache *hc = cr->rctx->cr_hot_cache;
+    struct cache_req_hot_entry *entry;
+
+    if (hc == NULL) {
+        return NULL;
+    }
+
+    entry = sss_ptr_hash_lookup(hc->table, key, struct cache_req_hot_entry);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    /* Entries that need to be refreshed are searched in ldb again, the
+     * object may have been updated by another process meanwhile. */
+    if (entry->stored + cr->rctx->result_cache_timeout < time(NULL)
+            || cache_req_expiration_status(cr, entry->result)
+                                                    != CACHE_OBJECT_VALID) {
+        talloc_free(entry);
+        return NULL;
+    }
+
+    cache_req_hot_entry_unlink(entry);
+    DLIST_ADD(hc->entries, entry);
+    if (hc->last == NULL) {
+        hc->last = entry;
+    }
+
+    return cache_req_copy_ldb_result(mem_ctx, entry->result);
+}
+
+static void cache_req_hot_cache_drop(struct cache_req *cr,
+                                     const char *key)
 {
-    struct ldb_result *result = NULL;
+    if (cr->rctx->cr_hot_cache == NULL) {
+        return;
+    }
+
+    sss_ptr_hash_delete(cr->rctx->cr_hot_cache->table, key, true);
+}
+
+static void cache_req_hot_cache_store(struct cache_req *cr,
+                                      const char *key,
+                                      struct ldb_result *result)
+{
+    struct cache_req_hot_cache *hc;
+    struct cache_req_hot_entry *entry;
     errno_t ret;
 
+    hc = cache_req_hot_cache_get(cr->rctx);
+    if (hc == NULL) {
+        return;
+    }
+
+    cache_req_hot_cache_drop(cr, key);
+
+    entry = talloc_zero(hc, struct cache_req_hot_entry);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->hc = hc;
+    entry->stored = time(NULL);
+    entry->result = cache_req_copy_ldb_result(entry, result);
+    if (entry->result == NULL) {
+        talloc_free(entry);
+        return;
+    }
+
+    ret = sss_ptr_hash_add(hc->table, key, entry, struct cache_req_hot_entry);
+    if (ret != EOK) {
+        CACHE_REQ_DEBUG(SSSDBG_MINOR_FAILURE, cr,
+                        "Unable to keep [%s] in memory [%d]: %s\n",
+                        cr->debugobj, ret, sss_strerror(ret));
+        talloc_free(entry);
+        return;
+    }
+
+    DLIST_ADD(hc->entries, entry);
+    if (hc->last == NULL) {
+        hc->last = entry;
+    }
+    hc->num_entries++;
+    talloc_set_destructor(entry, cache_req_hot_entry_destructor);
+
+    while (hc->num_entries > cr->rctx->result_cache_size) {
+        talloc_free(hc->last);
+    }
+}
+
+/* Searches the cache for the object, first in memory, then in sysdb. The
+ * sysdb readers do the search when they are running, otherwise it is
+ * done right away and the request finishes in the next loop iteration. */
+struct cache_req_search_cache_state {
+    struct cache_req *cr;
+    char *key;
+    uint64_t start_time;
+    struct ldb_result *result;
+};
+
+static errno_t cache_req_search_cache_lookup(struct tevent_req *req,
+                                             struct tevent_context *ev);
+static void cache_req_search_cache_lookup_done(struct tevent_req *subreq);
+static errno_t cache_req_search_cache_looked_up(struct tevent_req *req,
+                                                errno_t ret);
+static void cache_req_search_cache_finish(struct tevent_req *req,
+                                          errno_t ret);
+
+static struct tevent_req *
+cache_req_search_cache_send(TALLOC_CTX *mem_ctx,
+                            struct tevent_context *ev,
+                            struct cache_req *cr,
+                            bool use_memory)
+{
+    struct cache_req_search_cache_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct cache_req_search_cache_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->cr = cr;
+
     if (cr->plugin->lookup_fn == NULL) {
         CACHE_REQ_DEBUG(SSSDBG_CRIT_FAILURE, cr,
                         "Bug: No cache lookup function specified\n");
-        return ERR_INTERNAL;
+        ret = ERR_INTERNAL;
+        goto done;
     }
 
     CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
                     "Looking up [%s] in cache\n",
                     cr->debugobj);
 
-    ret = cr->plugin->lookup_fn(mem_ctx, cr, cr->data, cr->domain, &result);
-    if (ret == EOK && (result == NULL || result->count == 0)) {
+    state->key = cache_req_hot_key(state, cr);
+    if (state->key != NULL && use_memory) {
+        state->result = cache_req_hot_cache_lookup(state, cr, state->key);
+    }
+
+    if (state->result != NULL) {
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
+                        "[%s] was found in memory\n", cr->debugobj);
+        ret = EOK;
+        goto done;
+    }
+
+    ret = cache_req_search_cache_lookup(req, ev);
+    if (ret == EAGAIN) {
+        return req;
+    }
+
+done:
+    cache_req_search_cache_finish(req, ret);
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static errno_t cache_req_search_cache_lookup(struct tevent_req *req,
+                                             struct tevent_context *ev)
+{
+    struct cache_req_search_cache_state *state;
+    struct tevent_req *subreq;
+    struct cache_req *cr;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct cache_req_search_cache_state);
+    cr = state->cr;
+
+    state->start_time = get_start_time();
+
+    /* Lookups of custom attributes are rare and stay synchronous */
+    if (cr->plugin->lookup_send_fn == NULL
+            || cr->data->attrs != NULL
+            || !sysdb_readers_available(cr->domain)) {
+        ret = cr->plugin->lookup_fn(state, cr, cr->data, cr->domain,
+                                    &state->result);
+        return cache_req_search_cache_looked_up(req, ret);
+    }
+
+    ret = cr->plugin->lookup_send_fn(state, ev, cr, cr->data, cr->domain,
+                                     &subreq);
+    if (ret != EOK) {
+        return cache_req_search_cache_looked_up(req, ret);
+    }
+
+    tevent_req_set_callback(subreq, cache_req_search_cache_lookup_done, req);
+
+    return EAGAIN;
+}
+
+static void cache_req_search_cache_lookup_done(struct tevent_req *subreq)
+{
+    struct cache_req_search_cache_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct cache_req_search_cache_state);
+
+    ret = state->cr->plugin->lookup_recv_fn(state, subreq, &state->result);
+    talloc_zfree(subreq);
+
+    ret = cache_req_search_cache_looked_up(req, ret);
+    cache_req_search_cache_finish(req, ret);
+}
+
+static errno_t cache_req_search_cache_looked_up(struct tevent_req *req,
+                                                errno_t ret)
+{
+    struct cache_req_search_cache_state *state;
+    struct cache_req *cr;
+
+    state = tevent_req_data(req, struct cache_req_search_cache_state);
+    cr = state->cr;
+
+    resp_stats_cr_record(cr->rctx->stats, cr->data->type,
+                         cr->plugin->name, RESP_STATS_CR_SYSDB,
+                         get_spend_time_us(state->start_time));
+    if (ret == EOK && (state->result == NULL || state->result->count == 0)) {
         ret = ENOENT;
     }
 
+    if (state->key != NULL && ret == EOK) {
+        cache_req_hot_cache_store(cr, state->key, state->result);
+    } else if (state->key != NULL) {
+        cache_req_hot_cache_drop(cr, state->key);
+    }
+
+    return ret;
+}
+
+static void cache_req_search_cache_finish(struct tevent_req *req,
+                                          errno_t ret)
+{
+    struct cache_req_search_cache_state *state;
+    struct cache_req *cr;
+
+    state = tevent_req_data(req, struct cache_req_search_cache_state);
+    cr = state->cr;
+
     if (ret == EOK) {
-        ret = cache_req_should_be_in_cache(cr, result);
+        ret = cache_req_should_be_in_cache(cr, state->result);
     }
 
     switch (ret) {
     case EOK:
-        if (cr->plugin->only_one_result && result->count > 1) {
+        if (cr->plugin->only_one_result && state->result->count > 1) {
             CACHE_REQ_DEBUG(SSSDBG_CRIT_FAILURE, cr,
                             "Multiple objects were found when "
                             "only one was expected!\n");
             ret = ERR_MULTIPLE_ENTRIES;
-            goto done;
         }
-
-        *_result = result;
         break;
     case ERR_ID_OUTSIDE_RANGE:
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
@@ -249,12 +608,26 @@ static errno_t cache_req_search_cache(TALLOC_CTX *mem_ctx,
         break;
     }
 
-done:
     if (ret != EOK) {
-        talloc_free(result);
+        tevent_req_error(req, ret);
+        return;
     }
 
-    return ret;
+    tevent_req_done(req);
+}
+
+static errno_t cache_req_search_cache_recv(TALLOC_CTX *mem_ctx,
+                                           struct tevent_req *req,
+                                           struct ldb_result **_result)
+{
+    struct cache_req_search_cache_state *state;
+    state = tevent_req_data(req, struct cache_req_search_cache_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_result = talloc_steal(mem_ctx, state->result);
+
+    return EOK;
 }
 
 static enum cache_object_status
@@ -290,12 +663,21 @@ struct cache_req_search_state {
     /* output data */
     struct ldb_result *result;
     bool dp_success;
+
+    /* start of the data provider request, for the statistics */
+    uint64_t dp_start_time;
+
+    bool bypass_dp;
+    bool skip_refresh;
 };
 
+static void cache_req_search_cache_done(struct tevent_req *subreq);
 static errno_t cache_req_search_dp(struct tevent_req *req,
                                    enum cache_object_status status);
 static void cache_req_search_oob_done(struct tevent_req *subreq);
 static void cache_req_search_done(struct tevent_req *subreq);
+static void cache_req_search_reread_done(struct tevent_req *subreq);
+static void cache_req_search_finish(struct tevent_req *req, errno_t ret);
 
 struct tevent_req *
 cache_req_search_send(TALLOC_CTX *mem_ctx,
@@ -305,7 +687,7 @@ cache_req_search_send(TALLOC_CTX *mem_ctx,
                       bool cache_only_override)
 {
     struct cache_req_search_state *state;
-    enum cache_object_status status;
+    struct tevent_req *subreq;
     struct tevent_req *req;
     bool bypass_cache = false;
     bool bypass_dp = false;
@@ -348,6 +730,9 @@ cache_req_search_send(TALLOC_CTX *mem_ctx,
         }
     }
 
+    state->bypass_dp = bypass_dp;
+    state->skip_refresh = skip_refresh;
+
     /* If bypass_cache is enabled we always contact data provider before
      * searching the cache. Thus we set expiration status to missing,
      * which will trigger data provider request later.
@@ -357,37 +742,19 @@ cache_req_search_send(TALLOC_CTX *mem_ctx,
      * to be contacted.
      */
     state->result = NULL;
-    status = CACHE_OBJECT_MISSING;
     if (!bypass_cache) {
-        ret = cache_req_search_cache(state, cr, &state->result);
-        if (ret != EOK && ret != ENOENT) {
-            goto done;
-        }
-
-        status = cache_req_expiration_status(cr, state->result);
-        if (status == CACHE_OBJECT_VALID) {
-            CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
-                            "Returning [%s] from cache\n", cr->debugobj);
-            ret = EOK;
+        subreq = cache_req_search_cache_send(state, ev, cr, true);
+        if (subreq == NULL) {
+            ret = ENOMEM;
             goto done;
         }
 
-        /* For the CACHE_REQ_CACHE_FIRST case, if bypass_dp is true but we
-         * found the object in this domain, we will contact the data provider
-         * anyway to refresh it so we can return it without searching the rest
-         * of the domains.
-         */
-        if (status != CACHE_OBJECT_MISSING && !skip_refresh) {
-            CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
-                            "Object found, but needs to be refreshed.\n");
-            bypass_dp = false;
-        } else {
-            ret = ENOENT;
-        }
+        tevent_req_set_callback(subreq, cache_req_search_cache_done, req);
+        return req;
     }
 
     if (!bypass_dp) {
-        ret = cache_req_search_dp(req, status);
+        ret = cache_req_search_dp(req, CACHE_OBJECT_MISSING);
     }
 
     if (ret != EAGAIN) {
@@ -397,8 +764,71 @@ cache_req_search_send(TALLOC_CTX *mem_ctx,
     return req;
 
 done:
+    cache_req_search_finish(req, ret);
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static void cache_req_search_cache_done(struct tevent_req *subreq)
+{
+    struct cache_req_search_state *state;
+    enum cache_object_status status;
+    struct tevent_req *req;
+    struct cache_req *cr;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct cache_req_search_state);
+    cr = state->cr;
+
+    ret = cache_req_search_cache_recv(state, subreq, &state->result);
+    talloc_zfree(subreq);
+    if (ret != EOK && ret != ENOENT) {
+        goto done;
+    }
+
+    status = cache_req_expiration_status(cr, state->result);
+    if (status == CACHE_OBJECT_VALID) {
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
+                        "Returning [%s] from cache\n", cr->debugobj);
+        ret = EOK;
+        goto done;
+    }
+
+    /* For the CACHE_REQ_CACHE_FIRST case, if bypass_dp is true but we
+     * found the object in this domain, we will contact the data provider
+     * anyway to refresh it so we can return it without searching the rest
+     * of the domains.
+     */
+    if (status != CACHE_OBJECT_MISSING && !state->skip_refresh) {
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
+                        "Object found, but needs to be refreshed.\n");
+        state->bypass_dp = false;
+    } else {
+        ret = ENOENT;
+    }
+
+    if (!state->bypass_dp) {
+        ret = cache_req_search_dp(req, status);
+    }
+
+    if (ret == EAGAIN) {
+        return;
+    }
+
+done:
+    cache_req_search_finish(req, ret);
+}
+
+static void cache_req_search_finish(struct tevent_req *req, errno_t ret)
+{
+    struct cache_req_search_state *state;
+
+    state = tevent_req_data(req, struct cache_req_search_state);
+
     if (ret == EOK) {
-        ret = cache_req_search_ncache_filter(state, cr, &state->result);
+        ret = cache_req_search_ncache_filter(state, state->cr, &state->result);
     }
 
     if (ret == EOK) {
@@ -406,9 +836,6 @@ done:
     } else {
         tevent_req_error(req, ret);
     }
-    tevent_req_post(req, ev);
-
-    return req;
 }
 
 static errno_t cache_req_search_dp(struct tevent_req *req,
@@ -450,6 +877,7 @@ static errno_t cache_req_search_dp(struct tevent_req *req,
                         "Looking up [%s] in data provider\n",
                         state->cr->debugobj);
 
+        state->dp_start_time = get_start_time();
         subreq = state->cr->plugin->dp_send_fn(state->cr, state->cr,
                                                state->cr->data,
                                                state->cr->domain,
@@ -495,6 +923,10 @@ static void cache_req_search_done(struct tevent_req *subreq)
     state->dp_success = state->cr->plugin->dp_recv_fn(subreq, state->cr);
     talloc_zfree(subreq);
 
+    resp_stats_cr_record(state->cr->rctx->stats, state->cr->data->type,
+                         state->cr->plugin->name, RESP_STATS_CR_DP,
+                         get_spend_time_us(state->dp_start_time));
+
 #ifdef BUILD_FILES_PROVIDER
     /* Do not try to read from cache if the domain is inconsistent */
     if (sss_domain_get_state(state->cr->domain) == DOM_INCONSISTENT) {
@@ -506,8 +938,32 @@ static void cache_req_search_done(struct tevent_req *subreq)
     }
 #endif /* BUILD_FILES_PROVIDER */
 
-    /* Get result from cache again. */
-    ret = cache_req_search_cache(state, state->cr, &state->result);
+    /* Get result from cache again, the data provider may have just
+     * updated the object so the copy in memory is replaced. */
+    subreq = cache_req_search_cache_send(state, state->ev, state->cr, false);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, cache_req_search_reread_done, req);
+    return;
+
+done:
+    tevent_req_error(req, ret);
+}
+
+static void cache_req_search_reread_done(struct tevent_req *subreq)
+{
+    struct cache_req_search_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct cache_req_search_state);
+
+    ret = cache_req_search_cache_recv(state, subreq, &state->result);
+    talloc_zfree(subreq);
     if (ret != EOK) {
         if (ret == ENOENT) {
             /* Only store entry in negative cache if DP request succeeded
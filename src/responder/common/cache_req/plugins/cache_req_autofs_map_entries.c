@@ -150,6 +150,8 @@ const struct cache_req_plugin cache_req_autofs_map_entries = {
     .ncache_add_fn = NULL,
     .ncache_filter_fn = NULL,
     .lookup_fn = cache_req_autofs_map_entries_lookup,
+    .lookup_send_fn = NULL,
+    .lookup_recv_fn = NULL,
     .dp_send_fn = cache_req_autofs_map_entries_dp_send,
     .dp_recv_fn = cache_req_autofs_map_entries_dp_recv,
     .dp_get_domain_check_fn = NULL,
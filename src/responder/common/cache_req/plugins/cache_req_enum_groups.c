@@ -85,6 +85,8 @@ const struct cache_req_plugin cache_req_enum_groups = {
     .ncache_add_fn = NULL,
     .ncache_filter_fn = cache_req_enum_groups_ncache_filter,
     .lookup_fn = cache_req_enum_groups_lookup,
+    .lookup_send_fn = NULL,
+    .lookup_recv_fn = NULL,
     .dp_send_fn = cache_req_enum_groups_dp_send,
     .dp_recv_fn = cache_req_common_dp_recv,
     .dp_get_domain_check_fn = NULL,
@@ -216,6 +216,8 @@ const struct cache_req_plugin cache_req_group_by_id = {
     .ncache_add_fn = cache_req_group_by_id_ncache_add,
     .ncache_filter_fn = cache_req_group_by_id_ncache_filter,
     .lookup_fn = cache_req_group_by_id_lookup,
+    .lookup_send_fn = NULL,
+    .lookup_recv_fn = NULL,
     .dp_send_fn = cache_req_group_by_id_dp_send,
     .dp_recv_fn = cache_req_common_dp_recv,
     .dp_get_domain_check_fn = cache_req_group_by_id_get_domain_check,
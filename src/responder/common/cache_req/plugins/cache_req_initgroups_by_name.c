@@ -211,6 +211,8 @@ const struct cache_req_plugin cache_req_initgroups_by_name = {
     .ncache_add_fn = cache_req_initgroups_by_name_ncache_add,
     .ncache_filter_fn = NULL,
     .lookup_fn = cache_req_initgroups_by_name_lookup,
+    .lookup_send_fn = NULL,
+    .lookup_recv_fn = NULL,
     .dp_send_fn = cache_req_initgroups_by_name_dp_send,
     .dp_recv_fn = cache_req_common_dp_recv,
     .dp_get_domain_check_fn = NULL,
@@ -171,6 +171,8 @@ const struct cache_req_plugin cache_req_object_by_sid = {
     .ncache_add_fn = cache_req_object_by_sid_ncache_add,
     .ncache_filter_fn = NULL,
     .lookup_fn = cache_req_object_by_sid_lookup,
+    .lookup_send_fn = NULL,
+    .lookup_recv_fn = NULL,
     .dp_send_fn = cache_req_object_by_sid_dp_send,
     .dp_recv_fn = cache_req_common_dp_recv,
     .dp_get_domain_check_fn = cache_req_object_by_sid_get_domain_check,
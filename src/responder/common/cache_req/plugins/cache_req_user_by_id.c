@@ -89,6 +89,31 @@ cache_req_user_by_id_lookup(TALLOC_CTX *mem_ctx,
     return sysdb_getpwuid_with_views(mem_ctx, domain, data->id, _result);
 }
 
+static errno_t
+cache_req_user_by_id_lookup_send(TALLOC_CTX *mem_ctx,
+                                 struct tevent_context *ev,
+                                 struct cache_req *cr,
+                                 struct cache_req_data *data,
+                                 struct sss_domain_info *domain,
+                                 struct tevent_req **_subreq)
+{
+    struct tevent_req *subreq;
+    errno_t ret;
+
+    ret = cache_req_idminmax_check(data, domain);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    subreq = sysdb_getpwuid_with_views_send(mem_ctx, ev, domain, data->id);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+
+    *_subreq = subreq;
+    return EOK;
+}
+
 static errno_t
 cache_req_user_by_id_dpreq_params(TALLOC_CTX *mem_ctx,
                                   struct cache_req *cr,
@@ -216,6 +241,8 @@ const struct cache_req_plugin cache_req_user_by_id = {
     .ncache_add_fn = cache_req_user_by_id_ncache_add,
     .ncache_filter_fn = cache_req_user_by_id_ncache_filter,
     .lookup_fn = cache_req_user_by_id_lookup,
+    .lookup_send_fn = cache_req_user_by_id_lookup_send,
+    .lookup_recv_fn = sysdb_getpwuid_with_views_recv,
     .dp_send_fn = cache_req_user_by_id_dp_send,
     .dp_recv_fn = cache_req_common_dp_recv,
     .dp_get_domain_check_fn = cache_req_user_by_id_get_domain_check,
@@ -114,6 +114,26 @@ cache_req_user_by_name_lookup(TALLOC_CTX *mem_ctx,
                                           data->attrs, _result);
 }
 
+static errno_t
+cache_req_user_by_name_lookup_send(TALLOC_CTX *mem_ctx,
+                                   struct tevent_context *ev,
+                                   struct cache_req *cr,
+                                   struct cache_req_data *data,
+                                   struct sss_domain_info *domain,
+                                   struct tevent_req **_subreq)
+{
+    struct tevent_req *subreq;
+
+    subreq = sysdb_getpwnam_with_views_send(mem_ctx, ev, domain,
+                                            data->name.lookup);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+
+    *_subreq = subreq;
+    return EOK;
+}
+
 static errno_t
 cache_req_user_by_name_dpreq_params(TALLOC_CTX *mem_ctx,
                                     struct cache_req *cr,
@@ -201,6 +221,8 @@ const struct cache_req_plugin cache_req_user_by_name = {
     .ncache_add_fn = cache_req_user_by_name_ncache_add,
     .ncache_filter_fn = NULL,
     .lookup_fn = cache_req_user_by_name_lookup,
+    .lookup_send_fn = cache_req_user_by_name_lookup_send,
+    .lookup_recv_fn = sysdb_getpwnam_with_views_recv,
     .dp_send_fn = cache_req_user_by_name_dp_send,
     .dp_recv_fn = cache_req_common_dp_recv,
     .dp_get_domain_check_fn = NULL,
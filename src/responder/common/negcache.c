@@ -19,52 +19,106 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <fcntl.h>
 #include <time.h>
-#include "tdb.h"
 #include "util/util.h"
 #include "util/nss_dl_load.h"
+#include "shared/murmurhash3.h"
 #include "confdb/confdb.h"
 #include "responder/common/negcache_files.h"
+#include "responder/common/negcache_shared.h"
 #include "responder/common/responder.h"
 #include "responder/common/negcache.h"
 
+/* Entries are spread over independent shards by the top bits of their hash
+ * so that growing the table only ever rehashes a fraction of the entries. */
+#define NC_SHARD_BITS 4
+#define NC_SHARDS (1 << NC_SHARD_BITS)
+#define NC_SHARD_MIN_BUCKETS 64
+
+/* Seed of the second half of the fingerprint used in the shared cache */
+#define NC_SHARED_SEED 0x9e3779b9
+
+enum sss_nc_type {
+    SSS_NC_USER = 0,
+    SSS_NC_UPN,
+    SSS_NC_GROUP,
+    SSS_NC_NETGROUP,
+    SSS_NC_SERVICE,
+    SSS_NC_UID,
+    SSS_NC_GID,
+    SSS_NC_SID,
+    SSS_NC_CERT,
+    SSS_NC_DOMAIN_LOCATE_TYPE,
+    SSS_NC_DOMAIN_LOCATE_UID,
+    SSS_NC_DOMAIN_LOCATE_GID,
+    SSS_NC_DOMAIN_LOCATE_SID,
+
+    SSS_NC_TYPE_SENTINEL
+};
 
-#define NC_ENTRY_PREFIX "NCE/"
-#define NC_USER_PREFIX NC_ENTRY_PREFIX"USER"
-#define NC_GROUP_PREFIX NC_ENTRY_PREFIX"GROUP"
-#define NC_NETGROUP_PREFIX NC_ENTRY_PREFIX"NETGR"
-#define NC_SERVICE_PREFIX NC_ENTRY_PREFIX"SERVICE"
-#define NC_UID_PREFIX NC_ENTRY_PREFIX"UID"
-#define NC_GID_PREFIX NC_ENTRY_PREFIX"GID"
-#define NC_SID_PREFIX NC_ENTRY_PREFIX"SID"
-#define NC_CERT_PREFIX NC_ENTRY_PREFIX"CERT"
-#define NC_DOMAIN_ACCT_LOCATE_PREFIX NC_ENTRY_PREFIX"DOM_LOCATE"
-#define NC_DOMAIN_ACCT_LOCATE_TYPE_PREFIX NC_ENTRY_PREFIX"DOM_LOCATE_TYPE"
+static const char *sss_nc_type_str[SSS_NC_TYPE_SENTINEL] = {
+    [SSS_NC_USER] = "USER",
+    [SSS_NC_UPN] = "UPN",
+    [SSS_NC_GROUP] = "GROUP",
+    [SSS_NC_NETGROUP] = "NETGR",
+    [SSS_NC_SERVICE] = "SERVICE",
+    [SSS_NC_UID] = "UID",
+    [SSS_NC_GID] = "GID",
+    [SSS_NC_SID] = "SID",
+    [SSS_NC_CERT] = "CERT",
+    [SSS_NC_DOMAIN_LOCATE_TYPE] = "DOM_LOCATE_TYPE",
+    [SSS_NC_DOMAIN_LOCATE_UID] = "DOM_LOCATE/UID",
+    [SSS_NC_DOMAIN_LOCATE_GID] = "DOM_LOCATE/GID",
+    [SSS_NC_DOMAIN_LOCATE_SID] = "DOM_LOCATE/SID",
+};
 
-struct sss_nc_ctx {
-    struct tdb_context *tdb;
-    uint32_t timeout;
-    uint32_t local_timeout;
-    struct sss_nss_ops ops;
+/* An entry is identified by its type, an optional domain and either a name
+ * or a numeric id. */
+struct sss_nc_key {
+    enum sss_nc_type type;
+    const char *domain;
+    const char *name;
+    uint32_t id;
 };
 
-typedef int (*ncache_set_byname_fn_t)(struct sss_nc_ctx *, bool,
-                                      const char *, const char *);
+struct sss_nc_entry {
+    struct sss_nc_entry *next;
+    uint32_t hash;
 
-static int sss_ncache_set_ent(struct sss_nc_ctx *ctx, bool permanent,
-                              struct sss_domain_info *dom, const char *name,
-                              ncache_set_byname_fn_t setter);
+    enum sss_nc_type type;
+    uint32_t id;
+    const char *domain;
+    const char *name;
 
-static int string_to_tdb_data(char *str, TDB_DATA *ret)
-{
-    if (!str || !ret) return EINVAL;
+    /* Permanent entries are valid as long as their generation matches
+     * sss_nc_ctx::perm_gen, other entries until they expire or the
+     * generation of their type is bumped. */
+    bool permanent;
+    uint32_t gen;
+    time_t expire;
 
-    ret->dptr = (uint8_t *)str;
-    ret->dsize = strlen(str)+1;
+    char strs[0];
+};
 
-    return EOK;
-}
+struct sss_nc_shard {
+    struct sss_nc_entry **buckets;
+    uint32_t mask;
+    uint32_t count;
+};
+
+struct sss_nc_ctx {
+    struct sss_nc_shard shards[NC_SHARDS];
+    uint32_t perm_gen;
+    uint32_t type_gen[SSS_NC_TYPE_SENTINEL];
+
+    /* Not permanent user and group entries are also stored here, so that
+     * they are seen by the other responders */
+    struct sss_nc_shared *shared;
+
+    uint32_t timeout;
+    uint32_t local_timeout;
+    struct sss_nss_ops ops;
+};
 
 static errno_t ncache_load_nss_symbols(struct sss_nss_ops *ops)
 {
@@ -90,6 +144,7 @@ int sss_ncache_init(TALLOC_CTX *memctx, uint32_t timeout,
 {
     errno_t ret;
     struct sss_nc_ctx *ctx;
+    int i;
 
     ctx = talloc_zero(memctx, struct sss_nc_ctx);
     if (!ctx) return ENOMEM;
@@ -102,10 +157,15 @@ int sss_ncache_init(TALLOC_CTX *memctx, uint32_t timeout,
         return ret;
     }
 
-    errno = 0;
-    /* open a memory only tdb with default hash size */
-    ctx->tdb = tdb_open("memcache", 0, TDB_INTERNAL, O_RDWR|O_CREAT, 0);
-    if (!ctx->tdb) return errno;
+    for (i = 0; i < NC_SHARDS; i++) {
+        ctx->shards[i].buckets = talloc_zero_array(ctx, struct sss_nc_entry *,
+                                                   NC_SHARD_MIN_BUCKETS);
+        if (ctx->shards[i].buckets == NULL) {
+            talloc_free(ctx);
+            return ENOMEM;
+        }
+        ctx->shards[i].mask = NC_SHARD_MIN_BUCKETS - 1;
+    }
 
     ctx->timeout = timeout;
     ctx->local_timeout = local_timeout;
@@ -119,254 +179,450 @@ uint32_t sss_ncache_get_timeout(struct sss_nc_ctx *ctx)
     return ctx->timeout;
 }
 
-static int sss_ncache_check_str(struct sss_nc_ctx *ctx, char *str)
+errno_t sss_ncache_attach_shared(struct sss_nc_ctx *ctx, const char *path)
 {
-    TDB_DATA key;
-    TDB_DATA data;
-    unsigned long long int timestamp;
-    bool expired = false;
-    char *ep;
-    int ret;
+    errno_t ret;
 
-    DEBUG(SSSDBG_TRACE_INTERNAL, "Checking negative cache for [%s]\n", str);
+    ret = sss_nc_shared_open(ctx, path, &ctx->shared);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to open shared negative cache %s [%d]: %s\n",
+              path, ret, sss_strerror(ret));
+        return ret;
+    }
 
-    data.dptr = NULL;
+    DEBUG(SSSDBG_TRACE_FUNC, "Using shared negative cache %s\n", path);
+    return EOK;
+}
 
-    ret = string_to_tdb_data(str, &key);
-    if (ret != EOK) goto done;
+static uint32_t sss_nc_key_hash(const struct sss_nc_key *key, uint32_t seed)
+{
+    uint32_t hash;
 
-    data = tdb_fetch(ctx->tdb, key);
+    hash = murmurhash3((const char *)&key->id, sizeof(key->id),
+                       seed + key->type);
+    if (key->domain != NULL) {
+        hash = murmurhash3(key->domain, strlen(key->domain), hash);
+    }
+    if (key->name != NULL) {
+        hash = murmurhash3(key->name, strlen(key->name), hash);
+    }
 
-    if (!data.dptr) {
-        ret = ENOENT;
-        goto done;
+    return hash;
+}
+
+static bool sss_nc_str_equal(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
     }
 
-    errno = 0;
-    timestamp = strtoull((const char *)data.dptr, &ep, 10);
-    if (errno != 0 || *ep != '\0') {
-        /* Malformed entry, remove it and return no entry */
-        expired = true;
-        goto done;
+    return strcmp(a, b) == 0;
+}
+
+static bool sss_nc_entry_match(struct sss_nc_entry *entry, uint32_t hash,
+                               const struct sss_nc_key *key)
+{
+    return entry->hash == hash
+           && entry->type == key->type
+           && entry->id == key->id
+           && sss_nc_str_equal(entry->name, key->name)
+           && sss_nc_str_equal(entry->domain, key->domain);
+}
+
+static bool sss_nc_entry_valid(struct sss_nc_ctx *ctx,
+                               struct sss_nc_entry *entry,
+                               time_t now)
+{
+    if (entry->permanent) {
+        return entry->gen == ctx->perm_gen;
     }
 
-    if (timestamp == 0) {
-        /* a 0 timestamp means this is a permanent entry */
-        ret = EEXIST;
-        goto done;
+    return entry->gen == ctx->type_gen[entry->type] && entry->expire >= now;
+}
+
+static struct sss_nc_shard *sss_nc_get_shard(struct sss_nc_ctx *ctx,
+                                             uint32_t hash)
+{
+    return &ctx->shards[hash >> (32 - NC_SHARD_BITS)];
+}
+
+/* Returns the link pointing to the entry matching the key or NULL */
+static struct sss_nc_entry **sss_nc_find(struct sss_nc_shard *shard,
+                                         uint32_t hash,
+                                         const struct sss_nc_key *key)
+{
+    struct sss_nc_entry **link;
+
+    for (link = &shard->buckets[hash & shard->mask];
+         *link != NULL;
+         link = &(*link)->next) {
+        if (sss_nc_entry_match(*link, hash, key)) {
+            return link;
+        }
     }
 
-    if (timestamp >= time(NULL)) {
-        /* still valid */
-        ret = EEXIST;
-        goto done;
+    return NULL;
+}
+
+static void sss_nc_unlink(struct sss_nc_shard *shard,
+                          struct sss_nc_entry **link)
+{
+    struct sss_nc_entry *entry = *link;
+
+    *link = entry->next;
+    shard->count--;
+    talloc_free(entry);
+}
+
+static void sss_nc_shard_purge(struct sss_nc_ctx *ctx,
+                               struct sss_nc_shard *shard)
+{
+    struct sss_nc_entry **link;
+    time_t now = time(NULL);
+    uint32_t i;
+
+    for (i = 0; i <= shard->mask; i++) {
+        link = &shard->buckets[i];
+        while (*link != NULL) {
+            if (sss_nc_entry_valid(ctx, *link, now)) {
+                link = &(*link)->next;
+            } else {
+                sss_nc_unlink(shard, link);
+            }
+        }
     }
+}
 
-    expired = true;
+/* Called once the shard holds as many entries as it has buckets. Expired
+ * and reset entries are dropped first and the bucket array is only doubled
+ * if the shard is still more than half full afterwards. */
+static void sss_nc_shard_grow(struct sss_nc_ctx *ctx,
+                              struct sss_nc_shard *shard)
+{
+    struct sss_nc_entry **buckets;
+    struct sss_nc_entry *entry;
+    struct sss_nc_entry *next;
+    uint32_t mask;
+    uint32_t i;
+
+    sss_nc_shard_purge(ctx, shard);
+    if (shard->count <= shard->mask / 2) {
+        return;
+    }
 
-done:
-    if (expired) {
-        /* expired, remove and return no entry */
-        tdb_delete(ctx->tdb, key);
-        ret = ENOENT;
+    mask = (shard->mask << 1) | 1;
+    buckets = talloc_zero_array(ctx, struct sss_nc_entry *, mask + 1);
+    if (buckets == NULL) {
+        /* Longer chains are still correct, just slower */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to grow the negative cache table\n");
+        return;
     }
 
-    free(data.dptr);
-    return ret;
+    for (i = 0; i <= shard->mask; i++) {
+        for (entry = shard->buckets[i]; entry != NULL; entry = next) {
+            next = entry->next;
+            entry->next = buckets[entry->hash & mask];
+            buckets[entry->hash & mask] = entry;
+        }
+    }
+
+    talloc_free(shard->buckets);
+    shard->buckets = buckets;
+    shard->mask = mask;
 }
 
-static int sss_ncache_set_str(struct sss_nc_ctx *ctx, char *str,
-                              bool permanent, bool use_local_negative)
+static bool sss_nc_shared_class(enum sss_nc_type type,
+                                enum sss_nc_shared_class *_cls)
 {
-    TDB_DATA key;
-    TDB_DATA data;
-    char *timest;
-    unsigned long long int timell;
-    int ret;
+    switch (type) {
+    case SSS_NC_USER:
+    case SSS_NC_UPN:
+    case SSS_NC_UID:
+        *_cls = SSS_NC_SHARED_USERS;
+        return true;
+    case SSS_NC_GROUP:
+    case SSS_NC_GID:
+        *_cls = SSS_NC_SHARED_GROUPS;
+        return true;
+    default:
+        return false;
+    }
+}
 
-    ret = string_to_tdb_data(str, &key);
-    if (ret != EOK) return ret;
+static uint64_t sss_nc_shared_key(const struct sss_nc_key *key, uint32_t hash)
+{
+    return ((uint64_t)hash << 32) | sss_nc_key_hash(key, NC_SHARED_SEED);
+}
 
-    if (permanent) {
-        timest = talloc_strdup(ctx, "0");
+static void sss_nc_debug_key(int level, const char *msg,
+                             const struct sss_nc_key *key, bool permanent)
+{
+    if (key->name != NULL) {
+        DEBUG(level, "%s [%s/%s/%s]%s\n", msg,
+              sss_nc_type_str[key->type], key->domain ? key->domain : "",
+              key->name, permanent ? " permanently" : "");
     } else {
+        DEBUG(level, "%s [%s/%s/%"PRIu32"]%s\n", msg,
+              sss_nc_type_str[key->type], key->domain ? key->domain : "",
+              key->id, permanent ? " permanently" : "");
+    }
+}
+
+static int sss_ncache_check_key(struct sss_nc_ctx *ctx,
+                                const struct sss_nc_key *key)
+{
+    struct sss_nc_shard *shard;
+    struct sss_nc_entry **link;
+    uint32_t hash;
+
+    enum sss_nc_shared_class cls;
+    time_t now = time(NULL);
+
+    sss_nc_debug_key(SSSDBG_TRACE_INTERNAL, "Checking negative cache for",
+                     key, false);
+
+    hash = sss_nc_key_hash(key, 0);
+    shard = sss_nc_get_shard(ctx, hash);
+
+    link = sss_nc_find(shard, hash, key);
+    if (link != NULL) {
+        if (sss_nc_entry_valid(ctx, *link, now)) {
+            return EEXIST;
+        }
+
+        /* expired or reset, remove it */
+        sss_nc_unlink(shard, link);
+    }
+
+    if (ctx->shared != NULL && sss_nc_shared_class(key->type, &cls)
+            && sss_nc_shared_check(ctx->shared, cls,
+                                   sss_nc_shared_key(key, hash), now)) {
+        sss_nc_debug_key(SSSDBG_TRACE_INTERNAL,
+                         "Found in shared negative cache", key, false);
+        return EEXIST;
+    }
+
+    return ENOENT;
+}
+
+static int sss_ncache_set_key(struct sss_nc_ctx *ctx,
+                              const struct sss_nc_key *key,
+                              bool permanent, bool use_local_negative)
+{
+    struct sss_nc_shard *shard;
+    struct sss_nc_entry **link;
+    struct sss_nc_entry *entry;
+    enum sss_nc_shared_class cls;
+    size_t domain_len = 0;
+    size_t name_len = 0;
+    time_t expire = 0;
+    uint32_t hash;
+
+    if (!permanent) {
         if (use_local_negative == true && ctx->local_timeout > ctx->timeout) {
-            timell = ctx->local_timeout;
+            expire = ctx->local_timeout;
         } else {
             /* EOK is tested in cwrap based unit test */
             if (ctx->timeout == 0) {
                 return EOK;
             }
-            timell = ctx->timeout;
+            expire = ctx->timeout;
         }
-        timell += (unsigned long long int)time(NULL);
-        timest = talloc_asprintf(ctx, "%llu", timell);
+        expire += time(NULL);
     }
-    if (!timest) return ENOMEM;
 
-    ret = string_to_tdb_data(timest, &data);
-    if (ret != EOK) goto done;
+    sss_nc_debug_key(SSSDBG_TRACE_FUNC, "Adding to negative cache",
+                     key, permanent);
 
-    DEBUG(SSSDBG_TRACE_FUNC, "Adding [%s] to negative cache%s\n",
-              str, permanent?" permanently":"");
+    hash = sss_nc_key_hash(key, 0);
+    shard = sss_nc_get_shard(ctx, hash);
 
-    ret = tdb_store(ctx->tdb, key, data, TDB_REPLACE);
-    if (ret != 0) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Negative cache failed to set entry: [%s]\n",
-                  tdb_errorstr(ctx->tdb));
-        ret = EFAULT;
-    }
+    link = sss_nc_find(shard, hash, key);
+    if (link != NULL) {
+        entry = *link;
+    } else {
+        if (key->domain != NULL) {
+            domain_len = strlen(key->domain) + 1;
+        }
+        if (key->name != NULL) {
+            name_len = strlen(key->name) + 1;
+        }
 
-done:
-    talloc_free(timest);
-    return ret;
-}
+        entry = talloc_size(ctx, sizeof(struct sss_nc_entry)
+                                 + domain_len + name_len);
+        if (entry == NULL) {
+            return ENOMEM;
+        }
+        talloc_set_name_const(entry, "struct sss_nc_entry");
+
+        entry->hash = hash;
+        entry->type = key->type;
+        entry->id = key->id;
+        entry->domain = NULL;
+        entry->name = NULL;
+        if (key->domain != NULL) {
+            memcpy(entry->strs, key->domain, domain_len);
+            entry->domain = entry->strs;
+        }
+        if (key->name != NULL) {
+            memcpy(entry->strs + domain_len, key->name, name_len);
+            entry->name = entry->strs + domain_len;
+        }
 
-static int sss_ncache_check_user_int(struct sss_nc_ctx *ctx, const char *domain,
-                                     const char *name)
-{
-    char *str;
-    int ret;
+        entry->next = shard->buckets[hash & shard->mask];
+        shard->buckets[hash & shard->mask] = entry;
+        shard->count++;
+    }
 
-    if (!name || !*name) return EINVAL;
+    entry->permanent = permanent;
+    entry->gen = permanent ? ctx->perm_gen : ctx->type_gen[key->type];
+    entry->expire = expire;
 
-    str = talloc_asprintf(ctx, "%s/%s/%s", NC_USER_PREFIX, domain, name);
-    if (!str) return ENOMEM;
+    if (shard->count > shard->mask) {
+        sss_nc_shard_grow(ctx, shard);
+    }
 
-    ret = sss_ncache_check_str(ctx, str);
+    /* Permanent entries come from the configuration which every responder
+     * loads by itself */
+    if (!permanent && ctx->shared != NULL
+            && sss_nc_shared_class(key->type, &cls)) {
+        sss_nc_shared_set(ctx->shared, cls, sss_nc_shared_key(key, hash),
+                          expire);
+    }
 
-    talloc_free(str);
-    return ret;
+    return EOK;
 }
 
-static int sss_ncache_check_group_int(struct sss_nc_ctx *ctx,
-                                      const char *domain, const char *name)
+static int sss_ncache_check_ent(struct sss_nc_ctx *ctx,
+                                enum sss_nc_type type,
+                                struct sss_domain_info *dom, const char *name)
 {
-    char *str;
-    int ret;
+    struct sss_nc_key key = { .type = type, .domain = dom->name };
+    char *lower = NULL;
+    errno_t ret;
 
     if (!name || !*name) return EINVAL;
 
-    str = talloc_asprintf(ctx, "%s/%s/%s", NC_GROUP_PREFIX, domain, name);
-    if (!str) return ENOMEM;
+    if (dom->case_sensitive == false) {
+        lower = sss_tc_utf8_str_tolower(ctx, name);
+        if (!lower) return ENOMEM;
+        name = lower;
+    }
 
-    ret = sss_ncache_check_str(ctx, str);
+    key.name = name;
+    ret = sss_ncache_check_key(ctx, &key);
 
-    talloc_free(str);
+    talloc_free(lower);
     return ret;
 }
 
-static int sss_ncache_check_netgr_int(struct sss_nc_ctx *ctx,
-                                      const char *domain, const char *name)
+static int sss_ncache_set_ent(struct sss_nc_ctx *ctx, bool permanent,
+                              enum sss_nc_type type,
+                              struct sss_domain_info *dom, const char *name)
 {
-    char *str;
-    int ret;
+    struct sss_nc_key key = { .type = type, .domain = dom->name };
+    bool use_local_negative = false;
+    char *lower = NULL;
+    errno_t ret;
 
     if (!name || !*name) return EINVAL;
 
-    str = talloc_asprintf(ctx, "%s/%s/%s", NC_NETGROUP_PREFIX, domain, name);
-    if (!str) return ENOMEM;
+    if (dom->case_sensitive == false) {
+        lower = sss_tc_utf8_str_tolower(ctx, name);
+        if (!lower) return ENOMEM;
+        name = lower;
+    }
 
-    ret = sss_ncache_check_str(ctx, str);
+    if ((!permanent) && (ctx->local_timeout > 0)) {
+        if (type == SSS_NC_USER) {
+            use_local_negative = is_user_local_by_name(&ctx->ops, name);
+        } else if (type == SSS_NC_GROUP) {
+            use_local_negative = is_group_local_by_name(&ctx->ops, name);
+        }
+    }
 
-    talloc_free(str);
+    key.name = name;
+    ret = sss_ncache_set_key(ctx, &key, permanent, use_local_negative);
+
+    talloc_free(lower);
     return ret;
 }
 
-static int sss_ncache_check_service_int(struct sss_nc_ctx *ctx,
-                                        const char *domain,
-                                        const char *name)
+static int sss_ncache_check_id(struct sss_nc_ctx *ctx, enum sss_nc_type type,
+                               struct sss_domain_info *dom, uint32_t id)
 {
-    char *str;
-    int ret;
-
-    if (!name || !*name) return EINVAL;
+    struct sss_nc_key key = {
+        .type = type,
+        .domain = dom != NULL ? dom->name : NULL,
+        .id = id,
+    };
 
-    str = talloc_asprintf(ctx, "%s/%s/%s",
-                          NC_SERVICE_PREFIX,
-                          domain,
-                          name);
-    if (!str) return ENOMEM;
+    return sss_ncache_check_key(ctx, &key);
+}
 
-    ret = sss_ncache_check_str(ctx, str);
+static int sss_ncache_set_id(struct sss_nc_ctx *ctx, bool permanent,
+                             enum sss_nc_type type,
+                             struct sss_domain_info *dom, uint32_t id,
+                             bool use_local_negative)
+{
+    struct sss_nc_key key = {
+        .type = type,
+        .domain = dom != NULL ? dom->name : NULL,
+        .id = id,
+    };
 
-    talloc_free(str);
-    return ret;
+    return sss_ncache_set_key(ctx, &key, permanent, use_local_negative);
 }
 
-typedef int (*ncache_check_byname_fn_t)(struct sss_nc_ctx *, const char *,
-                                        const char *);
-
-static int sss_cache_check_ent(struct sss_nc_ctx *ctx,
-                               struct sss_domain_info *dom, const char *name,
-                               ncache_check_byname_fn_t checker)
+static int sss_ncache_check_name(struct sss_nc_ctx *ctx, enum sss_nc_type type,
+                                 struct sss_domain_info *dom, const char *name)
 {
-    char *lower;
-    errno_t ret;
+    struct sss_nc_key key = {
+        .type = type,
+        .domain = dom != NULL ? dom->name : NULL,
+        .name = name,
+    };
 
-    if (dom->case_sensitive == false) {
-        lower = sss_tc_utf8_str_tolower(ctx, name);
-        if (!lower) return ENOMEM;
-        ret = checker(ctx, dom->name, lower);
-        talloc_free(lower);
-    } else {
-        ret = checker(ctx, dom->name, name);
-    }
+    return sss_ncache_check_key(ctx, &key);
+}
 
-    return ret;
+static int sss_ncache_set_name(struct sss_nc_ctx *ctx, bool permanent,
+                               enum sss_nc_type type,
+                               struct sss_domain_info *dom, const char *name)
+{
+    struct sss_nc_key key = {
+        .type = type,
+        .domain = dom != NULL ? dom->name : NULL,
+        .name = name,
+    };
+
+    return sss_ncache_set_key(ctx, &key, permanent, false);
 }
 
 int sss_ncache_check_user(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                           const char *name)
 {
-    return sss_cache_check_ent(ctx, dom, name, sss_ncache_check_user_int);
+    return sss_ncache_check_ent(ctx, SSS_NC_USER, dom, name);
 }
 
 int sss_ncache_check_upn(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                          const char *name)
 {
-    char *neg_cache_name = NULL;
-    errno_t ret;
-
-    neg_cache_name = talloc_asprintf(ctx, "@%s", name);
-    if (neg_cache_name == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_cache_check_ent(ctx, dom, neg_cache_name,
-                              sss_ncache_check_user_int);
-    talloc_free(neg_cache_name);
-
-    return ret;
+    return sss_ncache_check_ent(ctx, SSS_NC_UPN, dom, name);
 }
 
 int sss_ncache_check_group(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                            const char *name)
 {
-    return sss_cache_check_ent(ctx, dom, name, sss_ncache_check_group_int);
+    return sss_ncache_check_ent(ctx, SSS_NC_GROUP, dom, name);
 }
 
 int sss_ncache_check_netgr(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                            const char *name)
 {
-    return sss_cache_check_ent(ctx, dom, name, sss_ncache_check_netgr_int);
-}
-
-static int sss_ncache_set_service_int(struct sss_nc_ctx *ctx, bool permanent,
-                                      const char *domain, const char *name)
-{
-    char *str;
-    int ret;
-
-    if (!name || !*name) return EINVAL;
-
-    str = talloc_asprintf(ctx, "%s/%s/%s", NC_SERVICE_PREFIX, domain, name);
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_set_str(ctx, str, permanent, false);
-
-    talloc_free(str);
-    return ret;
+    return sss_ncache_check_ent(ctx, SSS_NC_NETGROUP, dom, name);
 }
 
 int sss_ncache_set_service_name(struct sss_nc_ctx *ctx, bool permanent,
@@ -379,9 +635,8 @@ int sss_ncache_set_service_name(struct sss_nc_ctx *ctx, bool permanent,
                                                  proto ? proto : "<ANY>");
     if (!service_and_protocol) return ENOMEM;
 
-    ret = sss_ncache_set_ent(ctx, permanent, dom,
-                             service_and_protocol,
-                             sss_ncache_set_service_int);
+    ret = sss_ncache_set_ent(ctx, permanent, SSS_NC_SERVICE, dom,
+                             service_and_protocol);
     talloc_free(service_and_protocol);
     return ret;
 }
@@ -395,8 +650,8 @@ int sss_ncache_check_service(struct sss_nc_ctx *ctx,struct sss_domain_info *dom,
                                                  proto ? proto : "<ANY>");
     if (!service_and_protocol) return ENOMEM;
 
-    ret = sss_cache_check_ent(ctx, dom, service_and_protocol,
-                              sss_ncache_check_service_int);
+    ret = sss_ncache_check_ent(ctx, SSS_NC_SERVICE, dom,
+                               service_and_protocol);
     talloc_free(service_and_protocol);
     return ret;
 }
@@ -411,9 +666,8 @@ int sss_ncache_set_service_port(struct sss_nc_ctx *ctx, bool permanent,
                                                  proto ? proto : "<ANY>");
     if (!service_and_protocol) return ENOMEM;
 
-    ret = sss_ncache_set_ent(ctx, permanent, dom,
-                             service_and_protocol,
-                             sss_ncache_set_service_int);
+    ret = sss_ncache_set_ent(ctx, permanent, SSS_NC_SERVICE, dom,
+                             service_and_protocol);
     talloc_free(service_and_protocol);
     return ret;
 }
@@ -429,8 +683,8 @@ int sss_ncache_check_service_port(struct sss_nc_ctx *ctx,
                                                  proto ? proto : "<ANY>");
     if (!service_and_protocol) return ENOMEM;
 
-    ret = sss_cache_check_ent(ctx, dom, service_and_protocol,
-                              sss_ncache_check_service_int);
+    ret = sss_ncache_check_ent(ctx, SSS_NC_SERVICE, dom,
+                               service_and_protocol);
     talloc_free(service_and_protocol);
     return ret;
 }
@@ -440,564 +694,192 @@ int sss_ncache_check_service_port(struct sss_nc_ctx *ctx,
 int sss_ncache_check_uid(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                          uid_t uid)
 {
-    char *str;
-    int ret;
-
-    if (dom != NULL) {
-        str = talloc_asprintf(ctx, "%s/%s/%"SPRIuid, NC_UID_PREFIX, dom->name,
-                              uid);
-    } else {
-        str = talloc_asprintf(ctx, "%s/%"SPRIuid, NC_UID_PREFIX, uid);
-    }
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_check_str(ctx, str);
-
-    talloc_free(str);
-    return ret;
+    return sss_ncache_check_id(ctx, SSS_NC_UID, dom, uid);
 }
 
 int sss_ncache_check_gid(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                          gid_t gid)
 {
-    char *str;
-    int ret;
-
-    if (dom != NULL) {
-        str = talloc_asprintf(ctx, "%s/%s/%"SPRIgid, NC_GID_PREFIX, dom->name,
-                              gid);
-    } else {
-        str = talloc_asprintf(ctx, "%s/%"SPRIgid, NC_GID_PREFIX, gid);
-    }
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_check_str(ctx, str);
-
-    talloc_free(str);
-    return ret;
+    return sss_ncache_check_id(ctx, SSS_NC_GID, dom, gid);
 }
 
 int sss_ncache_check_sid(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                          const char *sid)
 {
-    char *str;
-    int ret;
-
-    if (dom != NULL) {
-        str = talloc_asprintf(ctx, "%s/%s/%s", NC_SID_PREFIX, dom->name, sid);
-    } else {
-        str = talloc_asprintf(ctx, "%s/%s", NC_SID_PREFIX, sid);
-    }
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_check_str(ctx, str);
-
-    talloc_free(str);
-    return ret;
+    return sss_ncache_check_name(ctx, SSS_NC_SID, dom, sid);
 }
 
 int sss_ncache_check_cert(struct sss_nc_ctx *ctx, const char *cert)
 {
-    char *str;
-    int ret;
-
-    str = talloc_asprintf(ctx, "%s/%s", NC_CERT_PREFIX, cert);
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_check_str(ctx, str);
-
-    talloc_free(str);
-    return ret;
-}
-
-
-static int sss_ncache_set_user_int(struct sss_nc_ctx *ctx, bool permanent,
-                                   const char *domain, const char *name)
-{
-    bool use_local_negative = false;
-    char *str;
-    int ret;
-
-    if (!name || !*name) return EINVAL;
-
-    str = talloc_asprintf(ctx, "%s/%s/%s", NC_USER_PREFIX, domain, name);
-    if (!str) return ENOMEM;
-
-    if ((!permanent) && (ctx->local_timeout > 0)) {
-        use_local_negative = is_user_local_by_name(&ctx->ops, name);
-    }
-    ret = sss_ncache_set_str(ctx, str, permanent, use_local_negative);
-
-    talloc_free(str);
-    return ret;
-}
-
-static int sss_ncache_set_group_int(struct sss_nc_ctx *ctx, bool permanent,
-                                    const char *domain, const char *name)
-{
-    bool use_local_negative = false;
-    char *str;
-    int ret;
-
-    if (!name || !*name) return EINVAL;
-
-    str = talloc_asprintf(ctx, "%s/%s/%s", NC_GROUP_PREFIX, domain, name);
-    if (!str) return ENOMEM;
-
-    if ((!permanent) && (ctx->local_timeout > 0)) {
-        use_local_negative = is_group_local_by_name(&ctx->ops, name);
-    }
-    ret = sss_ncache_set_str(ctx, str, permanent, use_local_negative);
-
-    talloc_free(str);
-    return ret;
-}
-
-static int sss_ncache_set_netgr_int(struct sss_nc_ctx *ctx, bool permanent,
-                                    const char *domain, const char *name)
-{
-    char *str;
-    int ret;
-
-    if (!name || !*name) return EINVAL;
-
-    str = talloc_asprintf(ctx, "%s/%s/%s", NC_NETGROUP_PREFIX, domain, name);
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_set_str(ctx, str, permanent, false);
-
-    talloc_free(str);
-    return ret;
-}
-
-static int sss_ncache_set_ent(struct sss_nc_ctx *ctx, bool permanent,
-                              struct sss_domain_info *dom, const char *name,
-                              ncache_set_byname_fn_t setter)
-{
-    char *lower;
-    errno_t ret;
-
-    if (dom->case_sensitive == false) {
-        lower = sss_tc_utf8_str_tolower(ctx, name);
-        if (!lower) return ENOMEM;
-        ret = setter(ctx, permanent, dom->name, lower);
-        talloc_free(lower);
-    } else {
-        ret = setter(ctx, permanent, dom->name, name);
-    }
-
-    return ret;
+    return sss_ncache_check_name(ctx, SSS_NC_CERT, NULL, cert);
 }
 
 
 int sss_ncache_set_user(struct sss_nc_ctx *ctx, bool permanent,
                         struct sss_domain_info *dom, const char *name)
 {
-    return sss_ncache_set_ent(ctx, permanent, dom, name, sss_ncache_set_user_int);
+    return sss_ncache_set_ent(ctx, permanent, SSS_NC_USER, dom, name);
 }
 
 int sss_ncache_set_upn(struct sss_nc_ctx *ctx, bool permanent,
                        struct sss_domain_info *dom, const char *name)
 {
-    char *neg_cache_name = NULL;
-    errno_t ret;
-
-    neg_cache_name = talloc_asprintf(ctx, "@%s", name);
-    if (neg_cache_name == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_ncache_set_ent(ctx, permanent, dom, neg_cache_name,
-                             sss_ncache_set_user_int);
-    talloc_free(neg_cache_name);
-
-    return ret;
+    return sss_ncache_set_ent(ctx, permanent, SSS_NC_UPN, dom, name);
 }
 
 int sss_ncache_set_group(struct sss_nc_ctx *ctx, bool permanent,
                          struct sss_domain_info *dom, const char *name)
 {
-    return sss_ncache_set_ent(ctx, permanent, dom, name, sss_ncache_set_group_int);
+    return sss_ncache_set_ent(ctx, permanent, SSS_NC_GROUP, dom, name);
 }
 
 int sss_ncache_set_netgr(struct sss_nc_ctx *ctx, bool permanent,
                          struct sss_domain_info *dom, const char *name)
 {
-    return sss_ncache_set_ent(ctx, permanent, dom, name, sss_ncache_set_netgr_int);
+    return sss_ncache_set_ent(ctx, permanent, SSS_NC_NETGROUP, dom, name);
 }
 
 int sss_ncache_set_uid(struct sss_nc_ctx *ctx, bool permanent,
                        struct sss_domain_info *dom, uid_t uid)
 {
     bool use_local_negative = false;
-    char *str;
-    int ret;
-
-    if (dom != NULL) {
-        str = talloc_asprintf(ctx, "%s/%s/%"SPRIuid, NC_UID_PREFIX, dom->name,
-                              uid);
-    } else {
-        str = talloc_asprintf(ctx, "%s/%"SPRIuid, NC_UID_PREFIX, uid);
-    }
-    if (!str) return ENOMEM;
 
     if ((!permanent) && (ctx->local_timeout > 0)) {
         use_local_negative = is_user_local_by_uid(&ctx->ops, uid);
     }
-    ret = sss_ncache_set_str(ctx, str, permanent, use_local_negative);
 
-    talloc_free(str);
-    return ret;
+    return sss_ncache_set_id(ctx, permanent, SSS_NC_UID, dom, uid,
+                             use_local_negative);
 }
 
 int sss_ncache_set_gid(struct sss_nc_ctx *ctx, bool permanent,
                        struct sss_domain_info *dom, gid_t gid)
 {
     bool use_local_negative = false;
-    char *str;
-    int ret;
-
-    if (dom != NULL) {
-        str = talloc_asprintf(ctx, "%s/%s/%"SPRIgid, NC_GID_PREFIX, dom->name,
-                              gid);
-    } else {
-        str = talloc_asprintf(ctx, "%s/%"SPRIgid, NC_GID_PREFIX, gid);
-    }
-    if (!str) return ENOMEM;
 
     if ((!permanent) && (ctx->local_timeout > 0)) {
         use_local_negative = is_group_local_by_gid(&ctx->ops, gid);
     }
-    ret = sss_ncache_set_str(ctx, str, permanent, use_local_negative);
 
-    talloc_free(str);
-    return ret;
+    return sss_ncache_set_id(ctx, permanent, SSS_NC_GID, dom, gid,
+                             use_local_negative);
 }
 
 int sss_ncache_set_sid(struct sss_nc_ctx *ctx, bool permanent,
                        struct sss_domain_info *dom, const char *sid)
 {
-    char *str;
-    int ret;
-
-    if (dom != NULL) {
-        str = talloc_asprintf(ctx, "%s/%s/%s", NC_SID_PREFIX, dom->name, sid);
-    } else {
-        str = talloc_asprintf(ctx, "%s/%s", NC_SID_PREFIX, sid);
-    }
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_set_str(ctx, str, permanent, false);
-
-    talloc_free(str);
-    return ret;
+    return sss_ncache_set_name(ctx, permanent, SSS_NC_SID, dom, sid);
 }
 
 int sss_ncache_set_cert(struct sss_nc_ctx *ctx, bool permanent,
                         const char *cert)
 {
-    char *str;
-    int ret;
-
-    str = talloc_asprintf(ctx, "%s/%s", NC_CERT_PREFIX, cert);
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_set_str(ctx, str, permanent, false);
-
-    talloc_free(str);
-    return ret;
-}
-
-static char *domain_lookup_type_str(TALLOC_CTX *mem_ctx,
-                                    struct sss_domain_info *dom,
-                                    const char *lookup_type)
-{
-    return talloc_asprintf(mem_ctx,
-                           "%s/%s/%s",
-                           NC_DOMAIN_ACCT_LOCATE_TYPE_PREFIX,
-                           dom->name,
-                           lookup_type);
+    return sss_ncache_set_name(ctx, permanent, SSS_NC_CERT, NULL, cert);
 }
 
 int sss_ncache_set_domain_locate_type(struct sss_nc_ctx *ctx,
                                       struct sss_domain_info *dom,
                                       const char *lookup_type)
 {
-    char *str;
-    int ret;
-
-    str = domain_lookup_type_str(ctx, dom, lookup_type);
-    if (!str) return ENOMEM;
-
     /* Permanent cache is always used here, because the lookup
      * type's (getgrgid, getpwuid, ..) support locating an entry's domain
      * doesn't change
      */
-    ret = sss_ncache_set_str(ctx, str, true, false);
-    talloc_free(str);
-    return ret;
+    return sss_ncache_set_name(ctx, true, SSS_NC_DOMAIN_LOCATE_TYPE,
+                               dom, lookup_type);
 }
 
 int sss_ncache_check_domain_locate_type(struct sss_nc_ctx *ctx,
                                         struct sss_domain_info *dom,
                                         const char *lookup_type)
 {
-    char *str;
-    int ret;
-
-    str = domain_lookup_type_str(ctx, dom, lookup_type);
-    if (!str) return ENOMEM;
-
-    ret = sss_ncache_check_str(ctx, str);
-    talloc_free(str);
-    return ret;
-}
-
-static char *locate_gid_str(TALLOC_CTX *mem_ctx,
-                            struct sss_domain_info *dom,
-                            gid_t gid)
-{
-    return talloc_asprintf(mem_ctx,
-                           "%s/%s/%s/%"SPRIgid,
-                           NC_DOMAIN_ACCT_LOCATE_PREFIX,
-                           NC_GID_PREFIX,
-                           dom->name,
-                           gid);
+    return sss_ncache_check_name(ctx, SSS_NC_DOMAIN_LOCATE_TYPE,
+                                 dom, lookup_type);
 }
 
 int sss_ncache_set_locate_gid(struct sss_nc_ctx *ctx,
                               struct sss_domain_info *dom,
                               gid_t gid)
 {
-    char *str;
-    int ret;
-
     if (dom == NULL) {
         return EINVAL;
     }
 
-    str = locate_gid_str(ctx, dom, gid);
-    if (str == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_ncache_set_str(ctx, str, false, false);
-    talloc_free(str);
-    return ret;
+    return sss_ncache_set_id(ctx, false, SSS_NC_DOMAIN_LOCATE_GID, dom, gid,
+                             false);
 }
 
 int sss_ncache_check_locate_gid(struct sss_nc_ctx *ctx,
                                 struct sss_domain_info *dom,
                                 gid_t gid)
 {
-    char *str;
-    int ret;
-
     if (dom == NULL) {
         return EINVAL;
     }
 
-    str = locate_gid_str(ctx, dom, gid);
-    if (str == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_ncache_check_str(ctx, str);
-    talloc_free(str);
-    return ret;
-}
-
-static char *locate_uid_str(struct sss_nc_ctx *ctx,
-                            struct sss_domain_info *dom,
-                            uid_t uid)
-{
-    return talloc_asprintf(ctx,
-                           "%s/%s/%s/%"SPRIuid,
-                           NC_DOMAIN_ACCT_LOCATE_PREFIX,
-                           NC_UID_PREFIX,
-                           dom->name,
-                           uid);
+    return sss_ncache_check_id(ctx, SSS_NC_DOMAIN_LOCATE_GID, dom, gid);
 }
 
 int sss_ncache_set_locate_uid(struct sss_nc_ctx *ctx,
                               struct sss_domain_info *dom,
                               uid_t uid)
 {
-    char *str;
-    int ret;
-
     if (dom == NULL) {
         return EINVAL;
     }
 
-    str = locate_uid_str(ctx, dom, uid);
-    if (str == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_ncache_set_str(ctx, str, false, false);
-    talloc_free(str);
-    return ret;
+    return sss_ncache_set_id(ctx, false, SSS_NC_DOMAIN_LOCATE_UID, dom, uid,
+                             false);
 }
 
 int sss_ncache_check_locate_uid(struct sss_nc_ctx *ctx,
                                 struct sss_domain_info *dom,
                                 uid_t uid)
 {
-    char *str;
-    int ret;
-
     if (dom == NULL) {
         return EINVAL;
     }
 
-    str = locate_uid_str(ctx, dom, uid);
-    if (str == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_ncache_check_str(ctx, str);
-    talloc_free(str);
-    return ret;
-}
-
-static char *locate_sid_str(struct sss_nc_ctx *ctx,
-                            struct sss_domain_info *dom,
-                            const char *sid)
-{
-    return talloc_asprintf(ctx,
-                           "%s/%s/%s/%s",
-                           NC_DOMAIN_ACCT_LOCATE_PREFIX,
-                           NC_SID_PREFIX,
-                           dom->name,
-                           sid);
+    return sss_ncache_check_id(ctx, SSS_NC_DOMAIN_LOCATE_UID, dom, uid);
 }
 
 int sss_ncache_check_locate_sid(struct sss_nc_ctx *ctx,
                                 struct sss_domain_info *dom,
                                 const char *sid)
 {
-    char *str;
-    int ret;
-
     if (dom == NULL) {
         return EINVAL;
     }
 
-    str = locate_sid_str(ctx, dom, sid);
-    if (str == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_ncache_check_str(ctx, str);
-    talloc_free(str);
-    return ret;
+    return sss_ncache_check_name(ctx, SSS_NC_DOMAIN_LOCATE_SID, dom, sid);
 }
 
 int sss_ncache_set_locate_sid(struct sss_nc_ctx *ctx,
                               struct sss_domain_info *dom,
                               const char *sid)
 {
-    char *str;
-    int ret;
-
     if (dom == NULL) {
         return EINVAL;
     }
 
-    str = locate_sid_str(ctx, dom, sid);
-    if (str == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sss_ncache_set_str(ctx, str, false, false);
-    talloc_free(str);
-    return ret;
-}
-
-static int delete_permanent(struct tdb_context *tdb,
-                            TDB_DATA key, TDB_DATA data, void *state)
-{
-    unsigned long long int timestamp;
-    bool remove_key = false;
-    char *ep;
-
-    if (strncmp((char *)key.dptr,
-                NC_ENTRY_PREFIX, sizeof(NC_ENTRY_PREFIX) - 1) != 0) {
-        /* not interested in this key */
-        return 0;
-    }
-
-    errno = 0;
-    timestamp = strtoull((const char *)data.dptr, &ep, 10);
-    if (errno != 0 || *ep != '\0') {
-        /* Malformed entry, remove it */
-        remove_key = true;
-        goto done;
-    }
-
-    if (timestamp == 0) {
-        /* a 0 timestamp means this is a permanent entry */
-        remove_key = true;
-    }
-
-done:
-    if (remove_key) {
-        return tdb_delete(tdb, key);
-    }
-
-    return 0;
+    return sss_ncache_set_name(ctx, false, SSS_NC_DOMAIN_LOCATE_SID,
+                               dom, sid);
 }
 
+/* Stale entries are not removed here, they are dropped when they are
+ * looked up again or when their shard needs to grow. */
 int sss_ncache_reset_permanent(struct sss_nc_ctx *ctx)
 {
-    int ret;
-
-    ret = tdb_traverse(ctx->tdb, delete_permanent, NULL);
-    if (ret < 0)
-        return EIO;
+    ctx->perm_gen++;
 
     return EOK;
 }
 
-static int delete_prefix(struct tdb_context *tdb,
-                         TDB_DATA key, TDB_DATA data, void *state)
-{
-    const char *prefix = (const char *) state;
-    unsigned long long int timestamp;
-    char *ep = NULL;
-
-    if (strncmp((char *)key.dptr, prefix, strlen(prefix) - 1) != 0) {
-        /* not interested in this key */
-        return 0;
-    }
-
-    errno = 0;
-    timestamp = strtoull((const char *)data.dptr, &ep, 10);
-    if ((errno == 0) && (*ep == '\0') && (timestamp == 0)) {
-        /* skip permanent entries */
-        return 0;
-    }
-
-    return tdb_delete(tdb, key);
-}
-
-static int sss_ncache_reset_pfx(struct sss_nc_ctx *ctx,
-                                const char **prefixes)
+static int sss_ncache_reset_types(struct sss_nc_ctx *ctx,
+                                  const enum sss_nc_type *types)
 {
-    int ret;
-
-    if (prefixes == NULL) {
-        return EOK;
-    }
-
-    for (int i = 0; prefixes[i] != NULL; i++) {
-        ret = tdb_traverse(ctx->tdb,
-                           delete_prefix,
-                           discard_const(prefixes[i]));
-        if (ret < 0) {
-            return EIO;
-        }
+    for (int i = 0; types[i] != SSS_NC_TYPE_SENTINEL; i++) {
+        ctx->type_gen[types[i]]++;
     }
 
     return EOK;
@@ -1005,24 +887,33 @@ static int sss_ncache_reset_pfx(struct sss_nc_ctx *ctx,
 
 int sss_ncache_reset_users(struct sss_nc_ctx *ctx)
 {
-    const char *prefixes[] = {
-        NC_USER_PREFIX,
-        NC_UID_PREFIX,
-        NULL,
+    const enum sss_nc_type types[] = {
+        SSS_NC_USER,
+        SSS_NC_UPN,
+        SSS_NC_UID,
+        SSS_NC_TYPE_SENTINEL,
     };
 
-    return sss_ncache_reset_pfx(ctx, prefixes);
+    if (ctx->shared != NULL) {
+        sss_nc_shared_reset(ctx->shared, SSS_NC_SHARED_USERS);
+    }
+
+    return sss_ncache_reset_types(ctx, types);
 }
 
 int sss_ncache_reset_groups(struct sss_nc_ctx *ctx)
 {
-    const char *prefixes[] = {
-        NC_GROUP_PREFIX,
-        NC_GID_PREFIX,
-        NULL,
+    const enum sss_nc_type types[] = {
+        SSS_NC_GROUP,
+        SSS_NC_GID,
+        SSS_NC_TYPE_SENTINEL,
     };
 
-    return sss_ncache_reset_pfx(ctx, prefixes);
+    if (ctx->shared != NULL) {
+        sss_nc_shared_reset(ctx->shared, SSS_NC_SHARED_GROUPS);
+    }
+
+    return sss_ncache_reset_types(ctx, types);
 }
 
 errno_t sss_ncache_prepopulate(struct sss_nc_ctx *ncache,
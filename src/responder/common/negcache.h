@@ -30,6 +30,10 @@ int sss_ncache_init(TALLOC_CTX *memctx, uint32_t timeout,
 
 uint32_t sss_ncache_get_timeout(struct sss_nc_ctx *ctx);
 
+/* share the not permanent user and group entries with the other responders
+ * through the segment created by the monitor */
+errno_t sss_ncache_attach_shared(struct sss_nc_ctx *ctx, const char *path);
+
 /* check if the user is expired according to the passed in time to live */
 int sss_ncache_check_user(struct sss_nc_ctx *ctx, struct sss_domain_info *dom,
                           const char *name);
@@ -0,0 +1,358 @@
+/*
+   SSSD
+
+   Negative cache shared between responders
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "util/util.h"
+#include "responder/common/negcache_shared.h"
+
+/* The segment is a fixed size open addressing table. Each slot is
+ * protected by its own sequence counter, which is odd while a writer
+ * updates the slot, so responders never block each other. A slot that is
+ * being written is simply skipped: a missed negative entry only costs one
+ * more lookup in the data provider. */
+
+#define SSS_NC_SHARED_MAGIC 0x4e43534d /* NCSM */
+#define SSS_NC_SHARED_VERSION 1
+#define SSS_NC_SHARED_SLOTS (64 * 1024)
+#define SSS_NC_SHARED_PROBE 8
+#define SSS_NC_SHARED_HEADER_SIZE 64
+
+struct sss_nc_shared_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_slots;
+    uint32_t reserved;
+    uint32_t gen[SSS_NC_SHARED_CLASS_NUM];
+};
+
+struct sss_nc_shared_slot {
+    uint32_t seq;
+    uint32_t cls;
+    uint32_t gen;
+    uint32_t reserved;
+    uint64_t key;           /* 0 if the slot was never used */
+    int64_t expire;
+};
+
+struct sss_nc_shared {
+    void *mmap_base;
+    size_t mmap_size;
+    struct sss_nc_shared_header *header;
+    struct sss_nc_shared_slot *slots;
+    uint32_t mask;
+};
+
+static size_t sss_nc_shared_size(uint32_t n_slots)
+{
+    return SSS_NC_SHARED_HEADER_SIZE
+           + (size_t)n_slots * sizeof(struct sss_nc_shared_slot);
+}
+
+errno_t sss_nc_shared_create(const char *path)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_nc_shared_header header = { 0 };
+    char *tmp_path;
+    ssize_t written;
+    int fd = -1;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    tmp_path = talloc_asprintf(tmp_ctx, "%s.tmp", path);
+    if (tmp_path == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to create %s: %d(%s)\n",
+              tmp_path, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /* the slots are zero filled, which marks them as unused */
+    ret = ftruncate(fd, sss_nc_shared_size(SSS_NC_SHARED_SLOTS));
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to resize %s: %d(%s)\n",
+              tmp_path, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    header.magic = SSS_NC_SHARED_MAGIC;
+    header.version = SSS_NC_SHARED_VERSION;
+    header.n_slots = SSS_NC_SHARED_SLOTS;
+
+    written = sss_atomic_write_s(fd, &header, sizeof(header));
+    if (written != sizeof(header)) {
+        ret = written == -1 ? errno : EIO;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to write header of %s: %d(%s)\n",
+              tmp_path, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /* responders that still map the previous segment keep using it */
+    ret = rename(tmp_path, path);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to rename %s to %s: %d(%s)\n",
+              tmp_path, path, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Created shared negative cache %s\n", path);
+    ret = EOK;
+
+done:
+    if (fd != -1) {
+        close(fd);
+        if (ret != EOK) {
+            unlink(tmp_path);
+        }
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static int sss_nc_shared_destructor(struct sss_nc_shared *nc_shared)
+{
+    int ret;
+
+    if (nc_shared->mmap_base != NULL) {
+        ret = munmap(nc_shared->mmap_base, nc_shared->mmap_size);
+        if (ret == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Failed to unmap shared negative cache: %d(%s)\n",
+                  ret, sss_strerror(ret));
+        }
+    }
+
+    return 0;
+}
+
+errno_t sss_nc_shared_open(TALLOC_CTX *mem_ctx, const char *path,
+                           struct sss_nc_shared **_nc_shared)
+{
+    struct sss_nc_shared *nc_shared;
+    struct sss_nc_shared_header *header;
+    struct stat fdstat;
+    int fd;
+    errno_t ret;
+
+    nc_shared = talloc_zero(mem_ctx, struct sss_nc_shared);
+    if (nc_shared == NULL) {
+        return ENOMEM;
+    }
+    talloc_set_destructor(nc_shared, sss_nc_shared_destructor);
+
+    fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    ret = fstat(fd, &fdstat);
+    if (ret == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    if (fdstat.st_size < SSS_NC_SHARED_HEADER_SIZE) {
+        ret = EINVAL;
+        goto done;
+    }
+
+    nc_shared->mmap_size = fdstat.st_size;
+    nc_shared->mmap_base = mmap(NULL, nc_shared->mmap_size,
+                                PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (nc_shared->mmap_base == MAP_FAILED) {
+        ret = errno;
+        nc_shared->mmap_base = NULL;
+        goto done;
+    }
+
+    header = nc_shared->mmap_base;
+    if (header->magic != SSS_NC_SHARED_MAGIC
+            || header->version != SSS_NC_SHARED_VERSION
+            || header->n_slots == 0
+            || (header->n_slots & (header->n_slots - 1)) != 0
+            || sss_nc_shared_size(header->n_slots) > nc_shared->mmap_size) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Shared negative cache %s is not valid\n", path);
+        ret = EINVAL;
+        goto done;
+    }
+
+    nc_shared->header = header;
+    nc_shared->slots = (struct sss_nc_shared_slot *)
+                ((uint8_t *)nc_shared->mmap_base + SSS_NC_SHARED_HEADER_SIZE);
+    nc_shared->mask = header->n_slots - 1;
+
+    *_nc_shared = nc_shared;
+    ret = EOK;
+
+done:
+    if (fd != -1) {
+        close(fd);
+    }
+    if (ret != EOK) {
+        talloc_free(nc_shared);
+    }
+    return ret;
+}
+
+static uint32_t sss_nc_shared_gen(struct sss_nc_shared *nc_shared,
+                                  uint32_t cls)
+{
+    if (cls >= SSS_NC_SHARED_CLASS_NUM) {
+        return UINT32_MAX;
+    }
+
+    return __atomic_load_n(&nc_shared->header->gen[cls], __ATOMIC_ACQUIRE);
+}
+
+/* Returns false if the slot was being written while it was read */
+static bool sss_nc_shared_read(struct sss_nc_shared_slot *slot,
+                               struct sss_nc_shared_slot *copy)
+{
+    uint32_t seq;
+
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+        return false;
+    }
+
+    copy->cls = __atomic_load_n(&slot->cls, __ATOMIC_RELAXED);
+    copy->gen = __atomic_load_n(&slot->gen, __ATOMIC_RELAXED);
+    copy->key = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+    copy->expire = __atomic_load_n(&slot->expire, __ATOMIC_RELAXED);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq;
+}
+
+static bool sss_nc_shared_valid(struct sss_nc_shared *nc_shared,
+                                struct sss_nc_shared_slot *copy,
+                                time_t now)
+{
+    return copy->key != 0
+           && copy->gen == sss_nc_shared_gen(nc_shared, copy->cls)
+           && copy->expire >= now;
+}
+
+bool sss_nc_shared_check(struct sss_nc_shared *nc_shared,
+                         enum sss_nc_shared_class cls,
+                         uint64_t key, time_t now)
+{
+    struct sss_nc_shared_slot copy;
+    uint32_t i;
+
+    if (key == 0) {
+        key = 1;
+    }
+
+    for (i = 0; i < SSS_NC_SHARED_PROBE; i++) {
+        if (!sss_nc_shared_read(&nc_shared->slots[(key + i) & nc_shared->mask],
+                                &copy)) {
+            continue;
+        }
+
+        if (copy.key == key && copy.cls == cls) {
+            return sss_nc_shared_valid(nc_shared, &copy, now);
+        }
+    }
+
+    return false;
+}
+
+void sss_nc_shared_set(struct sss_nc_shared *nc_shared,
+                       enum sss_nc_shared_class cls,
+                       uint64_t key, time_t expire)
+{
+    struct sss_nc_shared_slot *victim = NULL;
+    struct sss_nc_shared_slot *slot;
+    struct sss_nc_shared_slot copy;
+    int64_t victim_expire = INT64_MAX;
+    time_t now = time(NULL);
+    uint32_t seq;
+    uint32_t i;
+
+    if (key == 0) {
+        key = 1;
+    }
+
+    /* Reuse the slot of the same key, otherwise the first unused one or
+     * the one that expires first. */
+    for (i = 0; i < SSS_NC_SHARED_PROBE; i++) {
+        slot = &nc_shared->slots[(key + i) & nc_shared->mask];
+        if (!sss_nc_shared_read(slot, &copy)) {
+            continue;
+        }
+
+        if (copy.key == key && copy.cls == cls) {
+            victim = slot;
+            break;
+        }
+
+        if (!sss_nc_shared_valid(nc_shared, &copy, now)) {
+            copy.expire = INT64_MIN;
+        }
+
+        if (copy.expire < victim_expire) {
+            victim = slot;
+            victim_expire = copy.expire;
+        }
+    }
+
+    if (victim == NULL) {
+        return;
+    }
+
+    seq = __atomic_load_n(&victim->seq, __ATOMIC_RELAXED);
+    if ((seq & 1)
+            || !__atomic_compare_exchange_n(&victim->seq, &seq, seq + 1,
+                                            false, __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED)) {
+        /* another responder is writing the slot */
+        return;
+    }
+
+    __atomic_store_n(&victim->cls, cls, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->gen, sss_nc_shared_gen(nc_shared, cls),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->key, key, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->expire, (int64_t)expire, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&victim->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void sss_nc_shared_reset(struct sss_nc_shared *nc_shared,
+                         enum sss_nc_shared_class cls)
+{
+    __atomic_add_fetch(&nc_shared->header->gen[cls], 1, __ATOMIC_RELEASE);
+}
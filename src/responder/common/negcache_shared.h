@@ -0,0 +1,59 @@
+/*
+   SSSD
+
+   Negative cache shared between responders
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _NEGCACHE_SHARED_H_
+#define _NEGCACHE_SHARED_H_
+
+#include "util/util.h"
+
+/* The segment is created by the monitor before any responder is started
+ * and mapped by every responder in responder_init_ncache(). */
+#define SSS_NC_SHARED_PATH DB_PATH"/negcache_shared"
+
+/* Entries of one class are all invalidated at once by
+ * sss_nc_shared_reset() */
+enum sss_nc_shared_class {
+    SSS_NC_SHARED_USERS = 0,
+    SSS_NC_SHARED_GROUPS,
+
+    SSS_NC_SHARED_CLASS_NUM
+};
+
+struct sss_nc_shared;
+
+/* Create a new empty segment, atomically replacing the existing one */
+errno_t sss_nc_shared_create(const char *path);
+
+errno_t sss_nc_shared_open(TALLOC_CTX *mem_ctx, const char *path,
+                           struct sss_nc_shared **_nc_shared);
+
+/* Entries are identified by a 64 bit fingerprint of their key only, the
+ * caller is responsible for computing it from the whole key. */
+bool sss_nc_shared_check(struct sss_nc_shared *nc_shared,
+                         enum sss_nc_shared_class cls,
+                         uint64_t key, time_t now);
+
+void sss_nc_shared_set(struct sss_nc_shared *nc_shared,
+                       enum sss_nc_shared_class cls,
+                       uint64_t key, time_t expire);
+
+void sss_nc_shared_reset(struct sss_nc_shared *nc_shared,
+                         enum sss_nc_shared_class cls);
+
+#endif /* _NEGCACHE_SHARED_H_ */
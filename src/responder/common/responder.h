@@ -50,13 +50,22 @@ extern hash_table_t *dp_requests;
 #define SCKT_RSP_UMASK 0111
 
 /* needed until nsssrv.h is updated */
+struct cache_req_hot_cache;
+
 struct cli_request {
+    struct cli_request *prev;
+    struct cli_request *next;
 
     /* original request from the wire */
     struct sss_packet *in;
 
     /* reply data */
     struct sss_packet *out;
+
+    /* for the statistics: when the request was read, in microseconds, and
+     * its position in the command table */
+    uint64_t recv_time;
+    unsigned int cmd_index;
 };
 
 struct cli_protocol_version {
@@ -68,6 +77,13 @@ struct cli_protocol_version {
 struct cli_protocol {
     struct cli_request *creq;
     struct cli_protocol_version *cli_protocol_version;
+
+    /* Set once the client asked for SSS_CLI_FEATURE_PIPELINE. Every request
+     * is then executed by a cli_ctx of its own and the finished replies are
+     * queued in out_queue until they can be written to the socket. */
+    bool pipelined;
+    struct cli_request *out_queue;
+    unsigned int num_inflight;
 };
 
 struct resp_ctx {
@@ -118,12 +134,31 @@ struct resp_ctx {
     uint32_t cache_req_num;
     uint32_t client_id_num;
 
+    /* cache requests in progress, see cache_req_send() */
+    hash_table_t *cr_flights;
+    uint64_t cr_flights_started;
+    uint64_t cr_flights_merged;
+
+    /* recently found objects, see cache_req_search_cache_send() */
+    struct cache_req_hot_cache *cr_hot_cache;
+    int result_cache_size;
+    int result_cache_timeout;
+
+    /* reader children searching the cache, see sysdb_readers_init() */
+    struct sysdb_readers *sysdb_readers;
+
     void *pvt_ctx;
 
     bool shutting_down;
     bool socket_activated;
     bool cache_first;
+    bool parallel_domain_lookup;
     bool enumeration_warn_logged;
+    /* the responder can handle pipelined connections */
+    bool pipelining;
+
+    /* latency histograms, see responder_stats.h */
+    struct resp_stats *stats;
 };
 
 struct cli_creds;
@@ -146,6 +181,10 @@ struct cli_ctx {
     struct tevent_timer *idle;
     time_t last_request_time;
     uint32_t client_id_num;
+
+    /* connection this request arrived on, NULL unless the client ctx was
+     * created for a single request of a pipelined connection */
+    struct cli_ctx *conn;
 };
 
 struct sss_cmd_table {
@@ -188,7 +227,6 @@ responder_get_domain(struct resp_ctx *rctx, const char *domain);
 errno_t responder_get_domain_by_id(struct resp_ctx *rctx, const char *id,
                                    struct sss_domain_info **_ret_dom);
 
-int create_pipe_fd(const char *sock_name, int *_fd, mode_t umaskval);
 int activate_unix_sockets(struct resp_ctx *rctx,
                           connection_setup_t conn_setup);
 
@@ -23,6 +23,7 @@
 #include "util/util.h"
 #include "responder/common/responder.h"
 #include "responder/common/responder_packet.h"
+#include "responder/common/responder_stats.h"
 
 
 int sss_cmd_send_error(struct cli_ctx *cctx, int err)
@@ -91,8 +92,55 @@ int sss_cmd_send_empty(struct cli_ctx *cctx)
     return EOK;
 }
 
+static void sss_cmd_done_pipelined(struct cli_ctx *cctx)
+{
+    struct cli_protocol *conn_pctx;
+    struct cli_protocol *pctx;
+    struct cli_request *creq;
+
+    conn_pctx = talloc_get_type(cctx->conn->protocol_ctx, struct cli_protocol);
+    pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
+    creq = pctx->creq;
+
+    /* the client matches the reply to its request by the id */
+    sss_packet_set_id(creq->out, sss_packet_get_id(creq->in));
+
+    /* queue the reply on the connection, the request context is freed
+     * together with it once it is sent */
+    talloc_steal(conn_pctx, creq);
+    talloc_steal(creq, cctx);
+    DLIST_ADD_END(conn_pctx->out_queue, creq, struct cli_request *);
+}
+
+static void sss_cmd_record_stats(struct cli_ctx *cctx)
+{
+    struct cli_protocol *pctx;
+    struct cli_request *creq;
+
+    pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
+    if (pctx == NULL || pctx->creq == NULL || pctx->creq->recv_time == 0) {
+        return;
+    }
+    creq = pctx->creq;
+
+    resp_stats_cmd_record(cctx->rctx->stats, creq->cmd_index,
+                          RESP_STATS_CMD_TOTAL,
+                          get_spend_time_us(creq->recv_time));
+    if (creq->out != NULL) {
+        resp_stats_cmd_record(cctx->rctx->stats, creq->cmd_index,
+                              RESP_STATS_CMD_REPLY_SIZE,
+                              sss_packet_get_len(creq->out));
+    }
+}
+
 void sss_cmd_done(struct cli_ctx *cctx, void *freectx)
 {
+    sss_cmd_record_stats(cctx);
+
+    if (cctx->conn != NULL) {
+        sss_cmd_done_pipelined(cctx);
+    }
+
     /* now that the packet is in place, unlock queue
      * making the event writable */
     TEVENT_FD_WRITEABLE(cctx->cfde);
@@ -105,12 +153,13 @@ int sss_cmd_get_version(struct cli_ctx *cctx)
 {
     struct cli_protocol *pctx;
     uint8_t *req_body;
-    size_t req_blen;
+    size_t req_blen = 0;
     uint8_t *body;
     size_t blen;
     int ret;
     uint32_t client_version;
     uint32_t protocol_version;
+    uint32_t features = 0;
     int i;
     static struct cli_protocol_version *cli_protocol_version = NULL;
 
@@ -127,7 +176,8 @@ int sss_cmd_get_version(struct cli_ctx *cctx)
         pctx->cli_protocol_version = &cli_protocol_version[0];
 
         sss_packet_get_body(pctx->creq->in, &req_body, &req_blen);
-        if (req_blen == sizeof(uint32_t)) {
+        if (req_blen == sizeof(uint32_t)
+                || req_blen == 2 * sizeof(uint32_t)) {
             memcpy(&client_version, req_body, sizeof(uint32_t));
             DEBUG(SSSDBG_FUNC_DATA,
                   "Received client version [%d].\n", client_version);
@@ -141,10 +191,26 @@ int sss_cmd_get_version(struct cli_ctx *cctx)
                 i++;
             }
         }
+
+        /* clients which know about features send them after the version */
+        if (req_blen == 2 * sizeof(uint32_t)) {
+            memcpy(&features, req_body + sizeof(uint32_t), sizeof(uint32_t));
+            DEBUG(SSSDBG_FUNC_DATA,
+                  "Received client features [%#x].\n", features);
+        }
+    }
+
+    /* offer only the features this responder supports */
+    if (cctx->rctx->pipelining && cctx->conn == NULL) {
+        features &= SSS_CLI_FEATURE_PIPELINE;
+    } else {
+        features = 0;
     }
 
     /* create response packet */
-    ret = sss_packet_new(pctx->creq, sizeof(uint32_t),
+    ret = sss_packet_new(pctx->creq,
+                         (req_blen == 2 * sizeof(uint32_t))
+                                ? 2 * sizeof(uint32_t) : sizeof(uint32_t),
                          sss_packet_get_cmd(pctx->creq->in),
                          &pctx->creq->out);
     if (ret != EOK) {
@@ -158,6 +224,15 @@ int sss_cmd_get_version(struct cli_ctx *cctx)
     SAFEALIGN_COPY_UINT32(body, &protocol_version, NULL);
     DEBUG(SSSDBG_FUNC_DATA, "Offered version [%d].\n", protocol_version);
 
+    if (blen == 2 * sizeof(uint32_t)) {
+        SAFEALIGN_COPY_UINT32(body + sizeof(uint32_t), &features, NULL);
+        DEBUG(SSSDBG_FUNC_DATA, "Offered features [%#x].\n", features);
+
+        if (features & SSS_CLI_FEATURE_PIPELINE) {
+            pctx->pipelined = true;
+        }
+    }
+
     sss_cmd_done(cctx, NULL);
     return EOK;
 }
@@ -166,10 +241,21 @@ int sss_cmd_execute(struct cli_ctx *cctx,
                     enum sss_cli_command cmd,
                     struct sss_cmd_table *sss_cmds)
 {
+    struct cli_protocol *pctx;
     int i;
 
+    pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
+
     for (i = 0; sss_cmds[i].cmd != SSS_CLI_NULL; i++) {
         if (cmd == sss_cmds[i].cmd) {
+            if (pctx != NULL && pctx->creq != NULL
+                    && pctx->creq->recv_time != 0) {
+                pctx->creq->cmd_index = i;
+                resp_stats_cmd_record(cctx->rctx->stats, i,
+                                      RESP_STATS_CMD_QUEUE,
+                                      get_spend_time_us(pctx->creq->recv_time));
+            }
+
             return sss_cmds[i].fn(cctx);
         }
     }
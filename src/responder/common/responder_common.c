@@ -39,6 +39,8 @@
 #include "confdb/confdb.h"
 #include "responder/common/responder.h"
 #include "responder/common/responder_packet.h"
+#include "responder/common/responder_stats.h"
+#include "responder/common/negcache_shared.h"
 #include "providers/data_provider.h"
 #include "util/util_creds.h"
 #include "sss_iface/sss_iface_async.h"
@@ -52,28 +54,6 @@
 #define SHELL_REALLOC_INCREMENT 5
 #define SHELL_REALLOC_MAX       50
 
-static errno_t set_close_on_exec(int fd)
-{
-    int v;
-    int ferr;
-    errno_t error;
-
-    /* Get the current flags for this file descriptor */
-    v = fcntl(fd, F_GETFD, 0);
-
-    errno = 0;
-    /* Set the close-on-exec flags on this fd */
-    ferr = fcntl(fd, F_SETFD, v | FD_CLOEXEC);
-    if (ferr < 0) {
-        error = errno;
-        DEBUG(SSSDBG_FATAL_FAILURE,
-              "Unable to set fd close-on-exec: [%d][%s]\n",
-                  error, strerror(error));
-        return error;
-    }
-    return EOK;
-}
-
 static void client_close_fn(struct tevent_context *ev,
                             struct tevent_fd *fde, int fd,
                             void *ptr)
@@ -281,6 +261,43 @@ done:
     return ret;
 }
 
+/* Maximum number of requests of one pipelined connection that are executed
+ * or wait to be sent at the same time. The connection is not read anymore
+ * until some of the replies are sent. */
+#define CLI_PIPELINE_MAX_INFLIGHT 64
+
+static void client_send_pipelined(struct cli_ctx *cctx,
+                                  struct cli_protocol *pctx)
+{
+    struct cli_request *creq;
+    int ret;
+
+    while ((creq = pctx->out_queue) != NULL) {
+        ret = sss_packet_send(creq->out, cctx->cfd);
+        if (ret == EAGAIN) {
+            /* not all data was sent, loop again */
+            return;
+        }
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Failed to send data, aborting client!\n");
+            talloc_free(cctx);
+            return;
+        }
+
+        DLIST_REMOVE(pctx->out_queue, creq);
+        /* frees also the client context of the request */
+        talloc_free(creq);
+        pctx->num_inflight--;
+    }
+
+    /* ok all sent */
+    TEVENT_FD_NOT_WRITEABLE(cctx->cfde);
+    if (pctx->num_inflight < CLI_PIPELINE_MAX_INFLIGHT) {
+        TEVENT_FD_READABLE(cctx->cfde);
+    }
+}
+
 static void client_send(struct cli_ctx *cctx)
 {
     struct cli_protocol *pctx;
@@ -288,6 +305,11 @@ static void client_send(struct cli_ctx *cctx)
 
     pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
 
+    if (pctx->creq == NULL || pctx->creq->out == NULL) {
+        client_send_pipelined(cctx, pctx);
+        return;
+    }
+
     ret = sss_packet_send(pctx->creq->out, cctx->cfd);
     if (ret == EAGAIN) {
         /* not all data was sent, loop again */
@@ -300,9 +322,13 @@ static void client_send(struct cli_ctx *cctx)
     }
 
     /* ok all sent */
+    talloc_zfree(pctx->creq);
+    if (pctx->out_queue != NULL) {
+        /* replies of a pipelined connection are waiting */
+        return;
+    }
     TEVENT_FD_NOT_WRITEABLE(cctx->cfde);
     TEVENT_FD_READABLE(cctx->cfde);
-    talloc_zfree(pctx->creq);
     return;
 }
 
@@ -316,6 +342,51 @@ static int client_cmd_execute(struct cli_ctx *cctx, struct sss_cmd_table *sss_cm
     return sss_cmd_execute(cctx, cmd, sss_cmds);
 }
 
+/* Runs the received request of a pipelined connection in a client context
+ * of its own so that the connection can be read again right away. */
+static errno_t client_cmd_execute_pipelined(struct cli_ctx *cctx,
+                                            struct cli_protocol *pctx)
+{
+    struct cli_protocol *req_pctx;
+    struct cli_ctx *req_cctx;
+
+    req_cctx = talloc_zero(cctx, struct cli_ctx);
+    if (req_cctx == NULL) {
+        return ENOMEM;
+    }
+
+    req_cctx->ev = cctx->ev;
+    req_cctx->rctx = cctx->rctx;
+    req_cctx->cfd = cctx->cfd;
+    req_cctx->cfde = cctx->cfde;
+    req_cctx->cfd_handler = cctx->cfd_handler;
+    req_cctx->addr = cctx->addr;
+    req_cctx->priv = cctx->priv;
+    req_cctx->creds = cctx->creds;
+    req_cctx->cmd_line = cctx->cmd_line;
+    req_cctx->state_ctx = cctx->state_ctx;
+    req_cctx->last_request_time = cctx->last_request_time;
+    req_cctx->client_id_num = cctx->client_id_num;
+    req_cctx->conn = cctx;
+
+    req_pctx = talloc_zero(req_cctx, struct cli_protocol);
+    if (req_pctx == NULL) {
+        talloc_free(req_cctx);
+        return ENOMEM;
+    }
+    req_pctx->cli_protocol_version = pctx->cli_protocol_version;
+    req_pctx->creq = talloc_steal(req_pctx, pctx->creq);
+    req_cctx->protocol_ctx = req_pctx;
+    pctx->creq = NULL;
+
+    pctx->num_inflight++;
+    if (pctx->num_inflight >= CLI_PIPELINE_MAX_INFLIGHT) {
+        TEVENT_FD_NOT_READABLE(cctx->cfde);
+    }
+
+    return client_cmd_execute(req_cctx, cctx->rctx->sss_cmds);
+}
+
 static void client_recv(struct cli_ctx *cctx)
 {
     struct cli_protocol *pctx;
@@ -344,9 +415,26 @@ static void client_recv(struct cli_ctx *cctx)
         }
     }
 
-    ret = sss_packet_recv(pctx->creq->in, cctx->cfd);
+    if (pctx->pipelined) {
+        ret = sss_packet_recv_one(pctx->creq->in, cctx->cfd);
+    } else {
+        ret = sss_packet_recv(pctx->creq->in, cctx->cfd);
+    }
     switch (ret) {
     case EOK:
+        pctx->creq->recv_time = get_start_time();
+        if (pctx->pipelined) {
+            ret = client_cmd_execute_pipelined(cctx, pctx);
+            if (ret != EOK) {
+                DEBUG(SSSDBG_FATAL_FAILURE,
+                      "Failed to execute request, aborting client!\n");
+                talloc_free(cctx);
+            }
+            /* past this point cctx can be freed at any time by callbacks
+             * in case of error, do not use it */
+            return;
+        }
+
         /* do not read anymore */
         TEVENT_FD_NOT_READABLE(cctx->cfde);
         /* execute command */
@@ -694,73 +782,6 @@ static errno_t setup_client_idle_timer(struct cli_ctx *cctx)
     return EOK;
 }
 
-int create_pipe_fd(const char *sock_name, int *_fd, mode_t umaskval)
-{
-    struct sockaddr_un addr;
-    mode_t orig_umaskval;
-    errno_t ret;
-    int fd;
-
-    fd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (fd == -1) {
-        return EIO;
-    }
-
-    orig_umaskval = umask(umaskval);
-
-    ret = sss_fd_nonblocking(fd);
-    if (ret != EOK) {
-        goto done;
-    }
-
-    ret = set_close_on_exec(fd);
-    if (ret != EOK) {
-        goto done;
-    }
-
-    memset(&addr, 0, sizeof(addr));
-    addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, sock_name, sizeof(addr.sun_path) - 1);
-    addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
-
-    /* make sure we have no old sockets around */
-    ret = unlink(sock_name);
-    if (ret != 0 && errno != ENOENT) {
-        ret = errno;
-        DEBUG(SSSDBG_MINOR_FAILURE,
-              "Cannot remove old socket (errno=%d [%s]), bind might fail!\n",
-              ret, sss_strerror(ret));
-    }
-
-    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_FATAL_FAILURE,
-              "Unable to bind on socket '%s' [%d]: %s\n",
-              sock_name, ret, sss_strerror(ret));
-        goto done;
-    }
-
-    if (listen(fd, 128) == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_FATAL_FAILURE,
-              "Unable to listen on socket '%s' [%d]: %s\n",
-              sock_name, ret, sss_strerror(ret));
-        goto done;
-    }
-
-    ret = EOK;
-
-done:
-    /* restore previous umask value */
-    umask(orig_umaskval);
-    if (ret == EOK) {
-        *_fd = fd;
-    } else {
-        close(fd);
-    }
-    return ret;
-}
-
 /* create a unix socket and listen to it */
 static int set_unix_socket(struct resp_ctx *rctx,
                            connection_setup_t conn_setup)
@@ -975,6 +996,15 @@ static errno_t responder_init_ncache(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    /* the responder still works with its own cache only if the monitor
+     * did not create the shared segment */
+    ret = sss_ncache_attach_shared(*ncache, SSS_NC_SHARED_PATH);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CONF_SETTINGS,
+              "Shared negative cache is not available, misses will not be "
+              "shared with other responders\n");
+    }
+
     ret = EOK;
 
 done:
@@ -1061,6 +1091,7 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
 {
     struct resp_ctx *rctx;
     struct sss_domain_info *dom;
+    int num_sysdb_readers;
     int ret;
     char *tmp = NULL;
 
@@ -1081,6 +1112,14 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
 
     talloc_set_destructor((TALLOC_CTX*)rctx, sss_responder_ctx_destructor);
 
+    ret = resp_stats_init(rctx, sss_cmds, &rctx->stats);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Cannot set up statistics [%d]: %s
+",
+              ret, sss_strerror(ret));
+        goto fail;
+    }
+
     ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
                          CONFDB_RESPONDER_CLI_IDLE_TIMEOUT,
                          CONFDB_RESPONDER_CLI_IDLE_DEFAULT_TIMEOUT,
@@ -1116,6 +1155,41 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
               ret, sss_strerror(ret));
     }
 
+    ret = confdb_get_bool(rctx->cdb, rctx->confdb_service_path,
+                          CONFDB_RESPONDER_PARALLEL_DOMAIN_LOOKUP,
+                          false, &rctx->parallel_domain_lookup);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get \"%s\", domains will be searched one by one "
+              "[%d]: %s.\n", CONFDB_RESPONDER_PARALLEL_DOMAIN_LOOKUP,
+              ret, sss_strerror(ret));
+    }
+
+    ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
+                         CONFDB_RESPONDER_RESULT_CACHE_SIZE,
+                         CONFDB_RESPONDER_RESULT_CACHE_SIZE_DEFAULT,
+                         &rctx->result_cache_size);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get \"%s\", recently found objects will not be "
+              "kept in memory [%d]: %s.\n", CONFDB_RESPONDER_RESULT_CACHE_SIZE,
+              ret, sss_strerror(ret));
+        rctx->result_cache_size = 0;
+    }
+
+    ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
+                         CONFDB_RESPONDER_RESULT_CACHE_TIMEOUT,
+                         CONFDB_RESPONDER_RESULT_CACHE_TIMEOUT_DEFAULT,
+                         &rctx->result_cache_timeout);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get \"%s\", recently found objects will not be "
+              "kept in memory [%d]: %s.\n",
+              CONFDB_RESPONDER_RESULT_CACHE_TIMEOUT,
+              ret, sss_strerror(ret));
+        rctx->result_cache_timeout = 0;
+    }
+
     ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
                          CONFDB_RESPONDER_GET_DOMAINS_TIMEOUT,
                          GET_DOMAINS_DEFAULT_TIMEOUT, &rctx->domains_timeout);
@@ -1242,6 +1316,29 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
+                         CONFDB_RESPONDER_SYSDB_READERS,
+                         CONFDB_RESPONDER_SYSDB_READERS_DEFAULT,
+                         &num_sysdb_readers);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get \"%s\", the cache will be searched by the "
+              "responder [%d]: %s.\n", CONFDB_RESPONDER_SYSDB_READERS,
+              ret, sss_strerror(ret));
+        num_sysdb_readers = 0;
+    }
+
+    if (num_sysdb_readers > 0) {
+        ret = sysdb_readers_init(rctx, rctx->ev, rctx->domains,
+                                 num_sysdb_readers, &rctx->sysdb_readers);
+        if (ret != EOK) {
+            /* non-fatal, the responder searches the cache itself */
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Unable to start the sysdb readers [%d]: %s\n",
+                  ret, sss_strerror(ret));
+        }
+    }
+
     /* after all initializations we are ready to listen on our socket */
     ret = activate_unix_sockets(rctx, conn_setup);
     if (ret != EOK) {
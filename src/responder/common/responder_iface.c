@@ -19,6 +19,8 @@
 #include "sss_iface/sss_iface_async.h"
 #include "responder/common/negcache.h"
 #include "responder/common/responder.h"
+#include "responder/common/responder_stats.h"
+#include "responder/common/cache_req/cache_req.h"
 
 #ifdef BUILD_FILES_PROVIDER
 static void set_domain_state_by_name(struct resp_ctx *rctx,
@@ -81,6 +83,7 @@ sss_resp_reset_ncache_users(TALLOC_CTX *mem_ctx,
                             struct resp_ctx *rctx)
 {
     sss_ncache_reset_users(rctx->ncache);
+    cache_req_hot_cache_clear(rctx);
 
     return EOK;
 }
@@ -91,6 +94,31 @@ sss_resp_reset_ncache_groups(TALLOC_CTX *mem_ctx,
                             struct resp_ctx *rctx)
 {
     sss_ncache_reset_groups(rctx->ncache);
+    cache_req_hot_cache_clear(rctx);
+
+    return EOK;
+}
+
+static errno_t
+sss_resp_get_stats(TALLOC_CTX *mem_ctx,
+                   struct sbus_request *sbus_req,
+                   struct resp_ctx *rctx,
+                   const char ***_names,
+                   uint64_t **_values)
+{
+    size_t num;
+
+    return resp_stats_get(mem_ctx, rctx->stats, _names, _values, &num);
+}
+
+static errno_t
+sss_resp_reset_stats(TALLOC_CTX *mem_ctx,
+                     struct sbus_request *sbus_req,
+                     struct resp_ctx *rctx)
+{
+    DEBUG(SSSDBG_TRACE_FUNC, "Resetting statistics\n");
+
+    resp_stats_reset(rctx->stats);
 
     return EOK;
 }
@@ -101,6 +129,16 @@ sss_resp_register_sbus_iface(struct sbus_connection *conn,
 {
     errno_t ret;
 
+    SBUS_INTERFACE(iface_stats,
+        sssd_Responder_Statistics,
+        SBUS_METHODS(
+            SBUS_SYNC(METHOD, sssd_Responder_Statistics, Get, sss_resp_get_stats, rctx),
+            SBUS_SYNC(METHOD, sssd_Responder_Statistics, Reset, sss_resp_reset_stats, rctx)
+        ),
+        SBUS_SIGNALS(SBUS_NO_SIGNALS),
+        SBUS_PROPERTIES(SBUS_NO_PROPERTIES)
+    );
+
     struct sbus_listener listeners[] = SBUS_LISTENERS(
 #ifdef BUILD_FILES_PROVIDER
         SBUS_LISTEN_SYNC(sssd_Responder_Domain, SetActive,
@@ -118,6 +156,13 @@ sss_resp_register_sbus_iface(struct sbus_connection *conn,
     if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE, "Unable to add listeners [%d]: %s\n",
               ret, sss_strerror(ret));
+        return ret;
+    }
+
+    ret = sbus_connection_add_path(conn, SSS_BUS_PATH, &iface_stats);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to register statistics interface "
+              "[%d]: %s\n", ret, sss_strerror(ret));
     }
 
     return ret;
@@ -21,6 +21,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <string.h>
 #include <errno.h>
 #include <talloc.h>
@@ -30,6 +31,19 @@
 
 #define SSSSRV_PACKET_MEM_SIZE 512
 
+/* Maximum number of pieces sent by one sendmsg() call */
+#define SSSSRV_PACKET_MAX_IOV 64
+
+struct sss_packet_chunk {
+    struct sss_packet_chunk *prev;
+    struct sss_packet_chunk *next;
+
+    /* the chunk is sent after this many bytes of the buffer */
+    size_t at;
+    uint8_t *data;
+    size_t len;
+};
+
 struct sss_packet {
     size_t memsize;
 
@@ -40,10 +54,16 @@ struct sss_packet {
     * 0-3      packet length (uint32_t)
     * 4-7      command type (uint32_t)
     * 8-11     status (uint32_t)
-    * 12-15    reserved
-    * 16+      packet body */
+    * 12-15    reserved, request id on pipelined connections
+    * 16+      packet body
+    *
+    * The packet length includes the chunks, which are not copied to the
+    * buffer but sent between its parts. */
     uint8_t *buffer;
 
+    struct sss_packet_chunk *chunks;
+    size_t chunks_len;
+
     /* io pointer */
     size_t iop;
 };
@@ -52,6 +72,7 @@ struct sss_packet {
 #define SSS_PACKET_LEN_OFFSET 0
 #define SSS_PACKET_CMD_OFFSET sizeof(uint32_t)
 #define SSS_PACKET_ERR_OFFSET (2*(sizeof(uint32_t)))
+#define SSS_PACKET_ID_OFFSET (3*(sizeof(uint32_t)))
 #define SSS_PACKET_BODY_OFFSET (4*(sizeof(uint32_t)))
 
 static void sss_packet_set_len(struct sss_packet *packet, uint32_t len);
@@ -59,6 +80,30 @@ static void sss_packet_set_cmd(struct sss_packet *packet,
                                enum sss_cli_command cmd);
 static uint32_t sss_packet_get_len(struct sss_packet *packet);
 
+/* length of the data in the buffer, without the chunks */
+static size_t sss_packet_get_buflen(struct sss_packet *packet)
+{
+    return sss_packet_get_len(packet) - packet->chunks_len;
+}
+
+/* free the chunks that were appended after @buflen bytes of the buffer */
+static void sss_packet_drop_chunks(struct sss_packet *packet, size_t buflen)
+{
+    struct sss_packet_chunk *chunk;
+    struct sss_packet_chunk *next;
+
+    for (chunk = packet->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        if (chunk->at <= buflen) {
+            continue;
+        }
+
+        packet->chunks_len -= chunk->len;
+        DLIST_REMOVE(packet->chunks, chunk);
+        talloc_free(chunk);
+    }
+}
+
 /*
  * Allocate a new packet structure
  *
@@ -71,7 +116,7 @@ int sss_packet_new(TALLOC_CTX *mem_ctx, size_t size,
 {
     struct sss_packet *packet;
 
-    packet = talloc(mem_ctx, struct sss_packet);
+    packet = talloc_zero(mem_ctx, struct sss_packet);
     if (!packet) return ENOMEM;
 
     if (size) {
@@ -112,7 +157,7 @@ int sss_packet_grow(struct sss_packet *packet, size_t size)
     totlen = packet->memsize;
     packet_len = sss_packet_get_len(packet);
 
-    len = packet_len + size;
+    len = sss_packet_get_buflen(packet) + size;
 
     /* make sure we do not overflow */
     if (totlen < len) {
@@ -149,14 +194,15 @@ int sss_packet_grow(struct sss_packet *packet, size_t size)
 int sss_packet_shrink(struct sss_packet *packet, size_t size)
 {
     size_t newlen;
-    size_t oldlen = sss_packet_get_len(packet);
+    size_t oldlen = sss_packet_get_buflen(packet);
 
     if (size > oldlen) return EINVAL;
 
     newlen = oldlen - size;
     if (newlen < SSS_NSS_HEADER_SIZE) return EINVAL;
 
-    sss_packet_set_len(packet, newlen);
+    sss_packet_drop_chunks(packet, newlen);
+    sss_packet_set_len(packet, newlen + packet->chunks_len);
     return 0;
 }
 
@@ -169,12 +215,92 @@ int sss_packet_set_size(struct sss_packet *packet, size_t size)
     /* make sure we do not overflow */
     if (packet->memsize < newlen) return EINVAL;
 
-    sss_packet_set_len(packet, newlen);
+    sss_packet_drop_chunks(packet, newlen);
+    sss_packet_set_len(packet, newlen + packet->chunks_len);
 
     return 0;
 }
 
-int sss_packet_recv(struct sss_packet *packet, int fd)
+int sss_packet_append_chunk(struct sss_packet *packet,
+                            uint8_t *data, size_t len)
+{
+    struct sss_packet_chunk *chunk;
+    uint32_t packet_len;
+
+    if (len == 0) {
+        return EOK;
+    }
+
+    packet_len = sss_packet_get_len(packet);
+    if (packet_len + len < packet_len) {
+        return EINVAL;
+    }
+
+    chunk = talloc_zero(packet, struct sss_packet_chunk);
+    if (chunk == NULL) {
+        return ENOMEM;
+    }
+
+    chunk->at = sss_packet_get_buflen(packet);
+    chunk->data = talloc_steal(chunk, data);
+    chunk->len = len;
+
+    DLIST_ADD_END(packet->chunks, chunk, struct sss_packet_chunk *);
+    packet->chunks_len += len;
+    sss_packet_set_len(packet, packet_len + len);
+
+    return EOK;
+}
+
+int sss_packet_flatten(struct sss_packet *packet)
+{
+    struct sss_packet_chunk *chunk;
+    uint32_t packet_len;
+    uint8_t *newmem;
+    size_t start = 0;
+    size_t end;
+    size_t rp = 0;
+
+    if (packet->chunks == NULL) {
+        return EOK;
+    }
+
+    packet_len = sss_packet_get_len(packet);
+    newmem = talloc_size(packet, packet_len);
+    if (newmem == NULL) {
+        return ENOMEM;
+    }
+
+    for (chunk = packet->chunks; ; chunk = chunk->next) {
+        end = chunk != NULL ? chunk->at : sss_packet_get_buflen(packet);
+        memcpy(newmem + rp, packet->buffer + start, end - start);
+        rp += end - start;
+        start = end;
+
+        if (chunk == NULL) {
+            break;
+        }
+
+        memcpy(newmem + rp, chunk->data, chunk->len);
+        rp += chunk->len;
+    }
+
+    while (packet->chunks != NULL) {
+        chunk = packet->chunks;
+        DLIST_REMOVE(packet->chunks, chunk);
+        talloc_free(chunk);
+    }
+    packet->chunks_len = 0;
+
+    talloc_free(packet->buffer);
+    packet->buffer = newmem;
+    packet->memsize = packet_len;
+
+    return EOK;
+}
+
+static int sss_packet_recv_internal(struct sss_packet *packet, int fd,
+                                    bool exact)
 {
     size_t rb;
     size_t len;
@@ -185,6 +311,9 @@ int sss_packet_recv(struct sss_packet *packet, int fd)
     buf = (uint8_t *)packet->buffer + packet->iop;
     if (packet->iop >= SSS_PACKET_CMD_OFFSET) {
         len = sss_packet_get_len(packet) - packet->iop;
+    } else if (exact) {
+        /* read the length first */
+        len = SSS_PACKET_CMD_OFFSET - packet->iop;
     } else {
         len = packet->memsize - packet->iop;
     }
@@ -258,6 +387,61 @@ int sss_packet_recv(struct sss_packet *packet, int fd)
     return EOK;
 }
 
+int sss_packet_recv(struct sss_packet *packet, int fd)
+{
+    return sss_packet_recv_internal(packet, fd, false);
+}
+
+int sss_packet_recv_one(struct sss_packet *packet, int fd)
+{
+    return sss_packet_recv_internal(packet, fd, true);
+}
+
+static void sss_packet_add_iov(struct iovec *iov, int *_n, size_t *_skip,
+                               uint8_t *data, size_t len)
+{
+    /* skip the data that was already sent */
+    if (*_skip >= len) {
+        *_skip -= len;
+        return;
+    }
+
+    iov[*_n].iov_base = data + *_skip;
+    iov[*_n].iov_len = len - *_skip;
+    *_skip = 0;
+    (*_n)++;
+}
+
+static ssize_t sss_packet_send_chunks(struct sss_packet *packet, int fd)
+{
+    struct iovec iov[SSSSRV_PACKET_MAX_IOV];
+    struct sss_packet_chunk *chunk;
+    struct msghdr msg = { 0 };
+    size_t skip = packet->iop;
+    size_t start = 0;
+    size_t end;
+    int n = 0;
+
+    chunk = packet->chunks;
+    while (n < SSSSRV_PACKET_MAX_IOV - 1) {
+        end = chunk != NULL ? chunk->at : sss_packet_get_buflen(packet);
+        sss_packet_add_iov(iov, &n, &skip, packet->buffer + start,
+                           end - start);
+        if (chunk == NULL) {
+            break;
+        }
+
+        sss_packet_add_iov(iov, &n, &skip, chunk->data, chunk->len);
+        start = end;
+        chunk = chunk->next;
+    }
+
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n;
+
+    return sendmsg(fd, &msg, 0);
+}
+
 int sss_packet_send(struct sss_packet *packet, int fd)
 {
     size_t rb;
@@ -269,11 +453,15 @@ int sss_packet_send(struct sss_packet *packet, int fd)
         return EINVAL;
     }
 
-    buf = packet->buffer + packet->iop;
-    len = sss_packet_get_len(packet) - packet->iop;
-
     errno = 0;
-    rb = send(fd, buf, len, 0);
+    if (packet->chunks != NULL) {
+        rb = sss_packet_send_chunks(packet, fd);
+    } else {
+        buf = packet->buffer + packet->iop;
+        len = sss_packet_get_len(packet) - packet->iop;
+
+        rb = send(fd, buf, len, 0);
+    }
 
     if (rb == -1) {
         if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
@@ -316,7 +504,7 @@ uint32_t sss_packet_get_status(struct sss_packet *packet)
 void sss_packet_get_body(struct sss_packet *packet, uint8_t **body, size_t *blen)
 {
     *body = packet->buffer + SSS_PACKET_BODY_OFFSET;
-    *blen = sss_packet_get_len(packet) - SSS_NSS_HEADER_SIZE;
+    *blen = sss_packet_get_buflen(packet) - SSS_NSS_HEADER_SIZE;
 }
 
 errno_t sss_packet_set_body(struct sss_packet *packet,
@@ -344,6 +532,19 @@ void sss_packet_set_error(struct sss_packet *packet, int error)
                             NULL);
 }
 
+uint32_t sss_packet_get_id(struct sss_packet *packet)
+{
+    uint32_t id;
+
+    SAFEALIGN_COPY_UINT32(&id, packet->buffer + SSS_PACKET_ID_OFFSET, NULL);
+    return id;
+}
+
+void sss_packet_set_id(struct sss_packet *packet, uint32_t id)
+{
+    SAFEALIGN_SETMEM_UINT32(packet->buffer + SSS_PACKET_ID_OFFSET, id, NULL);
+}
+
 static void sss_packet_set_len(struct sss_packet *packet, uint32_t len)
 {
     SAFEALIGN_SETMEM_UINT32(packet->buffer + SSS_PACKET_LEN_OFFSET, len, NULL);
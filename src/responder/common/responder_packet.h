@@ -36,12 +36,27 @@ int sss_packet_new(TALLOC_CTX *mem_ctx, size_t size,
 int sss_packet_grow(struct sss_packet *packet, size_t size);
 int sss_packet_shrink(struct sss_packet *packet, size_t size);
 int sss_packet_set_size(struct sss_packet *packet, size_t size);
+/* Append @data to the packet body without copying it, @data is stolen by
+ * the packet. The chunk is not part of the body returned by
+ * sss_packet_get_body(), offsets into the body keep referring only to the
+ * data added with sss_packet_grow(). Shrinking the packet below the point
+ * where the chunk was appended drops the chunk. */
+int sss_packet_append_chunk(struct sss_packet *packet,
+                            uint8_t *data, size_t len);
+/* Copy the chunks into the buffer, so that sss_packet_get_body() returns
+ * the whole body. */
+int sss_packet_flatten(struct sss_packet *packet);
 int sss_packet_recv(struct sss_packet *packet, int fd);
+/* Like sss_packet_recv() but never reads past the end of the packet, so
+ * the next request of a pipelined connection stays in the socket. */
+int sss_packet_recv_one(struct sss_packet *packet, int fd);
 int sss_packet_send(struct sss_packet *packet, int fd);
 enum sss_cli_command sss_packet_get_cmd(struct sss_packet *packet);
 uint32_t sss_packet_get_status(struct sss_packet *packet);
 void sss_packet_get_body(struct sss_packet *packet, uint8_t **body, size_t *blen);
 void sss_packet_set_error(struct sss_packet *packet, int error);
+uint32_t sss_packet_get_id(struct sss_packet *packet);
+void sss_packet_set_id(struct sss_packet *packet, uint32_t id);
 
 /* Grow packet and set its body. */
 errno_t sss_packet_set_body(struct sss_packet *packet,
@@ -0,0 +1,299 @@
+/*
+   SSSD
+
+   Latency statistics of the responders
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <talloc.h>
+
+#include "util/util.h"
+#include "util/sss_cli_cmd.h"
+#include "responder/common/responder.h"
+#include "responder/common/responder_stats.h"
+#include "responder/common/cache_req/cache_req.h"
+
+static const char *resp_stats_cmd_metric_names[] = {
+    "queue",
+    "total",
+    "reply_size",
+};
+
+static const char *resp_stats_cr_metric_names[] = {
+    "total",
+    "sysdb",
+    "dp",
+};
+
+static const char *resp_stats_counter_names[] = {
+    "cache_req/flights_started",
+    "cache_req/flights_merged",
+};
+
+/* The histograms are allocated once the first value is recorded since most
+ * of the commands are never used by most of the clients. */
+struct resp_stats_cmd {
+    struct sss_histogram *metrics[RESP_STATS_CMD_METRICS];
+};
+
+struct resp_stats_cr {
+    const char *name;
+    struct sss_histogram *metrics[RESP_STATS_CR_METRICS];
+};
+
+struct resp_stats {
+    struct sss_cmd_table *sss_cmds;
+    size_t num_cmds;
+    struct resp_stats_cmd *cmds;
+
+    struct resp_stats_cr cr[CACHE_REQ_SENTINEL];
+
+    uint64_t counters[RESP_STATS_COUNTERS];
+};
+
+errno_t resp_stats_init(TALLOC_CTX *mem_ctx,
+                        struct sss_cmd_table *sss_cmds,
+                        struct resp_stats **_stats)
+{
+    struct resp_stats *stats;
+    size_t num_cmds;
+
+    stats = talloc_zero(mem_ctx, struct resp_stats);
+    if (stats == NULL) {
+        return ENOMEM;
+    }
+
+    for (num_cmds = 0; sss_cmds[num_cmds].cmd != SSS_CLI_NULL; num_cmds++);
+
+    stats->cmds = talloc_zero_array(stats, struct resp_stats_cmd, num_cmds);
+    if (stats->cmds == NULL) {
+        talloc_free(stats);
+        return ENOMEM;
+    }
+    stats->sss_cmds = sss_cmds;
+    stats->num_cmds = num_cmds;
+
+    *_stats = stats;
+
+    return EOK;
+}
+
+static void resp_stats_record(struct resp_stats *stats,
+                              struct sss_histogram **_h,
+                              uint64_t value)
+{
+    if (*_h == NULL) {
+        *_h = talloc_zero(stats, struct sss_histogram);
+        if (*_h == NULL) {
+            /* the statistics are not worth failing the request */
+            return;
+        }
+    }
+
+    sss_histogram_record(*_h, value);
+}
+
+void resp_stats_cmd_record(struct resp_stats *stats,
+                           unsigned int cmd_index,
+                           enum resp_stats_cmd_metric metric,
+                           uint64_t value)
+{
+    if (stats == NULL || cmd_index >= stats->num_cmds
+            || metric >= RESP_STATS_CMD_METRICS) {
+        return;
+    }
+
+    resp_stats_record(stats, &stats->cmds[cmd_index].metrics[metric], value);
+}
+
+void resp_stats_cr_record(struct resp_stats *stats,
+                          unsigned int cr_type,
+                          const char *plugin_name,
+                          enum resp_stats_cr_metric metric,
+                          uint64_t value)
+{
+    if (stats == NULL || cr_type >= CACHE_REQ_SENTINEL
+            || metric >= RESP_STATS_CR_METRICS) {
+        return;
+    }
+
+    stats->cr[cr_type].name = plugin_name;
+    resp_stats_record(stats, &stats->cr[cr_type].metrics[metric], value);
+}
+
+void resp_stats_count(struct resp_stats *stats,
+                      enum resp_stats_counter counter)
+{
+    if (stats == NULL || counter >= RESP_STATS_COUNTERS) {
+        return;
+    }
+
+    stats->counters[counter]++;
+}
+
+static errno_t resp_stats_add(TALLOC_CTX *mem_ctx,
+                              const char *kind,
+                              const char *name,
+                              const char *metric,
+                              struct sss_histogram *h,
+                              const char **names,
+                              uint64_t *values,
+                              size_t *_num)
+{
+    if (h == NULL || h->count == 0) {
+        return EOK;
+    }
+
+    names[*_num] = talloc_asprintf(mem_ctx, "%s/%s/%s", kind, name, metric);
+    if (names[*_num] == NULL) {
+        return ENOMEM;
+    }
+
+    sss_histogram_summary(h, &values[*_num * SSS_HISTOGRAM_FIELDS]);
+    (*_num)++;
+
+    return EOK;
+}
+
+errno_t resp_stats_get(TALLOC_CTX *mem_ctx,
+                       struct resp_stats *stats,
+                       const char ***_names,
+                       uint64_t **_values,
+                       size_t *_num_values)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char **names;
+    uint64_t *values;
+    size_t max;
+    size_t num = 0;
+    size_t i;
+    size_t m;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    max = 0;
+    if (stats != NULL) {
+        max = stats->num_cmds * RESP_STATS_CMD_METRICS
+              + CACHE_REQ_SENTINEL * RESP_STATS_CR_METRICS
+              + RESP_STATS_COUNTERS;
+    }
+
+    /* NULL terminated for the string array of the D-Bus reply */
+    names = talloc_zero_array(tmp_ctx, const char *, max + 1);
+    values = talloc_zero_array(tmp_ctx, uint64_t,
+                               max * SSS_HISTOGRAM_FIELDS + 1);
+    if (names == NULL || values == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (stats == NULL) {
+        goto out;
+    }
+
+    for (i = 0; i < stats->num_cmds; i++) {
+        for (m = 0; m < RESP_STATS_CMD_METRICS; m++) {
+            ret = resp_stats_add(names, "command",
+                                 sss_cmd2str(stats->sss_cmds[i].cmd),
+                                 resp_stats_cmd_metric_names[m],
+                                 stats->cmds[i].metrics[m],
+                                 names, values, &num);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    for (i = 0; i < CACHE_REQ_SENTINEL; i++) {
+        for (m = 0; m < RESP_STATS_CR_METRICS; m++) {
+            ret = resp_stats_add(names, "cache_req", stats->cr[i].name,
+                                 resp_stats_cr_metric_names[m],
+                                 stats->cr[i].metrics[m],
+                                 names, values, &num);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    for (i = 0; i < RESP_STATS_COUNTERS; i++) {
+        if (stats->counters[i] == 0) {
+            continue;
+        }
+
+        names[num] = talloc_asprintf(names, "counter/%s",
+                                     resp_stats_counter_names[i]);
+        if (names[num] == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        values[num * SSS_HISTOGRAM_FIELDS + SSS_HISTOGRAM_COUNT] =
+                                                        stats->counters[i];
+        num++;
+    }
+
+out:
+    /* the D-Bus reply takes the length of the array from its size */
+    if (num == 0) {
+        talloc_zfree(values);
+    } else {
+        values = talloc_realloc(tmp_ctx, values, uint64_t,
+                                num * SSS_HISTOGRAM_FIELDS);
+        if (values == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    *_names = talloc_steal(mem_ctx, names);
+    *_values = talloc_steal(mem_ctx, values);
+    *_num_values = num;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+void resp_stats_reset(struct resp_stats *stats)
+{
+    size_t i;
+    size_t m;
+
+    if (stats == NULL) {
+        return;
+    }
+
+    for (i = 0; i < stats->num_cmds; i++) {
+        for (m = 0; m < RESP_STATS_CMD_METRICS; m++) {
+            talloc_zfree(stats->cmds[i].metrics[m]);
+        }
+    }
+
+    for (i = 0; i < CACHE_REQ_SENTINEL; i++) {
+        for (m = 0; m < RESP_STATS_CR_METRICS; m++) {
+            talloc_zfree(stats->cr[i].metrics[m]);
+        }
+    }
+
+    memset(stats->counters, 0, sizeof(stats->counters));
+}
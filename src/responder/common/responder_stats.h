@@ -0,0 +1,96 @@
+/*
+   SSSD
+
+   Latency statistics of the responders
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _RESPONDER_STATS_H_
+#define _RESPONDER_STATS_H_
+
+#include "util/util.h"
+#include "util/sss_histogram.h"
+
+struct sss_cmd_table;
+struct resp_stats;
+
+/* Measured for each command of the responder. Times are in microseconds. */
+enum resp_stats_cmd_metric {
+    /* from reading the whole request until the command is started */
+    RESP_STATS_CMD_QUEUE,
+    /* from reading the whole request until the reply is ready */
+    RESP_STATS_CMD_TOTAL,
+    /* size of the reply in bytes */
+    RESP_STATS_CMD_REPLY_SIZE,
+
+    RESP_STATS_CMD_METRICS
+};
+
+/* Measured for each cache_req plugin. Times are in microseconds. */
+enum resp_stats_cr_metric {
+    /* the whole cache request */
+    RESP_STATS_CR_TOTAL,
+    /* one search of the cache, the in-memory cache excluded */
+    RESP_STATS_CR_SYSDB,
+    /* one data provider request */
+    RESP_STATS_CR_DP,
+
+    RESP_STATS_CR_METRICS
+};
+
+/* Events which are only counted */
+enum resp_stats_counter {
+    /* cache requests which started a lookup of their own */
+    RESP_STATS_CR_FLIGHTS_STARTED,
+    /* cache requests which waited for an identical one in progress */
+    RESP_STATS_CR_FLIGHTS_MERGED,
+
+    RESP_STATS_COUNTERS
+};
+
+errno_t resp_stats_init(TALLOC_CTX *mem_ctx,
+                        struct sss_cmd_table *sss_cmds,
+                        struct resp_stats **_stats);
+
+/* @cmd_index is the position of the command in the command table */
+void resp_stats_cmd_record(struct resp_stats *stats,
+                           unsigned int cmd_index,
+                           enum resp_stats_cmd_metric metric,
+                           uint64_t value);
+
+/* @plugin_name must stay valid as long as @stats */
+void resp_stats_cr_record(struct resp_stats *stats,
+                          unsigned int cr_type,
+                          const char *plugin_name,
+                          enum resp_stats_cr_metric metric,
+                          uint64_t value);
+
+void resp_stats_count(struct resp_stats *stats,
+                      enum resp_stats_counter counter);
+
+/* Returns the names of all metrics with values, for example
+ * "command/SSS_NSS_GETPWNAM/total". The summary of the metric _names[i] is
+ * _values[i * SSS_HISTOGRAM_FIELDS] and the following values, in the order
+ * of enum sss_histogram_field. Counters are named "counter/...", only the
+ * count of their summary is set. */
+errno_t resp_stats_get(TALLOC_CTX *mem_ctx,
+                       struct resp_stats *stats,
+                       const char ***_names,
+                       uint64_t **_values,
+                       size_t *_num_values);
+
+void resp_stats_reset(struct resp_stats *stats);
+
+#endif /* _RESPONDER_STATS_H_ */
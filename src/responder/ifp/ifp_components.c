@@ -28,7 +28,9 @@
 #include "confdb/confdb.h"
 #include "util/util.h"
 #include "responder/common/responder.h"
+#include "responder/common/responder_stats.h"
 #include "responder/ifp/ifp_components.h"
+#include "sss_iface/sss_iface_async.h"
 
 #define PATH_MONITOR    IFP_PATH_COMPONENTS "/monitor"
 #define PATH_RESPONDERS IFP_PATH_COMPONENTS "/Responders"
@@ -660,3 +662,233 @@ done:
 
     return ret;
 }
+
+/* Statistics are kept by responders only. The bus name is NULL for the
+ * InfoPipe responder itself, which answers from its own context. */
+static errno_t
+ifp_component_stats_busname(TALLOC_CTX *mem_ctx,
+                            struct ifp_ctx *ctx,
+                            const char *path,
+                            const char **_busname)
+{
+    enum component_type type;
+    char *name;
+    errno_t ret;
+
+    ret = check_and_get_component_from_path(mem_ctx, ctx->rctx->cdb,
+                                            path, &type, &name);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unknown object [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (type != COMPONENT_RESPONDER) {
+        DEBUG(SSSDBG_OP_FAILURE, "[%s] is not a responder\n", name);
+        talloc_free(name);
+        return ENOTSUP;
+    }
+
+    if (strcmp(name, "ifp") == 0) {
+        *_busname = NULL;
+        talloc_free(name);
+        return EOK;
+    }
+
+    *_busname = talloc_asprintf(mem_ctx, "sssd.%s", name);
+    talloc_free(name);
+    if (*_busname == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+struct ifp_component_get_statistics_state {
+    const char **names;
+    uint64_t *values;
+};
+
+static void ifp_component_get_statistics_done(struct tevent_req *subreq);
+
+struct tevent_req *
+ifp_component_get_statistics_send(TALLOC_CTX *mem_ctx,
+                                  struct tevent_context *ev,
+                                  struct sbus_request *sbus_req,
+                                  struct ifp_ctx *ctx)
+{
+    struct ifp_component_get_statistics_state *state;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    const char *busname;
+    size_t num;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct ifp_component_get_statistics_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create tevent request!\n");
+        return NULL;
+    }
+
+    ret = ifp_component_stats_busname(state, ctx, sbus_req->path, &busname);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (busname == NULL) {
+        ret = resp_stats_get(state, ctx->rctx->stats,
+                             &state->names, &state->values, &num);
+        goto done;
+    }
+
+    subreq = sbus_call_resp_stats_Get_send(state, ctx->rctx->sbus_conn,
+                                           busname, SSS_BUS_PATH);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, ifp_component_get_statistics_done, req);
+
+    ret = EAGAIN;
+
+done:
+    if (ret == EOK) {
+        tevent_req_done(req);
+        tevent_req_post(req, ev);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
+static void ifp_component_get_statistics_done(struct tevent_req *subreq)
+{
+    struct ifp_component_get_statistics_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ifp_component_get_statistics_state);
+
+    ret = sbus_call_resp_stats_Get_recv(state, subreq,
+                                        &state->names, &state->values);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to get statistics [%d]: %s\n",
+              ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+errno_t
+ifp_component_get_statistics_recv(TALLOC_CTX *mem_ctx,
+                                  struct tevent_req *req,
+                                  const char ***_names,
+                                  uint64_t **_values)
+{
+    struct ifp_component_get_statistics_state *state;
+    state = tevent_req_data(req, struct ifp_component_get_statistics_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_names = talloc_steal(mem_ctx, state->names);
+    *_values = talloc_steal(mem_ctx, state->values);
+
+    return EOK;
+}
+
+struct ifp_component_reset_statistics_state {
+    int dummy;
+};
+
+static void ifp_component_reset_statistics_done(struct tevent_req *subreq);
+
+struct tevent_req *
+ifp_component_reset_statistics_send(TALLOC_CTX *mem_ctx,
+                                    struct tevent_context *ev,
+                                    struct sbus_request *sbus_req,
+                                    struct ifp_ctx *ctx)
+{
+    struct ifp_component_reset_statistics_state *state;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    const char *busname;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct ifp_component_reset_statistics_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create tevent request!\n");
+        return NULL;
+    }
+
+    ret = ifp_component_stats_busname(state, ctx, sbus_req->path, &busname);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (busname == NULL) {
+        resp_stats_reset(ctx->rctx->stats);
+        ret = EOK;
+        goto done;
+    }
+
+    subreq = sbus_call_resp_stats_Reset_send(state, ctx->rctx->sbus_conn,
+                                             busname, SSS_BUS_PATH);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, ifp_component_reset_statistics_done, req);
+
+    ret = EAGAIN;
+
+done:
+    if (ret == EOK) {
+        tevent_req_done(req);
+        tevent_req_post(req, ev);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
+static void ifp_component_reset_statistics_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+
+    ret = sbus_call_resp_stats_Reset_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to reset statistics [%d]: %s\n",
+              ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+errno_t
+ifp_component_reset_statistics_recv(TALLOC_CTX *mem_ctx,
+                                    struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
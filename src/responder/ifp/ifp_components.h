@@ -97,4 +97,26 @@ ifp_backend_get_providers(TALLOC_CTX *mem_ctx,
                           struct ifp_ctx *ctx,
                           const char ***_out);
 
+struct tevent_req *
+ifp_component_get_statistics_send(TALLOC_CTX *mem_ctx,
+                                  struct tevent_context *ev,
+                                  struct sbus_request *sbus_req,
+                                  struct ifp_ctx *ctx);
+
+errno_t
+ifp_component_get_statistics_recv(TALLOC_CTX *mem_ctx,
+                                  struct tevent_req *req,
+                                  const char ***_names,
+                                  uint64_t **_values);
+
+struct tevent_req *
+ifp_component_reset_statistics_send(TALLOC_CTX *mem_ctx,
+                                    struct tevent_context *ev,
+                                    struct sbus_request *sbus_req,
+                                    struct ifp_ctx *ctx);
+
+errno_t
+ifp_component_reset_statistics_recv(TALLOC_CTX *mem_ctx,
+                                    struct tevent_req *req);
+
 #endif /* _IFP_COMPONENTS_H_ */
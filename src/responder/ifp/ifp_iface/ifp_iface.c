@@ -98,7 +98,10 @@ ifp_register_sbus_interface(struct sbus_connection *conn,
 
     SBUS_INTERFACE(iface_ifp_components,
         org_freedesktop_sssd_infopipe_Components,
-        SBUS_METHODS(SBUS_NO_METHODS),
+        SBUS_METHODS(
+            SBUS_ASYNC(METHOD, org_freedesktop_sssd_infopipe_Components, GetStatistics, ifp_component_get_statistics_send, ifp_component_get_statistics_recv, ctx),
+            SBUS_ASYNC(METHOD, org_freedesktop_sssd_infopipe_Components, ResetStatistics, ifp_component_reset_statistics_send, ifp_component_reset_statistics_recv, ctx)
+        ),
         SBUS_SIGNALS(SBUS_NO_SIGNALS),
         SBUS_PROPERTIES(
             SBUS_SYNC(GETTER, org_freedesktop_sssd_infopipe_Components, name, ifp_component_get_name, ctx),
@@ -164,6 +164,59 @@ done:
     return ret;
 }
 
+static errno_t
+sbus_method_in__out_asat
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_sync_connection *conn,
+     const char *bus,
+     const char *path,
+     const char *iface,
+     const char *method,
+     const char *** _arg0,
+     uint64_t ** _arg1)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct _sbus_ifp_invoker_args_asat *out;
+    DBusMessage *reply;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Out of memory!\n");
+        return ENOMEM;
+    }
+
+    out = talloc_zero(tmp_ctx, struct _sbus_ifp_invoker_args_asat);
+    if (out == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to allocate space for output parameters!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+
+    ret = sbus_sync_call_method(tmp_ctx, conn, NULL, NULL,
+                                bus, path, iface, method, NULL, &reply);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sbus_read_output(out, reply, (sbus_invoker_reader_fn)_sbus_ifp_invoker_read_asat, out);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    *_arg0 = talloc_steal(mem_ctx, out->arg0);
+    *_arg1 = talloc_steal(mem_ctx, out->arg1);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+
+    return ret;
+}
+
 static errno_t
 sbus_method_in__out_b
     (struct sbus_sync_connection *conn,
@@ -972,6 +1025,31 @@ sbus_call_ifp_cache_object_Store
           _arg_result);
 }
 
+errno_t
+sbus_call_ifp_components_GetStatistics
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_sync_connection *conn,
+     const char *busname,
+     const char *object_path,
+     const char *** _arg_names,
+     uint64_t ** _arg_values)
+{
+     return sbus_method_in__out_asat(mem_ctx, conn,
+          busname, object_path, "org.freedesktop.sssd.infopipe.Components", "GetStatistics",
+          _arg_names,
+          _arg_values);
+}
+
+errno_t
+sbus_call_ifp_components_ResetStatistics
+    (struct sbus_sync_connection *conn,
+     const char *busname,
+     const char *object_path)
+{
+     return sbus_method_in__out_(conn,
+          busname, object_path, "org.freedesktop.sssd.infopipe.Components", "ResetStatistics");
+}
+
 errno_t
 sbus_call_ifp_domain_ActiveServer
     (TALLOC_CTX *mem_ctx,
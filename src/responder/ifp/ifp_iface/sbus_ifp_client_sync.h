@@ -154,6 +154,21 @@ sbus_call_ifp_cache_object_Store
      const char *object_path,
      bool* _arg_result);
 
+errno_t
+sbus_call_ifp_components_GetStatistics
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_sync_connection *conn,
+     const char *busname,
+     const char *object_path,
+     const char *** _arg_names,
+     uint64_t ** _arg_values);
+
+errno_t
+sbus_call_ifp_components_ResetStatistics
+    (struct sbus_sync_connection *conn,
+     const char *busname,
+     const char *object_path);
+
 errno_t
 sbus_call_ifp_domain_ActiveServer
     (TALLOC_CTX *mem_ctx,
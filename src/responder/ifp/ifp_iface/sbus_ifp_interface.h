@@ -379,6 +379,50 @@
         (methods), (signals), (properties)); \
 })
 
+/* Method: org.freedesktop.sssd.infopipe.Components.GetStatistics */
+#define SBUS_METHOD_SYNC_org_freedesktop_sssd_infopipe_Components_GetStatistics(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data), const char ***, uint64_t **); \
+    sbus_method_sync("GetStatistics", \
+        &_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_GetStatistics, \
+        NULL, \
+        _sbus_ifp_invoke_in__out_asat_send, \
+        _sbus_ifp_key_, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_org_freedesktop_sssd_infopipe_Components_GetStatistics(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data)); \
+    SBUS_CHECK_RECV((handler_recv), const char ***, uint64_t **); \
+    sbus_method_async("GetStatistics", \
+        &_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_GetStatistics, \
+        NULL, \
+        _sbus_ifp_invoke_in__out_asat_send, \
+        _sbus_ifp_key_, \
+        (handler_send), (handler_recv), (data)); \
+})
+
+/* Method: org.freedesktop.sssd.infopipe.Components.ResetStatistics */
+#define SBUS_METHOD_SYNC_org_freedesktop_sssd_infopipe_Components_ResetStatistics(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data)); \
+    sbus_method_sync("ResetStatistics", \
+        &_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_ResetStatistics, \
+        NULL, \
+        _sbus_ifp_invoke_in__out__send, \
+        _sbus_ifp_key_, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_org_freedesktop_sssd_infopipe_Components_ResetStatistics(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data)); \
+    SBUS_CHECK_RECV((handler_recv)); \
+    sbus_method_async("ResetStatistics", \
+        &_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_ResetStatistics, \
+        NULL, \
+        _sbus_ifp_invoke_in__out__send, \
+        _sbus_ifp_key_, \
+        (handler_send), (handler_recv), (data)); \
+})
+
 /* Property: org.freedesktop.sssd.infopipe.Components.debug_level */
 #define SBUS_GETTER_SYNC_org_freedesktop_sssd_infopipe_Components_debug_level(handler, data) ({ \
     SBUS_CHECK_SYNC((handler), (data), uint32_t*); \
@@ -193,6 +193,28 @@ _sbus_ifp_args_org_freedesktop_sssd_infopipe_Cache_Object_Store = {
     }
 };
 
+const struct sbus_method_arguments
+_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_GetStatistics = {
+    .input = (const struct sbus_argument[]){
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {.type = "as", .name = "names"},
+        {.type = "at", .name = "values"},
+        {NULL}
+    }
+};
+
+const struct sbus_method_arguments
+_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_ResetStatistics = {
+    .input = (const struct sbus_argument[]){
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {NULL}
+    }
+};
+
 const struct sbus_method_arguments
 _sbus_ifp_args_org_freedesktop_sssd_infopipe_Domains_Domain_ActiveServer = {
     .input = (const struct sbus_argument[]){
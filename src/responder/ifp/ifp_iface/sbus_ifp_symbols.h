@@ -67,6 +67,12 @@ _sbus_ifp_args_org_freedesktop_sssd_infopipe_Cache_Object_Remove;
 extern const struct sbus_method_arguments
 _sbus_ifp_args_org_freedesktop_sssd_infopipe_Cache_Object_Store;
 
+extern const struct sbus_method_arguments
+_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_GetStatistics;
+
+extern const struct sbus_method_arguments
+_sbus_ifp_args_org_freedesktop_sssd_infopipe_Components_ResetStatistics;
+
 extern const struct sbus_method_arguments
 _sbus_ifp_args_org_freedesktop_sssd_infopipe_Domains_Domain_ActiveServer;
 
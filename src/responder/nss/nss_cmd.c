@@ -223,7 +223,9 @@ static errno_t sss_nss_getby_svc(struct cli_ctx *cli_ctx,
         goto done;
     }
 
+    cmd_ctx->svc_name = name;
     cmd_ctx->svc_protocol = protocol;
+    cmd_ctx->svc_port = port;
 
     data = cache_req_data_svc(cmd_ctx, type, name, protocol, port);
     if (data == NULL) {
@@ -591,6 +593,46 @@ static errno_t invalidate_cache(struct sss_nss_cmd_ctx *cmd_ctx,
     return EOK;
 }
 
+/* Instances other than the first one do not write the fast in-memory
+ * caches, they ask the first one to store the entry they found. */
+static void forward_memcache_store(struct sss_nss_cmd_ctx *cmd_ctx,
+                                   const char *rawname,
+                                   struct cache_req_result *result)
+{
+    uint32_t id = 0;
+
+    if (!cmd_ctx->nss_ctx->forward_mc
+            || (cmd_ctx->flags & SSS_NSS_EX_FLAG_INVALIDATE_CACHE) != 0) {
+        return;
+    }
+
+    switch (cmd_ctx->type) {
+    case CACHE_REQ_USER_BY_ID:
+        id = sss_view_ldb_msg_find_attr_as_uint64(result->domain,
+                                                  result->msgs[0],
+                                                  SYSDB_UIDNUM, 0);
+        break;
+    case CACHE_REQ_GROUP_BY_ID:
+        id = sss_view_ldb_msg_find_attr_as_uint64(result->domain,
+                                                  result->msgs[0],
+                                                  SYSDB_GIDNUM, 0);
+        break;
+    case CACHE_REQ_USER_BY_NAME:
+    case CACHE_REQ_GROUP_BY_NAME:
+    case CACHE_REQ_INITGROUPS:
+    case CACHE_REQ_INITGROUPS_BY_UPN:
+        if (rawname == NULL) {
+            return;
+        }
+        break;
+    default:
+        return;
+    }
+
+    sss_nss_memcache_forward_store(cmd_ctx->nss_ctx, cmd_ctx->type,
+                                   rawname, id);
+}
+
 static void sss_nss_getby_done(struct tevent_req *subreq)
 {
     struct cache_req_result *result;
@@ -619,10 +661,174 @@ static void sss_nss_getby_done(struct tevent_req *subreq)
     sss_nss_protocol_reply(cmd_ctx->cli_ctx, cmd_ctx->nss_ctx, cmd_ctx,
                        result, cmd_ctx->fill_fn);
 
+    forward_memcache_store(cmd_ctx, cmd_ctx->rawname, result);
+
 done:
     talloc_free(cmd_ctx);
 }
 
+/* All IDs of a *_MULTI request are looked up in parallel, the reply is sent
+ * once the last lookup finishes. */
+struct sss_nss_multi_ctx {
+    struct sss_nss_cmd_ctx *cmd_ctx;
+    uint32_t num_ids;
+    uint32_t num_pending;
+    errno_t *errors;
+    struct cache_req_result **results;
+};
+
+struct sss_nss_multi_key {
+    struct sss_nss_multi_ctx *multi_ctx;
+    uint32_t idx;
+    uint32_t id;
+};
+
+static void sss_nss_getby_id_multi_done(struct tevent_req *subreq);
+
+static errno_t sss_nss_getby_id_multi(struct cli_ctx *cli_ctx,
+                                      enum cache_req_type type,
+                                      enum sss_mc_type memcache,
+                                      sss_nss_protocol_fill_packet_fn fill_fn)
+{
+    struct sss_nss_multi_ctx *multi_ctx;
+    struct sss_nss_multi_key *keys;
+    struct cache_req_data *data;
+    struct tevent_req *subreq;
+    uint32_t *ids;
+    uint32_t i;
+    errno_t ret;
+
+    multi_ctx = talloc_zero(cli_ctx, struct sss_nss_multi_ctx);
+    if (multi_ctx == NULL) {
+        return sss_nss_protocol_done(cli_ctx, ENOMEM);
+    }
+
+    multi_ctx->cmd_ctx = sss_nss_cmd_ctx_create(multi_ctx, cli_ctx, type,
+                                                fill_fn);
+    if (multi_ctx->cmd_ctx == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sss_nss_protocol_parse_id_multi(multi_ctx, cli_ctx,
+                                          &multi_ctx->cmd_ctx->flags,
+                                          &multi_ctx->num_ids, &ids);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid request message!\n");
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Input: %u IDs\n", multi_ctx->num_ids);
+
+    multi_ctx->errors = talloc_zero_array(multi_ctx, errno_t,
+                                          multi_ctx->num_ids);
+    multi_ctx->results = talloc_zero_array(multi_ctx,
+                                           struct cache_req_result *,
+                                           multi_ctx->num_ids);
+    keys = talloc_zero_array(multi_ctx, struct sss_nss_multi_key,
+                             multi_ctx->num_ids);
+    if (multi_ctx->errors == NULL || multi_ctx->results == NULL
+            || keys == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < multi_ctx->num_ids; i++) {
+        data = cache_req_data_id(multi_ctx, type, ids[i]);
+        if (data == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to set cache request data!\n");
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = eval_flags(multi_ctx->cmd_ctx, data);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "eval_flags failed.\n");
+            goto done;
+        }
+
+        subreq = sss_nss_get_object_send(multi_ctx, cli_ctx->ev, cli_ctx,
+                                         data, memcache, NULL, ids[i]);
+        if (subreq == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "sss_nss_get_object_send() failed\n");
+            ret = ENOMEM;
+            goto done;
+        }
+
+        keys[i].multi_ctx = multi_ctx;
+        keys[i].idx = i;
+        keys[i].id = ids[i];
+        multi_ctx->num_pending++;
+
+        tevent_req_set_callback(subreq, sss_nss_getby_id_multi_done, &keys[i]);
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        /* freeing the context cancels the requests already sent */
+        talloc_free(multi_ctx);
+        return sss_nss_protocol_done(cli_ctx, ret);
+    }
+
+    return EOK;
+}
+
+static void sss_nss_getby_id_multi_done(struct tevent_req *subreq)
+{
+    struct sss_nss_multi_ctx *multi_ctx;
+    struct sss_nss_multi_key *key;
+    struct sss_nss_cmd_ctx *cmd_ctx;
+    struct cli_protocol *pctx;
+    errno_t ret;
+
+    key = tevent_req_callback_data(subreq, struct sss_nss_multi_key);
+    multi_ctx = key->multi_ctx;
+    cmd_ctx = multi_ctx->cmd_ctx;
+
+    ret = sss_nss_get_object_recv(multi_ctx, subreq,
+                                  &multi_ctx->results[key->idx], NULL);
+    talloc_zfree(subreq);
+    if (ret == EOK
+            && (cmd_ctx->flags & SSS_NSS_EX_FLAG_INVALIDATE_CACHE) != 0) {
+        ret = invalidate_cache(cmd_ctx, multi_ctx->results[key->idx]);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Failed to invalidate cache for [%u].\n",
+                                     key->id);
+        }
+    } else if (ret == EOK) {
+        forward_memcache_store(cmd_ctx, NULL, multi_ctx->results[key->idx]);
+    }
+
+    multi_ctx->errors[key->idx] = ret;
+    multi_ctx->num_pending--;
+    if (multi_ctx->num_pending > 0) {
+        return;
+    }
+
+    pctx = talloc_get_type(cmd_ctx->cli_ctx->protocol_ctx, struct cli_protocol);
+
+    ret = sss_packet_new(pctx->creq, 0, sss_packet_get_cmd(pctx->creq->in),
+                         &pctx->creq->out);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_nss_protocol_fill_multi(cmd_ctx->nss_ctx, cmd_ctx,
+                                      pctx->creq->out, multi_ctx->num_ids,
+                                      multi_ctx->errors, multi_ctx->results);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    sss_packet_set_error(pctx->creq->out, EOK);
+
+done:
+    sss_nss_protocol_done(cmd_ctx->cli_ctx, ret);
+    talloc_free(multi_ctx);
+}
+
 static void sss_nss_setent_done(struct tevent_req *subreq);
 
 static errno_t sss_nss_setent(struct cli_ctx *cli_ctx,
@@ -925,6 +1131,12 @@ static errno_t sss_nss_cmd_getpwuid_ex(struct cli_ctx *cli_ctx)
                             SSS_MC_PASSWD, sss_nss_protocol_fill_pwent);
 }
 
+static errno_t sss_nss_cmd_getpwuid_multi(struct cli_ctx *cli_ctx)
+{
+    return sss_nss_getby_id_multi(cli_ctx, CACHE_REQ_USER_BY_ID,
+                                  SSS_MC_PASSWD, sss_nss_protocol_fill_pwent);
+}
+
 static errno_t sss_nss_cmd_setpwent(struct cli_ctx *cli_ctx)
 {
     struct sss_nss_ctx *nss_ctx;
@@ -986,6 +1198,47 @@ static errno_t sss_nss_cmd_getgrgid_ex(struct cli_ctx *cli_ctx)
 }
 
 
+static errno_t sss_nss_cmd_getgrmembers(struct cli_ctx *cli_ctx)
+{
+    struct sss_nss_ctx *nss_ctx;
+    struct sss_nss_state_ctx *state_ctx;
+    struct cli_protocol *pctx;
+    errno_t ret;
+
+    nss_ctx = talloc_get_type(cli_ctx->rctx->pvt_ctx, struct sss_nss_ctx);
+    state_ctx = talloc_get_type(cli_ctx->state_ctx, struct sss_nss_state_ctx);
+    pctx = talloc_get_type(cli_ctx->protocol_ctx, struct cli_protocol);
+
+    if (state_ctx->grmem == NULL) {
+        /* An empty reply would look like the end of the member list. */
+        DEBUG(SSSDBG_OP_FAILURE, "No group members are pending\n");
+        return EINVAL;
+    }
+
+    ret = sss_packet_new(pctx->creq, 0, sss_packet_get_cmd(pctx->creq->in),
+                         &pctx->creq->out);
+    if (ret != EOK) {
+        talloc_zfree(state_ctx->grmem);
+        goto done;
+    }
+
+    ret = sss_nss_protocol_fill_grmem(nss_ctx, state_ctx, pctx->creq->out);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    sss_packet_set_error(pctx->creq->out, EOK);
+
+done:
+    return sss_nss_protocol_done(cli_ctx, ret);
+}
+
+static errno_t sss_nss_cmd_getgrgid_multi(struct cli_ctx *cli_ctx)
+{
+    return sss_nss_getby_id_multi(cli_ctx, CACHE_REQ_GROUP_BY_ID,
+                                  SSS_MC_GROUP, sss_nss_protocol_fill_grent);
+}
+
 static errno_t sss_nss_cmd_setgrent(struct cli_ctx *cli_ctx)
 {
     struct sss_nss_ctx *nss_ctx;
@@ -1395,6 +1648,9 @@ struct sss_cmd_table *get_sss_nss_cmds(void)
         { SSS_NSS_GETPWUID_EX, sss_nss_cmd_getpwuid_ex },
         { SSS_NSS_GETGRNAM_EX, sss_nss_cmd_getgrnam_ex },
         { SSS_NSS_GETGRGID_EX, sss_nss_cmd_getgrgid_ex },
+        { SSS_NSS_GETPWUID_MULTI, sss_nss_cmd_getpwuid_multi },
+        { SSS_NSS_GETGRGID_MULTI, sss_nss_cmd_getgrgid_multi },
+        { SSS_NSS_GETGRMEMBERS, sss_nss_cmd_getgrmembers },
         { SSS_NSS_INITGR_EX, sss_nss_cmd_initgroups_ex },
         { SSS_NSS_GETHOSTBYNAME, sss_nss_cmd_gethostbyname },
         { SSS_NSS_GETHOSTBYNAME2, sss_nss_cmd_gethostbyname },
@@ -98,6 +98,15 @@ memcache_delete_entry(struct sss_nss_ctx *nss_ctx,
     struct sized_string *sized_name;
     errno_t ret;
 
+    if (nss_ctx->forward_mc) {
+        /* The first instance deletes the entry in all domains, which at
+         * worst drops a record that is still valid. */
+        if (name != NULL || id != 0) {
+            sss_nss_memcache_forward_delete(nss_ctx, type, name, id);
+        }
+        return EOK;
+    }
+
     for (dom = rctx->domains;
          dom != NULL;
          dom = get_next_domain(dom, SSS_GND_DESCEND)) {
@@ -243,6 +252,41 @@ hybrid_domain_user_to_group(struct cache_req_result *result)
     return EOK;
 }
 
+/* Lets clients answer repeated lookups of a user that does not exist from
+ * the memory cache for as long as the negative cache would */
+static void
+memcache_store_negative(struct sss_nss_ctx *nss_ctx,
+                        struct resp_ctx *rctx,
+                        const char *name,
+                        uint32_t id)
+{
+    struct sized_string sized_name;
+    uint32_t ttl;
+    errno_t ret;
+
+    ttl = sss_ncache_get_timeout(rctx->ncache);
+    if (ttl == 0) {
+        return;
+    }
+
+    if (name != NULL) {
+        to_sized_string(&sized_name, name);
+        ret = sss_mmap_cache_pw_store_negative(&nss_ctx->pwd_mc_ctx,
+                                               &sized_name, 0, ttl);
+    } else if (id != 0) {
+        ret = sss_mmap_cache_pw_store_negative(&nss_ctx->pwd_mc_ctx,
+                                               NULL, (uid_t)id, ttl);
+    } else {
+        return;
+    }
+
+    if (ret != EOK && ret != EINVAL) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to store negative memory cache record [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+}
+
 struct sss_nss_get_object_state {
     struct sss_nss_ctx *nss_ctx;
     struct resp_ctx *rctx;
@@ -377,6 +421,11 @@ static void sss_nss_get_object_finish_req(struct tevent_req *req,
                                   state->memcache);
         }
 
+        if (state->memcache == SSS_MC_PASSWD) {
+            memcache_store_negative(state->nss_ctx, state->rctx,
+                                    state->input_name, state->input_id);
+        }
+
         tevent_req_error(req, ENOENT);
         break;
     default:
@@ -19,6 +19,7 @@
 */
 
 #include "responder/nss/nss_private.h"
+#include "responder/nss/nss_protocol.h"
 #include "responder/nss/nss_iface.h"
 #include "sss_iface/sss_iface_async.h"
 
@@ -154,6 +155,7 @@ sss_nss_memorycache_invalidate_users(TALLOC_CTX *mem_ctx,
 {
     DEBUG(SSSDBG_TRACE_LIBS, "Invalidating all users in memory cache\n");
     sss_mmap_cache_reset(nctx->pwd_mc_ctx);
+    cache_req_hot_cache_clear(nctx->rctx);
 
     return EOK;
 }
@@ -165,6 +167,7 @@ sss_nss_memorycache_invalidate_groups(TALLOC_CTX *mem_ctx,
 {
     DEBUG(SSSDBG_TRACE_LIBS, "Invalidating all groups in memory cache\n");
     sss_mmap_cache_reset(nctx->grp_mc_ctx);
+    cache_req_hot_cache_clear(nctx->rctx);
 
     return EOK;
 }
@@ -177,6 +180,7 @@ sss_nss_memorycache_invalidate_initgroups(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_LIBS,
           "Invalidating all initgroup records in memory cache\n");
     sss_mmap_cache_reset(nctx->initgr_mc_ctx);
+    cache_req_hot_cache_clear(nctx->rctx);
 
     return EOK;
 }
@@ -209,10 +213,226 @@ sss_nss_memorycache_invalidate_group_by_id(TALLOC_CTX *mem_ctx,
           "Invalidating group %u from memory cache\n", gid);
 
     sss_mmap_cache_gr_invalidate_gid(&nctx->grp_mc_ctx, gid);
+    cache_req_hot_cache_clear(nctx->rctx);
 
     return EOK;
 }
 
+static void sss_nss_memorycache_store_entry_done(struct tevent_req *subreq);
+
+/* Stores an entry looked up by another NSS responder instance. The entry is
+ * read from the cache again, the other instance already asked the data
+ * provider to update it. */
+static errno_t
+sss_nss_memorycache_store_entry(TALLOC_CTX *mem_ctx,
+                                struct sbus_request *sbus_req,
+                                struct sss_nss_ctx *nctx,
+                                uint32_t type,
+                                const char *name,
+                                uint32_t id)
+{
+    struct sss_nss_cmd_ctx *cmd_ctx;
+    struct cache_req_data *data;
+    struct tevent_req *subreq;
+    errno_t ret;
+
+    DEBUG(SSSDBG_TRACE_LIBS, "Storing [%s][%u] in memory cache\n", name, id);
+
+    cmd_ctx = talloc_zero(nctx, struct sss_nss_cmd_ctx);
+    if (cmd_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    cmd_ctx->type = type;
+    cmd_ctx->nss_ctx = nctx;
+
+    switch (type) {
+    case CACHE_REQ_USER_BY_NAME:
+    case CACHE_REQ_USER_BY_ID:
+        cmd_ctx->fill_fn = sss_nss_protocol_fill_pwent;
+        break;
+    case CACHE_REQ_GROUP_BY_NAME:
+    case CACHE_REQ_GROUP_BY_ID:
+        cmd_ctx->fill_fn = sss_nss_protocol_fill_grent;
+        break;
+    case CACHE_REQ_INITGROUPS:
+    case CACHE_REQ_INITGROUPS_BY_UPN:
+        cmd_ctx->fill_fn = sss_nss_protocol_fill_initgr;
+        break;
+    default:
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unsupported request type %u\n", type);
+        ret = EINVAL;
+        goto done;
+    }
+
+    if (type == CACHE_REQ_USER_BY_ID || type == CACHE_REQ_GROUP_BY_ID) {
+        data = cache_req_data_id(cmd_ctx, type, id);
+    } else {
+        cmd_ctx->rawname = talloc_strdup(cmd_ctx, name);
+        if (cmd_ctx->rawname == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        data = cache_req_data_name(cmd_ctx, type, name);
+    }
+    if (data == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to set cache request data!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    cache_req_data_set_bypass_dp(data, true);
+
+    subreq = cache_req_send(cmd_ctx, nctx->rctx->ev, nctx->rctx,
+                            nctx->rctx->ncache, 0, CACHE_REQ_POSIX_DOM,
+                            NULL, data);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to send cache request!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, sss_nss_memorycache_store_entry_done,
+                            cmd_ctx);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(cmd_ctx);
+    }
+
+    return ret;
+}
+
+static void sss_nss_memorycache_store_entry_done(struct tevent_req *subreq)
+{
+    struct cache_req_result *result;
+    struct sss_nss_cmd_ctx *cmd_ctx;
+    struct sss_packet *packet;
+    errno_t ret;
+
+    cmd_ctx = tevent_req_callback_data(subreq, struct sss_nss_cmd_ctx);
+
+    ret = cache_req_single_domain_recv(cmd_ctx, subreq, &result);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Entry to store was not found [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /* The fill functions store the entries as they build the reply, which
+     * is thrown away. */
+    ret = sss_packet_new(cmd_ctx, 0, SSS_CLI_NULL, &packet);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = cmd_ctx->fill_fn(cmd_ctx->nss_ctx, cmd_ctx, packet, result);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to store entry [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+
+done:
+    talloc_free(cmd_ctx);
+}
+
+static errno_t
+sss_nss_memorycache_delete_entry(TALLOC_CTX *mem_ctx,
+                                 struct sbus_request *sbus_req,
+                                 struct sss_nss_ctx *nctx,
+                                 uint32_t type,
+                                 const char *name,
+                                 uint32_t id)
+{
+    DEBUG(SSSDBG_TRACE_LIBS, "Deleting [%s][%u] from memory cache\n",
+          name, id);
+
+    return memcache_delete_entry(nctx, nctx->rctx, NULL,
+                                 name[0] == '\0' ? NULL : name, id, type);
+}
+
+static void sss_nss_memcache_forward_store_done(struct tevent_req *subreq)
+{
+    errno_t ret;
+
+    ret = sbus_call_nss_memcache_StoreEntry_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to forward memory cache store [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+}
+
+static void sss_nss_memcache_forward_delete_done(struct tevent_req *subreq)
+{
+    errno_t ret;
+
+    ret = sbus_call_nss_memcache_DeleteEntry_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to forward memory cache delete [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+}
+
+void
+sss_nss_memcache_forward_store(struct sss_nss_ctx *nss_ctx,
+                               enum cache_req_type type,
+                               const char *name,
+                               uint32_t id)
+{
+    struct tevent_req *subreq;
+
+    if (!nss_ctx->forward_mc) {
+        return;
+    }
+
+    subreq = sbus_call_nss_memcache_StoreEntry_send(nss_ctx,
+                                                    nss_ctx->rctx->sbus_conn,
+                                                    SSS_BUS_NSS, SSS_BUS_PATH,
+                                                    type,
+                                                    name == NULL ? "" : name,
+                                                    id);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to forward memory cache store\n");
+        return;
+    }
+
+    tevent_req_set_callback(subreq, sss_nss_memcache_forward_store_done, NULL);
+}
+
+void
+sss_nss_memcache_forward_delete(struct sss_nss_ctx *nss_ctx,
+                                enum sss_mc_type type,
+                                const char *name,
+                                uint32_t id)
+{
+    struct tevent_req *subreq;
+
+    if (!nss_ctx->forward_mc) {
+        return;
+    }
+
+    subreq = sbus_call_nss_memcache_DeleteEntry_send(nss_ctx,
+                                                     nss_ctx->rctx->sbus_conn,
+                                                     SSS_BUS_NSS, SSS_BUS_PATH,
+                                                     type,
+                                                     name == NULL ? "" : name,
+                                                     id);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to forward memory cache delete\n");
+        return;
+    }
+
+    tevent_req_set_callback(subreq, sss_nss_memcache_forward_delete_done, NULL);
+}
+
 errno_t
 sss_nss_register_backend_iface(struct sbus_connection *conn,
                                struct sss_nss_ctx *nss_ctx)
@@ -223,7 +443,11 @@ sss_nss_register_backend_iface(struct sbus_connection *conn,
         sssd_nss_MemoryCache,
         SBUS_METHODS(
             SBUS_SYNC(METHOD, sssd_nss_MemoryCache, UpdateInitgroups,
-                      sss_nss_memorycache_update_initgroups, nss_ctx)
+                      sss_nss_memorycache_update_initgroups, nss_ctx),
+            SBUS_SYNC(METHOD, sssd_nss_MemoryCache, StoreEntry,
+                      sss_nss_memorycache_store_entry, nss_ctx),
+            SBUS_SYNC(METHOD, sssd_nss_MemoryCache, DeleteEntry,
+                      sss_nss_memorycache_delete_entry, nss_ctx)
         ),
         SBUS_SIGNALS(SBUS_NO_SIGNALS),
         SBUS_PROPERTIES(SBUS_NO_PROPERTIES)
@@ -54,6 +54,14 @@ struct sss_nss_enum_ctx {
     struct setent_req_list *notify_list;
 };
 
+/* Members of a group which were not sent yet. */
+struct sss_nss_grmem_stream {
+    struct sss_domain_info *domain;
+    struct ldb_message *msg;
+    const char *group_name;
+    unsigned int next;
+};
+
 struct sss_nss_state_ctx {
     struct sss_nss_enum_index pwent;
     struct sss_nss_enum_index grent;
@@ -63,6 +71,9 @@ struct sss_nss_state_ctx {
     struct sss_nss_enum_index netent;
 
     const char *netgroup;
+
+    /* Group whose members are sent in several replies. */
+    struct sss_nss_grmem_stream *grmem;
 };
 
 struct sss_nss_ctx {
@@ -93,12 +104,32 @@ struct sss_nss_ctx {
     struct sss_mc_ctx *grp_mc_ctx;
     struct sss_mc_ctx *initgr_mc_ctx;
     struct sss_mc_ctx *sid_mc_ctx;
+    struct sss_mc_ctx *netgr_mc_ctx;
+    struct sss_mc_ctx *svc_mc_ctx;
+
+    /* index of this NSS responder process, only the first one writes the
+     * memory cache */
+    int instance;
+    /* the other instances forward the memory cache updates to it */
+    bool forward_mc;
 };
 
 struct sss_cmd_table *get_sss_nss_cmds(void);
 
 int sss_nss_connection_setup(struct cli_ctx *cli_ctx);
 
+void
+sss_nss_memcache_forward_store(struct sss_nss_ctx *nss_ctx,
+                               enum cache_req_type type,
+                               const char *name,
+                               uint32_t id);
+
+void
+sss_nss_memcache_forward_delete(struct sss_nss_ctx *nss_ctx,
+                                enum sss_mc_type type,
+                                const char *name,
+                                uint32_t id);
+
 errno_t
 memcache_delete_entry(struct sss_nss_ctx *nss_ctx,
                       struct resp_ctx *rctx,
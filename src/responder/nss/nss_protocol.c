@@ -99,6 +99,101 @@ done:
     sss_nss_protocol_done(cli_ctx, ret);
 }
 
+errno_t
+sss_nss_protocol_fill_multi(struct sss_nss_ctx *nss_ctx,
+                            struct sss_nss_cmd_ctx *cmd_ctx,
+                            struct sss_packet *packet,
+                            uint32_t num_keys,
+                            errno_t *errors,
+                            struct cache_req_result **results)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_packet *key_packet;
+    uint8_t *key_body;
+    size_t key_blen;
+    uint32_t num_results;
+    uint32_t error;
+    uint8_t *body;
+    size_t blen;
+    size_t rp;
+    uint32_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    /* First two fields (number of keys and reserved), filled up later. */
+    ret = sss_packet_grow(packet, 2 * sizeof(uint32_t));
+    if (ret != EOK) {
+        goto done;
+    }
+
+    rp = 2 * sizeof(uint32_t);
+
+    for (i = 0; i < num_keys; i++) {
+        talloc_free_children(tmp_ctx);
+        error = errors[i];
+        key_body = NULL;
+        key_blen = 0;
+
+        /* Each key is answered exactly as a single key request would be. */
+        if (error == EOK) {
+            ret = sss_packet_new(tmp_ctx, 0, SSS_CLI_NULL, &key_packet);
+            if (ret != EOK) {
+                goto done;
+            }
+
+            error = cmd_ctx->fill_fn(nss_ctx, cmd_ctx, key_packet, results[i]);
+            if (error == EOK) {
+                /* large member lists are appended as chunks */
+                error = sss_packet_flatten(key_packet);
+            }
+            if (error == EOK) {
+                sss_packet_get_body(key_packet, &key_body, &key_blen);
+                SAFEALIGN_COPY_UINT32(&num_results, key_body, NULL);
+                if (num_results == 0) {
+                    error = ENOENT;
+                }
+            }
+
+            if (error != EOK) {
+                key_blen = 0;
+            }
+        }
+
+        ret = sss_packet_grow(packet, 2 * sizeof(uint32_t) + key_blen);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        sss_packet_get_body(packet, &body, &blen);
+
+        SAFEALIGN_SET_UINT32(&body[rp], error, &rp);
+        SAFEALIGN_SET_UINT32(&body[rp], key_blen, &rp);
+        if (key_blen > 0) {
+            memcpy(&body[rp], key_body, key_blen);
+            rp += key_blen;
+        }
+    }
+
+    sss_packet_get_body(packet, &body, &blen);
+    SAFEALIGN_COPY_UINT32(body, &num_keys, NULL);
+    SAFEALIGN_SETMEM_UINT32(body + sizeof(uint32_t), 0, NULL); /* reserved */
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+
+    if (ret != EOK) {
+        sss_packet_set_size(packet, 0);
+    }
+
+    return ret;
+}
+
 errno_t
 sss_nss_protocol_parse_name(struct cli_ctx *cli_ctx, const char **_rawname)
 {
@@ -245,6 +340,60 @@ sss_nss_protocol_parse_id_ex(struct cli_ctx *cli_ctx, uint32_t *_id,
     return EOK;
 }
 
+errno_t
+sss_nss_protocol_parse_id_multi(TALLOC_CTX *mem_ctx,
+                                struct cli_ctx *cli_ctx,
+                                uint32_t *_flags,
+                                uint32_t *_num_ids,
+                                uint32_t **_ids)
+{
+    struct cli_protocol *pctx;
+    uint8_t *body;
+    size_t blen;
+    size_t rp = 0;
+    uint32_t flags;
+    uint32_t num_ids;
+    uint32_t *ids;
+    uint32_t i;
+
+    pctx = talloc_get_type(cli_ctx->protocol_ctx, struct cli_protocol);
+
+    sss_packet_get_body(pctx->creq->in, &body, &blen);
+
+    if (blen < 2 * sizeof(uint32_t)) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Body too short!\n");
+        return EINVAL;
+    }
+
+    SAFEALIGN_COPY_UINT32(&flags, body, &rp);
+    SAFEALIGN_COPY_UINT32(&num_ids, body + rp, &rp);
+
+    if (num_ids == 0 || num_ids > SSS_NSS_MULTI_MAX_KEYS) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid number of IDs [%u]!\n", num_ids);
+        return EINVAL;
+    }
+
+    if (blen != (2 + (size_t)num_ids) * sizeof(uint32_t)) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Body has unexpected size!\n");
+        return EINVAL;
+    }
+
+    ids = talloc_array(mem_ctx, uint32_t, num_ids);
+    if (ids == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < num_ids; i++) {
+        SAFEALIGN_COPY_UINT32(&ids[i], body + rp, &rp);
+    }
+
+    *_flags = flags;
+    *_num_ids = num_ids;
+    *_ids = ids;
+
+    return EOK;
+}
+
 errno_t
 sss_nss_protocol_parse_limit(struct cli_ctx *cli_ctx, uint32_t *_limit)
 {
@@ -62,7 +62,9 @@ struct sss_nss_cmd_ctx {
     uint32_t enum_limit;
 
     /* For services. */
+    const char *svc_name;
     const char *svc_protocol;
+    uint16_t svc_port;
 
     /* For SID lookups. */
     enum sss_id_type sid_id_type;
@@ -84,6 +86,18 @@ void sss_nss_protocol_reply(struct cli_ctx *cli_ctx,
                         struct cache_req_result *result,
                         sss_nss_protocol_fill_packet_fn fill_fn);
 
+/**
+ * Fill the reply of a *_MULTI command with the reply of cmd_ctx->fill_fn
+ * for each key. Keys which failed have their error set in errors.
+ */
+errno_t
+sss_nss_protocol_fill_multi(struct sss_nss_ctx *nss_ctx,
+                            struct sss_nss_cmd_ctx *cmd_ctx,
+                            struct sss_packet *packet,
+                            uint32_t num_keys,
+                            errno_t *errors,
+                            struct cache_req_result **results);
+
 /* Parse input packet. */
 
 errno_t
@@ -100,6 +114,13 @@ errno_t
 sss_nss_protocol_parse_id_ex(struct cli_ctx *cli_ctx, uint32_t *_id,
                          uint32_t *_flags);
 
+errno_t
+sss_nss_protocol_parse_id_multi(TALLOC_CTX *mem_ctx,
+                                struct cli_ctx *cli_ctx,
+                                uint32_t *_flags,
+                                uint32_t *_num_ids,
+                                uint32_t **_ids);
+
 errno_t
 sss_nss_protocol_parse_limit(struct cli_ctx *cli_ctx, uint32_t *_limit);
 
@@ -141,6 +162,11 @@ sss_nss_protocol_fill_grent(struct sss_nss_ctx *nss_ctx,
                         struct sss_packet *packet,
                         struct cache_req_result *result);
 
+errno_t
+sss_nss_protocol_fill_grmem(struct sss_nss_ctx *nss_ctx,
+                            struct sss_nss_state_ctx *state_ctx,
+                            struct sss_packet *packet);
+
 errno_t
 sss_nss_protocol_fill_initgr(struct sss_nss_ctx *nss_ctx,
                          struct sss_nss_cmd_ctx *cmd_ctx,
@@ -21,6 +21,14 @@
 #include "responder/nss/nss_protocol.h"
 #include "util/sss_format.h"
 
+/* Members of larger groups are not copied into the packet buffer but sent
+ * as a separate chunk of the reply. */
+#define SSS_NSS_MEMBERS_CHUNK_MIN_SIZE 4096
+
+/* Number of members sent in one reply to clients which can request the
+ * rest with SSS_NSS_GETGRMEMBERS. */
+#define SSS_NSS_GRMEM_PAGE_SIZE 2048
+
 static errno_t
 sss_nss_get_grent(TALLOC_CTX *mem_ctx,
                   struct sss_nss_ctx *nss_ctx,
@@ -114,25 +122,34 @@ sss_nss_get_group_ghosts(struct sss_domain_info *domain,
 }
 
 static errno_t
-sss_nss_protocol_fill_members(struct sss_packet *packet,
+sss_nss_protocol_fill_members(TALLOC_CTX *mem_ctx,
                               struct sss_nss_ctx *nss_ctx,
                               struct sss_domain_info *domain,
                               struct ldb_message *msg,
                               const char *group_name,
-                              size_t *_rp,
+                              unsigned int start,
+                              unsigned int limit,
+                              unsigned int *_next,
+                              uint8_t **_members,
+                              size_t *_members_size,
                               uint32_t *_num_members)
 {
     TALLOC_CTX *tmp_ctx;
     struct resp_ctx *rctx = nss_ctx->rctx;
     struct ldb_message_element *members[2];
-    struct ldb_message_element *el;
-    struct sized_string *name;
+    struct ldb_val *value;
+    struct sized_string **names;
     const char *member_name;
     uint32_t num_members = 0;
-    size_t body_len;
-    uint8_t *body;
+    size_t members_size = 0;
+    unsigned int num_values[2];
+    unsigned int total;
+    unsigned int end;
+    unsigned int k;
+    uint8_t *buf = NULL;
+    size_t rp;
     errno_t ret;
-    int i, j;
+    int i;
 
     tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
@@ -160,46 +177,72 @@ sss_nss_protocol_fill_members(struct sss_packet *packet,
         goto done;
     }
 
-    sss_packet_get_body(packet, &body, &body_len);
+    /* Ghost members follow the members, @start and @limit count both. */
+    for (i = 0; i < 2; i++) {
+        num_values[i] = members[i] == NULL ? 0 : members[i]->num_values;
+    }
+    total = num_values[0] + num_values[1];
 
-    for (i = 0; i < sizeof(members) / sizeof(members[0]); i++) {
-        el = members[i];
-        if (el == NULL) {
-            continue;
-        }
+    end = total;
+    if (limit != 0 && start < total && total - start > limit) {
+        end = start + limit;
+    }
 
-        for (j = 0; j < el->num_values; j++) {
-            member_name = (const char *)el->values[j].data;
-
-            if (nss_ctx->filter_users_in_groups) {
-                ret = sss_ncache_check_user(rctx->ncache, domain, member_name);
-                if (ret == EEXIST) {
-                    DEBUG(SSSDBG_TRACE_FUNC,
-                          "Group [%s] member [%s] filtered out! "
-                          "(negative cache)\n", group_name, member_name);
-                    continue;
-                }
-            }
+    names = talloc_zero_array(tmp_ctx, struct sized_string *,
+                              (start < end ? end - start : 0) + 1);
+    if (names == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
 
-            ret = sized_domain_name(tmp_ctx, rctx, member_name, &name);
-            if (ret != EOK) {
-                DEBUG(SSSDBG_OP_FAILURE, "Unable to get sized name [%d]: %s\n",
-                      ret, sss_strerror(ret));
-                goto done;
+    for (k = start; k < end; k++) {
+        if (k < num_values[0]) {
+            value = &members[0]->values[k];
+        } else {
+            value = &members[1]->values[k - num_values[0]];
+        }
+        member_name = (const char *)value->data;
+
+        if (nss_ctx->filter_users_in_groups) {
+            ret = sss_ncache_check_user(rctx->ncache, domain, member_name);
+            if (ret == EEXIST) {
+                DEBUG(SSSDBG_TRACE_FUNC,
+                      "Group [%s] member [%s] filtered out! "
+                      "(negative cache)\n", group_name, member_name);
+                continue;
             }
+        }
 
-            ret = sss_packet_grow(packet, name->len);
-            if (ret != EOK) {
-                goto done;
-            }
+        ret = sized_domain_name(names, rctx, member_name,
+                                &names[num_members]);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to get sized name [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            goto done;
+        }
 
-            sss_packet_get_body(packet, &body, &body_len);
-            SAFEALIGN_SET_STRING(&body[*_rp], name->str, name->len, _rp);
+        members_size += names[num_members]->len;
+        num_members++;
+    }
 
-            num_members++;
+    /* All members are copied at once, so even groups with many thousands of
+     * members do not reallocate the buffer. */
+    if (members_size > 0) {
+        buf = talloc_size(tmp_ctx, members_size);
+        if (buf == NULL) {
+            ret = ENOMEM;
+            goto done;
         }
     }
 
+    rp = 0;
+    for (i = 0; i < num_members; i++) {
+        SAFEALIGN_SET_STRING(&buf[rp], names[i]->str, names[i]->len, &rp);
+    }
+
+    *_members = talloc_steal(mem_ctx, buf);
+    *_members_size = members_size;
+    *_next = end < total ? end : 0;
     ret = EOK;
 
 done:
@@ -209,6 +252,102 @@ done:
     return ret;
 }
 
+static errno_t
+sss_nss_grmem_stream_start(struct sss_nss_state_ctx *state_ctx,
+                           struct sss_domain_info *domain,
+                           struct ldb_message *msg,
+                           const char *group_name,
+                           unsigned int next)
+{
+    struct sss_nss_grmem_stream *grmem;
+
+    grmem = talloc_zero(state_ctx, struct sss_nss_grmem_stream);
+    if (grmem == NULL) {
+        return ENOMEM;
+    }
+
+    grmem->group_name = talloc_strdup(grmem, group_name);
+    if (grmem->group_name == NULL) {
+        talloc_free(grmem);
+        return ENOMEM;
+    }
+
+    grmem->domain = domain;
+    grmem->msg = talloc_steal(grmem, msg);
+    grmem->next = next;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Group [%s] is sent in several replies\n",
+          group_name);
+
+    state_ctx->grmem = grmem;
+
+    return EOK;
+}
+
+static errno_t
+sss_nss_protocol_append_members(struct sss_packet *packet,
+                                size_t *_rp,
+                                uint8_t *members,
+                                size_t members_size)
+{
+    size_t body_len;
+    uint8_t *body;
+    errno_t ret;
+
+    if (members_size >= SSS_NSS_MEMBERS_CHUNK_MIN_SIZE) {
+        return sss_packet_append_chunk(packet, members, members_size);
+    }
+
+    if (members_size == 0) {
+        return EOK;
+    }
+
+    ret = sss_packet_grow(packet, members_size);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sss_packet_get_body(packet, &body, &body_len);
+    memcpy(&body[*_rp], members, members_size);
+    *_rp += members_size;
+
+    return EOK;
+}
+
+/* The memory cache holds all members of a group, so those of groups which
+ * are sent in several replies are collected once more. */
+static errno_t
+sss_nss_protocol_store_group(TALLOC_CTX *mem_ctx,
+                             struct sss_nss_ctx *nss_ctx,
+                             struct sss_domain_info *domain,
+                             struct ldb_message *msg,
+                             struct sized_string *name,
+                             struct sized_string *pwfield,
+                             uint32_t gid,
+                             unsigned int next,
+                             uint32_t num_members,
+                             uint8_t *members,
+                             size_t members_size)
+{
+    unsigned int unused;
+    errno_t ret;
+
+    if (next != 0) {
+        members = NULL;
+        ret = sss_nss_protocol_fill_members(mem_ctx, nss_ctx, domain, msg,
+                                            name->str, 0, 0, &unused,
+                                            &members, &members_size,
+                                            &num_members);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return sss_mmap_cache_gr_store(&nss_ctx->grp_mc_ctx, name, pwfield,
+                                   gid, num_members, (char *)members,
+                                   members_size);
+}
+
 errno_t
 sss_nss_protocol_fill_grent(struct sss_nss_ctx *nss_ctx,
                             struct sss_nss_cmd_ctx *cmd_ctx,
@@ -222,13 +361,15 @@ sss_nss_protocol_fill_grent(struct sss_nss_ctx *nss_ctx,
     uint32_t gid;
     uint32_t num_results;
     uint32_t num_members;
-    char *members;
+    uint32_t reply_flags = 0;
+    uint8_t *members;
     size_t members_size;
+    unsigned int next;
     size_t rp;
-    size_t rp_members;
     size_t rp_num_members;
     size_t body_len;
     uint8_t *body;
+    bool stream;
     int i;
     errno_t ret;
 
@@ -237,6 +378,18 @@ sss_nss_protocol_fill_grent(struct sss_nss_ctx *nss_ctx,
         return ENOMEM;
     }
 
+    /* The members of a single group can be sent in several replies if the
+     * client asked for it. The remaining members are kept with the
+     * connection, so this is not possible for pipelined requests. */
+    stream = (cmd_ctx->flags & SSS_NSS_EX_FLAG_STREAM_MEMBERS) != 0
+             && !cmd_ctx->enumeration
+             && result->count == 1
+             && cmd_ctx->cli_ctx->conn == NULL
+             && cmd_ctx->state_ctx != NULL;
+    if (stream) {
+        talloc_zfree(cmd_ctx->state_ctx->grmem);
+    }
+
     /* First two fields (length and reserved), filled up later. */
     ret = sss_packet_grow(packet, 2 * sizeof(uint32_t));
     if (ret != EOK) {
@@ -278,36 +431,55 @@ sss_nss_protocol_fill_grent(struct sss_nss_ctx *nss_ctx,
         SAFEALIGN_SET_UINT32(&body[rp], 0, &rp);
         SAFEALIGN_SET_STRING(&body[rp], name->str, name->len, &rp);
         SAFEALIGN_SET_STRING(&body[rp], pwfield.str, pwfield.len, &rp);
-        rp_members = rp;
 
         /* Fill members. */
-        ret = sss_nss_protocol_fill_members(packet, nss_ctx, result->domain, msg,
-                                        name->str, &rp, &num_members);
+        members = NULL;
+        ret = sss_nss_protocol_fill_members(tmp_ctx, nss_ctx, result->domain,
+                                            msg, name->str, 0,
+                                            stream ? SSS_NSS_GRMEM_PAGE_SIZE : 0,
+                                            &next, &members, &members_size,
+                                            &num_members);
         if (ret != EOK) {
             goto done;
         }
 
-        sss_packet_get_body(packet, &body, &body_len);
         SAFEALIGN_SET_UINT32(&body[rp_num_members], num_members, NULL);
 
         num_results++;
 
+        if (next != 0) {
+            ret = sss_nss_grmem_stream_start(cmd_ctx->state_ctx,
+                                             result->domain, msg,
+                                             name->str, next);
+            if (ret != EOK) {
+                goto done;
+            }
+
+            reply_flags |= SSS_NSS_GR_MORE_MEMBERS;
+        }
+
         /* Do not store entry in memory cache during enumeration or when
          * requested or if cache explicitly disabled. */
         if (!cmd_ctx->enumeration
                 && ((cmd_ctx->flags & SSS_NSS_EX_FLAG_INVALIDATE_CACHE) == 0)
                 && (nss_ctx->grp_mc_ctx != NULL)) {
-            members = (char *)&body[rp_members];
-            members_size = body_len - rp_members;
-            ret = sss_mmap_cache_gr_store(&nss_ctx->grp_mc_ctx, name, &pwfield,
-                                          gid, num_members, members,
-                                          members_size);
+            ret = sss_nss_protocol_store_group(tmp_ctx, nss_ctx,
+                                               result->domain, msg, name,
+                                               &pwfield, gid, next,
+                                               num_members, members,
+                                               members_size);
             if (ret != EOK) {
                 DEBUG(SSSDBG_OP_FAILURE,
                       "Failed to store group %s (%s) in mem-cache [%d]: %s!\n",
                       name->str, result->domain->name, ret, sss_strerror(ret));
             }
         }
+
+        ret = sss_nss_protocol_append_members(packet, &rp, members,
+                                              members_size);
+        if (ret != EOK) {
+            goto done;
+        }
     }
 
     ret = EOK;
@@ -316,17 +488,89 @@ done:
     talloc_free(tmp_ctx);
 
     if (ret != EOK) {
+        if (stream) {
+            talloc_zfree(cmd_ctx->state_ctx->grmem);
+        }
         sss_packet_set_size(packet, 0);
         return ret;
     }
 
     sss_packet_get_body(packet, &body, &body_len);
     SAFEALIGN_COPY_UINT32(body, &num_results, NULL);
-    SAFEALIGN_SETMEM_UINT32(body + sizeof(uint32_t), 0, NULL); /* reserved */
+    SAFEALIGN_COPY_UINT32(body + sizeof(uint32_t), &reply_flags, NULL);
 
     return EOK;
 }
 
+errno_t
+sss_nss_protocol_fill_grmem(struct sss_nss_ctx *nss_ctx,
+                            struct sss_nss_state_ctx *state_ctx,
+                            struct sss_packet *packet)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_nss_grmem_stream *grmem = state_ctx->grmem;
+    uint32_t num_members;
+    uint32_t reply_flags;
+    uint8_t *members;
+    size_t members_size;
+    unsigned int next = 0;
+    size_t rp;
+    size_t body_len;
+    uint8_t *body;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    /* Number of members and flags. */
+    ret = sss_packet_grow(packet, 2 * sizeof(uint32_t));
+    if (ret != EOK) {
+        goto done;
+    }
+
+    rp = 2 * sizeof(uint32_t);
+
+    members = NULL;
+    ret = sss_nss_protocol_fill_members(tmp_ctx, nss_ctx, grmem->domain,
+                                        grmem->msg, grmem->group_name,
+                                        grmem->next, SSS_NSS_GRMEM_PAGE_SIZE,
+                                        &next, &members, &members_size,
+                                        &num_members);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_nss_protocol_append_members(packet, &rp, members, members_size);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    reply_flags = next != 0 ? SSS_NSS_GR_MORE_MEMBERS : 0;
+
+    sss_packet_get_body(packet, &body, &body_len);
+    SAFEALIGN_COPY_UINT32(body, &num_members, NULL);
+    SAFEALIGN_COPY_UINT32(body + sizeof(uint32_t), &reply_flags, NULL);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+
+    if (ret != EOK || next == 0) {
+        talloc_zfree(state_ctx->grmem);
+    } else {
+        grmem->next = next;
+    }
+
+    if (ret != EOK) {
+        sss_packet_set_size(packet, 0);
+    }
+
+    return ret;
+}
+
 static bool is_group_filtered(struct sss_nc_ctx *ncache,
                               struct sss_domain_info *domain,
                               const char *grp_name, gid_t gid)
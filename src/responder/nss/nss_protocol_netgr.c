@@ -110,6 +110,8 @@ sss_nss_protocol_fill_netgrent(struct sss_nss_ctx *nss_ctx,
     struct sysdb_netgroup_ctx **entries;
     struct sysdb_netgroup_ctx *entry;
     struct sss_nss_enum_index *idx;
+    struct sized_string name;
+    uint32_t first_result;
     uint32_t num_results;
     size_t rp;
     size_t body_len;
@@ -133,6 +135,7 @@ sss_nss_protocol_fill_netgrent(struct sss_nss_ctx *nss_ctx,
     }
 
     rp = 2 * sizeof(uint32_t);
+    first_result = idx->result;
 
     if (entries == NULL) {
         num_results = 0;
@@ -177,5 +180,19 @@ done:
     SAFEALIGN_COPY_UINT32(body, &num_results, NULL);
     SAFEALIGN_SETMEM_UINT32(body + sizeof(uint32_t), 0, NULL); /* reserved */
 
+    /* The reply holds the whole netgroup, so it can serve later
+     * setnetgrent() and innetgr() calls from the memory cache. */
+    if (nss_ctx->netgr_mc_ctx != NULL && num_results > 0 && first_result == 0
+            && cmd_ctx->state_ctx->netgroup != NULL) {
+        to_sized_string(&name, cmd_ctx->state_ctx->netgroup);
+        ret = sss_mmap_cache_netgr_store(&nss_ctx->netgr_mc_ctx, &name,
+                                         body, body_len);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Failed to store netgroup %s in mmap cache [%d]: %s!\n",
+                  name.str, ret, sss_strerror(ret));
+        }
+    }
+
     return EOK;
 }
@@ -163,6 +163,47 @@ done:
     return ret;
 }
 
+static void
+sss_nss_protocol_mc_store_svcent(struct sss_nss_ctx *nss_ctx,
+                                 struct sss_nss_cmd_ctx *cmd_ctx,
+                                 uint8_t *body, size_t body_len)
+{
+    struct sized_string key;
+    const char *protocol;
+    char *keystr;
+    errno_t ret;
+
+    protocol = cmd_ctx->svc_protocol == NULL ? "" : cmd_ctx->svc_protocol;
+
+    switch (cmd_ctx->type) {
+    case CACHE_REQ_SVC_BY_NAME:
+        keystr = talloc_asprintf(NULL, "%s/%s", cmd_ctx->svc_name, protocol);
+        break;
+    case CACHE_REQ_SVC_BY_PORT:
+        keystr = talloc_asprintf(NULL, "%"PRIu16"/%s",
+                                 cmd_ctx->svc_port, protocol);
+        break;
+    default:
+        /* enumeration is not cached */
+        return;
+    }
+
+    if (keystr == NULL) {
+        return;
+    }
+
+    to_sized_string(&key, keystr);
+    ret = sss_mmap_cache_svc_store(&nss_ctx->svc_mc_ctx, &key,
+                                   body, body_len);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Failed to store service %s in mmap cache [%d]: %s!\n",
+              keystr, ret, sss_strerror(ret));
+    }
+
+    talloc_free(keystr);
+}
+
 errno_t
 sss_nss_protocol_fill_svcent(struct sss_nss_ctx *nss_ctx,
                              struct sss_nss_cmd_ctx *cmd_ctx,
@@ -266,5 +307,10 @@ done:
     SAFEALIGN_COPY_UINT32(body, &num_results, NULL);
     SAFEALIGN_SETMEM_UINT32(body + sizeof(uint32_t), 0, NULL); /* reserved */
 
+    /* clients accept exactly one result for lookups by name or port */
+    if (nss_ctx->svc_mc_ctx != NULL && num_results == 1) {
+        sss_nss_protocol_mc_store_svcent(nss_ctx, cmd_ctx, body, body_len);
+    }
+
     return EOK;
 }
@@ -58,6 +58,12 @@ sss_nss_clear_memcache(TALLOC_CTX *mem_ctx,
     int memcache_timeout;
     errno_t ret;
 
+    if (nctx->instance != 0) {
+        /* the memory cache and the flag file belong to the first instance */
+        cache_req_hot_cache_clear(nctx->rctx);
+        return EOK;
+    }
+
     if (access(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG, F_OK) < 0) {
         ret = errno;
         if (ret == ENOENT) {
@@ -92,6 +98,8 @@ sss_nss_clear_memcache(TALLOC_CTX *mem_ctx,
     }
 
     DEBUG(SSSDBG_TRACE_FUNC, "Clearing memory caches.\n");
+    cache_req_hot_cache_clear(nctx->rctx);
+
     ret = sss_mmap_cache_reinit(nctx,
                                 -1, /* keep current size */
                                 (time_t) memcache_timeout,
@@ -122,6 +130,30 @@ sss_nss_clear_memcache(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    if (nctx->netgr_mc_ctx != NULL) {
+        ret = sss_mmap_cache_reinit(nctx,
+                                    -1, /* keep current size */
+                                    (time_t)memcache_timeout,
+                                    &nctx->netgr_mc_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "netgroup mmap cache invalidation failed\n");
+            goto done;
+        }
+    }
+
+    if (nctx->svc_mc_ctx != NULL) {
+        ret = sss_mmap_cache_reinit(nctx,
+                                    -1, /* keep current size */
+                                    (time_t)memcache_timeout,
+                                    &nctx->svc_mc_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "services mmap cache invalidation failed\n");
+            goto done;
+        }
+    }
+
 done:
     if (unlink(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG) != 0) {
         if (errno != ENOENT)
@@ -154,6 +186,14 @@ sss_nss_clear_negcache(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    /* the memory cache may be disabled */
+    ret = sss_mmap_cache_pw_invalidate_negative(&nctx->pwd_mc_ctx);
+    if (ret != EOK && ret != EINVAL) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to clear negative memory cache records\n");
+    }
+    ret = EOK;
+
 done:
     return ret;
 }
@@ -280,16 +320,25 @@ static int setup_memcaches(struct sss_nss_ctx *nctx)
     static const size_t SSS_MC_CACHE_GROUP_SIZE     =  6;
     static const size_t SSS_MC_CACHE_INITGROUP_SIZE = 10;
     static const size_t SSS_MC_CACHE_SID_SIZE       =  6;
+    static const size_t SSS_MC_CACHE_NETGROUP_SIZE  =  2;
+    static const size_t SSS_MC_CACHE_SERVICES_SIZE  =  2;
+    static const int SSS_MC_CACHE_MAX_GROWTH        =  1;
 
     int ret;
     int memcache_timeout;
+    int mc_max_growth;
+    bool mc_warm_start;
+    bool mc_clear_requested;
     int mc_size_passwd;
     int mc_size_group;
     int mc_size_initgroups;
     int mc_size_sid;
+    int mc_size_netgroup;
+    int mc_size_services;
 
     /* Remove the CLEAR_MC_FLAG file if exists. */
     ret = unlink(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG);
+    mc_clear_requested = (ret == 0);
     if (ret != 0 && errno != ENOENT) {
         ret = errno;
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -308,7 +357,7 @@ static int setup_memcaches(struct sss_nss_ctx *nctx)
         return ret;
     }
 
-    /* Get all memcache sizes from confdb (pwd, grp, initgr, sid) */
+    /* Get all memcache sizes from confdb (pwd, grp, initgr, sid, netgr, svc) */
 
     ret = confdb_get_int(nctx->rctx->cdb,
                          CONFDB_NSS_CONF_ENTRY,
@@ -358,11 +407,72 @@ static int setup_memcaches(struct sss_nss_ctx *nctx)
         return ret;
     }
 
+    ret = confdb_get_int(nctx->rctx->cdb,
+                         CONFDB_NSS_CONF_ENTRY,
+                         CONFDB_NSS_MEMCACHE_SIZE_NETGROUP,
+                         SSS_MC_CACHE_NETGROUP_SIZE,
+                         &mc_size_netgroup);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to get '"CONFDB_NSS_MEMCACHE_SIZE_NETGROUP
+              "' option from confdb.\n");
+        return ret;
+    }
+
+    ret = confdb_get_int(nctx->rctx->cdb,
+                         CONFDB_NSS_CONF_ENTRY,
+                         CONFDB_NSS_MEMCACHE_SIZE_SERVICES,
+                         SSS_MC_CACHE_SERVICES_SIZE,
+                         &mc_size_services);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to get '"CONFDB_NSS_MEMCACHE_SIZE_SERVICES
+              "' option from confdb.\n");
+        return ret;
+    }
+
+    ret = confdb_get_int(nctx->rctx->cdb,
+                         CONFDB_NSS_CONF_ENTRY,
+                         CONFDB_NSS_MEMCACHE_MAX_GROWTH,
+                         SSS_MC_CACHE_MAX_GROWTH,
+                         &mc_max_growth);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to get '"CONFDB_NSS_MEMCACHE_MAX_GROWTH
+              "' option from confdb.\n");
+        return ret;
+    }
+    if (mc_max_growth < 1) {
+        DEBUG(SSSDBG_CONF_SETTINGS,
+              "Invalid value %d of '"CONFDB_NSS_MEMCACHE_MAX_GROWTH"', "
+              "online growth of the fast cache is disabled\n", mc_max_growth);
+        mc_max_growth = 1;
+    }
+
+    ret = confdb_get_bool(nctx->rctx->cdb,
+                          CONFDB_NSS_CONF_ENTRY,
+                          CONFDB_NSS_MEMCACHE_WARM_START,
+                          false, &mc_warm_start);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to get '"CONFDB_NSS_MEMCACHE_WARM_START
+              "' option from confdb.\n");
+        return ret;
+    }
+    if (mc_warm_start && mc_clear_requested) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Memory cache was cleared by sss_cache, not reusing it\n");
+        mc_warm_start = false;
+    }
+
     /* Initialize the fast in-memory caches if they were not disabled */
 
     ret = sss_mmap_cache_init(nctx, "passwd",
                               SSS_MC_PASSWD,
                               mc_size_passwd * SSS_MC_CACHE_SLOTS_PER_MB,
+                              mc_size_passwd * SSS_MC_CACHE_SLOTS_PER_MB
+                                  * mc_max_growth,
+                              mc_warm_start,
                               (time_t)memcache_timeout,
                               &nctx->pwd_mc_ctx);
     if (ret) {
@@ -374,6 +484,9 @@ static int setup_memcaches(struct sss_nss_ctx *nctx)
     ret = sss_mmap_cache_init(nctx, "group",
                               SSS_MC_GROUP,
                               mc_size_group * SSS_MC_CACHE_SLOTS_PER_MB,
+                              mc_size_group * SSS_MC_CACHE_SLOTS_PER_MB
+                                  * mc_max_growth,
+                              mc_warm_start,
                               (time_t)memcache_timeout,
                               &nctx->grp_mc_ctx);
     if (ret) {
@@ -385,6 +498,9 @@ static int setup_memcaches(struct sss_nss_ctx *nctx)
     ret = sss_mmap_cache_init(nctx, "initgroups",
                               SSS_MC_INITGROUPS,
                               mc_size_initgroups * SSS_MC_CACHE_SLOTS_PER_MB,
+                              mc_size_initgroups * SSS_MC_CACHE_SLOTS_PER_MB
+                                  * mc_max_growth,
+                              mc_warm_start,
                               (time_t)memcache_timeout,
                               &nctx->initgr_mc_ctx);
     if (ret) {
@@ -396,6 +512,9 @@ static int setup_memcaches(struct sss_nss_ctx *nctx)
     ret = sss_mmap_cache_init(nctx, "sid",
                               SSS_MC_SID,
                               mc_size_sid * SSS_MC_CACHE_SLOTS_PER_MB,
+                              mc_size_sid * SSS_MC_CACHE_SLOTS_PER_MB
+                                  * mc_max_growth,
+                              mc_warm_start,
                               (time_t)memcache_timeout,
                               &nctx->sid_mc_ctx);
     if (ret) {
@@ -404,6 +523,34 @@ static int setup_memcaches(struct sss_nss_ctx *nctx)
               sss_strerror(ret));
     }
 
+    ret = sss_mmap_cache_init(nctx, "netgroup",
+                              SSS_MC_NETGROUP,
+                              mc_size_netgroup * SSS_MC_CACHE_SLOTS_PER_MB,
+                              mc_size_netgroup * SSS_MC_CACHE_SLOTS_PER_MB
+                                  * mc_max_growth,
+                              mc_warm_start,
+                              (time_t)memcache_timeout,
+                              &nctx->netgr_mc_ctx);
+    if (ret) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to initialize netgroup mmap cache: '%s'\n",
+              sss_strerror(ret));
+    }
+
+    ret = sss_mmap_cache_init(nctx, "services",
+                              SSS_MC_SERVICES,
+                              mc_size_services * SSS_MC_CACHE_SLOTS_PER_MB,
+                              mc_size_services * SSS_MC_CACHE_SLOTS_PER_MB
+                                  * mc_max_growth,
+                              mc_warm_start,
+                              (time_t)memcache_timeout,
+                              &nctx->svc_mc_ctx);
+    if (ret) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to initialize services mmap cache: '%s'\n",
+              sss_strerror(ret));
+    }
+
     return EOK;
 }
 
@@ -439,22 +586,38 @@ sss_nss_register_service_iface(struct sss_nss_ctx *nss_ctx,
 
 int sss_nss_process_init(TALLOC_CTX *mem_ctx,
                          struct tevent_context *ev,
-                         struct confdb_ctx *cdb)
+                         struct confdb_ctx *cdb,
+                         int instance)
 {
     struct resp_ctx *rctx;
     struct sss_cmd_table *nss_cmds;
     struct sss_nss_ctx *nctx;
+    const char *conn_name = SSS_BUS_NSS;
+    const char *svc_name = NSS_SBUS_SERVICE_NAME;
     int ret;
     enum idmap_error_code err;
     int fd_limit;
+    int memcache_timeout;
 
     nss_cmds = get_sss_nss_cmds();
 
+    /* Additional instances share the socket passed by the monitor but have
+     * a D-Bus name of their own. Only the first one receives the requests
+     * of the backends, which are about the memory cache it owns. */
+    if (instance != 0) {
+        conn_name = talloc_asprintf(mem_ctx, "%s_%d", SSS_BUS_NSS, instance);
+        svc_name = talloc_asprintf(mem_ctx, "%s_%d", NSS_SBUS_SERVICE_NAME,
+                                   instance);
+        if (conn_name == NULL || svc_name == NULL) {
+            return ENOMEM;
+        }
+    }
+
     ret = sss_process_init(mem_ctx, ev, cdb,
                            nss_cmds,
                            SSS_NSS_SOCKET_NAME, SCKT_RSP_UMASK,
                            CONFDB_NSS_CONF_ENTRY,
-                           SSS_BUS_NSS, NSS_SBUS_SERVICE_NAME,
+                           conn_name, svc_name,
                            sss_nss_connection_setup,
                            &rctx);
     if (ret != EOK) {
@@ -471,6 +634,10 @@ int sss_nss_process_init(TALLOC_CTX *mem_ctx,
 
     nctx->rctx = rctx;
     nctx->rctx->pvt_ctx = nctx;
+    nctx->instance = instance;
+    /* clients of the NSS responder may multiplex requests of all their
+     * threads over one connection */
+    nctx->rctx->pipelining = true;
 
     ret = sss_nss_get_config(nctx, cdb);
     if (ret != EOK) {
@@ -528,9 +695,26 @@ int sss_nss_process_init(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
-    ret = setup_memcaches(nctx);
-    if (ret != EOK) {
-        goto fail;
+    /* The fast in-memory caches have a single writer. The other instances
+     * do not map them at all, they ask the first one to store or delete
+     * the entries they look up. */
+    if (instance == 0) {
+        ret = setup_memcaches(nctx);
+        if (ret != EOK) {
+            goto fail;
+        }
+    } else {
+        ret = confdb_get_int(nctx->rctx->cdb,
+                             CONFDB_NSS_CONF_ENTRY,
+                             CONFDB_MEMCACHE_TIMEOUT,
+                             300, &memcache_timeout);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Failed to get 'memcache_timeout' option from confdb.\n");
+            goto fail;
+        }
+
+        nctx->forward_mc = (memcache_timeout > 0);
     }
 
     /* Set up file descriptor limits */
@@ -555,7 +739,7 @@ int sss_nss_process_init(TALLOC_CTX *mem_ctx,
 
     /* The responder is initialized. Now tell it to the monitor. */
     ret = sss_monitor_register_service(rctx, rctx->sbus_conn,
-                                       NSS_SBUS_SERVICE_NAME,
+                                       svc_name,
                                        NSS_SBUS_SERVICE_VERSION,
                                        MT_SVC_SERVICE);
     if (ret != EOK) {
@@ -589,6 +773,8 @@ int main(int argc, const char *argv[])
     poptContext pc;
     char *opt_logger = NULL;
     struct main_context *main_ctx;
+    int instance = 0;
+    char log_file[32];
     int ret;
 
     struct poptOption long_options[] = {
@@ -596,6 +782,8 @@ int main(int argc, const char *argv[])
         SSSD_MAIN_OPTS
         SSSD_LOGGER_OPTS
         SSSD_RESPONDER_OPTS
+        {"instance", 0, POPT_ARG_INT, &instance, 0,
+         _("Index of this NSS responder process"), NULL },
         POPT_TABLEEND
     };
 
@@ -618,7 +806,12 @@ int main(int argc, const char *argv[])
     poptFreeContext(pc);
 
     /* set up things like debug, signals, daemonization, etc. */
-    debug_log_file = "sssd_nss";
+    if (instance == 0) {
+        debug_log_file = "sssd_nss";
+    } else {
+        snprintf(log_file, sizeof(log_file), "sssd_nss_%d", instance);
+        debug_log_file = log_file;
+    }
     DEBUG_INIT(debug_level, opt_logger);
 
     ret = server_setup("nss", true, 0, CONFDB_FILE,
@@ -634,7 +827,8 @@ int main(int argc, const char *argv[])
 
     ret = sss_nss_process_init(main_ctx,
                                main_ctx->event_ctx,
-                               main_ctx->confdb_ctx);
+                               main_ctx->confdb_ctx,
+                               instance);
     if (ret != EOK) return 3;
 
     /* loop on main */
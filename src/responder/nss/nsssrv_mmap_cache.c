@@ -58,8 +58,9 @@ struct sss_mc_ctx {
     void *mmap_base;        /* base address of mmap */
     size_t mmap_size;       /* total size of mmap */
 
-    uint32_t *hash_table;   /* hash table address (in mmap) */
+    struct sss_mc_ht_bucket *hash_table; /* hash table address (in mmap) */
     uint32_t ht_size;       /* size of hash table */
+    uint32_t ht_deleted;    /* number of deleted hash table entries */
 
     uint8_t *free_table;    /* free list bitmaps */
     uint32_t ft_size;       /* size of free table */
@@ -67,6 +68,12 @@ struct sss_mc_ctx {
 
     uint8_t *data_table;    /* data table address (in mmap) */
     uint32_t dt_size;       /* size of data table */
+
+    size_t max_n_elem;      /* upper bound for online growth (in slots) */
+    uint32_t generation;    /* how many times the file was regrown */
+    size_t used_slots;      /* number of slots marked in free table */
+    uint64_t stores;        /* number of records written */
+    uint64_t evictions;     /* number of live records dropped for space */
 };
 
 #define MC_FIND_BIT(base, num) \
@@ -90,34 +97,6 @@ struct sss_mc_ctx {
     else used = false; \
 } while (0)
 
-static inline
-uint32_t sss_mc_next_slot_with_hash(struct sss_mc_rec *rec,
-                                    uint32_t hash)
-{
-    if (rec->hash1 == hash) {
-        return rec->next1;
-    } else if (rec->hash2 == hash) {
-        return rec->next2;
-    } else {
-        /* it should never happen. */
-        return MC_INVALID_VAL;
-    }
-}
-
-static inline
-void sss_mc_chain_slot_to_record_with_hash(struct sss_mc_rec *rec,
-                                           uint32_t hash,
-                                           uint32_t slot)
-{
-    /* changing a single uint32_t is atomic, so there is no
-     * need to use barriers in this case */
-    if (rec->hash1 == hash) {
-        rec->next1 = slot;
-    } else if (rec->hash2 == hash) {
-        rec->next2 = slot;
-    }
-}
-
 /* This function will store corrupted memcache to disk for later
  * analysis. */
 static void  sss_mc_save_corrupted(struct sss_mc_ctx *mc_ctx)
@@ -192,86 +171,140 @@ done:
 static uint32_t sss_mc_hash(struct sss_mc_ctx *mcc,
                             const char *key, size_t len)
 {
-    return murmurhash3(key, len, mcc->seed) % MC_HT_ELEMS(mcc->ht_size);
+    return sss_mc_key_hash(key, len, mcc->seed);
 }
 
-static void sss_mc_add_rec_to_chain(struct sss_mc_ctx *mcc,
+static void sss_mc_add_rec_to_index(struct sss_mc_ctx *mcc,
                                     struct sss_mc_rec *rec,
                                     uint32_t hash)
 {
-    struct sss_mc_rec *cur;
+    struct sss_mc_ht_bucket *bucket;
+    struct sss_mc_ht_bucket *free_bucket = NULL;
+    uint32_t free_entry = 0;
+    uint32_t n_buckets;
+    uint32_t rec_slot;
+    uint32_t entry;
     uint32_t slot;
+    uint32_t pos;
 
-    if (hash > MC_HT_ELEMS(mcc->ht_size)) {
-        /* Invalid hash. This should never happen, but better
-         * return than trying to access out of bounds memory */
+    if (hash == MC_INVALID_VAL) {
+        /* Invalid hash. This should never happen. */
         return;
     }
 
-    slot = mcc->hash_table[hash];
-    if (slot == MC_INVALID_VAL) {
-        /* no previous record/collision, just add to hash table */
-        mcc->hash_table[hash] = MC_PTR_TO_SLOT(mcc->data_table, rec);
-        return;
-    }
+    n_buckets = MC_HT_BUCKETS(mcc->ht_size);
+    rec_slot = MC_PTR_TO_SLOT(mcc->data_table, rec);
 
-    do {
-        cur = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
-        if (cur == rec) {
-            /* rec already stored in hash chain */
+    for (pos = 0; pos < MC_HT_ELEMS(mcc->ht_size); pos++) {
+        bucket = &mcc->hash_table[MC_HT_POS_BUCKET(hash, pos, n_buckets)];
+        entry = MC_HT_POS_ENTRY(pos);
+        slot = bucket->slot[entry];
+
+        if (slot == rec_slot && bucket->hash[entry] == hash) {
+            /* rec already stored in the index, this happens when
+             * rec->hash1 and rec->hash2 are the same */
             return;
         }
-        slot = sss_mc_next_slot_with_hash(cur, hash);
-    } while (slot != MC_INVALID_VAL);
-    /* end of chain, append our record here */
 
-    slot = MC_PTR_TO_SLOT(mcc->data_table, rec);
-    sss_mc_chain_slot_to_record_with_hash(cur, hash, slot);
+        if (slot == MC_INVALID_VAL || slot == MC_HT_DELETED) {
+            if (free_bucket == NULL) {
+                free_bucket = bucket;
+                free_entry = entry;
+            }
+            if (slot == MC_INVALID_VAL) {
+                /* end of the probe sequence, rec is not indexed yet */
+                break;
+            }
+        }
+    }
+
+    if (free_bucket == NULL) {
+        /* The index has twice as many entries as there can be keys, so
+         * this should never happen */
+        DEBUG(SSSDBG_CRIT_FAILURE, "mmap cache hash table is full\n");
+        return;
+    }
+
+    if (free_bucket->slot[free_entry] == MC_HT_DELETED) {
+        mcc->ht_deleted--;
+    }
+
+    /* clients read the slot first, so it must be written last */
+    free_bucket->hash[free_entry] = hash;
+    __sync_synchronize();
+    free_bucket->slot[free_entry] = rec_slot;
 }
 
-static void sss_mc_rm_rec_from_chain(struct sss_mc_ctx *mcc,
+static void sss_mc_rm_rec_from_index(struct sss_mc_ctx *mcc,
                                      struct sss_mc_rec *rec,
                                      uint32_t hash)
 {
-    struct sss_mc_rec *prev = NULL;
-    struct sss_mc_rec *cur = NULL;
+    struct sss_mc_ht_bucket *bucket;
+    struct sss_mc_ht_bucket *next;
+    uint32_t n_buckets;
+    uint32_t max_pos;
+    uint32_t rec_slot;
+    uint32_t entry;
     uint32_t slot;
+    uint32_t pos;
 
-    if (hash > MC_HT_ELEMS(mcc->ht_size)) {
-        /* It can happen if rec->hash1 and rec->hash2 was the same.
-         * or it is invalid hash. It is better to return
-         * than trying to access out of bounds memory
-         */
+    if (hash == MC_INVALID_VAL) {
+        /* It can happen if rec->hash1 and rec->hash2 was the same and the
+         * record was already removed */
         return;
     }
 
-    slot = mcc->hash_table[hash];
-    if (slot == MC_INVALID_VAL) {
-        /* record has already been removed. It may happen if rec->hash1 and
-         * rec->has2 are the same. (It is not very likely).
-         */
-        return;
-    }
-    cur = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
-    if (cur == rec) {
-        mcc->hash_table[hash] = sss_mc_next_slot_with_hash(rec, hash);
-    } else {
-        slot = sss_mc_next_slot_with_hash(cur, hash);
-        while (slot != MC_INVALID_VAL) {
-            prev = cur;
-            cur = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
-            if (cur == rec) {
-                slot = sss_mc_next_slot_with_hash(cur, hash);
-
-                sss_mc_chain_slot_to_record_with_hash(prev, hash, slot);
-                slot = MC_INVALID_VAL;
-            } else {
-                slot = sss_mc_next_slot_with_hash(cur, hash);
-            }
+    n_buckets = MC_HT_BUCKETS(mcc->ht_size);
+    max_pos = MC_HT_ELEMS(mcc->ht_size);
+    rec_slot = MC_PTR_TO_SLOT(mcc->data_table, rec);
+
+    for (pos = 0; pos < max_pos; pos++) {
+        bucket = &mcc->hash_table[MC_HT_POS_BUCKET(hash, pos, n_buckets)];
+        entry = MC_HT_POS_ENTRY(pos);
+        slot = bucket->slot[entry];
+
+        if (slot == MC_INVALID_VAL) {
+            /* record has already been removed. It may happen if
+             * rec->hash1 and rec->hash2 are the same. */
+            return;
+        }
+
+        if (slot != rec_slot || bucket->hash[entry] != hash) {
+            continue;
+        }
+
+        /* If the probe sequence ends right after this entry nothing can be
+         * found past it and the entry can be marked as unused again,
+         * otherwise leave a tombstone so lookups continue probing. */
+        next = &mcc->hash_table[MC_HT_POS_BUCKET(hash, pos + 1, n_buckets)];
+        if (pos + 1 < max_pos
+                && next->slot[MC_HT_POS_ENTRY(pos + 1)] == MC_INVALID_VAL) {
+            bucket->slot[entry] = MC_INVALID_VAL;
+        } else {
+            bucket->slot[entry] = MC_HT_DELETED;
+            mcc->ht_deleted++;
         }
+        return;
     }
 }
 
+static bool sss_mc_is_rec_indexed(struct sss_mc_ctx *mcc,
+                                  struct sss_mc_rec *rec,
+                                  uint32_t hash)
+{
+    uint32_t rec_slot;
+    uint32_t slot;
+    uint32_t pos = 0;
+
+    rec_slot = MC_PTR_TO_SLOT(mcc->data_table, rec);
+    do {
+        slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size,
+                                   hash, &pos);
+    } while (slot != MC_INVALID_VAL && slot != rec_slot);
+
+    return slot == rec_slot;
+}
+
 static void sss_mc_free_slots(struct sss_mc_ctx *mcc, struct sss_mc_rec *rec)
 {
     uint32_t slot;
@@ -283,6 +316,7 @@ static void sss_mc_free_slots(struct sss_mc_ctx *mcc, struct sss_mc_rec *rec)
     for (i = 0; i < num; i++) {
         MC_CLEAR_BIT(mcc->free_table, slot + i);
     }
+    mcc->used_slots -= MIN(num, mcc->used_slots);
 }
 
 static void sss_mc_invalidate_rec(struct sss_mc_ctx *mcc,
@@ -293,11 +327,9 @@ static void sss_mc_invalidate_rec(struct sss_mc_ctx *mcc,
         return;
     }
 
-    /* Remove from hash chains */
-    /* hash chain 1 */
-    sss_mc_rm_rec_from_chain(mcc, rec, rec->hash1);
-    /* hash chain 2 */
-    sss_mc_rm_rec_from_chain(mcc, rec, rec->hash2);
+    /* Remove from hash table */
+    sss_mc_rm_rec_from_index(mcc, rec, rec->hash1);
+    sss_mc_rm_rec_from_index(mcc, rec, rec->hash2);
 
     /* Clear from free_table */
     sss_mc_free_slots(mcc, rec);
@@ -317,9 +349,6 @@ static void sss_mc_invalidate_rec(struct sss_mc_ctx *mcc,
 
 static bool sss_mc_is_valid_rec(struct sss_mc_ctx *mcc, struct sss_mc_rec *rec)
 {
-    struct sss_mc_rec *self;
-    uint32_t slot;
-
     if (((uint8_t *)rec < mcc->data_table) ||
         ((uint8_t *)rec > (mcc->data_table + mcc->dt_size - MC_SLOT_SIZE))) {
         return false;
@@ -342,27 +371,12 @@ static bool sss_mc_is_valid_rec(struct sss_mc_ctx *mcc, struct sss_mc_rec *rec)
 
     if (rec->hash1 == MC_INVALID_VAL32) {
         return false;
-    } else {
-        self = NULL;
-        slot = mcc->hash_table[rec->hash1];
-        while (slot != MC_INVALID_VAL32 && self != rec) {
-            self = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
-            slot = sss_mc_next_slot_with_hash(self, rec->hash1);
-        }
-        if (self != rec) {
-            return false;
-        }
+    } else if (!sss_mc_is_rec_indexed(mcc, rec, rec->hash1)) {
+        return false;
     }
-    if (rec->hash2 != MC_INVALID_VAL32) {
-        self = NULL;
-        slot = mcc->hash_table[rec->hash2];
-        while (slot != MC_INVALID_VAL32 && self != rec) {
-            self = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
-            slot = sss_mc_next_slot_with_hash(self, rec->hash2);
-        }
-        if (self != rec) {
-            return false;
-        }
+    if (rec->hash2 != MC_INVALID_VAL32
+            && !sss_mc_is_rec_indexed(mcc, rec, rec->hash2)) {
+        return false;
     }
 
     /* all tests passed */
@@ -380,18 +394,22 @@ static const char *mc_type_to_str(enum sss_mc_type type)
         return "INITGROUPS";
     case SSS_MC_SID:
         return "SID";
+    case SSS_MC_NETGROUP:
+        return "NETGROUP";
+    case SSS_MC_SERVICES:
+        return "SERVICES";
     default:
         return "-UNKNOWN-";
     }
 }
 
-/* FIXME: This is a very simplistic, inefficient, memory allocator,
- * it will just free the oldest entries regardless of expiration if it
- * cycled the whole free bits map and found no empty slot */
+/* FIXME: This is a very simplistic, inefficient, memory allocator.
+ * Returns ENOSPC if it cycled the whole free bits map and found no empty
+ * slot, the caller then either grows the cache or evicts the oldest entries
+ * with sss_mc_evict_slots() */
 static errno_t sss_mc_find_free_slots(struct sss_mc_ctx *mcc,
                                       int num_slots, uint32_t *free_slot)
 {
-    struct sss_mc_rec *rec;
     uint32_t tot_slots;
     uint32_t cur;
     uint32_t i;
@@ -449,7 +467,21 @@ static errno_t sss_mc_find_free_slots(struct sss_mc_ctx *mcc,
         }
     }
 
-    /* no free slots found, free occupied slots after next_slot */
+    return ENOSPC;
+}
+
+/* Frees occupied slots after next_slot regardless of expiration */
+static errno_t sss_mc_evict_slots(struct sss_mc_ctx *mcc,
+                                  int num_slots, uint32_t *free_slot)
+{
+    struct sss_mc_rec *rec;
+    uint32_t tot_slots;
+    uint32_t cur;
+    uint32_t i;
+    bool used;
+
+    tot_slots = mcc->ft_size * 8;
+
     if ((mcc->next_slot + num_slots) > tot_slots) {
         cur = 0;
     } else {
@@ -477,6 +509,10 @@ static errno_t sss_mc_find_free_slots(struct sss_mc_ctx *mcc,
             /* next loop skip the whole record */
             i += MC_SIZE_TO_SLOTS(rec->len) - 1;
 
+            if (rec->expire > time(NULL)) {
+                mcc->evictions++;
+            }
+
             /* finally invalidate record completely */
             sss_mc_invalidate_rec(mcc, rec);
         }
@@ -503,6 +539,10 @@ static errno_t sss_mc_get_strs_offset(struct sss_mc_ctx *mcc,
     case SSS_MC_SID:
         *_offset = offsetof(struct sss_mc_sid_data, sid);
         return EOK;
+    case SSS_MC_NETGROUP:
+    case SSS_MC_SERVICES:
+        *_offset = offsetof(struct sss_mc_rep_data, strs);
+        return EOK;
     default:
         DEBUG(SSSDBG_FATAL_FAILURE, "Unknown memory cache type.\n");
         return EINVAL;
@@ -526,6 +566,10 @@ static errno_t sss_mc_get_strs_len(struct sss_mc_ctx *mcc,
     case SSS_MC_SID:
         *_len = ((struct sss_mc_sid_data *)&rec->data)->sid_len;
         return EOK;
+    case SSS_MC_NETGROUP:
+    case SSS_MC_SERVICES:
+        *_len = ((struct sss_mc_rep_data *)&rec->data)->strs_len;
+        return EOK;
     default:
         DEBUG(SSSDBG_FATAL_FAILURE, "Unknown memory cache type.\n");
         return EINVAL;
@@ -538,6 +582,7 @@ static struct sss_mc_rec *sss_mc_find_record(struct sss_mc_ctx *mcc,
     struct sss_mc_rec *rec = NULL;
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos = 0;
     rel_ptr_t name_ptr;
     char *t_key;
     size_t strs_offset;
@@ -547,7 +592,7 @@ static struct sss_mc_rec *sss_mc_find_record(struct sss_mc_ctx *mcc,
 
     hash = sss_mc_hash(mcc, key->str, key->len);
 
-    slot = mcc->hash_table[hash];
+    slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size, hash, &pos);
     if (!MC_SLOT_WITHIN_BOUNDS(slot, mcc->dt_size)) {
         return NULL;
     }
@@ -577,7 +622,8 @@ static struct sss_mc_rec *sss_mc_find_record(struct sss_mc_ctx *mcc,
 
         if (key->len > strs_len) {
             /* The string cannot be in current record */
-            slot = sss_mc_next_slot_with_hash(rec, hash);
+            slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size,
+                                       hash, &pos);
             continue;
         }
 
@@ -605,12 +651,52 @@ static struct sss_mc_rec *sss_mc_find_record(struct sss_mc_ctx *mcc,
             return rec;
         }
 
-        slot = sss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size, hash, &pos);
     }
 
     return NULL;
 }
 
+/* Deleted entries make probe sequences longer, once there are too many of
+ * them rebuild the index from the records in the data table. Concurrent
+ * client lookups may miss meanwhile and fall back to the socket. */
+static void sss_mc_rebuild_index(struct sss_mc_ctx *mcc)
+{
+    struct sss_mc_rec *rec;
+    uint32_t tot_slots;
+    uint32_t slot;
+    bool used;
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Rebuilding hash table of '%s' mmap cache (%"PRIu32" deleted "
+          "entries)\n", mc_type_to_str(mcc->type), mcc->ht_deleted);
+
+    memset(mcc->hash_table, 0xff, mcc->ht_size);
+    mcc->ht_deleted = 0;
+
+    tot_slots = mcc->ft_size * 8;
+    for (slot = 0; slot < tot_slots; slot++) {
+        MC_PROBE_BIT(mcc->free_table, slot, used);
+        if (!used) {
+            continue;
+        }
+
+        rec = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
+        if (rec->b1 == MC_INVALID_VAL || rec->b1 != rec->b2
+                || !MC_CHECK_RECORD_LENGTH(mcc, rec)) {
+            continue;
+        }
+
+        sss_mc_add_rec_to_index(mcc, rec, rec->hash1);
+        sss_mc_add_rec_to_index(mcc, rec, rec->hash2);
+
+        /* skip the rest of the record */
+        slot += MC_SIZE_TO_SLOTS(rec->len) - 1;
+    }
+}
+
+static errno_t sss_mc_grow(struct sss_mc_ctx **_mcc);
+
 static errno_t sss_mc_get_record(struct sss_mc_ctx **_mcc,
                                  size_t rec_len,
                                  const struct sized_string *key,
@@ -627,7 +713,13 @@ static errno_t sss_mc_get_record(struct sss_mc_ctx **_mcc,
 
     num_slots = MC_SIZE_TO_SLOTS(rec_len);
 
-    old_rec = sss_mc_find_record(mcc, key);
+    if (mcc->ht_deleted > MC_HT_ELEMS(mcc->ht_size) / 4) {
+        sss_mc_rebuild_index(mcc);
+    }
+
+    if (key != NULL) {
+        old_rec = sss_mc_find_record(mcc, key);
+    }
     if (old_rec) {
         old_slots = MC_SIZE_TO_SLOTS(old_rec->len);
 
@@ -643,6 +735,17 @@ static errno_t sss_mc_get_record(struct sss_mc_ctx **_mcc,
 
     /* we are going to use more space, find enough free slots */
     ret = sss_mc_find_free_slots(mcc, num_slots, &base_slot);
+    if (ret == ENOSPC) {
+        /* prefer growing the cache over dropping live records */
+        ret = sss_mc_grow(_mcc);
+        if (ret == EOK) {
+            mcc = *_mcc;
+            ret = sss_mc_find_free_slots(mcc, num_slots, &base_slot);
+        }
+        if (ret != EOK) {
+            ret = sss_mc_evict_slots(mcc, num_slots, &base_slot);
+        }
+    }
     if (ret != EOK) {
         if (ret == EFAULT) {
             DEBUG(SSSDBG_CRIT_FAILURE,
@@ -659,13 +762,14 @@ static errno_t sss_mc_get_record(struct sss_mc_ctx **_mcc,
     rec->len = rec_len;
     rec->next1 = MC_INVALID_VAL;
     rec->next2 = MC_INVALID_VAL;
-    rec->padding = MC_INVALID_VAL;
+    rec->flags = 0;
     MC_LOWER_BARRIER(rec);
 
     /* and now mark slots as used */
     for (i = 0; i < num_slots; i++) {
         MC_SET_BIT(mcc->free_table, base_slot + i);
     }
+    mcc->used_slots += num_slots;
 
     *_rec = rec;
     return EOK;
@@ -678,18 +782,20 @@ static inline void sss_mmap_set_rec_header(struct sss_mc_ctx *mcc,
                                            const char *key2, size_t key2_len)
 {
     rec->len = len;
+    rec->flags = 0;
     rec->expire = time(NULL) + ttl;
     rec->hash1 = sss_mc_hash(mcc, key1, key1_len);
     rec->hash2 = sss_mc_hash(mcc, key2, key2_len);
+    mcc->stores++;
 }
 
 static inline void sss_mmap_chain_in_rec(struct sss_mc_ctx *mcc,
                                          struct sss_mc_rec *rec)
 {
     /* name first */
-    sss_mc_add_rec_to_chain(mcc, rec, rec->hash1);
+    sss_mc_add_rec_to_index(mcc, rec, rec->hash1);
     /* then uid/gid */
-    sss_mc_add_rec_to_chain(mcc, rec, rec->hash2);
+    sss_mc_add_rec_to_index(mcc, rec, rec->hash2);
 }
 
 /***************************************************************************
@@ -778,6 +884,50 @@ done:
  * passwd map
  ***************************************************************************/
 
+/* Invalidates the first passwd record of the uid, either a negative one or
+ * a regular one */
+static errno_t sss_mc_invalidate_pw_uid(struct sss_mc_ctx *mcc, uid_t uid,
+                                        bool negative)
+{
+    struct sss_mc_rec *rec;
+    struct sss_mc_pwd_data *data;
+    char uidstr[11];
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t pos = 0;
+    int len;
+
+    len = snprintf(uidstr, 11, "%ld", (long)uid);
+    if (len > 10) {
+        return EINVAL;
+    }
+
+    hash = sss_mc_hash(mcc, uidstr, len + 1);
+
+    slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size, hash, &pos);
+    while (slot != MC_INVALID_VAL) {
+        if (!MC_SLOT_WITHIN_BOUNDS(slot, mcc->dt_size)) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Corrupted memcache.\n");
+            sss_mc_save_corrupted(mcc);
+            sss_mmap_cache_reset(mcc);
+            return ENOENT;
+        }
+
+        rec = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
+        data = (struct sss_mc_pwd_data *)(&rec->data);
+
+        if (rec->hash2 == hash && uid == data->uid
+                && ((rec->flags & MC_REC_NEGATIVE) != 0) == negative) {
+            sss_mc_invalidate_rec(mcc, rec);
+            return EOK;
+        }
+
+        slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size, hash, &pos);
+    }
+
+    return ENOENT;
+}
+
 errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
                                 const struct sized_string *name,
                                 const struct sized_string *pw,
@@ -809,6 +959,10 @@ errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
     }
     to_sized_string(&uidkey, uidstr);
 
+    /* a negative record of the name is replaced below, the one of the uid
+     * would hide the new record from lookups by uid */
+    sss_mc_invalidate_pw_uid(mcc, uid, true);
+
     data_len = name->len + pw->len + gecos->len + homedir->len + shell->len;
     rec_len = sizeof(struct sss_mc_rec) +
               sizeof(struct sss_mc_pwd_data) +
@@ -822,6 +976,9 @@ errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
         return ret;
     }
 
+    /* the cache may have been regrown while looking for space */
+    mcc = *_mcc;
+
     data = (struct sss_mc_pwd_data *)rec->data;
     pos = 0;
 
@@ -861,14 +1018,28 @@ errno_t sss_mmap_cache_pw_invalidate(struct sss_mc_ctx **_mcc,
 }
 
 errno_t sss_mmap_cache_pw_invalidate_uid(struct sss_mc_ctx **_mcc, uid_t uid)
+{
+    errno_t ret;
+
+    ret = sss_mmap_cache_validate_or_reinit(_mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return sss_mc_invalidate_pw_uid(*_mcc, uid, false);
+}
+
+errno_t sss_mmap_cache_pw_store_negative(struct sss_mc_ctx **_mcc,
+                                         const struct sized_string *name,
+                                         uid_t uid, time_t ttl)
 {
     struct sss_mc_ctx *mcc;
-    struct sss_mc_rec *rec = NULL;
+    struct sss_mc_rec *rec;
     struct sss_mc_pwd_data *data;
-    uint32_t hash;
-    uint32_t slot;
-    char *uidstr;
-    errno_t ret;
+    struct sized_string key;
+    char uidstr[11];
+    size_t rec_len;
+    int ret;
 
     ret = sss_mmap_cache_validate_or_reinit(_mcc);
     if (ret != EOK) {
@@ -877,50 +1048,98 @@ errno_t sss_mmap_cache_pw_invalidate_uid(struct sss_mc_ctx **_mcc, uid_t uid)
 
     mcc = *_mcc;
 
-    uidstr = talloc_asprintf(NULL, "%ld", (long)uid);
-    if (!uidstr) {
-        return ENOMEM;
+    if (name != NULL) {
+        key = *name;
+    } else {
+        ret = snprintf(uidstr, 11, "%ld", (long)uid);
+        if (ret > 10) {
+            return EINVAL;
+        }
+        to_sized_string(&key, uidstr);
+
+        /* uid records have no name to find them by in sss_mc_get_record() */
+        sss_mc_invalidate_pw_uid(mcc, uid, true);
     }
 
-    hash = sss_mc_hash(mcc, uidstr, strlen(uidstr) + 1);
+    rec_len = sizeof(struct sss_mc_rec) +
+              sizeof(struct sss_mc_pwd_data) +
+              (name != NULL ? name->len : 1);
+    if (rec_len > mcc->dt_size) {
+        return ENOMEM;
+    }
 
-    slot = mcc->hash_table[hash];
-    if (!MC_SLOT_WITHIN_BOUNDS(slot, mcc->dt_size)) {
-        ret = ENOENT;
-        goto done;
+    ret = sss_mc_get_record(_mcc, rec_len, name, &rec);
+    if (ret != EOK) {
+        return ret;
     }
 
-    while (slot != MC_INVALID_VAL) {
-        if (!MC_SLOT_WITHIN_BOUNDS(slot, mcc->dt_size)) {
-            DEBUG(SSSDBG_FATAL_FAILURE, "Corrupted memcache.\n");
-            sss_mc_save_corrupted(mcc);
-            sss_mmap_cache_reset(mcc);
-            ret = ENOENT;
-            goto done;
-        }
+    /* the cache may have been regrown while looking for space */
+    mcc = *_mcc;
 
-        rec = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
-        data = (struct sss_mc_pwd_data *)(&rec->data);
+    data = (struct sss_mc_pwd_data *)rec->data;
 
-        if (uid == data->uid) {
-            break;
-        }
+    MC_RAISE_BARRIER(rec);
+
+    sss_mmap_set_rec_header(mcc, rec, rec_len, ttl,
+                            key.str, key.len, key.str, key.len);
+    rec->flags = MC_REC_NEGATIVE;
 
-        slot = sss_mc_next_slot_with_hash(rec, hash);
+    data->name = MC_PTR_DIFF(data->strs, data);
+    data->uid = (name != NULL) ? MC_INVALID_VAL32 : uid;
+    data->gid = MC_INVALID_VAL32;
+    if (name != NULL) {
+        data->strs_len = name->len;
+        memcpy(data->strs, name->str, name->len);
+    } else {
+        data->strs_len = 1;
+        data->strs[0] = '\0';
     }
 
-    if (slot == MC_INVALID_VAL) {
-        ret = ENOENT;
-        goto done;
+    MC_LOWER_BARRIER(rec);
+
+    sss_mmap_chain_in_rec(mcc, rec);
+
+    return EOK;
+}
+
+errno_t sss_mmap_cache_pw_invalidate_negative(struct sss_mc_ctx **_mcc)
+{
+    struct sss_mc_ctx *mcc;
+    struct sss_mc_rec *rec;
+    uint32_t tot_slots;
+    uint32_t slot;
+    bool used;
+    errno_t ret;
+
+    ret = sss_mmap_cache_validate_or_reinit(_mcc);
+    if (ret != EOK) {
+        return ret;
     }
 
-    sss_mc_invalidate_rec(mcc, rec);
+    mcc = *_mcc;
 
-    ret = EOK;
+    tot_slots = mcc->ft_size * 8;
+    for (slot = 0; slot < tot_slots; slot++) {
+        MC_PROBE_BIT(mcc->free_table, slot, used);
+        if (!used) {
+            continue;
+        }
 
-done:
-    talloc_zfree(uidstr);
-    return ret;
+        rec = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
+        if (rec->b1 == MC_INVALID_VAL || rec->b1 != rec->b2
+                || !MC_CHECK_RECORD_LENGTH(mcc, rec)) {
+            continue;
+        }
+
+        /* skip the rest of the record */
+        slot += MC_SIZE_TO_SLOTS(rec->len) - 1;
+
+        if (rec->flags & MC_REC_NEGATIVE) {
+            sss_mc_invalidate_rec(mcc, rec);
+        }
+    }
+
+    return EOK;
 }
 
 /***************************************************************************
@@ -969,6 +1188,9 @@ int sss_mmap_cache_gr_store(struct sss_mc_ctx **_mcc,
         return ret;
     }
 
+    /* the cache may have been regrown while looking for space */
+    mcc = *_mcc;
+
     data = (struct sss_mc_grp_data *)rec->data;
     pos = 0;
 
@@ -1010,6 +1232,7 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx **_mcc, gid_t gid)
     struct sss_mc_grp_data *data;
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos = 0;
     char *gidstr;
     errno_t ret;
 
@@ -1027,7 +1250,7 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx **_mcc, gid_t gid)
 
     hash = sss_mc_hash(mcc, gidstr, strlen(gidstr) + 1);
 
-    slot = mcc->hash_table[hash];
+    slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size, hash, &pos);
     if (!MC_SLOT_WITHIN_BOUNDS(slot, mcc->dt_size)) {
         ret = ENOENT;
         goto done;
@@ -1045,11 +1268,11 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx **_mcc, gid_t gid)
         rec = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
         data = (struct sss_mc_grp_data *)(&rec->data);
 
-        if (gid == data->gid) {
+        if (rec->hash2 == hash && gid == data->gid) {
             break;
         }
 
-        slot = sss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_mc_ht_next_slot(mcc->hash_table, mcc->ht_size, hash, &pos);
     }
 
     if (slot == MC_INVALID_VAL) {
@@ -1101,6 +1324,9 @@ errno_t sss_mmap_cache_initgr_store(struct sss_mc_ctx **_mcc,
         return ret;
     }
 
+    /* the cache may have been regrown while looking for space */
+    mcc = *_mcc;
+
     data = (struct sss_mc_initgr_data *)rec->data;
     pos = 0;
 
@@ -1174,6 +1400,9 @@ errno_t sss_mmap_cache_sid_store(struct sss_mc_ctx **_mcc,
         return ret;
     }
 
+    /* the cache may have been regrown while looking for space */
+    mcc = *_mcc;
+
     data = (struct sss_mc_sid_data *)rec->data;
     MC_RAISE_BARRIER(rec);
 
@@ -1193,24 +1422,88 @@ errno_t sss_mmap_cache_sid_store(struct sss_mc_ctx **_mcc,
     return EOK;
 }
 
-/***************************************************************************
- * initialization
- ***************************************************************************/
-
-/* Copy of sss_mc_set_recycled is present in the src/tools/tools_mc_util.c.
- * If you modify this function, you should modify the duplicated function
- * too. */
-static errno_t sss_mc_set_recycled(int fd)
+static errno_t sss_mmap_cache_rep_store(struct sss_mc_ctx **_mcc,
+                                        const struct sized_string *key,
+                                        const uint8_t *rep, size_t rep_len)
 {
-    uint32_t w = SSS_MC_HEADER_RECYCLED;
-    off_t offset;
-    off_t pos;
-    ssize_t written;
+    struct sss_mc_ctx *mcc;
+    struct sss_mc_rec *rec;
+    struct sss_mc_rep_data *data;
+    size_t rec_len;
+    int ret;
 
-    offset = offsetof(struct sss_mc_header, status);
+    ret = sss_mmap_cache_validate_or_reinit(_mcc);
+    if (ret != EOK) {
+        return ret;
+    }
 
-    pos = lseek(fd, offset, SEEK_SET);
-    if (pos == -1) {
+    mcc = *_mcc;
+
+    rec_len = sizeof(struct sss_mc_rec) + sizeof(struct sss_mc_rep_data)
+              + key->len + rep_len;
+    if (rec_len > mcc->dt_size) {
+        return ENOMEM;
+    }
+
+    ret = sss_mc_get_record(_mcc, rec_len, key, &rec);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* the cache may have been regrown while looking for space */
+    mcc = *_mcc;
+
+    data = (struct sss_mc_rep_data *)rec->data;
+    MC_RAISE_BARRIER(rec);
+
+    /* the key is the only one of the record, index it once */
+    sss_mmap_set_rec_header(mcc, rec, rec_len, mcc->valid_time_slot,
+                            key->str, key->len, key->str, key->len);
+
+    data->name = MC_PTR_DIFF(data->strs, data);
+    data->strs_len = key->len + rep_len;
+    data->rep_len = rep_len;
+    memcpy(data->strs, key->str, key->len);
+    memcpy(data->strs + key->len, rep, rep_len);
+
+    MC_LOWER_BARRIER(rec);
+    sss_mmap_chain_in_rec(mcc, rec);
+
+    return EOK;
+}
+
+errno_t sss_mmap_cache_netgr_store(struct sss_mc_ctx **_mcc,
+                                   const struct sized_string *name,
+                                   const uint8_t *rep, size_t rep_len)
+{
+    return sss_mmap_cache_rep_store(_mcc, name, rep, rep_len);
+}
+
+errno_t sss_mmap_cache_svc_store(struct sss_mc_ctx **_mcc,
+                                 const struct sized_string *key,
+                                 const uint8_t *rep, size_t rep_len)
+{
+    return sss_mmap_cache_rep_store(_mcc, key, rep, rep_len);
+}
+
+/***************************************************************************
+ * initialization
+ ***************************************************************************/
+
+/* Copy of sss_mc_set_recycled is present in the src/tools/tools_mc_util.c.
+ * If you modify this function, you should modify the duplicated function
+ * too. */
+static errno_t sss_mc_set_recycled(int fd)
+{
+    uint32_t w = SSS_MC_HEADER_RECYCLED;
+    off_t offset;
+    off_t pos;
+    ssize_t written;
+
+    offset = offsetof(struct sss_mc_header, status);
+
+    pos = lseek(fd, offset, SEEK_SET);
+    if (pos == -1) {
         /* What do we do now? */
         return errno;
     }
@@ -1329,7 +1622,7 @@ static void sss_mc_header_update(struct sss_mc_ctx *mc_ctx, int status)
         h->major_vno = SSS_MC_MAJOR_VNO;
         h->minor_vno = SSS_MC_MINOR_VNO;
         h->seed = mc_ctx->seed;
-        h->reserved = 0;
+        h->generation = mc_ctx->generation;
     }
     h->status = status;
     MC_LOWER_BARRIER(h);
@@ -1367,9 +1660,12 @@ static int mc_ctx_destructor(struct sss_mc_ctx *mc_ctx)
 
 #define POSIX_FALLOCATE_ATTEMPTS 3
 
-errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
-                            enum sss_mc_type type, size_t n_elem,
-                            time_t timeout, struct sss_mc_ctx **mcc)
+/* Creates, sizes and maps a new cache file at 'file'. The file must not
+ * exist yet. */
+static errno_t sss_mc_init_ctx(TALLOC_CTX *mem_ctx, const char *name,
+                               char *file, enum sss_mc_type type,
+                               size_t n_elem, size_t max_n_elem,
+                               time_t timeout, struct sss_mc_ctx **mcc)
 {
     /* sss_mc_rec alone occupies whole slot,
      * so each entry takes 2 slots at the very least
@@ -1377,33 +1673,12 @@ errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
     static const int PAYLOAD_FACTOR = 2;
 
     struct sss_mc_ctx *mc_ctx = NULL;
+    size_t ht_offset;
     int ret, dret;
-    char *filename;
-
-    filename = talloc_asprintf(mem_ctx, "%s/%s", SSS_NSS_MCACHE_DIR, name);
-    if (!filename) {
-        return ENOMEM;
-    }
-    /*
-     * First of all mark the current file as recycled
-     * and unlink so active clients will abandon its use ASAP
-     */
-    sss_mc_destroy_file(filename);
-
-    if ((timeout == 0) || (n_elem == 0)) {
-        DEBUG(SSSDBG_IMPORTANT_INFO,
-              "Fast '%s' mmap cache is explicitly DISABLED\n",
-              mc_type_to_str(type));
-        *mcc = NULL;
-        return EOK;
-    }
-    DEBUG(SSSDBG_CONF_SETTINGS,
-          "Fast '%s' mmap cache: memcache_timeout = %"SPRItime", slots = %zu\n",
-          mc_type_to_str(type), timeout, n_elem);
 
     mc_ctx = talloc_zero(mem_ctx, struct sss_mc_ctx);
     if (!mc_ctx) {
-        talloc_free(filename);
+        talloc_free(file);
         return ENOMEM;
     }
     mc_ctx->fd = -1;
@@ -1419,22 +1694,25 @@ errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
 
     mc_ctx->valid_time_slot = timeout;
 
-    mc_ctx->file = talloc_steal(mc_ctx, filename);
+    mc_ctx->file = talloc_steal(mc_ctx, file);
 
     /* elements must always be multiple of 8 to make things easier to handle,
      * so we increase by the necessary amount if they are not a multiple */
     /* We can use MC_ALIGN64 for this */
     n_elem = MC_ALIGN64(n_elem);
+    mc_ctx->max_n_elem = MAX(n_elem, MC_ALIGN64(max_n_elem));
 
-    /* hash table is double the size because it will store both forward and
-     * reverse keys (name/uid, name/gid, ..) */
-    mc_ctx->ht_size = MC_HT_SIZE(2 * n_elem / PAYLOAD_FACTOR);
+    /* hash table stores both forward and reverse keys (name/uid,
+     * name/gid, ..) and is kept at most half full so that open addressing
+     * probe sequences stay short */
+    mc_ctx->ht_size = MC_HT_SIZE(2 * (2 * n_elem / PAYLOAD_FACTOR));
     mc_ctx->dt_size = n_elem * MC_SLOT_SIZE;
     mc_ctx->ft_size = n_elem / 8; /* 1 bit per slot */
-    mc_ctx->mmap_size = MC_HEADER_SIZE +
-                        MC_ALIGN64(mc_ctx->dt_size) +
-                        MC_ALIGN64(mc_ctx->ft_size) +
-                        MC_ALIGN64(mc_ctx->ht_size);
+    /* hash table buckets must not straddle cache lines */
+    ht_offset = MC_ALIGN_CACHELINE(MC_HEADER_SIZE +
+                                   MC_ALIGN64(mc_ctx->dt_size) +
+                                   MC_ALIGN64(mc_ctx->ft_size));
+    mc_ctx->mmap_size = ht_offset + mc_ctx->ht_size;
 
 
     ret = sss_mc_create_file(mc_ctx);
@@ -1468,8 +1746,7 @@ errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
     mc_ctx->data_table = MC_PTR_ADD(mc_ctx->mmap_base, MC_HEADER_SIZE);
     mc_ctx->free_table = MC_PTR_ADD(mc_ctx->data_table,
                                     MC_ALIGN64(mc_ctx->dt_size));
-    mc_ctx->hash_table = MC_PTR_ADD(mc_ctx->free_table,
-                                    MC_ALIGN64(mc_ctx->ft_size));
+    mc_ctx->hash_table = MC_PTR_ADD(mc_ctx->mmap_base, ht_offset);
 
     memset(mc_ctx->data_table, 0xff, mc_ctx->dt_size);
     memset(mc_ctx->free_table, 0x00, mc_ctx->ft_size);
@@ -1482,8 +1759,6 @@ errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
         goto done;
     }
 
-    sss_mc_header_update(mc_ctx, SSS_MC_HEADER_ALIVE);
-
     ret = EOK;
 
 done:
@@ -1507,6 +1782,501 @@ done:
     return ret;
 }
 
+static errno_t sss_mc_warm_start(TALLOC_CTX *mem_ctx, const char *name,
+                                 const char *filename, enum sss_mc_type type,
+                                 size_t n_elem, size_t max_n_elem,
+                                 time_t timeout, struct sss_mc_ctx **_mcc);
+
+errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
+                            enum sss_mc_type type, size_t n_elem,
+                            size_t max_n_elem, bool warm_start,
+                            time_t timeout, struct sss_mc_ctx **mcc)
+{
+    struct sss_mc_ctx *mc_ctx = NULL;
+    char *filename;
+    int ret;
+
+    filename = talloc_asprintf(mem_ctx, "%s/%s", SSS_NSS_MCACHE_DIR, name);
+    if (!filename) {
+        return ENOMEM;
+    }
+
+    if (warm_start && timeout != 0 && n_elem != 0) {
+        ret = sss_mc_warm_start(mem_ctx, name, filename, type,
+                                MC_ALIGN64(n_elem),
+                                MAX(MC_ALIGN64(n_elem),
+                                    MC_ALIGN64(max_n_elem)),
+                                timeout, &mc_ctx);
+        if (ret == EOK) {
+            talloc_free(filename);
+            *mcc = mc_ctx;
+            return EOK;
+        }
+        DEBUG(ret == ENOENT ? SSSDBG_TRACE_FUNC : SSSDBG_MINOR_FAILURE,
+              "Fast '%s' mmap cache cannot be reused [%d]: %s, "
+              "starting with an empty cache\n",
+              mc_type_to_str(type), ret, sss_strerror(ret));
+    }
+
+    /*
+     * First of all mark the current file as recycled
+     * and unlink so active clients will abandon its use ASAP
+     */
+    sss_mc_destroy_file(filename);
+
+    if ((timeout == 0) || (n_elem == 0)) {
+        DEBUG(SSSDBG_IMPORTANT_INFO,
+              "Fast '%s' mmap cache is explicitly DISABLED\n",
+              mc_type_to_str(type));
+        *mcc = NULL;
+        return EOK;
+    }
+    DEBUG(SSSDBG_CONF_SETTINGS,
+          "Fast '%s' mmap cache: memcache_timeout = %"SPRItime", slots = %zu, "
+          "max slots = %zu\n",
+          mc_type_to_str(type), timeout, n_elem, MAX(n_elem, max_n_elem));
+
+    ret = sss_mc_init_ctx(mem_ctx, name, filename, type, n_elem, max_n_elem,
+                          timeout, &mc_ctx);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sss_mc_header_update(mc_ctx, SSS_MC_HEADER_ALIVE);
+
+    *mcc = mc_ctx;
+    return EOK;
+}
+
+/* Checks that key is a NUL terminated string inside the record */
+static bool sss_mc_rec_has_str(struct sss_mc_rec *rec, const char *key)
+{
+    const char *end = (const char *)rec + rec->len;
+
+    if (key < (const char *)rec->data || key >= end) {
+        return false;
+    }
+
+    return memchr(key, '\0', end - key) != NULL;
+}
+
+/* Recompute the hash table positions of a record from its keys, this is
+ * needed when records are moved to a cache with a different hash table */
+static errno_t sss_mc_rehash_rec(struct sss_mc_ctx *mcc,
+                                 struct sss_mc_rec *rec)
+{
+    struct sss_mc_pwd_data *pwd_data;
+    struct sss_mc_grp_data *grp_data;
+    struct sss_mc_initgr_data *initgr_data;
+    struct sss_mc_sid_data *sid_data;
+    struct sss_mc_rep_data *rep_data;
+    const char *key1;
+    char key2[16];
+    const char *ptr2 = key2;
+    int ret;
+
+    switch (mcc->type) {
+    case SSS_MC_PASSWD:
+        pwd_data = (struct sss_mc_pwd_data *)rec->data;
+        key1 = pwd_data->strs;
+        ret = snprintf(key2, sizeof(key2), "%ld", (long)pwd_data->uid);
+        break;
+    case SSS_MC_GROUP:
+        grp_data = (struct sss_mc_grp_data *)rec->data;
+        key1 = grp_data->strs;
+        ret = snprintf(key2, sizeof(key2), "%ld", (long)grp_data->gid);
+        break;
+    case SSS_MC_INITGROUPS:
+        initgr_data = (struct sss_mc_initgr_data *)rec->data;
+        key1 = (const char *)initgr_data + initgr_data->name;
+        ptr2 = (const char *)initgr_data + initgr_data->unique_name;
+        ret = 0;
+        break;
+    case SSS_MC_SID:
+        sid_data = (struct sss_mc_sid_data *)rec->data;
+        key1 = sid_data->sid;
+        ret = snprintf(key2, sizeof(key2), "%d-%ld",
+                       (sid_data->type == SSS_ID_TYPE_GID) ? SSS_ID_TYPE_GID
+                                                           : SSS_ID_TYPE_UID,
+                       (long)sid_data->id);
+        break;
+    case SSS_MC_NETGROUP:
+    case SSS_MC_SERVICES:
+        rep_data = (struct sss_mc_rep_data *)rec->data;
+        key1 = rep_data->strs;
+        ptr2 = key1;
+        ret = 0;
+        break;
+    default:
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unknown memory cache type.\n");
+        return EINVAL;
+    }
+    if (ret < 0 || ret >= sizeof(key2)) {
+        return EINVAL;
+    }
+
+    if (!sss_mc_rec_has_str(rec, key1)
+            || (ptr2 != key2 && !sss_mc_rec_has_str(rec, ptr2))) {
+        return EINVAL;
+    }
+
+    rec->hash1 = sss_mc_hash(mcc, key1, strlen(key1) + 1);
+    rec->hash2 = sss_mc_hash(mcc, ptr2, strlen(ptr2) + 1);
+    rec->next1 = MC_INVALID_VAL;
+    rec->next2 = MC_INVALID_VAL;
+
+    return EOK;
+}
+
+/* Copy all valid and unexpired records from src to the same slots of dst.
+ * dst must not be visible to clients yet, so no barriers are needed.
+ * Returns the number of used slots of src not holding a consistent record. */
+static uint32_t sss_mc_copy_records(struct sss_mc_ctx *dst,
+                                    struct sss_mc_ctx *src)
+{
+    struct sss_mc_rec *rec;
+    struct sss_mc_rec *new_rec;
+    uint32_t dst_slots;
+    uint32_t tot_slots;
+    uint32_t slot;
+    uint32_t num;
+    uint32_t bad = 0;
+    uint32_t i;
+    time_t now;
+    bool used;
+    errno_t ret;
+
+    now = time(NULL);
+    tot_slots = src->ft_size * 8;
+    dst_slots = dst->ft_size * 8;
+
+    for (slot = 0; slot < tot_slots; slot++) {
+        MC_PROBE_BIT(src->free_table, slot, used);
+        if (!used) {
+            continue;
+        }
+
+        rec = MC_SLOT_TO_PTR(src->data_table, slot, struct sss_mc_rec);
+        if (!sss_mc_is_valid_rec(src, rec)) {
+            bad++;
+            continue;
+        }
+
+        num = MC_SIZE_TO_SLOTS(rec->len);
+        if (rec->expire > now && slot + num <= dst_slots) {
+            new_rec = MC_SLOT_TO_PTR(dst->data_table, slot, struct sss_mc_rec);
+            memcpy(new_rec, rec, num * MC_SLOT_SIZE);
+
+            ret = sss_mc_rehash_rec(dst, new_rec);
+            if (ret != EOK) {
+                memset(new_rec, 0xff, num * MC_SLOT_SIZE);
+                bad++;
+            } else {
+                /* records must not outlive the timeout of the new cache */
+                new_rec->expire = MIN(new_rec->expire,
+                                      (uint64_t)(now + dst->valid_time_slot));
+                for (i = 0; i < num; i++) {
+                    MC_SET_BIT(dst->free_table, slot + i);
+                }
+                dst->used_slots += num;
+                sss_mmap_chain_in_rec(dst, new_rec);
+            }
+        }
+
+        /* skip the rest of the record */
+        slot += num - 1;
+    }
+
+    return bad;
+}
+
+/* Replace the cache file with one twice as big (up to max_n_elem) holding
+ * the same records. The new file is fully populated before it is renamed
+ * over the old one, and only then the old file is marked as recycled, so
+ * clients re-map to a warm cache. */
+static errno_t sss_mc_grow(struct sss_mc_ctx **_mcc)
+{
+    struct sss_mc_ctx *mcc = *_mcc;
+    struct sss_mc_ctx *new_mcc = NULL;
+    size_t n_elem;
+    char *file;
+    int ret;
+
+    n_elem = MIN(mcc->ft_size * 8 * 2, mcc->max_n_elem);
+    if (n_elem <= mcc->ft_size * 8) {
+        return ENOSPC;
+    }
+
+    file = talloc_asprintf(NULL, "%s.new", mcc->file);
+    if (file == NULL) {
+        return ENOMEM;
+    }
+
+    /* remove leftovers of a previous interrupted attempt */
+    if (unlink(file) == -1 && errno != ENOENT) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to remove stale file %s: %d(%s)\n",
+                                    file, ret, strerror(ret));
+        talloc_free(file);
+        return ret;
+    }
+
+    ret = sss_mc_init_ctx(talloc_parent(mcc), mcc->name, file, mcc->type,
+                          n_elem, mcc->max_n_elem, mcc->valid_time_slot,
+                          &new_mcc);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to create larger '%s' mmap cache [%d]: %s\n",
+              mc_type_to_str(mcc->type), ret, sss_strerror(ret));
+        /* do not retry on every store, fall back to eviction */
+        mcc->max_n_elem = mcc->ft_size * 8;
+        return ret;
+    }
+
+    new_mcc->generation = mcc->generation + 1;
+    new_mcc->stores = mcc->stores;
+    new_mcc->evictions = mcc->evictions;
+
+    sss_mc_copy_records(new_mcc, mcc);
+    sss_mc_header_update(new_mcc, SSS_MC_HEADER_ALIVE);
+
+    if (rename(new_mcc->file, mcc->file) == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to rename %s to %s: %d(%s)\n",
+                                    new_mcc->file, mcc->file,
+                                    ret, strerror(ret));
+        if (unlink(new_mcc->file) == -1) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Failed to rm mmap file %s\n",
+                                      new_mcc->file);
+        }
+        talloc_free(new_mcc);
+        mcc->max_n_elem = mcc->ft_size * 8;
+        return ret;
+    }
+    talloc_steal(new_mcc, mcc->file);
+    talloc_free(new_mcc->file);
+    new_mcc->file = mcc->file;
+
+    /* clients still using the old generation will re-map */
+    sss_mc_header_update(mcc, SSS_MC_HEADER_RECYCLED);
+
+    DEBUG(SSSDBG_IMPORTANT_INFO,
+          "Fast '%s' mmap cache grown to %zu slots (generation %"PRIu32", "
+          "%zu slots in use, %"PRIu64" evictions so far)\n",
+          mc_type_to_str(new_mcc->type), n_elem, new_mcc->generation,
+          new_mcc->used_slots, new_mcc->evictions);
+
+    talloc_free(mcc);
+    *_mcc = new_mcc;
+    return EOK;
+}
+
+/* Maps an existing cache file read-only after checking that its header is
+ * consistent and describes a layout this version can read. */
+static errno_t sss_mc_open_file(TALLOC_CTX *mem_ctx, const char *name,
+                                const char *filename, enum sss_mc_type type,
+                                struct sss_mc_ctx **_mcc)
+{
+    struct sss_mc_ctx *mc_ctx;
+    struct sss_mc_header h;
+    struct stat fdstat;
+    size_t ft_offset;
+    errno_t ret;
+
+    mc_ctx = talloc_zero(mem_ctx, struct sss_mc_ctx);
+    if (mc_ctx == NULL) {
+        return ENOMEM;
+    }
+    mc_ctx->fd = -1;
+    talloc_set_destructor(mc_ctx, mc_ctx_destructor);
+
+    mc_ctx->name = talloc_strdup(mc_ctx, name);
+    mc_ctx->file = talloc_strdup(mc_ctx, filename);
+    if (mc_ctx->name == NULL || mc_ctx->file == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    mc_ctx->type = type;
+
+    /* read-write only so that the file can be marked as recycled */
+    mc_ctx->fd = open(filename, O_RDWR);
+    if (mc_ctx->fd == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    if (fstat(mc_ctx->fd, &fdstat) == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    if (fdstat.st_size < MC_HEADER_SIZE) {
+        DEBUG(SSSDBG_TRACE_FUNC, "File %s is too small\n", filename);
+        ret = EINVAL;
+        goto done;
+    }
+    mc_ctx->mmap_size = fdstat.st_size;
+
+    mc_ctx->mmap_base = mmap(NULL, mc_ctx->mmap_size, PROT_READ,
+                             MAP_SHARED, mc_ctx->fd, 0);
+    if (mc_ctx->mmap_base == MAP_FAILED) {
+        ret = errno;
+        mc_ctx->mmap_base = NULL;
+        goto done;
+    }
+
+    memcpy(&h, mc_ctx->mmap_base, sizeof(struct sss_mc_header));
+    if (!MC_VALID_BARRIER(h.b1) || h.b1 != h.b2) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Header of %s is inconsistent\n", filename);
+        ret = EINVAL;
+        goto done;
+    }
+
+    if (h.major_vno != SSS_MC_MAJOR_VNO || h.minor_vno != SSS_MC_MINOR_VNO) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "File %s has version %"PRIu32".%"PRIu32", expected %d.%d\n",
+              filename, h.major_vno, h.minor_vno,
+              SSS_MC_MAJOR_VNO, SSS_MC_MINOR_VNO);
+        ret = EINVAL;
+        goto done;
+    }
+
+    if (h.status != SSS_MC_HEADER_ALIVE) {
+        DEBUG(SSSDBG_TRACE_FUNC, "File %s was invalidated\n", filename);
+        ret = EINVAL;
+        goto done;
+    }
+
+    /* the tables must be laid out the same way sss_mc_init_ctx() does */
+    ft_offset = MC_HEADER_SIZE + MC_ALIGN64(h.dt_size);
+    if (h.dt_size == 0
+            || h.dt_size % (MC_SLOT_SIZE * 64) != 0
+            || h.ft_size != h.dt_size / MC_SLOT_SIZE / 8
+            || h.ht_size == 0
+            || h.ht_size % MC_HT_BUCKET_SIZE != 0
+            || h.data_table != MC_HEADER_SIZE
+            || h.free_table != ft_offset
+            || h.hash_table != MC_ALIGN_CACHELINE(ft_offset +
+                                                  MC_ALIGN64(h.ft_size))
+            || (size_t)h.hash_table + h.ht_size != mc_ctx->mmap_size) {
+        DEBUG(SSSDBG_TRACE_FUNC, "File %s has an invalid layout\n", filename);
+        ret = EINVAL;
+        goto done;
+    }
+
+    mc_ctx->seed = h.seed;
+    mc_ctx->generation = h.generation;
+    mc_ctx->data_table = MC_PTR_ADD(mc_ctx->mmap_base, h.data_table);
+    mc_ctx->dt_size = h.dt_size;
+    mc_ctx->free_table = MC_PTR_ADD(mc_ctx->mmap_base, h.free_table);
+    mc_ctx->ft_size = h.ft_size;
+    mc_ctx->hash_table = MC_PTR_ADD(mc_ctx->mmap_base, h.hash_table);
+    mc_ctx->ht_size = h.ht_size;
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(mc_ctx);
+    } else {
+        *_mcc = mc_ctx;
+    }
+    return ret;
+}
+
+/* Creates a new cache holding the unexpired records of the cache left in
+ * 'filename' by a previous instance of the responder and puts it in place
+ * of the old one. Like when the cache is regrown, clients keep using the
+ * old file until the new one is fully populated. */
+static errno_t sss_mc_warm_start(TALLOC_CTX *mem_ctx, const char *name,
+                                 const char *filename, enum sss_mc_type type,
+                                 size_t n_elem, size_t max_n_elem,
+                                 time_t timeout, struct sss_mc_ctx **_mcc)
+{
+    struct sss_mc_ctx *old_mcc = NULL;
+    struct sss_mc_ctx *new_mcc = NULL;
+    uint32_t bad;
+    char *file;
+    errno_t ret;
+
+    ret = sss_mc_open_file(mem_ctx, name, filename, type, &old_mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* keep all records of a cache which was regrown before the restart */
+    n_elem = MAX(n_elem, MIN(old_mcc->ft_size * 8, max_n_elem));
+
+    file = talloc_asprintf(NULL, "%s.new", filename);
+    if (file == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* remove leftovers of a previous interrupted attempt */
+    if (unlink(file) == -1 && errno != ENOENT) {
+        ret = errno;
+        talloc_free(file);
+        goto done;
+    }
+
+    ret = sss_mc_init_ctx(mem_ctx, name, file, type, n_elem, max_n_elem,
+                          timeout, &new_mcc);
+    if (ret != EOK) {
+        goto done;
+    }
+    new_mcc->generation = old_mcc->generation;
+
+    bad = sss_mc_copy_records(new_mcc, old_mcc);
+    if (bad != 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Found %"PRIu32" inconsistent slots in fast '%s' mmap cache, "
+              "not reusing it\n", bad, mc_type_to_str(type));
+        sss_mc_save_corrupted(old_mcc);
+        ret = EINVAL;
+        goto done;
+    }
+
+    sss_mc_header_update(new_mcc, SSS_MC_HEADER_ALIVE);
+
+    if (rename(new_mcc->file, filename) == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to rename %s to %s: %d(%s)\n",
+                                    new_mcc->file, filename,
+                                    ret, strerror(ret));
+        goto done;
+    }
+    talloc_free(new_mcc->file);
+    new_mcc->file = talloc_steal(new_mcc, old_mcc->file);
+
+    /* clients still using the old file will re-map */
+    ret = sss_mc_set_recycled(old_mcc->fd);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Failed to mark old mmap file %s as "
+                                     "recycled: %d (%s)\n",
+                                     filename, ret, strerror(ret));
+    }
+
+    DEBUG(SSSDBG_CONF_SETTINGS,
+          "Fast '%s' mmap cache warm started with %zu of %zu slots in use\n",
+          mc_type_to_str(type), new_mcc->used_slots, n_elem);
+
+    *_mcc = new_mcc;
+    new_mcc = NULL;
+    ret = EOK;
+
+done:
+    if (new_mcc != NULL) {
+        if (unlink(new_mcc->file) == -1) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Failed to rm mmap file %s\n",
+                                      new_mcc->file);
+        }
+        talloc_free(new_mcc);
+    }
+    talloc_free(old_mcc);
+    return ret;
+}
+
 errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx,
                               size_t n_elem,
                               time_t timeout, struct sss_mc_ctx **mc_ctx)
@@ -1515,6 +2285,7 @@ errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx,
     TALLOC_CTX* tmp_ctx = NULL;
     char *name;
     enum sss_mc_type type;
+    size_t max_n_elem;
 
     if (mc_ctx == NULL || (*mc_ctx) == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -1536,6 +2307,7 @@ errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx,
     }
 
     type = (*mc_ctx)->type;
+    max_n_elem = (*mc_ctx)->max_n_elem;
 
     if (n_elem == (size_t)-1) {
         n_elem = (*mc_ctx)->ft_size * 8;
@@ -1554,6 +2326,8 @@ errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx,
                               name,
                               type,
                               n_elem,
+                              max_n_elem,
+                              false,
                               timeout,
                               mc_ctx);
     if (ret != EOK) {
@@ -1582,6 +2356,26 @@ void sss_mmap_cache_reset(struct sss_mc_ctx *mc_ctx)
     memset(mc_ctx->data_table, 0xff, mc_ctx->dt_size);
     memset(mc_ctx->free_table, 0x00, mc_ctx->ft_size);
     memset(mc_ctx->hash_table, 0xff, mc_ctx->ht_size);
+    mc_ctx->ht_deleted = 0;
+    mc_ctx->used_slots = 0;
+    mc_ctx->next_slot = 0;
 
     sss_mc_header_update(mc_ctx, SSS_MC_HEADER_ALIVE);
 }
+
+void sss_mmap_cache_get_stats(struct sss_mc_ctx *mc_ctx,
+                              struct sss_mc_stats *stats)
+{
+    memset(stats, 0, sizeof(struct sss_mc_stats));
+
+    if (mc_ctx == NULL) {
+        return;
+    }
+
+    stats->generation = mc_ctx->generation;
+    stats->n_elem = mc_ctx->ft_size * 8;
+    stats->max_n_elem = mc_ctx->max_n_elem;
+    stats->used_slots = mc_ctx->used_slots;
+    stats->stores = mc_ctx->stores;
+    stats->evictions = mc_ctx->evictions;
+}
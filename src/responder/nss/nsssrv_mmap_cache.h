@@ -30,10 +30,26 @@ enum sss_mc_type {
     SSS_MC_GROUP,
     SSS_MC_INITGROUPS,
     SSS_MC_SID,
+    SSS_MC_NETGROUP,
+    SSS_MC_SERVICES,
 };
 
+struct sss_mc_stats {
+    uint32_t generation;    /* number of times the cache file was regrown */
+    size_t n_elem;          /* current number of slots */
+    size_t max_n_elem;      /* number of slots the cache may grow to */
+    size_t used_slots;      /* slots occupied by records */
+    uint64_t stores;        /* records written */
+    uint64_t evictions;     /* live records dropped to make room */
+};
+
+/* The cache starts with n_elem slots. If max_n_elem is larger than n_elem
+ * the cache is regrown online, instead of evicting live records, until it
+ * reaches max_n_elem slots. If warm_start is true the unexpired records of
+ * an existing consistent cache file are kept, otherwise it is discarded. */
 errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
                             enum sss_mc_type type, size_t n_elem,
+                            size_t max_n_elem, bool warm_start,
                             time_t valid_time, struct sss_mc_ctx **mcc);
 
 errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
@@ -62,11 +78,29 @@ errno_t sss_mmap_cache_sid_store(struct sss_mc_ctx **_mcc,
                                  uint32_t type,          /* enum sss_id_type*/
                                  bool explicit_lookup);  /* false ~ by_id(), true ~ by_uid/gid() */
 
+errno_t sss_mmap_cache_netgr_store(struct sss_mc_ctx **_mcc,
+                                   const struct sized_string *name,
+                                   const uint8_t *rep, size_t rep_len);
+
+/* key is "name/protocol" or "port/protocol", see struct sss_mc_rep_data */
+errno_t sss_mmap_cache_svc_store(struct sss_mc_ctx **_mcc,
+                                 const struct sized_string *key,
+                                 const uint8_t *rep, size_t rep_len);
+
 errno_t sss_mmap_cache_pw_invalidate(struct sss_mc_ctx **_mcc,
                                      const struct sized_string *name);
 
 errno_t sss_mmap_cache_pw_invalidate_uid(struct sss_mc_ctx **_mcc, uid_t uid);
 
+/* Store a negative record valid for ttl seconds for the name, or for the
+ * uid if name is NULL */
+errno_t sss_mmap_cache_pw_store_negative(struct sss_mc_ctx **_mcc,
+                                         const struct sized_string *name,
+                                         uid_t uid, time_t ttl);
+
+/* Invalidate all negative records */
+errno_t sss_mmap_cache_pw_invalidate_negative(struct sss_mc_ctx **_mcc);
+
 errno_t sss_mmap_cache_gr_invalidate(struct sss_mc_ctx **_mcc,
                                      const struct sized_string *name);
 
@@ -81,4 +115,7 @@ errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx,
 
 void sss_mmap_cache_reset(struct sss_mc_ctx *mc_ctx);
 
+void sss_mmap_cache_get_stats(struct sss_mc_ctx *mc_ctx,
+                              struct sss_mc_stats *stats);
+
 #endif /* _NSSSRV_MMAP_CACHE_H_ */
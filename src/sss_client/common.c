@@ -710,12 +710,6 @@ static int sss_cli_open_socket(int *errnop, const char *socket_name, int timeout
         return -1;
     }
 
-    ret = sss_cli_sb_set_by_sd(sd);
-    if (ret != 0) {
-        close(sd);
-        return -1;
-    }
-
     return sd;
 }
 
@@ -846,6 +840,12 @@ static enum sss_status sss_cli_check_socket(int *errnop,
         return SSS_STATUS_UNAVAIL;
     }
 
+    ret = sss_cli_sb_set_by_sd(mysd);
+    if (ret != 0) {
+        close(mysd);
+        return SSS_STATUS_UNAVAIL;
+    }
+
     sss_cli_sd_set(mysd);
 
     if (sss_cli_check_version(socket_name, timeout)) {
@@ -857,6 +857,533 @@ static enum sss_status sss_cli_check_socket(int *errnop,
     return SSS_STATUS_UNAVAIL;
 }
 
+#ifdef HAVE_PTHREAD_EXT
+
+/* Pipelined mode, enabled with SSS_PIPELINE=YES: all threads of a process
+ * share a single connection to the NSS responder instead of opening one
+ * each. Requests carry an id in the last header field, which the responder
+ * copies to the reply, so replies can arrive in any order. Whichever
+ * waiting thread finds nobody reading the socket reads replies on behalf of
+ * all of them until its own reply arrives. */
+
+struct sss_cli_pipeline_waiter {
+    struct sss_cli_pipeline_waiter *prev;
+    struct sss_cli_pipeline_waiter *next;
+    uint32_t id;
+    bool done;
+    int errnop;
+    uint32_t status;
+    uint32_t cmd;
+    uint8_t *buf;
+    size_t len;
+};
+
+struct sss_cli_pipeline {
+    pthread_mutex_t mtx;    /* protects everything below */
+    pthread_mutex_t wmtx;   /* serializes writing of requests */
+    pthread_cond_t cond;
+    int sd;
+    bool broken;            /* closed once the last user leaves */
+    bool unsupported;
+    bool reading;
+    unsigned int users;
+    uint32_t next_id;
+    struct sss_cli_pipeline_waiter *waiters;
+};
+
+static struct sss_cli_pipeline sss_pipe = {
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+    .wmtx = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .sd = -1,
+};
+
+static bool sss_pipeline_mode = false;
+static pthread_once_t sss_pipeline_mode_initialized = PTHREAD_ONCE_INIT;
+
+bool sss_is_lockfree_mode(void);
+
+static void sss_cli_pipeline_atfork_child(void)
+{
+    /* the other threads, and their requests, do not exist in the child */
+    if (sss_pipe.sd != -1) {
+        close(sss_pipe.sd);
+    }
+
+    pthread_mutex_init(&sss_pipe.mtx, NULL);
+    pthread_mutex_init(&sss_pipe.wmtx, NULL);
+    pthread_cond_init(&sss_pipe.cond, NULL);
+    sss_pipe.sd = -1;
+    sss_pipe.broken = false;
+    sss_pipe.reading = false;
+    sss_pipe.users = 0;
+    sss_pipe.waiters = NULL;
+}
+
+static void init_pipeline_mode(void)
+{
+    const char *env = getenv("SSS_PIPELINE");
+
+    if ((env != NULL) && (strcasecmp(env, "YES") == 0)) {
+        if (pthread_atfork(NULL, NULL, sss_cli_pipeline_atfork_child) == 0) {
+            sss_pipeline_mode = true;
+        }
+    }
+}
+
+static bool sss_cli_pipeline_enabled(void)
+{
+    pthread_once(&sss_pipeline_mode_initialized, init_pipeline_mode);
+
+    /* without lockfree mode requests of all threads are serialized anyway */
+    return sss_pipeline_mode && sss_is_lockfree_mode();
+}
+
+static int sss_cli_pipeline_poll(int sd, short events, int timeout)
+{
+    struct pollfd pfd;
+    int res, error;
+
+    pfd.fd = sd;
+    pfd.events = events;
+
+    do {
+        errno = 0;
+        res = poll(&pfd, 1, timeout);
+        error = errno;
+    } while (error == EINTR);
+
+    switch (res) {
+    case -1:
+        return error;
+    case 0:
+        return ETIME;
+    case 1:
+        if (pfd.revents & (POLLERR | POLLNVAL)) {
+            return EPIPE;
+        }
+        if (!(pfd.revents & events)) {
+            return EPIPE;
+        }
+        return 0;
+    default: /* more than one available!? */
+        return EBADF;
+    }
+}
+
+static int sss_cli_pipeline_write(int sd, const uint8_t *data, size_t len,
+                                  int timeout)
+{
+    size_t datasent = 0;
+    ssize_t sent;
+    int ret;
+
+    while (datasent < len) {
+        ret = sss_cli_pipeline_poll(sd, POLLOUT, timeout);
+        if (ret != 0) {
+            return ret;
+        }
+
+        errno = 0;
+        sent = send(sd, data + datasent, len - datasent,
+                    SSS_DEFAULT_WRITE_FLAGS);
+        if (sent <= 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return errno != 0 ? errno : EPIPE;
+        }
+
+        datasent += sent;
+    }
+
+    return 0;
+}
+
+/* Fails with ETIME only if nothing was read, otherwise the connection is
+ * out of sync and can not be used anymore. */
+static int sss_cli_pipeline_read(int sd, uint8_t *data, size_t len,
+                                 bool partial, int timeout)
+{
+    size_t datarecv = 0;
+    ssize_t res;
+    int ret;
+
+    while (datarecv < len) {
+        ret = sss_cli_pipeline_poll(sd, POLLIN, timeout);
+        if (ret != 0) {
+            return (ret == ETIME && (partial || datarecv > 0)) ? EPIPE : ret;
+        }
+
+        errno = 0;
+        res = read(sd, data + datarecv, len - datarecv);
+        if (res <= 0) {
+            if (res == -1 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            return (res == -1 && errno != 0) ? errno : EPIPE;
+        }
+
+        datarecv += res;
+    }
+
+    return 0;
+}
+
+static int sss_cli_pipeline_send_req(int sd, enum sss_cli_command cmd,
+                                     uint32_t id, struct sss_cli_req_data *rd,
+                                     int timeout)
+{
+    uint32_t header[4];
+    int ret;
+
+    header[0] = SSS_NSS_HEADER_SIZE + (rd ? rd->len : 0);
+    header[1] = cmd;
+    header[2] = 0;
+    header[3] = id;
+
+    ret = sss_cli_pipeline_write(sd, (uint8_t *)header, SSS_NSS_HEADER_SIZE,
+                                 timeout);
+    if (ret == 0 && rd != NULL && rd->len > 0) {
+        ret = sss_cli_pipeline_write(sd, rd->data, rd->len, timeout);
+        if (ret == ETIME) {
+            /* half of a request was sent */
+            ret = EPIPE;
+        }
+    }
+
+    return ret;
+}
+
+static int sss_cli_pipeline_recv_rep(int sd, uint32_t header[4],
+                                     uint8_t **_buf, size_t *_len,
+                                     int timeout)
+{
+    uint8_t *buf = NULL;
+    size_t len;
+    int ret;
+
+    ret = sss_cli_pipeline_read(sd, (uint8_t *)header, SSS_NSS_HEADER_SIZE,
+                                false, timeout);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (header[0] < SSS_NSS_HEADER_SIZE) {
+        return EBADMSG;
+    }
+
+    len = header[0] - SSS_NSS_HEADER_SIZE;
+    if (len > 0) {
+        buf = malloc(len);
+        if (buf == NULL) {
+            return ENOMEM;
+        }
+
+        ret = sss_cli_pipeline_read(sd, buf, len, true, timeout);
+        if (ret != 0) {
+            free(buf);
+            return ret;
+        }
+    }
+
+    *_buf = buf;
+    *_len = len;
+    return 0;
+}
+
+/* Called with sss_pipe.mtx held and no other user of the connection */
+static int sss_cli_pipeline_open(int timeout)
+{
+    uint32_t req_data[2] = { SSS_NSS_PROTOCOL_VERSION,
+                             SSS_CLI_FEATURE_PIPELINE };
+    struct sss_cli_req_data rd = { sizeof(req_data), req_data };
+    uint32_t header[4];
+    uint32_t version;
+    uint32_t features;
+    uint8_t *buf = NULL;
+    size_t len = 0;
+    int errnop = 0;
+    int sd;
+    int ret;
+
+    sd = sss_cli_open_socket(&errnop, SSS_NSS_SOCKET_NAME, timeout);
+    if (sd == -1) {
+        return errnop != 0 ? errnop : EPIPE;
+    }
+
+    ret = sss_cli_pipeline_send_req(sd, SSS_GET_VERSION, 0, &rd, timeout);
+    if (ret == 0) {
+        ret = sss_cli_pipeline_recv_rep(sd, header, &buf, &len, timeout);
+    }
+    if (ret != 0) {
+        close(sd);
+        return ret;
+    }
+
+    /* responders which do not support pipelining reply with the version
+     * only */
+    if (header[2] != 0 || len < 2 * sizeof(uint32_t)) {
+        sss_pipe.unsupported = true;
+        ret = ENOTSUP;
+    } else {
+        SAFEALIGN_COPY_UINT32(&version, buf, NULL);
+        SAFEALIGN_COPY_UINT32(&features, buf + sizeof(uint32_t), NULL);
+        if (version != SSS_NSS_PROTOCOL_VERSION
+                || (features & SSS_CLI_FEATURE_PIPELINE) == 0) {
+            sss_pipe.unsupported = true;
+            ret = ENOTSUP;
+        }
+    }
+    free(buf);
+
+    if (ret != 0) {
+        close(sd);
+        return ret;
+    }
+
+    sss_pipe.sd = sd;
+    sss_pipe.broken = false;
+    return 0;
+}
+
+/* Called with sss_pipe.mtx held */
+static void sss_cli_pipeline_fail(int error)
+{
+    struct sss_cli_pipeline_waiter *w;
+
+    if (!sss_pipe.broken) {
+        /* wakes up the threads which use the socket, it is closed once the
+         * last one leaves */
+        shutdown(sss_pipe.sd, SHUT_RDWR);
+        sss_pipe.broken = true;
+    }
+
+    for (w = sss_pipe.waiters; w != NULL; w = w->next) {
+        if (!w->done) {
+            w->done = true;
+            w->errnop = error;
+        }
+    }
+
+    pthread_cond_broadcast(&sss_pipe.cond);
+}
+
+/* Called with sss_pipe.mtx held, delivers a reply to its waiter */
+static void sss_cli_pipeline_deliver(uint32_t header[4],
+                                     uint8_t *buf, size_t len)
+{
+    struct sss_cli_pipeline_waiter *w;
+
+    for (w = sss_pipe.waiters; w != NULL; w = w->next) {
+        if (w->id == header[3] && !w->done) {
+            w->done = true;
+            w->cmd = header[1];
+            w->status = header[2];
+            w->buf = buf;
+            w->len = len;
+            pthread_cond_broadcast(&sss_pipe.cond);
+            return;
+        }
+    }
+
+    /* the waiter gave up already */
+    free(buf);
+}
+
+static void sss_cli_pipeline_deadline(int timeout, struct timespec *ts)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout / 1000;
+    ts->tv_nsec += (timeout % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* Enumerations and the member pages of a group keep their position in the
+ * state of the connection, they must not be shared by the threads. */
+static bool sss_cli_pipeline_cmd(enum sss_cli_command cmd)
+{
+    switch (cmd) {
+    case SSS_NSS_SETPWENT:
+    case SSS_NSS_GETPWENT:
+    case SSS_NSS_ENDPWENT:
+    case SSS_NSS_SETGRENT:
+    case SSS_NSS_GETGRENT:
+    case SSS_NSS_ENDGRENT:
+    case SSS_NSS_SETNETGRENT:
+    case SSS_NSS_GETNETGRENT:
+    case SSS_NSS_ENDNETGRENT:
+    case SSS_NSS_SETHOSTENT:
+    case SSS_NSS_GETHOSTENT:
+    case SSS_NSS_ENDHOSTENT:
+    case SSS_NSS_SETNETENT:
+    case SSS_NSS_GETNETENT:
+    case SSS_NSS_ENDNETENT:
+    case SSS_NSS_SETSERVENT:
+    case SSS_NSS_GETSERVENT:
+    case SSS_NSS_ENDSERVENT:
+    case SSS_NSS_GETGRMEMBERS:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/* Returns false if the request was not sent because pipelining is not
+ * available, the caller should use a connection of its own instead. */
+static bool sss_cli_make_request_pipelined(enum sss_cli_command cmd,
+                                           struct sss_cli_req_data *rd,
+                                           int timeout,
+                                           uint8_t **repbuf, size_t *replen,
+                                           int *errnop,
+                                           enum sss_status *_status)
+{
+    struct sss_cli_pipeline_waiter me = { 0 };
+    struct timespec deadline;
+    uint32_t header[4];
+    uint8_t *buf;
+    size_t len;
+    int sd;
+    int ret;
+
+    pthread_mutex_lock(&sss_pipe.mtx);
+
+    if (sss_pipe.sd != -1 && sss_pipe.broken && sss_pipe.users == 0) {
+        close(sss_pipe.sd);
+        sss_pipe.sd = -1;
+        sss_pipe.broken = false;
+    }
+
+    if (sss_pipe.unsupported || sss_pipe.broken) {
+        pthread_mutex_unlock(&sss_pipe.mtx);
+        return false;
+    }
+
+    if (sss_pipe.sd == -1) {
+        ret = sss_cli_pipeline_open(timeout);
+        if (ret != 0) {
+            pthread_mutex_unlock(&sss_pipe.mtx);
+            return false;
+        }
+    }
+
+    sss_pipe.next_id++;
+    if (sss_pipe.next_id == 0) {
+        sss_pipe.next_id++;
+    }
+    me.id = sss_pipe.next_id;
+    me.next = sss_pipe.waiters;
+    if (sss_pipe.waiters != NULL) {
+        sss_pipe.waiters->prev = &me;
+    }
+    sss_pipe.waiters = &me;
+    sss_pipe.users++;
+    sd = sss_pipe.sd;
+
+    pthread_mutex_unlock(&sss_pipe.mtx);
+
+    pthread_mutex_lock(&sss_pipe.wmtx);
+    ret = sss_cli_pipeline_send_req(sd, cmd, me.id, rd, timeout);
+    pthread_mutex_unlock(&sss_pipe.wmtx);
+
+    pthread_mutex_lock(&sss_pipe.mtx);
+
+    if (ret == ETIME) {
+        /* nothing was sent */
+        me.done = true;
+        me.errnop = ETIME;
+    } else if (ret != 0) {
+        sss_cli_pipeline_fail(ret);
+    }
+
+    sss_cli_pipeline_deadline(timeout, &deadline);
+    while (!me.done) {
+        if (!sss_pipe.reading && !sss_pipe.broken) {
+            sss_pipe.reading = true;
+            pthread_mutex_unlock(&sss_pipe.mtx);
+
+            buf = NULL;
+            ret = sss_cli_pipeline_recv_rep(sd, header, &buf, &len, timeout);
+
+            pthread_mutex_lock(&sss_pipe.mtx);
+            sss_pipe.reading = false;
+
+            if (ret == 0) {
+                sss_cli_pipeline_deliver(header, buf, len);
+            } else if (ret == ETIME) {
+                me.done = true;
+                me.errnop = ETIME;
+                /* let another thread take over reading */
+                pthread_cond_broadcast(&sss_pipe.cond);
+            } else {
+                sss_cli_pipeline_fail(ret);
+            }
+            continue;
+        }
+
+        ret = pthread_cond_timedwait(&sss_pipe.cond, &sss_pipe.mtx, &deadline);
+        if (ret == ETIMEDOUT && !me.done) {
+            me.done = true;
+            me.errnop = ETIME;
+        }
+    }
+
+    if (me.prev != NULL) {
+        me.prev->next = me.next;
+    } else {
+        sss_pipe.waiters = me.next;
+    }
+    if (me.next != NULL) {
+        me.next->prev = me.prev;
+    }
+    sss_pipe.users--;
+
+    if (sss_pipe.broken && sss_pipe.users == 0) {
+        close(sss_pipe.sd);
+        sss_pipe.sd = -1;
+        sss_pipe.broken = false;
+    }
+
+    pthread_mutex_unlock(&sss_pipe.mtx);
+
+    if (me.errnop == 0 && me.cmd != cmd) {
+        /* wrong command id */
+        me.errnop = EBADMSG;
+    }
+    if (me.errnop == 0 && me.status != 0) {
+        /* server side error */
+        me.errnop = me.status;
+    }
+
+    if (me.errnop != 0) {
+        free(me.buf);
+        *errnop = me.errnop;
+        *_status = (me.errnop == EAGAIN) ? SSS_STATUS_TRYAGAIN
+                                         : SSS_STATUS_UNAVAIL;
+        return true;
+    }
+
+    if (repbuf && me.buf) {
+        *repbuf = me.buf;
+        if (replen) {
+            *replen = me.len;
+        }
+    } else {
+        free(me.buf);
+        if (replen) {
+            *replen = 0;
+        }
+    }
+
+    *_status = SSS_STATUS_SUCCESS;
+    return true;
+}
+
+#endif /* HAVE_PTHREAD_EXT */
+
 /* this function will check command codes match and returned length is ok */
 /* repbuf and replen report only the data section not the header */
 enum nss_status sss_nss_make_request_timeout(enum sss_cli_command cmd,
@@ -874,6 +1401,14 @@ enum nss_status sss_nss_make_request_timeout(enum sss_cli_command cmd,
         return NSS_STATUS_NOTFOUND;
     }
 
+#ifdef HAVE_PTHREAD_EXT
+    if (sss_cli_pipeline_enabled() && sss_cli_pipeline_cmd(cmd)
+            && sss_cli_make_request_pipelined(cmd, rd, timeout, repbuf, replen,
+                                              errnop, &ret)) {
+        goto done;
+    }
+#endif
+
     ret = sss_cli_check_socket(errnop, SSS_NSS_SOCKET_NAME, timeout);
     if (ret != SSS_STATUS_SUCCESS) {
 #ifdef NONSTANDARD_SSS_NSS_BEHAVIOUR
@@ -904,6 +1439,10 @@ enum nss_status sss_nss_make_request_timeout(enum sss_cli_command cmd,
         ret = sss_cli_make_request_nochecks(cmd, rd, timeout, repbuf, replen,
                                             errnop);
     }
+
+#ifdef HAVE_PTHREAD_EXT
+done:
+#endif
     switch (ret) {
     case SSS_STATUS_TRYAGAIN:
         return NSS_STATUS_TRYAGAIN;
@@ -194,6 +194,9 @@ static int sss_get_ex(struct nss_input *inp, uint32_t flags,
             return 0;
         case ERANGE:
             return ERANGE;
+        case ESRCH:
+            /* the entry is cached as nonexistent */
+            return ENOENT;
         case ENOENT:
             /* fall through, we need to actively ask the parent
              * if no entry is found */
@@ -220,6 +223,9 @@ static int sss_get_ex(struct nss_input *inp, uint32_t flags,
         case ERANGE:
             ret = ERANGE;
             goto out;
+        case ESRCH:
+            ret = ENOENT;
+            goto out;
         case ENOENT:
             /* fall through, we need to actively ask the parent
              * if no entry is found */
@@ -531,3 +537,197 @@ int sss_nss_getgrouplist_timeout(const char *name, gid_t group,
 
     return ret;
 }
+
+/* Each key gets an equal slice of the caller's buffer, so a key whose slice
+ * is too small fails with ERANGE without affecting the other keys. */
+static int sss_get_multi_ex(enum sss_cli_command cmd, size_t num_ids,
+                            const uint32_t *ids, struct passwd *pwds,
+                            struct group *grps, int *errs,
+                            char *buffer, size_t buflen,
+                            uint32_t flags, unsigned int timeout)
+{
+    uint32_t req_data[2 + SSS_NSS_MULTI_MAX_KEYS];
+    size_t pending[SSS_NSS_MULTI_MAX_KEYS];
+    struct sss_cli_req_data rd;
+    struct sss_nss_pw_rep pwrep;
+    struct sss_nss_gr_rep grrep;
+    uint8_t *repbuf = NULL;
+    size_t replen;
+    size_t slice;
+    size_t idx;
+    size_t len;
+    size_t c;
+    uint32_t num_pending = 0;
+    uint32_t num_keys;
+    uint32_t num_results;
+    uint32_t err;
+    uint32_t key_len;
+    int time_left;
+    int errnop;
+    int ret;
+
+    if (num_ids == 0 || num_ids > SSS_NSS_MULTI_MAX_KEYS || ids == NULL
+            || errs == NULL || buffer == NULL) {
+        return EINVAL;
+    }
+
+    /* SSS_NSS_EX_FLAG_NO_CACHE and SSS_NSS_EX_FLAG_INVALIDATE_CACHE are
+     * mutually exclusive */
+    if ((flags & SSS_NSS_EX_FLAG_NO_CACHE) != 0
+            && (flags & SSS_NSS_EX_FLAG_INVALIDATE_CACHE) != 0) {
+        return EINVAL;
+    }
+
+    slice = (buflen / num_ids) & ~(sizeof(char *) - 1);
+    if (slice == 0) {
+        return ERANGE;
+    }
+
+    for (c = 0; c < num_ids; c++) {
+        errs[c] = ENOENT;
+
+        if ((flags & (SSS_NSS_EX_FLAG_NO_CACHE
+                      | SSS_NSS_EX_FLAG_INVALIDATE_CACHE)) == 0) {
+            if (cmd == SSS_NSS_GETPWUID_MULTI) {
+                ret = sss_nss_mc_getpwuid(ids[c], &pwds[c],
+                                          buffer + c * slice, slice);
+            } else {
+                ret = sss_nss_mc_getgrgid(ids[c], &grps[c],
+                                          buffer + c * slice, slice);
+            }
+
+            switch (ret) {
+            case 0:
+            case ERANGE:
+                errs[c] = ret;
+                continue;
+            case ESRCH:
+                /* the entry is cached as nonexistent */
+                continue;
+            default:
+                break;
+            }
+        }
+
+        SAFEALIGN_COPY_UINT32(&req_data[2 + num_pending], &ids[c], NULL);
+        pending[num_pending] = c;
+        num_pending++;
+    }
+
+    if (num_pending == 0) {
+        return 0;
+    }
+
+    SAFEALIGN_COPY_UINT32(&req_data[0], &flags, NULL);
+    SAFEALIGN_COPY_UINT32(&req_data[1], &num_pending, NULL);
+    rd.len = (2 + num_pending) * sizeof(uint32_t);
+    rd.data = req_data;
+
+    ret = sss_nss_timedlock(timeout, &time_left);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = sss_nss_make_request_timeout(cmd, &rd, time_left,
+                                       &repbuf, &replen, &errnop);
+    if (ret != NSS_STATUS_SUCCESS) {
+        ret = errnop != 0 ? errnop : EIO;
+        goto out;
+    }
+
+    if (replen < 2 * sizeof(uint32_t)) {
+        ret = EBADMSG;
+        goto out;
+    }
+
+    SAFEALIGN_COPY_UINT32(&num_keys, repbuf, NULL);
+    if (num_keys != num_pending) {
+        ret = EBADMSG;
+        goto out;
+    }
+
+    idx = 2 * sizeof(uint32_t);
+    for (c = 0; c < num_pending; c++) {
+        if (replen - idx < 2 * sizeof(uint32_t)) {
+            ret = EBADMSG;
+            goto out;
+        }
+
+        SAFEALIGN_COPY_UINT32(&err, repbuf + idx, &idx);
+        SAFEALIGN_COPY_UINT32(&key_len, repbuf + idx, &idx);
+        if (replen - idx < key_len) {
+            ret = EBADMSG;
+            goto out;
+        }
+
+        if (err != 0 || key_len < 2 * sizeof(uint32_t)) {
+            errs[pending[c]] = err != 0 ? err : ENOENT;
+            idx += key_len;
+            continue;
+        }
+
+        /* only 1 result is accepted for each key */
+        SAFEALIGN_COPY_UINT32(&num_results, repbuf + idx, NULL);
+        if (num_results != 1) {
+            errs[pending[c]] = num_results == 0 ? ENOENT : EBADMSG;
+            idx += key_len;
+            continue;
+        }
+
+        len = key_len - 2 * sizeof(uint32_t);
+        if (cmd == SSS_NSS_GETPWUID_MULTI) {
+            pwrep.result = &pwds[pending[c]];
+            pwrep.buffer = buffer + pending[c] * slice;
+            pwrep.buflen = slice;
+            errs[pending[c]] = sss_nss_getpw_readrep(&pwrep,
+                                                  repbuf + idx
+                                                    + 2 * sizeof(uint32_t),
+                                                  &len);
+        } else {
+            grrep.result = &grps[pending[c]];
+            grrep.buffer = buffer + pending[c] * slice;
+            grrep.buflen = slice;
+            errs[pending[c]] = sss_nss_getgr_readrep(&grrep,
+                                                  repbuf + idx
+                                                    + 2 * sizeof(uint32_t),
+                                                  &len);
+        }
+        idx += key_len;
+    }
+
+    ret = 0;
+
+out:
+    free(repbuf);
+
+    sss_nss_unlock();
+    return ret;
+}
+
+int sss_nss_getpwuid_multi_timeout(size_t num_uids, const uid_t *uids,
+                                   struct passwd *pwds, int *errs,
+                                   char *buffer, size_t buflen,
+                                   uint32_t flags, unsigned int timeout)
+{
+    if (pwds == NULL) {
+        return EINVAL;
+    }
+
+    return sss_get_multi_ex(SSS_NSS_GETPWUID_MULTI, num_uids,
+                            (const uint32_t *)uids, pwds, NULL, errs,
+                            buffer, buflen, flags, timeout);
+}
+
+int sss_nss_getgrgid_multi_timeout(size_t num_gids, const gid_t *gids,
+                                   struct group *grps, int *errs,
+                                   char *buffer, size_t buflen,
+                                   uint32_t flags, unsigned int timeout)
+{
+    if (grps == NULL) {
+        return EINVAL;
+    }
+
+    return sss_get_multi_ex(SSS_NSS_GETGRGID_MULTI, num_gids,
+                            (const uint32_t *)gids, NULL, grps, errs,
+                            buffer, buflen, flags, timeout);
+}
@@ -402,6 +402,46 @@ int sss_nss_getgrgid_timeout(gid_t gid, struct group *grp,
 int sss_nss_getgrouplist_timeout(const char *name, gid_t group,
                                  gid_t *groups, int *ngroups,
                                  uint32_t flags, unsigned int timeout);
+
+/**
+ * @brief Return user information for a list of uids with a single request
+ *
+ * Users found in the memory cache are not requested from SSSD.
+ *
+ * @param[in]  num_uids   number of uids, at most SSS_NSS_MULTI_MAX_KEYS (128)
+ * @param[in]  uids       array of num_uids uids
+ * @param[out] pwds       array of num_uids struct passwd, pwds[i] is valid if
+ *                        errs[i] is 0
+ * @param[out] errs       array of num_uids results, same values as returned
+ *                        by sss_nss_getpwuid_timeout() for a single uid
+ * @param[in]  buffer     buffer for the strings of all users, each user gets
+ *                        an equal part of it
+ * @param[in]  buflen     size of buffer
+ * @param[in]  flags      flags to control the behavior and the results of the
+ *                        call
+ * @param[in]  timeout    timeout in milliseconds
+ *
+ * @return
+ *  - 0:         request was processed, see errs for the result of each uid
+ *  - EINVAL:    invalid input
+ *  - ERANGE:    buffer too small to be split between the uids
+ *  - ETIME:     request timed out but was send to SSSD
+ *  - ETIMEDOUT: request timed out but was not send to SSSD
+ */
+int sss_nss_getpwuid_multi_timeout(size_t num_uids, const uid_t *uids,
+                                   struct passwd *pwds, int *errs,
+                                   char *buffer, size_t buflen,
+                                   uint32_t flags, unsigned int timeout);
+
+/**
+ * @brief Return group information for a list of gids with a single request
+ *
+ * Same as sss_nss_getpwuid_multi_timeout() for groups.
+ */
+int sss_nss_getgrgid_multi_timeout(size_t num_gids, const gid_t *gids,
+                                   struct group *grps, int *errs,
+                                   char *buffer, size_t buflen,
+                                   uint32_t flags, unsigned int timeout);
 /**
  * @brief Find SID by fully qualified name with timeout
  *
@@ -101,6 +101,8 @@ static int get_uid_from_mc(id_t *uid, const char *name)
     if (rc == 0) {
         IDMAP_LOG(1, ("found user %s in memcache", name));
         *uid = pwd.pw_uid;
+    } else if (rc == ESRCH) {
+        IDMAP_LOG(1, ("user %s cached as nonexistent in memcache", name));
     } else {
         IDMAP_LOG(1, ("user %s not in memcache", name));
     }
@@ -183,6 +185,8 @@ static int get_user_from_mc(char *name, size_t len, uid_t uid)
         }
         IDMAP_LOG(1, ("found uid %i in memcache", uid));
         memcpy(name, pwd.pw_name, pw_name_len);
+    } else if (rc == ESRCH) {
+        IDMAP_LOG(1, ("uid %i cached as nonexistent in memcache", uid));
     } else {
         IDMAP_LOG(1, ("uid %i not in memcache", uid));
     }
@@ -483,7 +487,10 @@ static int sss_nfs_name_to_uid(char *name, uid_t *uid)
     }
 
     rc = get_uid_from_mc(uid, name);
-    if (rc != 0) {
+    if (rc == ESRCH) {
+        /* negative record, the user is known not to exist */
+        rc = ENOENT;
+    } else if (rc != 0) {
         rc = name_to_id(name, uid, SSS_NSS_GETPWNAM);
     }
 
@@ -534,7 +541,10 @@ static int sss_nfs_uid_to_name(uid_t uid, char *domain, char *name, size_t len)
     }
 
     rc = get_user_from_mc(name, len, uid);
-    if (rc != 0) {
+    if (rc == ESRCH) {
+        /* negative record, the user is known not to exist */
+        rc = ENOENT;
+    } else if (rc != 0) {
         rc = id_to_name(name, len, uid, SSS_NSS_GETPWUID);
     }
 
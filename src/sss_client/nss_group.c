@@ -412,10 +412,104 @@ out:
 }
 
 
+/* Sends the SSS_NSS_GETGR*_EX request @cmd for @key and returns the reply
+ * in the format of SSS_NSS_GETGRNAM. If the responder sends the members of
+ * a large group in several replies, they are requested with
+ * SSS_NSS_GETGRMEMBERS and appended to the first reply. */
+static enum nss_status sss_nss_getgr_request(enum sss_cli_command cmd,
+                                             const void *key, size_t key_len,
+                                             uint8_t **_repbuf, size_t *_replen,
+                                             int *errnop)
+{
+    uint8_t body[SSS_NAME_MAX + 1 + sizeof(uint32_t)];
+    struct sss_cli_req_data rd;
+    uint32_t flags = SSS_NSS_EX_FLAG_STREAM_MEMBERS;
+    uint32_t reply_flags;
+    uint32_t num_members;
+    uint32_t page_members;
+    uint8_t *repbuf = NULL;
+    size_t replen;
+    uint8_t *page;
+    size_t pagelen;
+    uint8_t *tmp;
+    enum nss_status nret;
+
+    memcpy(body, key, key_len);
+    rd.len = key_len + sizeof(uint32_t);
+    rd.data = body;
+
+retry:
+    SAFEALIGN_COPY_UINT32(body + key_len, &flags, NULL);
+
+    nret = sss_nss_make_request(cmd, &rd, &repbuf, &replen, errnop);
+    if (nret != NSS_STATUS_SUCCESS) {
+        return nret;
+    }
+
+    if (replen < 4 * sizeof(uint32_t)) {
+        /* not found */
+        goto done;
+    }
+
+    SAFEALIGN_COPY_UINT32(&reply_flags, repbuf + sizeof(uint32_t), NULL);
+    while ((reply_flags & SSS_NSS_GR_MORE_MEMBERS) != 0) {
+        nret = sss_nss_make_request(SSS_NSS_GETGRMEMBERS, NULL,
+                                    &page, &pagelen, errnop);
+        if (nret != NSS_STATUS_SUCCESS || pagelen < 2 * sizeof(uint32_t)) {
+            if (nret == NSS_STATUS_SUCCESS) {
+                free(page);
+            }
+            free(repbuf);
+            repbuf = NULL;
+
+            if (flags == 0) {
+                *errnop = EBADMSG;
+                return NSS_STATUS_TRYAGAIN;
+            }
+
+            /* The connection might have been reset in between, ask again
+             * for the whole group. */
+            flags = 0;
+            goto retry;
+        }
+
+        SAFEALIGN_COPY_UINT32(&page_members, page, NULL);
+        SAFEALIGN_COPY_UINT32(&reply_flags, page + sizeof(uint32_t), NULL);
+
+        tmp = realloc(repbuf, replen + pagelen - 2 * sizeof(uint32_t));
+        if (tmp == NULL) {
+            free(page);
+            free(repbuf);
+            *errnop = ENOMEM;
+            return NSS_STATUS_TRYAGAIN;
+        }
+        repbuf = tmp;
+
+        memcpy(repbuf + replen, page + 2 * sizeof(uint32_t),
+               pagelen - 2 * sizeof(uint32_t));
+        replen += pagelen - 2 * sizeof(uint32_t);
+        free(page);
+
+        /* the number of members follows the number of results, the reserved
+         * field and the gid */
+        SAFEALIGN_COPY_UINT32(&num_members, repbuf + 3 * sizeof(uint32_t),
+                              NULL);
+        num_members += page_members;
+        SAFEALIGN_COPY_UINT32(repbuf + 3 * sizeof(uint32_t), &num_members,
+                              NULL);
+    }
+
+    SAFEALIGN_SETMEM_UINT32(repbuf + sizeof(uint32_t), 0, NULL);
+
+done:
+    *_repbuf = repbuf;
+    *_replen = replen;
+    return NSS_STATUS_SUCCESS;
+}
+
 enum nss_status _nss_sss_getgrnam_r(const char *name, struct group *result,
                                     char *buffer, size_t buflen, int *errnop)
 {
-    struct sss_cli_req_data rd;
     struct sss_nss_gr_rep grrep;
     uint8_t *repbuf;
     size_t replen, len, name_len;
@@ -461,9 +555,6 @@ enum nss_status _nss_sss_getgrnam_r(const char *name, struct group *result,
         break;
     }
 
-    rd.len = name_len + 1;
-    rd.data = name;
-
     sss_nss_lock();
 
     /* previous thread might already initialize entry in mmap cache */
@@ -490,8 +581,8 @@ enum nss_status _nss_sss_getgrnam_r(const char *name, struct group *result,
     nret = sss_nss_get_getgr_cache(name, 0, GETGR_NAME,
                                    &repbuf, &replen, errnop);
     if (nret == NSS_STATUS_NOTFOUND) {
-        nret = sss_nss_make_request(SSS_NSS_GETGRNAM, &rd,
-                                    &repbuf, &replen, errnop);
+        nret = sss_nss_getgr_request(SSS_NSS_GETGRNAM_EX, name, name_len + 1,
+                                     &repbuf, &replen, errnop);
     }
     if (nret != NSS_STATUS_SUCCESS) {
         goto out;
@@ -542,7 +633,6 @@ out:
 enum nss_status _nss_sss_getgrgid_r(gid_t gid, struct group *result,
                                     char *buffer, size_t buflen, int *errnop)
 {
-    struct sss_cli_req_data rd;
     struct sss_nss_gr_rep grrep;
     uint8_t *repbuf;
     size_t replen, len;
@@ -576,8 +666,6 @@ enum nss_status _nss_sss_getgrgid_r(gid_t gid, struct group *result,
     }
 
     group_gid = gid;
-    rd.len = sizeof(uint32_t);
-    rd.data = &group_gid;
 
     sss_nss_lock();
 
@@ -605,8 +693,9 @@ enum nss_status _nss_sss_getgrgid_r(gid_t gid, struct group *result,
     nret = sss_nss_get_getgr_cache(NULL, gid, GETGR_GID,
                                    &repbuf, &replen, errnop);
     if (nret == NSS_STATUS_NOTFOUND) {
-        nret = sss_nss_make_request(SSS_NSS_GETGRGID, &rd,
-                                    &repbuf, &replen, errnop);
+        nret = sss_nss_getgr_request(SSS_NSS_GETGRGID_EX, &group_gid,
+                                     sizeof(uint32_t), &repbuf, &replen,
+                                     errnop);
     }
     if (nret != NSS_STATUS_SUCCESS) {
         goto out;
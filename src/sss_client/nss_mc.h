@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 #include <pwd.h>
 #include <grp.h>
 
@@ -38,6 +39,15 @@
 typedef int errno_t;
 #endif
 
+/* Number of counters `active_threads` is spread over, each on its own
+ * cache line, so that threads entering and leaving the cache in parallel
+ * do not contend on a single counter */
+#define SSS_CLI_MC_SHARDS 16
+
+struct sss_cli_mc_shard {
+    uint32_t active_threads;
+} __attribute__((aligned(MC_CACHELINE)));
+
 enum sss_mc_state {
     UNINITIALIZED = 0,
     INITIALIZED,
@@ -64,19 +74,24 @@ struct sss_cli_mc_ctx {
     uint8_t *data_table;    /* data table address (in mmap) */
     uint32_t dt_size;       /* size of data table */
 
-    uint32_t *hash_table;   /* hash table address (in mmap) */
+    struct sss_mc_ht_bucket *hash_table; /* hash table address (in mmap) */
     uint32_t ht_size;       /* size of hash table */
 
-    uint32_t active_threads; /* count of threads which use memory cache */
+    uint32_t epoch;         /* header barrier at the last full header check */
+    time_t validated;       /* last time the cache file was checked */
+
+    /* count of threads which use memory cache */
+    struct sss_cli_mc_shard shards[SSS_CLI_MC_SHARDS];
 };
 
 #if HAVE_PTHREAD
-#define SSS_CLI_MC_CTX_INITIALIZER(mtx) {UNINITIALIZED, (mtx), -1, 0, 0, 0, NULL, 0, NULL, 0, NULL, 0, 0}
+#define SSS_CLI_MC_CTX_INITIALIZER(mtx) {UNINITIALIZED, (mtx), -1, 0, 0, 0, NULL, 0, NULL, 0, NULL, 0, 0, 0, {{0}}}
 #else
-#define SSS_CLI_MC_CTX_INITIALIZER {UNINITIALIZED, -1, 0, 0, 0, NULL, 0, NULL, 0, NULL, 0, 0}
+#define SSS_CLI_MC_CTX_INITIALIZER {UNINITIALIZED, -1, 0, 0, 0, NULL, 0, NULL, 0, NULL, 0, 0, 0, {{0}}}
 #endif
 
 errno_t sss_nss_mc_get_ctx(const char *name, struct sss_cli_mc_ctx *ctx);
+void sss_nss_mc_put_ctx(struct sss_cli_mc_ctx *ctx);
 errno_t sss_nss_check_header(struct sss_cli_mc_ctx *ctx);
 uint32_t sss_nss_mc_hash(struct sss_cli_mc_ctx *ctx,
                          const char *key, size_t len);
@@ -84,10 +99,13 @@ errno_t sss_nss_mc_get_record(struct sss_cli_mc_ctx *ctx,
                               uint32_t slot, struct sss_mc_rec **_rec);
 errno_t sss_nss_str_ptr_from_buffer(char **str, void **cookie,
                                     char *buf, size_t len);
-uint32_t sss_nss_mc_next_slot_with_hash(struct sss_mc_rec *rec,
-                                        uint32_t hash);
+uint32_t sss_nss_mc_next_slot(struct sss_cli_mc_ctx *ctx,
+                              uint32_t hash, uint32_t *_pos);
+errno_t sss_nss_mc_get_rep(const char *name, struct sss_cli_mc_ctx *ctx,
+                           const char *key, size_t key_len,
+                           uint8_t **_rep, size_t *_rep_len);
 
-/* passwd db */
+/* passwd db, ESRCH is returned if the user is cached as nonexistent */
 errno_t sss_nss_mc_getpwnam(const char *name, size_t name_len,
                             struct passwd *result,
                             char *buffer, size_t buflen);
@@ -114,4 +132,14 @@ errno_t sss_nss_mc_get_sid_by_uid(uint32_t id, char **sid, uint32_t *type);
 errno_t sss_nss_mc_get_sid_by_gid(uint32_t id, char **sid, uint32_t *type);
 errno_t sss_nss_mc_get_id_by_sid(const char *sid, uint32_t *id, uint32_t *type);
 
+/* netgroup db, returns the body of the SSS_NSS_SETNETGRENT reply */
+errno_t sss_nss_mc_setnetgrent(const char *name, size_t name_len,
+                               uint8_t **_rep, size_t *_rep_len);
+
+/* services db, return the body of the SSS_NSS_GETSERVBYNAME/PORT reply */
+errno_t sss_nss_mc_getservbyname(const char *name, const char *protocol,
+                                 uint8_t **_rep, size_t *_rep_len);
+errno_t sss_nss_mc_getservbyport(int port, const char *protocol,
+                                 uint8_t **_rep, size_t *_rep_len);
+
 #endif /* _NSS_MC_H_ */
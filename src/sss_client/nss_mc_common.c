@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stddef.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -30,6 +31,7 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include "nss_mc.h"
 #include "sss_cli.h"
 #include "shared/io.h"
@@ -69,15 +71,55 @@ static void sss_mt_unlock(struct sss_cli_mc_ctx *ctx)
 #endif
 }
 
+/* Returns the counter the calling thread accounts itself in, threads keep
+ * using the same one so that get and put always pair up. */
+static struct sss_cli_mc_shard *sss_nss_mc_shard(struct sss_cli_mc_ctx *ctx)
+{
+#ifdef HAVE_PTHREAD_EXT
+    static __thread unsigned int thread_shard;
+    static unsigned int next_shard;
+
+    if (thread_shard == 0) {
+        thread_shard = __sync_add_and_fetch(&next_shard, 1);
+    }
+    return &ctx->shards[thread_shard % SSS_CLI_MC_SHARDS];
+#else
+    return &ctx->shards[0];
+#endif
+}
+
+static uint32_t sss_nss_mc_active_threads(struct sss_cli_mc_ctx *ctx)
+{
+    uint32_t active = 0;
+    int i;
+
+    for (i = 0; i < SSS_CLI_MC_SHARDS; i++) {
+        active += __atomic_load_n(&ctx->shards[i].active_threads,
+                                  __ATOMIC_SEQ_CST);
+    }
+
+    return active;
+}
+
 static errno_t sss_nss_mc_validate(struct sss_cli_mc_ctx *ctx)
 {
     struct stat fdstat;
+    time_t now;
 
     /* No mc ctx initialized?*/
     if (ctx == NULL || ctx->fd < 0) {
         return EINVAL;
     }
 
+    /* fstat() makes all threads of the process bump the reference count of
+     * the same file, so the file is checked at most once per second. The
+     * responder marks the header as recycled before it replaces or removes
+     * the file, which is seen right away through the header. */
+    now = time(NULL);
+    if (__atomic_load_n(&ctx->validated, __ATOMIC_RELAXED) == now) {
+        return EOK;
+    }
+
     if (fstat(ctx->fd, &fdstat) == -1) {
         return EINVAL;
     }
@@ -98,9 +140,40 @@ static errno_t sss_nss_mc_validate(struct sss_cli_mc_ctx *ctx)
         return EINVAL;
     }
 
+    __atomic_store_n(&ctx->validated, now, __ATOMIC_RELAXED);
     return EOK;
 }
 
+/* The header barrier works as a sequence lock: it only changes when the
+ * responder rewrites the header, so as long as it still has the value seen
+ * by the last full check the layout stored in ctx is current and only the
+ * status has to be looked at. */
+static bool sss_nss_mc_header_unchanged(struct sss_cli_mc_ctx *ctx)
+{
+    struct sss_mc_header *h = (struct sss_mc_header *)ctx->mmap_base;
+    uint32_t epoch;
+    uint32_t status;
+    uint32_t b1;
+
+    epoch = __atomic_load_n(&ctx->epoch, __ATOMIC_ACQUIRE);
+    if (ctx->data_table == NULL || !MC_VALID_BARRIER(epoch)) {
+        return false;
+    }
+
+    b1 = h->b1;
+    if (b1 != epoch) {
+        return false;
+    }
+    __sync_synchronize();
+    status = h->status;
+    __sync_synchronize();
+    if (h->b2 != b1) {
+        return false;
+    }
+
+    return status == SSS_MC_HEADER_ALIVE;
+}
+
 errno_t sss_nss_check_header(struct sss_cli_mc_ctx *ctx)
 {
     struct sss_mc_header h;
@@ -113,6 +186,10 @@ errno_t sss_nss_check_header(struct sss_cli_mc_ctx *ctx)
         return ret;
     }
 
+    if (sss_nss_mc_header_unchanged(ctx)) {
+        return 0;
+    }
+
     /* retry barrier protected reading max 5 times then give up */
     for (count = 5; count > 0; count--) {
         MEMCPY_WITH_BARRIERS(copy_ok, &h,
@@ -151,11 +228,13 @@ errno_t sss_nss_check_header(struct sss_cli_mc_ctx *ctx)
         }
     }
 
+    __atomic_store_n(&ctx->epoch, h.b1, __ATOMIC_RELEASE);
     return 0;
 }
 
 static void sss_nss_mc_destroy_ctx(struct sss_cli_mc_ctx *ctx)
 {
+    struct stat fdstat;
 
     if ((ctx->mmap_base != NULL) && (ctx->mmap_size != 0)) {
         munmap(ctx->mmap_base, ctx->mmap_size);
@@ -163,7 +242,13 @@ static void sss_nss_mc_destroy_ctx(struct sss_cli_mc_ctx *ctx)
     ctx->mmap_base = NULL;
     ctx->mmap_size = 0;
 
-    if (ctx->fd != -1) {
+    /* sss_nss_mc_validate() skips the check for a hijacked FD when the
+     * file was checked within the last second, so check it again to not
+     * close an FD the application opened in the meantime */
+    if (ctx->fd != -1
+            && fstat(ctx->fd, &fdstat) == 0
+            && fdstat.st_dev == ctx->fd_device
+            && fdstat.st_ino == ctx->fd_inode) {
         close(ctx->fd);
     }
     ctx->fd = -1;
@@ -175,8 +260,10 @@ static void sss_nss_mc_destroy_ctx(struct sss_cli_mc_ctx *ctx)
     ctx->dt_size = 0;
     ctx->hash_table = NULL;
     ctx->ht_size = 0;
+    ctx->epoch = 0;
+    ctx->validated = 0;
     ctx->initialized = UNINITIALIZED;
-    /* `mutex` and `active_threads` should be left intact */
+    /* `mutex` and `shards` should be left intact */
 }
 
 static errno_t sss_nss_mc_init_ctx(const char *name,
@@ -231,7 +318,7 @@ static errno_t sss_nss_mc_init_ctx(const char *name,
         goto done;
     }
 
-    ctx->initialized = INITIALIZED;
+    __atomic_store_n(&ctx->initialized, INITIALIZED, __ATOMIC_RELEASE);
 
     ret = 0;
 
@@ -248,28 +335,26 @@ done:
 errno_t sss_nss_mc_get_ctx(const char *name, struct sss_cli_mc_ctx *ctx)
 {
     char *envval;
+    struct sss_cli_mc_shard *shard;
     int ret;
-    bool need_decrement = false;
 
     envval = getenv("SSS_NSS_USE_MEMCACHE");
     if (envval && strcasecmp(envval, "NO") == 0) {
         return EPERM;
     }
 
-    switch (ctx->initialized) {
+    /* Account for this thread before looking at the state; a thread which
+     * recycles the context changes the state before it counts the active
+     * threads, so either it sees us or we see the recycled state. */
+    shard = sss_nss_mc_shard(ctx);
+    __sync_add_and_fetch(&shard->active_threads, 1);
+
+    switch (__atomic_load_n(&ctx->initialized, __ATOMIC_SEQ_CST)) {
     case UNINITIALIZED:
-        __sync_add_and_fetch(&ctx->active_threads, 1);
         ret = sss_nss_mc_init_ctx(name, ctx);
-        if (ret) {
-            need_decrement = true;
-        }
         break;
     case INITIALIZED:
-        __sync_add_and_fetch(&ctx->active_threads, 1);
         ret = sss_nss_check_header(ctx);
-        if (ret) {
-            need_decrement = true;
-        }
         break;
     case RECYCLED:
         /* we need to safely destroy memory cache */
@@ -281,28 +366,37 @@ errno_t sss_nss_mc_get_ctx(const char *name, struct sss_cli_mc_ctx *ctx)
 
     if (ret) {
         if (ctx->initialized == INITIALIZED) {
-            ctx->initialized = RECYCLED;
+            __atomic_store_n(&ctx->initialized, RECYCLED, __ATOMIC_SEQ_CST);
         }
-        if (ctx->initialized == RECYCLED && ctx->active_threads == 0) {
+
+        /* In case of error, we will not touch mmapped area => decrement */
+        __sync_sub_and_fetch(&shard->active_threads, 1);
+
+        if (ctx->initialized == RECYCLED
+                && sss_nss_mc_active_threads(ctx) == 0) {
             /* just one thread should call munmap */
             sss_mt_lock(ctx);
-            if (ctx->initialized == RECYCLED) {
+            if (ctx->initialized == RECYCLED
+                    && sss_nss_mc_active_threads(ctx) == 0) {
                 sss_nss_mc_destroy_ctx(ctx);
             }
             sss_mt_unlock(ctx);
         }
-        if (need_decrement) {
-            /* In case of error, we will not touch mmapped area => decrement */
-            __sync_sub_and_fetch(&ctx->active_threads, 1);
-        }
     }
     return ret;
 }
 
+/* Must be called once the records returned through a context acquired by
+ * sss_nss_mc_get_ctx() are not accessed anymore */
+void sss_nss_mc_put_ctx(struct sss_cli_mc_ctx *ctx)
+{
+    __sync_sub_and_fetch(&sss_nss_mc_shard(ctx)->active_threads, 1);
+}
+
 uint32_t sss_nss_mc_hash(struct sss_cli_mc_ctx *ctx,
                          const char *key, size_t len)
 {
-    return murmurhash3(key, len, ctx->seed) % MC_HT_ELEMS(ctx->ht_size);
+    return sss_mc_key_hash(key, len, ctx->seed);
 }
 
 errno_t sss_nss_mc_get_record(struct sss_cli_mc_ctx *ctx,
@@ -419,16 +513,106 @@ errno_t sss_nss_str_ptr_from_buffer(char **str, void **cookie,
     return 0;
 }
 
-uint32_t sss_nss_mc_next_slot_with_hash(struct sss_mc_rec *rec,
-                                        uint32_t hash)
+/*
+ * returns the slot of the next record whose key may match hash.
+ *
+ * Call first time with *_pos set to 0, MC_INVALID_VAL is returned once all
+ * candidates were returned.
+ */
+uint32_t sss_nss_mc_next_slot(struct sss_cli_mc_ctx *ctx,
+                              uint32_t hash, uint32_t *_pos)
+{
+    return sss_mc_ht_next_slot(ctx->hash_table, ctx->ht_size, hash, _pos);
+}
+
+/*
+ * looks up a record holding a cached responder reply, see
+ * struct sss_mc_rep_data, and returns a copy of the reply body which
+ * the caller must free.
+ */
+errno_t sss_nss_mc_get_rep(const char *name, struct sss_cli_mc_ctx *ctx,
+                           const char *key, size_t key_len,
+                           uint8_t **_rep, size_t *_rep_len)
 {
-    if (rec->hash1 == hash) {
-        return rec->next1;
-    } else if (rec->hash2 == hash) {
-        return rec->next2;
-    } else {
-        /* it should never happen. */
-        return MC_INVALID_VAL;
+    struct sss_mc_rec *rec = NULL;
+    struct sss_mc_rep_data *data;
+    const size_t strs_offset = offsetof(struct sss_mc_rep_data, strs);
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t pos;
+    uint8_t *rep;
+    int ret;
+
+    ret = sss_nss_mc_get_ctx(name, ctx);
+    if (ret) {
+        return ret;
+    }
+
+    /* hashes are calculated including the NULL terminator */
+    hash = sss_nss_mc_hash(ctx, key, key_len + 1);
+    pos = 0;
+    slot = sss_nss_mc_next_slot(ctx, hash, &pos);
+
+    while (MC_SLOT_WITHIN_BOUNDS(slot, ctx->dt_size)) {
+        /* free record from previous iteration */
+        free(rec);
+        rec = NULL;
+
+        ret = sss_nss_mc_get_record(ctx, slot, &rec);
+        if (ret) {
+            goto done;
+        }
+
+        /* check record matches what we are searching for */
+        if (hash != rec->hash1) {
+            slot = sss_nss_mc_next_slot(ctx, hash, &pos);
+            continue;
+        }
+
+        data = (struct sss_mc_rep_data *)rec->data;
+        /* Integrity check
+         * - data->name must point to the start of strs
+         * - all strings and the reply must be within copy of record */
+        if (data->name != strs_offset
+            || sizeof(struct sss_mc_rec) + strs_offset + data->strs_len
+                    > rec->len
+            || data->rep_len >= data->strs_len) {
+            ret = ENOENT;
+            goto done;
+        }
+
+        if (data->strs_len - data->rep_len == key_len + 1
+                && memcmp(key, data->strs, key_len + 1) == 0) {
+            break;
+        }
+
+        slot = sss_nss_mc_next_slot(ctx, hash, &pos);
+    }
+
+    if (!MC_SLOT_WITHIN_BOUNDS(slot, ctx->dt_size)) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    if (rec->expire < time(NULL)) {
+        /* entry is now invalid */
+        ret = EINVAL;
+        goto done;
+    }
+
+    rep = malloc(data->rep_len);
+    if (rep == NULL) {
+        ret = ENOMEM;
+        goto done;
     }
+    memcpy(rep, data->strs + key_len + 1, data->rep_len);
+
+    *_rep = rep;
+    *_rep_len = data->rep_len;
+    ret = 0;
 
+done:
+    free(rec);
+    sss_nss_mc_put_ctx(ctx);
+    return ret;
 }
@@ -115,6 +115,7 @@ errno_t sss_nss_mc_getgrnam(const char *name, size_t name_len,
     char *rec_name;
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos;
     int ret;
     const size_t strs_offset = offsetof(struct sss_mc_grp_data, strs);
     size_t data_size;
@@ -129,7 +130,8 @@ errno_t sss_nss_mc_getgrnam(const char *name, size_t name_len,
 
     /* hashes are calculated including the NULL terminator */
     hash = sss_nss_mc_hash(&gr_mc_ctx, name, name_len + 1);
-    slot = gr_mc_ctx.hash_table[hash];
+    pos = 0;
+    slot = sss_nss_mc_next_slot(&gr_mc_ctx, hash, &pos);
 
     /* If slot is not within the bounds of mmapped region and
      * it's value is not MC_INVALID_VAL, then the cache is
@@ -147,7 +149,7 @@ errno_t sss_nss_mc_getgrnam(const char *name, size_t name_len,
         /* check record matches what we are searching for */
         if (hash != rec->hash1) {
             /* if name hash does not match we can skip this immediately */
-            slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+            slot = sss_nss_mc_next_slot(&gr_mc_ctx, hash, &pos);
             continue;
         }
 
@@ -168,7 +170,7 @@ errno_t sss_nss_mc_getgrnam(const char *name, size_t name_len,
             break;
         }
 
-        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_nss_mc_next_slot(&gr_mc_ctx, hash, &pos);
     }
 
     if (!MC_SLOT_WITHIN_BOUNDS(slot, data_size)) {
@@ -180,7 +182,7 @@ errno_t sss_nss_mc_getgrnam(const char *name, size_t name_len,
 
 done:
     free(rec);
-    __sync_sub_and_fetch(&gr_mc_ctx.active_threads, 1);
+    sss_nss_mc_put_ctx(&gr_mc_ctx);
     return ret;
 }
 
@@ -193,6 +195,7 @@ errno_t sss_nss_mc_getgrgid(gid_t gid,
     char gidstr[11];
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos;
     int len;
     int ret;
 
@@ -209,7 +212,8 @@ errno_t sss_nss_mc_getgrgid(gid_t gid,
 
     /* hashes are calculated including the NULL terminator */
     hash = sss_nss_mc_hash(&gr_mc_ctx, gidstr, len+1);
-    slot = gr_mc_ctx.hash_table[hash];
+    pos = 0;
+    slot = sss_nss_mc_next_slot(&gr_mc_ctx, hash, &pos);
 
     /* If slot is not within the bounds of mmapped region and
      * it's value is not MC_INVALID_VAL, then the cache is
@@ -227,7 +231,7 @@ errno_t sss_nss_mc_getgrgid(gid_t gid,
         /* check record matches what we are searching for */
         if (hash != rec->hash2) {
             /* if uid hash does not match we can skip this immediately */
-            slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+            slot = sss_nss_mc_next_slot(&gr_mc_ctx, hash, &pos);
             continue;
         }
 
@@ -236,7 +240,7 @@ errno_t sss_nss_mc_getgrgid(gid_t gid,
             break;
         }
 
-        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_nss_mc_next_slot(&gr_mc_ctx, hash, &pos);
     }
 
     if (!MC_SLOT_WITHIN_BOUNDS(slot, gr_mc_ctx.dt_size)) {
@@ -248,7 +252,7 @@ errno_t sss_nss_mc_getgrgid(gid_t gid,
 
 done:
     free(rec);
-    __sync_sub_and_fetch(&gr_mc_ctx.active_threads, 1);
+    sss_nss_mc_put_ctx(&gr_mc_ctx);
     return ret;
 }
 
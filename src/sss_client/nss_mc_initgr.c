@@ -96,6 +96,7 @@ errno_t sss_nss_mc_initgroups_dyn(const char *name, size_t name_len,
     char *rec_name;
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos;
     int ret;
     const size_t data_offset = offsetof(struct sss_mc_initgr_data, gids);
     size_t data_size;
@@ -110,7 +111,8 @@ errno_t sss_nss_mc_initgroups_dyn(const char *name, size_t name_len,
 
     /* hashes are calculated including the NULL terminator */
     hash = sss_nss_mc_hash(&initgr_mc_ctx, name, name_len + 1);
-    slot = initgr_mc_ctx.hash_table[hash];
+    pos = 0;
+    slot = sss_nss_mc_next_slot(&initgr_mc_ctx, hash, &pos);
 
     /* If slot is not within the bounds of mmapped region and
      * it's value is not MC_INVALID_VAL, then the cache is
@@ -128,7 +130,7 @@ errno_t sss_nss_mc_initgroups_dyn(const char *name, size_t name_len,
         /* check record matches what we are searching for */
         if (hash != rec->hash1) {
             /* if name hash does not match we can skip this immediately */
-            slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+            slot = sss_nss_mc_next_slot(&initgr_mc_ctx, hash, &pos);
             continue;
         }
 
@@ -151,7 +153,7 @@ errno_t sss_nss_mc_initgroups_dyn(const char *name, size_t name_len,
             break;
         }
 
-        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_nss_mc_next_slot(&initgr_mc_ctx, hash, &pos);
     }
 
     if (!MC_SLOT_WITHIN_BOUNDS(slot, data_size)) {
@@ -163,6 +165,6 @@ errno_t sss_nss_mc_initgroups_dyn(const char *name, size_t name_len,
 
 done:
     free(rec);
-    __sync_sub_and_fetch(&initgr_mc_ctx.active_threads, 1);
+    sss_nss_mc_put_ctx(&initgr_mc_ctx);
     return ret;
 }
@@ -0,0 +1,39 @@
+/*
+ * System Security Services Daemon. NSS client interface
+ *
+ * Copyright (C) 2026 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* NETGROUP database NSS interface using mmap cache */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "nss_mc.h"
+
+#if HAVE_PTHREAD
+static pthread_mutex_t netgr_mc_ctx_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct sss_cli_mc_ctx netgr_mc_ctx = SSS_CLI_MC_CTX_INITIALIZER(&netgr_mc_ctx_mutex);
+#else
+static struct sss_cli_mc_ctx netgr_mc_ctx = SSS_CLI_MC_CTX_INITIALIZER;
+#endif
+
+errno_t sss_nss_mc_setnetgrent(const char *name, size_t name_len,
+                               uint8_t **_rep, size_t *_rep_len)
+{
+    return sss_nss_mc_get_rep("netgroup", &netgr_mc_ctx, name, name_len,
+                              _rep, _rep_len);
+}
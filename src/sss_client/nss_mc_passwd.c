@@ -51,6 +51,10 @@ static errno_t sss_nss_mc_parse_result(struct sss_mc_rec *rec,
         return EINVAL;
     }
 
+    if (rec->flags & MC_REC_NEGATIVE) {
+        return ESRCH;
+    }
+
     data = (struct sss_mc_pwd_data *)rec->data;
 
     if (data->strs_len > buflen) {
@@ -108,6 +112,7 @@ errno_t sss_nss_mc_getpwnam(const char *name, size_t name_len,
     char *rec_name;
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos;
     int ret;
     const size_t strs_offset = offsetof(struct sss_mc_pwd_data, strs);
     size_t data_size;
@@ -122,7 +127,8 @@ errno_t sss_nss_mc_getpwnam(const char *name, size_t name_len,
 
     /* hashes are calculated including the NULL terminator */
     hash = sss_nss_mc_hash(&pw_mc_ctx, name, name_len + 1);
-    slot = pw_mc_ctx.hash_table[hash];
+    pos = 0;
+    slot = sss_nss_mc_next_slot(&pw_mc_ctx, hash, &pos);
 
     /* If slot is not within the bounds of mmapped region and
      * it's value is not MC_INVALID_VAL, then the cache is
@@ -140,7 +146,7 @@ errno_t sss_nss_mc_getpwnam(const char *name, size_t name_len,
         /* check record matches what we are searching for */
         if (hash != rec->hash1) {
             /* if name hash does not match we can skip this immediately */
-            slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+            slot = sss_nss_mc_next_slot(&pw_mc_ctx, hash, &pos);
             continue;
         }
 
@@ -161,7 +167,7 @@ errno_t sss_nss_mc_getpwnam(const char *name, size_t name_len,
             break;
         }
 
-        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_nss_mc_next_slot(&pw_mc_ctx, hash, &pos);
     }
 
     if (!MC_SLOT_WITHIN_BOUNDS(slot, data_size)) {
@@ -173,7 +179,7 @@ errno_t sss_nss_mc_getpwnam(const char *name, size_t name_len,
 
 done:
     free(rec);
-    __sync_sub_and_fetch(&pw_mc_ctx.active_threads, 1);
+    sss_nss_mc_put_ctx(&pw_mc_ctx);
     return ret;
 }
 
@@ -186,6 +192,7 @@ errno_t sss_nss_mc_getpwuid(uid_t uid,
     char uidstr[11];
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos;
     int len;
     int ret;
 
@@ -202,7 +209,8 @@ errno_t sss_nss_mc_getpwuid(uid_t uid,
 
     /* hashes are calculated including the NULL terminator */
     hash = sss_nss_mc_hash(&pw_mc_ctx, uidstr, len+1);
-    slot = pw_mc_ctx.hash_table[hash];
+    pos = 0;
+    slot = sss_nss_mc_next_slot(&pw_mc_ctx, hash, &pos);
 
     /* If slot is not within the bounds of mmapped region and
      * it's value is not MC_INVALID_VAL, then the cache is
@@ -220,7 +228,7 @@ errno_t sss_nss_mc_getpwuid(uid_t uid,
         /* check record matches what we are searching for */
         if (hash != rec->hash2) {
             /* if uid hash does not match we can skip this immediately */
-            slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+            slot = sss_nss_mc_next_slot(&pw_mc_ctx, hash, &pos);
             continue;
         }
 
@@ -229,7 +237,7 @@ errno_t sss_nss_mc_getpwuid(uid_t uid,
             break;
         }
 
-        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_nss_mc_next_slot(&pw_mc_ctx, hash, &pos);
     }
 
     if (!MC_SLOT_WITHIN_BOUNDS(slot, pw_mc_ctx.dt_size)) {
@@ -241,7 +249,7 @@ errno_t sss_nss_mc_getpwuid(uid_t uid,
 
 done:
     free(rec);
-    __sync_sub_and_fetch(&pw_mc_ctx.active_threads, 1);
+    sss_nss_mc_put_ctx(&pw_mc_ctx);
     return ret;
 }
 
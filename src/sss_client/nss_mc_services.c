@@ -0,0 +1,73 @@
+/*
+ * System Security Services Daemon. NSS client interface
+ *
+ * Copyright (C) 2026 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* SERVICES database NSS interface using mmap cache */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include "nss_mc.h"
+#include "sss_cli.h"
+
+#if HAVE_PTHREAD
+static pthread_mutex_t svc_mc_ctx_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct sss_cli_mc_ctx svc_mc_ctx = SSS_CLI_MC_CTX_INITIALIZER(&svc_mc_ctx_mutex);
+#else
+static struct sss_cli_mc_ctx svc_mc_ctx = SSS_CLI_MC_CTX_INITIALIZER;
+#endif
+
+errno_t sss_nss_mc_getservbyname(const char *name, const char *protocol,
+                                 uint8_t **_rep, size_t *_rep_len)
+{
+    char key[SSS_NAME_MAX * 2 + 2];
+    int key_len;
+
+    /* keys are built the same way the responder stores them, see
+     * struct sss_mc_rep_data */
+    key_len = snprintf(key, sizeof(key), "%s/%s",
+                       name, protocol == NULL ? "" : protocol);
+
+    if (key_len < 0 || key_len >= sizeof(key)) {
+        return EINVAL;
+    }
+
+    return sss_nss_mc_get_rep("services", &svc_mc_ctx, key, key_len,
+                              _rep, _rep_len);
+}
+
+errno_t sss_nss_mc_getservbyport(int port, const char *protocol,
+                                 uint8_t **_rep, size_t *_rep_len)
+{
+    char key[SSS_NAME_MAX + 8];
+    int key_len;
+
+    /* port is passed in network byte order */
+    key_len = snprintf(key, sizeof(key), "%u/%s",
+                       (unsigned int)ntohs((uint16_t)port),
+                       protocol == NULL ? "" : protocol);
+
+    if (key_len < 0 || key_len >= sizeof(key)) {
+        return EINVAL;
+    }
+
+    return sss_nss_mc_get_rep("services", &svc_mc_ctx, key, key_len,
+                              _rep, _rep_len);
+}
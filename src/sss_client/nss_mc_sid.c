@@ -46,6 +46,7 @@ static errno_t mc_get_sid_by_typed_id(uint32_t id, enum sss_id_type object_type,
     int key_len;
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos;
     struct sss_mc_rec *rec = NULL;
     const struct sss_mc_sid_data *data = NULL;
 
@@ -60,7 +61,8 @@ static errno_t mc_get_sid_by_typed_id(uint32_t id, enum sss_id_type object_type,
     }
 
     hash = sss_nss_mc_hash(&sid_mc_ctx, key, key_len + 1);
-    slot = sid_mc_ctx.hash_table[hash];
+    pos = 0;
+    slot = sss_nss_mc_next_slot(&sid_mc_ctx, hash, &pos);
 
     while (MC_SLOT_WITHIN_BOUNDS(slot, sid_mc_ctx.dt_size)) {
         free(rec); /* free record from previous iteration */
@@ -92,14 +94,14 @@ static errno_t mc_get_sid_by_typed_id(uint32_t id, enum sss_id_type object_type,
             goto done;
         }
 
-        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_nss_mc_next_slot(&sid_mc_ctx, hash, &pos);
     }
 
     ret = ENOENT;
 
 done:
     free(rec);
-    __sync_sub_and_fetch(&sid_mc_ctx.active_threads, 1);
+    sss_nss_mc_put_ctx(&sid_mc_ctx);
     return ret;
 }
 
@@ -149,6 +151,7 @@ errno_t sss_nss_mc_get_id_by_sid(const char *sid, uint32_t *id, uint32_t *type)
     int key_len;
     uint32_t hash;
     uint32_t slot;
+    uint32_t pos;
     struct sss_mc_rec *rec = NULL;
     const struct sss_mc_sid_data *data = NULL;
 
@@ -160,7 +163,8 @@ errno_t sss_nss_mc_get_id_by_sid(const char *sid, uint32_t *id, uint32_t *type)
     }
 
     hash = sss_nss_mc_hash(&sid_mc_ctx, sid, key_len);
-    slot = sid_mc_ctx.hash_table[hash];
+    pos = 0;
+    slot = sss_nss_mc_next_slot(&sid_mc_ctx, hash, &pos);
 
     while (MC_SLOT_WITHIN_BOUNDS(slot, sid_mc_ctx.dt_size)) {
         free(rec); /* free record from previous iteration */
@@ -186,13 +190,13 @@ errno_t sss_nss_mc_get_id_by_sid(const char *sid, uint32_t *id, uint32_t *type)
             goto done; /* ret == 0 */
         }
 
-        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+        slot = sss_nss_mc_next_slot(&sid_mc_ctx, hash, &pos);
     }
 
     ret = ENOENT;
 
 done:
     free(rec);
-    __sync_sub_and_fetch(&sid_mc_ctx.active_threads, 1);
+    sss_nss_mc_put_ctx(&sid_mc_ctx);
     return ret;
 }
@@ -32,6 +32,7 @@
 #include <string.h>
 #include "sss_cli.h"
 #include "nss_compat.h"
+#include "nss_mc.h"
 
 #define CLEAR_NETGRENT_DATA(netgrent) do { \
         free(netgrent->data); \
@@ -155,12 +156,33 @@ static int sss_nss_getnetgr_readrep(struct sss_nss_netgr_rep *pr,
     return 0;
 }
 
+static enum nss_status sss_nss_setnetgrent_rep(struct __netgrent *result,
+                                               uint8_t *repbuf, size_t replen)
+{
+    uint32_t num_results;
+
+    /* Get number of results from repbuf */
+    SAFEALIGN_COPY_UINT32(&num_results, repbuf, NULL);
+
+    /* no results if not found */
+    if ((num_results == 0) || (replen < NETGR_METADATA_COUNT)) {
+        free(repbuf);
+        return NSS_STATUS_NOTFOUND;
+    }
+
+    result->data = (char *) repbuf;
+    result->data_size = replen;
+    /* skip metadata fields */
+    result->idx.position = NETGR_METADATA_COUNT;
+
+    return NSS_STATUS_SUCCESS;
+}
+
 enum nss_status _nss_sss_setnetgrent(const char *netgroup,
                      struct __netgrent *result)
 {
     uint8_t *repbuf = NULL;
     size_t replen;
-    uint32_t num_results;
     enum nss_status nret;
     struct sss_cli_req_data rd;
     int errnop;
@@ -170,17 +192,23 @@ enum nss_status _nss_sss_setnetgrent(const char *netgroup,
 
     if (!netgroup) return NSS_STATUS_NOTFOUND;
 
-    sss_nss_lock();
+    ret = sss_strnlen(netgroup, SSS_NAME_MAX, &name_len);
+    if (ret != 0) {
+        return NSS_STATUS_NOTFOUND;
+    }
 
     /* make sure we do not have leftovers, and release memory */
     CLEAR_NETGRENT_DATA(result);
 
-    ret = sss_strnlen(netgroup, SSS_NAME_MAX, &name_len);
-    if (ret != 0) {
-        nret = NSS_STATUS_NOTFOUND;
-        goto out;
+    /* the whole netgroup may be in the mmap cache already, if using it
+     * fails fall back to socket based comms */
+    ret = sss_nss_mc_setnetgrent(netgroup, name_len, &repbuf, &replen);
+    if (ret == 0) {
+        return sss_nss_setnetgrent_rep(result, repbuf, replen);
     }
 
+    sss_nss_lock();
+
     name = malloc(sizeof(char)*name_len + 1);
     if (name == NULL) {
         nret = NSS_STATUS_TRYAGAIN;
@@ -199,22 +227,7 @@ enum nss_status _nss_sss_setnetgrent(const char *netgroup,
         goto out;
     }
 
-    /* Get number of results from repbuf */
-    SAFEALIGN_COPY_UINT32(&num_results, repbuf, NULL);
-
-    /* no results if not found */
-    if ((num_results == 0) || (replen < NETGR_METADATA_COUNT)) {
-        free(repbuf);
-        nret = NSS_STATUS_NOTFOUND;
-        goto out;
-    }
-
-    result->data = (char *) repbuf;
-    result->data_size = replen;
-    /* skip metadata fields */
-    result->idx.position = NETGR_METADATA_COUNT;
-
-    nret = NSS_STATUS_SUCCESS;
+    nret = sss_nss_setnetgrent_rep(result, repbuf, replen);
 
 out:
     sss_nss_unlock();
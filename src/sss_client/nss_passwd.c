@@ -172,6 +172,9 @@ enum nss_status _nss_sss_getpwnam_r(const char *name, struct passwd *result,
     case ERANGE:
         *errnop = ERANGE;
         return NSS_STATUS_TRYAGAIN;
+    case ESRCH:
+        *errnop = 0;
+        return NSS_STATUS_NOTFOUND;
     case ENOENT:
         /* fall through, we need to actively ask the parent
          * if no entry is found */
@@ -198,6 +201,10 @@ enum nss_status _nss_sss_getpwnam_r(const char *name, struct passwd *result,
         *errnop = ERANGE;
         nret = NSS_STATUS_TRYAGAIN;
         goto out;
+    case ESRCH:
+        *errnop = 0;
+        nret = NSS_STATUS_NOTFOUND;
+        goto out;
     case ENOENT:
         /* fall through, we need to actively ask the parent
          * if no entry is found */
@@ -278,6 +285,9 @@ enum nss_status _nss_sss_getpwuid_r(uid_t uid, struct passwd *result,
     case ERANGE:
         *errnop = ERANGE;
         return NSS_STATUS_TRYAGAIN;
+    case ESRCH:
+        *errnop = 0;
+        return NSS_STATUS_NOTFOUND;
     case ENOENT:
         /* fall through, we need to actively ask the parent
          * if no entry is found */
@@ -305,6 +315,10 @@ enum nss_status _nss_sss_getpwuid_r(uid_t uid, struct passwd *result,
         *errnop = ERANGE;
         nret = NSS_STATUS_TRYAGAIN;
         goto out;
+    case ESRCH:
+        *errnop = 0;
+        nret = NSS_STATUS_NOTFOUND;
+        goto out;
     case ENOENT:
         /* fall through, we need to actively ask the parent
          * if no entry is found */
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "sss_cli.h"
+#include "nss_mc.h"
 
 static
 #ifdef HAVE_PTHREAD_EXT
@@ -164,6 +165,46 @@ sss_nss_getsvc_readrep(struct sss_nss_svc_rep *sr,
     return EOK;
 }
 
+/* Fills result from a reply found in the mmap cache, repbuf is freed */
+static enum nss_status
+sss_nss_getsvc_mc_rep(struct servent *result,
+                      char *buffer, size_t buflen,
+                      int *errnop,
+                      uint8_t *repbuf, size_t replen)
+{
+    struct sss_nss_svc_rep svcrep;
+    uint32_t num_results = 0;
+    size_t len;
+    int ret;
+
+    if (replen >= SVC_METADATA_COUNT) {
+        SAFEALIGN_COPY_UINT32(&num_results, repbuf, NULL);
+    }
+
+    /* only 1 result is stored by the responder */
+    if (num_results != 1) {
+        free(repbuf);
+        *errnop = EBADMSG;
+        return NSS_STATUS_TRYAGAIN;
+    }
+
+    svcrep.result = result;
+    svcrep.buffer = buffer;
+    svcrep.buflen = buflen;
+
+    len = replen - SVC_METADATA_COUNT;
+    ret = sss_nss_getsvc_readrep(&svcrep,
+                                 repbuf + SVC_METADATA_COUNT,
+                                 &len);
+    free(repbuf);
+    if (ret) {
+        *errnop = ret;
+        return NSS_STATUS_TRYAGAIN;
+    }
+
+    return NSS_STATUS_SUCCESS;
+}
+
 enum nss_status
 _nss_sss_getservbyname_r(const char *name,
                          const char *protocol,
@@ -202,6 +243,12 @@ _nss_sss_getservbyname_r(const char *name,
         }
     }
 
+    ret = sss_nss_mc_getservbyname(name, protocol, &repbuf, &replen);
+    if (ret == 0) {
+        return sss_nss_getsvc_mc_rep(result, buffer, buflen, errnop,
+                                     repbuf, replen);
+    }
+
     rd.len = name_len + proto_len + 2;
     data = malloc(sizeof(uint8_t)*rd.len);
     if (data == NULL) {
@@ -300,6 +347,12 @@ _nss_sss_getservbyport_r(int port, const char *protocol,
         }
     }
 
+    ret = sss_nss_mc_getservbyport(port, protocol, &repbuf, &replen);
+    if (ret == 0) {
+        return sss_nss_getsvc_mc_rep(result, buffer, buflen, errnop,
+                                     repbuf, replen);
+    }
+
     rd.len = sizeof(uint32_t)*2 + proto_len + 1;
     data = malloc(sizeof(uint8_t)*rd.len);
     if (data == NULL) {
@@ -52,6 +52,13 @@ typedef int errno_t;
 #define SSS_SSH_PROTOCOL_VERSION 0
 #define SSS_PAC_PROTOCOL_VERSION 1
 
+/* Features a client can ask for with a second 32bit value in the
+ * SSS_GET_VERSION request. The reply then carries the features enabled
+ * for the connection as a second 32bit value. */
+#define SSS_CLI_FEATURE_PIPELINE 0x00000001 /* requests carry an id in the
+                                             * last header field and may be
+                                             * answered in any order */
+
 #ifdef LOGIN_NAME_MAX
 #define SSS_NAME_MAX LOGIN_NAME_MAX
 #else
@@ -82,6 +89,10 @@ enum sss_cli_command {
 
     SSS_NSS_GETPWNAM_EX    = 0x0019,
     SSS_NSS_GETPWUID_EX    = 0x001A,
+    SSS_NSS_GETPWUID_MULTI = 0x001B, /**< Takes 32bit flags, the 32bit number
+                                      * of UIDs and the UIDs, returns the
+                                      * SSS_NSS_GETPWUID_EX reply of each UID,
+                                      * see SSS_NSS_MULTI_MAX_KEYS */
 
 /* group */
 
@@ -94,6 +105,12 @@ enum sss_cli_command {
 
     SSS_NSS_GETGRNAM_EX    = 0x0029,
     SSS_NSS_GETGRGID_EX    = 0x002A,
+    SSS_NSS_GETGRGID_MULTI = 0x002B, /**< Same as SSS_NSS_GETPWUID_MULTI for
+                                      * GIDs */
+    SSS_NSS_GETGRMEMBERS   = 0x002C, /**< Returns the next members of the
+                                      * group of the previous
+                                      * SSS_NSS_GETGR*_EX request, see
+                                      * SSS_NSS_GR_MORE_MEMBERS */
     SSS_NSS_INITGR_EX      = 0x002E,
 
 #if 0
@@ -427,6 +444,18 @@ enum pam_item_type {
 #define PAM_CLI_FLAGS_REQUIRE_CERT_AUTH (1 << 9)
 
 #define SSS_NSS_MAX_ENTRIES 256
+/* The reply of the *_MULTI commands starts with the number of keys and a
+ * reserved 32bit field, followed for each key in request order by a 32bit
+ * errno value, the 32bit length of the single key reply and the reply. */
+#define SSS_NSS_MULTI_MAX_KEYS 128
+/* Internal flag of the SSS_NSS_GETGR*_EX requests, not part of the public
+ * SSS_NSS_EX_FLAG_* flags. It allows the responder to send only the first
+ * members of a large group. In this case SSS_NSS_GR_MORE_MEMBERS is set in
+ * the reserved field of the reply and the remaining members are returned
+ * by SSS_NSS_GETGRMEMBERS on the same connection. Its reply contains the
+ * 32bit number of members, 32bit flags and the member names. */
+#define SSS_NSS_EX_FLAG_STREAM_MEMBERS (1 << 16)
+#define SSS_NSS_GR_MORE_MEMBERS 0x00000001
 #define SSS_NSS_HEADER_SIZE (sizeof(uint32_t) * 4)
 struct sss_cli_req_data {
     size_t len;
@@ -108,6 +108,108 @@ sbus_method_in__out__recv
     return EOK;
 }
 
+struct sbus_method_in__out_asat_state {
+    struct _sbus_sss_invoker_args_asat *out;
+};
+
+static void sbus_method_in__out_asat_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+sbus_method_in__out_asat_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     sbus_invoker_keygen keygen,
+     const char *bus,
+     const char *path,
+     const char *iface,
+     const char *method)
+{
+    struct sbus_method_in__out_asat_state *state;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sbus_method_in__out_asat_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create tevent request!\n");
+        return NULL;
+    }
+
+    state->out = talloc_zero(state, struct _sbus_sss_invoker_args_asat);
+    if (state->out == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to allocate space for output parameters!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+
+    subreq = sbus_call_method_send(state, conn, NULL, keygen, NULL,
+                                   bus, path, iface, method, NULL);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, sbus_method_in__out_asat_done, req);
+
+    ret = EAGAIN;
+
+done:
+    if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, conn->ev);
+    }
+
+    return req;
+}
+
+static void sbus_method_in__out_asat_done(struct tevent_req *subreq)
+{
+    struct sbus_method_in__out_asat_state *state;
+    struct tevent_req *req;
+    DBusMessage *reply;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sbus_method_in__out_asat_state);
+
+    ret = sbus_call_method_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = sbus_read_output(state->out, reply, (sbus_invoker_reader_fn)_sbus_sss_invoker_read_asat, state->out);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+    return;
+}
+
+static errno_t
+sbus_method_in__out_asat_recv
+    (TALLOC_CTX *mem_ctx,
+     struct tevent_req *req,
+     const char *** _arg0,
+     uint64_t ** _arg1)
+{
+    struct sbus_method_in__out_asat_state *state;
+    state = tevent_req_data(req, struct sbus_method_in__out_asat_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_arg0 = talloc_steal(mem_ctx, state->out->arg0);
+    *_arg1 = talloc_steal(mem_ctx, state->out->arg1);
+
+    return EOK;
+}
+
 struct sbus_method_in_pam_data_out_pam_response_state {
     struct _sbus_sss_invoker_args_pam_data in;
     struct _sbus_sss_invoker_args_pam_response *out;
@@ -1956,6 +2058,45 @@ sbus_call_proxy_client_Register_recv
     return sbus_method_in_u_out__recv(req);
 }
 
+struct tevent_req *
+sbus_call_resp_stats_Get_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path)
+{
+    return sbus_method_in__out_asat_send(mem_ctx, conn, NULL,
+        busname, object_path, "sssd.Responder.Statistics", "Get");
+}
+
+errno_t
+sbus_call_resp_stats_Get_recv
+    (TALLOC_CTX *mem_ctx,
+     struct tevent_req *req,
+     const char *** _names,
+     uint64_t ** _values)
+{
+    return sbus_method_in__out_asat_recv(mem_ctx, req, _names, _values);
+}
+
+struct tevent_req *
+sbus_call_resp_stats_Reset_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path)
+{
+    return sbus_method_in__out__send(mem_ctx, conn, NULL,
+        busname, object_path, "sssd.Responder.Statistics", "Reset");
+}
+
+errno_t
+sbus_call_resp_stats_Reset_recv
+    (struct tevent_req *req)
+{
+    return sbus_method_in__out__recv(req);
+}
+
 struct tevent_req *
 sbus_call_dp_dp_getAccountDomain_send
     (TALLOC_CTX *mem_ctx,
@@ -2170,6 +2311,48 @@ sbus_call_nss_memcache_UpdateInitgroups_recv
     return sbus_method_in_ssau_out__recv(req);
 }
 
+struct tevent_req *
+sbus_call_nss_memcache_StoreEntry_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path,
+     uint32_t arg_type,
+     const char * arg_name,
+     uint32_t arg_id)
+{
+    return sbus_method_in_usu_out__send(mem_ctx, conn, NULL,
+        busname, object_path, "sssd.nss.MemoryCache", "StoreEntry", arg_type, arg_name, arg_id);
+}
+
+errno_t
+sbus_call_nss_memcache_StoreEntry_recv
+    (struct tevent_req *req)
+{
+    return sbus_method_in_usu_out__recv(req);
+}
+
+struct tevent_req *
+sbus_call_nss_memcache_DeleteEntry_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path,
+     uint32_t arg_type,
+     const char * arg_name,
+     uint32_t arg_id)
+{
+    return sbus_method_in_usu_out__send(mem_ctx, conn, NULL,
+        busname, object_path, "sssd.nss.MemoryCache", "DeleteEntry", arg_type, arg_name, arg_id);
+}
+
+errno_t
+sbus_call_nss_memcache_DeleteEntry_recv
+    (struct tevent_req *req)
+{
+    return sbus_method_in_usu_out__recv(req);
+}
+
 struct tevent_req *
 sbus_call_service_clearEnumCache_send
     (TALLOC_CTX *mem_ctx,
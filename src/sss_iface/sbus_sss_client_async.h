@@ -177,6 +177,31 @@ errno_t
 sbus_call_proxy_client_Register_recv
     (struct tevent_req *req);
 
+struct tevent_req *
+sbus_call_resp_stats_Get_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path);
+
+errno_t
+sbus_call_resp_stats_Get_recv
+    (TALLOC_CTX *mem_ctx,
+     struct tevent_req *req,
+     const char *** _names,
+     uint64_t ** _values);
+
+struct tevent_req *
+sbus_call_resp_stats_Reset_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path);
+
+errno_t
+sbus_call_resp_stats_Reset_recv
+    (struct tevent_req *req);
+
 struct tevent_req *
 sbus_call_dp_dp_getAccountDomain_send
     (TALLOC_CTX *mem_ctx,
@@ -329,6 +354,34 @@ errno_t
 sbus_call_nss_memcache_UpdateInitgroups_recv
     (struct tevent_req *req);
 
+struct tevent_req *
+sbus_call_nss_memcache_StoreEntry_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path,
+     uint32_t arg_type,
+     const char * arg_name,
+     uint32_t arg_id);
+
+errno_t
+sbus_call_nss_memcache_StoreEntry_recv
+    (struct tevent_req *req);
+
+struct tevent_req *
+sbus_call_nss_memcache_DeleteEntry_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path,
+     uint32_t arg_type,
+     const char * arg_name,
+     uint32_t arg_id);
+
+errno_t
+sbus_call_nss_memcache_DeleteEntry_recv
+    (struct tevent_req *req);
+
 struct tevent_req *
 sbus_call_service_clearEnumCache_send
     (TALLOC_CTX *mem_ctx,
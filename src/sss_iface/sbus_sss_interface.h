@@ -489,6 +489,56 @@
         (handler_send), (handler_recv), (data)); \
 })
 
+/* Interface: sssd.Responder.Statistics */
+#define SBUS_IFACE_sssd_Responder_Statistics(methods, signals, properties) ({ \
+    sbus_interface("sssd.Responder.Statistics", NULL, \
+        (methods), (signals), (properties)); \
+})
+
+/* Method: sssd.Responder.Statistics.Get */
+#define SBUS_METHOD_SYNC_sssd_Responder_Statistics_Get(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data), const char ***, uint64_t **); \
+    sbus_method_sync("Get", \
+        &_sbus_sss_args_sssd_Responder_Statistics_Get, \
+        NULL, \
+        _sbus_sss_invoke_in__out_asat_send, \
+        NULL, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_sssd_Responder_Statistics_Get(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data)); \
+    SBUS_CHECK_RECV((handler_recv), const char ***, uint64_t **); \
+    sbus_method_async("Get", \
+        &_sbus_sss_args_sssd_Responder_Statistics_Get, \
+        NULL, \
+        _sbus_sss_invoke_in__out_asat_send, \
+        NULL, \
+        (handler_send), (handler_recv), (data)); \
+})
+
+/* Method: sssd.Responder.Statistics.Reset */
+#define SBUS_METHOD_SYNC_sssd_Responder_Statistics_Reset(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data)); \
+    sbus_method_sync("Reset", \
+        &_sbus_sss_args_sssd_Responder_Statistics_Reset, \
+        NULL, \
+        _sbus_sss_invoke_in__out__send, \
+        NULL, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_sssd_Responder_Statistics_Reset(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data)); \
+    SBUS_CHECK_RECV((handler_recv)); \
+    sbus_method_async("Reset", \
+        &_sbus_sss_args_sssd_Responder_Statistics_Reset, \
+        NULL, \
+        _sbus_sss_invoke_in__out__send, \
+        NULL, \
+        (handler_send), (handler_recv), (data)); \
+})
+
 /* Interface: sssd.dataprovider */
 #define SBUS_IFACE_sssd_dataprovider(methods, signals, properties) ({ \
     sbus_interface("sssd.dataprovider", NULL, \
@@ -705,6 +755,50 @@
         (handler_send), (handler_recv), (data)); \
 })
 
+/* Method: sssd.nss.MemoryCache.StoreEntry */
+#define SBUS_METHOD_SYNC_sssd_nss_MemoryCache_StoreEntry(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data), uint32_t, const char *, uint32_t); \
+    sbus_method_sync("StoreEntry", \
+        &_sbus_sss_args_sssd_nss_MemoryCache_StoreEntry, \
+        NULL, \
+        _sbus_sss_invoke_in_usu_out__send, \
+        NULL, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_sssd_nss_MemoryCache_StoreEntry(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data), uint32_t, const char *, uint32_t); \
+    SBUS_CHECK_RECV((handler_recv)); \
+    sbus_method_async("StoreEntry", \
+        &_sbus_sss_args_sssd_nss_MemoryCache_StoreEntry, \
+        NULL, \
+        _sbus_sss_invoke_in_usu_out__send, \
+        NULL, \
+        (handler_send), (handler_recv), (data)); \
+})
+
+/* Method: sssd.nss.MemoryCache.DeleteEntry */
+#define SBUS_METHOD_SYNC_sssd_nss_MemoryCache_DeleteEntry(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data), uint32_t, const char *, uint32_t); \
+    sbus_method_sync("DeleteEntry", \
+        &_sbus_sss_args_sssd_nss_MemoryCache_DeleteEntry, \
+        NULL, \
+        _sbus_sss_invoke_in_usu_out__send, \
+        NULL, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_sssd_nss_MemoryCache_DeleteEntry(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data), uint32_t, const char *, uint32_t); \
+    SBUS_CHECK_RECV((handler_recv)); \
+    sbus_method_async("DeleteEntry", \
+        &_sbus_sss_args_sssd_nss_MemoryCache_DeleteEntry, \
+        NULL, \
+        _sbus_sss_invoke_in_usu_out__send, \
+        NULL, \
+        (handler_send), (handler_recv), (data)); \
+})
+
 /* Signal: sssd.nss.MemoryCache.InvalidateAllGroups */
 #define SBUS_SIGNAL_EMITS_sssd_nss_MemoryCache_InvalidateAllGroups() ({ \
     sbus_signal("InvalidateAllGroups", \
@@ -215,6 +215,28 @@ _sbus_sss_args_sssd_Responder_NegativeCache_ResetUsers[] = {
     {NULL}
 };
 
+const struct sbus_method_arguments
+_sbus_sss_args_sssd_Responder_Statistics_Get = {
+    .input = (const struct sbus_argument[]){
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {.type = "as", .name = "names"},
+        {.type = "at", .name = "values"},
+        {NULL}
+    }
+};
+
+const struct sbus_method_arguments
+_sbus_sss_args_sssd_Responder_Statistics_Reset = {
+    .input = (const struct sbus_argument[]){
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {NULL}
+    }
+};
+
 const struct sbus_method_arguments
 _sbus_sss_args_sssd_dataprovider_getAccountDomain = {
     .input = (const struct sbus_argument[]){
@@ -352,6 +374,32 @@ _sbus_sss_args_sssd_nss_MemoryCache_UpdateInitgroups = {
     }
 };
 
+const struct sbus_method_arguments
+_sbus_sss_args_sssd_nss_MemoryCache_StoreEntry = {
+    .input = (const struct sbus_argument[]){
+        {.type = "u", .name = "type"},
+        {.type = "s", .name = "name"},
+        {.type = "u", .name = "id"},
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {NULL}
+    }
+};
+
+const struct sbus_method_arguments
+_sbus_sss_args_sssd_nss_MemoryCache_DeleteEntry = {
+    .input = (const struct sbus_argument[]){
+        {.type = "u", .name = "type"},
+        {.type = "s", .name = "name"},
+        {.type = "u", .name = "id"},
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {NULL}
+    }
+};
+
 const struct sbus_argument
 _sbus_sss_args_sssd_nss_MemoryCache_InvalidateAllGroups[] = {
     {NULL}
@@ -76,6 +76,12 @@ _sbus_sss_args_sssd_Responder_NegativeCache_ResetGroups[];
 extern const struct sbus_argument
 _sbus_sss_args_sssd_Responder_NegativeCache_ResetUsers[];
 
+extern const struct sbus_method_arguments
+_sbus_sss_args_sssd_Responder_Statistics_Get;
+
+extern const struct sbus_method_arguments
+_sbus_sss_args_sssd_Responder_Statistics_Reset;
+
 extern const struct sbus_method_arguments
 _sbus_sss_args_sssd_dataprovider_getAccountDomain;
 
@@ -103,6 +109,12 @@ _sbus_sss_args_sssd_monitor_RegisterService;
 extern const struct sbus_method_arguments
 _sbus_sss_args_sssd_nss_MemoryCache_UpdateInitgroups;
 
+extern const struct sbus_method_arguments
+_sbus_sss_args_sssd_nss_MemoryCache_StoreEntry;
+
+extern const struct sbus_method_arguments
+_sbus_sss_args_sssd_nss_MemoryCache_DeleteEntry;
+
 extern const struct sbus_argument
 _sbus_sss_args_sssd_nss_MemoryCache_InvalidateAllGroups[];
 
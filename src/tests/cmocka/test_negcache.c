@@ -40,6 +40,7 @@
 #include "util/util.h"
 #include "responder/common/responder.h"
 #include "responder/common/negcache.h"
+#include "responder/common/negcache_shared.h"
 
 int test_ncache_setup(void **state);
 int test_ncache_teardown(void **state);
@@ -553,11 +554,25 @@ static void test_sss_ncache_reset_permanent(void **state)
     ret = sss_ncache_check_uid(ts->ctx, NULL, 0);
     assert_int_equal(ret, EEXIST);
 
+    ret = sss_ncache_set_uid(ts->ctx, false, NULL, 1);
+    assert_int_equal(ret, EOK);
+
     ret = sss_ncache_reset_permanent(ts->ctx);
     assert_int_equal(ret, EOK);
 
     ret = sss_ncache_check_uid(ts->ctx, NULL, 0);
     assert_int_equal(ret, ENOENT);
+
+    /* Non-permanent entries are kept */
+    ret = sss_ncache_check_uid(ts->ctx, NULL, 1);
+    assert_int_equal(ret, EEXIST);
+
+    /* Entries set again after the reset are valid */
+    ret = sss_ncache_set_uid(ts->ctx, permanent, NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_ncache_check_uid(ts->ctx, NULL, 0);
+    assert_int_equal(ret, EEXIST);
 }
 
 static int check_user_in_ncache(struct sss_nc_ctx *ctx,
@@ -1232,6 +1247,9 @@ static void test_sss_ncache_reset(void **state)
     ret = sss_ncache_check_group(ts->ctx, dom, "bar");
     assert_int_equal(ret, EEXIST);
 
+    ret = sss_ncache_set_user(ts->ctx, true, dom, "baz");
+    assert_int_equal(ret, EOK);
+
     ret = sss_ncache_reset_users(ts->ctx);
     assert_int_equal(ret, EOK);
 
@@ -1241,6 +1259,10 @@ static void test_sss_ncache_reset(void **state)
     ret = sss_ncache_check_uid(ts->ctx, NULL, 123);
     assert_int_equal(ret, ENOENT);
 
+    /* Permanent entries are skipped */
+    ret = sss_ncache_check_user(ts->ctx, dom, "baz");
+    assert_int_equal(ret, EEXIST);
+
     /* Groups still are */
     ret = sss_ncache_check_gid(ts->ctx, NULL, 456);
     assert_int_equal(ret, EEXIST);
@@ -1256,6 +1278,81 @@ static void test_sss_ncache_reset(void **state)
     assert_int_equal(ret, ENOENT);
 }
 
+static void test_sss_ncache_shared(void **state)
+{
+    errno_t ret;
+    struct test_state *ts;
+    struct sss_domain_info *dom;
+    struct sss_nc_ctx *other;
+    const char *path = TESTS_PATH "/negcache_shared";
+
+    ts = talloc_get_type_abort(*state, struct test_state);
+    dom = talloc(ts, struct sss_domain_info);
+    assert_non_null(dom);
+    dom->case_sensitive = true;
+    dom->name = discard_const_p(char, TEST_DOM_NAME);
+
+    ret = sss_ncache_init(ts, SHORTSPAN, 0, &other);
+    assert_int_equal(ret, EOK);
+
+    /* Nothing is shared without the segment */
+    ret = sss_ncache_attach_shared(other, path);
+    assert_int_equal(ret, ENOENT);
+
+    ret = sss_nc_shared_create(path);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_ncache_attach_shared(ts->ctx, path);
+    assert_int_equal(ret, EOK);
+    ret = sss_ncache_attach_shared(other, path);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_ncache_set_user(ts->ctx, false, dom, "foo");
+    assert_int_equal(ret, EOK);
+    ret = sss_ncache_set_uid(ts->ctx, false, NULL, 123);
+    assert_int_equal(ret, EOK);
+    ret = sss_ncache_set_gid(ts->ctx, false, NULL, 456);
+    assert_int_equal(ret, EOK);
+    ret = sss_ncache_set_netgr(ts->ctx, false, dom, "bar");
+    assert_int_equal(ret, EOK);
+    ret = sss_ncache_set_group(ts->ctx, true, dom, "baz");
+    assert_int_equal(ret, EOK);
+
+    ret = sss_ncache_check_user(other, dom, "foo");
+    assert_int_equal(ret, EEXIST);
+    ret = sss_ncache_check_uid(other, NULL, 123);
+    assert_int_equal(ret, EEXIST);
+    ret = sss_ncache_check_gid(other, NULL, 456);
+    assert_int_equal(ret, EEXIST);
+    ret = sss_ncache_check_gid(other, NULL, 123);
+    assert_int_equal(ret, ENOENT);
+
+    /* Only not permanent users and groups are shared */
+    ret = sss_ncache_check_netgr(other, dom, "bar");
+    assert_int_equal(ret, ENOENT);
+    ret = sss_ncache_check_group(other, dom, "baz");
+    assert_int_equal(ret, ENOENT);
+
+    /* A reset in one responder applies to the shared entries of all */
+    ret = sss_ncache_reset_users(other);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_ncache_check_user(other, dom, "foo");
+    assert_int_equal(ret, ENOENT);
+    ret = sss_ncache_check_uid(other, NULL, 123);
+    assert_int_equal(ret, ENOENT);
+    ret = sss_ncache_check_gid(other, NULL, 456);
+    assert_int_equal(ret, EEXIST);
+
+    /* Shared entries expire */
+    sleep(SHORTSPAN + 1);
+    ret = sss_ncache_check_gid(other, NULL, 456);
+    assert_int_equal(ret, ENOENT);
+
+    talloc_free(other);
+    unlink(path);
+}
+
 static void test_sss_ncache_locate_uid_gid_sid(void **state)
 {
     uid_t uid;
@@ -1366,6 +1463,8 @@ int main(void)
                                         setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_reset,
                                         setup, teardown),
+        cmocka_unit_test_setup_teardown(test_sss_ncache_shared,
+                                        setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_locate_uid_gid_sid,
                                         setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_domain_locate_type,
@@ -0,0 +1,222 @@
+/*
+    SSSD
+
+    NSS Responder - Fast mmap cache online growth tests
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <errno.h>
+#include <popt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pwd.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "util/mmap_cache.h"
+#include "responder/nss/nsssrv_mmap_cache.h"
+#include "sss_client/nss_mc.h"
+
+/* SSS_NSS_MCACHE_DIR is overridden to this directory in Makefile.am */
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_MC_FILE TESTS_PATH"/passwd"
+
+#define TEST_INITIAL_ELEM 64
+#define TEST_MAX_ELEM 4096
+#define TEST_NUM_USERS 200
+#define TEST_UID_BASE 10000
+
+struct mc_test_ctx {
+    struct sss_mc_ctx *mcc;
+};
+
+static int test_mc_setup(void **state)
+{
+    struct mc_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct mc_test_ctx);
+    assert_non_null(test_ctx);
+
+    ret = sss_mmap_cache_init(test_ctx, "passwd", SSS_MC_PASSWD,
+                              TEST_INITIAL_ELEM, TEST_MAX_ELEM, false,
+                              300, &test_ctx->mcc);
+    assert_int_equal(ret, EOK);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_mc_teardown(void **state)
+{
+    struct mc_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                         struct mc_test_ctx);
+
+    talloc_free(test_ctx);
+    unlink(TEST_MC_FILE);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void store_user(struct sss_mc_ctx **_mcc, unsigned int i)
+{
+    struct sized_string name;
+    struct sized_string pw;
+    struct sized_string gecos;
+    struct sized_string homedir;
+    struct sized_string shell;
+    char *user;
+    char *home;
+    errno_t ret;
+
+    user = talloc_asprintf(NULL, "mcuser%u", i);
+    assert_non_null(user);
+    home = talloc_asprintf(user, "/home/%s", user);
+    assert_non_null(home);
+
+    to_sized_string(&name, user);
+    to_sized_string(&pw, "*");
+    to_sized_string(&gecos, "Test User");
+    to_sized_string(&homedir, home);
+    to_sized_string(&shell, "/bin/sh");
+
+    ret = sss_mmap_cache_pw_store(_mcc, &name, &pw,
+                                  TEST_UID_BASE + i, TEST_UID_BASE + i,
+                                  &gecos, &homedir, &shell);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(user);
+}
+
+static errno_t lookup_user(unsigned int i)
+{
+    struct passwd pwd;
+    char buf[1024];
+    char user[64];
+    errno_t ret;
+
+    snprintf(user, sizeof(user), "mcuser%u", i);
+    ret = sss_nss_mc_getpwnam(user, strlen(user), &pwd, buf, sizeof(buf));
+    if (ret != 0) {
+        return ret;
+    }
+
+    assert_string_equal(pwd.pw_name, user);
+    assert_int_equal(pwd.pw_uid, TEST_UID_BASE + i);
+    return 0;
+}
+
+/* Filling the cache past its initial size must regrow the file instead of
+ * evicting live records, and a client still mapping the old file must see
+ * it as recycled and re-map the new one. */
+static void test_mc_grow_keeps_records(void **state)
+{
+    struct mc_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                         struct mc_test_ctx);
+    struct sss_mc_stats stats;
+    struct sss_mc_header h;
+    ssize_t len;
+    unsigned int i;
+    errno_t ret;
+    int fd;
+
+    store_user(&test_ctx->mcc, 0);
+
+    /* map the first generation in the client */
+    ret = lookup_user(0);
+    assert_int_equal(ret, 0);
+
+    fd = open(TEST_MC_FILE, O_RDONLY);
+    assert_true(fd != -1);
+
+    for (i = 1; i < TEST_NUM_USERS; i++) {
+        store_user(&test_ctx->mcc, i);
+    }
+
+    sss_mmap_cache_get_stats(test_ctx->mcc, &stats);
+    assert_true(stats.generation >= 1);
+    assert_true(stats.n_elem > TEST_INITIAL_ELEM);
+    assert_int_equal(stats.max_n_elem, TEST_MAX_ELEM);
+    assert_int_equal(stats.stores, TEST_NUM_USERS);
+    assert_int_equal(stats.evictions, 0);
+
+    /* the file the client mapped was replaced and marked as recycled */
+    len = pread(fd, &h, sizeof(h), 0);
+    assert_int_equal(len, sizeof(h));
+    assert_int_equal(h.status, SSS_MC_HEADER_RECYCLED);
+    close(fd);
+
+    /* the client drops the recycled mapping ... */
+    ret = lookup_user(0);
+    assert_int_not_equal(ret, 0);
+
+    /* ... and re-opens the grown cache which holds every record */
+    for (i = 0; i < TEST_NUM_USERS; i++) {
+        ret = lookup_user(i);
+        assert_int_equal(ret, 0);
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    int no_cleanup = 0;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_mc_grow_keeps_records,
+                                        test_mc_setup,
+                                        test_mc_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        rmdir(TESTS_PATH);
+    }
+
+    return rv;
+}
@@ -1639,6 +1639,71 @@ void test_sss_nss_getgrnam_members(void **state)
     assert_int_equal(ret, EOK);
 }
 
+static int test_sss_nss_getgrnam_stream_members_check(uint32_t status,
+                                                      uint8_t *body,
+                                                      size_t blen)
+{
+    uint32_t reply_flags;
+
+    /* The whole group fits into the first reply */
+    SAFEALIGN_COPY_UINT32(&reply_flags, body + sizeof(uint32_t), NULL);
+    assert_int_equal(reply_flags & SSS_NSS_GR_MORE_MEMBERS, 0);
+
+    return test_sss_nss_getgrnam_members_check(status, body, blen);
+}
+
+void test_sss_nss_getgrnam_ex_stream_members(void **state)
+{
+    errno_t ret;
+
+    ret = store_group(sss_nss_test_ctx, sss_nss_test_ctx->tctx->dom,
+                      &testgroup_members, NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = store_user(sss_nss_test_ctx, sss_nss_test_ctx->tctx->dom,
+                     &testmember1, NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = store_user(sss_nss_test_ctx, sss_nss_test_ctx->tctx->dom,
+                     &testmember2, NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = store_group_member(sss_nss_test_ctx,
+                             testgroup_members.gr_name,
+                             sss_nss_test_ctx->tctx->dom,
+                             testmember1.pw_name,
+                             sss_nss_test_ctx->tctx->dom,
+                             SYSDB_MEMBER_USER);
+    assert_int_equal(ret, EOK);
+
+    ret = store_group_member(sss_nss_test_ctx,
+                             testgroup_members.gr_name,
+                             sss_nss_test_ctx->tctx->dom,
+                             testmember2.pw_name,
+                             sss_nss_test_ctx->tctx->dom,
+                             SYSDB_MEMBER_USER);
+    assert_int_equal(ret, EOK);
+
+    mock_input_user_or_group_ex(true, testgroup_members.gr_name,
+                                SSS_NSS_EX_FLAG_STREAM_MEMBERS);
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM_EX);
+    will_return_always(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+
+    set_cmd_cb(test_sss_nss_getgrnam_stream_members_check);
+    ret = sss_cmd_execute(sss_nss_test_ctx->cctx, SSS_NSS_GETGRNAM_EX,
+                          sss_nss_test_ctx->sss_nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(sss_nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+
+    /* No members are left to be sent */
+    ret = sss_cmd_execute(sss_nss_test_ctx->cctx, SSS_NSS_GETGRMEMBERS,
+                          sss_nss_test_ctx->sss_nss_cmds);
+    assert_int_equal(ret, EINVAL);
+}
+
 static int test_sss_nss_getgrnam_members_check_fqdn(uint32_t status,
                                                 uint8_t *body, size_t blen)
 {
@@ -5123,6 +5188,217 @@ void test_sss_nss_getpwuid_ex(void **state)
     assert_int_equal(ret, EOK);
 }
 
+struct passwd getpwuid_multi_usr = {
+    .pw_name = discard_const("testusermulti"),
+    .pw_uid = 103,
+    .pw_gid = 401,
+    .pw_dir = discard_const("/home/testusermulti"),
+    .pw_gecos = discard_const("test user multi"),
+    .pw_shell = discard_const("/bin/sh"),
+    .pw_passwd = discard_const("*"),
+};
+
+static void mock_input_id_multi(TALLOC_CTX *mem_ctx, uint32_t *ids,
+                                uint32_t num_ids, uint32_t flags)
+{
+    uint8_t *body;
+    size_t rp = 0;
+    uint32_t i;
+
+    body = talloc_zero_array(mem_ctx, uint8_t,
+                             (2 + num_ids) * sizeof(uint32_t));
+    if (body == NULL) return;
+
+    SAFEALIGN_SET_UINT32(body + rp, flags, &rp);
+    SAFEALIGN_SET_UINT32(body + rp, num_ids, &rp);
+    for (i = 0; i < num_ids; i++) {
+        SAFEALIGN_SET_UINT32(body + rp, ids[i], &rp);
+    }
+
+    will_return(__wrap_sss_packet_get_body, WRAP_CALL_WRAPPER);
+    will_return(__wrap_sss_packet_get_body, body);
+    will_return(__wrap_sss_packet_get_body, rp);
+}
+
+static void mock_fill_multi_user(uint32_t num_ids)
+{
+    uint32_t i;
+
+    /* The user reply, copying it and growing the reply for each key and
+     * one more for the number of keys */
+    for (i = 0; i < num_ids; i++) {
+        mock_fill_user();
+        will_return(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+        will_return(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+    }
+    will_return(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+}
+
+static int test_sss_nss_getpwuid_multi_check(uint32_t status,
+                                             uint8_t *body, size_t blen)
+{
+    struct passwd *expected[] = { &getpwuid_usr, &getpwuid_multi_usr };
+    struct passwd pwd;
+    uint32_t num_keys;
+    uint32_t err;
+    uint32_t len;
+    size_t rp = 0;
+    uint32_t i;
+    errno_t ret;
+
+    assert_int_equal(status, EOK);
+
+    SAFEALIGN_COPY_UINT32(&num_keys, body, &rp);
+    assert_int_equal(num_keys, 2);
+    rp += sizeof(uint32_t); /* reserved */
+
+    for (i = 0; i < num_keys; i++) {
+        SAFEALIGN_COPY_UINT32(&err, body + rp, &rp);
+        SAFEALIGN_COPY_UINT32(&len, body + rp, &rp);
+        assert_int_equal(err, EOK);
+        assert_true(rp + len <= blen);
+
+        ret = parse_user_packet(body + rp, len, &pwd);
+        assert_int_equal(ret, EOK);
+        assert_users_equal(&pwd, expected[i]);
+
+        rp += len;
+    }
+
+    assert_int_equal(rp, blen);
+    return EOK;
+}
+
+void test_sss_nss_getpwuid_multi(void **state)
+{
+    errno_t ret;
+    uint32_t ids[] = { 101, 103 };
+
+    /* Prime the cache with valid users */
+    ret = store_user(sss_nss_test_ctx, sss_nss_test_ctx->tctx->dom,
+                     &getpwuid_usr, NULL, 0);
+    assert_int_equal(ret, EOK);
+    ret = store_user(sss_nss_test_ctx, sss_nss_test_ctx->tctx->dom,
+                     &getpwuid_multi_usr, NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    mock_input_id_multi(sss_nss_test_ctx, ids, 2, 0);
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETPWUID_MULTI);
+    mock_fill_multi_user(2);
+
+    /* Both users are returned in the order they were requested */
+    set_cmd_cb(test_sss_nss_getpwuid_multi_check);
+    ret = sss_cmd_execute(sss_nss_test_ctx->cctx, SSS_NSS_GETPWUID_MULTI,
+                          sss_nss_test_ctx->sss_nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(sss_nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+    RESET_TCTX;
+
+    /* No IDs at all, expect EINVAL */
+    mock_input_id_multi(sss_nss_test_ctx, ids, 0, 0);
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETPWUID_MULTI);
+
+    set_cmd_cb(test_sss_nss_EINVAL_check);
+    ret = sss_cmd_execute(sss_nss_test_ctx->cctx, SSS_NSS_GETPWUID_MULTI,
+                          sss_nss_test_ctx->sss_nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(sss_nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+}
+
+struct group getgrgid_multi_large = {
+    .gr_gid = 1131,
+    .gr_name = discard_const("testgroup_multi_large"),
+    .gr_passwd = discard_const("*"),
+    .gr_mem = NULL,
+};
+
+/* Enough members to send them as a chunk of the single key reply */
+#define MULTI_LARGE_NUM_MEMBERS 512
+
+static int test_sss_nss_getgrgid_multi_large_check(uint32_t status,
+                                                   uint8_t *body, size_t blen)
+{
+    struct group gr;
+    char member[64];
+    uint32_t num_keys;
+    uint32_t nmem;
+    uint32_t err;
+    uint32_t len;
+    size_t rp = 0;
+    uint32_t i;
+    errno_t ret;
+
+    assert_int_equal(status, EOK);
+
+    SAFEALIGN_COPY_UINT32(&num_keys, body, &rp);
+    assert_int_equal(num_keys, 1);
+    rp += sizeof(uint32_t); /* reserved */
+
+    SAFEALIGN_COPY_UINT32(&err, body + rp, &rp);
+    SAFEALIGN_COPY_UINT32(&len, body + rp, &rp);
+    assert_int_equal(err, EOK);
+    assert_int_equal(rp + len, blen);
+
+    ret = parse_group_packet(body + rp, len, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(gr.gr_gid, getgrgid_multi_large.gr_gid);
+    assert_string_equal(gr.gr_name, getgrgid_multi_large.gr_name);
+    assert_int_equal(nmem, MULTI_LARGE_NUM_MEMBERS);
+
+    for (i = 0; i < nmem; i++) {
+        snprintf(member, sizeof(member), "multi_large_member_%04u", i);
+        assert_string_equal(gr.gr_mem[i], member);
+    }
+
+    return EOK;
+}
+
+/* Test that the member list of a large group is part of the reply to a
+ * MULTI request */
+void test_sss_nss_getgrgid_multi_large(void **state)
+{
+    struct sysdb_attrs *attrs;
+    uint32_t ids[] = { getgrgid_multi_large.gr_gid };
+    char *member;
+    errno_t ret;
+    uint32_t i;
+
+    attrs = sysdb_new_attrs(sss_nss_test_ctx);
+    assert_non_null(attrs);
+
+    for (i = 0; i < MULTI_LARGE_NUM_MEMBERS; i++) {
+        member = talloc_asprintf(attrs, "multi_large_member_%04u", i);
+        assert_non_null(member);
+
+        ret = sysdb_attrs_add_string(attrs, SYSDB_GHOST, member);
+        assert_int_equal(ret, EOK);
+    }
+
+    ret = store_group(sss_nss_test_ctx, sss_nss_test_ctx->tctx->dom,
+                      &getgrgid_multi_large, attrs, 0);
+    assert_int_equal(ret, EOK);
+    talloc_free(attrs);
+
+    mock_input_id_multi(sss_nss_test_ctx, ids, 1, 0);
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRGID_MULTI);
+    will_return_always(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+
+    set_cmd_cb(test_sss_nss_getgrgid_multi_large_check);
+    ret = sss_cmd_execute(sss_nss_test_ctx->cctx, SSS_NSS_GETGRGID_MULTI,
+                          sss_nss_test_ctx->sss_nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(sss_nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+}
+
 void test_sss_nss_getgrnam_ex_no_members(void **state)
 {
     errno_t ret;
@@ -6030,6 +6306,8 @@ int main(int argc, const char *argv[])
                                         sss_nss_test_setup, sss_nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_sss_nss_getgrnam_members,
                                         sss_nss_test_setup, sss_nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sss_nss_getgrnam_ex_stream_members,
+                                        sss_nss_test_setup, sss_nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_sss_nss_getgrnam_members_fqdn,
                                         sss_nss_fqdn_test_setup, sss_nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_sss_nss_getgrnam_members_subdom,
@@ -6166,6 +6444,10 @@ int main(int argc, const char *argv[])
                                         sss_nss_test_setup, sss_nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_sss_nss_getpwuid_ex,
                                         sss_nss_test_setup, sss_nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sss_nss_getpwuid_multi,
+                                        sss_nss_test_setup, sss_nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_sss_nss_getgrgid_multi_large,
+                                        sss_nss_test_setup, sss_nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_sss_nss_getgrnam_ex_no_members,
                                         sss_nss_test_setup, sss_nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_sss_nss_getgrgid_ex_no_members,
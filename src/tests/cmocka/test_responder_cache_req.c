@@ -137,6 +137,7 @@ struct cache_req_test_ctx {
 
     struct cache_req_result *result;
     bool dp_called;
+    int num_done;
 
     /* NOTE: Please, instead of adding new create_[user|group] bool,
      * use bitshift. */
@@ -177,6 +178,29 @@ static void cache_req_user_by_name_test_done(struct tevent_req *req)
     ctx->tctx->done = true;
 }
 
+static void cache_req_user_by_name_concurrent_done(struct tevent_req *req)
+{
+    struct cache_req_test_ctx *ctx = NULL;
+    struct cache_req_result *result = NULL;
+    errno_t ret;
+
+    ctx = tevent_req_callback_data(req, struct cache_req_test_ctx);
+
+    ret = cache_req_user_by_name_recv(ctx, req, &result);
+    talloc_zfree(req);
+    assert_int_equal(ret, EOK);
+    assert_non_null(result);
+
+    talloc_zfree(ctx->result);
+    ctx->result = result;
+
+    ctx->num_done++;
+    if (ctx->num_done == 2) {
+        ctx->tctx->error = EOK;
+        ctx->tctx->done = true;
+    }
+}
+
 static void cache_req_user_by_id_test_done(struct tevent_req *req)
 {
     struct cache_req_test_ctx *ctx = NULL;
@@ -819,6 +843,49 @@ void test_user_by_name_multiple_domains_notfound(void **state)
     assert_true(test_ctx->dp_called);
 }
 
+void test_user_by_name_multiple_domains_parallel_found(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+    struct sss_domain_info *domain = NULL;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+    test_ctx->rctx->parallel_domain_lookup = true;
+
+    /* Setup user. */
+    domain = find_domain_by_name(test_ctx->tctx->dom,
+                                 "responder_cache_req_test_d", true);
+    assert_non_null(domain);
+
+    prepare_user(domain, &users[0], 1000, time(NULL));
+
+    /* Mock values. */
+    will_return_always(__wrap_sss_dp_get_account_send, test_ctx);
+    will_return_always(sss_dp_get_account_recv, 0);
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+
+    /* Test. */
+    run_user_by_name(test_ctx, NULL, 0, ERR_OK);
+    assert_true(test_ctx->dp_called);
+    check_user(test_ctx, &users[0], domain);
+}
+
+void test_user_by_name_multiple_domains_parallel_notfound(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+    test_ctx->rctx->parallel_domain_lookup = true;
+
+    /* Mock values. */
+    will_return_always(__wrap_sss_dp_get_account_send, test_ctx);
+    will_return_always(sss_dp_get_account_recv, 0);
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+
+    /* Test. */
+    run_user_by_name(test_ctx, NULL, 0, ENOENT);
+    assert_true(test_ctx->dp_called);
+}
+
 void test_user_by_name_multiple_domains_parse(void **state)
 {
     struct cache_req_test_ctx *test_ctx = NULL;
@@ -995,6 +1062,91 @@ void test_user_by_name_missing_found(void **state)
     check_user(test_ctx, &users[0], test_ctx->tctx->dom);
 }
 
+void test_user_by_name_concurrent_merged(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+    TALLOC_CTX *req_mem_ctx = NULL;
+    struct tevent_req *req = NULL;
+    errno_t ret;
+    int i;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+
+    /* Mock values, the second request does not search on its own. */
+    will_return(__wrap_sss_dp_get_account_send, test_ctx);
+    mock_account_recv_simple();
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+
+    test_ctx->create_user1 = true;
+    test_ctx->create_user2 = false;
+
+    /* Test. */
+    req_mem_ctx = talloc_new(test_ctx->tctx);
+    check_leaks_push(req_mem_ctx);
+
+    for (i = 0; i < 2; i++) {
+        req = cache_req_user_by_name_send(req_mem_ctx, test_ctx->tctx->ev,
+                                          test_ctx->rctx, test_ctx->ncache,
+                                          0, CACHE_REQ_POSIX_DOM,
+                                          test_ctx->tctx->dom->name,
+                                          users[0].short_name);
+        assert_non_null(req);
+        tevent_req_set_callback(req, cache_req_user_by_name_concurrent_done,
+                                test_ctx);
+    }
+
+    ret = test_ev_loop(test_ctx->tctx);
+    assert_int_equal(ret, ERR_OK);
+    assert_true(check_leaks_pop(req_mem_ctx));
+    talloc_free(req_mem_ctx);
+
+    assert_true(test_ctx->dp_called);
+    assert_int_equal(test_ctx->rctx->cr_flights_started, 1);
+    assert_int_equal(test_ctx->rctx->cr_flights_merged, 1);
+    check_user(test_ctx, &users[0], test_ctx->tctx->dom);
+}
+
+void test_user_by_name_result_cache(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+    char *fqname;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+    test_ctx->rctx->result_cache_size = 10;
+    test_ctx->rctx->result_cache_timeout = 60;
+
+    /* Setup user. */
+    prepare_user(test_ctx->tctx->dom, &users[0], 1000, time(NULL));
+
+    /* The user is kept in memory by the first lookup. */
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+    run_user_by_name(test_ctx, test_ctx->tctx->dom, 0, ERR_OK);
+    check_user(test_ctx, &users[0], test_ctx->tctx->dom);
+
+    fqname = sss_create_internal_fqname(test_ctx, users[0].short_name,
+                                        test_ctx->tctx->dom->name);
+    assert_non_null(fqname);
+    ret = sysdb_delete_user(test_ctx->tctx->dom, fqname, 0);
+    talloc_free(fqname);
+    assert_int_equal(ret, EOK);
+
+    /* The second lookup does not search the cache. */
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+    run_user_by_name(test_ctx, test_ctx->tctx->dom, 0, ERR_OK);
+    assert_false(test_ctx->dp_called);
+    check_user(test_ctx, &users[0], test_ctx->tctx->dom);
+
+    /* Once the memory is cleared the user is searched again. */
+    cache_req_hot_cache_clear(test_ctx->rctx);
+
+    will_return(__wrap_sss_dp_get_account_send, test_ctx);
+    mock_account_recv_simple();
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+    run_user_by_name(test_ctx, test_ctx->tctx->dom, 0, ENOENT);
+    assert_true(test_ctx->dp_called);
+}
+
 void test_user_by_name_missing_notfound(void **state)
 {
     struct cache_req_test_ctx *test_ctx = NULL;
@@ -4414,12 +4566,16 @@ int main(int argc, const char *argv[])
         new_single_domain_test(user_by_name_cache_midpoint),
         new_single_domain_test(user_by_name_ncache),
         new_single_domain_test(user_by_name_missing_found),
+        new_single_domain_test(user_by_name_concurrent_merged),
+        new_single_domain_test(user_by_name_result_cache),
         new_single_domain_test(user_by_name_missing_notfound),
         new_single_domain_test(user_by_name_missing_notfound_cache_first),
         new_single_domain_test(user_by_name_missing_notfound_full_name),
         new_single_domain_test(user_by_name_missing_notfound_cache_first_full_name),
         new_multi_domain_test(user_by_name_multiple_domains_found),
         new_multi_domain_test(user_by_name_multiple_domains_notfound),
+        new_multi_domain_test(user_by_name_multiple_domains_parallel_found),
+        new_multi_domain_test(user_by_name_multiple_domains_parallel_notfound),
         new_multi_domain_test(user_by_name_multiple_domains_parse),
         new_multi_domain_test(user_by_name_multiple_domains_requested_domains_found),
         new_multi_domain_test(user_by_name_multiple_domains_requested_domains_notfound),
@@ -24,9 +24,11 @@
 #include <tevent.h>
 #include <errno.h>
 #include <popt.h>
+#include <sys/socket.h>
 
 #include "tests/cmocka/common_mock.h"
 #include "tests/cmocka/common_mock_resp.h"
+#include "responder/common/responder_packet.h"
 
 #define TESTS_PATH "tp_" BASE_FILE_STEM
 #define TEST_CONF_DB "test_responder_conf.ldb"
@@ -290,6 +292,486 @@ void test_sss_output_fqname(void **state)
     talloc_zfree(res);
 }
 
+/* When set, sendmsg() sends at most this many bytes, like a socket whose
+ * buffer is full would */
+static size_t sendmsg_limit;
+
+ssize_t __real_sendmsg(int sockfd, const struct msghdr *msg, int flags);
+
+ssize_t __wrap_sendmsg(int sockfd, const struct msghdr *msg, int flags)
+{
+    struct iovec iov[64];
+    struct msghdr limited;
+    size_t left = sendmsg_limit;
+    size_t i;
+
+    if (sendmsg_limit == 0) {
+        return __real_sendmsg(sockfd, msg, flags);
+    }
+
+    limited = *msg;
+    limited.msg_iov = iov;
+    limited.msg_iovlen = 0;
+    for (i = 0; i < msg->msg_iovlen && i < 64 && left > 0; i++) {
+        iov[i] = msg->msg_iov[i];
+        if (iov[i].iov_len > left) {
+            iov[i].iov_len = left;
+        }
+        left -= iov[i].iov_len;
+        limited.msg_iovlen++;
+    }
+
+    return __real_sendmsg(sockfd, &limited, flags);
+}
+
+/* Reads the whole packet from fd and checks its length and body */
+static void assert_packet_received(int fd, const char *exp_body,
+                                   size_t exp_len)
+{
+    uint8_t buf[SSS_NSS_HEADER_SIZE + 64];
+    uint32_t len;
+    ssize_t rb;
+    size_t pos = 0;
+
+    assert_true(exp_len <= 64);
+
+    while (pos < SSS_NSS_HEADER_SIZE + exp_len) {
+        rb = recv(fd, buf + pos, sizeof(buf) - pos, MSG_DONTWAIT);
+        assert_true(rb > 0);
+        pos += rb;
+    }
+    assert_int_equal(pos, SSS_NSS_HEADER_SIZE + exp_len);
+
+    memcpy(&len, buf, sizeof(len));
+    assert_int_equal(len, SSS_NSS_HEADER_SIZE + exp_len);
+    assert_memory_equal(buf + SSS_NSS_HEADER_SIZE, exp_body, exp_len);
+}
+
+static struct sss_packet *chunked_packet(TALLOC_CTX *mem_ctx)
+{
+    struct sss_packet *packet;
+    uint8_t *chunk;
+    uint8_t *body;
+    size_t blen;
+    errno_t ret;
+
+    ret = sss_packet_new(mem_ctx, 4, SSS_NSS_GETGRNAM, &packet);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(packet, &body, &blen);
+    assert_int_equal(blen, 4);
+    memcpy(body, "abcd", 4);
+
+    chunk = talloc_memdup(mem_ctx, "XYZ", 3);
+    assert_non_null(chunk);
+    ret = sss_packet_append_chunk(packet, chunk, 3);
+    assert_int_equal(ret, EOK);
+
+    /* data added after the chunk is sent after it, the body only holds
+     * the data of the buffer */
+    ret = sss_packet_grow(packet, 2);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(packet, &body, &blen);
+    assert_int_equal(blen, 6);
+    memcpy(body + 4, "ef", 2);
+
+    return packet;
+}
+
+void test_sss_packet_send_chunks(void **state)
+{
+    TALLOC_CTX *test_ctx;
+    struct sss_packet *packet;
+    int fds[2];
+    errno_t ret;
+
+    test_ctx = talloc_new(NULL);
+    assert_non_null(test_ctx);
+
+    ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert_int_equal(ret, 0);
+
+    packet = chunked_packet(test_ctx);
+
+    /* stop right before the chunk */
+    sendmsg_limit = SSS_NSS_HEADER_SIZE + 4;
+    ret = sss_packet_send(packet, fds[0]);
+    assert_int_equal(ret, EAGAIN);
+
+    /* send exactly the chunk */
+    sendmsg_limit = 3;
+    ret = sss_packet_send(packet, fds[0]);
+    assert_int_equal(ret, EAGAIN);
+
+    /* stop inside the data after the chunk */
+    sendmsg_limit = 1;
+    ret = sss_packet_send(packet, fds[0]);
+    assert_int_equal(ret, EAGAIN);
+
+    sendmsg_limit = 0;
+    ret = sss_packet_send(packet, fds[0]);
+    assert_int_equal(ret, EOK);
+
+    assert_packet_received(fds[1], "abcdXYZef", 9);
+
+    close(fds[0]);
+    close(fds[1]);
+    talloc_free(test_ctx);
+}
+
+void test_sss_packet_set_size_chunks(void **state)
+{
+    TALLOC_CTX *test_ctx;
+    struct sss_packet *packet;
+    uint8_t *body;
+    size_t blen;
+    int fds[2];
+    errno_t ret;
+
+    test_ctx = talloc_new(NULL);
+    assert_non_null(test_ctx);
+
+    ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert_int_equal(ret, 0);
+
+    /* the chunk was appended after 4 bytes of the body, it is kept as
+     * long as these are */
+    packet = chunked_packet(test_ctx);
+    ret = sss_packet_set_size(packet, 4);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(packet, &body, &blen);
+    assert_int_equal(blen, 4);
+
+    ret = sss_packet_send(packet, fds[0]);
+    assert_int_equal(ret, EOK);
+    assert_packet_received(fds[1], "abcdXYZ", 7);
+
+    /* and dropped with them */
+    packet = chunked_packet(test_ctx);
+    ret = sss_packet_set_size(packet, 3);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(packet, &body, &blen);
+    assert_int_equal(blen, 3);
+
+    ret = sss_packet_send(packet, fds[0]);
+    assert_int_equal(ret, EOK);
+    assert_packet_received(fds[1], "abc", 3);
+
+    close(fds[0]);
+    close(fds[1]);
+    talloc_free(test_ctx);
+}
+
+void test_sss_packet_flatten(void **state)
+{
+    TALLOC_CTX *test_ctx;
+    struct sss_packet *packet;
+    uint8_t *body;
+    size_t blen;
+    int fds[2];
+    errno_t ret;
+
+    test_ctx = talloc_new(NULL);
+    assert_non_null(test_ctx);
+
+    ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert_int_equal(ret, 0);
+
+    /* the body holds the chunk afterwards */
+    packet = chunked_packet(test_ctx);
+    ret = sss_packet_flatten(packet);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(packet, &body, &blen);
+    assert_int_equal(blen, 9);
+    assert_memory_equal(body, "abcdXYZef", 9);
+
+    /* and the packet is sent unchanged */
+    ret = sss_packet_send(packet, fds[0]);
+    assert_int_equal(ret, EOK);
+    assert_packet_received(fds[1], "abcdXYZef", 9);
+
+    /* it still grows and shrinks like any other packet */
+    ret = sss_packet_grow(packet, 1);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(packet, &body, &blen);
+    assert_int_equal(blen, 10);
+    body[9] = 'g';
+    ret = sss_packet_shrink(packet, 6);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(packet, &body, &blen);
+    assert_int_equal(blen, 4);
+    assert_memory_equal(body, "abcd", 4);
+
+    close(fds[0]);
+    close(fds[1]);
+    talloc_free(test_ctx);
+}
+
+/* Same as CLI_PIPELINE_MAX_INFLIGHT in responder_common.c */
+#define TEST_PIPELINE_MAX_INFLIGHT 64
+#define TEST_PIPELINE_MAX_REQS (TEST_PIPELINE_MAX_INFLIGHT + 6)
+#define TEST_PIPELINE_ID(i) (0x1000 + (i))
+
+struct pipeline_test_ctx {
+    struct tevent_context *ev;
+    struct resp_ctx *rctx;
+    struct cli_ctx *cctx;
+    int fds[2];
+
+    /* requests executed by the responder, in the order they were read */
+    struct cli_ctx *received[TEST_PIPELINE_MAX_REQS];
+    unsigned int num_received;
+};
+
+/* Keeps the request pending, the test replies to it later */
+static int pipeline_test_cmd(struct cli_ctx *cctx)
+{
+    struct pipeline_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type(cctx->rctx->pvt_ctx, struct pipeline_test_ctx);
+    assert_true(test_ctx->num_received < TEST_PIPELINE_MAX_REQS);
+    test_ctx->received[test_ctx->num_received++] = cctx;
+
+    return EOK;
+}
+
+static struct sss_cmd_table pipeline_test_cmds[] = {
+    { SSS_GET_VERSION, sss_cmd_get_version },
+    { SSS_NSS_GETPWNAM, pipeline_test_cmd },
+    { SSS_CLI_NULL, NULL }
+};
+
+static int pipeline_test_setup(void **state)
+{
+    struct pipeline_test_ctx *test_ctx;
+    int ret;
+
+    assert_true(leak_check_setup());
+    test_ctx = talloc_zero(global_talloc_context, struct pipeline_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    test_ctx->rctx = mock_rctx(test_ctx, test_ctx->ev, NULL, test_ctx);
+    assert_non_null(test_ctx->rctx);
+    test_ctx->rctx->sss_cmds = pipeline_test_cmds;
+    test_ctx->rctx->pipelining = true;
+
+    ret = socketpair(AF_UNIX, SOCK_STREAM, 0, test_ctx->fds);
+    assert_int_equal(ret, 0);
+    ret = sss_fd_nonblocking(test_ctx->fds[0]);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->cctx = talloc_zero(test_ctx, struct cli_ctx);
+    assert_non_null(test_ctx->cctx);
+    test_ctx->cctx->ev = test_ctx->ev;
+    test_ctx->cctx->rctx = test_ctx->rctx;
+    test_ctx->cctx->cfd = test_ctx->fds[0];
+
+    ret = sss_connection_setup(test_ctx->cctx);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->cctx->cfde = tevent_add_fd(test_ctx->ev, test_ctx->cctx,
+                                         test_ctx->cctx->cfd, TEVENT_FD_READ,
+                                         test_ctx->cctx->cfd_handler,
+                                         test_ctx->cctx);
+    assert_non_null(test_ctx->cctx->cfde);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int pipeline_test_teardown(void **state)
+{
+    struct pipeline_test_ctx *test_ctx = talloc_get_type(*state,
+                                                 struct pipeline_test_ctx);
+
+    /* removes the fd event before the socket is closed */
+    talloc_free(test_ctx->cctx);
+    close(test_ctx->fds[0]);
+    close(test_ctx->fds[1]);
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void pipeline_send_req(struct pipeline_test_ctx *test_ctx,
+                              enum sss_cli_command cmd, uint32_t id,
+                              const void *body, size_t blen)
+{
+    uint32_t header[4];
+    ssize_t wb;
+
+    header[0] = SSS_NSS_HEADER_SIZE + blen;
+    header[1] = cmd;
+    header[2] = 0;
+    header[3] = id;
+
+    wb = write(test_ctx->fds[1], header, SSS_NSS_HEADER_SIZE);
+    assert_int_equal(wb, SSS_NSS_HEADER_SIZE);
+    wb = write(test_ctx->fds[1], body, blen);
+    assert_int_equal(wb, blen);
+}
+
+/* Runs the responder until len bytes were received by the client */
+static void pipeline_recv(struct pipeline_test_ctx *test_ctx,
+                          void *buf, size_t len)
+{
+    size_t pos = 0;
+    ssize_t rb;
+
+    while (pos < len) {
+        rb = recv(test_ctx->fds[1], (uint8_t *)buf + pos, len - pos,
+                  MSG_DONTWAIT);
+        if (rb == -1 && errno == EAGAIN) {
+            tevent_loop_once(test_ctx->ev);
+            continue;
+        }
+        assert_true(rb > 0);
+        pos += rb;
+    }
+}
+
+/* Receives a reply with a 32bit body and returns its id and body */
+static void pipeline_recv_rep(struct pipeline_test_ctx *test_ctx,
+                              uint32_t *_id, uint32_t *_value)
+{
+    uint32_t header[4];
+
+    pipeline_recv(test_ctx, header, SSS_NSS_HEADER_SIZE);
+    assert_int_equal(header[0], SSS_NSS_HEADER_SIZE + sizeof(uint32_t));
+    assert_int_equal(header[2], EOK);
+
+    pipeline_recv(test_ctx, _value, sizeof(uint32_t));
+    *_id = header[3];
+}
+
+static void pipeline_negotiate(struct pipeline_test_ctx *test_ctx)
+{
+    uint32_t body[2] = { 0, SSS_CLI_FEATURE_PIPELINE };
+    uint32_t header[4];
+    struct cli_protocol *pctx;
+
+    pipeline_send_req(test_ctx, SSS_GET_VERSION, 0, body, sizeof(body));
+
+    pipeline_recv(test_ctx, header, SSS_NSS_HEADER_SIZE);
+    assert_int_equal(header[0], SSS_NSS_HEADER_SIZE + sizeof(body));
+    pipeline_recv(test_ctx, body, sizeof(body));
+    assert_int_equal(body[1], SSS_CLI_FEATURE_PIPELINE);
+
+    pctx = talloc_get_type(test_ctx->cctx->protocol_ctx, struct cli_protocol);
+    assert_true(pctx->pipelined);
+}
+
+/* Sends the body of the request back as the reply */
+static void pipeline_reply(struct cli_ctx *cctx)
+{
+    struct cli_protocol *pctx;
+    uint8_t *req_body;
+    size_t req_blen;
+    uint8_t *body;
+    size_t blen;
+    errno_t ret;
+
+    pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
+    sss_packet_get_body(pctx->creq->in, &req_body, &req_blen);
+
+    ret = sss_packet_new(pctx->creq, req_blen,
+                         sss_packet_get_cmd(pctx->creq->in),
+                         &pctx->creq->out);
+    assert_int_equal(ret, EOK);
+    sss_packet_get_body(pctx->creq->out, &body, &blen);
+    memcpy(body, req_body, req_blen);
+
+    sss_cmd_done(cctx, NULL);
+}
+
+void test_pipeline_reply_ids(void **state)
+{
+    struct pipeline_test_ctx *test_ctx = talloc_get_type(*state,
+                                                 struct pipeline_test_ctx);
+    struct cli_protocol *pctx;
+    uint32_t value;
+    uint32_t id;
+    uint32_t i;
+
+    pipeline_negotiate(test_ctx);
+
+    /* back to back, the responder must not read past each request */
+    for (i = 0; i < 8; i++) {
+        pipeline_send_req(test_ctx, SSS_NSS_GETPWNAM, TEST_PIPELINE_ID(i),
+                          &i, sizeof(i));
+    }
+
+    while (test_ctx->num_received < 8) {
+        tevent_loop_once(test_ctx->ev);
+    }
+
+    /* finish the requests in the reverse order */
+    for (i = 8; i > 0; i--) {
+        pipeline_reply(test_ctx->received[i - 1]);
+    }
+
+    for (i = 0; i < 8; i++) {
+        pipeline_recv_rep(test_ctx, &id, &value);
+        assert_int_equal(value, 7 - i);
+        assert_int_equal(id, TEST_PIPELINE_ID(value));
+    }
+
+    pctx = talloc_get_type(test_ctx->cctx->protocol_ctx, struct cli_protocol);
+    assert_int_equal(pctx->num_inflight, 0);
+    assert_null(pctx->out_queue);
+}
+
+void test_pipeline_max_inflight(void **state)
+{
+    struct pipeline_test_ctx *test_ctx = talloc_get_type(*state,
+                                                 struct pipeline_test_ctx);
+    struct cli_protocol *pctx;
+    uint32_t value;
+    uint32_t id;
+    uint32_t i;
+
+    pipeline_negotiate(test_ctx);
+    pctx = talloc_get_type(test_ctx->cctx->protocol_ctx, struct cli_protocol);
+
+    for (i = 0; i < TEST_PIPELINE_MAX_REQS; i++) {
+        pipeline_send_req(test_ctx, SSS_NSS_GETPWNAM, TEST_PIPELINE_ID(i),
+                          &i, sizeof(i));
+    }
+
+    while (test_ctx->num_received < TEST_PIPELINE_MAX_INFLIGHT) {
+        tevent_loop_once(test_ctx->ev);
+    }
+
+    /* the connection is not read anymore */
+    assert_int_equal(pctx->num_inflight, TEST_PIPELINE_MAX_INFLIGHT);
+    assert_false(tevent_fd_get_flags(test_ctx->cctx->cfde) & TEVENT_FD_READ);
+
+    /* until a reply is sent */
+    pipeline_reply(test_ctx->received[0]);
+    pipeline_recv_rep(test_ctx, &id, &value);
+    assert_int_equal(value, 0);
+    assert_int_equal(id, TEST_PIPELINE_ID(0));
+    assert_true(tevent_fd_get_flags(test_ctx->cctx->cfde) & TEVENT_FD_READ);
+
+    while (test_ctx->num_received < TEST_PIPELINE_MAX_REQS) {
+        tevent_loop_once(test_ctx->ev);
+    }
+
+    for (i = 1; i < TEST_PIPELINE_MAX_REQS; i++) {
+        pipeline_reply(test_ctx->received[i]);
+    }
+
+    for (i = 1; i < TEST_PIPELINE_MAX_REQS; i++) {
+        pipeline_recv_rep(test_ctx, &id, &value);
+        assert_int_equal(value, i);
+        assert_int_equal(id, TEST_PIPELINE_ID(value));
+    }
+
+    assert_int_equal(pctx->num_inflight, 0);
+}
+
 int main(int argc, const char *argv[])
 {
     int rv;
@@ -325,6 +807,15 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sss_output_fqname,
                                         parse_inp_test_setup,
                                         parse_inp_test_teardown),
+        cmocka_unit_test(test_sss_packet_send_chunks),
+        cmocka_unit_test(test_sss_packet_set_size_chunks),
+        cmocka_unit_test(test_sss_packet_flatten),
+        cmocka_unit_test_setup_teardown(test_pipeline_reply_ids,
+                                        pipeline_test_setup,
+                                        pipeline_test_teardown),
+        cmocka_unit_test_setup_teardown(test_pipeline_max_inflight,
+                                        pipeline_test_setup,
+                                        pipeline_test_teardown),
     };
 
     /* Set debug level to invalid value so we can decide if -d 0 was used. */
@@ -0,0 +1,400 @@
+/*
+    SSSD
+
+    NSS client - Tests of the pipelined connection
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <popt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "sss_client/sss_cli.h"
+
+/* SSS_NSS_SOCKET_NAME is overridden to TESTS_PATH"/nss" in Makefile.am */
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_SOCKET TESTS_PATH"/nss"
+
+#define TEST_NUM_THREADS 8
+#define TEST_MAX_REQS 64
+
+/* A minimal NSS responder. It reads a batch of requests of a connection
+ * before it answers them in reverse order, so each reply can only reach the
+ * right thread if the client matches it by the request id. */
+struct fake_nss {
+    int lsd;
+    pthread_t thread;
+
+    pthread_mutex_t mtx;    /* protects everything below */
+    unsigned int batch;
+    unsigned int connections;
+    unsigned int requests;
+    uint32_t ids[TEST_MAX_REQS];
+};
+
+static struct fake_nss fake_nss = {
+    .lsd = -1,
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+};
+
+struct fake_req {
+    uint32_t header[4];
+    uint8_t body[64];
+};
+
+static int read_exact(int fd, void *buf, size_t len)
+{
+    size_t pos = 0;
+    ssize_t rb;
+
+    while (pos < len) {
+        rb = read(fd, (uint8_t *)buf + pos, len - pos);
+        if (rb == -1 && errno == EINTR) {
+            continue;
+        }
+        if (rb <= 0) {
+            return -1;
+        }
+        pos += rb;
+    }
+
+    return 0;
+}
+
+static int write_exact(int fd, const void *buf, size_t len)
+{
+    size_t pos = 0;
+    ssize_t wb;
+
+    while (pos < len) {
+        wb = write(fd, (const uint8_t *)buf + pos, len - pos);
+        if (wb == -1 && errno == EINTR) {
+            continue;
+        }
+        if (wb <= 0) {
+            return -1;
+        }
+        pos += wb;
+    }
+
+    return 0;
+}
+
+static int fake_nss_read_req(int fd, struct fake_req *req)
+{
+    size_t len;
+
+    if (read_exact(fd, req->header, SSS_NSS_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    len = req->header[0] - SSS_NSS_HEADER_SIZE;
+    if (req->header[0] < SSS_NSS_HEADER_SIZE || len > sizeof(req->body)) {
+        return -1;
+    }
+
+    return read_exact(fd, req->body, len);
+}
+
+static int fake_nss_reply(int fd, struct fake_req *req,
+                          const void *body, size_t len)
+{
+    uint32_t header[4];
+
+    header[0] = SSS_NSS_HEADER_SIZE + len;
+    header[1] = req->header[1];
+    header[2] = 0;
+    header[3] = req->header[3];
+
+    if (write_exact(fd, header, SSS_NSS_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    return write_exact(fd, body, len);
+}
+
+static void *fake_nss_conn(void *arg)
+{
+    struct fake_req reqs[TEST_MAX_REQS];
+    uint32_t version[2] = { SSS_NSS_PROTOCOL_VERSION,
+                            SSS_CLI_FEATURE_PIPELINE };
+    unsigned int batch;
+    unsigned int n;
+    int fd = (int)(intptr_t)arg;
+
+    /* only pipelined connections are served */
+    if (fake_nss_read_req(fd, &reqs[0]) != 0
+            || reqs[0].header[1] != SSS_GET_VERSION
+            || reqs[0].header[0] != SSS_NSS_HEADER_SIZE + sizeof(version)) {
+        goto done;
+    }
+    if (fake_nss_reply(fd, &reqs[0], version, sizeof(version)) != 0) {
+        goto done;
+    }
+
+    pthread_mutex_lock(&fake_nss.mtx);
+    fake_nss.connections++;
+    pthread_mutex_unlock(&fake_nss.mtx);
+
+    while (fake_nss_read_req(fd, &reqs[0]) == 0) {
+        pthread_mutex_lock(&fake_nss.mtx);
+        batch = fake_nss.batch;
+        pthread_mutex_unlock(&fake_nss.mtx);
+
+        for (n = 1; n < batch; n++) {
+            if (fake_nss_read_req(fd, &reqs[n]) != 0) {
+                goto done;
+            }
+        }
+
+        pthread_mutex_lock(&fake_nss.mtx);
+        for (n = 0; n < batch && fake_nss.requests < TEST_MAX_REQS; n++) {
+            fake_nss.ids[fake_nss.requests++] = reqs[n].header[3];
+        }
+        pthread_mutex_unlock(&fake_nss.mtx);
+
+        /* echo the request body */
+        for (n = batch; n > 0; n--) {
+            if (fake_nss_reply(fd, &reqs[n - 1], reqs[n - 1].body,
+                               reqs[n - 1].header[0] - SSS_NSS_HEADER_SIZE)
+                    != 0) {
+                goto done;
+            }
+        }
+    }
+
+done:
+    close(fd);
+    return NULL;
+}
+
+static void *fake_nss_accept(void *arg)
+{
+    pthread_t thread;
+    int fd;
+
+    while ((fd = accept(fake_nss.lsd, NULL, NULL)) != -1) {
+        if (pthread_create(&thread, NULL, fake_nss_conn,
+                           (void *)(intptr_t)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    return NULL;
+}
+
+static int fake_nss_setup(void **state)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int ret;
+
+    unlink(TEST_SOCKET);
+    strncpy(addr.sun_path, TEST_SOCKET, sizeof(addr.sun_path) - 1);
+
+    fake_nss.lsd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert_true(fake_nss.lsd != -1);
+
+    ret = bind(fake_nss.lsd, (struct sockaddr *)&addr, sizeof(addr));
+    assert_int_equal(ret, 0);
+    ret = listen(fake_nss.lsd, 16);
+    assert_int_equal(ret, 0);
+
+    ret = pthread_create(&fake_nss.thread, NULL, fake_nss_accept, NULL);
+    assert_int_equal(ret, 0);
+
+    return 0;
+}
+
+static int fake_nss_teardown(void **state)
+{
+    /* makes accept() fail */
+    shutdown(fake_nss.lsd, SHUT_RDWR);
+    pthread_join(fake_nss.thread, NULL);
+    close(fake_nss.lsd);
+    unlink(TEST_SOCKET);
+    return 0;
+}
+
+static void fake_nss_reset(unsigned int batch)
+{
+    pthread_mutex_lock(&fake_nss.mtx);
+    fake_nss.batch = batch;
+    fake_nss.requests = 0;
+    pthread_mutex_unlock(&fake_nss.mtx);
+}
+
+static bool lookup(unsigned int i)
+{
+    struct sss_cli_req_data rd;
+    enum nss_status nret;
+    uint8_t *repbuf = NULL;
+    size_t replen = 0;
+    char name[32];
+    int errnop = 0;
+    bool ok;
+
+    snprintf(name, sizeof(name), "user%u", i);
+    rd.len = strlen(name) + 1;
+    rd.data = name;
+
+    nret = sss_nss_make_request(SSS_NSS_GETPWNAM, &rd,
+                                &repbuf, &replen, &errnop);
+    ok = (nret == NSS_STATUS_SUCCESS && replen == rd.len
+            && memcmp(repbuf, name, replen) == 0);
+    free(repbuf);
+
+    return ok;
+}
+
+struct client_thread {
+    pthread_t thread;
+    unsigned int i;
+    bool ok;
+};
+
+static void *client_thread(void *arg)
+{
+    struct client_thread *ct = (struct client_thread *)arg;
+
+    ct->ok = lookup(ct->i);
+    return NULL;
+}
+
+/* Each thread has to get the reply to its own request although the replies
+ * come back in the reverse order and only one thread reads the socket */
+void test_pipeline_replies_reach_waiters(void **state)
+{
+    struct client_thread threads[TEST_NUM_THREADS];
+    unsigned int i;
+    unsigned int j;
+    int ret;
+
+    fake_nss_reset(TEST_NUM_THREADS);
+
+    for (i = 0; i < TEST_NUM_THREADS; i++) {
+        threads[i].i = i;
+        threads[i].ok = false;
+        ret = pthread_create(&threads[i].thread, NULL, client_thread,
+                             &threads[i]);
+        assert_int_equal(ret, 0);
+    }
+
+    for (i = 0; i < TEST_NUM_THREADS; i++) {
+        pthread_join(threads[i].thread, NULL);
+        assert_true(threads[i].ok);
+    }
+
+    /* all requests went over one connection with distinct ids */
+    pthread_mutex_lock(&fake_nss.mtx);
+    assert_int_equal(fake_nss.connections, 1);
+    assert_int_equal(fake_nss.requests, TEST_NUM_THREADS);
+    for (i = 0; i < TEST_NUM_THREADS; i++) {
+        assert_int_not_equal(fake_nss.ids[i], 0);
+        for (j = i + 1; j < TEST_NUM_THREADS; j++) {
+            assert_int_not_equal(fake_nss.ids[i], fake_nss.ids[j]);
+        }
+    }
+    pthread_mutex_unlock(&fake_nss.mtx);
+}
+
+/* A child process must not share the connection of its parent, the replies
+ * to its requests would be read by the parent or the other way round */
+void test_pipeline_fork(void **state)
+{
+    unsigned int connections;
+    pid_t pid;
+    int status;
+
+    fake_nss_reset(1);
+
+    /* make sure the parent has the connection open */
+    assert_true(lookup(1));
+
+    pthread_mutex_lock(&fake_nss.mtx);
+    connections = fake_nss.connections;
+    pthread_mutex_unlock(&fake_nss.mtx);
+
+    pid = fork();
+    assert_true(pid != -1);
+    if (pid == 0) {
+        _exit(lookup(2) ? 0 : 1);
+    }
+
+    assert_int_equal(waitpid(pid, &status, 0), pid);
+    assert_true(WIFEXITED(status));
+    assert_int_equal(WEXITSTATUS(status), 0);
+
+    /* the parent keeps using its own connection */
+    assert_true(lookup(3));
+
+    pthread_mutex_lock(&fake_nss.mtx);
+    assert_int_equal(fake_nss.connections, connections + 1);
+    pthread_mutex_unlock(&fake_nss.mtx);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_pipeline_replies_reach_waiters),
+        cmocka_unit_test(test_pipeline_fork),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* must be set before the first request */
+    setenv("SSS_PIPELINE", "YES", 1);
+    setenv("SSS_LOCKFREE", "YES", 1);
+
+    tests_set_cwd();
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, fake_nss_setup, fake_nss_teardown);
+    rmdir(TESTS_PATH);
+
+    return rv;
+}
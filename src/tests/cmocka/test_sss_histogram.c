@@ -0,0 +1,134 @@
+/*
+    SSSD
+
+    Histograms of latencies and sizes - tests
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests/cmocka/common_mock.h"
+#include "util/sss_histogram.h"
+
+/* the value reported for a percentile may be higher than the exact one by
+ * the width of its bucket */
+static void assert_close(uint64_t value, uint64_t exact)
+{
+    assert_true(value >= exact);
+    assert_true(value - exact <= exact / SSS_HISTOGRAM_SUB_COUNT);
+}
+
+void test_sss_histogram_percentile(void **state)
+{
+    struct sss_histogram *h;
+    uint64_t summary[SSS_HISTOGRAM_FIELDS];
+    uint64_t v;
+
+    h = talloc_zero(global_talloc_context, struct sss_histogram);
+    assert_non_null(h);
+
+    assert_int_equal(sss_histogram_percentile(h, 50), 0);
+
+    for (v = 1; v <= 100000; v++) {
+        sss_histogram_record(h, v);
+    }
+
+    assert_close(sss_histogram_percentile(h, 50), 50000);
+    assert_close(sss_histogram_percentile(h, 90), 90000);
+    assert_close(sss_histogram_percentile(h, 99), 99000);
+    assert_int_equal(sss_histogram_percentile(h, 0), 1);
+    assert_int_equal(sss_histogram_percentile(h, 100), 100000);
+
+    sss_histogram_summary(h, summary);
+    assert_int_equal(summary[SSS_HISTOGRAM_COUNT], 100000);
+    assert_int_equal(summary[SSS_HISTOGRAM_MIN], 1);
+    assert_int_equal(summary[SSS_HISTOGRAM_MEAN], 50000);
+    assert_int_equal(summary[SSS_HISTOGRAM_MAX], 100000);
+    assert_close(summary[SSS_HISTOGRAM_P999], 99900);
+
+    sss_histogram_reset(h);
+    assert_int_equal(h->count, 0);
+    assert_int_equal(sss_histogram_percentile(h, 99), 0);
+
+    talloc_free(h);
+}
+
+void test_sss_histogram_exact_small_values(void **state)
+{
+    struct sss_histogram *h;
+    uint64_t v;
+
+    h = talloc_zero(global_talloc_context, struct sss_histogram);
+    assert_non_null(h);
+
+    /* values below SSS_HISTOGRAM_SUB_COUNT * 2 have buckets of their own */
+    for (v = 0; v < SSS_HISTOGRAM_SUB_COUNT * 2; v++) {
+        sss_histogram_record(h, v);
+        assert_int_equal(sss_histogram_percentile(h, 100), v);
+        assert_int_equal(h->buckets[v], 1);
+    }
+
+    talloc_free(h);
+}
+
+void test_sss_histogram_overflow(void **state)
+{
+    struct sss_histogram *h;
+
+    h = talloc_zero(global_talloc_context, struct sss_histogram);
+    assert_non_null(h);
+
+    sss_histogram_record(h, 10);
+    sss_histogram_record(h, SSS_HISTOGRAM_MAX_VALUE * 4);
+    sss_histogram_record(h, UINT64_MAX);
+
+    assert_int_equal(h->buckets[SSS_HISTOGRAM_BUCKETS - 1], 2);
+    assert_int_equal(sss_histogram_percentile(h, 10), 10);
+    assert_true(sss_histogram_percentile(h, 50) >= SSS_HISTOGRAM_MAX_VALUE / 2);
+    assert_true(sss_histogram_percentile(h, 99) <= UINT64_MAX);
+    assert_int_equal(h->max, UINT64_MAX);
+
+    talloc_free(h);
+}
+
+void test_sss_histogram_merge(void **state)
+{
+    struct sss_histogram *a;
+    struct sss_histogram *b;
+    uint64_t v;
+
+    a = talloc_zero(global_talloc_context, struct sss_histogram);
+    assert_non_null(a);
+    b = talloc_zero(global_talloc_context, struct sss_histogram);
+    assert_non_null(b);
+
+    /* merging an empty histogram changes nothing */
+    sss_histogram_record(a, 500);
+    sss_histogram_merge(a, b);
+    assert_int_equal(a->count, 1);
+    assert_int_equal(a->min, 500);
+
+    for (v = 1; v <= 1000; v++) {
+        sss_histogram_record(b, v);
+    }
+    sss_histogram_merge(a, b);
+
+    assert_int_equal(a->count, 1001);
+    assert_int_equal(a->sum, 500 + 500500);
+    assert_int_equal(a->min, 1);
+    assert_int_equal(a->max, 1000);
+    assert_close(sss_histogram_percentile(a, 50), 500);
+
+    talloc_free(a);
+    talloc_free(b);
+}
@@ -0,0 +1,256 @@
+/*
+    SSSD
+
+    sysdb reader child protocol - tests
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "db/sysdb_reader.h"
+
+struct reader_test_ctx {
+    struct ldb_context *ldb;
+};
+
+static int test_reader_setup(void **state)
+{
+    struct reader_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct reader_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ldb = ldb_init(test_ctx, NULL);
+    assert_non_null(test_ctx->ldb);
+
+    check_leaks_push(test_ctx);
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_reader_teardown(void **state)
+{
+    struct reader_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct reader_test_ctx);
+
+    assert_true(check_leaks_pop(test_ctx));
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static uint8_t *frame_body(uint8_t *buf, size_t len, size_t *_body_len)
+{
+    uint32_t body_len;
+
+    memcpy(&body_len, buf, sizeof(uint32_t));
+    assert_int_equal(body_len, len - sizeof(uint32_t));
+
+    *_body_len = body_len;
+    return buf + sizeof(uint32_t);
+}
+
+void test_reader_request(void **state)
+{
+    struct reader_test_ctx *test_ctx;
+    const char *attrs[] = { "name", "uidNumber", NULL };
+    struct sysdb_reader_request in = {
+        .id = 42,
+        .scope = LDB_SCOPE_SUBTREE,
+        .ldb_file = "/var/lib/sss/db/cache_test.ldb",
+        .ts_file = NULL,
+        .base_dn = "cn=users,cn=test,cn=sysdb",
+        .filter = "(&(objectCategory=user)(name=user1))",
+        .attrs = attrs,
+    };
+    struct sysdb_reader_request *out;
+    uint8_t *buf;
+    uint8_t *body;
+    size_t len;
+    size_t body_len;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct reader_test_ctx);
+
+    ret = sysdb_reader_pack_request(test_ctx, &in, &buf, &len);
+    assert_int_equal(ret, EOK);
+    body = frame_body(buf, len, &body_len);
+
+    ret = sysdb_reader_unpack_request(test_ctx, body, body_len, &out);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(out->id, 42);
+    assert_int_equal(out->scope, LDB_SCOPE_SUBTREE);
+    assert_string_equal(out->ldb_file, in.ldb_file);
+    assert_null(out->ts_file);
+    assert_string_equal(out->base_dn, in.base_dn);
+    assert_string_equal(out->filter, in.filter);
+    assert_non_null(out->attrs);
+    assert_string_equal(out->attrs[0], "name");
+    assert_string_equal(out->attrs[1], "uidNumber");
+    assert_null(out->attrs[2]);
+    talloc_free(out);
+
+    /* A truncated request is rejected */
+    ret = sysdb_reader_unpack_request(test_ctx, body, body_len - 1, &out);
+    assert_int_equal(ret, EINVAL);
+
+    talloc_free(buf);
+}
+
+void test_reader_reply(void **state)
+{
+    struct reader_test_ctx *test_ctx;
+    struct ldb_message *msgs[2];
+    struct ldb_message **out;
+    size_t out_count;
+    uint8_t *buf;
+    uint8_t *body;
+    size_t len;
+    size_t body_len;
+    uint32_t id;
+    errno_t error;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct reader_test_ctx);
+
+    msgs[0] = ldb_msg_new(test_ctx);
+    assert_non_null(msgs[0]);
+    msgs[0]->dn = ldb_dn_new(msgs[0], test_ctx->ldb,
+                             "name=user1,cn=users,cn=test,cn=sysdb");
+    assert_non_null(msgs[0]->dn);
+    ret = ldb_msg_add_string(msgs[0], "name", "user1");
+    assert_int_equal(ret, LDB_SUCCESS);
+    ret = ldb_msg_add_string(msgs[0], "memberOf", "name=g1,cn=groups");
+    assert_int_equal(ret, LDB_SUCCESS);
+    ret = ldb_msg_add_string(msgs[0], "memberOf", "name=g2,cn=groups");
+    assert_int_equal(ret, LDB_SUCCESS);
+
+    msgs[1] = ldb_msg_new(test_ctx);
+    assert_non_null(msgs[1]);
+    msgs[1]->dn = ldb_dn_new(msgs[1], test_ctx->ldb,
+                             "name=user2,cn=users,cn=test,cn=sysdb");
+    assert_non_null(msgs[1]->dn);
+
+    ret = sysdb_reader_pack_reply(test_ctx, 7, EOK, 2, msgs, &buf, &len);
+    assert_int_equal(ret, EOK);
+    body = frame_body(buf, len, &body_len);
+
+    ret = sysdb_reader_unpack_reply_header(body, body_len, &id, &error);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(id, 7);
+    assert_int_equal(error, EOK);
+
+    ret = sysdb_reader_unpack_reply(test_ctx, test_ctx->ldb, body, body_len,
+                                    &out_count, &out);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(out_count, 2);
+    assert_string_equal(ldb_dn_get_linearized(out[0]->dn),
+                        "name=user1,cn=users,cn=test,cn=sysdb");
+    assert_string_equal(ldb_msg_find_attr_as_string(out[0], "name", NULL),
+                        "user1");
+    assert_int_equal(ldb_msg_find_element(out[0], "memberOf")->num_values, 2);
+    assert_int_equal(out[1]->num_elements, 0);
+    talloc_free(out);
+
+    /* A truncated reply is rejected */
+    ret = sysdb_reader_unpack_reply(test_ctx, test_ctx->ldb, body,
+                                    body_len - 1, &out_count, &out);
+    assert_int_equal(ret, EINVAL);
+
+    talloc_free(buf);
+    talloc_free(msgs[0]);
+    talloc_free(msgs[1]);
+}
+
+void test_reader_reply_error(void **state)
+{
+    struct reader_test_ctx *test_ctx;
+    struct ldb_message **out;
+    size_t out_count;
+    uint8_t *buf;
+    uint8_t *body;
+    size_t len;
+    size_t body_len;
+    uint32_t id;
+    errno_t error;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct reader_test_ctx);
+
+    ret = sysdb_reader_pack_reply(test_ctx, 9, ENOENT, 0, NULL, &buf, &len);
+    assert_int_equal(ret, EOK);
+    body = frame_body(buf, len, &body_len);
+
+    ret = sysdb_reader_unpack_reply_header(body, body_len, &id, &error);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(id, 9);
+    assert_int_equal(error, ENOENT);
+
+    ret = sysdb_reader_unpack_reply(test_ctx, test_ctx->ldb, body, body_len,
+                                    &out_count, &out);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(out_count, 0);
+    talloc_free(out);
+
+    talloc_free(buf);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_reader_request,
+                                        test_reader_setup,
+                                        test_reader_teardown),
+        cmocka_unit_test_setup_teardown(test_reader_reply,
+                                        test_reader_setup,
+                                        test_reader_teardown),
+        cmocka_unit_test_setup_teardown(test_reader_reply_error,
+                                        test_reader_setup,
+                                        test_reader_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
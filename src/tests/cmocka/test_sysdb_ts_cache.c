@@ -1707,6 +1707,471 @@ static void test_sysdb_group_missing_ts(void **state)
     talloc_zfree(groupdn);
 }
 
+static void store_objects(struct sysdb_ts_test_ctx *test_ctx,
+                          const char *gecos,
+                          time_t now)
+{
+    struct sysdb_store_obj objs[3];
+    errno_t ret;
+    size_t i;
+
+    memset(objs, 0, sizeof(objs));
+
+    objs[0].type = SYSDB_USER;
+    objs[0].name = TEST_USER_NAME;
+    objs[0].uid = TEST_USER_UID;
+    objs[0].gid = TEST_USER_GID;
+    objs[0].gecos = gecos;
+    objs[0].homedir = "/home/"TEST_USER_NAME;
+    objs[0].shell = "/bin/bash";
+
+    objs[1].type = SYSDB_GROUP;
+    objs[1].name = TEST_GROUP_NAME;
+    objs[1].gid = TEST_GROUP_GID;
+
+    objs[2].type = SYSDB_GROUP;
+    objs[2].name = TEST_GROUP_NAME_2;
+    objs[2].gid = TEST_GROUP_GID_2;
+
+    for (i = 0; i < 3; i++) {
+        objs[i].attrs = create_modstamp_attrs(test_ctx, TEST_MODSTAMP_1);
+        assert_non_null(objs[i].attrs);
+    }
+
+    ret = sysdb_store_objects(test_ctx->tctx->dom, objs, 3,
+                              TEST_CACHE_TIMEOUT, now);
+    assert_int_equal(ret, EOK);
+
+    for (i = 0; i < 3; i++) {
+        assert_int_equal(objs[i].ret, EOK);
+        talloc_free(objs[i].attrs);
+    }
+}
+
+static void test_sysdb_store_objects(void **state)
+{
+    struct sysdb_ts_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                     struct sysdb_ts_test_ctx);
+    struct ldb_result *res = NULL;
+    uint64_t cache_expire_sysdb;
+    uint64_t cache_expire_ts;
+
+    /* New objects are added to both caches */
+    store_objects(test_ctx, "gecos", TEST_NOW_1);
+
+    res = sysdb_getpwnam_res(test_ctx, test_ctx->tctx->dom, TEST_USER_NAME);
+    assert_int_equal(res->count, 1);
+    assert_string_equal(ldb_msg_find_attr_as_string(res->msgs[0],
+                                                    SYSDB_GECOS, NULL),
+                        "gecos");
+    talloc_free(res);
+
+    res = sysdb_getgrnam_res(test_ctx, test_ctx->tctx->dom, TEST_GROUP_NAME_2);
+    assert_int_equal(res->count, 1);
+    talloc_free(res);
+
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    get_gr_timestamp_attrs(test_ctx, TEST_GROUP_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    /* Storing the same objects again only bumps the timestamp cache */
+    store_objects(test_ctx, "gecos", TEST_NOW_2);
+
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_2);
+
+    get_gr_timestamp_attrs(test_ctx, TEST_GROUP_NAME_2,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_2);
+
+    /* A changed attribute updates only the changed object in the cache */
+    store_objects(test_ctx, "new gecos", TEST_NOW_3);
+
+    res = sysdb_getpwnam_res(test_ctx, test_ctx->tctx->dom, TEST_USER_NAME);
+    assert_int_equal(res->count, 1);
+    assert_string_equal(ldb_msg_find_attr_as_string(res->msgs[0],
+                                                    SYSDB_GECOS, NULL),
+                        "new gecos");
+    talloc_free(res);
+
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_3);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_3);
+
+    get_gr_timestamp_attrs(test_ctx, TEST_GROUP_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_3);
+}
+
+static void assert_closure(struct sysdb_ts_test_ctx *test_ctx,
+                           errno_t exp_ret,
+                           size_t exp_count)
+{
+    struct ldb_message **msgs = NULL;
+    struct ldb_dn *userdn;
+    size_t count = 0;
+    errno_t ret;
+
+    userdn = sysdb_user_dn(test_ctx, test_ctx->tctx->dom, TEST_USER_NAME);
+    assert_non_null(userdn);
+
+    ret = sysdb_initgr_closure_get(test_ctx, test_ctx->tctx->dom, userdn,
+                                   &count, &msgs);
+    assert_int_equal(ret, exp_ret);
+
+    if (ret == EOK) {
+        assert_int_equal(count, exp_count);
+        /* sorted by GID */
+        assert_int_equal(ldb_msg_find_attr_as_uint64(msgs[0],
+                                                     SYSDB_GIDNUM, 0),
+                         TEST_GROUP_GID);
+        if (count > 1) {
+            assert_int_equal(ldb_msg_find_attr_as_uint64(msgs[1],
+                                                         SYSDB_GIDNUM, 0),
+                             TEST_GROUP_GID_2);
+        }
+        talloc_free(msgs);
+    }
+
+    talloc_free(userdn);
+}
+
+static void assert_initgroups(struct sysdb_ts_test_ctx *test_ctx,
+                              unsigned int exp_count)
+{
+    struct ldb_result *res = NULL;
+    errno_t ret;
+
+    ret = sysdb_initgroups(test_ctx, test_ctx->tctx->dom, TEST_USER_NAME,
+                           &res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(res->count, exp_count);
+    assert_string_equal(ldb_msg_find_attr_as_string(res->msgs[0],
+                                                    SYSDB_NAME, NULL),
+                        TEST_USER_NAME);
+    assert_int_equal(ldb_msg_find_attr_as_uint64(res->msgs[1],
+                                                 SYSDB_GIDNUM, 0),
+                     TEST_GROUP_GID);
+    talloc_free(res);
+}
+
+static void test_sysdb_initgr_closure(void **state)
+{
+    struct sysdb_ts_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                     struct sysdb_ts_test_ctx);
+    struct sysdb_attrs *group_attrs;
+    struct ldb_result *res;
+    unsigned int i;
+    errno_t ret;
+
+    test_ctx->tctx->dom->initgr_closure = true;
+
+    /* The user is a member of the second group through the first one */
+    store_objects(test_ctx, "gecos", TEST_NOW_1);
+
+    ret = sysdb_add_group_member(test_ctx->tctx->dom, TEST_GROUP_NAME,
+                                 TEST_USER_NAME, SYSDB_MEMBER_USER, false);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_group_member(test_ctx->tctx->dom, TEST_GROUP_NAME_2,
+                                 TEST_GROUP_NAME, SYSDB_MEMBER_GROUP, false);
+    assert_int_equal(ret, EOK);
+
+    assert_closure(test_ctx, ENOENT, 0);
+
+    /* Lookups only read the index */
+    assert_initgroups(test_ctx, 3);
+    assert_closure(test_ctx, ENOENT, 0);
+
+    /* The backend stores it once the groups are saved */
+    ret = sysdb_initgr_closure_update(test_ctx->tctx->dom, TEST_USER_NAME);
+    assert_int_equal(ret, EOK);
+    assert_closure(test_ctx, EOK, 2);
+    assert_initgroups(test_ctx, 3);
+
+    /* Refreshing only the timestamps keeps the index */
+    store_objects(test_ctx, "gecos", TEST_NOW_2);
+    assert_closure(test_ctx, EOK, 2);
+
+    /* So do changes to the cache that leave the groups of the user alone */
+    group_attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(group_attrs);
+
+    ret = sysdb_store_group(test_ctx->tctx->dom, TEST_GROUP_NAME_3,
+                            TEST_GROUP_GID_3, group_attrs, TEST_CACHE_TIMEOUT,
+                            TEST_NOW_2);
+    assert_int_equal(ret, EOK);
+    talloc_free(group_attrs);
+    assert_closure(test_ctx, EOK, 2);
+
+    /* Changing a group of the user drops it, so the new GID is returned */
+    group_attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(group_attrs);
+    ret = sysdb_attrs_add_uint32(group_attrs, SYSDB_GIDNUM,
+                                 TEST_GROUP_GID_2 + 100);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_set_group_attr(test_ctx->tctx->dom, TEST_GROUP_NAME_2,
+                               group_attrs, SYSDB_MOD_REP);
+    assert_int_equal(ret, EOK);
+    assert_closure(test_ctx, ENOENT, 0);
+
+    ret = sysdb_initgroups(test_ctx, test_ctx->tctx->dom, TEST_USER_NAME,
+                           &res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(res->count, 3);
+    for (i = 1; i < res->count; i++) {
+        if (ldb_msg_find_attr_as_uint64(res->msgs[i], SYSDB_GIDNUM, 0)
+                == TEST_GROUP_GID_2 + 100) {
+            break;
+        }
+    }
+    assert_true(i < res->count);
+    talloc_free(res);
+    talloc_free(group_attrs);
+
+    group_attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(group_attrs);
+    ret = sysdb_attrs_add_uint32(group_attrs, SYSDB_GIDNUM, TEST_GROUP_GID_2);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_set_group_attr(test_ctx->tctx->dom, TEST_GROUP_NAME_2,
+                               group_attrs, SYSDB_MOD_REP);
+    assert_int_equal(ret, EOK);
+    talloc_free(group_attrs);
+
+    ret = sysdb_initgr_closure_update(test_ctx->tctx->dom, TEST_USER_NAME);
+    assert_int_equal(ret, EOK);
+    assert_closure(test_ctx, EOK, 2);
+
+    /* So does changing the memberships of the user */
+    ret = sysdb_remove_group_member(test_ctx->tctx->dom, TEST_GROUP_NAME_2,
+                                    TEST_GROUP_NAME, SYSDB_MEMBER_GROUP,
+                                    false);
+    assert_int_equal(ret, EOK);
+    assert_closure(test_ctx, ENOENT, 0);
+    assert_initgroups(test_ctx, 2);
+
+    ret = sysdb_initgr_closure_update(test_ctx->tctx->dom, TEST_USER_NAME);
+    assert_int_equal(ret, EOK);
+    assert_closure(test_ctx, EOK, 1);
+    assert_initgroups(test_ctx, 2);
+}
+
+/* Reads the expiration from the timestamp cache file, bypassing the
+ * pending updates */
+static uint64_t get_pw_ts_disk_timestamp(struct sysdb_ts_test_ctx *test_ctx,
+                                         const char *name)
+{
+    const char *attrs[] = { SYSDB_CACHE_EXPIRE, NULL };
+    struct ldb_result *res;
+    struct ldb_dn *dn;
+    uint64_t cache_expire_ts = 0;
+    int ret;
+
+    dn = sysdb_user_dn(test_ctx, test_ctx->tctx->dom, name);
+    assert_non_null(dn);
+
+    ret = ldb_search(test_ctx->tctx->sysdb->ldb_ts, test_ctx, &res,
+                     dn, LDB_SCOPE_BASE, attrs, NULL);
+    if (ret == LDB_SUCCESS && res->count == 1) {
+        cache_expire_ts = ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                      SYSDB_CACHE_EXPIRE, 0);
+    }
+
+    if (ret == LDB_SUCCESS) {
+        talloc_free(res);
+    }
+    talloc_free(dn);
+    return cache_expire_ts;
+}
+
+static void test_sysdb_ts_buffer(void **state)
+{
+    struct sysdb_ts_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                     struct sysdb_ts_test_ctx);
+    struct sysdb_ctx *sysdb = test_ctx->tctx->sysdb;
+    struct ldb_result *res = NULL;
+    uint64_t cache_expire_sysdb;
+    uint64_t cache_expire_ts;
+    errno_t ret;
+
+    ret = sysdb_ts_buffer_init(sysdb, test_ctx->tctx->ev, 60);
+    assert_int_equal(ret, EOK);
+
+    /* New entries are written right away */
+    store_objects(test_ctx, "gecos", TEST_NOW_1);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    /* A refresh is kept in memory, but the cache already returns it */
+    store_objects(test_ctx, "gecos", TEST_NOW_2);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_sysdb, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_2);
+
+    res = sysdb_getpwnam_res(test_ctx, test_ctx->tctx->dom, TEST_USER_NAME);
+    assert_int_equal(res->count, 1);
+    assert_int_equal(ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                 SYSDB_CACHE_EXPIRE, 0),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_2);
+    talloc_zfree(res);
+
+    ret = sysdb_ts_buffer_flush(sysdb);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_2);
+
+    /* Invalidating the entry is not undone by a pending refresh */
+    store_objects(test_ctx, "gecos", TEST_NOW_3);
+    ret = sysdb_invalidate_cache_entry(test_ctx->tctx->dom, TEST_USER_NAME,
+                                       true);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_ts_buffer_flush(sysdb);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME), 1);
+
+    /* The pending refresh of a deleted entry is dropped */
+    store_objects(test_ctx, "gecos", TEST_NOW_4);
+    ret = sysdb_delete_user(test_ctx->tctx->dom, TEST_USER_NAME, 0);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_ts_buffer_flush(sysdb);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME), 0);
+
+    ret = sysdb_ts_buffer_init(sysdb, test_ctx->tctx->ev, 0);
+    assert_int_equal(ret, EOK);
+}
+
+static void test_sysdb_ts_buffer_transaction(void **state)
+{
+    struct sysdb_ts_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                     struct sysdb_ts_test_ctx);
+    struct sysdb_ctx *sysdb = test_ctx->tctx->sysdb;
+    uint64_t cache_expire_sysdb;
+    uint64_t cache_expire_ts;
+    errno_t ret;
+
+    ret = sysdb_ts_buffer_init(sysdb, test_ctx->tctx->ev, 60);
+    assert_int_equal(ret, EOK);
+
+    store_objects(test_ctx, "gecos", TEST_NOW_1);
+
+    /* A refresh inside a cancelled transaction is dropped with it */
+    ret = sysdb_transaction_start(sysdb);
+    assert_int_equal(ret, EOK);
+
+    store_objects(test_ctx, "gecos", TEST_NOW_2);
+
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_2);
+
+    ret = sysdb_transaction_cancel(sysdb);
+    assert_int_equal(ret, EOK);
+
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    ret = sysdb_ts_buffer_flush(sysdb);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    /* A committed one is buffered like any other */
+    ret = sysdb_transaction_start(sysdb);
+    assert_int_equal(ret, EOK);
+
+    store_objects(test_ctx, "gecos", TEST_NOW_3);
+
+    ret = sysdb_transaction_commit(sysdb);
+    assert_int_equal(ret, EOK);
+
+    get_pw_timestamp_attrs(test_ctx, TEST_USER_NAME,
+                           &cache_expire_sysdb, &cache_expire_ts);
+    assert_int_equal(cache_expire_ts, TEST_CACHE_TIMEOUT + TEST_NOW_3);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    ret = sysdb_ts_buffer_flush(sysdb);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_3);
+
+    ret = sysdb_ts_buffer_init(sysdb, test_ctx->tctx->ev, 0);
+    assert_int_equal(ret, EOK);
+}
+
+static void test_sysdb_ts_buffer_search(void **state)
+{
+    struct sysdb_ts_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                     struct sysdb_ts_test_ctx);
+    struct sysdb_ctx *sysdb = test_ctx->tctx->sysdb;
+    struct ldb_result *ts_res;
+    errno_t ret;
+
+    ts_res = talloc_zero(test_ctx, struct ldb_result);
+    assert_non_null(ts_res);
+
+    ret = sysdb_ts_buffer_init(sysdb, test_ctx->tctx->ev, 60);
+    assert_int_equal(ret, EOK);
+
+    store_objects(test_ctx, "gecos", TEST_NOW_1);
+    store_objects(test_ctx, "gecos", TEST_NOW_3);
+
+    /* The pending refresh makes the user match ... */
+    ret = sysdb_search_ts_users(ts_res, test_ctx->tctx->dom,
+                                "("SYSDB_CACHE_EXPIRE">=300)",
+                                sysdb_ts_cache_attrs, ts_res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ts_res->count, 1);
+    assert_int_equal(ldb_msg_find_attr_as_uint64(ts_res->msgs[0],
+                                                 SYSDB_CACHE_EXPIRE, 0),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_3);
+
+    /* ... and no longer match the stored expiration */
+    ret = sysdb_search_ts_users(ts_res, test_ctx->tctx->dom,
+                                "("SYSDB_CACHE_EXPIRE"<=200)",
+                                sysdb_ts_cache_attrs, ts_res);
+    assert_int_equal(ret, ENOENT);
+
+    /* Filters on other attributes return the pending values as well */
+    ret = sysdb_search_ts_groups(ts_res, test_ctx->tctx->dom,
+                                 TS_FILTER_ALL, sysdb_ts_cache_attrs, ts_res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ts_res->count, 2);
+    assert_int_equal(ldb_msg_find_attr_as_uint64(ts_res->msgs[0],
+                                                 SYSDB_CACHE_EXPIRE, 0),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_3);
+    assert_int_equal(ldb_msg_find_attr_as_uint64(ts_res->msgs[1],
+                                                 SYSDB_CACHE_EXPIRE, 0),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_3);
+
+    /* None of the searches wrote the buffer */
+    assert_int_equal(get_pw_ts_disk_timestamp(test_ctx, TEST_USER_NAME),
+                     TEST_CACHE_TIMEOUT + TEST_NOW_1);
+
+    ret = sysdb_ts_buffer_init(sysdb, test_ctx->tctx->ev, 0);
+    assert_int_equal(ret, EOK);
+    talloc_free(ts_res);
+}
+
 int main(int argc, const char *argv[])
 {
     int rv;
@@ -1767,6 +2232,21 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sysdb_group_missing_ts,
                                         test_sysdb_ts_setup,
                                         test_sysdb_ts_teardown),
+        cmocka_unit_test_setup_teardown(test_sysdb_store_objects,
+                                        test_sysdb_ts_setup,
+                                        test_sysdb_ts_teardown),
+        cmocka_unit_test_setup_teardown(test_sysdb_initgr_closure,
+                                        test_sysdb_ts_setup,
+                                        test_sysdb_ts_teardown),
+        cmocka_unit_test_setup_teardown(test_sysdb_ts_buffer,
+                                        test_sysdb_ts_setup,
+                                        test_sysdb_ts_teardown),
+        cmocka_unit_test_setup_teardown(test_sysdb_ts_buffer_transaction,
+                                        test_sysdb_ts_setup,
+                                        test_sysdb_ts_teardown),
+        cmocka_unit_test_setup_teardown(test_sysdb_ts_buffer_search,
+                                        test_sysdb_ts_setup,
+                                        test_sysdb_ts_teardown),
     };
 
     /* Set debug level to invalid value so we can decide if -d 0 was used. */
@@ -40,5 +40,11 @@ void test_sss_ptr_hash_overwrite_with_free_cb(void **state);
 void test_sss_ptr_hash_with_lookup_cb(void **state);
 void test_sss_ptr_hash_without_cb(void **state);
 
+/* from src/tests/cmocka/test_sss_histogram.c */
+void test_sss_histogram_percentile(void **state);
+void test_sss_histogram_exact_small_values(void **state);
+void test_sss_histogram_overflow(void **state);
+void test_sss_histogram_merge(void **state);
+
 
 #endif /* __TESTS__CMOCKA__TEST_UTILS_H__ */
@@ -35,6 +35,8 @@ import pysss_murmur
 import ds_openldap
 import ldap_ent
 import sssd_id
+from sssd_nss import NssReturnCode
+from sssd_passwd import call_sssd_getpwnam, call_sssd_getpwuid
 from util import unindent
 
 LDAP_BASE_DN = "dc=example,dc=com"
@@ -366,6 +368,33 @@ def zero_timeout_rfc2307(request, ldap_conn):
     return None
 
 
+@pytest.fixture
+def warm_start_rfc2307(request, ldap_conn):
+    load_data_to_ldap(request, ldap_conn)
+
+    conf = unindent("""\
+        [sssd]
+        domains             = LDAP
+        services            = nss
+
+        [nss]
+        memcache_warm_start = true
+
+        [domain/LDAP]
+        ldap_auth_disable_tls_never_use_in_production = true
+        ldap_id_use_start_tls = false
+        ldap_schema         = rfc2307
+        id_provider         = ldap
+        auth_provider       = ldap
+        sudo_provider       = ldap
+        ldap_uri            = {ldap_conn.ds_inst.ldap_url}
+        ldap_search_base    = {ldap_conn.ds_inst.base_dn}
+    """).format(**locals())
+    create_conf_fixture(request, conf)
+    create_sssd_fixture(request)
+    return None
+
+
 @pytest.mark.converted('test_id.py', 'test_id__getpwuid')
 @pytest.mark.converted('test_id.py', 'test_id__getpwnam')
 def test_getpwnam(ldap_conn, sanity_rfc2307):
@@ -962,6 +991,7 @@ def get_random_string(length):
 
 class MemoryCache(object):
     SIZEOF_UINT32_T = 4
+    SIZEOF_HT_BUCKET = 64
 
     def __init__(self, path):
         with open(path, "rb") as fin:
@@ -970,14 +1000,15 @@ class MemoryCache(object):
             self.data_size = struct.unpack('i', fin.read(4))[0]
             self.ft_size = struct.unpack('i', fin.read(4))[0]
             hash_len = struct.unpack('i', fin.read(4))[0]
-            self.hash_size = hash_len / self.SIZEOF_UINT32_T
+            self.hash_buckets = hash_len // self.SIZEOF_HT_BUCKET
 
     def sss_nss_mc_hash(self, key):
+        """Index of the first hash table bucket probed for key"""
         input_key = key + '\0'
         input_len = len(key) + 1
 
         murmur_hash = pysss_murmur.murmurhash3(input_key, input_len, self.seed)
-        return murmur_hash % self.hash_size
+        return murmur_hash % self.hash_buckets
 
 
 def test_colliding_hashes(ldap_conn, sanity_rfc2307):
@@ -1102,6 +1133,60 @@ def test_mc_zero_timeout(ldap_conn, zero_timeout_rfc2307):
         grp.getgrgid(2001)
 
 
+def test_mc_warm_start(ldap_conn, warm_start_rfc2307):
+    """
+    Test that records cached before a restart are still served by the
+    memory cache when memcache_warm_start is enabled
+    """
+    ent.assert_passwd_by_name(
+        'user1',
+        dict(name='user1', passwd='*', uid=1001, gid=2001,
+             gecos='1001', shell='/bin/bash'))
+    ent.assert_group_by_name("group1", dict(name="group1", gid=2001))
+
+    stop_sssd()
+    if subprocess.call(["sssd", "-D", "--logger=files"]) != 0:
+        raise Exception("sssd start failed")
+
+    # records were not looked up since the restart, once sssd is stopped
+    # again they can only come from the memory cache kept across restart
+    stop_sssd()
+
+    ent.assert_passwd_by_name(
+        'user1',
+        dict(name='user1', passwd='*', uid=1001, gid=2001,
+             gecos='1001', shell='/bin/bash'))
+    ent.assert_passwd_by_uid(
+        1001,
+        dict(name='user1', passwd='*', uid=1001, gid=2001,
+             gecos='1001', shell='/bin/bash'))
+    ent.assert_group_by_name("group1", dict(name="group1", gid=2001))
+    ent.assert_group_by_gid(2001, dict(name="group1", gid=2001))
+
+    # entries which were not cached before the restart are not found
+    with pytest.raises(KeyError):
+        pwd.getpwnam('user2')
+
+
+def test_mc_negative_user(ldap_conn, sanity_rfc2307):
+    """
+    Test that users which do not exist are answered from the memory cache
+    """
+    res, _ = call_sssd_getpwnam('nonexistent_user')
+    assert res == NssReturnCode.NOTFOUND
+    res, _ = call_sssd_getpwuid(9999)
+    assert res == NssReturnCode.NOTFOUND
+
+    stop_sssd()
+
+    # without the negative records the client could not reach sssd and
+    # would return UNAVAIL
+    res, _ = call_sssd_getpwnam('nonexistent_user')
+    assert res == NssReturnCode.NOTFOUND
+    res, _ = call_sssd_getpwuid(9999)
+    assert res == NssReturnCode.NOTFOUND
+
+
 @pytest.mark.converted('test_memory_cache.py', 'test_memory_cache__disabled_cache')
 def test_disabled_mc(ldap_conn, disable_memcache_rfc2307):
     ent.assert_passwd_by_name(
@@ -160,17 +160,22 @@ def get_sssd_pid():
     return pid
 
 
+def stop_sssd_process():
+    """Stop the SSSD process and keep its state"""
+    pid = get_sssd_pid()
+    os.kill(pid, signal.SIGTERM)
+    while True:
+        try:
+            os.kill(pid, signal.SIGCONT)
+        except OSError:
+            break
+        time.sleep(1)
+
+
 def cleanup_sssd_process():
     """Stop the SSSD process and remove its state"""
     try:
-        pid = get_sssd_pid()
-        os.kill(pid, signal.SIGTERM)
-        while True:
-            try:
-                os.kill(pid, signal.SIGCONT)
-            except OSError:
-                break
-            time.sleep(1)
+        stop_sssd_process()
     except OSError:
         pass
     for path in os.listdir(config.DB_PATH):
@@ -513,6 +518,25 @@ def test_offline_netgroups(add_tripled_netgroup):
     assert netgrps == [("host", "user", "domain")]
 
 
+def test_netgroup_memory_cache(add_tripled_netgroup):
+    """
+    Netgroups looked up once are served from the memory cache.
+    """
+    res, _, netgrps = get_sssd_netgroups("adv_tripled_netgroup")
+    assert res == NssReturnCode.SUCCESS
+
+    # the memory cache stays usable while sssd is stopped
+    stop_sssd_process()
+
+    res, _, netgrps = get_sssd_netgroups("adv_tripled_netgroup")
+    assert res == NssReturnCode.SUCCESS
+    assert sorted(netgrps) == sorted([("host1", "user1", "domain1"),
+                                      ("host2", "user2", "domain2")])
+
+    res, _, netgrps = get_sssd_netgroups("tripled_netgroup")
+    assert res == NssReturnCode.UNAVAIL
+
+
 @pytest.fixture
 def add_thread_test_netgroup(request, ldap_conn):
     ent_list = ldap_ent.List(ldap_conn.ds_inst.base_dn)
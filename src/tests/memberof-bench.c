@@ -0,0 +1,407 @@
+/*
+   SSSD
+
+   memberof module benchmark
+
+   Builds chains of nested groups of several depths in a scratch cache and
+   times the operations the memberof module has to propagate along them:
+   adding a user to the innermost group, nesting a group with many members
+   into the innermost group and deleting that group again. Each operation
+   runs in its own transaction, as the providers do.
+
+   Run it with LDB_MODULES_PATH pointing to the directory holding the
+   memberof module that should be measured.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <talloc.h>
+#include <popt.h>
+
+#include "util/util.h"
+#include "db/sysdb.h"
+#include "tests/common.h"
+
+#define TESTS_PATH          "tp_memberof-bench"
+#define TEST_CONF_DB        "memberof-bench-conf.ldb"
+#define TEST_DOM_NAME       "memberof_bench"
+#define TEST_ID_PROVIDER    "ldap"
+
+#define DEFAULT_DEPTHS      "1,4,16,64,256"
+#define DEFAULT_MEMBERS     1000
+#define FIRST_ID            100000
+#define CACHE_TIMEOUT       86400
+
+struct bench_ctx {
+    struct sss_domain_info *domain;
+    int members;
+    int next_id;
+};
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *bench_name(TALLOC_CTX *mem_ctx,
+                              struct bench_ctx *bctx,
+                              const char *fmt, int depth, int n)
+{
+    char *name;
+
+    name = talloc_asprintf(mem_ctx, fmt, depth, n);
+    if (name == NULL) {
+        return NULL;
+    }
+
+    return sss_create_internal_fqname(mem_ctx, name, bctx->domain->name);
+}
+
+static errno_t bench_add_group(TALLOC_CTX *mem_ctx,
+                               struct bench_ctx *bctx,
+                               const char *fmt, int depth, int n,
+                               const char **_name)
+{
+    const char *name;
+    errno_t ret;
+
+    name = bench_name(mem_ctx, bctx, fmt, depth, n);
+    if (name == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_add_group(bctx->domain, name, bctx->next_id++, NULL,
+                          CACHE_TIMEOUT, time(NULL));
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_name = name;
+    return EOK;
+}
+
+static errno_t bench_add_user(TALLOC_CTX *mem_ctx,
+                              struct bench_ctx *bctx,
+                              const char *fmt, int depth, int n,
+                              const char **_name)
+{
+    const char *name;
+    uid_t id;
+    errno_t ret;
+
+    name = bench_name(mem_ctx, bctx, fmt, depth, n);
+    if (name == NULL) {
+        return ENOMEM;
+    }
+
+    id = bctx->next_id++;
+    ret = sysdb_add_user(bctx->domain, name, id, id, NULL, "/", "/bin/sh",
+                         NULL, NULL, CACHE_TIMEOUT, time(NULL));
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_name = name;
+    return EOK;
+}
+
+/* A chain of depth groups, each one a member of the next, and a group with
+ * bctx->members users that is not nested yet */
+static errno_t bench_setup(TALLOC_CTX *mem_ctx,
+                           struct bench_ctx *bctx,
+                           int depth,
+                           const char ***_chain,
+                           const char **_wide)
+{
+    struct sysdb_ctx *sysdb = bctx->domain->sysdb;
+    const char **chain;
+    const char *wide;
+    const char *user;
+    bool in_transaction = false;
+    errno_t ret;
+    int i;
+
+    chain = talloc_array(mem_ctx, const char *, depth);
+    if (chain == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_transaction_start(sysdb);
+    if (ret != EOK) {
+        return ret;
+    }
+    in_transaction = true;
+
+    for (i = 0; i < depth; i++) {
+        ret = bench_add_group(chain, bctx, "d%d_chain%d", depth, i, &chain[i]);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        if (i > 0) {
+            ret = sysdb_add_group_member(bctx->domain, chain[i], chain[i - 1],
+                                         SYSDB_MEMBER_GROUP, false);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    ret = bench_add_group(mem_ctx, bctx, "d%d_wide%d", depth, 0, &wide);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (i = 0; i < bctx->members; i++) {
+        ret = bench_add_user(chain, bctx, "d%d_member%d", depth, i, &user);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        ret = sysdb_add_group_member(bctx->domain, wide, user,
+                                     SYSDB_MEMBER_USER, false);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = sysdb_transaction_commit(sysdb);
+    if (ret != EOK) {
+        goto done;
+    }
+    in_transaction = false;
+
+    *_chain = chain;
+    *_wide = wide;
+
+done:
+    if (in_transaction) {
+        sysdb_transaction_cancel(sysdb);
+    }
+    if (ret != EOK) {
+        talloc_free(chain);
+    }
+    return ret;
+}
+
+static errno_t bench_add_member(struct bench_ctx *bctx,
+                                const char *group,
+                                const char *member,
+                                enum sysdb_member_type type,
+                                double *_elapsed)
+{
+    struct sysdb_ctx *sysdb = bctx->domain->sysdb;
+    double start;
+    errno_t ret;
+
+    start = bench_now();
+
+    ret = sysdb_transaction_start(sysdb);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sysdb_add_group_member(bctx->domain, group, member, type, false);
+    if (ret != EOK) {
+        sysdb_transaction_cancel(sysdb);
+        return ret;
+    }
+
+    ret = sysdb_transaction_commit(sysdb);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_elapsed = bench_now() - start;
+    return EOK;
+}
+
+static errno_t bench_delete_group(struct bench_ctx *bctx,
+                                  const char *group,
+                                  double *_elapsed)
+{
+    struct sysdb_ctx *sysdb = bctx->domain->sysdb;
+    double start;
+    errno_t ret;
+
+    start = bench_now();
+
+    ret = sysdb_transaction_start(sysdb);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sysdb_delete_group(bctx->domain, group, 0);
+    if (ret != EOK) {
+        sysdb_transaction_cancel(sysdb);
+        return ret;
+    }
+
+    ret = sysdb_transaction_commit(sysdb);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_elapsed = bench_now() - start;
+    return EOK;
+}
+
+static errno_t bench_depth(struct bench_ctx *bctx, int depth)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char **chain;
+    const char *wide;
+    const char *user;
+    double add_user;
+    double add_group;
+    double del_group;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = bench_setup(tmp_ctx, bctx, depth, &chain, &wide);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = bench_add_user(tmp_ctx, bctx, "d%d_single%d", depth, 0, &user);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* the user inherits all the groups of the chain */
+    ret = bench_add_member(bctx, chain[0], user, SYSDB_MEMBER_USER,
+                           &add_user);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* every member of the wide group inherits all the groups of the chain
+     * and every group of the chain gets all their names */
+    ret = bench_add_member(bctx, chain[0], wide, SYSDB_MEMBER_GROUP,
+                           &add_group);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* and all of that has to be taken back */
+    ret = bench_delete_group(bctx, wide, &del_group);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    printf("depth %5d: add user %10.3f ms, nest group %10.3f ms, "
+           "delete group %10.3f ms\n",
+           depth, add_user * 1e3, add_group * 1e3, del_group * 1e3);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    struct bench_ctx bctx = { 0 };
+    struct sss_test_ctx *test_ctx = NULL;
+    const char *depths = DEFAULT_DEPTHS;
+    const char *p;
+    char *end;
+    long depth;
+    int debug = SSSDBG_DEFAULT;
+    errno_t ret;
+
+    bctx.members = DEFAULT_MEMBERS;
+    bctx.next_id = FIRST_ID;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "debug", '\0', POPT_ARG_INT | POPT_ARGFLAG_DOC_HIDDEN, &debug,
+                    0, "The debug level to run with", NULL },
+        { "depths", 'd', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &depths, 0, "Comma separated nesting depths", NULL },
+        { "members", 'm', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.members, 0,
+                    "Number of users in the group that is nested and deleted",
+                    NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+            default:
+                fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                        poptBadOption(pc, 0), poptStrerror(opt));
+                poptPrintUsage(pc, stderr, 0);
+                poptFreeContext(pc);
+                return 1;
+        }
+    }
+
+    if (bctx.members < 0) {
+        poptPrintUsage(pc, stderr, 0);
+        poptFreeContext(pc);
+        return 1;
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug);
+
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = create_dom_test_ctx(NULL, TESTS_PATH, TEST_CONF_DB,
+                                   TEST_DOM_NAME, TEST_ID_PROVIDER, NULL);
+    if (test_ctx == NULL) {
+        fprintf(stderr, "Cannot create the scratch cache\n");
+        ret = EIO;
+        goto done;
+    }
+    bctx.domain = test_ctx->dom;
+
+    printf("%d users in the nested group\n", bctx.members);
+
+    ret = EOK;
+    for (p = depths; *p != '\0'; p = end + (*end == ',' ? 1 : 0)) {
+        depth = strtol(p, &end, 10);
+        if (end == p || depth <= 0 || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Invalid depth list: %s\n", depths);
+            ret = EINVAL;
+            goto done;
+        }
+
+        ret = bench_depth(&bctx, depth);
+        if (ret != EOK) {
+            fprintf(stderr, "Depth %ld failed: %s\n", depth, sss_strerror(ret));
+            goto done;
+        }
+    }
+
+done:
+    talloc_free(test_ctx);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    return ret == EOK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
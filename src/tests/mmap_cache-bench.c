@@ -0,0 +1,326 @@
+/*
+   SSSD
+
+   Mmap cache hash table microbenchmark
+
+   Compares lookups in the chained hash table used by mmap cache files
+   before major version 2 with the cache line bucketed open addressing
+   index used since then. Both layouts index the same data table.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <popt.h>
+
+#include "util/util.h"
+#include "util/mmap_cache.h"
+
+#define DEFAULT_RECORDS     500000
+#define DEFAULT_LOOKUPS     5000000
+#define RECORD_SLOTS        4
+#define NAME_LEN            32
+
+struct bench_ctx {
+    uint32_t seed;
+    uint32_t num_records;
+    uint32_t n_elem;
+
+    uint8_t *data_table;
+    uint32_t dt_size;
+
+    /* layout before major version 2 */
+    uint32_t *chain_table;
+    uint32_t chain_elems;
+
+    /* cache line bucketed index */
+    struct sss_mc_ht_bucket *index;
+    uint32_t index_size;
+
+    uint64_t probes;
+};
+
+static struct sss_mc_rec *bench_rec(struct bench_ctx *bctx, uint32_t slot)
+{
+    return MC_SLOT_TO_PTR(bctx->data_table, slot, struct sss_mc_rec);
+}
+
+static const char *bench_rec_name(struct sss_mc_rec *rec)
+{
+    return (const char *)rec->data;
+}
+
+static void bench_gen_name(char *buf, uint32_t i)
+{
+    snprintf(buf, NAME_LEN, "user%08"PRIu32"@bench.example.com", i);
+}
+
+static uint32_t *chain_next(struct sss_mc_rec *rec, uint32_t hash)
+{
+    return (rec->hash1 == hash) ? &rec->next1 : &rec->next2;
+}
+
+static void chain_add(struct bench_ctx *bctx, uint32_t slot, uint32_t hash)
+{
+    uint32_t *next;
+    uint32_t cur;
+
+    hash %= bctx->chain_elems;
+    next = &bctx->chain_table[hash];
+    while (*next != MC_INVALID_VAL) {
+        cur = *next;
+        next = chain_next(bench_rec(bctx, cur), hash);
+    }
+    *next = slot;
+}
+
+static void index_add(struct bench_ctx *bctx, uint32_t slot, uint32_t hash)
+{
+    struct sss_mc_ht_bucket *bucket;
+    uint32_t n_buckets;
+    uint32_t entry;
+    uint32_t pos;
+
+    n_buckets = MC_HT_BUCKETS(bctx->index_size);
+    for (pos = 0; pos < MC_HT_ELEMS(bctx->index_size); pos++) {
+        bucket = &bctx->index[MC_HT_POS_BUCKET(hash, pos, n_buckets)];
+        entry = MC_HT_POS_ENTRY(pos);
+        if (bucket->slot[entry] == MC_INVALID_VAL) {
+            bucket->hash[entry] = hash;
+            bucket->slot[entry] = slot;
+            return;
+        }
+    }
+}
+
+static errno_t bench_setup(struct bench_ctx *bctx, uint32_t num_records)
+{
+    struct sss_mc_rec *rec;
+    char name[NAME_LEN];
+    char uid[11];
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t i;
+
+    bctx->seed = 0x5555aaaa;
+    bctx->num_records = num_records;
+    bctx->n_elem = MC_ALIGN64(num_records * RECORD_SLOTS);
+    bctx->dt_size = bctx->n_elem * MC_SLOT_SIZE;
+
+    /* sizes follow the ones used by the NSS responder for each layout */
+    bctx->chain_elems = bctx->n_elem;
+    bctx->index_size = MC_HT_SIZE(2 * bctx->n_elem);
+
+    bctx->data_table = malloc(bctx->dt_size);
+    bctx->chain_table = malloc(bctx->chain_elems * sizeof(uint32_t));
+    bctx->index = aligned_alloc(MC_CACHELINE, bctx->index_size);
+    if (bctx->data_table == NULL || bctx->chain_table == NULL
+            || bctx->index == NULL) {
+        return ENOMEM;
+    }
+
+    memset(bctx->data_table, 0xff, bctx->dt_size);
+    memset(bctx->chain_table, 0xff, bctx->chain_elems * sizeof(uint32_t));
+    memset(bctx->index, 0xff, bctx->index_size);
+
+    for (i = 0; i < num_records; i++) {
+        slot = i * RECORD_SLOTS;
+        rec = bench_rec(bctx, slot);
+
+        bench_gen_name(name, i);
+        snprintf(uid, sizeof(uid), "%"PRIu32, 10000 + i);
+
+        rec->len = RECORD_SLOTS * MC_SLOT_SIZE;
+        rec->next1 = MC_INVALID_VAL;
+        rec->next2 = MC_INVALID_VAL;
+        memcpy(rec->data, name, strlen(name) + 1);
+
+        hash = sss_mc_key_hash(name, strlen(name) + 1, bctx->seed);
+        rec->hash1 = hash % bctx->chain_elems;
+        chain_add(bctx, slot, hash);
+        index_add(bctx, slot, hash);
+
+        hash = sss_mc_key_hash(uid, strlen(uid) + 1, bctx->seed);
+        rec->hash2 = hash % bctx->chain_elems;
+        chain_add(bctx, slot, hash);
+        index_add(bctx, slot, hash);
+    }
+
+    return EOK;
+}
+
+static void bench_teardown(struct bench_ctx *bctx)
+{
+    free(bctx->data_table);
+    free(bctx->chain_table);
+    free(bctx->index);
+}
+
+static bool chain_lookup(struct bench_ctx *bctx, const char *name)
+{
+    struct sss_mc_rec *rec;
+    uint32_t hash;
+    uint32_t slot;
+
+    hash = sss_mc_key_hash(name, strlen(name) + 1, bctx->seed)
+                % bctx->chain_elems;
+    slot = bctx->chain_table[hash];
+    while (slot != MC_INVALID_VAL) {
+        rec = bench_rec(bctx, slot);
+        bctx->probes++;
+        if (rec->hash1 == hash && strcmp(bench_rec_name(rec), name) == 0) {
+            return true;
+        }
+        slot = *chain_next(rec, hash);
+    }
+
+    return false;
+}
+
+static bool index_lookup(struct bench_ctx *bctx, const char *name)
+{
+    struct sss_mc_rec *rec;
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t pos = 0;
+
+    hash = sss_mc_key_hash(name, strlen(name) + 1, bctx->seed);
+    while ((slot = sss_mc_ht_next_slot(bctx->index, bctx->index_size,
+                                       hash, &pos)) != MC_INVALID_VAL) {
+        rec = bench_rec(bctx, slot);
+        bctx->probes++;
+        if (strcmp(bench_rec_name(rec), name) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int bench_run(struct bench_ctx *bctx, const char *label,
+                     bool (*lookup)(struct bench_ctx *, const char *),
+                     uint32_t num_lookups, int miss_pct)
+{
+    char (*names)[NAME_LEN];
+    uint32_t found = 0;
+    uint32_t key;
+    uint32_t i;
+    double start;
+    double elapsed;
+
+    /* keys are generated up front so only the lookups are timed */
+    names = malloc(num_lookups * sizeof(*names));
+    if (names == NULL) {
+        return ENOMEM;
+    }
+
+    srandom(1);
+    for (i = 0; i < num_lookups; i++) {
+        key = random() % bctx->num_records;
+        if (random() % 100 < miss_pct) {
+            /* not present in the cache */
+            key += bctx->num_records;
+        }
+        bench_gen_name(names[i], key);
+    }
+
+    bctx->probes = 0;
+    start = bench_now();
+    for (i = 0; i < num_lookups; i++) {
+        if (lookup(bctx, names[i])) {
+            found++;
+        }
+    }
+    elapsed = bench_now() - start;
+    free(names);
+
+    printf("%-10s %10.1f ns/lookup %8.3f records/lookup %10"PRIu32" hits\n",
+           label, elapsed * 1e9 / num_lookups,
+           (double)bctx->probes / num_lookups, found);
+
+    return EOK;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int pc_records = DEFAULT_RECORDS;
+    int pc_lookups = DEFAULT_LOOKUPS;
+    int pc_miss = 10;
+    struct bench_ctx bctx = { 0 };
+    int ret;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "records", 'r', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_records, 0,
+                    "Number of records stored in the cache", NULL },
+        { "lookups", 'l', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_lookups, 0,
+                    "Number of lookups to run for each layout", NULL },
+        { "miss", 'm', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_miss, 0,
+                    "Percentage of lookups for keys not in the cache", NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+            default:
+                fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                        poptBadOption(pc, 0), poptStrerror(opt));
+                poptPrintUsage(pc, stderr, 0);
+                poptFreeContext(pc);
+                return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    if (pc_records <= 0 || pc_lookups <= 0 || pc_miss < 0 || pc_miss > 100) {
+        fprintf(stderr, "Invalid parameters\n");
+        return 1;
+    }
+
+    ret = bench_setup(&bctx, pc_records);
+    if (ret != EOK) {
+        fprintf(stderr, "Failed to set up the benchmark: %s\n",
+                strerror(ret));
+        bench_teardown(&bctx);
+        return 1;
+    }
+
+    printf("%d records, %d lookups, %d%% misses\n",
+           pc_records, pc_lookups, pc_miss);
+    ret = bench_run(&bctx, "chained", chain_lookup, pc_lookups, pc_miss);
+    if (ret == EOK) {
+        ret = bench_run(&bctx, "bucketed", index_lookup, pc_lookups, pc_miss);
+    }
+
+    bench_teardown(&bctx);
+    return ret == EOK ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/*
+   SSSD
+
+   Multithreaded mmap cache client benchmark
+
+   Resolves the same user from a growing number of threads and reports the
+   lookup rate for each thread count. The user must already be stored in
+   the fast memory cache, so run it against a running SSSD after a first
+   lookup of the user.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <pthread.h>
+#include <popt.h>
+
+#define DEFAULT_THREADS     8
+#define DEFAULT_SECONDS     2
+
+struct bench_thread {
+    pthread_t tid;
+    uid_t uid;
+    volatile int *stop;
+    unsigned long lookups;
+    int error;
+};
+
+static void *bench_thread_main(void *arg)
+{
+    struct bench_thread *bt = (struct bench_thread *)arg;
+    struct passwd pwd;
+    struct passwd *result;
+    char buf[4096];
+    int ret;
+
+    while (!*bt->stop) {
+        ret = getpwuid_r(bt->uid, &pwd, buf, sizeof(buf), &result);
+        if (ret != 0 || result == NULL) {
+            bt->error = (ret != 0) ? ret : ENOENT;
+            break;
+        }
+        bt->lookups++;
+    }
+
+    return NULL;
+}
+
+static int bench_run(uid_t uid, int num_threads, int seconds,
+                     double *_rate)
+{
+    struct bench_thread *threads;
+    volatile int stop = 0;
+    unsigned long lookups = 0;
+    int created;
+    int ret = 0;
+    int i;
+
+    threads = calloc(num_threads, sizeof(struct bench_thread));
+    if (threads == NULL) {
+        return ENOMEM;
+    }
+
+    for (created = 0; created < num_threads; created++) {
+        threads[created].uid = uid;
+        threads[created].stop = &stop;
+        ret = pthread_create(&threads[created].tid, NULL,
+                             bench_thread_main, &threads[created]);
+        if (ret != 0) {
+            break;
+        }
+    }
+
+    if (ret == 0) {
+        sleep(seconds);
+    }
+    stop = 1;
+
+    for (i = 0; i < created; i++) {
+        pthread_join(threads[i].tid, NULL);
+        if (threads[i].error != 0 && ret == 0) {
+            ret = threads[i].error;
+        }
+        lookups += threads[i].lookups;
+    }
+    free(threads);
+
+    *_rate = (double)lookups / seconds;
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int pc_uid = -1;
+    int pc_threads = DEFAULT_THREADS;
+    int pc_seconds = DEFAULT_SECONDS;
+    double single = 0;
+    double rate;
+    int threads;
+    int ret;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "uid", 'u', POPT_ARG_INT, &pc_uid, 0,
+                    "UID of a user stored in the memory cache", NULL },
+        { "threads", 't', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_threads, 0,
+                    "Highest number of threads to run", NULL },
+        { "seconds", 's', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_seconds, 0,
+                    "Duration of each run", NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+            default:
+                fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                        poptBadOption(pc, 0), poptStrerror(opt));
+                poptPrintUsage(pc, stderr, 0);
+                poptFreeContext(pc);
+                return 1;
+        }
+    }
+
+    if (pc_uid < 0 || pc_threads <= 0 || pc_seconds <= 0) {
+        poptPrintUsage(pc, stderr, 0);
+        poptFreeContext(pc);
+        return 1;
+    }
+    poptFreeContext(pc);
+
+    printf("%8s %14s %14s %8s\n",
+           "threads", "lookups/s", "per thread", "scaling");
+    for (threads = 1; threads <= pc_threads; threads *= 2) {
+        ret = bench_run(pc_uid, threads, pc_seconds, &rate);
+        if (ret != 0) {
+            fprintf(stderr, "Lookup of UID %d failed: %s\n",
+                    pc_uid, strerror(ret));
+            return 1;
+        }
+        if (threads == 1) {
+            single = rate;
+        }
+        printf("%8d %14.0f %14.0f %8.2f\n",
+               threads, rate, rate / threads, rate / single);
+    }
+
+    return 0;
+}
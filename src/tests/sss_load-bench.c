@@ -0,0 +1,994 @@
+/*
+   SSSD
+
+   Load generator for the NSS and PAM responders
+
+   Sends getpw*, getgr*, initgroups and PAM account requests from many
+   threads, each with its own connection speaking the raw client protocol,
+   and reports the throughput and the latency percentiles of each request
+   type. The lookups are measured in three tiers:
+
+     dp      each expired user stored by sss_load-fixture is looked up once,
+             so every request goes to the data provider
+     socket  the valid users and groups are looked up over the socket,
+             answered from the cache of the responder
+     mmap    the same lookups are answered from the fast memory cache,
+             without any request to the responder
+
+   The PAM requests always contact the data provider for the access check,
+   they are sent in the socket tier only.
+
+   Run the dp tier right after populating the cache and starting SSSD, the
+   socket tier also fills the fast memory cache for the mmap tier.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <pwd.h>
+#include <grp.h>
+#include <pthread.h>
+#include <popt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sss_client/sss_cli.h"
+#include "sss_client/nss_mc.h"
+#include "util/sss_histogram.h"
+
+#define DEFAULT_THREADS     8
+#define DEFAULT_SECONDS     5
+#define DEFAULT_COUNT       10000
+#define DEFAULT_GROUPS      1000
+#define DEFAULT_DP_COUNT    1000
+#define DEFAULT_FIRST_ID    200000
+
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#define NAME_LEN            256
+#define BUF_LEN             65536
+
+enum bench_op {
+    BENCH_GETPWNAM,
+    BENCH_GETPWUID,
+    BENCH_GETGRNAM,
+    BENCH_GETGRGID,
+    BENCH_INITGR,
+    BENCH_PAM,
+
+    BENCH_OPS
+};
+
+static const char *bench_op_names[] = {
+    "getpwnam",
+    "getpwuid",
+    "getgrnam",
+    "getgrgid",
+    "initgroups",
+    "pam",
+};
+
+enum bench_tier {
+    BENCH_TIER_DP,
+    BENCH_TIER_SOCKET,
+    BENCH_TIER_MMAP,
+
+    BENCH_TIERS
+};
+
+static const char *bench_tier_names[] = {
+    "dp",
+    "socket",
+    "mmap",
+};
+
+enum bench_result {
+    BENCH_FOUND,
+    BENCH_MISS,
+    BENCH_ERROR,
+};
+
+/* One request of a trace. */
+struct bench_req {
+    enum bench_op op;
+    char name[NAME_LEN];
+    uint32_t id;
+};
+
+struct bench_ctx {
+    const char *nss_socket;
+    const char *pam_socket;
+    const char *pam_service;
+
+    const char *user_prefix;
+    const char *group_prefix;
+    const char *dp_prefix;
+    int count;
+    int groups;
+    int dp_count;
+    int first_id;
+
+    bool ops[BENCH_OPS];
+
+    /* cumulative distribution of the names, NULL for uniform */
+    double *zipf_cdf;
+
+    /* replayed instead of the generated names if set */
+    struct bench_req *trace;
+    size_t trace_len;
+
+    /* next expired user to look up in the dp tier */
+    unsigned int dp_next;
+
+    volatile int stop;
+};
+
+struct bench_stats {
+    uint64_t results[3];
+    struct sss_histogram latency;
+};
+
+struct bench_thread {
+    pthread_t tid;
+    struct bench_ctx *bctx;
+    enum bench_tier tier;
+    unsigned int seed;
+    size_t trace_pos;
+
+    int nss_fd;
+    int pam_fd;
+    uint8_t buf[BUF_LEN];
+
+    struct bench_stats stats[BENCH_OPS];
+};
+
+static uint64_t bench_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* ---------------------------------------------------------------------
+ * Raw client protocol
+ * --------------------------------------------------------------------- */
+
+static int bench_write_all(int fd, const uint8_t *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int bench_read_all(int fd, uint8_t *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = read(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (n == 0) {
+            return EPIPE;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/* Sends the request @cmd with @body and reads the reply into bt->buf.
+ * The reply body starts at bt->buf + SSS_NSS_HEADER_SIZE. */
+static int bench_request(struct bench_thread *bt, int fd,
+                         enum sss_cli_command cmd,
+                         const uint8_t *body, size_t body_len,
+                         uint32_t *_status, size_t *_reply_len)
+{
+    uint8_t discard[4096];
+    uint32_t header[4];
+    size_t chunk;
+    size_t len;
+    int ret;
+
+    header[0] = SSS_NSS_HEADER_SIZE + body_len;
+    header[1] = cmd;
+    header[2] = 0;
+    header[3] = 0;
+
+    ret = bench_write_all(fd, (uint8_t *)header, SSS_NSS_HEADER_SIZE);
+    if (ret == 0 && body_len > 0) {
+        ret = bench_write_all(fd, body, body_len);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = bench_read_all(fd, bt->buf, SSS_NSS_HEADER_SIZE);
+    if (ret != 0) {
+        return ret;
+    }
+
+    memcpy(header, bt->buf, SSS_NSS_HEADER_SIZE);
+    len = header[0];
+    if (len < SSS_NSS_HEADER_SIZE || header[1] != cmd) {
+        return EBADMSG;
+    }
+
+    /* only the beginning of large replies is kept */
+    len -= SSS_NSS_HEADER_SIZE;
+    chunk = MIN(len, BUF_LEN - SSS_NSS_HEADER_SIZE);
+    ret = bench_read_all(fd, bt->buf + SSS_NSS_HEADER_SIZE, chunk);
+    if (ret != 0) {
+        return ret;
+    }
+    len -= chunk;
+
+    while (len > 0) {
+        chunk = MIN(len, sizeof(discard));
+        ret = bench_read_all(fd, discard, chunk);
+        if (ret != 0) {
+            return ret;
+        }
+        len -= chunk;
+    }
+
+    *_status = header[2];
+    *_reply_len = header[0] - SSS_NSS_HEADER_SIZE;
+    return 0;
+}
+
+static int bench_connect(struct bench_thread *bt, const char *path,
+                         uint32_t version, int *_fd)
+{
+    struct sockaddr_un addr = { 0 };
+    uint32_t status;
+    size_t len;
+    int fd;
+    int ret;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return errno;
+    }
+
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    ret = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (ret == -1) {
+        ret = errno;
+        close(fd);
+        return ret;
+    }
+
+    ret = bench_request(bt, fd, SSS_GET_VERSION, (uint8_t *)&version,
+                        sizeof(uint32_t), &status, &len);
+    if (ret == 0 && status != 0) {
+        ret = status;
+    }
+    if (ret != 0) {
+        close(fd);
+        return ret;
+    }
+
+    *_fd = fd;
+    return 0;
+}
+
+static enum bench_result bench_nss_request(struct bench_thread *bt,
+                                           enum sss_cli_command cmd,
+                                           const uint8_t *body,
+                                           size_t body_len)
+{
+    uint32_t status;
+    uint32_t num;
+    size_t len;
+    int ret;
+
+    if (bt->nss_fd == -1) {
+        ret = bench_connect(bt, bt->bctx->nss_socket,
+                            SSS_NSS_PROTOCOL_VERSION, &bt->nss_fd);
+        if (ret != 0) {
+            return BENCH_ERROR;
+        }
+    }
+
+    ret = bench_request(bt, bt->nss_fd, cmd, body, body_len, &status, &len);
+    if (ret != 0) {
+        close(bt->nss_fd);
+        bt->nss_fd = -1;
+        return BENCH_ERROR;
+    }
+
+    if (status != 0) {
+        return status == ENOENT ? BENCH_MISS : BENCH_ERROR;
+    }
+
+    if (len < sizeof(uint32_t)) {
+        return BENCH_MISS;
+    }
+
+    /* all replies start with the number of results */
+    memcpy(&num, bt->buf + SSS_NSS_HEADER_SIZE, sizeof(uint32_t));
+    return num == 0 ? BENCH_MISS : BENCH_FOUND;
+}
+
+static size_t bench_pam_item(uint8_t *buf, uint32_t type,
+                             const void *data, uint32_t size)
+{
+    memcpy(buf, &type, sizeof(uint32_t));
+    memcpy(buf + sizeof(uint32_t), &size, sizeof(uint32_t));
+    memcpy(buf + 2 * sizeof(uint32_t), data, size);
+
+    return 2 * sizeof(uint32_t) + size;
+}
+
+static enum bench_result bench_pam_request(struct bench_thread *bt,
+                                           const char *user)
+{
+    uint8_t body[3 * NAME_LEN];
+    uint32_t marker;
+    uint32_t status;
+    uint32_t pam_status;
+    uint32_t value;
+    size_t len;
+    size_t rp = 0;
+    int ret;
+
+    if (bt->pam_fd == -1) {
+        ret = bench_connect(bt, bt->bctx->pam_socket,
+                            SSS_PAM_PROTOCOL_VERSION, &bt->pam_fd);
+        if (ret != 0) {
+            return BENCH_ERROR;
+        }
+    }
+
+    /* the same layout as pack_message_v3() of pam_sss */
+    marker = SSS_START_OF_PAM_REQUEST;
+    memcpy(&body[rp], &marker, sizeof(uint32_t));
+    rp += sizeof(uint32_t);
+
+    rp += bench_pam_item(&body[rp], SSS_PAM_ITEM_USER, user,
+                         strlen(user) + 1);
+    rp += bench_pam_item(&body[rp], SSS_PAM_ITEM_SERVICE,
+                         bt->bctx->pam_service,
+                         strlen(bt->bctx->pam_service) + 1);
+
+    value = getpid();
+    rp += bench_pam_item(&body[rp], SSS_PAM_ITEM_CLI_PID, &value,
+                         sizeof(uint32_t));
+
+    value = SSS_AUTHTOK_TYPE_EMPTY;
+    rp += bench_pam_item(&body[rp], SSS_PAM_ITEM_AUTHTOK, &value,
+                         sizeof(uint32_t));
+
+    value = 0;
+    rp += bench_pam_item(&body[rp], SSS_PAM_ITEM_FLAGS, &value,
+                         sizeof(uint32_t));
+
+    marker = SSS_END_OF_PAM_REQUEST;
+    memcpy(&body[rp], &marker, sizeof(uint32_t));
+    rp += sizeof(uint32_t);
+
+    ret = bench_request(bt, bt->pam_fd, SSS_PAM_ACCT_MGMT, body, rp,
+                        &status, &len);
+    if (ret != 0) {
+        close(bt->pam_fd);
+        bt->pam_fd = -1;
+        return BENCH_ERROR;
+    }
+
+    if (status != 0 || len < sizeof(uint32_t)) {
+        return BENCH_ERROR;
+    }
+
+    memcpy(&pam_status, bt->buf + SSS_NSS_HEADER_SIZE, sizeof(uint32_t));
+    return pam_status == 0 ? BENCH_FOUND : BENCH_MISS;
+}
+
+static enum bench_result bench_socket_lookup(struct bench_thread *bt,
+                                             const struct bench_req *req)
+{
+    enum sss_cli_command cmd;
+
+    switch (req->op) {
+    case BENCH_GETPWNAM:
+        cmd = SSS_NSS_GETPWNAM;
+        break;
+    case BENCH_GETGRNAM:
+        cmd = SSS_NSS_GETGRNAM;
+        break;
+    case BENCH_INITGR:
+        cmd = SSS_NSS_INITGR;
+        break;
+    case BENCH_GETPWUID:
+        return bench_nss_request(bt, SSS_NSS_GETPWUID,
+                                 (const uint8_t *)&req->id, sizeof(uint32_t));
+    case BENCH_GETGRGID:
+        return bench_nss_request(bt, SSS_NSS_GETGRGID,
+                                 (const uint8_t *)&req->id, sizeof(uint32_t));
+    case BENCH_PAM:
+        return bench_pam_request(bt, req->name);
+    default:
+        return BENCH_ERROR;
+    }
+
+    return bench_nss_request(bt, cmd, (const uint8_t *)req->name,
+                             strlen(req->name) + 1);
+}
+
+static enum bench_result bench_mmap_lookup(struct bench_thread *bt,
+                                           const struct bench_req *req)
+{
+    struct passwd pwd;
+    struct group grp;
+    gid_t *groups;
+    long int start = 0;
+    long int size = 16;
+    int ret;
+
+    switch (req->op) {
+    case BENCH_GETPWNAM:
+        ret = sss_nss_mc_getpwnam(req->name, strlen(req->name), &pwd,
+                                  (char *)bt->buf, BUF_LEN);
+        break;
+    case BENCH_GETPWUID:
+        ret = sss_nss_mc_getpwuid(req->id, &pwd, (char *)bt->buf, BUF_LEN);
+        break;
+    case BENCH_GETGRNAM:
+        ret = sss_nss_mc_getgrnam(req->name, strlen(req->name), &grp,
+                                  (char *)bt->buf, BUF_LEN);
+        break;
+    case BENCH_GETGRGID:
+        ret = sss_nss_mc_getgrgid(req->id, &grp, (char *)bt->buf, BUF_LEN);
+        break;
+    case BENCH_INITGR:
+        groups = malloc(size * sizeof(gid_t));
+        if (groups == NULL) {
+            return BENCH_ERROR;
+        }
+        ret = sss_nss_mc_initgroups_dyn(req->name, strlen(req->name),
+                                        (gid_t)-1, &start, &size,
+                                        &groups, -1);
+        free(groups);
+        break;
+    default:
+        return BENCH_ERROR;
+    }
+
+    switch (ret) {
+    case 0:
+        return BENCH_FOUND;
+    case ENOENT:
+    case ESRCH:
+        return BENCH_MISS;
+    default:
+        return BENCH_ERROR;
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * Workload
+ * --------------------------------------------------------------------- */
+
+static int bench_zipf_init(struct bench_ctx *bctx, double s)
+{
+    double sum = 0;
+    int i;
+
+    bctx->zipf_cdf = malloc(bctx->count * sizeof(double));
+    if (bctx->zipf_cdf == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < bctx->count; i++) {
+        sum += 1.0 / pow(i + 1, s);
+        bctx->zipf_cdf[i] = sum;
+    }
+
+    for (i = 0; i < bctx->count; i++) {
+        bctx->zipf_cdf[i] /= sum;
+    }
+
+    return 0;
+}
+
+/* Index of the next object, 0 is the most popular one */
+static int bench_pick(struct bench_thread *bt, int count)
+{
+    struct bench_ctx *bctx = bt->bctx;
+    double r;
+    int lo;
+    int hi;
+    int mid;
+
+    if (bctx->zipf_cdf == NULL || count != bctx->count) {
+        return rand_r(&bt->seed) % count;
+    }
+
+    r = (double)rand_r(&bt->seed) / ((double)RAND_MAX + 1);
+    lo = 0;
+    hi = count - 1;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (bctx->zipf_cdf[mid] < r) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static bool bench_op_in_tier(enum bench_op op, enum bench_tier tier)
+{
+    switch (tier) {
+    case BENCH_TIER_DP:
+        return op == BENCH_GETPWNAM || op == BENCH_GETPWUID
+               || op == BENCH_INITGR;
+    case BENCH_TIER_MMAP:
+        return op != BENCH_PAM;
+    default:
+        return true;
+    }
+}
+
+/* Fills @req with the next request, returns false when the tier is done */
+static bool bench_next(struct bench_thread *bt, enum bench_op op,
+                       struct bench_req *req)
+{
+    struct bench_ctx *bctx = bt->bctx;
+    unsigned int n;
+
+    req->op = op;
+
+    if (bt->tier == BENCH_TIER_DP) {
+        n = __sync_fetch_and_add(&bctx->dp_next, 1);
+        if (n >= (unsigned int)bctx->dp_count) {
+            return false;
+        }
+        snprintf(req->name, NAME_LEN, "%s%u", bctx->dp_prefix, n);
+        req->id = bctx->first_id + bctx->count + n;
+        return true;
+    }
+
+    if (bctx->trace != NULL) {
+        *req = bctx->trace[bt->trace_pos];
+        bt->trace_pos = (bt->trace_pos + 1) % bctx->trace_len;
+        return true;
+    }
+
+    if (op == BENCH_GETGRNAM || op == BENCH_GETGRGID) {
+        n = bench_pick(bt, bctx->groups);
+        snprintf(req->name, NAME_LEN, "%s%u", bctx->group_prefix, n);
+    } else {
+        n = bench_pick(bt, bctx->count);
+        snprintf(req->name, NAME_LEN, "%s%u", bctx->user_prefix, n);
+    }
+    req->id = bctx->first_id + n;
+
+    return true;
+}
+
+static void *bench_thread_main(void *arg)
+{
+    struct bench_thread *bt = (struct bench_thread *)arg;
+    struct bench_ctx *bctx = bt->bctx;
+    enum bench_result result;
+    struct bench_req req;
+    enum bench_op op = 0;
+    uint64_t start;
+
+    while (!bctx->stop) {
+        /* the generated requests go round the selected request types */
+        do {
+            op = (op + 1) % BENCH_OPS;
+        } while (!bctx->ops[op] || !bench_op_in_tier(op, bt->tier));
+
+        if (!bench_next(bt, op, &req)) {
+            break;
+        }
+
+        if (!bench_op_in_tier(req.op, bt->tier)) {
+            continue;
+        }
+
+        start = bench_now_us();
+        if (bt->tier == BENCH_TIER_MMAP) {
+            result = bench_mmap_lookup(bt, &req);
+        } else {
+            result = bench_socket_lookup(bt, &req);
+        }
+
+        sss_histogram_record(&bt->stats[req.op].latency,
+                             bench_now_us() - start);
+        bt->stats[req.op].results[result]++;
+    }
+
+    if (bt->nss_fd != -1) {
+        close(bt->nss_fd);
+    }
+    if (bt->pam_fd != -1) {
+        close(bt->pam_fd);
+    }
+
+    return NULL;
+}
+
+static void bench_report(enum bench_tier tier, struct bench_stats *stats,
+                         double seconds)
+{
+    uint64_t v[SSS_HISTOGRAM_FIELDS];
+    int op;
+
+    for (op = 0; op < BENCH_OPS; op++) {
+        if (stats[op].latency.count == 0) {
+            continue;
+        }
+
+        sss_histogram_summary(&stats[op].latency, v);
+        printf("%-7s %-11s %10"PRIu64" %8"PRIu64" %8"PRIu64" %10.0f "
+               "%8"PRIu64" %8"PRIu64" %8"PRIu64" %8"PRIu64" %8"PRIu64
+               " %8"PRIu64"\n",
+               bench_tier_names[tier], bench_op_names[op],
+               v[SSS_HISTOGRAM_COUNT],
+               stats[op].results[BENCH_MISS],
+               stats[op].results[BENCH_ERROR],
+               v[SSS_HISTOGRAM_COUNT] / seconds,
+               v[SSS_HISTOGRAM_MEAN], v[SSS_HISTOGRAM_P50],
+               v[SSS_HISTOGRAM_P90], v[SSS_HISTOGRAM_P99],
+               v[SSS_HISTOGRAM_P999], v[SSS_HISTOGRAM_MAX]);
+    }
+}
+
+static bool bench_tier_has_ops(struct bench_ctx *bctx, enum bench_tier tier)
+{
+    int op;
+
+    for (op = 0; op < BENCH_OPS; op++) {
+        if (bctx->ops[op] && bench_op_in_tier(op, tier)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int bench_run(struct bench_ctx *bctx, enum bench_tier tier,
+                     int num_threads, int seconds)
+{
+    struct bench_thread *threads;
+    struct bench_stats *stats;
+    uint64_t start;
+    double elapsed;
+    int created;
+    int ret = 0;
+    int i;
+    int op;
+
+    threads = calloc(num_threads, sizeof(struct bench_thread));
+    stats = calloc(BENCH_OPS, sizeof(struct bench_stats));
+    if (threads == NULL || stats == NULL) {
+        free(threads);
+        free(stats);
+        return ENOMEM;
+    }
+
+    bctx->stop = 0;
+    bctx->dp_next = 0;
+    start = bench_now_us();
+
+    for (created = 0; created < num_threads; created++) {
+        threads[created].bctx = bctx;
+        threads[created].tier = tier;
+        threads[created].seed = created + 1;
+        threads[created].nss_fd = -1;
+        threads[created].pam_fd = -1;
+        if (bctx->trace != NULL) {
+            threads[created].trace_pos =
+                                bctx->trace_len * created / num_threads;
+        }
+
+        ret = pthread_create(&threads[created].tid, NULL,
+                             bench_thread_main, &threads[created]);
+        if (ret != 0) {
+            break;
+        }
+    }
+
+    /* the dp tier ends once all expired users were looked up */
+    if (ret == 0 && tier != BENCH_TIER_DP) {
+        sleep(seconds);
+        bctx->stop = 1;
+    }
+
+    for (i = 0; i < created; i++) {
+        pthread_join(threads[i].tid, NULL);
+        for (op = 0; op < BENCH_OPS; op++) {
+            stats[op].results[BENCH_FOUND] +=
+                                threads[i].stats[op].results[BENCH_FOUND];
+            stats[op].results[BENCH_MISS] +=
+                                threads[i].stats[op].results[BENCH_MISS];
+            stats[op].results[BENCH_ERROR] +=
+                                threads[i].stats[op].results[BENCH_ERROR];
+            sss_histogram_merge(&stats[op].latency,
+                                &threads[i].stats[op].latency);
+        }
+    }
+
+    elapsed = (bench_now_us() - start) / 1000000.0;
+    if (ret == 0) {
+        bench_report(tier, stats, elapsed);
+    }
+
+    free(threads);
+    free(stats);
+    return ret;
+}
+
+/* Each line of the trace is "<request type> <name or id>", for example
+ * "getpwnam bench_user42" or "getgrgid 200017". */
+static int bench_read_trace(struct bench_ctx *bctx, const char *path)
+{
+    struct bench_req *trace = NULL;
+    struct bench_req *tmp;
+    size_t size = 0;
+    size_t len = 0;
+    char op[32];
+    char key[NAME_LEN];
+    char line[NAME_LEN + 64];
+    FILE *f;
+    int ret = 0;
+    int i;
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        return errno;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%31s %255s", op, key) != 2) {
+            continue;
+        }
+
+        for (i = 0; i < BENCH_OPS; i++) {
+            if (strcmp(op, bench_op_names[i]) == 0) {
+                break;
+            }
+        }
+        if (i == BENCH_OPS) {
+            fprintf(stderr, "Unknown request type in trace: %s\n", op);
+            ret = EINVAL;
+            break;
+        }
+
+        if (len == size) {
+            size = size == 0 ? 1024 : size * 2;
+            tmp = realloc(trace, size * sizeof(struct bench_req));
+            if (tmp == NULL) {
+                ret = ENOMEM;
+                break;
+            }
+            trace = tmp;
+        }
+
+        trace[len].op = i;
+        strcpy(trace[len].name, key);
+        trace[len].id = strtoul(key, NULL, 10);
+        bctx->ops[i] = true;
+        len++;
+    }
+
+    fclose(f);
+
+    if (ret == 0 && len == 0) {
+        ret = EINVAL;
+    }
+
+    if (ret != 0) {
+        free(trace);
+        return ret;
+    }
+
+    bctx->trace = trace;
+    bctx->trace_len = len;
+    return 0;
+}
+
+static int bench_parse_ops(struct bench_ctx *bctx, const char *list)
+{
+    const char *p = list;
+    size_t len;
+    int i;
+
+    while (*p != '\0') {
+        len = strcspn(p, ",");
+
+        for (i = 0; i < BENCH_OPS; i++) {
+            if (strlen(bench_op_names[i]) == len
+                    && strncmp(p, bench_op_names[i], len) == 0) {
+                bctx->ops[i] = true;
+                break;
+            }
+        }
+        if (i == BENCH_OPS) {
+            return EINVAL;
+        }
+
+        p += len;
+        if (*p == ',') {
+            p++;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    struct bench_ctx bctx = { 0 };
+    const char *pc_tiers = "dp,socket,mmap";
+    const char *pc_ops = "getpwnam";
+    const char *pc_trace = NULL;
+    double pc_zipf = 0;
+    int pc_threads = DEFAULT_THREADS;
+    int pc_seconds = DEFAULT_SECONDS;
+    int tier;
+    int ret;
+
+    bctx.nss_socket = SSS_NSS_SOCKET_NAME;
+    bctx.pam_socket = SSS_PAM_SOCKET_NAME;
+    bctx.pam_service = "sshd";
+    bctx.user_prefix = "bench_user";
+    bctx.group_prefix = "bench_group";
+    bctx.dp_prefix = "bench_dpuser";
+    bctx.count = DEFAULT_COUNT;
+    bctx.groups = DEFAULT_GROUPS;
+    bctx.dp_count = DEFAULT_DP_COUNT;
+    bctx.first_id = DEFAULT_FIRST_ID;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "tiers", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_tiers, 0, "Comma separated tiers to measure", NULL },
+        { "requests", 'r', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_ops, 0, "Comma separated request types: getpwnam, "
+                    "getpwuid, getgrnam, getgrgid, initgroups, pam", NULL },
+        { "threads", 't', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_threads, 0, "Number of client threads", NULL },
+        { "seconds", 's', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_seconds, 0,
+                    "Duration of the socket and mmap tiers", NULL },
+        { "zipf", 'z', POPT_ARG_DOUBLE, &pc_zipf, 0,
+                    "Exponent of the Zipf distribution of the names, "
+                    "uniform if 0", NULL },
+        { "trace", '\0', POPT_ARG_STRING, &pc_trace, 0,
+                    "Replay the requests listed in a file", NULL },
+        { "users", 'u', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.count, 0, "Number of valid users", NULL },
+        { "groups", 'g', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.groups, 0, "Number of groups", NULL },
+        { "dp-users", '\0', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.dp_count, 0, "Number of expired users", NULL },
+        { "prefix", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.user_prefix, 0, "Prefix of the user names", NULL },
+        { "group-prefix", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.group_prefix, 0, "Prefix of the group names", NULL },
+        { "dp-prefix", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.dp_prefix, 0, "Prefix of the expired user names",
+                    NULL },
+        { "first-id", '\0', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.first_id, 0, "Lowest UID and GID", NULL },
+        { "nss-socket", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.nss_socket, 0, "Socket of the NSS responder", NULL },
+        { "pam-socket", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.pam_socket, 0, "Socket of the PAM responder", NULL },
+        { "pam-service", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.pam_service, 0, "PAM service of the requests",
+                    NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+            default:
+                fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                        poptBadOption(pc, 0), poptStrerror(opt));
+                poptPrintUsage(pc, stderr, 0);
+                poptFreeContext(pc);
+                return 1;
+        }
+    }
+
+    if (pc_threads <= 0 || pc_seconds <= 0 || pc_zipf < 0
+            || bctx.count <= 0 || bctx.groups <= 0 || bctx.dp_count < 0
+            || bench_parse_ops(&bctx, pc_ops) != 0) {
+        poptPrintUsage(pc, stderr, 0);
+        poptFreeContext(pc);
+        return 1;
+    }
+    poptFreeContext(pc);
+
+    if (pc_trace != NULL) {
+        ret = bench_read_trace(&bctx, pc_trace);
+        if (ret != 0) {
+            fprintf(stderr, "Cannot read trace %s: %s\n",
+                    pc_trace, strerror(ret));
+            return 1;
+        }
+    }
+
+    if (pc_zipf > 0) {
+        ret = bench_zipf_init(&bctx, pc_zipf);
+        if (ret != 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("Times are in microseconds.\n\n");
+    printf("%-7s %-11s %10s %8s %8s %10s %8s %8s %8s %8s %8s %8s\n",
+           "tier", "request", "count", "miss", "error", "req/s",
+           "mean", "p50", "p90", "p99", "p99.9", "max");
+
+    for (tier = 0; tier < BENCH_TIERS; tier++) {
+        if (strstr(pc_tiers, bench_tier_names[tier]) == NULL
+                || !bench_tier_has_ops(&bctx, tier)) {
+            continue;
+        }
+
+        ret = bench_run(&bctx, tier, pc_threads, pc_seconds);
+        if (ret != 0) {
+            fprintf(stderr, "Cannot run the %s tier: %s\n",
+                    bench_tier_names[tier], strerror(ret));
+            return 1;
+        }
+    }
+
+    free(bctx.zipf_cdf);
+    free(bctx.trace);
+    return 0;
+}
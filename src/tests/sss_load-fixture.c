@@ -0,0 +1,377 @@
+/*
+   SSSD
+
+   Cache fixture for the load generator
+
+   Stores generated users and groups into the cache of a configured domain,
+   so sss_load-bench has something to look up. The users named
+   <prefix><n> and the groups named <group-prefix><n> are valid for
+   --cache-timeout seconds; the users named <dp-prefix><n> are stored
+   already expired, so each lookup of them goes to the data provider.
+
+   Stop SSSD before populating its cache.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <talloc.h>
+#include <popt.h>
+
+#include "util/util.h"
+#include "confdb/confdb.h"
+#include "db/sysdb.h"
+
+#define DEFAULT_USERS           10000
+#define DEFAULT_GROUPS          1000
+#define DEFAULT_DP_USERS        1000
+#define DEFAULT_MEMBERSHIPS     3
+#define DEFAULT_FIRST_ID        200000
+#define DEFAULT_CACHE_TIMEOUT   86400
+
+/* objects stored in one transaction */
+#define BATCH                   500
+
+struct fixture_ctx {
+    struct sss_domain_info *domain;
+
+    const char *user_prefix;
+    const char *group_prefix;
+    const char *dp_prefix;
+    int users;
+    int groups;
+    int dp_users;
+    int memberships;
+    int first_id;
+    int cache_timeout;
+
+    int in_transaction;
+};
+
+static errno_t fixture_batch(struct fixture_ctx *fctx, int n)
+{
+    errno_t ret;
+
+    if (fctx->in_transaction && n % BATCH == 0) {
+        ret = sysdb_transaction_commit(fctx->domain->sysdb);
+        fctx->in_transaction = 0;
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    if (!fctx->in_transaction) {
+        ret = sysdb_transaction_start(fctx->domain->sysdb);
+        if (ret != EOK) {
+            return ret;
+        }
+        fctx->in_transaction = 1;
+    }
+
+    return EOK;
+}
+
+static errno_t fixture_store_groups(struct fixture_ctx *fctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    char *name;
+    time_t now;
+    errno_t ret;
+    int i;
+
+    now = time(NULL);
+
+    for (i = 0; i < fctx->groups; i++) {
+        ret = fixture_batch(fctx, i);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        tmp_ctx = talloc_new(NULL);
+        if (tmp_ctx == NULL) {
+            return ENOMEM;
+        }
+
+        name = talloc_asprintf(tmp_ctx, "%s%d", fctx->group_prefix, i);
+        if (name == NULL) {
+            talloc_free(tmp_ctx);
+            return ENOMEM;
+        }
+
+        name = sss_create_internal_fqname(tmp_ctx, name, fctx->domain->name);
+        if (name == NULL) {
+            talloc_free(tmp_ctx);
+            return ENOMEM;
+        }
+
+        ret = sysdb_store_group(fctx->domain, name, fctx->first_id + i,
+                                NULL, fctx->cache_timeout, now);
+        talloc_free(tmp_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot store group %s%d [%d]: %s\n",
+                  fctx->group_prefix, i, ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+static errno_t fixture_store_user(struct fixture_ctx *fctx,
+                                  const char *prefix,
+                                  int n,
+                                  uid_t uid,
+                                  time_t now)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *group;
+    char *name;
+    char *home;
+    gid_t gid = 0;
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    name = talloc_asprintf(tmp_ctx, "%s%d", prefix, n);
+    if (name == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    home = talloc_asprintf(tmp_ctx, "/home/%s", name);
+    if (home == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    name = sss_create_internal_fqname(tmp_ctx, name, fctx->domain->name);
+    if (name == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (fctx->groups > 0) {
+        gid = fctx->first_id + n % fctx->groups;
+    }
+
+    ret = sysdb_store_user(fctx->domain, name, NULL, uid, gid, NULL,
+                           home, "/bin/bash", NULL, NULL, NULL,
+                           fctx->cache_timeout, now);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (i = 0; i < fctx->memberships && i < fctx->groups; i++) {
+        group = talloc_asprintf(tmp_ctx, "%s%d", fctx->group_prefix,
+                                (n + i) % fctx->groups);
+        if (group == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        group = sss_create_internal_fqname(tmp_ctx, group, fctx->domain->name);
+        if (group == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sysdb_add_group_member(fctx->domain, group, name,
+                                     SYSDB_MEMBER_USER, false);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot store user %s%d [%d]: %s\n",
+              prefix, n, ret, sss_strerror(ret));
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t fixture_store_users(struct fixture_ctx *fctx)
+{
+    time_t now;
+    errno_t ret;
+    int i;
+
+    now = time(NULL);
+
+    for (i = 0; i < fctx->users; i++) {
+        ret = fixture_batch(fctx, i);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        ret = fixture_store_user(fctx, fctx->user_prefix, i,
+                                 fctx->first_id + i, now);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    /* stored as if they were fetched one timeout ago, so they are
+     * expired right away */
+    now -= fctx->cache_timeout + 1;
+
+    for (i = 0; i < fctx->dp_users; i++) {
+        ret = fixture_batch(fctx, i);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        ret = fixture_store_user(fctx, fctx->dp_prefix, i,
+                                 fctx->first_id + fctx->users + i, now);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    struct fixture_ctx fctx = { 0 };
+    struct confdb_ctx *confdb;
+    TALLOC_CTX *mem_ctx = NULL;
+    char *confdb_path;
+    const char *domain = NULL;
+    int debug = SSSDBG_DEFAULT;
+    errno_t ret;
+
+    fctx.user_prefix = "bench_user";
+    fctx.group_prefix = "bench_group";
+    fctx.dp_prefix = "bench_dpuser";
+    fctx.users = DEFAULT_USERS;
+    fctx.groups = DEFAULT_GROUPS;
+    fctx.dp_users = DEFAULT_DP_USERS;
+    fctx.memberships = DEFAULT_MEMBERSHIPS;
+    fctx.first_id = DEFAULT_FIRST_ID;
+    fctx.cache_timeout = DEFAULT_CACHE_TIMEOUT;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "debug", '\0', POPT_ARG_INT | POPT_ARGFLAG_DOC_HIDDEN, &debug,
+                    0, "The debug level to run with", NULL },
+        { "domain", 'd', POPT_ARG_STRING, &domain, 0,
+                    "The domain to populate", NULL },
+        { "users", 'u', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.users, 0, "Number of valid users", NULL },
+        { "groups", 'g', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.groups, 0, "Number of groups", NULL },
+        { "dp-users", '\0', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.dp_users, 0, "Number of expired users", NULL },
+        { "memberships", 'm', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.memberships, 0,
+                    "Number of groups each user is a member of", NULL },
+        { "prefix", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.user_prefix, 0, "Prefix of the user names", NULL },
+        { "group-prefix", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.group_prefix, 0, "Prefix of the group names", NULL },
+        { "dp-prefix", '\0', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.dp_prefix, 0, "Prefix of the expired user names",
+                    NULL },
+        { "first-id", '\0', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.first_id, 0, "Lowest UID and GID", NULL },
+        { "cache-timeout", '\0', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &fctx.cache_timeout, 0,
+                    "Seconds the valid objects stay valid", NULL },
+        POPT_TABLEEND
+    };
+
+    /* parse the params */
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+            default:
+                fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                        poptBadOption(pc, 0), poptStrerror(opt));
+                poptPrintUsage(pc, stderr, 0);
+                poptFreeContext(pc);
+                return 1;
+        }
+    }
+
+    if (domain == NULL || fctx.users < 0 || fctx.groups < 0
+            || fctx.dp_users < 0 || fctx.memberships < 0
+            || fctx.first_id <= 0 || fctx.cache_timeout <= 0) {
+        poptPrintUsage(pc, stderr, 0);
+        poptFreeContext(pc);
+        return 1;
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug);
+
+    mem_ctx = talloc_new(NULL);
+    if (mem_ctx == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    confdb_path = talloc_asprintf(mem_ctx, "%s/%s", DB_PATH, CONFDB_FILE);
+    if (confdb_path == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = confdb_init(mem_ctx, &confdb, confdb_path);
+    if (ret != EOK) {
+        fprintf(stderr, "Cannot open the configuration database %s\n",
+                confdb_path);
+        goto done;
+    }
+
+    ret = sssd_domain_init(mem_ctx, confdb, domain, DB_PATH, &fctx.domain);
+    if (ret != EOK) {
+        SYSDB_VERSION_ERROR(ret);
+        fprintf(stderr, "Cannot open the cache of domain %s\n", domain);
+        goto done;
+    }
+
+    ret = fixture_store_groups(&fctx);
+    if (ret == EOK) {
+        ret = fixture_store_users(&fctx);
+    }
+
+    if (fctx.in_transaction) {
+        if (ret == EOK) {
+            ret = sysdb_transaction_commit(fctx.domain->sysdb);
+        } else {
+            sysdb_transaction_cancel(fctx.domain->sysdb);
+        }
+    }
+
+    if (ret != EOK) {
+        fprintf(stderr, "Cannot populate the cache: %s\n", sss_strerror(ret));
+        goto done;
+    }
+
+    printf("Stored %d users, %d expired users and %d groups into %s\n",
+           fctx.users, fctx.dp_users, fctx.groups, domain);
+
+done:
+    talloc_free(mem_ctx);
+    return ret == EOK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
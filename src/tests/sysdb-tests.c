@@ -54,6 +54,8 @@
 #define MBO_USER_BASE 27500
 #define MBO_GROUP_BASE 28500
 #define NUM_GHOSTS 10
+#define MBO_TXN_GROUP_BASE 29000
+#define CACHE_FORMAT_ID 29100
 
 #define TEST_AUTOFS_MAP_BASE 29500
 
@@ -3043,6 +3045,526 @@ START_TEST (test_sysdb_memberof_close_loop)
 }
 END_TEST
 
+/* The memberof transaction tests build their own groups and remove them
+ * when done. The groups are named testgroup<gid> and each one has the ghost
+ * testghost<gid>. */
+static struct ldb_dn *mbof_txn_group_dn(struct sysdb_test_ctx *test_ctx,
+                                        gid_t gid)
+{
+    struct ldb_dn *dn;
+    char *name;
+
+    name = test_asprintf_fqname(test_ctx, test_ctx->domain,
+                                "testgroup%d", gid);
+    ck_assert_msg(name != NULL, "Out of memory\n");
+
+    dn = sysdb_group_dn(test_ctx, test_ctx->domain, name);
+    ck_assert_msg(dn != NULL, "Out of memory\n");
+
+    talloc_free(name);
+    return dn;
+}
+
+static void mbof_txn_add_group(struct sysdb_test_ctx *test_ctx, gid_t gid)
+{
+    struct test_data *data;
+    char *ghostname;
+    int ret;
+
+    data = test_data_new_group(test_ctx, gid);
+    sss_ck_fail_if_msg(data == NULL, "Failed to allocate memory");
+
+    ghostname = test_asprintf_fqname(data, test_ctx->domain,
+                                     "testghost%d", gid);
+    ck_assert_msg(ghostname != NULL, "Out of memory\n");
+
+    ret = sysdb_attrs_steal_string(data->attrs, SYSDB_GHOST, ghostname);
+    ck_assert_msg(ret == EOK, "Cannot add attr\n");
+
+    ret = test_add_group(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not add group %d", gid);
+
+    talloc_free(data);
+}
+
+static void mbof_txn_mod_member(struct sysdb_test_ctx *test_ctx,
+                                struct ldb_dn *member_dn,
+                                struct ldb_dn *group_dn,
+                                int mod_op)
+{
+    int ret;
+
+    ret = sysdb_mod_group_member(test_ctx->domain, member_dn, group_dn,
+                                 mod_op);
+    sss_ck_fail_if_msg(ret != EOK, "Could not %s %s in %s",
+                       mod_op == SYSDB_MOD_ADD ? "add" : "remove",
+                       ldb_dn_get_linearized(member_dn),
+                       ldb_dn_get_linearized(group_dn));
+}
+
+/* parents is NULL terminated, the group must be a member of exactly them */
+static void mbof_txn_check_memberof(struct sysdb_test_ctx *test_ctx,
+                                    struct ldb_dn *dn,
+                                    struct ldb_dn **parents)
+{
+    const char *attrs[] = { SYSDB_MEMBEROF, NULL };
+    struct ldb_message_element *el;
+    struct ldb_message **msgs;
+    struct ldb_dn *val_dn;
+    size_t msgs_count;
+    unsigned int num_values;
+    size_t i;
+    size_t j;
+    int ret;
+
+    ret = sysdb_search_entry(test_ctx, test_ctx->sysdb, dn, LDB_SCOPE_BASE,
+                             NULL, attrs, &msgs_count, &msgs);
+    sss_ck_fail_if_msg(ret != EOK, "Cannot retrieve %s\n",
+                       ldb_dn_get_linearized(dn));
+    ck_assert_msg(msgs_count == 1, "Expected one entry, found %zu\n",
+                  msgs_count);
+
+    el = ldb_msg_find_element(msgs[0], SYSDB_MEMBEROF);
+    num_values = el == NULL ? 0 : el->num_values;
+
+    for (i = 0; parents[i] != NULL; i++) {
+        for (j = 0; j < num_values; j++) {
+            val_dn = ldb_dn_from_ldb_val(msgs, test_ctx->sysdb->ldb,
+                                         &el->values[j]);
+            ck_assert_msg(val_dn != NULL, "Out of memory\n");
+            if (ldb_dn_compare(val_dn, parents[i]) == 0) {
+                break;
+            }
+        }
+        ck_assert_msg(j < num_values, "%s is not a member of %s\n",
+                      ldb_dn_get_linearized(dn),
+                      ldb_dn_get_linearized(parents[i]));
+    }
+
+    ck_assert_msg(num_values == i,
+                  "%s is a member of %u groups, expected %zu\n",
+                  ldb_dn_get_linearized(dn), num_values, i);
+
+    talloc_free(msgs);
+}
+
+static void mbof_txn_check_ghost(struct sysdb_test_ctx *test_ctx,
+                                 struct ldb_dn *dn,
+                                 gid_t ghost_gid,
+                                 bool present)
+{
+    const char *attrs[] = { SYSDB_GHOST, NULL };
+    struct ldb_message_element *el;
+    struct ldb_message **msgs;
+    struct ldb_val gv;
+    size_t msgs_count;
+    char *ghostname;
+    bool found;
+    int ret;
+
+    ret = sysdb_search_entry(test_ctx, test_ctx->sysdb, dn, LDB_SCOPE_BASE,
+                             NULL, attrs, &msgs_count, &msgs);
+    sss_ck_fail_if_msg(ret != EOK, "Cannot retrieve %s\n",
+                       ldb_dn_get_linearized(dn));
+    ck_assert_msg(msgs_count == 1, "Expected one entry, found %zu\n",
+                  msgs_count);
+
+    ghostname = test_asprintf_fqname(msgs, test_ctx->domain,
+                                     "testghost%d", ghost_gid);
+    ck_assert_msg(ghostname != NULL, "Out of memory\n");
+
+    gv.data = (uint8_t *) ghostname;
+    gv.length = strlen(ghostname);
+
+    el = ldb_msg_find_element(msgs[0], SYSDB_GHOST);
+    found = el != NULL && ldb_msg_find_val(el, &gv) != NULL;
+    ck_assert_msg(found == present, "Ghost user %s %s in %s\n", ghostname,
+                  present ? "not found" : "unexpectedly found",
+                  ldb_dn_get_linearized(dn));
+
+    talloc_free(msgs);
+}
+
+static void mbof_txn_cleanup(struct sysdb_test_ctx *test_ctx,
+                             gid_t first, gid_t num)
+{
+    gid_t gid;
+    int ret;
+
+    for (gid = first; gid < first + num; gid++) {
+        ret = sysdb_delete_group(test_ctx->domain, NULL, gid);
+        sss_ck_fail_if_msg(ret != EOK, "Could not remove group %d", gid);
+    }
+}
+
+/* Members are added to and removed from groups the memberof module has
+ * already read in the same transaction */
+START_TEST (test_sysdb_memberof_txn_add_del)
+{
+    struct sysdb_test_ctx *test_ctx;
+    struct ldb_dn *a, *b, *c, *d;
+    int ret;
+
+    /* Setup */
+    ret = setup_sysdb_tests(&test_ctx);
+    if (ret != EOK) {
+        ck_abort_msg("Could not set up the test");
+        return;
+    }
+
+    a = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE);
+    b = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 1);
+    c = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 2);
+    d = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 3);
+
+    /* c is a member of b which is a member of a */
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 1);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 2);
+    mbof_txn_mod_member(test_ctx, b, a, SYSDB_MOD_ADD);
+    mbof_txn_mod_member(test_ctx, c, b, SYSDB_MOD_ADD);
+
+    ret = sysdb_transaction_start(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot start transaction\n");
+
+    /* reads c, b and a into the graph */
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 3);
+    mbof_txn_mod_member(test_ctx, d, c, SYSDB_MOD_ADD);
+
+    mbof_txn_check_memberof(test_ctx, d,
+                            (struct ldb_dn *[]) { c, b, a, NULL });
+    mbof_txn_check_ghost(test_ctx, c, MBO_TXN_GROUP_BASE + 3, true);
+    mbof_txn_check_ghost(test_ctx, b, MBO_TXN_GROUP_BASE + 3, true);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 3, true);
+
+    /* cut c loose from b while b and a are known */
+    mbof_txn_mod_member(test_ctx, c, b, SYSDB_MOD_DEL);
+
+    mbof_txn_check_memberof(test_ctx, b, (struct ldb_dn *[]) { a, NULL });
+    mbof_txn_check_memberof(test_ctx, c, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_memberof(test_ctx, d, (struct ldb_dn *[]) { c, NULL });
+    mbof_txn_check_ghost(test_ctx, c, MBO_TXN_GROUP_BASE + 3, true);
+    mbof_txn_check_ghost(test_ctx, b, MBO_TXN_GROUP_BASE + 3, false);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 3, false);
+    mbof_txn_check_ghost(test_ctx, b, MBO_TXN_GROUP_BASE + 2, false);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, false);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 1, true);
+
+    mbof_txn_mod_member(test_ctx, d, c, SYSDB_MOD_DEL);
+
+    mbof_txn_check_memberof(test_ctx, d, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_ghost(test_ctx, c, MBO_TXN_GROUP_BASE + 3, false);
+
+    /* and put c back, the parents have to be read again */
+    mbof_txn_mod_member(test_ctx, c, b, SYSDB_MOD_ADD);
+
+    mbof_txn_check_memberof(test_ctx, c, (struct ldb_dn *[]) { b, a, NULL });
+    mbof_txn_check_ghost(test_ctx, b, MBO_TXN_GROUP_BASE + 2, true);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, true);
+
+    ret = sysdb_transaction_commit(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot commit transaction\n");
+
+    mbof_txn_check_memberof(test_ctx, c, (struct ldb_dn *[]) { b, a, NULL });
+    mbof_txn_check_memberof(test_ctx, d, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, true);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 3, false);
+
+    mbof_txn_cleanup(test_ctx, MBO_TXN_GROUP_BASE, 4);
+    talloc_free(test_ctx);
+}
+END_TEST
+
+/* A group the memberof module has already read is renamed in the middle of
+ * the transaction */
+START_TEST (test_sysdb_memberof_txn_rename)
+{
+    struct sysdb_test_ctx *test_ctx;
+    struct ldb_dn *a, *b, *c, *e, *renamed;
+    int ret;
+
+    /* Setup */
+    ret = setup_sysdb_tests(&test_ctx);
+    if (ret != EOK) {
+        ck_abort_msg("Could not set up the test");
+        return;
+    }
+
+    a = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE);
+    b = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 1);
+    c = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 2);
+    e = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 3);
+    renamed = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 9);
+
+    /* b is a member of a */
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 1);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 2);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 3);
+    mbof_txn_mod_member(test_ctx, b, a, SYSDB_MOD_ADD);
+
+    ret = sysdb_transaction_start(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot start transaction\n");
+
+    /* reads b and a into the graph, c is removed again so that no memberof
+     * value points to the old name of b */
+    mbof_txn_mod_member(test_ctx, c, b, SYSDB_MOD_ADD);
+    mbof_txn_check_memberof(test_ctx, c, (struct ldb_dn *[]) { b, a, NULL });
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, true);
+
+    mbof_txn_mod_member(test_ctx, c, b, SYSDB_MOD_DEL);
+    mbof_txn_check_memberof(test_ctx, c, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, false);
+
+    ret = ldb_rename(test_ctx->sysdb->ldb, b, renamed);
+    ck_assert_msg(ret == LDB_SUCCESS, "Cannot rename %s: %s\n",
+                  ldb_dn_get_linearized(b), ldb_strerror(ret));
+
+    mbof_txn_check_memberof(test_ctx, renamed,
+                            (struct ldb_dn *[]) { a, NULL });
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 1, true);
+
+    mbof_txn_mod_member(test_ctx, e, renamed, SYSDB_MOD_ADD);
+    mbof_txn_mod_member(test_ctx, c, renamed, SYSDB_MOD_ADD);
+
+    mbof_txn_check_memberof(test_ctx, e,
+                            (struct ldb_dn *[]) { renamed, a, NULL });
+    mbof_txn_check_memberof(test_ctx, c,
+                            (struct ldb_dn *[]) { renamed, a, NULL });
+    mbof_txn_check_ghost(test_ctx, renamed, MBO_TXN_GROUP_BASE + 3, true);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 3, true);
+    mbof_txn_check_ghost(test_ctx, renamed, MBO_TXN_GROUP_BASE + 2, true);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, true);
+
+    ret = sysdb_transaction_commit(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot commit transaction\n");
+
+    mbof_txn_check_memberof(test_ctx, renamed,
+                            (struct ldb_dn *[]) { a, NULL });
+    mbof_txn_check_memberof(test_ctx, e,
+                            (struct ldb_dn *[]) { renamed, a, NULL });
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 3, true);
+
+    /* the renamed group keeps its gidNumber */
+    mbof_txn_cleanup(test_ctx, MBO_TXN_GROUP_BASE, 4);
+    talloc_free(test_ctx);
+}
+END_TEST
+
+/* The graph of a cancelled transaction must not leak into the next one */
+START_TEST (test_sysdb_memberof_txn_cancel)
+{
+    struct sysdb_test_ctx *test_ctx;
+    struct ldb_message *msg;
+    struct ldb_dn *a, *b, *c, *d, *x;
+    int ret;
+
+    /* Setup */
+    ret = setup_sysdb_tests(&test_ctx);
+    if (ret != EOK) {
+        ck_abort_msg("Could not set up the test");
+        return;
+    }
+
+    a = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE);
+    b = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 1);
+    c = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 2);
+    d = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 3);
+    x = mbof_txn_group_dn(test_ctx, MBO_TXN_GROUP_BASE + 4);
+
+    /* b is a member of a */
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 1);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 2);
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 3);
+    mbof_txn_mod_member(test_ctx, b, a, SYSDB_MOD_ADD);
+
+    ret = sysdb_transaction_start(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot start transaction\n");
+
+    /* a becomes a member of x and is read into the graph with it */
+    mbof_txn_add_group(test_ctx, MBO_TXN_GROUP_BASE + 4);
+    mbof_txn_mod_member(test_ctx, a, x, SYSDB_MOD_ADD);
+    mbof_txn_mod_member(test_ctx, c, b, SYSDB_MOD_ADD);
+
+    mbof_txn_check_memberof(test_ctx, c,
+                            (struct ldb_dn *[]) { b, a, x, NULL });
+    mbof_txn_check_ghost(test_ctx, x, MBO_TXN_GROUP_BASE + 2, true);
+
+    ret = sysdb_transaction_cancel(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot cancel transaction\n");
+
+    ret = sysdb_search_group_by_gid(test_ctx, test_ctx->domain,
+                                    MBO_TXN_GROUP_BASE + 4, NULL, &msg);
+    ck_assert_msg(ret == ENOENT, "Group %d survived the cancel\n",
+                  MBO_TXN_GROUP_BASE + 4);
+    mbof_txn_check_memberof(test_ctx, a, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_memberof(test_ctx, c, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, false);
+
+    ret = sysdb_transaction_start(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot start transaction\n");
+
+    mbof_txn_mod_member(test_ctx, d, b, SYSDB_MOD_ADD);
+
+    mbof_txn_check_memberof(test_ctx, d, (struct ldb_dn *[]) { b, a, NULL });
+    mbof_txn_check_ghost(test_ctx, b, MBO_TXN_GROUP_BASE + 3, true);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 3, true);
+
+    ret = sysdb_transaction_commit(test_ctx->sysdb);
+    ck_assert_msg(ret == EOK, "Cannot commit transaction\n");
+
+    mbof_txn_check_memberof(test_ctx, a, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_memberof(test_ctx, c, (struct ldb_dn *[]) { NULL });
+    mbof_txn_check_memberof(test_ctx, d, (struct ldb_dn *[]) { b, a, NULL });
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 3, true);
+    mbof_txn_check_ghost(test_ctx, a, MBO_TXN_GROUP_BASE + 2, false);
+
+    mbof_txn_cleanup(test_ctx, MBO_TXN_GROUP_BASE, 4);
+    talloc_free(test_ctx);
+}
+END_TEST
+
+/* Converts the cache and reopens it, as the conversion at startup does */
+static void cache_format_convert(struct sysdb_test_ctx *test_ctx,
+                                 enum sss_cache_format format,
+                                 bool exp_converted)
+{
+    struct sysdb_ctx *sysdb = test_ctx->sysdb;
+    enum sss_cache_format current;
+    bool converted;
+    int ret;
+
+    ret = sysdb_ldb_set_format(sysdb->ldb, format, &converted);
+    ck_assert_msg(ret == EOK, "sysdb_ldb_set_format error [%d][%s]",
+                  ret, strerror(ret));
+    ck_assert_msg(converted == exp_converted,
+                  "Expected converted to be %d\n", exp_converted);
+
+    talloc_zfree(sysdb->ldb);
+    ret = sysdb_ldb_connect(sysdb, sysdb->ldb_file, 0, &sysdb->ldb);
+    ck_assert_msg(ret == EOK, "Cannot reopen the cache [%d][%s]",
+                  ret, strerror(ret));
+
+    ret = sysdb_ldb_get_format(sysdb->ldb, &current);
+    ck_assert_msg(ret == EOK, "sysdb_ldb_get_format error [%d][%s]",
+                  ret, strerror(ret));
+    ck_assert_msg(current == format, "Expected format %s, got %s\n",
+                  sysdb_cache_format_str(format),
+                  sysdb_cache_format_str(current));
+}
+
+static void cache_format_check_guid(struct test_data *data, bool exp_present)
+{
+    const char *attrs[] = { SYSDB_RECORD_GUID, NULL };
+    struct ldb_message_element *el;
+    struct ldb_message *msg;
+    int ret;
+
+    ret = sysdb_search_user_by_name(data, data->ctx->domain, data->username,
+                                    attrs, &msg);
+    ck_assert_msg(ret == EOK, "sysdb_search_user_by_name error [%d][%s]",
+                  ret, strerror(ret));
+
+    el = ldb_msg_find_element(msg, SYSDB_RECORD_GUID);
+    if (exp_present) {
+        ck_assert_msg(el != NULL && el->num_values == 1
+                          && el->values[0].length == SSS_UNIQUE_ID_SIZE,
+                      "%s has no valid GUID\n", data->username);
+    } else {
+        ck_assert_msg(el == NULL, "%s has a GUID\n", data->username);
+    }
+    talloc_free(msg);
+}
+
+static void cache_format_check_initgroups(struct test_data *data,
+                                          unsigned int exp_count)
+{
+    struct ldb_result *res;
+    int ret;
+
+    ret = sysdb_initgroups(data, data->ctx->domain, data->username, &res);
+    ck_assert_msg(ret == EOK, "sysdb_initgroups error [%d][%s]",
+                  ret, strerror(ret));
+    ck_assert_msg(res->count == exp_count, "Expected %u entries, got %u\n",
+                  exp_count, res->count);
+    talloc_free(res);
+}
+
+START_TEST (test_sysdb_cache_format)
+{
+    struct sysdb_test_ctx *test_ctx;
+    struct test_data *data;
+    enum sss_cache_format format;
+    int ret;
+
+    /* Setup */
+    ret = setup_sysdb_tests(&test_ctx);
+    if (ret != EOK) {
+        ck_abort_msg("Could not set up the test");
+        return;
+    }
+
+    data = test_data_new_user(test_ctx, CACHE_FORMAT_ID);
+    sss_ck_fail_if_msg(data == NULL, "OOM\n");
+    data->groupname = test_asprintf_fqname(data, test_ctx->domain,
+                                           "testgroup%d", CACHE_FORMAT_ID);
+    sss_ck_fail_if_msg(data->groupname == NULL, "OOM\n");
+
+    ret = test_add_user(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not add user %s\n", data->username);
+    ret = test_add_group(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not add group %s\n",
+                       data->groupname);
+    ret = test_add_group_member(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not add %s to %s\n",
+                       data->username, data->groupname);
+
+    ret = sysdb_ldb_get_format(test_ctx->sysdb->ldb, &format);
+    ck_assert_msg(ret == EOK, "sysdb_ldb_get_format error [%d][%s]",
+                  ret, strerror(ret));
+    ck_assert_msg(format == SSS_CACHE_FORMAT_STANDARD,
+                  "Expected the standard format\n");
+    cache_format_check_guid(data, false);
+
+    /* Existing entries get a GUID, converting twice does nothing */
+    cache_format_convert(test_ctx, SSS_CACHE_FORMAT_COMPACT, true);
+    cache_format_convert(test_ctx, SSS_CACHE_FORMAT_COMPACT, false);
+    cache_format_check_guid(data, true);
+    cache_format_check_initgroups(data, 2);
+
+    /* New entries get one as well and can be found through the indexes */
+    data->gid = CACHE_FORMAT_ID + 1;
+    data->groupname = test_asprintf_fqname(data, test_ctx->domain,
+                                           "testgroup%d", data->gid);
+    sss_ck_fail_if_msg(data->groupname == NULL, "OOM\n");
+
+    ret = test_add_group(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not add group %s\n",
+                       data->groupname);
+    ret = test_add_group_member(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not add %s to %s\n",
+                       data->username, data->groupname);
+    cache_format_check_initgroups(data, 3);
+
+    /* And back */
+    cache_format_convert(test_ctx, SSS_CACHE_FORMAT_STANDARD, true);
+    cache_format_check_guid(data, false);
+    cache_format_check_initgroups(data, 3);
+
+    /* Cleanup */
+    ret = test_remove_group_by_gid(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not remove group %d\n", data->gid);
+    data->gid = CACHE_FORMAT_ID;
+    ret = test_remove_group_by_gid(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not remove group %d\n", data->gid);
+    ret = test_remove_user_by_uid(data);
+    sss_ck_fail_if_msg(ret != EOK, "Could not remove user %d\n", data->uid);
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 START_TEST (test_sysdb_memberof_store_user)
 {
     struct sysdb_test_ctx *test_ctx;
@@ -8245,6 +8767,12 @@ Suite *create_sysdb_suite(void)
                         1 , 11);
     tcase_add_loop_test(tc_memberof, test_sysdb_remove_local_group_by_gid,
                         MBO_GROUP_BASE , MBO_GROUP_BASE + 10);
+
+    /* memberof within one transaction */
+    tcase_add_test(tc_memberof, test_sysdb_memberof_txn_add_del);
+    tcase_add_test(tc_memberof, test_sysdb_memberof_txn_rename);
+    tcase_add_test(tc_memberof, test_sysdb_memberof_txn_cancel);
+    tcase_add_test(tc_memberof, test_sysdb_cache_format);
     suite_add_tcase(s, tc_memberof);
 
     TCase *tc_subdomain = tcase_create("SYSDB sub-domain Tests");
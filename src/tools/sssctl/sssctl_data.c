@@ -360,18 +360,32 @@ static errno_t sssctl_cache_index_action(enum sysdb_index_actions action,
         return ENOMEM;
     }
 
+    ret = sss_tool_connect_to_confdb(tmp_ctx, &confdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Could not connect to configuration database.\n");
+        goto done;
+    }
+
     if (domains == NULL) {
         /* If the user selected no domain, act on all of them */
-        ret = sss_tool_connect_to_confdb(tmp_ctx, &confdb);
+        ret = get_confdb_domains(tmp_ctx, confdb, discard_const(&domains));
         if (ret != EOK) {
-            DEBUG(SSSDBG_OP_FAILURE,
-                  "Could not connect to configuration database.\n");
+            DEBUG(SSSDBG_OP_FAILURE, "Could not list all the domains.\n");
             goto done;
         }
+    }
 
-        ret = get_confdb_domains(tmp_ctx, confdb, discard_const(&domains));
+    /* no cache is converted unless all of them can be */
+    if (convert) {
+        ret = sssctl_cache_format_check(tmp_ctx, confdb, domains, format);
         if (ret != EOK) {
-            DEBUG(SSSDBG_OP_FAILURE, "Could not list all the domains.\n");
+            goto done;
+        }
+
+        if (!sssctl_stop_sssd(stop)) {
+            ERROR("Unable to convert the cache unless SSSD is stopped.\n");
+            ret = ERR_SSSD_RUNNING;
             goto done;
         }
     }
@@ -502,3 +516,177 @@ done:
 
     return ret;
 }
+
+/* SSSD converts the cache to the configured format when it starts */
+static errno_t sssctl_cache_format_check(TALLOC_CTX *mem_ctx,
+                                         struct confdb_ctx *confdb,
+                                         const char **domains,
+                                         enum sss_cache_format format)
+{
+    enum sss_cache_format configured;
+    const char **domain;
+    char *configured_str;
+    char *path;
+    errno_t ret;
+
+    for (domain = domains; *domain != NULL; domain++) {
+        path = talloc_asprintf(mem_ctx, CONFDB_DOMAIN_PATH_TMPL, *domain);
+        if (path == NULL) {
+            return ENOMEM;
+        }
+
+        ret = confdb_get_string(confdb, mem_ctx, path,
+                                CONFDB_DOMAIN_CACHE_FORMAT,
+                                SYSDB_CACHE_FORMAT_STANDARD,
+                                &configured_str);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Could not read %s of domain %s\n",
+                  CONFDB_DOMAIN_CACHE_FORMAT, *domain);
+            return ret;
+        }
+
+        ret = sysdb_cache_format_from_str(configured_str, &configured);
+        if (ret != EOK) {
+            ERROR("Invalid %1$s of domain %2$s: %3$s\n",
+                  CONFDB_DOMAIN_CACHE_FORMAT, *domain, configured_str);
+            return ret;
+        }
+
+        if (configured != format) {
+            ERROR("The cache of domain %1$s would be converted back to "
+                  "format %2$s when SSSD starts. Set %3$s = %4$s in the "
+                  "section of the domain in sssd.conf first.\n",
+                  *domain, configured_str, CONFDB_DOMAIN_CACHE_FORMAT,
+                  sysdb_cache_format_str(format));
+            return EINVAL;
+        }
+    }
+
+    return EOK;
+}
+
+static errno_t sssctl_cache_format_action(const char **domains,
+                                          bool convert,
+                                          enum sss_cache_format format,
+                                          bool stop)
+{
+    errno_t ret;
+    TALLOC_CTX *tmp_ctx = NULL;
+    struct confdb_ctx *confdb = NULL;
+    enum sss_cache_format current;
+    char *cache;
+    const char **domain;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to allocate the context\n");
+        return ENOMEM;
+    }
+
+    if (domains == NULL) {
+        /* If the user selected no domain, act on all of them */
+        ret = sss_tool_connect_to_confdb(tmp_ctx, &confdb);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Could not connect to configuration database.\n");
+            goto done;
+        }
+
+        ret = get_confdb_domains(tmp_ctx, confdb, discard_const(&domains));
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Could not list all the domains.\n");
+            goto done;
+        }
+    }
+
+    for (domain = domains; *domain != NULL; domain++) {
+        ret = sysdb_get_db_file(tmp_ctx, NULL, *domain, DB_PATH, &cache, NULL);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Failed to get the cache db name\n");
+            goto done;
+        }
+
+        current = format;
+        if (convert) {
+            PRINT("Converting the cache of domain %1$s to format %2$s\n",
+                  *domain, sysdb_cache_format_str(format));
+        }
+
+        ret = sysdb_manage_format(tmp_ctx, cache, convert, &current);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        if (!convert) {
+            PRINT("Cache format of domain %1$s: %2$s\n",
+                  *domain, sysdb_cache_format_str(current));
+        }
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+
+    return ret;
+}
+
+errno_t sssctl_cache_format(struct sss_cmdline *cmdline,
+                            struct sss_tool_ctx *tool_ctx,
+                            void *pvt)
+{
+    const char *format_str = NULL;
+    const char **domains = NULL;
+    const char **p;
+    enum sss_cache_format format = SSS_CACHE_FORMAT_STANDARD;
+    int stop = 0;
+    errno_t ret;
+
+    /* Parse command line. */
+    struct poptOption options[] = {
+        { "domain", 'd', POPT_ARG_ARGV, &domains,
+            0, _("Target a specific domain"), _("domain") },
+        { "stop", 'p', POPT_ARG_NONE, &stop,
+            0, _("Stop SSSD before converting the cache"), NULL },
+        POPT_TABLEEND
+    };
+
+    ret = sss_tool_popt_ex(cmdline, options, NULL, SSS_TOOL_OPT_OPTIONAL, NULL, NULL,
+                           "FORMAT", "standard | compact",
+                           SSS_TOOL_OPT_OPTIONAL, &format_str, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse command arguments\n");
+        goto done;
+    }
+
+    if (format_str != NULL) {
+        ret = sysdb_cache_format_from_str(format_str, &format);
+        if (ret != EOK) {
+            ERROR("Unknown format: %1$s\nValid formats are "
+                           "\"%2$s\" and \"%3$s\"\n",
+                  format_str, SYSDB_CACHE_FORMAT_STANDARD,
+                  SYSDB_CACHE_FORMAT_COMPACT);
+            goto done;
+        }
+    }
+
+    ret = sssctl_cache_format_action(domains, format_str != NULL, format,
+                                     stop);
+    if (ret != EOK) {
+        ERROR("Cache format operation failed: %1$s\n", sss_strerror(ret));
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    free(discard_const(format_str));
+    if (domains != NULL) {
+        for (p = domains; *p != NULL; p++) {
+            free(discard_const(*p));
+        }
+        free(discard_const(domains));
+    }
+
+    return ret;
+}
@@ -0,0 +1,174 @@
+/*
+    SSSD
+
+    sssctl - latency statistics of the responders
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <popt.h>
+#include <stdio.h>
+#include <string.h>
+#include <talloc.h>
+
+#include "util/util.h"
+#include "util/sss_histogram.h"
+#include "tools/common/sss_tools.h"
+#include "tools/sssctl/sssctl.h"
+#include "sbus/sbus_opath.h"
+#include "responder/ifp/ifp_iface/ifp_iface_sync.h"
+
+#define SSSCTL_STATS_COUNTER "counter/"
+
+static bool sssctl_stats_is_counter(const char *name)
+{
+    return strncmp(name, SSSCTL_STATS_COUNTER,
+                   sizeof(SSSCTL_STATS_COUNTER) - 1) == 0;
+}
+
+static void sssctl_stats_print(const char **names, uint64_t *values)
+{
+    bool counters = false;
+    uint64_t *v;
+    size_t i;
+
+    if (names == NULL || names[0] == NULL) {
+        PRINT("No requests were recorded yet.\n");
+        return;
+    }
+
+    PRINT("Times are in microseconds, reply sizes in bytes.\n\n");
+
+    printf("%-50s %10s %10s %10s %10s %10s %10s %10s\n",
+           _("Metric"), _("Count"), _("Mean"), "p50", "p90", "p99",
+           "p99.9", _("Max"));
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (sssctl_stats_is_counter(names[i])) {
+            counters = true;
+            continue;
+        }
+
+        v = &values[i * SSS_HISTOGRAM_FIELDS];
+        printf("%-50s %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64
+               " %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+               names[i], v[SSS_HISTOGRAM_COUNT], v[SSS_HISTOGRAM_MEAN],
+               v[SSS_HISTOGRAM_P50], v[SSS_HISTOGRAM_P90],
+               v[SSS_HISTOGRAM_P99], v[SSS_HISTOGRAM_P999],
+               v[SSS_HISTOGRAM_MAX]);
+    }
+
+    if (!counters) {
+        return;
+    }
+
+    printf("\n%-50s %10s\n", _("Counter"), _("Count"));
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (!sssctl_stats_is_counter(names[i])) {
+            continue;
+        }
+
+        printf("%-50s %10"PRIu64"\n",
+               names[i] + sizeof(SSSCTL_STATS_COUNTER) - 1,
+               values[i * SSS_HISTOGRAM_FIELDS + SSS_HISTOGRAM_COUNT]);
+    }
+}
+
+errno_t sssctl_stats_show(struct sss_cmdline *cmdline,
+                          struct sss_tool_ctx *tool_ctx,
+                          void *pvt)
+{
+    TALLOC_CTX *tmp_ctx = NULL;
+    struct sbus_sync_connection *conn;
+    const char *responder = NULL;
+    const char **names;
+    uint64_t *values;
+    const char *path;
+    size_t num;
+    int reset = 0;
+    errno_t ret;
+
+    /* Parse command line. */
+    struct poptOption options[] = {
+        {"reset", 'r', POPT_ARG_NONE, &reset, 0, _("Reset the statistics after printing them"), NULL },
+        POPT_TABLEEND
+    };
+
+    ret = sss_tool_popt_ex(cmdline, options, NULL, SSS_TOOL_OPT_OPTIONAL,
+                           NULL, NULL, "RESPONDER",
+                           _("Specify the responder, nss by default."),
+                           SSS_TOOL_OPT_OPTIONAL, &responder, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse command arguments\n");
+        goto done;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Out of memory!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    path = sbus_opath_compose(tmp_ctx, IFP_PATH_COMPONENTS, "Responders",
+                              responder == NULL ? "nss" : responder);
+    if (path == NULL) {
+        PRINT("Out of memory!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    conn = sbus_sync_connect_system(tmp_ctx, NULL);
+    if (conn == NULL) {
+        ERROR("Unable to connect to system bus!\n");
+        ret = EIO;
+        goto done;
+    }
+
+    ret = sbus_call_ifp_components_GetStatistics(tmp_ctx, conn, IFP_BUS, path,
+                                                 &names, &values);
+    if (ret != EOK) {
+        ERROR("Unable to get statistics of the responder\n");
+        PRINT_IFP_WARNING(ret);
+        goto done;
+    }
+
+    /* the values of each metric are transferred in one flat array */
+    for (num = 0; names != NULL && names[num] != NULL; num++);
+    if (talloc_array_length(values) < num * SSS_HISTOGRAM_FIELDS) {
+        ERROR("Malformed statistics received\n");
+        ret = EINVAL;
+        goto done;
+    }
+
+    sssctl_stats_print(names, values);
+
+    if (reset) {
+        ret = sbus_call_ifp_components_ResetStatistics(conn, IFP_BUS, path);
+        if (ret != EOK) {
+            ERROR("Unable to reset statistics of the responder\n");
+            PRINT_IFP_WARNING(ret);
+            goto done;
+        }
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    free(discard_const(responder));
+
+    return ret;
+}
@@ -36,10 +36,28 @@ typedef uint32_t rel_ptr_t;
 #define MC_64 sizeof(uint64_t)
 #define MC_ALIGN32(size) ( ((size) + MC_32 -1) & (~(MC_32 -1)) )
 #define MC_ALIGN64(size) ( ((size) + MC_64 -1) & (~(MC_64 -1)) )
+#define MC_CACHELINE 64
+#define MC_ALIGN_CACHELINE(size) \
+    ( ((size) + MC_CACHELINE - 1) & (~(MC_CACHELINE - 1)) )
 #define MC_HEADER_SIZE MC_ALIGN64(sizeof(struct sss_mc_header))
 
-#define MC_HT_SIZE(elems) ( (elems) * MC_32 )
-#define MC_HT_ELEMS(size) ( (size) / MC_32 )
+/* The hash table is an open addressing index made of cache line sized
+ * buckets. Each bucket stores the full hashes of up to
+ * MC_HT_BUCKET_ENTRIES keys next to the slots of their records, so a
+ * lookup usually touches a single cache line of the index. */
+#define MC_HT_BUCKET_ENTRIES 8
+#define MC_HT_BUCKET_SIZE sizeof(struct sss_mc_ht_bucket)
+#define MC_HT_SIZE(elems) \
+    ( (((elems) + MC_HT_BUCKET_ENTRIES - 1) / MC_HT_BUCKET_ENTRIES) \
+      * MC_HT_BUCKET_SIZE )
+#define MC_HT_ELEMS(size) ( ((size) / MC_HT_BUCKET_SIZE) * MC_HT_BUCKET_ENTRIES )
+#define MC_HT_BUCKETS(size) ( (size) / MC_HT_BUCKET_SIZE )
+
+/* Entries are probed linearly, bucket by bucket, starting with the first
+ * entry of the bucket selected by the hash */
+#define MC_HT_POS_BUCKET(hash, pos, n_buckets) \
+    ( ((hash) % (n_buckets) + (pos) / MC_HT_BUCKET_ENTRIES) % (n_buckets) )
+#define MC_HT_POS_ENTRY(pos) ( (pos) % MC_HT_BUCKET_ENTRIES )
 
 #define MC_PTR_ADD(ptr, bytes) (void *)((uint8_t *)(ptr) + (bytes))
 #define MC_PTR_DIFF(ptr, base) ((uint8_t *)(ptr) - (uint8_t *)(base))
@@ -49,6 +67,10 @@ typedef uint32_t rel_ptr_t;
 #define MC_INVALID_VAL8 ((uint8_t)-1)
 #define MC_INVALID_VAL MC_INVALID_VAL32
 
+/* marks a hash table entry whose record was removed, probing must continue
+ * past it (MC_INVALID_VAL marks an entry that was never used) */
+#define MC_HT_DELETED ((uint32_t)-2)
+
 /*
  * 40 seem a good compromise for slot size
  * 4 blocks are enough for the average passwd entry of 42 bytes
@@ -75,7 +97,7 @@ typedef uint32_t rel_ptr_t;
                             - MC_PTR_DIFF(rec, (mc_ctx)->data_table))))
 
 
-#define SSS_MC_MAJOR_VNO    1
+#define SSS_MC_MAJOR_VNO    2
 #define SSS_MC_MINOR_VNO    1
 
 #define SSS_MC_HEADER_UNINIT    0   /* after ftruncate or before reset */
@@ -95,25 +117,36 @@ struct sss_mc_header {
     rel_ptr_t data_table;   /* data table pointer relative to mmap base */
     rel_ptr_t free_table;   /* free table pointer relative to mmap base */
     rel_ptr_t hash_table;   /* hash table pointer relative to mmap base */
-    rel_ptr_t reserved;     /* reserved for future changes */
+    uint32_t generation;    /* bumped every time the file is regrown */
     uint32_t b2;            /* barrier 2 */
 };
 
+struct sss_mc_ht_bucket {
+    uint32_t hash[MC_HT_BUCKET_ENTRIES];  /* full hashes of the keys */
+    rel_ptr_t slot[MC_HT_BUCKET_ENTRIES]; /* slots of matching records,
+                                           * MC_INVALID_VAL if unused,
+                                           * MC_HT_DELETED if removed */
+};
+
 struct sss_mc_rec {
     uint32_t b1;            /* barrier 1 */
     uint32_t len;           /* total record length including record data */
     uint64_t expire;        /* record expiration time (cast to time_t) */
-    rel_ptr_t next1;        /* ptr of next record rel to data_table */
-                            /* next1 is related to hash1 */
-    rel_ptr_t next2;        /* ptr of next record rel to data_table */
-                            /* next2 is related to hash2 */
+    rel_ptr_t next1;        /* unused since major version 2, */
+    rel_ptr_t next2;        /* always MC_INVALID_VAL */
     uint32_t hash1;         /* val of first hash (usually name of record) */
     uint32_t hash2;         /* val of second hash (usually id of record) */
-    uint32_t padding;       /* padding & reserved for future changes */
+    uint32_t flags;         /* MC_REC_* flags, the rest is reserved */
     uint32_t b2;            /* barrier 2 - 32 bytes mark, fits a slot */
     char data[0];
 };
 
+/* The name or uid of the record is known not to exist, clients return
+ * NOTFOUND without asking the responder until the record expires.
+ * Only used in the passwd cache: records looked up by name have uid set to
+ * MC_INVALID_VAL32, records looked up by uid have an empty name. */
+#define MC_REC_NEGATIVE 0x00000001
+
 struct sss_mc_pwd_data {
     rel_ptr_t name;         /* ptr to name string, rel. to struct base addr */
     uint32_t uid;
@@ -155,7 +188,69 @@ struct sss_mc_sid_data {
     char sid[0];
 };
 
+/* Records of lookups whose results are cached as the body of the reply the
+ * NSS responder sent, clients parse it exactly as they parse the reply.
+ * The lookup key is stored as both hash1 and hash2:
+ * - netgroups: the netgroup name as passed to setnetgrent()
+ * - services: "name/protocol" or "port/protocol" with port in host byte
+ *   order, protocol is empty if not specified by the caller */
+struct sss_mc_rep_data {
+    rel_ptr_t name;         /* ptr to lookup key, rel. to struct base addr */
+    uint32_t strs_len;      /* length of strs */
+    uint32_t rep_len;       /* length of the reply body */
+    char strs[0];           /* zero terminated lookup key followed by the
+                             * reply body */
+};
+
 #pragma pack()
 
+/* MC_INVALID_VAL marks a record without hash, never produce it as a hash */
+static inline uint32_t sss_mc_key_hash(const char *key, size_t len,
+                                       uint32_t seed)
+{
+    uint32_t hash;
+
+    hash = murmurhash3(key, len, seed);
+    return (hash == MC_INVALID_VAL) ? 0 : hash;
+}
+
+/* Returns the slot of the next entry in the probe sequence of 'hash' whose
+ * stored hash matches, or MC_INVALID_VAL when the sequence ends.
+ * Start with *_pos set to 0 and pass the updated value on next calls. */
+static inline uint32_t sss_mc_ht_next_slot(const struct sss_mc_ht_bucket *ht,
+                                           uint32_t ht_size,
+                                           uint32_t hash,
+                                           uint32_t *_pos)
+{
+    const struct sss_mc_ht_bucket *bucket;
+    uint32_t n_buckets;
+    uint32_t max_pos;
+    uint32_t pos;
+    uint32_t entry;
+    uint32_t slot;
+
+    n_buckets = MC_HT_BUCKETS(ht_size);
+    max_pos = MC_HT_ELEMS(ht_size);
+
+    for (pos = *_pos; pos < max_pos; pos++) {
+        bucket = &ht[MC_HT_POS_BUCKET(hash, pos, n_buckets)];
+        entry = MC_HT_POS_ENTRY(pos);
+
+        slot = bucket->slot[entry];
+        if (slot == MC_INVALID_VAL) {
+            /* end of the probe sequence */
+            break;
+        }
+
+        if (slot != MC_HT_DELETED && bucket->hash[entry] == hash) {
+            *_pos = pos + 1;
+            return slot;
+        }
+    }
+
+    *_pos = max_pos;
+    return MC_INVALID_VAL;
+}
+
 
 #endif /* _MMAP_CACHE_H_ */
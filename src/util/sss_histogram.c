@@ -0,0 +1,179 @@
+/*
+    SSSD
+
+    Histograms of latencies and sizes
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "util/sss_histogram.h"
+
+static unsigned int sss_histogram_msb(uint64_t value)
+{
+    unsigned int msb = 0;
+
+    while (value >>= 1) {
+        msb++;
+    }
+
+    return msb;
+}
+
+static unsigned int sss_histogram_index(uint64_t value)
+{
+    unsigned int group;
+    unsigned int msb;
+
+    if (value < SSS_HISTOGRAM_SUB_COUNT) {
+        return value;
+    }
+
+    if (value >= SSS_HISTOGRAM_MAX_VALUE) {
+        value = SSS_HISTOGRAM_MAX_VALUE - 1;
+    }
+
+    /* the SSS_HISTOGRAM_SUB_BITS bits below the highest one select the
+     * bucket within the power of two */
+    msb = sss_histogram_msb(value);
+    group = msb - SSS_HISTOGRAM_SUB_BITS + 1;
+
+    return group * SSS_HISTOGRAM_SUB_COUNT
+           + (value >> (msb - SSS_HISTOGRAM_SUB_BITS))
+           - SSS_HISTOGRAM_SUB_COUNT;
+}
+
+/* Highest value that is counted in the bucket @index */
+static uint64_t sss_histogram_bucket_max(unsigned int index)
+{
+    unsigned int group;
+    unsigned int shift;
+    uint64_t sub;
+
+    group = index / SSS_HISTOGRAM_SUB_COUNT;
+    if (group == 0) {
+        return index;
+    }
+
+    shift = group - 1;
+    sub = SSS_HISTOGRAM_SUB_COUNT + index % SSS_HISTOGRAM_SUB_COUNT;
+
+    return ((sub + 1) << shift) - 1;
+}
+
+void sss_histogram_record(struct sss_histogram *h, uint64_t value)
+{
+    if (h->count == 0 || value < h->min) {
+        h->min = value;
+    }
+
+    if (value > h->max) {
+        h->max = value;
+    }
+
+    h->count++;
+    h->sum += value;
+    h->buckets[sss_histogram_index(value)]++;
+}
+
+uint64_t sss_histogram_percentile(const struct sss_histogram *h,
+                                  double percentile)
+{
+    uint64_t wanted;
+    uint64_t seen = 0;
+    uint64_t value;
+    unsigned int i;
+
+    if (h->count == 0) {
+        return 0;
+    }
+
+    if (percentile <= 0) {
+        return h->min;
+    }
+
+    if (percentile >= 100) {
+        return h->max;
+    }
+
+    wanted = (uint64_t)(percentile / 100.0 * h->count + 0.5);
+    if (wanted == 0) {
+        wanted = 1;
+    }
+
+    for (i = 0; i < SSS_HISTOGRAM_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= wanted) {
+            break;
+        }
+    }
+
+    if (i == SSS_HISTOGRAM_BUCKETS) {
+        return h->max;
+    }
+
+    value = sss_histogram_bucket_max(i);
+    if (value > h->max) {
+        value = h->max;
+    }
+    if (value < h->min) {
+        value = h->min;
+    }
+
+    return value;
+}
+
+void sss_histogram_summary(const struct sss_histogram *h,
+                           uint64_t *_summary)
+{
+    _summary[SSS_HISTOGRAM_COUNT] = h->count;
+    _summary[SSS_HISTOGRAM_MIN] = h->min;
+    _summary[SSS_HISTOGRAM_MEAN] = h->count == 0 ? 0 : h->sum / h->count;
+    _summary[SSS_HISTOGRAM_P50] = sss_histogram_percentile(h, 50);
+    _summary[SSS_HISTOGRAM_P90] = sss_histogram_percentile(h, 90);
+    _summary[SSS_HISTOGRAM_P99] = sss_histogram_percentile(h, 99);
+    _summary[SSS_HISTOGRAM_P999] = sss_histogram_percentile(h, 99.9);
+    _summary[SSS_HISTOGRAM_MAX] = h->max;
+}
+
+void sss_histogram_reset(struct sss_histogram *h)
+{
+    memset(h, 0, sizeof(struct sss_histogram));
+}
+
+void sss_histogram_merge(struct sss_histogram *dst,
+                         const struct sss_histogram *src)
+{
+    unsigned int i;
+
+    if (src->count == 0) {
+        return;
+    }
+
+    if (dst->count == 0 || src->min < dst->min) {
+        dst->min = src->min;
+    }
+
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+
+    dst->count += src->count;
+    dst->sum += src->sum;
+
+    for (i = 0; i < SSS_HISTOGRAM_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+}
@@ -0,0 +1,78 @@
+/*
+    SSSD
+
+    Histograms of latencies and sizes
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SSS_HISTOGRAM_H_
+#define _SSS_HISTOGRAM_H_
+
+#include <stdint.h>
+
+/* The values are counted in buckets whose width grows with the value (the
+ * layout HdrHistogram uses): every power of two is split into
+ * SSS_HISTOGRAM_SUB_COUNT buckets, so any recorded value is known with a
+ * relative error below 1/SSS_HISTOGRAM_SUB_COUNT. Values of
+ * SSS_HISTOGRAM_MAX_VALUE and above (19 hours in microseconds) are counted
+ * in the last bucket. */
+#define SSS_HISTOGRAM_SUB_BITS 4
+#define SSS_HISTOGRAM_SUB_COUNT (1 << SSS_HISTOGRAM_SUB_BITS)
+#define SSS_HISTOGRAM_MAX_BITS 36
+#define SSS_HISTOGRAM_MAX_VALUE (UINT64_C(1) << SSS_HISTOGRAM_MAX_BITS)
+#define SSS_HISTOGRAM_BUCKETS \
+    ((SSS_HISTOGRAM_MAX_BITS - SSS_HISTOGRAM_SUB_BITS + 1) \
+     * SSS_HISTOGRAM_SUB_COUNT)
+
+struct sss_histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[SSS_HISTOGRAM_BUCKETS];
+};
+
+/* Values reported by sss_histogram_summary(), in this order */
+enum sss_histogram_field {
+    SSS_HISTOGRAM_COUNT,
+    SSS_HISTOGRAM_MIN,
+    SSS_HISTOGRAM_MEAN,
+    SSS_HISTOGRAM_P50,
+    SSS_HISTOGRAM_P90,
+    SSS_HISTOGRAM_P99,
+    SSS_HISTOGRAM_P999,
+    SSS_HISTOGRAM_MAX,
+
+    SSS_HISTOGRAM_FIELDS
+};
+
+void sss_histogram_record(struct sss_histogram *h, uint64_t value);
+
+/* Returns the value below or at which @percentile (0 - 100) percent of the
+ * recorded values are, 0 if nothing was recorded yet. */
+uint64_t sss_histogram_percentile(const struct sss_histogram *h,
+                                  double percentile);
+
+/* Fills @_summary with SSS_HISTOGRAM_FIELDS values */
+void sss_histogram_summary(const struct sss_histogram *h,
+                           uint64_t *_summary);
+
+void sss_histogram_reset(struct sss_histogram *h);
+
+/* Adds all values recorded in @src to @dst */
+void sss_histogram_merge(struct sss_histogram *dst,
+                         const struct sss_histogram *src);
+
+#endif /* _SSS_HISTOGRAM_H_ */
@@ -785,6 +785,95 @@ errno_t sss_fd_nonblocking(int fd)
     return EOK;
 }
 
+static errno_t set_close_on_exec(int fd)
+{
+    int v;
+    int ferr;
+    errno_t error;
+
+    /* Get the current flags for this file descriptor */
+    v = fcntl(fd, F_GETFD, 0);
+
+    errno = 0;
+    /* Set the close-on-exec flags on this fd */
+    ferr = fcntl(fd, F_SETFD, v | FD_CLOEXEC);
+    if (ferr < 0) {
+        error = errno;
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Unable to set fd close-on-exec: [%d][%s]\n",
+                  error, strerror(error));
+        return error;
+    }
+    return EOK;
+}
+
+int create_pipe_fd(const char *sock_name, int *_fd, mode_t umaskval)
+{
+    struct sockaddr_un addr;
+    mode_t orig_umaskval;
+    errno_t ret;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return EIO;
+    }
+
+    orig_umaskval = umask(umaskval);
+
+    ret = sss_fd_nonblocking(fd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = set_close_on_exec(fd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_name, sizeof(addr.sun_path) - 1);
+    addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
+
+    /* make sure we have no old sockets around */
+    ret = unlink(sock_name);
+    if (ret != 0 && errno != ENOENT) {
+        ret = errno;
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot remove old socket (errno=%d [%s]), bind might fail!\n",
+              ret, sss_strerror(ret));
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Unable to bind on socket '%s' [%d]: %s\n",
+              sock_name, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    if (listen(fd, 128) == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Unable to listen on socket '%s' [%d]: %s\n",
+              sock_name, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    /* restore previous umask value */
+    umask(orig_umaskval);
+    if (ret == EOK) {
+        *_fd = fd;
+    } else {
+        close(fd);
+    }
+    return ret;
+}
+
 /* Convert GeneralizedTime (http://en.wikipedia.org/wiki/GeneralizedTime)
  * to unix time (seconds since epoch). Use UTC time zone.
  */
@@ -1020,6 +1109,23 @@ int sss_rand(void)
     return rand();
 }
 
+void sss_unique_id(uint8_t id[SSS_UNIQUE_ID_SIZE])
+{
+    static uint32_t counter = 0;
+    struct timespec ts;
+    uint64_t usec;
+    uint32_t pid;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    usec = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    pid = getpid();
+    counter++;
+
+    memcpy(id, &usec, sizeof(usec));
+    memcpy(id + sizeof(usec), &pid, sizeof(pid));
+    memcpy(id + sizeof(usec) + sizeof(pid), &counter, sizeof(counter));
+}
+
 errno_t sss_canonicalize_ip_address(TALLOC_CTX *mem_ctx,
                                     const char *address,
                                     char **canonical_address)
@@ -464,6 +464,10 @@ static inline errno_t add_strings_lists(TALLOC_CTX *mem_ctx,
  */
 errno_t sss_fd_nonblocking(int fd);
 
+/* Create a listening UNIX socket @sock_name, an old socket of the same
+ * name is removed first. */
+int create_pipe_fd(const char *sock_name, int *_fd, mode_t umaskval);
+
 /* Copy a NULL-terminated string list
  * Returns NULL on out of memory error or invalid input
  */
@@ -560,6 +564,13 @@ bool is_valid_domain_name(const char *domain);
  */
 int sss_rand(void);
 
+/* Fills id with a value that is unique among the values created on this host:
+ * the current time in microseconds, the process id and a per-process counter.
+ * Like sss_rand() it is *not* suitable for security relevant context.
+ */
+#define SSS_UNIQUE_ID_SIZE 16
+void sss_unique_id(uint8_t id[SSS_UNIQUE_ID_SIZE]);
+
 /* from nscd.c */
 errno_t sss_nscd_parse_conf(const char *conf_path);
 
@@ -842,6 +853,8 @@ errno_t create_preauth_indicator(void);
 #define PASSKEY_CHILD_TIMEOUT_DEFAULT 15
 #define PASSKEY_CHILD_LOG_FILE "passkey_child"
 #define PASSKEY_CHILD_PATH SSSD_LIBEXEC_PATH"/passkey_child"
+#define SYSDB_READER_CHILD_LOG_FILE "sysdb_reader_child"
+#define SYSDB_READER_CHILD_PATH SSSD_LIBEXEC_PATH"/sysdb_reader_child"
 
 #endif  /* SSSD_LIBEXEC_PATH */
 